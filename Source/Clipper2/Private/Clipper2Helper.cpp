@@ -37,7 +37,7 @@ void UClipper2Helper::GetLongestPath(TArray<FVector2D>& OutResult, const Clipper
 	int32 PathsSize = Paths.size();
 	const Clipper2Lib::Path64* PathPtr = nullptr;
 	OutResult.Empty(PathsSize);
-	if (PathsSize < 0)
+	if (PathsSize <= 0)
 	{
 		return;
 	}
@@ -64,6 +64,60 @@ void UClipper2Helper::GetLongestPath(TArray<FVector2D>& OutResult, const Clipper
 	}
 }
 
+void FClipper2Workspace::Offset(TArray<FVector2D>& OutResult, const TArray<FVector2D>& Points, const double Delta,
+                                const double MiterLimit)
+{
+	SetSubject(Points);
+	OffsetEngine.Clear();
+	OffsetEngine.AddPath(Subjects[0], Clipper2Lib::JoinType::Miter, Clipper2Lib::EndType::Polygon);
+	OffsetEngine.MiterLimit(MiterLimit);
+	OffsetEngine.Execute(Delta, Solution);
+	UClipper2Helper::GetLongestPath(OutResult, Solution);
+}
+
+void FClipper2Workspace::OffsetRings(TArray<TArray<FVector2D>>& OutRings, const TArray<FVector2D>& Points,
+                                     TArrayView<const double> Deltas, const double MiterLimit)
+{
+	SetSubject(Points);
+	// The engine keeps the added path, so it is only cleaned and oriented once for all deltas
+	OffsetEngine.Clear();
+	OffsetEngine.AddPath(Subjects[0], Clipper2Lib::JoinType::Miter, Clipper2Lib::EndType::Polygon);
+	OffsetEngine.MiterLimit(MiterLimit);
+	OutRings.SetNum(Deltas.Num());
+	for (int32 Ring = 0; Ring < Deltas.Num(); ++Ring)
+	{
+		OffsetEngine.Execute(Deltas[Ring], Solution);
+		UClipper2Helper::GetLongestPath(OutRings[Ring], Solution);
+	}
+}
+
+void FClipper2Workspace::Union(TArray<FVector2D>& OutResult, const TArray<FVector2D>& APoints,
+                               const TArray<FVector2D>& BPoints)
+{
+	SetSubject(APoints, 0);
+	SetSubject(BPoints, 1);
+	UnionEngine.Clear();
+	UnionEngine.AddSubject(Subjects);
+	UnionEngine.Execute(Clipper2Lib::ClipType::Union, Clipper2Lib::FillRule::NonZero, Solution);
+	UClipper2Helper::GetLongestPath(OutResult, Solution);
+}
+
+void FClipper2Workspace::SetSubject(const TArray<FVector2D>& Points, const int32 Path)
+{
+	// Only grows, the unused paths keep their buffers for later calls
+	if (Subjects.size() <= static_cast<size_t>(Path))
+	{
+		Subjects.resize(Path + 1);
+	}
+	Clipper2Lib::Path64& Subject = Subjects[Path];
+	Subject.clear();
+	Subject.reserve(Points.Num());
+	for (const FVector2D& Point : Points)
+	{
+		Subject.emplace_back(Point.X, Point.Y);
+	}
+}
+
 template <typename RealType, typename OutputType>
 Clipper2Lib::Paths<OutputType> UClipper2Helper::ConvertPolygonsToPaths(
 	const TArray<TArrayView<UE::Math::TVector2<RealType>>>& InPolygons,
@@ -4,6 +4,8 @@
 
 #include "CoreMinimal.h"
 #include "clipper.core.h"
+#include "clipper.engine.h"
+#include "clipper.offset.h"
 #include "Kismet/BlueprintFunctionLibrary.h"
 #include "Clipper2Helper.generated.h"
 
@@ -36,3 +38,28 @@ public:
 	template <typename OutputType>
 	static Clipper2Lib::Path<OutputType> MakePath(const TArray<FVector2D>& Points);
 };
+
+/**
+ * Offset and union with the same results as UClipper2Helper, for many calls in a row.
+ * The Clipper2 engines and integer path buffers keep their allocations from one call to the next.
+ * One workspace per thread, e.g. one per ParallelFor iteration.
+ */
+class CLIPPER2_API FClipper2Workspace
+{
+public:
+	void Offset(TArray<FVector2D>& OutResult, const TArray<FVector2D>& Points, double Delta, double MiterLimit = 5);
+
+	// One ring per delta, all offset from the same preprocessed Points.
+	void OffsetRings(TArray<TArray<FVector2D>>& OutRings, const TArray<FVector2D>& Points,
+	                 TArrayView<const double> Deltas, double MiterLimit = 5);
+
+	void Union(TArray<FVector2D>& OutResult, const TArray<FVector2D>& APoints, const TArray<FVector2D>& BPoints);
+
+private:
+	void SetSubject(const TArray<FVector2D>& Points, int32 Path = 0);
+
+	Clipper2Lib::ClipperOffset OffsetEngine;
+	Clipper2Lib::Clipper64 UnionEngine;
+	Clipper2Lib::Paths64 Subjects;
+	Clipper2Lib::Paths64 Solution;
+};
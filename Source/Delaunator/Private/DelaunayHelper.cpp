@@ -6,6 +6,7 @@
 #include <delaunator.hpp>
 
 #include "Delaunator.h"
+#include "DivideAndConquerDelaunay.h"
 
 float FDelaunayTriangle::GetArea() const
 {
@@ -57,81 +58,95 @@ FVector2D FDelaunayTriangle::GetCircumcenter() const
 	}
 }
 
-void FDelaunayMesh::CreatePoints(const TArray<FVector2D>& GivenPoints)
+namespace
 {
-	// Convert to standard vector
-	std::vector<double> coords = {};
-	for (const FVector2D& point : GivenPoints)
+	static_assert(sizeof(FVector2D) == 2 * sizeof(double), "Points are handed to the Delaunator as raw doubles");
+	static_assert(INVALID_DELAUNAY_INDEX == delaunator::INVALID_INDEX, "Index wrappers must share the invalid index");
+
+	// The index wrappers are a single SIZE_T, so the Delaunator buffers can be copied over in one go.
+	template <typename IndexType>
+	void CopyIndexBuffer(TArray<IndexType>& Out, const std::vector<std::size_t>& In)
 	{
-		// Push the coordinates into the vector 2 at a time
-		coords.push_back((double)point.X);
-		coords.push_back((double)point.Y);
+		static_assert(sizeof(IndexType) == sizeof(std::size_t), "Index wrappers must match std::size_t");
+		Out.SetNumUninitialized(static_cast<int32>(In.size()));
+		FMemory::Memcpy(Out.GetData(), In.data(), In.size() * sizeof(std::size_t));
 	}
+}
 
-	// Triangulation happens here
-	delaunator::Delaunator delaunay(coords);
-
-	// Place all the data from the Delaunator into this struct for
-	// easy access in Unreal
-
-	// Coordinates
-	Coordinates.Empty(delaunay.coords.size() / 2);
-	for (int i = 0; i < delaunay.coords.size(); i += 2)
+void FDelaunayMesh::CreatePoints(const TArray<FVector2D>& GivenPoints, EDelaunayTriangulator Triangulator)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FDelaunayMesh::CreatePoints)
+	if (Triangulator == EDelaunayTriangulator::DT_Automatic)
 	{
-		// The Delaunator stores everything in a vector of doubles
-		// It doesn't store information about which doubles are paired to each other
-		// However, we know that all even indices represent the X value, while odd indices
-		// represent the Y value
-		FVector2D coord = FVector2D((float)delaunay.coords[i], (float)delaunay.coords[i + 1]);
-		Coordinates.Add(coord);
+		Triangulator = GivenPoints.Num() >= PARALLEL_DELAUNAY_POINT_NUM ? EDelaunayTriangulator::DT_DivideAndConquer : EDelaunayTriangulator::DT_Delaunator;
 	}
 
-	// Half-edges
-	HalfEdges.Empty(delaunay.halfedges.size());
-	for (int i = 0; i < delaunay.halfedges.size(); i++)
+	// Neither triangulator moves the input points, so keep them at full precision
+	Coordinates = GivenPoints;
+	if (Triangulator == EDelaunayTriangulator::DT_DivideAndConquer)
 	{
-		HalfEdges.Add((FSideIndex)delaunay.halfedges[i]);
+		if (!FDivideAndConquerDelaunay::Triangulate(GivenPoints, DelaunayTriangles, HalfEdges))
+		{
+			UE_LOG(LogDelaunator, Error, TEXT("Could not triangulate %d points, they hold no three distinct points off a line."), GivenPoints.Num());
+		}
+		LinkHullFromSides();
 	}
-
-	// Triangles
-	DelaunayTriangles.Empty(delaunay.triangles.size());
-	for (int i = 0; i < delaunay.triangles.size(); i++)
+	else
 	{
-		DelaunayTriangles.Add((FPointIndex)delaunay.triangles[i]);
+		// The Delaunator wants interleaved doubles, which is exactly the layout of FVector2D
+		const double* pointData = reinterpret_cast<const double*>(GivenPoints.GetData());
+		const std::vector<double> coords(pointData, pointData + GivenPoints.Num() * 2);
+
+		// Triangulation happens here
+		delaunator::Delaunator delaunay(coords);
+
+		CopyIndexBuffer(HalfEdges, delaunay.halfedges);
+		CopyIndexBuffer(DelaunayTriangles, delaunay.triangles);
+
+		// Hull
+		// Index of the first point in the hull
+		HullStart = delaunay.hull_start;
+		// All triangles making up our hull, and the previous and next triangle of each
+		CopyIndexBuffer(HullTriangles, delaunay.hull_tri);
+		CopyIndexBuffer(HullPrevious, delaunay.hull_prev);
+		CopyIndexBuffer(HullNext, delaunay.hull_next);
 	}
 
-	PointToEdge.Empty();
+	PointToEdge.Init(FSideIndex(), Coordinates.Num());
 	for (FSideIndex e = 0; e < DelaunayTriangles.Num(); e++)
 	{
 		FPointIndex endpoint = DelaunayTriangles[UDelaunayHelper::NextHalfEdge(e)];
-		if (!PointToEdge.Contains(endpoint) || !HalfEdges[e].IsValid())
+		if (!PointToEdge[endpoint].IsValid() || !HalfEdges[e].IsValid())
 		{
-			PointToEdge.Add(endpoint, e);
+			PointToEdge[endpoint] = e;
 		}
 	}
 
 	UE_LOG(LogDelaunator, Log, TEXT("Created Delaunay Triangulation with %d points, %d triangles, and %d half-edges."), Coordinates.Num(), DelaunayTriangles.Num() / 3, HalfEdges.Num());
+}
 
-	// Hull
-	// Index of the first point in the hull
-	HullStart = delaunay.hull_start;
-	// All triangles making up our hull
-	HullTriangles.Empty(delaunay.hull_tri.size());
-	for (int i = 0; i < delaunay.hull_tri.size(); i++)
-	{
-		HullTriangles.Add(delaunay.hull_tri[i]);
-	}
-	// The previous triangle in the hull
-	HullPrevious.Empty(delaunay.hull_prev.size());
-	for (int i = 0; i < delaunay.hull_prev.size(); i++)
-	{
-		HullPrevious.Add(delaunay.hull_prev[i]);
-	}
-	// The next triangle in the hull
-	HullNext.Empty(delaunay.hull_next.size());
-	for (int i = 0; i < delaunay.hull_next.size(); i++)
+void FDelaunayMesh::LinkHullFromSides()
+{
+	// A hull side runs from a hull point to the next one, like the sides the Delaunator keeps in hull_tri
+	HullStart = FTriangleIndex();
+	HullTriangles.Init(FTriangleIndex(), Coordinates.Num());
+	HullPrevious.Init(FTriangleIndex(), Coordinates.Num());
+	HullNext.Init(FTriangleIndex(), Coordinates.Num());
+	for (FSideIndex s = 0; s < HalfEdges.Num(); s++)
 	{
-		HullNext.Add(delaunay.hull_next[i]);
+		if (HalfEdges[s].IsValid())
+		{
+			continue;
+		}
+		const FPointIndex begin = DelaunayTriangles[s];
+		const FPointIndex end = DelaunayTriangles[UDelaunayHelper::NextHalfEdge(s)];
+		HullTriangles[begin] = FTriangleIndex(s.Value);
+		HullNext[begin] = FTriangleIndex(end.Value);
+		HullPrevious[end] = FTriangleIndex(begin.Value);
+		if (!HullStart.IsValid())
+		{
+			HullStart = FTriangleIndex(begin.Value);
+		}
 	}
 }
 
@@ -292,15 +307,12 @@ FVector2D UDelaunayHelper::GetPointFromHalfEdge(const FDelaunayMesh& Triangulati
 
 FPointIndex UDelaunayHelper::GetPointIndexFromHalfEdge(const FDelaunayMesh& Triangulation, FSideIndex HalfEdge)
 {
-	FTriangleIndex triangleIndex = GetTriangleIndexFromHalfEdge(HalfEdge);
-	if (!Triangulation.DelaunayTriangles.IsValidIndex(triangleIndex))
+	if (!HalfEdge.IsValid() || !Triangulation.DelaunayTriangles.IsValidIndex(HalfEdge))
 	{
 		return FPointIndex();
 	}
-
-	uint8 pointNum = HalfEdge % 3; // 0, 1, or 2
-	TArray<FPointIndex> trianglePoints = UDelaunayHelper::PointsOfTriangle(Triangulation, triangleIndex);
-	return trianglePoints[pointNum];
+	// The start point of a half-edge is stored at the half-edge's own slot.
+	return Triangulation.DelaunayTriangles[HalfEdge];
 }
 
 FDelaunayTriangle UDelaunayHelper::GetTriangleFromHalfEdge(const FDelaunayMesh& Triangulation, FSideIndex HalfEdge)
@@ -0,0 +1,459 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "DivideAndConquerDelaunay.h"
+#include "Algo/Sort.h"
+#include "Async/ParallelFor.h"
+
+namespace
+{
+	// Strips smaller than this cost more to schedule than to triangulate
+	constexpr int32 MinStripPoints = 8192;
+	// A power of two, so the strips merge pairwise down to one
+	constexpr int32 MaxStrips = 64;
+	// Directed edges scanned per task while collecting the triangles
+	constexpr int32 CollectBlockSize = 16384;
+}
+
+bool FDivideAndConquerDelaunay::Triangulate(const TArray<FVector2D>& Points, TArray<FPointIndex>& OutTriangles,
+                                            TArray<FSideIndex>& OutHalfEdges)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FDivideAndConquerDelaunay::Triangulate)
+	OutTriangles.Reset();
+	OutHalfEdges.Reset();
+
+	FDivideAndConquerDelaunay triangulator;
+	triangulator.SortPoints(Points);
+	const int32 numPoints = triangulator.SortedPoints.Num();
+	if (numPoints < 3)
+	{
+		return false;
+	}
+
+	// The strip count only depends on the points, so every machine numbers the triangles the same way
+	int32 numStrips = 1;
+	while (numStrips * 2 <= MaxStrips && numPoints / (numStrips * 2) >= MinStripPoints)
+	{
+		numStrips *= 2;
+	}
+
+	// A planar graph on n points has at most 3n - 6 edges, at any point of the merges too
+	const int32 numPairs = 3 * numPoints + 3 * numStrips;
+	triangulator.Org.Init(INDEX_NONE, 2 * numPairs);
+	triangulator.Onext.SetNumUninitialized(2 * numPairs);
+	triangulator.Oprev.SetNumUninitialized(2 * numPairs);
+
+	TArray<FEdgePool> pools;
+	TArray<int32> leftEdges;
+	TArray<int32> rightEdges;
+	pools.SetNum(numStrips);
+	leftEdges.SetNumUninitialized(numStrips);
+	rightEdges.SetNumUninitialized(numStrips);
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(FDivideAndConquerDelaunay::Strips)
+		ParallelFor(numStrips, [&triangulator, &pools, &leftEdges, &rightEdges, numPoints, numStrips](int32 strip)
+		{
+			const int32 lo = static_cast<int32>(static_cast<int64>(numPoints) * strip / numStrips);
+			const int32 hi = static_cast<int32>(static_cast<int64>(numPoints) * (strip + 1) / numStrips);
+			FEdgePool& pool = pools[strip];
+			pool.Next = 3 * lo + 3 * strip;
+			pool.End = 3 * hi + 3 * (strip + 1);
+			triangulator.TriangulateRange(pool, lo, hi, leftEdges[strip], rightEdges[strip]);
+		});
+	}
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(FDivideAndConquerDelaunay::MergeStrips)
+		for (int32 step = 1; step < numStrips; step *= 2)
+		{
+			ParallelFor(numStrips / (2 * step), [&triangulator, &pools, &leftEdges, &rightEdges, step](int32 group)
+			{
+				const int32 left = 2 * step * group;
+				const int32 right = left + step;
+				triangulator.Absorb(pools[left], pools[right]);
+				triangulator.Merge(pools[left], leftEdges[left], rightEdges[left], leftEdges[right], rightEdges[right],
+				                   leftEdges[left], rightEdges[left]);
+			});
+		}
+	}
+	return triangulator.CollectTriangles(OutTriangles, OutHalfEdges);
+}
+
+void FDivideAndConquerDelaunay::SortPoints(const TArray<FVector2D>& Points)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FDivideAndConquerDelaunay::SortPoints)
+	const int32 numPoints = Points.Num();
+	if (numPoints == 0)
+	{
+		return;
+	}
+
+	// Bucket along x first, then sort the buckets in parallel. The buckets follow x, so the result is sorted.
+	double minX = Points[0].X;
+	double maxX = Points[0].X;
+	for (const FVector2D& point : Points)
+	{
+		minX = FMath::Min(minX, point.X);
+		maxX = FMath::Max(maxX, point.X);
+	}
+	const int32 numBuckets = FMath::Clamp(numPoints / 1024, 1, 4096);
+	const double bucketScale = maxX > minX ? numBuckets / (maxX - minX) : 0.0;
+	auto bucketOf = [minX, bucketScale, numBuckets](const FVector2D& Point)
+	{
+		return FMath::Clamp(static_cast<int32>((Point.X - minX) * bucketScale), 0, numBuckets - 1);
+	};
+
+	TArray<int32> bucketStart;
+	bucketStart.SetNumZeroed(numBuckets + 1);
+	for (const FVector2D& point : Points)
+	{
+		bucketStart[bucketOf(point) + 1]++;
+	}
+	for (int32 bucket = 0; bucket < numBuckets; bucket++)
+	{
+		bucketStart[bucket + 1] += bucketStart[bucket];
+	}
+	TArray<int32> order;
+	order.SetNumUninitialized(numPoints);
+	{
+		TArray<int32> cursor = bucketStart;
+		for (int32 i = 0; i < numPoints; i++)
+		{
+			order[cursor[bucketOf(Points[i])]++] = i;
+		}
+	}
+	ParallelFor(numBuckets, [&Points, &order, &bucketStart](int32 bucket)
+	{
+		Algo::Sort(TArrayView<int32>(order.GetData() + bucketStart[bucket], bucketStart[bucket + 1] - bucketStart[bucket]),
+		           [&Points](const int32 A, const int32 B)
+		           {
+			           const FVector2D& a = Points[A];
+			           const FVector2D& b = Points[B];
+			           return a.X < b.X || (a.X == b.X && (a.Y < b.Y || (a.Y == b.Y && A < B)));
+		           });
+	});
+
+	SortedPoints.Reset(numPoints);
+	SortedIndex.Reset(numPoints);
+	for (const int32 i : order)
+	{
+		if (SortedPoints.Num() > 0 && SortedPoints.Last() == Points[i])
+		{
+			continue;
+		}
+		SortedPoints.Add(Points[i]);
+		SortedIndex.Add(i);
+	}
+}
+
+bool FDivideAndConquerDelaunay::CCW(int32 A, int32 B, int32 C) const
+{
+	const FVector2D& a = SortedPoints[A];
+	const FVector2D& b = SortedPoints[B];
+	const FVector2D& c = SortedPoints[C];
+	return (b.X - a.X) * (c.Y - a.Y) - (b.Y - a.Y) * (c.X - a.X) > 0.0;
+}
+
+bool FDivideAndConquerDelaunay::InCircle(int32 A, int32 B, int32 C, int32 D) const
+{
+	const FVector2D& d = SortedPoints[D];
+	const FVector2D a = SortedPoints[A] - d;
+	const FVector2D b = SortedPoints[B] - d;
+	const FVector2D c = SortedPoints[C] - d;
+	const double aLift = a.X * a.X + a.Y * a.Y;
+	const double bLift = b.X * b.X + b.Y * b.Y;
+	const double cLift = c.X * c.X + c.Y * c.Y;
+	return aLift * (b.X * c.Y - c.X * b.Y) + bLift * (c.X * a.Y - a.X * c.Y) + cLift * (a.X * b.Y - b.X * a.Y) > 0.0;
+}
+
+int32 FDivideAndConquerDelaunay::MakeEdge(FEdgePool& Pool, int32 From, int32 To)
+{
+	int32 pair;
+	if (Pool.FreeHead != INDEX_NONE)
+	{
+		pair = Pool.FreeHead;
+		Pool.FreeHead = Onext[2 * pair];
+		if (Pool.FreeHead == INDEX_NONE)
+		{
+			Pool.FreeTail = INDEX_NONE;
+		}
+	}
+	else
+	{
+		check(Pool.Next < Pool.End);
+		pair = Pool.Next++;
+	}
+
+	const int32 edge = 2 * pair;
+	Org[edge] = From;
+	Org[edge + 1] = To;
+	Onext[edge] = Oprev[edge] = edge;
+	Onext[edge + 1] = Oprev[edge + 1] = edge + 1;
+	return edge;
+}
+
+void FDivideAndConquerDelaunay::Splice(int32 A, int32 B)
+{
+	// Joins the rings around the origins of A and B, or splits them if they are the same ring
+	const int32 aNext = Onext[A];
+	const int32 bNext = Onext[B];
+	Onext[A] = bNext;
+	Onext[B] = aNext;
+	Oprev[bNext] = A;
+	Oprev[aNext] = B;
+}
+
+int32 FDivideAndConquerDelaunay::Connect(FEdgePool& Pool, int32 A, int32 B)
+{
+	const int32 edge = MakeEdge(Pool, Dest(A), Org[B]);
+	Splice(edge, Lnext(A));
+	Splice(edge ^ 1, B);
+	return edge;
+}
+
+void FDivideAndConquerDelaunay::DeleteEdge(FEdgePool& Pool, int32 Edge)
+{
+	Splice(Edge, Oprev[Edge]);
+	Splice(Edge ^ 1, Oprev[Edge ^ 1]);
+
+	const int32 pair = Edge >> 1;
+	Org[2 * pair] = Org[2 * pair + 1] = INDEX_NONE;
+	Onext[2 * pair] = Pool.FreeHead;
+	Pool.FreeHead = pair;
+	if (Pool.FreeTail == INDEX_NONE)
+	{
+		Pool.FreeTail = pair;
+	}
+}
+
+void FDivideAndConquerDelaunay::Absorb(FEdgePool& Pool, FEdgePool& Other)
+{
+	for (int32 pair = Other.Next; pair < Other.End; pair++)
+	{
+		Onext[2 * pair] = Pool.FreeHead;
+		Pool.FreeHead = pair;
+		if (Pool.FreeTail == INDEX_NONE)
+		{
+			Pool.FreeTail = pair;
+		}
+	}
+	if (Other.FreeHead != INDEX_NONE)
+	{
+		if (Pool.FreeTail == INDEX_NONE)
+		{
+			Pool.FreeHead = Other.FreeHead;
+		}
+		else
+		{
+			Onext[2 * Pool.FreeTail] = Other.FreeHead;
+		}
+		Pool.FreeTail = Other.FreeTail;
+	}
+	Other = FEdgePool();
+}
+
+void FDivideAndConquerDelaunay::TriangulateRange(FEdgePool& Pool, int32 Lo, int32 Hi, int32& OutLeft, int32& OutRight)
+{
+	const int32 num = Hi - Lo;
+	if (num == 2)
+	{
+		const int32 a = MakeEdge(Pool, Lo, Lo + 1);
+		OutLeft = a;
+		OutRight = a ^ 1;
+		return;
+	}
+	if (num == 3)
+	{
+		const int32 a = MakeEdge(Pool, Lo, Lo + 1);
+		const int32 b = MakeEdge(Pool, Lo + 1, Lo + 2);
+		Splice(a ^ 1, b);
+		if (CCW(Lo, Lo + 1, Lo + 2))
+		{
+			Connect(Pool, b, a);
+			OutLeft = a;
+			OutRight = b ^ 1;
+		}
+		else if (CCW(Lo, Lo + 2, Lo + 1))
+		{
+			const int32 c = Connect(Pool, b, a);
+			OutLeft = c ^ 1;
+			OutRight = c;
+		}
+		else
+		{
+			// All three on one line
+			OutLeft = a;
+			OutRight = b ^ 1;
+		}
+		return;
+	}
+
+	const int32 mid = Lo + num / 2;
+	int32 leftOuter, leftInner, rightInner, rightOuter;
+	TriangulateRange(Pool, Lo, mid, leftOuter, leftInner);
+	TriangulateRange(Pool, mid, Hi, rightInner, rightOuter);
+	Merge(Pool, leftOuter, leftInner, rightInner, rightOuter, OutLeft, OutRight);
+}
+
+void FDivideAndConquerDelaunay::Merge(FEdgePool& Pool, int32 LeftOuter, int32 LeftInner, int32 RightInner,
+                                      int32 RightOuter, int32& OutLeft, int32& OutRight)
+{
+	// Find the lower common tangent of both hulls
+	while (true)
+	{
+		if (LeftOf(Org[RightInner], LeftInner))
+		{
+			LeftInner = Lnext(LeftInner);
+		}
+		else if (RightOf(Org[LeftInner], RightInner))
+		{
+			RightInner = Rprev(RightInner);
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	int32 base = Connect(Pool, RightInner ^ 1, LeftInner);
+	if (Org[LeftInner] == Org[LeftOuter])
+	{
+		LeftOuter = base ^ 1;
+	}
+	if (Org[RightInner] == Org[RightOuter])
+	{
+		RightOuter = base;
+	}
+
+	// Zip the seam upwards, deleting the edges the new cross edges invalidate
+	auto isAboveBase = [this, &base](const int32 Edge)
+	{
+		return RightOf(Dest(Edge), base);
+	};
+	while (true)
+	{
+		int32 leftCandidate = Onext[base ^ 1];
+		if (isAboveBase(leftCandidate))
+		{
+			while (InCircle(Dest(base), Org[base], Dest(leftCandidate), Dest(Onext[leftCandidate])))
+			{
+				const int32 next = Onext[leftCandidate];
+				DeleteEdge(Pool, leftCandidate);
+				leftCandidate = next;
+			}
+		}
+		int32 rightCandidate = Oprev[base];
+		if (isAboveBase(rightCandidate))
+		{
+			while (InCircle(Dest(base), Org[base], Dest(rightCandidate), Dest(Oprev[rightCandidate])))
+			{
+				const int32 next = Oprev[rightCandidate];
+				DeleteEdge(Pool, rightCandidate);
+				rightCandidate = next;
+			}
+		}
+
+		const bool bLeftValid = isAboveBase(leftCandidate);
+		const bool bRightValid = isAboveBase(rightCandidate);
+		if (!bLeftValid && !bRightValid)
+		{
+			break;
+		}
+		if (!bLeftValid || (bRightValid && InCircle(Dest(leftCandidate), Org[leftCandidate], Org[rightCandidate],
+		                                            Dest(rightCandidate))))
+		{
+			base = Connect(Pool, rightCandidate, base ^ 1);
+		}
+		else
+		{
+			base = Connect(Pool, base ^ 1, leftCandidate ^ 1);
+		}
+	}
+
+	OutLeft = LeftOuter;
+	OutRight = RightOuter;
+}
+
+bool FDivideAndConquerDelaunay::CollectTriangles(TArray<FPointIndex>& OutTriangles,
+                                                 TArray<FSideIndex>& OutHalfEdges) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FDivideAndConquerDelaunay::CollectTriangles)
+	// Every counterclockwise left face of three edges is a triangle, counted from its lowest edge
+	auto isFirstEdge = [this](const int32 Edge)
+	{
+		if (Org[Edge] == INDEX_NONE)
+		{
+			return false;
+		}
+		const int32 second = Lnext(Edge);
+		const int32 third = Lnext(second);
+		return Lnext(third) == Edge && Edge < second && Edge < third && CCW(Org[Edge], Org[second], Org[third]);
+	};
+
+	const int32 numEdges = Org.Num();
+	const int32 numBlocks = FMath::DivideAndRoundUp(numEdges, CollectBlockSize);
+	TArray<int32> blockStart;
+	blockStart.SetNumZeroed(numBlocks + 1);
+	ParallelFor(numBlocks, [&isFirstEdge, &blockStart, numEdges](int32 block)
+	{
+		const int32 end = FMath::Min((block + 1) * CollectBlockSize, numEdges);
+		for (int32 edge = block * CollectBlockSize; edge < end; edge++)
+		{
+			blockStart[block + 1] += isFirstEdge(edge) ? 1 : 0;
+		}
+	});
+	for (int32 block = 0; block < numBlocks; block++)
+	{
+		blockStart[block + 1] += blockStart[block];
+	}
+	const int32 numTriangles = blockStart[numBlocks];
+	if (numTriangles == 0)
+	{
+		return false;
+	}
+
+	// The Delaunator turns its triangles clockwise, so every face is written backwards:
+	// the edges a->b, b->c, c->a become the sides a->c, c->b, b->a
+	TArray<int32> firstEdges;
+	TArray<int32> edgeSides;
+	firstEdges.SetNumUninitialized(numTriangles);
+	edgeSides.Init(INDEX_NONE, numEdges);
+	OutTriangles.SetNumUninitialized(3 * numTriangles);
+	OutHalfEdges.SetNumUninitialized(3 * numTriangles);
+	ParallelFor(numBlocks, [this, &isFirstEdge, &blockStart, &firstEdges, &edgeSides, &OutTriangles, numEdges](int32 block)
+	{
+		int32 t = blockStart[block];
+		const int32 end = FMath::Min((block + 1) * CollectBlockSize, numEdges);
+		for (int32 edge = block * CollectBlockSize; edge < end; edge++)
+		{
+			if (!isFirstEdge(edge))
+			{
+				continue;
+			}
+			const int32 second = Lnext(edge);
+			const int32 third = Lnext(second);
+			firstEdges[t] = edge;
+			OutTriangles[3 * t] = SortedIndex[Org[edge]];
+			OutTriangles[3 * t + 1] = SortedIndex[Org[third]];
+			OutTriangles[3 * t + 2] = SortedIndex[Org[second]];
+			edgeSides[third] = 3 * t;
+			edgeSides[second] = 3 * t + 1;
+			edgeSides[edge] = 3 * t + 2;
+			t++;
+		}
+	});
+
+	// The opposite of a side is the side written for the reversed edge, none on the hull
+	ParallelFor(numTriangles, [this, &firstEdges, &edgeSides, &OutHalfEdges](int32 t)
+	{
+		auto opposite = [&edgeSides](const int32 Edge)
+		{
+			return edgeSides[Edge ^ 1] == INDEX_NONE ? FSideIndex() : FSideIndex(edgeSides[Edge ^ 1]);
+		};
+		const int32 first = firstEdges[t];
+		const int32 second = Lnext(first);
+		const int32 third = Lnext(second);
+		OutHalfEdges[3 * t] = opposite(third);
+		OutHalfEdges[3 * t + 1] = opposite(second);
+		OutHalfEdges[3 * t + 2] = opposite(first);
+	});
+	return true;
+}
@@ -0,0 +1,74 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DelaunayHelper.h"
+
+/**
+ * Guibas-Stolfi divide and conquer Delaunay triangulation.
+ * The points are sorted along x and cut into strips, every strip is triangulated on its own task, then neighboring
+ * strips are merged pairwise, each level of merges again in parallel.
+ * The result has the layout of the Delaunator: clockwise triangles, three sides per triangle, unpaired hull sides.
+ * Points equal to an earlier point are left out of the triangulation, like the Delaunator does.
+ */
+class FDivideAndConquerDelaunay
+{
+public:
+	// False if there are no three distinct points that are not on one line; the outputs are empty then.
+	static bool Triangulate(const TArray<FVector2D>& Points, TArray<FPointIndex>& OutTriangles,
+	                        TArray<FSideIndex>& OutHalfEdges);
+
+private:
+	// Edges are allocated in pairs, one pair per undirected edge. Every strip starts with its own range of pairs
+	// and merged strips share the free pairs, so tasks never allocate from the same pool.
+	struct FEdgePool
+	{
+		int32 FreeHead = INDEX_NONE;
+		int32 FreeTail = INDEX_NONE;
+		int32 Next = 0;
+		int32 End = 0;
+	};
+
+	// Points sorted by x, then y, without duplicates
+	TArray<FVector2D> SortedPoints;
+	// The index in the input of every sorted point
+	TArray<int32> SortedIndex;
+
+	// Quad-edges without the dual: directed edge e runs from Org[e] to Org[e ^ 1], Onext and Oprev link the edges
+	// around the same origin counterclockwise and clockwise. Free pairs have no origin.
+	TArray<int32> Org;
+	TArray<int32> Onext;
+	TArray<int32> Oprev;
+
+	void SortPoints(const TArray<FVector2D>& Points);
+
+	int32 Dest(int32 Edge) const { return Org[Edge ^ 1]; }
+	// The next edge counterclockwise around the left face
+	int32 Lnext(int32 Edge) const { return Oprev[Edge ^ 1]; }
+	// The previous edge around the right face
+	int32 Rprev(int32 Edge) const { return Onext[Edge ^ 1]; }
+
+	bool CCW(int32 A, int32 B, int32 C) const;
+	// True if D is inside the circle through the counterclockwise triangle A, B, C
+	bool InCircle(int32 A, int32 B, int32 C, int32 D) const;
+	bool RightOf(int32 Point, int32 Edge) const { return CCW(Point, Dest(Edge), Org[Edge]); }
+	bool LeftOf(int32 Point, int32 Edge) const { return CCW(Point, Org[Edge], Dest(Edge)); }
+
+	int32 MakeEdge(FEdgePool& Pool, int32 From, int32 To);
+	void Splice(int32 A, int32 B);
+	// Adds an edge from the destination of A to the origin of B, with the same left face as both
+	int32 Connect(FEdgePool& Pool, int32 A, int32 B);
+	void DeleteEdge(FEdgePool& Pool, int32 Edge);
+	// Moves the free pairs of Other into Pool
+	void Absorb(FEdgePool& Pool, FEdgePool& Other);
+
+	// Triangulates the sorted points [Lo, Hi), at least two of them. OutLeft is the counterclockwise hull edge
+	// leaving the leftmost point, OutRight the clockwise hull edge leaving the rightmost point.
+	void TriangulateRange(FEdgePool& Pool, int32 Lo, int32 Hi, int32& OutLeft, int32& OutRight);
+	// Stitches the triangulations on either side of a cut along x together
+	void Merge(FEdgePool& Pool, int32 LeftOuter, int32 LeftInner, int32 RightInner, int32 RightOuter,
+	           int32& OutLeft, int32& OutRight);
+
+	bool CollectTriangles(TArray<FPointIndex>& OutTriangles, TArray<FSideIndex>& OutHalfEdges) const;
+};
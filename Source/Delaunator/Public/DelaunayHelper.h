@@ -19,6 +19,20 @@
 // We purposely underflow it to get the max value
 constexpr SIZE_T INVALID_DELAUNAY_INDEX = (SIZE_T)-1;
 
+// Point count from which EDelaunayTriangulator::DT_Automatic switches to the divide and conquer triangulation
+constexpr int32 PARALLEL_DELAUNAY_POINT_NUM = 100000;
+
+UENUM(BlueprintType)
+enum class EDelaunayTriangulator : uint8
+{
+	// The Delaunator for small maps, divide and conquer from PARALLEL_DELAUNAY_POINT_NUM points on
+	DT_Automatic UMETA(DisplayName="Automatic"),
+	// Single threaded sweep, fastest for small maps
+	DT_Delaunator UMETA(DisplayName="Delaunator"),
+	// Guibas-Stolfi divide and conquer, strips triangulated and merged in parallel
+	DT_DivideAndConquer UMETA(DisplayName="Divide and Conquer"),
+};
+
 #define PACKED
 #pragma pack(push,1)
 USTRUCT(BlueprintType)
@@ -352,9 +366,10 @@ public:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
 	TArray<FSideIndex> HalfEdges;
 
-	// An index mapping point IDs to half-edge IDs
+	// An index mapping point IDs to half-edge IDs, indexed by point.
+	// Points without an edge hold an invalid side.
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
-	TMap<FPointIndex, FSideIndex> PointToEdge;
+	TArray<FSideIndex> PointToEdge;
 
 	// Starting triangle for the hull.
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, AdvancedDisplay)
@@ -381,20 +396,25 @@ public:
 		HullStart = FTriangleIndex();
 	}
 
-	FDelaunayMesh(const TArray<FVector2D>& GivenPoints)
+	FDelaunayMesh(const TArray<FVector2D>& GivenPoints, EDelaunayTriangulator Triangulator = EDelaunayTriangulator::DT_Delaunator)
 	{
 		HullStart = FTriangleIndex();
-		CreatePoints(GivenPoints);
+		CreatePoints(GivenPoints, Triangulator);
 	}
 
 public:
-	// Generates the actual triangulation
-	void CreatePoints(const TArray<FVector2D>& GivenPoints);
+	// Generates the actual triangulation. Both triangulators give the same layout; which of several equally
+	// valid triangulations of cocircular points comes out, and the order of the triangles, differ between them.
+	void CreatePoints(const TArray<FVector2D>& GivenPoints, EDelaunayTriangulator Triangulator = EDelaunayTriangulator::DT_Delaunator);
 	// Gets the area of the Delaunay hull.
 	float GetHullArea(float& OutErrorAmount) const;
 	// Returns the Kahan and Babuska of an array of floats.
 	// Adapted from the Delaunator HPP file.
 	float Sum(const TArray<float>& Area, float& OutErrorAmount) const;
+
+private:
+	// Fills the hull arrays the way the Delaunator does, from the sides without an opposite side
+	void LinkHullFromSides();
 };
 
 /**
@@ -38,6 +38,7 @@ public class DualMesh : ModuleRules
 				"Delaunator",
 				"CoreUObject",
 				"Engine",
+				"Json",
 				"Slate",
 				"SlateCore"
 				// ... add private dependencies that you statically link with here ...	
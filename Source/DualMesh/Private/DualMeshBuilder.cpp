@@ -20,12 +20,15 @@
 
 #include "DualMeshBuilder.h"
 #include "Delaunator/Public/DelaunayHelper.h"
+#include "Algo/Sort.h"
 #include "RandomSampling/PoissonDiscUtilities.h"
+#include "ScratchContainers.h"
 
 
 TArray<FVector2D> UDualMeshBuilder::AddBoundaryPoints(int32 Spacing, const FVector2D& Size)
 {
-	TSet<FVector2D> points;
+	FMemMark mark(FMemStack::Get());
+	TScratchSet<FVector2D> points;
 
 	// If we have no spacing, return an empty array of points
 	if (Spacing <= 0)
@@ -70,6 +73,7 @@ UDualMeshBuilder::UDualMeshBuilder()
 {
 	NumBoundaryRegions = -1;
 	MaxMeshSize = FVector2D::ZeroVector;
+	Triangulator = EDelaunayTriangulator::DT_Automatic;
 }
 
 void UDualMeshBuilder::Initialize(const FVector2D& MaxSize, int32 BoundarySpacing /*= 0*/)
@@ -110,7 +114,18 @@ void UDualMeshBuilder::AddPoisson(FRandomStream& Rng, FVector2D MapOffset, float
 	Rng.GetFraction(); // Generates the next seed
 }
 
-UTriangleDualMesh* UDualMeshBuilder::Create()
+void UDualMeshBuilder::AddTiledPoisson(FRandomStream& Rng, FVector2D MapOffset, float Spacing, int32 MaxStepSamples, int32 TileCells)
+{
+	UPoissonDiscUtilities::DistributeTiled2D(Points, Rng.GetCurrentSeed(), MaxMeshSize - MapOffset, MapOffset * 0.5f, Spacing, MaxStepSamples, TileCells);
+	Rng.GetFraction(); // Generates the next seed
+}
+
+void UDualMeshBuilder::SetTriangulator(EDelaunayTriangulator NewTriangulator)
+{
+	Triangulator = NewTriangulator;
+}
+
+UTriangleDualMesh* UDualMeshBuilder::Create(bool bSortSpatially)
 {
 	if (NumBoundaryRegions == -1)
 	{
@@ -120,9 +135,75 @@ UTriangleDualMesh* UDualMeshBuilder::Create()
 
 	UTriangleDualMesh* mesh = NewObject<UTriangleDualMesh>();
 	check(mesh);
-	
-	FDualMesh dualMesh = FDualMesh(Points, MaxMeshSize);
-	mesh->InitializeMesh(dualMesh, NumBoundaryRegions);
-	
+	CreateInto(mesh, bSortSpatially);
 	return mesh;
 }
+
+bool UDualMeshBuilder::CreateInto(UTriangleDualMesh* Mesh, bool bSortSpatially) const
+{
+	if (NumBoundaryRegions == -1 || Mesh == nullptr)
+	{
+		UE_LOG(LogDualMesh, Error, TEXT("Dual mesh's attributes were not set. Initialize before trying to create a DualMesh."));
+		return false;
+	}
+
+	if (!bSortSpatially)
+	{
+		FDualMesh dualMesh = FDualMesh(Points, MaxMeshSize, false, Triangulator);
+		Mesh->InitializeMesh(dualMesh, NumBoundaryRegions);
+		return true;
+	}
+
+	// The boundary regions have to stay in front, so both ranges are sorted on their own
+	TArray<TPair<uint32, int32>> order;
+	order.SetNumUninitialized(Points.Num());
+	for (int32 i = 0; i < Points.Num(); i++)
+	{
+		order[i] = TPair<uint32, int32>(FDualMesh::HilbertIndex(Points[i], MaxMeshSize), i);
+	}
+	auto byCurve = [](const TPair<uint32, int32>& A, const TPair<uint32, int32>& B)
+	{
+		return A.Key < B.Key || (A.Key == B.Key && A.Value < B.Value);
+	};
+	Algo::Sort(TArrayView<TPair<uint32, int32>>(order.GetData(), NumBoundaryRegions), byCurve);
+	Algo::Sort(TArrayView<TPair<uint32, int32>>(order.GetData() + NumBoundaryRegions,
+	                                            Points.Num() - NumBoundaryRegions), byCurve);
+	TArray<FVector2D> sortedPoints;
+	sortedPoints.SetNumUninitialized(Points.Num());
+	for (int32 i = 0; i < Points.Num(); i++)
+	{
+		sortedPoints[i] = Points[order[i].Value];
+	}
+	FDualMesh dualMesh = FDualMesh(sortedPoints, MaxMeshSize, true, Triangulator);
+	Mesh->InitializeMesh(dualMesh, NumBoundaryRegions);
+	return true;
+}
+
+UTriangleDualMesh* UDualMeshBuilder::CreateGrid(int32 Columns, int32 Rows, bool bHexagonal, bool bSortSpatially)
+{
+	if (NumBoundaryRegions == -1)
+	{
+		UE_LOG(LogDualMesh, Error, TEXT("Dual mesh's attributes were not set. Initialize before trying to create a DualMesh."));
+		return NULL;
+	}
+
+	UTriangleDualMesh* mesh = NewObject<UTriangleDualMesh>();
+	check(mesh);
+	CreateGridInto(mesh, Columns, Rows, bHexagonal, bSortSpatially);
+	return mesh;
+}
+
+bool UDualMeshBuilder::CreateGridInto(UTriangleDualMesh* Mesh, int32 Columns, int32 Rows, bool bHexagonal,
+                                      bool bSortSpatially) const
+{
+	if (NumBoundaryRegions == -1 || Mesh == nullptr)
+	{
+		UE_LOG(LogDualMesh, Error, TEXT("Dual mesh's attributes were not set. Initialize before trying to create a DualMesh."));
+		return false;
+	}
+
+	// The grid numbers its regions row by row already, only the triangles are sorted
+	FDualMesh dualMesh = FDualMesh(Columns, Rows, MaxMeshSize, bHexagonal, bSortSpatially);
+	Mesh->InitializeMesh(dualMesh, FDualMesh::GridBoundaryRegionNum(Columns, Rows));
+	return true;
+}
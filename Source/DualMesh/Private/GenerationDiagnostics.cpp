@@ -0,0 +1,95 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "GenerationDiagnostics.h"
+
+namespace
+{
+	thread_local FGenerationDiagnostics* ActiveDiagnostics = nullptr;
+}
+
+void FGenerationDiagnostics::Add(const TCHAR* Category, int64 Index)
+{
+	FScopeLock ScopeLock(&Lock);
+	FCategory* Entry = Categories.FindByPredicate([Category](const FCategory& Existing)
+	{
+		return Existing.Name == Category;
+	});
+	if (Entry == nullptr)
+	{
+		Entry = &Categories.AddDefaulted_GetRef();
+		Entry->Name = Category;
+	}
+	Entry->Count++;
+	if (Index != INDEX_NONE && Entry->Samples.Num() < MaxSamples)
+	{
+		Entry->Samples.Add(Index);
+	}
+}
+
+void FGenerationDiagnostics::Reset()
+{
+	FScopeLock ScopeLock(&Lock);
+	Categories.Reset();
+}
+
+void FGenerationDiagnostics::Assign(const FGenerationDiagnostics& Other)
+{
+	if (&Other == this)
+	{
+		return;
+	}
+	TArray<FCategory> OtherCategories = Other.GetCategories();
+	FScopeLock ScopeLock(&Lock);
+	Categories = MoveTemp(OtherCategories);
+}
+
+bool FGenerationDiagnostics::IsEmpty() const
+{
+	FScopeLock ScopeLock(&Lock);
+	return Categories.IsEmpty();
+}
+
+int64 FGenerationDiagnostics::GetCount(const TCHAR* Category) const
+{
+	FScopeLock ScopeLock(&Lock);
+	const FCategory* Entry = Categories.FindByPredicate([Category](const FCategory& Existing)
+	{
+		return Existing.Name == Category;
+	});
+	return Entry != nullptr ? Entry->Count : 0;
+}
+
+TArray<FGenerationDiagnostics::FCategory> FGenerationDiagnostics::GetCategories() const
+{
+	FScopeLock ScopeLock(&Lock);
+	return Categories;
+}
+
+FGenerationDiagnostics* FGenerationDiagnostics::GetActive()
+{
+	return ActiveDiagnostics;
+}
+
+bool FGenerationDiagnostics::AddActive(const TCHAR* Category, int64 Index)
+{
+	if (ActiveDiagnostics == nullptr)
+	{
+		return false;
+	}
+	ActiveDiagnostics->Add(Category, Index);
+	return true;
+}
+
+FGenerationDiagnosticsScope::FGenerationDiagnosticsScope(FGenerationDiagnostics* Diagnostics)
+	: Previous(ActiveDiagnostics)
+{
+	if (Diagnostics != nullptr)
+	{
+		ActiveDiagnostics = Diagnostics;
+	}
+}
+
+FGenerationDiagnosticsScope::~FGenerationDiagnosticsScope()
+{
+	ActiveDiagnostics = Previous;
+}
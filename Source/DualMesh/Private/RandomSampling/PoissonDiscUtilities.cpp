@@ -18,138 +18,265 @@
 
 #include "RandomSampling/PoissonDiscUtilities.h"
 
+#include "Async/ParallelFor.h"
+
+namespace
+{
+	/** Candidates land up to twice the minimum distance away, which is less than three cells. */
+	constexpr int32 CandidateReachCells = 3;
+	/** Distance checks look at a 5x5 block of cells around the candidate. */
+	constexpr int32 NeighborCells = 2;
+}
+
 void UPoissonDiscUtilities::Distribute2D(TArray<FVector2D>& Samples, int32 Seed, FVector2D Size, FVector2D StartLocation, float MinimumDistance, int32 MaxStepSamples, bool WrapX, bool WrapY)
 {
-	uint64 iCells, iCellsX, iCellsY, iCell, iCellX, iCellY;
-	double dCellSize;
-	FVector2D* v2DSample; FVector2D** v2DSamples;
-	TDoubleLinkedList<FVector2D*>* v2DList;
-	FRandomStream rsRandomStream = FRandomStream(Seed);
+	TRACE_CPUPROFILER_EVENT_SCOPE(UPoissonDiscUtilities::Distribute2D)
+	FRandomStream RandomStream = FRandomStream(Seed);
 
 	// Calculate cell size, count and total.
-	dCellSize = MinimumDistance / sqrt(2.0);
-	iCellsX = ceil(Size.X / dCellSize);
-	iCellsY = ceil(Size.Y / dCellSize);
-	iCells = iCellsX * iCellsY;
-
-	// Initialize temporary arrays and lists for the generated elements.
-	v2DSamples = new FVector2D*[iCells];
-	v2DList = new TDoubleLinkedList<FVector2D*>();
-	for (uint64 n = 0; n < iCells; ++n)
-		v2DSamples[n] = NULL;
+	const double CellSize = MinimumDistance / sqrt(2.0);
+	if (CellSize <= 0.0 || Size.X <= 0.0 || Size.Y <= 0.0)
+	{
+		return;
+	}
+	const int64 CellsX = ceil(Size.X / CellSize);
+	const int64 CellsY = ceil(Size.Y / CellSize);
+	const int64 Cells = CellsX * CellsY;
+	const double MinimumDistanceSquared = FMath::Square((double)MinimumDistance);
+
+	// No two samples share a cell, so the sample list can never outgrow the grid.
+	// Both live in one block: the sample positions first, then the sample index of every cell.
+	FVector2D* CellSamples = static_cast<FVector2D*>(FMemory::Malloc(Cells * (sizeof(FVector2D) + sizeof(int32))));
+	int32* Grid = reinterpret_cast<int32*>(CellSamples + Cells);
+	FMemory::Memset(Grid, 0xFF, Cells * sizeof(int32));
+	int32 SampleNum = 0;
+
+	auto CellOf = [CellSize, CellsX, CellsY](const FVector2D& Sample)
+	{
+		const int64 CellX = FMath::Min((int64)(Sample.X / CellSize), CellsX - 1);
+		const int64 CellY = FMath::Min((int64)(Sample.Y / CellSize), CellsY - 1);
+		return CellX + CellY * CellsX;
+	};
 
 	// Generate starting sample.
-	v2DSample = new FVector2D(rsRandomStream.FRandRange(0, Size.X), rsRandomStream.FRandRange(0, Size.Y));
-	iCellX = (int)(v2DSample->X / dCellSize);
-	iCellY = (int)(v2DSample->Y / dCellSize);
-	iCell = iCellX + (iCellY * iCellsX);
-	v2DSamples[iCell] = v2DSample;
-	v2DList->AddTail(v2DSample);
-
-	// Generate samples until the processing list is empty (no more samples can be generated).
-	while (v2DList->Num() > 0) {
-		FVector2D* v2DSampleOrigin = v2DList->GetHead()->GetValue();
-
-		// Check if the retrieved sample is NULL instead of a valid vector,
-		if (v2DSampleOrigin == NULL) { // and break out instead.
-			break;
-		}
+	const double StartX = RandomStream.FRandRange(0, Size.X);
+	const double StartY = RandomStream.FRandRange(0, Size.Y);
+	CellSamples[SampleNum] = FVector2D(StartX, StartY);
+	Grid[CellOf(CellSamples[SampleNum])] = SampleNum;
+	++SampleNum;
+
+	// Samples are always expanded oldest first and only ever leave from the front,
+	// so the processing list is just the range [Active, SampleNum) of the sample array.
+	for (int32 Active = 0; Active < SampleNum;)
+	{
+		const FVector2D Origin = CellSamples[Active];
 
 		// Now try and generate samples around the sample origin.
 		bool bIsSuccessful = false;
-		for (uint32 i = 0; i < (uint32)MaxStepSamples; ++i) {
-			double dAngle, dRadius;
-			dAngle = rsRandomStream.FRandRange(0, PI * 2.0f) + (double)i;
-			dRadius = rsRandomStream.FRandRange(1.0f, 2.0f) * (double)MinimumDistance;
-			v2DSample = new FVector2D(v2DSampleOrigin->X + (dRadius * cos(dAngle)), v2DSampleOrigin->Y + (dRadius * sin(dAngle)));
-
-			// Destroy sample if outside of boundaries.
-			if ((v2DSample->X < 0 || v2DSample->X > Size.X) || (v2DSample->Y < 0 || v2DSample->Y > Size.Y)) {
-				delete v2DSample; continue;
+		for (int32 Step = 0; Step < MaxStepSamples; ++Step)
+		{
+			const double Angle = RandomStream.FRandRange(0, PI * 2.0f) + (double)Step;
+			const double Radius = RandomStream.FRandRange(1.0f, 2.0f) * (double)MinimumDistance;
+			const FVector2D Sample(Origin.X + (Radius * cos(Angle)), Origin.Y + (Radius * sin(Angle)));
+
+			// Discard the sample if outside of boundaries.
+			if (Sample.X < 0 || Sample.X > Size.X || Sample.Y < 0 || Sample.Y > Size.Y)
+			{
+				continue;
 			}
-			else {
-				// Check if it too close to any other sample generated.
-				iCellX = (uint64)(v2DSample->X / dCellSize);
-				iCellY = (uint64)(v2DSample->Y / dCellSize);
-				iCell = iCellX + (iCellY * iCellsX);
-				if (iCell < 0 || iCell > iCells) {
-					delete v2DSample; continue;
-				}
-				else {
-					for (int x = -2; x <= 2; x++) { // Loop through nearest grid points that are inside the radius.
-						for (int y = -2; y <= 2; y++) {
-							float fRealX = v2DSample->X, fRealY = v2DSample->Y;
-							int64 iTempCellX = iCellX + x;
-							int64 iTempCellY = iCellY + y;
-
-							if (!WrapX) {
-								if (iTempCellX < 0 || iTempCellX >= (int64)iCellsX)
-									continue;
-							}
-							else {
-								if (iTempCellX < 0) {
-									iTempCellX = iTempCellX + iCellsX;
-									v2DSample->X = fRealX + Size.X;
-								}
-								else if (iTempCellX >= (int64)iCellsX) {
-									iTempCellX = iTempCellX - iCellsX;
-									v2DSample->X = fRealX - Size.X;
-								}
-							}
-							if (!WrapY) {
-								if (iTempCellY < 0 || iTempCellY >= (int64)iCellsY)
-									continue;
-							}
-							else {
-								if (iTempCellY < 0) {
-									iTempCellY = iTempCellY + iCellsY;
-									v2DSample->Y = fRealY + Size.Y;
-								}
-								else if (iTempCellY >= (int64)iCellsY) {
-									iTempCellY = iTempCellY - iCellsY;
-									v2DSample->Y = fRealY - Size.Y;
-								}
-							}
-							int64 iTempCell = iTempCellX + (iTempCellY * iCellsX);
-
-							if (v2DSamples[iTempCell] != NULL) {
-								double dDist = FVector2D::Distance(*v2DSamples[iTempCell], *v2DSample);
-								if (dDist < MinimumDistance) {
-									delete v2DSample;
-									goto PoissonDisc2DCheckBreakout;
-								}
-							}
 
-							if (WrapX || WrapY) {
-								v2DSample->X = fRealX;
-								v2DSample->Y = fRealY;
-							}
+			// Check if it too close to any other sample generated.
+			const int64 Cell = CellOf(Sample);
+			const int64 CellX = Cell % CellsX;
+			const int64 CellY = Cell / CellsX;
+			bool bIsTooClose = false;
+			for (int32 X = -2; X <= 2 && !bIsTooClose; ++X)
+			{
+				int64 NeighborX = CellX + X;
+				double OffsetX = 0.0;
+				if (NeighborX < 0 || NeighborX >= CellsX)
+				{
+					if (!WrapX)
+					{
+						continue;
+					}
+					OffsetX = NeighborX < 0 ? Size.X : -Size.X;
+					NeighborX += NeighborX < 0 ? CellsX : -CellsX;
+				}
+				for (int32 Y = -2; Y <= 2; ++Y)
+				{
+					int64 NeighborY = CellY + Y;
+					double OffsetY = 0.0;
+					if (NeighborY < 0 || NeighborY >= CellsY)
+					{
+						if (!WrapY)
+						{
+							continue;
 						}
+						OffsetY = NeighborY < 0 ? Size.Y : -Size.Y;
+						NeighborY += NeighborY < 0 ? CellsY : -CellsY;
+					}
+					const int32 Neighbor = Grid[NeighborX + NeighborY * CellsX];
+					if (Neighbor != INDEX_NONE && FVector2D::DistSquared(CellSamples[Neighbor], Sample + FVector2D(OffsetX, OffsetY)) < MinimumDistanceSquared)
+					{
+						bIsTooClose = true;
+						break;
 					}
 				}
 			}
+			if (bIsTooClose)
+			{
+				continue;
+			}
 
-			v2DSamples[iCell] = v2DSample;
-			v2DList->AddTail(v2DSample);
+			CellSamples[SampleNum] = Sample;
+			Grid[Cell] = SampleNum;
+			++SampleNum;
 			bIsSuccessful = true;
-
-		PoissonDisc2DCheckBreakout:;
-			//continue;
 		}
 
 		// If we weren't successful in generating any new points, remove this point from the working list.
 		if (!bIsSuccessful)
-			v2DList->RemoveNode(v2DSampleOrigin);
+		{
+			++Active;
+		}
 	}
 
-	// Fill up the output array with generated samples.
-	for (uint64 n = 0; n < iCells; ++n) {
-		if (v2DSamples[n] != NULL)
-			Samples.Add(*v2DSamples[n] + StartLocation);
+	// Fill up the output array with generated samples, in grid order.
+	Samples.Reserve(Samples.Num() + SampleNum);
+	for (int64 Cell = 0; Cell < Cells; ++Cell)
+	{
+		if (Grid[Cell] != INDEX_NONE)
+		{
+			Samples.Add(CellSamples[Grid[Cell]] + StartLocation);
+		}
 	}
 
-	// Destroy temporary arrays and lists.
-	delete v2DSamples; delete v2DList;
+	FMemory::Free(CellSamples);
+}
+
+void UPoissonDiscUtilities::DistributeTiled2D(TArray<FVector2D>& Samples, int32 Seed, FVector2D Size, FVector2D StartLocation, float MinimumDistance, int32 MaxStepSamples, int32 TileCells)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UPoissonDiscUtilities::DistributeTiled2D)
+	const double CellSize = MinimumDistance / sqrt(2.0);
+	if (CellSize <= 0.0 || Size.X <= 0.0 || Size.Y <= 0.0)
+	{
+		return;
+	}
+	const int64 CellsX = ceil(Size.X / CellSize);
+	const int64 CellsY = ceil(Size.Y / CellSize);
+	const double MinimumDistanceSquared = FMath::Square((double)MinimumDistance);
+
+	// Same-phase tiles are a whole tile apart. A tile reads up to CandidateReachCells past its border and
+	// only writes inside itself, so a tile wider than that can never touch a concurrent tile's cells.
+	TileCells = FMath::Max(TileCells, CandidateReachCells + 1);
+	const int32 TilesX = FMath::DivideAndRoundUp<int64>(CellsX, TileCells);
+	const int32 TilesY = FMath::DivideAndRoundUp<int64>(CellsY, TileCells);
+
+	// The grid holds the samples themselves, so tiles never have to share a sample list.
+	const FVector2D EmptyCell(-1.0, -1.0);
+	TArray<FVector2D> Grid;
+	Grid.Init(EmptyCell, CellsX * CellsY);
+
+	auto FillTile = [&](const int32 TileX, const int32 TileY)
+	{
+		const int64 MinX = (int64)TileX * TileCells;
+		const int64 MinY = (int64)TileY * TileCells;
+		const int64 MaxX = FMath::Min(MinX + TileCells, CellsX) - 1;
+		const int64 MaxY = FMath::Min(MinY + TileCells, CellsY) - 1;
+		FRandomStream RandomStream(HashCombine(GetTypeHash(Seed), GetTypeHash(TileY * TilesX + TileX)));
+
+		// Samples from finished tiles that are close enough to grow into this one.
+		TArray<FVector2D> Processing;
+		for (int64 CellY = FMath::Max<int64>(MinY - CandidateReachCells, 0); CellY <= FMath::Min<int64>(MaxY + CandidateReachCells, CellsY - 1); ++CellY)
+		{
+			for (int64 CellX = FMath::Max<int64>(MinX - CandidateReachCells, 0); CellX <= FMath::Min<int64>(MaxX + CandidateReachCells, CellsX - 1); ++CellX)
+			{
+				const bool bIsInside = CellX >= MinX && CellX <= MaxX && CellY >= MinY && CellY <= MaxY;
+				if (!bIsInside && Grid[CellX + CellY * CellsX].X >= 0.0)
+				{
+					Processing.Add(Grid[CellX + CellY * CellsX]);
+				}
+			}
+		}
+		if (Processing.IsEmpty())
+		{
+			const double StartX = RandomStream.FRandRange(MinX * CellSize, FMath::Min((MaxX + 1) * CellSize, Size.X));
+			const double StartY = RandomStream.FRandRange(MinY * CellSize, FMath::Min((MaxY + 1) * CellSize, Size.Y));
+			const FVector2D Start(StartX, StartY);
+			Grid[FMath::Clamp<int64>(Start.X / CellSize, MinX, MaxX) + FMath::Clamp<int64>(Start.Y / CellSize, MinY, MaxY) * CellsX] = Start;
+			Processing.Add(Start);
+		}
+
+		for (int32 Active = 0; Active < Processing.Num();)
+		{
+			const FVector2D Origin = Processing[Active];
+			bool bIsSuccessful = false;
+			for (int32 Step = 0; Step < MaxStepSamples; ++Step)
+			{
+				const double Angle = RandomStream.FRandRange(0, PI * 2.0f) + (double)Step;
+				const double Radius = RandomStream.FRandRange(1.0f, 2.0f) * (double)MinimumDistance;
+				const FVector2D Sample(Origin.X + (Radius * cos(Angle)), Origin.Y + (Radius * sin(Angle)));
+				if (Sample.X < 0 || Sample.X > Size.X || Sample.Y < 0 || Sample.Y > Size.Y)
+				{
+					continue;
+				}
+				const int64 CellX = FMath::Min((int64)(Sample.X / CellSize), CellsX - 1);
+				const int64 CellY = FMath::Min((int64)(Sample.Y / CellSize), CellsY - 1);
+				// Other tiles own everything outside, they pick up this sample's neighborhood themselves.
+				if (CellX < MinX || CellX > MaxX || CellY < MinY || CellY > MaxY)
+				{
+					continue;
+				}
+
+				bool bIsTooClose = false;
+				for (int64 NeighborY = FMath::Max<int64>(CellY - NeighborCells, 0); NeighborY <= FMath::Min<int64>(CellY + NeighborCells, CellsY - 1) && !bIsTooClose; ++NeighborY)
+				{
+					for (int64 NeighborX = FMath::Max<int64>(CellX - NeighborCells, 0); NeighborX <= FMath::Min<int64>(CellX + NeighborCells, CellsX - 1); ++NeighborX)
+					{
+						const FVector2D& Neighbor = Grid[NeighborX + NeighborY * CellsX];
+						if (Neighbor.X >= 0.0 && FVector2D::DistSquared(Neighbor, Sample) < MinimumDistanceSquared)
+						{
+							bIsTooClose = true;
+							break;
+						}
+					}
+				}
+				if (bIsTooClose)
+				{
+					continue;
+				}
+
+				Grid[CellX + CellY * CellsX] = Sample;
+				Processing.Add(Sample);
+				bIsSuccessful = true;
+			}
+			if (!bIsSuccessful)
+			{
+				++Active;
+			}
+		}
+	};
+
+	// Tiles of one phase are independent, the phases themselves run in a fixed order.
+	for (int32 Phase = 0; Phase < 4; ++Phase)
+	{
+		const int32 PhaseTilesX = (TilesX - (Phase & 1) + 1) / 2;
+		const int32 PhaseTilesY = (TilesY - (Phase >> 1) + 1) / 2;
+		ParallelFor(PhaseTilesX * PhaseTilesY, [&](const int32 Index)
+		{
+			FillTile((Index % PhaseTilesX) * 2 + (Phase & 1), (Index / PhaseTilesX) * 2 + (Phase >> 1));
+		});
+	}
+
+	// Fill up the output array with generated samples, in grid order.
+	for (const FVector2D& Cell : Grid)
+	{
+		if (Cell.X >= 0.0)
+		{
+			Samples.Add(Cell + StartLocation);
+		}
+	}
 }
 
 void UPoissonDiscUtilities::Distribute3D(TArray<FVector>& Samples, int32 Seed /* = 0 */, FVector Size /* = FVector2D(1.0f , 1.0f) */, float MinimumDistance /* = 1.0f */, int32 MaxStepSamples /* = 30 */, bool WrapX /* = false */, bool WrapY /* = false */, bool WrapZ /* = false */)
@@ -0,0 +1,142 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "RegionGrid.h"
+
+namespace
+{
+	/** Upper bound of cells along one axis, keeps the grid small for degenerate point sets. */
+	constexpr int32 MaxCellsPerAxis = 1024;
+	/** Average number of points per cell. */
+	constexpr double PointsPerCell = 2.;
+}
+
+void FRegionGrid::Build(const TArray<FVector2D>& Points)
+{
+	BuildFrom(Points);
+}
+
+void FRegionGrid::Build(const TArray<FVector2f>& Points)
+{
+	BuildFrom(Points);
+}
+
+template <typename PointType>
+void FRegionGrid::BuildFrom(const TArray<PointType>& Points)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRegionGrid::Build)
+	Reset();
+	const int32 PointNum = Points.Num();
+	if (PointNum == 0)
+	{
+		return;
+	}
+
+	FBox2D Bounds(ForceInit);
+	for (const PointType& Point : Points)
+	{
+		Bounds += FVector2D(Point);
+	}
+	const FVector2D Extent = Bounds.GetSize();
+	CellSize = FMath::Max3(FMath::Sqrt(Extent.X * Extent.Y * PointsPerCell / PointNum),
+	                       Extent.GetMax() / MaxCellsPerAxis, UE_KINDA_SMALL_NUMBER);
+	Origin = Bounds.Min;
+	CellCount.X = FMath::FloorToInt32(Extent.X / CellSize) + 1;
+	CellCount.Y = FMath::FloorToInt32(Extent.Y / CellSize) + 1;
+	const int32 CellNum = CellCount.X * CellCount.Y;
+
+	TArray<int32> PointCells;
+	PointCells.SetNumUninitialized(PointNum);
+	CellOffsets.SetNumZeroed(CellNum + 1);
+	for (int32 Index = 0; Index < PointNum; ++Index)
+	{
+		const FIntPoint Cell = ClampedCellOf(FVector2D(Points[Index]));
+		PointCells[Index] = CellIndex(Cell.X, Cell.Y);
+		++CellOffsets[PointCells[Index] + 1];
+	}
+	for (int32 Cell = 0; Cell < CellNum; ++Cell)
+	{
+		CellOffsets[Cell + 1] += CellOffsets[Cell];
+	}
+	CellPoints.SetNumUninitialized(PointNum);
+	TArray<int32> Cursor(CellOffsets.GetData(), CellNum);
+	for (int32 Index = 0; Index < PointNum; ++Index)
+	{
+		CellPoints[Cursor[PointCells[Index]]++] = Index;
+	}
+}
+
+void FRegionGrid::Reset()
+{
+	CellCount = FIntPoint::ZeroValue;
+	CellOffsets.Reset();
+	CellPoints.Reset();
+}
+
+int32 FRegionGrid::FindClosest(const TArray<FVector2D>& Points, const FVector2D& Point) const
+{
+	return FindClosestIn(Points, Point);
+}
+
+int32 FRegionGrid::FindClosest(const TArray<FVector2f>& Points, const FVector2D& Point) const
+{
+	return FindClosestIn(Points, Point);
+}
+
+template <typename PointType>
+int32 FRegionGrid::FindClosestIn(const TArray<PointType>& Points, const FVector2D& Point) const
+{
+	if (IsEmpty())
+	{
+		return INDEX_NONE;
+	}
+	const FIntPoint Center = ClampedCellOf(Point);
+	int32 Closest = INDEX_NONE;
+	double ClosestDistSquared = DBL_MAX;
+	auto VisitCell = [&](const int32 CellX, const int32 CellY)
+	{
+		const int32 Cell = CellIndex(CellX, CellY);
+		for (int32 Offset = CellOffsets[Cell]; Offset < CellOffsets[Cell + 1]; ++Offset)
+		{
+			const int32 Index = CellPoints[Offset];
+			const double DistSquared = FVector2D::DistSquared(FVector2D(Points[Index]), Point);
+			if (DistSquared < ClosestDistSquared || (DistSquared == ClosestDistSquared && Index < Closest))
+			{
+				ClosestDistSquared = DistSquared;
+				Closest = Index;
+			}
+		}
+	};
+
+	const int32 MaxRing = FMath::Max(CellCount.X, CellCount.Y);
+	for (int32 Ring = 0; Ring <= MaxRing; ++Ring)
+	{
+		// Every cell of this ring is at least (Ring - 1) cells away, also for points clamped onto the grid.
+		// Equal distances keep searching so ties resolve to the lowest index like the linear scan.
+		if (Closest != INDEX_NONE && FMath::Square(FMath::Max(Ring - 1, 0) * CellSize) > ClosestDistSquared)
+		{
+			break;
+		}
+		const int32 MinX = Center.X - Ring;
+		const int32 MaxX = Center.X + Ring;
+		for (int32 CellY = FMath::Max(Center.Y - Ring, 0); CellY <= FMath::Min(Center.Y + Ring, CellCount.Y - 1); ++CellY)
+		{
+			if (CellY == Center.Y - Ring || CellY == Center.Y + Ring)
+			{
+				for (int32 CellX = FMath::Max(MinX, 0); CellX <= FMath::Min(MaxX, CellCount.X - 1); ++CellX)
+				{
+					VisitCell(CellX, CellY);
+				}
+				continue;
+			}
+			if (MinX >= 0)
+			{
+				VisitCell(MinX, CellY);
+			}
+			if (MaxX < CellCount.X && MaxX != MinX)
+			{
+				VisitCell(MaxX, CellY);
+			}
+		}
+	}
+	return Closest;
+}
@@ -0,0 +1,162 @@
+// Copyright 2018 Schemepunk Studios
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "Delaunator/Public/DelaunayHelper.h"
+
+#include "RandomSampling/PoissonDiscUtilities.h"
+#include "Tests/BenchmarkReport.h"
+#include "TriangleDualMesh.h"
+
+/**
+ * Times the DualMesh primitives at one of the point counts returned by GetTests and writes them to
+ * Saved/Benchmarks/DualMesh_<Size>.json. Inputs come from fixed seeds, so reports of two commits on the same machine
+ * can be compared entry by entry.
+ */
+IMPLEMENT_COMPLEX_AUTOMATION_TEST(FDualMeshBenchmark, "Procedural Generation.DualMesh.Benchmark", EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter | EAutomationTestFlags::LowPriority)
+
+namespace DualMeshBenchmark
+{
+	constexpr int32 QueryNum = 100000;
+	const FVector2D MapSize(10000.0, 10000.0);
+	// Poisson disc sampling covers about this much of the area with points per squared spacing
+	constexpr double PoissonDensity = 0.7;
+
+	template <typename IndexType>
+	int64 CirculateAll(const UTriangleDualMesh* Mesh,
+	                   TArray<IndexType> (UTriangleDualMesh::*Circulate)(FPointIndex) const)
+	{
+		int64 sum = 0;
+		for (FPointIndex r = 0; r < Mesh->NumRegions; r++)
+		{
+			sum += (Mesh->*Circulate)(r).Num();
+		}
+		return sum;
+	}
+
+	template <typename IndexType>
+	int64 VisitAll(const UTriangleDualMesh* Mesh,
+	               void (UTriangleDualMesh::*Circulate)(FPointIndex, TFunctionRef<void(IndexType)>) const)
+	{
+		int64 sum = 0;
+		for (FPointIndex r = 0; r < Mesh->NumRegions; r++)
+		{
+			(Mesh->*Circulate)(r, [&sum](IndexType) { sum++; });
+		}
+		return sum;
+	}
+}
+
+void FDualMeshBenchmark::GetTests(TArray<FString>& OutBeautifiedNames, TArray<FString>& OutTestCommands) const
+{
+	const TCHAR* sizes[] = { TEXT("1k"), TEXT("10k"), TEXT("100k"), TEXT("1M") };
+	for (const TCHAR* size : sizes)
+	{
+		OutBeautifiedNames.Add(size);
+		OutTestCommands.Add(size);
+	}
+}
+
+bool FDualMeshBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace DualMeshBenchmark;
+	using BenchmarkReport::Measure;
+	const int32 targetNum = Parameters == TEXT("1M") ? 1000000
+		: Parameters == TEXT("100k") ? 100000 : Parameters == TEXT("10k") ? 10000 : 1000;
+	const float minimumDistance = FMath::Sqrt(PoissonDensity * MapSize.X * MapSize.Y / targetNum);
+	TArray<TSharedPtr<FJsonValue>> results;
+
+	TArray<FVector2D> points;
+	results.Add(MakeShared<FJsonValueObject>(Measure(TEXT("Distribute2D"), targetNum, [&points, minimumDistance]
+	{
+		UPoissonDiscUtilities::Distribute2D(points, 0, MapSize, FVector2D::ZeroVector, minimumDistance);
+		return points.Num();
+	})));
+
+	results.Add(MakeShared<FJsonValueObject>(Measure(TEXT("CreatePoints"), points.Num(), [&points]
+	{
+		FDelaunayMesh delaunay;
+		delaunay.CreatePoints(points);
+		return delaunay.DelaunayTriangles.Num();
+	})));
+	results.Add(MakeShared<FJsonValueObject>(Measure(TEXT("CreatePointsDivideAndConquer"), points.Num(), [&points]
+	{
+		FDelaunayMesh delaunay;
+		delaunay.CreatePoints(points, EDelaunayTriangulator::DT_DivideAndConquer);
+		return delaunay.DelaunayTriangles.Num();
+	})));
+
+	const FDualMesh dualMesh(points, MapSize);
+	UTriangleDualMesh* mesh = NewObject<UTriangleDualMesh>();
+	results.Add(MakeShared<FJsonValueObject>(Measure(TEXT("InitializeMesh"), points.Num(), [&dualMesh, mesh]
+	{
+		mesh->InitializeMesh(dualMesh, 0);
+		return mesh->NumSides;
+	})));
+	if (mesh->NumRegions == 0)
+	{
+		AddError(TEXT("The benchmark mesh has no regions."));
+		return false;
+	}
+
+	// Once over the half-edges and once over the flattened adjacency tables
+	for (const bool bAdjacency : {false, true})
+	{
+		if (bAdjacency)
+		{
+			mesh->BuildAdjacency();
+		}
+		const FString suffix = bAdjacency ? TEXT("Adjacency") : TEXT("");
+		const int32 regionNum = mesh->NumRegions;
+		results.Add(MakeShared<FJsonValueObject>(Measure(*(TEXT("r_circulate_s") + suffix), regionNum, [mesh]
+		{
+			return CirculateAll<FSideIndex>(mesh, &UTriangleDualMesh::r_circulate_s);
+		})));
+		results.Add(MakeShared<FJsonValueObject>(Measure(*(TEXT("r_circulate_r") + suffix), regionNum, [mesh]
+		{
+			return CirculateAll<FPointIndex>(mesh, &UTriangleDualMesh::r_circulate_r);
+		})));
+		results.Add(MakeShared<FJsonValueObject>(Measure(*(TEXT("r_circulate_t") + suffix), regionNum, [mesh]
+		{
+			return CirculateAll<FTriangleIndex>(mesh, &UTriangleDualMesh::r_circulate_t);
+		})));
+		results.Add(MakeShared<FJsonValueObject>(Measure(*(TEXT("r_visit_s") + suffix), regionNum, [mesh]
+		{
+			return VisitAll<FSideIndex>(mesh, &UTriangleDualMesh::r_circulate_s);
+		})));
+		results.Add(MakeShared<FJsonValueObject>(Measure(*(TEXT("r_visit_r") + suffix), regionNum, [mesh]
+		{
+			return VisitAll<FPointIndex>(mesh, &UTriangleDualMesh::r_circulate_r);
+		})));
+		results.Add(MakeShared<FJsonValueObject>(Measure(*(TEXT("r_visit_t") + suffix), regionNum, [mesh]
+		{
+			return VisitAll<FTriangleIndex>(mesh, &UTriangleDualMesh::r_circulate_t);
+		})));
+	}
+
+	FRandomStream rng(0);
+	TArray<FVector2D> queries;
+	queries.SetNumUninitialized(QueryNum);
+	for (FVector2D& query : queries)
+	{
+		query = FVector2D(rng.FRandRange(0.0, MapSize.X), rng.FRandRange(0.0, MapSize.Y));
+	}
+	// The first query builds the region grid, which should not count towards the queries
+	mesh->ClosestRegion(queries[0]);
+	results.Add(MakeShared<FJsonValueObject>(Measure(TEXT("ClosestRegion"), QueryNum, [mesh, &queries]
+	{
+		int64 sum = 0;
+		for (const FVector2D& query : queries)
+		{
+			sum += static_cast<int64>(mesh->ClosestRegion(query).Value);
+		}
+		return sum;
+	})));
+
+	const TSharedRef<FJsonObject> report = BenchmarkReport::Create(TEXT("DualMesh"), Parameters);
+	report->SetNumberField(TEXT("regions"), mesh->NumRegions);
+	report->SetArrayField(TEXT("results"), results);
+	return BenchmarkReport::Save(*this, report);
+}
@@ -1,3 +1,4 @@
 // Copyright 2018 Schemepunk Studios
 
 #include "DualMeshTests.h"
+#include "DualMeshBenchmarks.h"
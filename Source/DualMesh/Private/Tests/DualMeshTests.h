@@ -38,6 +38,10 @@ IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPoissonSamplingTest, "Procedural Generation.Po
 IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPointInequalityTest, "Procedural Generation.DualMesh.Check Point Inequality", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter | EAutomationTestFlags::LowPriority)
 IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTriangleInequalityTest, "Procedural Generation.DualMesh.Check Triangle Inequality", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter | EAutomationTestFlags::MediumPriority)
 IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMeshConnectivityTest, "Procedural Generation.DualMesh.Check Region Circulation", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter | EAutomationTestFlags::MediumPriority)
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMeshAdjacencyTest, "Procedural Generation.DualMesh.Check Region Adjacency", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter | EAutomationTestFlags::MediumPriority)
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMeshLocalEditTest, "Procedural Generation.DualMesh.Check Local Edits", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter | EAutomationTestFlags::MediumPriority)
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FDivideAndConquerTest, "Procedural Generation.DualMesh.Check Divide and Conquer Triangulation", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter | EAutomationTestFlags::MediumPriority)
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FGridMeshTest, "Procedural Generation.DualMesh.Check Grid Meshes", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter | EAutomationTestFlags::MediumPriority)
 
 IMPLEMENT_SIMPLE_AUTOMATION_TEST(FConstructDualMeshTest, "Procedural Generation.DualMesh.Construct Dual Mesh", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter | EAutomationTestFlags::HighPriority)
 
@@ -288,6 +292,297 @@ bool FMeshConnectivityTest::RunTest(const FString& Parameters)
 	return true;
 }
 
+bool FMeshAdjacencyTest::RunTest(const FString& Parameters)
+{
+	UTriangleDualMesh* mesh = GenerateMeshBuilder();
+	if (mesh == NULL)
+	{
+		return false;
+	}
+
+	TArray<TArray<FPointIndex>> circulated_r;
+	TArray<TArray<FTriangleIndex>> circulated_t;
+	for (FPointIndex r = 0; r < mesh->NumRegions; r++)
+	{
+		circulated_r.Add(mesh->r_circulate_r(r));
+		circulated_t.Add(mesh->r_circulate_t(r));
+	}
+
+	mesh->BuildAdjacency();
+	if (!mesh->HasAdjacency())
+	{
+		UE_LOG(LogDualMesh, Error, TEXT("Adjacency tables were not built!"));
+		return false;
+	}
+	for (FPointIndex r = 0; r < mesh->NumRegions; r++)
+	{
+		if (mesh->r_circulate_r(r) != circulated_r[r] || mesh->r_circulate_t(r) != circulated_t[r])
+		{
+			UE_LOG(LogDualMesh, Error, TEXT("Adjacency of region %d differs from its half-edge circulation!"),
+			       static_cast<int32>(r));
+			return false;
+		}
+	}
+	return true;
+}
+
+bool FMeshLocalEditTest::RunTest(const FString& Parameters)
+{
+	UTriangleDualMesh* mesh = GenerateMeshBuilder();
+	if (mesh == NULL)
+	{
+		return false;
+	}
+	mesh->BuildAdjacency();
+
+	// Corners and opposite sides, a failed edit has to leave both as they were
+	auto snapshotSides = [mesh](TArray<FPointIndex>& OutBegin, TArray<FSideIndex>& OutOpposite)
+	{
+		OutBegin.Reset();
+		OutOpposite.Reset();
+		for (FSideIndex s = 0; s < mesh->NumSides; s++)
+		{
+			OutBegin.Add(mesh->s_begin_r(s));
+			OutOpposite.Add(mesh->s_opposite_s(s));
+		}
+	};
+	TArray<FPointIndex> beginBefore;
+	TArray<FSideIndex> oppositeBefore;
+	TArray<FPointIndex> beginAfter;
+	TArray<FSideIndex> oppositeAfter;
+
+	FRandomStream rng(0);
+	FDualMeshEdit edit;
+	int32 moved = 0;
+	for (int32 i = 0; i < 50; i++)
+	{
+		const FPointIndex r = rng.RandRange(mesh->NumBoundaryRegions, mesh->NumSolidRegions - 1);
+		const FVector2D position = mesh->r_pos(r) + FVector2D(rng.FRandRange(-5.0f, 5.0f), rng.FRandRange(-5.0f, 5.0f));
+		const FVector2D oldPosition = mesh->r_pos(r);
+		snapshotSides(beginBefore, oppositeBefore);
+		edit.Reset();
+		const bool bMoved = mesh->MoveRegion(r, position, edit);
+		snapshotSides(beginAfter, oppositeAfter);
+		if (!bMoved)
+		{
+			if (mesh->r_pos(r) != oldPosition || beginAfter != beginBefore || oppositeAfter != oppositeBefore
+				|| !edit.DirtyRegions.IsEmpty() || !edit.DirtyTriangles.IsEmpty())
+			{
+				UE_LOG(LogDualMesh, Error, TEXT("Failed move of region %d changed the mesh!"), static_cast<int32>(r));
+				return false;
+			}
+			continue;
+		}
+		if (mesh->r_pos(r) != position)
+		{
+			UE_LOG(LogDualMesh, Error, TEXT("Region %d was not moved!"), static_cast<int32>(r));
+			return false;
+		}
+		moved++;
+		if (!edit.DirtyRegions.Contains(r) || edit.DirtyTriangles.IsEmpty())
+		{
+			UE_LOG(LogDualMesh, Error, TEXT("Move of region %d was not reported as dirty!"), static_cast<int32>(r));
+			return false;
+		}
+		// Every triangle whose corners changed has to be reported, and so do its corners
+		for (FTriangleIndex t = 0; t < mesh->NumSolidTriangles; t++)
+		{
+			bool bChanged = false;
+			for (int32 k = 0; k < 3; k++)
+			{
+				bChanged |= beginAfter[3 * t + k] != beginBefore[3 * t + k];
+			}
+			if (bChanged && !edit.DirtyTriangles.Contains(t))
+			{
+				UE_LOG(LogDualMesh, Error, TEXT("Triangle %d changed but is not dirty!"), static_cast<int32>(t));
+				return false;
+			}
+		}
+		for (const FTriangleIndex t : edit.DirtyTriangles)
+		{
+			for (const FPointIndex corner : mesh->t_circulate_r(t))
+			{
+				if (!edit.DirtyRegions.Contains(corner))
+				{
+					UE_LOG(LogDualMesh, Error, TEXT("Corner %d of dirty triangle %d is not dirty!"),
+					       static_cast<int32>(corner), static_cast<int32>(t));
+					return false;
+				}
+			}
+		}
+	}
+	if (moved == 0)
+	{
+		UE_LOG(LogDualMesh, Error, TEXT("No region could be moved!"));
+		return false;
+	}
+
+	// Onto another region is rejected before anything is touched
+	const FPointIndex blocked = mesh->NumBoundaryRegions;
+	const FPointIndex neighbor = mesh->r_circulate_r(blocked)[0];
+	snapshotSides(beginBefore, oppositeBefore);
+	edit.Reset();
+	const bool bBlockedMoved = mesh->MoveRegion(blocked, mesh->r_pos(neighbor), edit);
+	snapshotSides(beginAfter, oppositeAfter);
+	if (bBlockedMoved || beginAfter != beginBefore || oppositeAfter != oppositeBefore || !edit.DirtyTriangles.IsEmpty())
+	{
+		UE_LOG(LogDualMesh, Error, TEXT("Region %d was moved onto region %d!"), static_cast<int32>(blocked),
+		       static_cast<int32>(neighbor));
+		return false;
+	}
+	edit.Reset();
+	const int32 numRegions = mesh->NumSolidRegions;
+	const FPointIndex added = mesh->AddRegion(FVector2D(500.5f, 500.5f), edit);
+	if (!added.IsValid() || mesh->NumSolidRegions != numRegions + 1 || !edit.DirtyRegions.Contains(added))
+	{
+		UE_LOG(LogDualMesh, Error, TEXT("Region was not added!"));
+		return false;
+	}
+	// Regions on the hull cannot be removed, take the first one inside
+	FPointIndex removed = mesh->NumBoundaryRegions;
+	while (!mesh->RemoveRegion(removed, edit) && removed < static_cast<SIZE_T>(mesh->NumSolidRegions - 1))
+	{
+		removed++;
+	}
+	if (mesh->NumSolidRegions != numRegions)
+	{
+		UE_LOG(LogDualMesh, Error, TEXT("Region was not removed!"));
+		return false;
+	}
+
+	// The edited mesh has to be closed, consistent and Delaunay
+	for (FSideIndex s = 0; s < mesh->NumSides; s++)
+	{
+		const FSideIndex opposite = mesh->s_opposite_s(s);
+		if (mesh->s_opposite_s(opposite) != s || mesh->s_begin_r(opposite) != mesh->s_end_r(s))
+		{
+			UE_LOG(LogDualMesh, Error, TEXT("Side %d does not match its opposite side!"), static_cast<int32>(s));
+			return false;
+		}
+		if (mesh->s_ghost(s) || mesh->s_ghost(opposite))
+		{
+			continue;
+		}
+		const FDelaunayTriangle triangle = mesh->t_triangle(mesh->s_inner_t(s));
+		const FVector2D outer = mesh->r_pos(mesh->s_begin_r(UTriangleDualMesh::s_prev_s(opposite)));
+		const FVector2D center = triangle.GetCircumcenter();
+		if (FVector2D::Distance(center, outer) < FVector2D::Distance(center, triangle.A) * (1.0 - 1e-6))
+		{
+			UE_LOG(LogDualMesh, Error, TEXT("Side %d is not Delaunay!"), static_cast<int32>(s));
+			return false;
+		}
+	}
+	TArray<TArray<FPointIndex>> circulated_r;
+	for (FPointIndex r = 0; r < mesh->NumRegions; r++)
+	{
+		circulated_r.Add(mesh->r_circulate_r(r));
+	}
+	mesh->ResetAdjacency();
+	for (FPointIndex r = 0; r < mesh->NumRegions; r++)
+	{
+		if (mesh->r_circulate_r(r) != circulated_r[r])
+		{
+			UE_LOG(LogDualMesh, Error, TEXT("Adjacency of region %d was not updated!"), static_cast<int32>(r));
+			return false;
+		}
+	}
+	return true;
+}
+
+bool FDivideAndConquerTest::RunTest(const FString& Parameters)
+{
+	// Enough points for several strips, so the parallel merges run as well
+	TArray<FVector2D> points;
+	UPoissonDiscUtilities::Distribute2D(points, 0, FVector2D(1000.0f, 1000.0f), FVector2D::ZeroVector, 4.0f, 30);
+	const FDelaunayMesh reference = FDelaunayMesh(points);
+	const FDelaunayMesh graph = FDelaunayMesh(points, EDelaunayTriangulator::DT_DivideAndConquer);
+
+	// Points in general position have a single Delaunay triangulation
+	if (!TestEqual(TEXT("Triangles"), graph.DelaunayTriangles.Num(), reference.DelaunayTriangles.Num()))
+	{
+		return false;
+	}
+	for (FSideIndex s = 0; s < graph.HalfEdges.Num(); s++)
+	{
+		const FSideIndex opposite = graph.HalfEdges[s];
+		if (!opposite.IsValid())
+		{
+			if (graph.HullTriangles[graph.DelaunayTriangles[s]].Value != s.Value)
+			{
+				AddError(FString::Printf(TEXT("Hull side %d is not in the hull."), static_cast<int32>(s)));
+				return false;
+			}
+			continue;
+		}
+		if (graph.HalfEdges[opposite] != s
+			|| graph.DelaunayTriangles[opposite] != graph.DelaunayTriangles[UDelaunayHelper::NextHalfEdge(s)])
+		{
+			AddError(FString::Printf(TEXT("Side %d has no matching opposite side."), static_cast<int32>(s)));
+			return false;
+		}
+		// Locally Delaunay everywhere means Delaunay: the far corner across every side is outside the circumcircle
+		const FDelaunayTriangle triangle = UDelaunayHelper::GetTriangleFromHalfEdge(graph, s);
+		const FVector2D farCorner = graph.Coordinates[graph.DelaunayTriangles[UDelaunayHelper::PreviousHalfEdge(opposite)]];
+		const FVector2D center = triangle.GetCircumcenter();
+		if (FVector2D::Distance(center, farCorner) < FVector2D::Distance(center, triangle.A) - 0.01)
+		{
+			AddError(FString::Printf(TEXT("Side %d is not Delaunay."), static_cast<int32>(s)));
+			return false;
+		}
+	}
+	return true;
+}
+
+bool FGridMeshTest::RunTest(const FString& Parameters)
+{
+	for (const bool bHexagonal : {false, true})
+	{
+		const int32 columns = 23;
+		const int32 rows = 17;
+		const FVector2D size = bHexagonal ? FVector2D(columns - 0.5, (rows - 1) * 0.8660254) * 10.0 : FVector2D(1000.0, 700.0);
+		UDualMeshBuilder* builder = NewObject<UDualMeshBuilder>();
+		builder->Initialize(size);
+		UTriangleDualMesh* mesh = builder->CreateGrid(columns, rows, bHexagonal);
+		if (!TestEqual(TEXT("Grid regions"), mesh->NumSolidRegions, columns * rows)
+			|| !TestEqual(TEXT("Grid boundary regions"), mesh->NumBoundaryRegions, FDualMesh::GridBoundaryRegionNum(columns, rows)))
+		{
+			return false;
+		}
+		for (FSideIndex s = 0; s < mesh->NumSides; s++)
+		{
+			const FSideIndex opposite = mesh->s_opposite_s(s);
+			if (!opposite.IsValid() || mesh->s_opposite_s(opposite) != s || mesh->s_begin_r(opposite) != mesh->s_end_r(s))
+			{
+				AddError(FString::Printf(TEXT("Side %d of the %s grid has no matching opposite side."), static_cast<int32>(s),
+				                         bHexagonal ? TEXT("hex") : TEXT("square")));
+				return false;
+			}
+			// Only the outer ring touches the ghost region
+			if (mesh->s_ghost(s) && !mesh->r_ghost(mesh->s_begin_r(s)) && !mesh->r_boundary(mesh->s_begin_r(s)))
+			{
+				AddError(FString::Printf(TEXT("Region %d is on the hull but not a boundary region."),
+				                         static_cast<int32>(mesh->s_begin_r(s))));
+				return false;
+			}
+		}
+		// Every solid triangle turns the same way as the ones of Delaunator
+		for (FTriangleIndex t = 0; t < mesh->NumSolidTriangles; t++)
+		{
+			const TStaticArray<FSideIndex, 3> sides = mesh->t_circulate_s(t);
+			const FVector2D a = mesh->r_pos(mesh->s_begin_r(sides[0]));
+			const FVector2D b = mesh->r_pos(mesh->s_begin_r(sides[1]));
+			const FVector2D c = mesh->r_pos(mesh->s_begin_r(sides[2]));
+			if (FVector2D::CrossProduct(b - a, c - a) >= 0.0)
+			{
+				AddError(FString::Printf(TEXT("Triangle %d of the %s grid is flipped."), static_cast<int32>(t),
+				                         bHexagonal ? TEXT("hex") : TEXT("square")));
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
 bool FConstructDualMeshTest::RunTest(const FString& Parameters)
 {
 	UTriangleDualMesh* mesh = GenerateMeshBuilder();
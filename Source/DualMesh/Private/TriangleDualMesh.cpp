@@ -20,13 +20,42 @@
 
 #include "TriangleDualMesh.h"
 #include "DrawDebugHelpers.h"
+#include "Components/LineBatchComponent.h"
+#include "Engine/World.h"
+#include "Runtime/Launch/Resources/Version.h"
+#include "Algo/Sort.h"
+#include "Algo/Unique.h"
+#include "Async/ParallelFor.h"
 #include "DualMesh.h"
+#include "DualMeshArchive.h"
 #include "GameFramework/Actor.h"
 
-FDualMesh::FDualMesh(const TArray<FVector2D>& GivenPoints, const FVector2D& MaxMapSize)
-	: FDelaunayMesh(GivenPoints)
+namespace
+{
+	// Debug lines go to the persistent batcher in one call, one DrawDebugLine per edge floods it on large meshes
+	ULineBatchComponent* GetPersistentLineBatcher(const UWorld* World)
+	{
+		if (World == nullptr)
+		{
+			return nullptr;
+		}
+#if ENGINE_MAJOR_VERSION > 5 || ENGINE_MINOR_VERSION >= 5
+		return World->GetLineBatcher(UWorld::ELineBatcherType::WorldPersistent);
+#else
+		return World->PersistentLineBatcher;
+#endif
+	}
+}
+
+FDualMesh::FDualMesh(const TArray<FVector2D>& GivenPoints, const FVector2D& MaxMapSize, bool bSortTriangles,
+                     EDelaunayTriangulator Triangulator)
+	: FDelaunayMesh(GivenPoints, Triangulator)
 {
 	MaxSize = MaxMapSize;
+	if (bSortTriangles)
+	{
+		SortTrianglesSpatially();
+	}
 	NumSolidSides = DelaunayTriangles.Num();
 	AddGhostStructure();
 
@@ -34,6 +63,231 @@ FDualMesh::FDualMesh(const TArray<FVector2D>& GivenPoints, const FVector2D& MaxM
 	       MaxSize.X, MaxSize.Y);
 }
 
+FDualMesh::FDualMesh(int32 Columns, int32 Rows, const FVector2D& MaxMapSize, bool bHexagonal, bool bSortTriangles)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FDualMesh::Grid)
+	HullStart = -1;
+	MaxSize = MaxMapSize;
+	Columns = FMath::Max(Columns, 2);
+	Rows = FMath::Max(Rows, 2);
+
+	// The ring goes first: the bottom row, the top row, then the left and right ends of the rows in between
+	const int32 ringNum = GridBoundaryRegionNum(Columns, Rows);
+	auto region = [Columns, Rows, ringNum](const int32 x, const int32 y) -> FPointIndex
+	{
+		if (y == 0)
+		{
+			return x;
+		}
+		if (y == Rows - 1)
+		{
+			return Columns + x;
+		}
+		if (x == 0 || x == Columns - 1)
+		{
+			return 2 * Columns + 2 * (y - 1) + (x == 0 ? 0 : 1);
+		}
+		return ringNum + (y - 1) * (Columns - 2) + x - 1;
+	};
+
+	// Odd rows of a hexagonal grid are shifted by half a column and end on the right edge of the map
+	const double dx = MaxSize.X / (bHexagonal ? Columns - 0.5 : Columns - 1.0);
+	const double dy = MaxSize.Y / (Rows - 1.0);
+	Coordinates.SetNumUninitialized(Columns * Rows);
+	ParallelFor(Rows, [this, &region, Columns, bHexagonal, dx, dy](const int32 y)
+	{
+		const double shift = bHexagonal && (y & 1) ? 0.5 : 0.0;
+		for (int32 x = 0; x < Columns; x++)
+		{
+			Coordinates[region(x, y)] = FVector2D((x + shift) * dx, y * dy);
+		}
+	});
+
+	// Two triangles per cell or per step along a row, all turning the same way as the ones of Delaunator.
+	// Hexagonal grids get one more triangle in every notch the shifted rows leave on the left and right edge.
+	const int32 stripNum = 2 * (Columns - 1);
+	const int32 leftNotchNum = bHexagonal ? (Rows - 1) / 2 : 0;
+	const int32 rightNotchNum = bHexagonal ? (Rows - 2) / 2 : 0;
+	const int32 stripsEnd = 3 * stripNum * (Rows - 1);
+	DelaunayTriangles.SetNumUninitialized(stripsEnd + 3 * (leftNotchNum + rightNotchNum));
+	auto setTriangle = [this](const int32 s, const FPointIndex a, const FPointIndex b, const FPointIndex c)
+	{
+		DelaunayTriangles[s] = a;
+		DelaunayTriangles[s + 1] = b;
+		DelaunayTriangles[s + 2] = c;
+	};
+	ParallelFor(Rows - 1, [&region, &setTriangle, Columns, bHexagonal, stripNum](const int32 y)
+	{
+		for (int32 x = 0; x < Columns - 1; x++)
+		{
+			const int32 s = 3 * (y * stripNum + 2 * x);
+			if (!bHexagonal)
+			{
+				setTriangle(s, region(x, y), region(x, y + 1), region(x + 1, y));
+				setTriangle(s + 3, region(x + 1, y), region(x, y + 1), region(x + 1, y + 1));
+			}
+			else if ((y & 1) == 0)
+			{
+				setTriangle(s, region(x, y), region(x, y + 1), region(x + 1, y));
+				setTriangle(s + 3, region(x + 1, y), region(x, y + 1), region(x + 1, y + 1));
+			}
+			else
+			{
+				setTriangle(s, region(x, y), region(x, y + 1), region(x + 1, y + 1));
+				setTriangle(s + 3, region(x, y), region(x + 1, y + 1), region(x + 1, y));
+			}
+		}
+	});
+	for (int32 i = 0; i < leftNotchNum; i++)
+	{
+		const int32 y = 2 * i + 1;
+		setTriangle(stripsEnd + 3 * i, region(0, y - 1), region(0, y + 1), region(0, y));
+	}
+	for (int32 i = 0; i < rightNotchNum; i++)
+	{
+		const int32 y = 2 * i + 2;
+		setTriangle(stripsEnd + 3 * (leftNotchNum + i), region(Columns - 1, y - 1), region(Columns - 1, y),
+		            region(Columns - 1, y + 1));
+	}
+
+	LinkHalfEdges();
+	if (bSortTriangles)
+	{
+		SortTrianglesSpatially();
+	}
+	NumSolidSides = DelaunayTriangles.Num();
+	AddGhostStructure();
+
+	UE_LOG(LogDualMesh, Log, TEXT("Final %s grid dual mesh had %d solid sides and a map size of %f, %f."),
+	       bHexagonal ? TEXT("hexagonal") : TEXT("square"), NumSolidSides, MaxSize.X, MaxSize.Y);
+}
+
+int32 FDualMesh::GridBoundaryRegionNum(int32 Columns, int32 Rows)
+{
+	Columns = FMath::Max(Columns, 2);
+	Rows = FMath::Max(Rows, 2);
+	return 2 * Columns + 2 * (Rows - 2);
+}
+
+void FDualMesh::LinkHalfEdges()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FDualMesh::LinkHalfEdges)
+	// Sides leaving each region, in compressed rows
+	const int32 numRegions = Coordinates.Num();
+	const int32 numSides = DelaunayTriangles.Num();
+	TArray<int32> offsets;
+	offsets.SetNumZeroed(numRegions + 1);
+	for (int32 s = 0; s < numSides; s++)
+	{
+		offsets[DelaunayTriangles[s] + 1]++;
+	}
+	for (int32 r = 0; r < numRegions; r++)
+	{
+		offsets[r + 1] += offsets[r];
+	}
+	TArray<int32> cursor(offsets.GetData(), numRegions);
+	TArray<int32> outgoing;
+	outgoing.SetNumUninitialized(numSides);
+	for (int32 s = 0; s < numSides; s++)
+	{
+		outgoing[cursor[DelaunayTriangles[s]]++] = s;
+	}
+
+	HalfEdges.SetNumUninitialized(numSides);
+	ParallelFor(numSides, [this, &offsets, &outgoing](const int32 s)
+	{
+		const FPointIndex begin = DelaunayTriangles[s];
+		const FPointIndex end = DelaunayTriangles[UTriangleDualMesh::s_next_s(s)];
+		HalfEdges[s] = FSideIndex();
+		for (int32 i = offsets[end]; i < offsets[end + 1]; i++)
+		{
+			if (DelaunayTriangles[UTriangleDualMesh::s_next_s(outgoing[i])] == begin)
+			{
+				HalfEdges[s] = outgoing[i];
+				break;
+			}
+		}
+	});
+}
+
+uint32 FDualMesh::HilbertIndex(const FVector2D& Point, const FVector2D& MaxMapSize)
+{
+	// 16 bits per axis, so the whole curve fits into 32 bits
+	constexpr uint32 n = 1u << 16;
+	const FVector2D size = FVector2D::Max(MaxMapSize, FVector2D(UE_KINDA_SMALL_NUMBER));
+	uint32 x = static_cast<uint32>(FMath::Clamp(Point.X / size.X * n, 0.0, n - 1.0));
+	uint32 y = static_cast<uint32>(FMath::Clamp(Point.Y / size.Y * n, 0.0, n - 1.0));
+	uint32 d = 0;
+	for (uint32 s = n / 2; s > 0; s /= 2)
+	{
+		const uint32 rx = (x & s) > 0 ? 1 : 0;
+		const uint32 ry = (y & s) > 0 ? 1 : 0;
+		d += s * s * ((3 * rx) ^ ry);
+		// Rotate the quadrant so the curve continues where the last one ended
+		if (ry == 0)
+		{
+			if (rx == 1)
+			{
+				x = n - 1 - x;
+				y = n - 1 - y;
+			}
+			Swap(x, y);
+		}
+	}
+	return d;
+}
+
+void FDualMesh::SortTrianglesSpatially()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FDualMesh::SortTrianglesSpatially)
+	const int32 numTriangles = DelaunayTriangles.Num() / 3;
+	TArray<TPair<uint32, int32>> order;
+	order.SetNumUninitialized(numTriangles);
+	ParallelFor(numTriangles, [this, &order](const int32 t)
+	{
+		const FVector2D centroid = (Coordinates[DelaunayTriangles[3 * t]] + Coordinates[DelaunayTriangles[3 * t + 1]]
+			+ Coordinates[DelaunayTriangles[3 * t + 2]]) / 3.0;
+		order[t] = TPair<uint32, int32>(HilbertIndex(centroid, MaxSize), t);
+	});
+	// Ties keep the triangulation order, so the result does not depend on the sort
+	Algo::Sort(order, [](const TPair<uint32, int32>& A, const TPair<uint32, int32>& B)
+	{
+		return A.Key < B.Key || (A.Key == B.Key && A.Value < B.Value);
+	});
+	TArray<int32> newTriangle;
+	newTriangle.SetNumUninitialized(numTriangles);
+	for (int32 i = 0; i < numTriangles; i++)
+	{
+		newTriangle[order[i].Value] = i;
+	}
+	auto remap = [&newTriangle](const FSideIndex s)
+	{
+		return s.IsValid() ? FSideIndex(3 * newTriangle[s / 3] + s % 3) : s;
+	};
+
+	TArray<FPointIndex> sortedTriangles;
+	sortedTriangles.SetNumUninitialized(DelaunayTriangles.Num());
+	TArray<FSideIndex> sortedHalfEdges;
+	sortedHalfEdges.SetNumUninitialized(HalfEdges.Num());
+	for (FSideIndex s = 0; s < DelaunayTriangles.Num(); s++)
+	{
+		const FSideIndex sorted = remap(s);
+		sortedTriangles[sorted] = DelaunayTriangles[s];
+		sortedHalfEdges[sorted] = remap(HalfEdges[s]);
+	}
+	DelaunayTriangles = MoveTemp(sortedTriangles);
+	HalfEdges = MoveTemp(sortedHalfEdges);
+	for (FSideIndex& edge : PointToEdge)
+	{
+		edge = remap(edge);
+	}
+	// The hull keeps the side of every hull point, in a triangle index
+	for (FTriangleIndex& hullSide : HullTriangles)
+	{
+		hullSide = FTriangleIndex(remap(FSideIndex(hullSide.Value)).Value);
+	}
+}
+
 void FDualMesh::AddGhostStructure()
 {
 	const FPointIndex ghostRegion = Coordinates.Num();
@@ -126,6 +380,10 @@ float UTriangleDualMesh::t_y(FTriangleIndex t) const
 
 FVector2D UTriangleDualMesh::r_pos(FPointIndex r) const
 {
+	if (bCompactPositions)
+	{
+		return _r_vertex_compact.IsValidIndex(r) ? FVector2D(_r_vertex_compact[r]) : FVector2D(-1.0f, -1.0f);
+	}
 	if (_r_vertex.IsValidIndex(r))
 	{
 		return _r_vertex[r];
@@ -138,6 +396,10 @@ FVector2D UTriangleDualMesh::r_pos(FPointIndex r) const
 
 FVector2D UTriangleDualMesh::t_pos(FTriangleIndex t) const
 {
+	if (bCompactPositions)
+	{
+		return _t_vertex_compact.IsValidIndex(t) ? FVector2D(_t_vertex_compact[t]) : FVector2D(-1.0f, -1.0f);
+	}
 	if (_t_vertex.IsValidIndex(t))
 	{
 		return _t_vertex[t];
@@ -148,9 +410,25 @@ FVector2D UTriangleDualMesh::t_pos(FTriangleIndex t) const
 	}
 }
 
+FDelaunayTriangle UTriangleDualMesh::t_triangle(FTriangleIndex t) const
+{
+	if (!t.IsValid() || t >= static_cast<SIZE_T>(NumTriangles))
+	{
+		return FDelaunayTriangle();
+	}
+	const FPointIndex a = Mesh.DelaunayTriangles[3 * t];
+	const FPointIndex b = Mesh.DelaunayTriangles[3 * t + 1];
+	const FPointIndex c = Mesh.DelaunayTriangles[3 * t + 2];
+	return FDelaunayTriangle(r_pos(a), r_pos(b), r_pos(c), a, b, c);
+}
+
 FPointIndex UTriangleDualMesh::s_begin_r(FSideIndex s) const
 {
-	return UDelaunayHelper::GetPointIndexFromHalfEdge(Mesh, s);
+	if (Mesh.DelaunayTriangles.IsValidIndex(s))
+	{
+		return Mesh.DelaunayTriangles[s];
+	}
+	return FPointIndex();
 }
 
 FPointIndex UTriangleDualMesh::s_end_r(FSideIndex s) const
@@ -173,31 +451,32 @@ FSideIndex UTriangleDualMesh::s_opposite_s(FSideIndex s) const
 	return UDelaunayHelper::OppositeHalfEdge(Mesh, s);
 }
 
-TArray<FSideIndex> UTriangleDualMesh::t_circulate_s(FTriangleIndex t) const
+TStaticArray<FSideIndex, 3> UTriangleDualMesh::t_circulate_s(FTriangleIndex t) const
 {
-	return UDelaunayHelper::EdgesOfTriangle(t * 3);
+	TStaticArray<FSideIndex, 3> out_s;
+	for (int i = 0; i < 3; i++)
+	{
+		out_s[i] = FSideIndex(t * 3 + i);
+	}
+	return out_s;
 }
 
-TArray<FPointIndex> UTriangleDualMesh::t_circulate_r(FTriangleIndex t) const
+TStaticArray<FPointIndex, 3> UTriangleDualMesh::t_circulate_r(FTriangleIndex t) const
 {
-	TArray<FPointIndex> out_r;
-	TArray<FSideIndex> out_s = t_circulate_s(t);
-	out_r.SetNum(3);
+	TStaticArray<FPointIndex, 3> out_r;
 	for (int i = 0; i < 3; i++)
 	{
-		out_r[i] = UDelaunayHelper::GetPointIndexFromHalfEdge(Mesh, out_s[i]);
+		out_r[i] = s_begin_r(FSideIndex(t * 3 + i));
 	}
 	return out_r;
 }
 
-TArray<FTriangleIndex> UTriangleDualMesh::t_circulate_t(FTriangleIndex t) const
+TStaticArray<FTriangleIndex, 3> UTriangleDualMesh::t_circulate_t(FTriangleIndex t) const
 {
-	TArray<FTriangleIndex> out_t;
-	TArray<FSideIndex> out_s = t_circulate_s(t);
-	out_t.SetNum(3);
+	TStaticArray<FTriangleIndex, 3> out_t;
 	for (int i = 0; i < 3; i++)
 	{
-		out_t[i] = s_outer_t(out_s[i]);
+		out_t[i] = s_outer_t(FSideIndex(t * 3 + i));
 	}
 	return out_t;
 }
@@ -205,10 +484,55 @@ TArray<FTriangleIndex> UTriangleDualMesh::t_circulate_t(FTriangleIndex t) const
 TArray<FSideIndex> UTriangleDualMesh::r_circulate_s(FPointIndex r) const
 {
 	TArray<FSideIndex> out_s;
-	if (!_r_in_s.Contains(r))
+	r_circulate_s(r, [&out_s](FSideIndex s) { out_s.Add(s); });
+	return out_s;
+}
+
+TArray<FPointIndex> UTriangleDualMesh::r_circulate_r(FPointIndex r) const
+{
+	TArray<FPointIndex> out_r;
+	r_circulate_r(r, [&out_r](FPointIndex r2) { out_r.Add(r2); });
+	return out_r;
+}
+
+TArray<FTriangleIndex> UTriangleDualMesh::r_circulate_t(FPointIndex r) const
+{
+	TArray<FTriangleIndex> out_t;
+	r_circulate_t(r, [&out_t](FTriangleIndex t) { out_t.Add(t); });
+	return out_t;
+}
+
+void UTriangleDualMesh::ReportMissingRegion(FPointIndex r) const
+{
+	FGenerationDiagnostics* diagnostics = Diagnostics.load(std::memory_order_relaxed);
+	if (diagnostics == nullptr)
+	{
+		diagnostics = FGenerationDiagnostics::GetActive();
+	}
+	if (diagnostics != nullptr)
+	{
+		diagnostics->Add(TEXT("Circulated a region without sides"), r);
+	}
+	else
 	{
 		UE_LOG(LogDualMesh, Warning, TEXT("Region list did not contain point %d!"), static_cast<int32>(r));
-		return out_s;
+	}
+}
+
+void UTriangleDualMesh::r_circulate_s(FPointIndex r, TFunctionRef<void(FSideIndex)> Visitor) const
+{
+	if (r.IsValid() && _r_adjacency_offsets.IsValidIndex(r + 1))
+	{
+		for (const FSideIndex s : r_adjacent_s(r))
+		{
+			Visitor(s);
+		}
+		return;
+	}
+	if (!_r_in_s.IsValidIndex(r) || !_r_in_s[r].IsValid())
+	{
+		ReportMissingRegion(r);
+		return;
 	}
 
 	const FSideIndex s0 = _r_in_s[r];
@@ -218,63 +542,68 @@ TArray<FSideIndex> UTriangleDualMesh::r_circulate_s(FPointIndex r) const
 		if (!_halfedges.IsValidIndex(incoming))
 		{
 			UE_LOG(LogDualMesh, Error, TEXT("Incoming side was invalid!"));
-			return out_s;
+			return;
 		}
 		FSideIndex next = _halfedges[incoming];
 		if (!next.IsValid())
 		{
 			UE_LOG(LogDualMesh, Error, TEXT("Next side was invalid!"));
-			return out_s;
+			return;
 		}
-		out_s.Add(next);
+		Visitor(next);
 		FSideIndex outgoing = UTriangleDualMesh::s_next_s(incoming);
 		incoming = _halfedges[outgoing];
 	}
 	while (incoming.IsValid() && incoming != s0);
-	return out_s;
 }
 
-TArray<FPointIndex> UTriangleDualMesh::r_circulate_r(FPointIndex r) const
+void UTriangleDualMesh::r_circulate_r(FPointIndex r, TFunctionRef<void(FPointIndex)> Visitor) const
 {
-	TArray<FPointIndex> out_r;
-	if (!_r_in_s.Contains(r))
+	if (r.IsValid() && _r_adjacency_offsets.IsValidIndex(r + 1))
 	{
-		UE_LOG(LogDualMesh, Warning, TEXT("Region list did not contain point %d!"), static_cast<int32>(r));
-		return out_r;
+		for (const FPointIndex r2 : r_adjacent_r(r))
+		{
+			Visitor(r2);
+		}
+		return;
+	}
+	if (!_r_in_s.IsValidIndex(r) || !_r_in_s[r].IsValid())
+	{
+		ReportMissingRegion(r);
+		return;
 	}
 
 	const FSideIndex s0 = _r_in_s[r];
-	if (s0.IsValid())
+	FSideIndex incoming = s0;
+	do
 	{
-		FSideIndex incoming = s0;
-		do
+		FPointIndex next = s_begin_r(incoming);
+		if (!next.IsValid())
 		{
-			FPointIndex next = s_begin_r(incoming);
-			if (!next.IsValid())
-			{
-				UE_LOG(LogDualMesh, Error, TEXT("Next region was invalid!"));
-				return out_r;
-			}
-			out_r.Add(next);
-			FSideIndex outgoing = UTriangleDualMesh::s_next_s(incoming);
-			incoming = _halfedges[outgoing];
+			UE_LOG(LogDualMesh, Error, TEXT("Next region was invalid!"));
+			return;
 		}
-		while (incoming.IsValid() && incoming != s0);
-	}
-	else
-	{
-		UE_LOG(LogDualMesh, Warning, TEXT("Attempted to start from an invalid region (%d)."), static_cast<int32>(r));
+		Visitor(next);
+		FSideIndex outgoing = UTriangleDualMesh::s_next_s(incoming);
+		incoming = _halfedges[outgoing];
 	}
-	return out_r;
+	while (incoming.IsValid() && incoming != s0);
 }
 
-TArray<FTriangleIndex> UTriangleDualMesh::r_circulate_t(FPointIndex r) const
+void UTriangleDualMesh::r_circulate_t(FPointIndex r, TFunctionRef<void(FTriangleIndex)> Visitor) const
 {
-	TArray<FTriangleIndex> out_t;
-	if (!_r_in_s.Contains(r))
+	if (r.IsValid() && _r_adjacency_offsets.IsValidIndex(r + 1))
 	{
-		UE_LOG(LogDualMesh, Warning, TEXT("Region list did not contain point %d!"), static_cast<int32>(r));
-		return out_t;
+		for (const FTriangleIndex t : r_adjacent_t(r))
+		{
+			Visitor(t);
+		}
+		return;
+	}
+	if (!_r_in_s.IsValidIndex(r) || !_r_in_s[r].IsValid())
+	{
+		ReportMissingRegion(r);
+		return;
 	}
 
 	const FSideIndex s0 = _r_in_s[r];
@@ -285,14 +614,148 @@ TArray<FTriangleIndex> UTriangleDualMesh::r_circulate_t(FPointIndex r) const
 		if (!next.IsValid())
 		{
 			UE_LOG(LogDualMesh, Error, TEXT("Next triangle was invalid!"));
-			return out_t;
+			return;
 		}
-		out_t.Add(next);
+		Visitor(next);
 		FSideIndex outgoing = UTriangleDualMesh::s_next_s(incoming);
 		incoming = _halfedges[outgoing];
 	}
 	while (incoming.IsValid() && incoming != s0);
-	return out_t;
+}
+
+void UTriangleDualMesh::BuildAdjacency()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UTriangleDualMesh::BuildAdjacency)
+	// Walk the half-edges, not the tables being replaced.
+	ResetAdjacency();
+
+	TArray<int32> offsets;
+	TArray<FSideIndex> adjacent_s;
+	TArray<FPointIndex> adjacent_r;
+	TArray<FTriangleIndex> adjacent_t;
+	offsets.SetNumUninitialized(NumRegions + 1);
+	adjacent_s.Reserve(NumSides);
+	adjacent_r.Reserve(NumSides);
+	adjacent_t.Reserve(NumSides);
+	for (FPointIndex r = 0; r < NumRegions; r++)
+	{
+		offsets[r] = adjacent_s.Num();
+		r_circulate_s(r, [&adjacent_s](FSideIndex s) { adjacent_s.Add(s); });
+		r_circulate_r(r, [&adjacent_r](FPointIndex r2) { adjacent_r.Add(r2); });
+		r_circulate_t(r, [&adjacent_t](FTriangleIndex t) { adjacent_t.Add(t); });
+		// The circulators take one step per incoming side, so their rows only line up on a well-formed mesh.
+		if (adjacent_r.Num() != adjacent_s.Num() || adjacent_t.Num() != adjacent_s.Num())
+		{
+			UE_LOG(LogDualMesh, Error, TEXT("Region %d has inconsistent neighbors, skipping adjacency tables."),
+			       static_cast<int32>(r));
+			return;
+		}
+	}
+	offsets[NumRegions] = adjacent_s.Num();
+
+	_r_adjacency_offsets = MoveTemp(offsets);
+	_r_adjacent_s = MoveTemp(adjacent_s);
+	_r_adjacent_r = MoveTemp(adjacent_r);
+	_r_adjacent_t = MoveTemp(adjacent_t);
+	UE_LOG(LogDualMesh, Log, TEXT("Built adjacency tables for %d regions using %llu bytes."), NumRegions,
+	       static_cast<uint64>(GetAdjacencyAllocatedSize()));
+}
+
+void UTriangleDualMesh::ResetAdjacency()
+{
+	_r_adjacency_offsets.Empty();
+	_r_adjacent_s.Empty();
+	_r_adjacent_r.Empty();
+	_r_adjacent_t.Empty();
+}
+
+bool UTriangleDualMesh::HasAdjacency() const
+{
+	return !_r_adjacency_offsets.IsEmpty();
+}
+
+SIZE_T UTriangleDualMesh::GetAdjacencyAllocatedSize() const
+{
+	return _r_adjacency_offsets.GetAllocatedSize() + _r_adjacent_s.GetAllocatedSize()
+		+ _r_adjacent_r.GetAllocatedSize() + _r_adjacent_t.GetAllocatedSize();
+}
+
+SIZE_T UTriangleDualMesh::GetAllocatedSize() const
+{
+	return GetPointsAllocatedSize() + GetTopologyAllocatedSize() + GetAdjacencyAllocatedSize()
+		+ GetRegionGridAllocatedSize();
+}
+
+SIZE_T UTriangleDualMesh::GetPointsAllocatedSize() const
+{
+	return _r_vertex.GetAllocatedSize() + _t_vertex.GetAllocatedSize() + Mesh.Coordinates.GetAllocatedSize()
+		+ _r_vertex_compact.GetAllocatedSize() + _t_vertex_compact.GetAllocatedSize();
+}
+
+SIZE_T UTriangleDualMesh::GetTopologyAllocatedSize() const
+{
+	return _halfedges.GetAllocatedSize() + _triangles.GetAllocatedSize() + _r_in_s.GetAllocatedSize()
+		+ Mesh.HalfEdges.GetAllocatedSize() + Mesh.PointToEdge.GetAllocatedSize()
+		+ Mesh.HullTriangles.GetAllocatedSize() + Mesh.HullPrevious.GetAllocatedSize()
+		+ Mesh.HullNext.GetAllocatedSize() + Mesh.DelaunayTriangles.GetAllocatedSize();
+}
+
+SIZE_T UTriangleDualMesh::GetRegionGridAllocatedSize() const
+{
+	return bRegionGridBuilt ? RegionGrid.GetAllocatedSize() : 0;
+}
+
+SIZE_T UTriangleDualMesh::EstimateAllocatedSize(const int32 NumRegions, const bool bWithAdjacency,
+                                                const bool bWithCompactPositions)
+{
+	// A planar triangulation has about two triangles and six sides per region
+	const SIZE_T regions = FMath::Max(NumRegions, 0);
+	const SIZE_T triangles = regions * 2;
+	const SIZE_T sides = triangles * 3;
+	// The raw triangulation keeps a second copy of the region positions unless they are compact
+	const SIZE_T points = bWithCompactPositions
+		? (regions + triangles) * sizeof(FVector2f)
+		: (regions * 2 + triangles) * sizeof(FVector2D);
+	const SIZE_T topology = sides * (2 * sizeof(FSideIndex) + sizeof(FPointIndex))
+		+ regions * (2 * sizeof(FSideIndex) + 3 * sizeof(FTriangleIndex));
+	SIZE_T adjacency = 0;
+	if (bWithAdjacency)
+	{
+		adjacency = (regions + 1) * sizeof(int32)
+			+ sides * (sizeof(FSideIndex) + sizeof(FPointIndex) + sizeof(FTriangleIndex));
+	}
+	// The region grid holds about one entry per region
+	return points + topology + adjacency + regions * sizeof(int32);
+}
+
+TArrayView<const FSideIndex> UTriangleDualMesh::r_adjacent_s(FPointIndex r) const
+{
+	if (!r.IsValid() || !_r_adjacency_offsets.IsValidIndex(r + 1))
+	{
+		return TArrayView<const FSideIndex>();
+	}
+	const int32 begin = _r_adjacency_offsets[r];
+	return TArrayView<const FSideIndex>(_r_adjacent_s.GetData() + begin, _r_adjacency_offsets[r + 1] - begin);
+}
+
+TArrayView<const FPointIndex> UTriangleDualMesh::r_adjacent_r(FPointIndex r) const
+{
+	if (!r.IsValid() || !_r_adjacency_offsets.IsValidIndex(r + 1))
+	{
+		return TArrayView<const FPointIndex>();
+	}
+	const int32 begin = _r_adjacency_offsets[r];
+	return TArrayView<const FPointIndex>(_r_adjacent_r.GetData() + begin, _r_adjacency_offsets[r + 1] - begin);
+}
+
+TArrayView<const FTriangleIndex> UTriangleDualMesh::r_adjacent_t(FPointIndex r) const
+{
+	if (!r.IsValid() || !_r_adjacency_offsets.IsValidIndex(r + 1))
+	{
+		return TArrayView<const FTriangleIndex>();
+	}
+	const int32 begin = _r_adjacency_offsets[r];
+	return TArrayView<const FTriangleIndex>(_r_adjacent_t.GetData() + begin, _r_adjacency_offsets[r + 1] - begin);
 }
 
 FPointIndex UTriangleDualMesh::ghost_r() const
@@ -337,29 +800,31 @@ bool UTriangleDualMesh::r_boundary(FPointIndex r) const
 
 void UTriangleDualMesh::InitializeMesh(const FDualMesh& Input, int32 BoundaryRegions)
 {
+	ResetAdjacency();
+	InvalidateRegionGrid();
 	Mesh = Input;
 	NumBoundaryRegions = BoundaryRegions;
 	NumSolidSides = Mesh.NumSolidSides;
+	bCompactPositions = false;
+	_r_vertex_compact.Empty();
+	_t_vertex_compact.Empty();
 	_r_vertex = Mesh.Coordinates;
-	_triangles.SetNum(Mesh.DelaunayTriangles.Num() / 3);
-	for (FTriangleIndex t = 0; t < Mesh.DelaunayTriangles.Num(); t += 3)
-	{
-		_triangles[t / 3] = UDelaunayHelper::ConvertTriangleIDToTriangle(Mesh, t);
-	}
+	_triangles.Empty();
 	_halfedges = Mesh.HalfEdges;
 
 	NumSides = _halfedges.Num();
 	NumRegions = _r_vertex.Num();
 	NumSolidRegions = NumRegions - 1;
-	NumTriangles = _triangles.Num();
+	NumTriangles = Mesh.DelaunayTriangles.Num() / 3;
 	NumSolidTriangles = NumSolidSides / 3;
 
+	_r_in_s.Init(FSideIndex(), NumRegions);
 	for (FSideIndex s = 0; s < _halfedges.Num(); s++)
 	{
 		FPointIndex endpoint = UDelaunayHelper::GetPointIndexFromHalfEdge(Mesh, UTriangleDualMesh::s_next_s(s));
-		if (!_r_in_s.Contains(endpoint) || !_halfedges[s].IsValid())
+		if (!_r_in_s[endpoint].IsValid() || !_halfedges[s].IsValid())
 		{
-			_r_in_s.Add(endpoint, s);
+			_r_in_s[endpoint] = s;
 		}
 	}
 
@@ -388,55 +853,837 @@ void UTriangleDualMesh::InitializeMesh(const FDualMesh& Input, int32 BoundaryReg
 	}
 }
 
-FVector2D UTriangleDualMesh::GetSize() const
+void UTriangleDualMesh::CompactPositions()
 {
-	return Mesh.MaxSize;
+	if (bCompactPositions)
+	{
+		return;
+	}
+	TRACE_CPUPROFILER_EVENT_SCOPE(UTriangleDualMesh::CompactPositions)
+	_r_vertex_compact.SetNumUninitialized(_r_vertex.Num());
+	for (int32 r = 0; r < _r_vertex.Num(); r++)
+	{
+		_r_vertex_compact[r] = FVector2f(_r_vertex[r]);
+	}
+	_t_vertex_compact.SetNumUninitialized(_t_vertex.Num());
+	for (int32 t = 0; t < _t_vertex.Num(); t++)
+	{
+		_t_vertex_compact[t] = FVector2f(_t_vertex[t]);
+	}
+	_r_vertex.Empty();
+	_t_vertex.Empty();
+	Mesh.Coordinates.Empty();
+	_triangles.Empty();
+	bCompactPositions = true;
+	// The grid cells were sized from the full precision positions
+	InvalidateRegionGrid();
 }
 
-
-TArray<FVector2D>& UTriangleDualMesh::GetPoints()
+bool UTriangleDualMesh::HasCompactPositions() const
 {
-	return _r_vertex;
+	return bCompactPositions;
 }
 
-TArray<FVector2D>& UTriangleDualMesh::GetTriangleCentroids()
+namespace
 {
-	return _t_vertex;
-}
+	// Relative tolerance of the predicates below it, smaller values count as collinear or cocircular.
+	constexpr double EditTolerance = 1e-9;
 
-TArray<FSideIndex>& UTriangleDualMesh::GetHalfEdges()
-{
-	return _halfedges;
-}
+	// Twice the signed area of A, B, C, positive when they turn counter-clockwise.
+	double Orient(const FVector2D& A, const FVector2D& B, const FVector2D& C)
+	{
+		return (B.X - A.X) * (C.Y - A.Y) - (B.Y - A.Y) * (C.X - A.X);
+	}
 
-TArray<FDelaunayTriangle>& UTriangleDualMesh::GetTriangles()
-{
-	return _triangles;
+	// Positive when D lies inside the circle through A, B and C, whichever way they turn.
+	// OutScale is the sum of the magnitudes of the terms, to compare the result against.
+	double InCircle(const FVector2D& A, const FVector2D& B, const FVector2D& C, const FVector2D& D, double& OutScale)
+	{
+		const double adx = A.X - D.X;
+		const double ady = A.Y - D.Y;
+		const double bdx = B.X - D.X;
+		const double bdy = B.Y - D.Y;
+		const double cdx = C.X - D.X;
+		const double cdy = C.Y - D.Y;
+		const double alift = adx * adx + ady * ady;
+		const double blift = bdx * bdx + bdy * bdy;
+		const double clift = cdx * cdx + cdy * cdy;
+		const double det = alift * (bdx * cdy - bdy * cdx) + blift * (cdx * ady - cdy * adx)
+			+ clift * (adx * bdy - ady * bdx);
+		OutScale = alift * (FMath::Abs(bdx * cdy) + FMath::Abs(bdy * cdx))
+			+ blift * (FMath::Abs(cdx * ady) + FMath::Abs(cdy * adx))
+			+ clift * (FMath::Abs(adx * bdy) + FMath::Abs(ady * bdx));
+		return Orient(A, B, C) < 0.0 ? -det : det;
+	}
 }
 
-FDualMesh& UTriangleDualMesh::GetRawMesh()
+void FDualMeshEdit::Reset()
 {
-	return Mesh;
+	DirtyRegions.Reset();
+	DirtyTriangles.Reset();
+	MovedRegions.Reset();
+	MovedTriangles.Reset();
+	bGhostsRenumbered = false;
 }
 
-FPointIndex UTriangleDualMesh::PointInRegion(const FVector2D& Point) const
+bool UTriangleDualMesh::r_interior(FPointIndex r) const
 {
-	int32 ClosestRegionIndex = ClosestRegion(Point);
-	double ClosestDistSquared = DBL_MAX;
-	for (int32 RegionIndex = 0; RegionIndex < _r_vertex.Num(); ++RegionIndex)
+	if (!r.IsValid() || r >= static_cast<SIZE_T>(NumSolidRegions) || !_r_in_s[r].IsValid())
+	{
+		return false;
+	}
+	// Regions on the hull have a ghost triangle around them
+	const FSideIndex s0 = _r_in_s[r];
+	FSideIndex incoming = s0;
+	int32 steps = 0;
+	do
 	{
-		double Dist = FVector2D::DistSquared(_r_vertex[RegionIndex], Point);
-		if (ClosestDistSquared > Dist)
+		if (s_ghost(incoming) || steps++ > NumSides)
 		{
-			ClosestDistSquared = Dist;
-			ClosestRegionIndex = RegionIndex;
+			return false;
 		}
+		incoming = _halfedges[s_next_s(incoming)];
 	}
-	if (ClosestRegionIndex == -1)
+	while (incoming != s0);
+	return true;
+}
+
+bool UTriangleDualMesh::LocateTriangle(const FVector2D& Point, FTriangleIndex Start, FTriangleIndex& OutTriangle,
+                                       FSideIndex& OutOnSide) const
+{
+	FTriangleIndex t = Start.IsValid() && Start < static_cast<SIZE_T>(NumSolidTriangles) ? Start : FTriangleIndex(0);
+	// Walk towards Point, a walk on a Delaunay triangulation never runs in circles
+	for (int32 step = 0; step < NumSolidTriangles; step++)
 	{
-		return -1;
-	}
-	TArray<FPointIndex> NearRegions;
+		const FVector2D corners[3] = {r_pos(s_begin_r(3 * t)), r_pos(s_begin_r(3 * t + 1)), r_pos(s_begin_r(3 * t + 2))};
+		const double area = Orient(corners[0], corners[1], corners[2]);
+		const double sign = area < 0.0 ? -1.0 : 1.0;
+		const double tolerance = FMath::Abs(area) * EditTolerance;
+		FSideIndex leaving;
+		FSideIndex onSide;
+		for (int32 k = 0; k < 3; k++)
+		{
+			const double side = sign * Orient(corners[k], corners[(k + 1) % 3], Point);
+			if (side < -tolerance)
+			{
+				leaving = 3 * t + k;
+				break;
+			}
+			if (side <= tolerance)
+			{
+				onSide = 3 * t + k;
+			}
+		}
+		if (!leaving.IsValid())
+		{
+			OutTriangle = t;
+			OutOnSide = onSide;
+			return true;
+		}
+		const FSideIndex next = _halfedges[leaving];
+		if (s_ghost(next))
+		{
+			return false;
+		}
+		t = s_to_t(next);
+	}
+	return false;
+}
+
+bool UTriangleDualMesh::CanInsertAt(const FVector2D& Point, FTriangleIndex Start, FPointIndex Ignore,
+                                    FTriangleIndex& OutTriangle, FSideIndex& OutOnSide) const
+{
+	if (!LocateTriangle(Point, Start, OutTriangle, OutOnSide))
+	{
+		return false;
+	}
+	// Splitting a hull side would change the ghost triangles
+	if (OutOnSide.IsValid() && s_ghost(_halfedges[OutOnSide]))
+	{
+		return false;
+	}
+	for (const FPointIndex corner : t_circulate_r(OutTriangle))
+	{
+		if (corner != Ignore && FVector2D::DistSquared(r_pos(corner), Point) <= FMath::Square(UE_KINDA_SMALL_NUMBER))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void UTriangleDualMesh::SetRegionPosition(FPointIndex r, const FVector2D& Position)
+{
+	if (bCompactPositions)
+	{
+		_r_vertex_compact[r] = FVector2f(Position);
+	}
+	else
+	{
+		_r_vertex[r] = Position;
+		Mesh.Coordinates[r] = Position;
+	}
+}
+
+void UTriangleDualMesh::SetTriangle(FTriangleIndex t, FPointIndex a, FPointIndex b, FPointIndex c,
+                                    FDualMeshEdit& OutEdit)
+{
+	Mesh.DelaunayTriangles[3 * t] = a;
+	Mesh.DelaunayTriangles[3 * t + 1] = b;
+	Mesh.DelaunayTriangles[3 * t + 2] = c;
+	// Every corner of a rewritten triangle is a corner of one written in the same edit, so _r_in_s stays valid
+	_r_in_s[b] = 3 * t;
+	_r_in_s[c] = 3 * t + 1;
+	_r_in_s[a] = 3 * t + 2;
+	OutEdit.DirtyTriangles.Add(t);
+}
+
+void UTriangleDualMesh::LinkSides(FSideIndex a, FSideIndex b)
+{
+	_halfedges[a] = b;
+	Mesh.HalfEdges[a] = b;
+	_halfedges[b] = a;
+	Mesh.HalfEdges[b] = a;
+}
+
+void UTriangleDualMesh::FlipSide(FSideIndex a, FDualMeshEdit& OutEdit)
+{
+	// Same flip as the Delaunator's legalize: a and b keep their slots and the diagonal ar, bl is replaced
+	const FSideIndex b = _halfedges[a];
+	const FSideIndex al = s_next_s(a);
+	const FSideIndex ar = s_prev_s(a);
+	const FSideIndex bl = s_prev_s(b);
+	const FPointIndex pr = s_begin_r(a);
+	const FPointIndex pl = s_begin_r(al);
+	const FPointIndex p0 = s_begin_r(ar);
+	const FPointIndex p1 = s_begin_r(bl);
+	const FSideIndex hbl = _halfedges[bl];
+	const FSideIndex har = _halfedges[ar];
+
+	Mesh.DelaunayTriangles[a] = p1;
+	Mesh.DelaunayTriangles[b] = p0;
+	LinkSides(a, hbl);
+	LinkSides(b, har);
+	LinkSides(ar, bl);
+	_r_in_s[pl] = a;
+	_r_in_s[p0] = al;
+	_r_in_s[p1] = ar;
+	_r_in_s[pr] = b;
+	OutEdit.DirtyTriangles.Add(s_to_t(a));
+	OutEdit.DirtyTriangles.Add(s_to_t(b));
+}
+
+void UTriangleDualMesh::Legalize(TArray<FSideIndex>& Sides, FDualMeshEdit& OutEdit)
+{
+	int32 budget = 4 * NumSides + Sides.Num();
+	while (!Sides.IsEmpty())
+	{
+		if (budget-- < 0)
+		{
+			UE_LOG(LogDualMesh, Warning, TEXT("Stopped flipping sides, %d are left unchecked."), Sides.Num());
+			return;
+		}
+		const FSideIndex a = Sides.Pop(EAllowShrinking::No);
+		const FSideIndex b = _halfedges[a];
+		// Hull sides are held in place by the ghost triangles
+		if (s_ghost(a) || !b.IsValid() || s_ghost(b))
+		{
+			continue;
+		}
+		double scale;
+		const double inside = InCircle(r_pos(s_begin_r(a)), r_pos(s_end_r(a)), r_pos(s_begin_r(s_prev_s(a))),
+		                               r_pos(s_begin_r(s_prev_s(b))), scale);
+		if (inside <= EditTolerance * scale)
+		{
+			continue;
+		}
+		FlipSide(a, OutEdit);
+		// The outer sides of the flipped pair may not be Delaunay anymore
+		Sides.Add(a);
+		Sides.Add(s_next_s(a));
+		Sides.Add(b);
+		Sides.Add(s_next_s(b));
+	}
+}
+
+void UTriangleDualMesh::InsertIntoTriangles(FPointIndex r, FTriangleIndex t, FSideIndex OnSide,
+                                            FTriangleIndex SpareA, FTriangleIndex SpareB, FDualMeshEdit& OutEdit)
+{
+	TArray<FSideIndex> sides;
+	if (!OnSide.IsValid() || s_ghost(_halfedges[OnSide]))
+	{
+		// Split t into three triangles around r
+		const FPointIndex a = s_begin_r(3 * t);
+		const FPointIndex b = s_begin_r(3 * t + 1);
+		const FPointIndex c = s_begin_r(3 * t + 2);
+		const FSideIndex h0 = _halfedges[3 * t];
+		const FSideIndex h1 = _halfedges[3 * t + 1];
+		const FSideIndex h2 = _halfedges[3 * t + 2];
+		SetTriangle(t, a, b, r, OutEdit);
+		SetTriangle(SpareA, b, c, r, OutEdit);
+		SetTriangle(SpareB, c, a, r, OutEdit);
+		LinkSides(3 * t, h0);
+		LinkSides(3 * SpareA, h1);
+		LinkSides(3 * SpareB, h2);
+		LinkSides(3 * t + 1, 3 * SpareA + 2);
+		LinkSides(3 * SpareA + 1, 3 * SpareB + 2);
+		LinkSides(3 * SpareB + 1, 3 * t + 2);
+		sides = {3 * t, 3 * SpareA, 3 * SpareB};
+	}
+	else
+	{
+		// r lies on OnSide, split both triangles along it into two
+		const FSideIndex opposite = _halfedges[OnSide];
+		const FTriangleIndex t1 = s_to_t(OnSide);
+		const FTriangleIndex t2 = s_to_t(opposite);
+		const FPointIndex a = s_begin_r(OnSide);
+		const FPointIndex b = s_end_r(OnSide);
+		const FPointIndex c = s_begin_r(s_prev_s(OnSide));
+		const FPointIndex d = s_begin_r(s_prev_s(opposite));
+		const FSideIndex bc = _halfedges[s_next_s(OnSide)];
+		const FSideIndex ca = _halfedges[s_prev_s(OnSide)];
+		const FSideIndex ad = _halfedges[s_next_s(opposite)];
+		const FSideIndex db = _halfedges[s_prev_s(opposite)];
+		SetTriangle(t1, c, a, r, OutEdit);
+		SetTriangle(SpareA, b, c, r, OutEdit);
+		SetTriangle(t2, d, b, r, OutEdit);
+		SetTriangle(SpareB, a, d, r, OutEdit);
+		LinkSides(3 * t1, ca);
+		LinkSides(3 * SpareA, bc);
+		LinkSides(3 * t2, db);
+		LinkSides(3 * SpareB, ad);
+		LinkSides(3 * t1 + 1, 3 * SpareB + 2);
+		LinkSides(3 * t1 + 2, 3 * SpareA + 1);
+		LinkSides(3 * SpareA + 2, 3 * t2 + 1);
+		LinkSides(3 * t2 + 2, 3 * SpareB + 1);
+		sides = {3 * t1, 3 * SpareA, 3 * t2, 3 * SpareB};
+	}
+	Legalize(sides, OutEdit);
+}
+
+bool UTriangleDualMesh::DetachRegion(FPointIndex r, FTriangleIndex& OutSpareA, FTriangleIndex& OutSpareB,
+                                     FDualMeshEdit& OutEdit)
+{
+	TArray<FSideIndex, TInlineAllocator<16>> incoming;
+	auto gatherIncoming = [this, r, &incoming]()
+	{
+		incoming.Reset();
+		const FSideIndex s0 = _r_in_s[r];
+		FSideIndex s = s0;
+		do
+		{
+			incoming.Add(s);
+			s = _halfedges[s_next_s(s)];
+		}
+		while (s != s0);
+	};
+	gatherIncoming();
+	// The flips below only trade triangles around r, so the hole keeps these slots
+	TArray<FTriangleIndex, TInlineAllocator<16>> hole;
+	for (const FSideIndex s : incoming)
+	{
+		hole.Add(s_to_t(s));
+	}
+	auto legalizeHole = [this, &hole, &OutEdit](FTriangleIndex SkipA, FTriangleIndex SkipB)
+	{
+		TArray<FSideIndex> sides;
+		for (const FTriangleIndex t : hole)
+		{
+			if (t != SkipA && t != SkipB)
+			{
+				sides.Append({3 * t, 3 * t + 1, 3 * t + 2});
+			}
+		}
+		Legalize(sides, OutEdit);
+	};
+
+	// What the flips below overwrite, so a region that cannot be detached leaves the mesh as it was
+	struct FSideState
+	{
+		FSideIndex Side;
+		FPointIndex Begin;
+		FSideIndex Opposite;
+	};
+	TArray<FSideState, TInlineAllocator<96>> sideLog;
+	TArray<TPair<FPointIndex, FSideIndex>, TInlineAllocator<48>> regionLog;
+	const int32 numDirtyTriangles = OutEdit.DirtyTriangles.Num();
+	auto logFlip = [this, &sideLog, &regionLog](FSideIndex e)
+	{
+		for (const FTriangleIndex t : {s_to_t(e), s_to_t(_halfedges[e])})
+		{
+			for (int32 k = 0; k < 3; k++)
+			{
+				const FSideIndex side = 3 * t + k;
+				const FSideIndex opposite = _halfedges[side];
+				sideLog.Add({side, Mesh.DelaunayTriangles[side], opposite});
+				if (opposite.IsValid())
+				{
+					sideLog.Add({opposite, Mesh.DelaunayTriangles[opposite], _halfedges[opposite]});
+				}
+				const FPointIndex begin = s_begin_r(side);
+				regionLog.Emplace(begin, _r_in_s[begin]);
+			}
+		}
+	};
+	auto rollBack = [this, &sideLog, &regionLog, &OutEdit, numDirtyTriangles]()
+	{
+		// Backwards, so entries logged twice end up with their oldest value
+		for (int32 i = sideLog.Num() - 1; i >= 0; i--)
+		{
+			const FSideState& state = sideLog[i];
+			Mesh.DelaunayTriangles[state.Side] = state.Begin;
+			_halfedges[state.Side] = state.Opposite;
+			Mesh.HalfEdges[state.Side] = state.Opposite;
+		}
+		for (int32 i = regionLog.Num() - 1; i >= 0; i--)
+		{
+			_r_in_s[regionLog[i].Key] = regionLog[i].Value;
+		}
+		OutEdit.DirtyTriangles.SetNum(numDirtyTriangles);
+	};
+
+	// Flip the sides of r away until three triangles are left
+	const FVector2D center = r_pos(r);
+	while (incoming.Num() > 3)
+	{
+		bool bFlipped = false;
+		// On a regular grid r can sit on the new side, the flat triangle it leaves is merged away below
+		for (const bool bAllowFlat : {false, true})
+		{
+			for (const FSideIndex e : incoming)
+			{
+				// e runs from u to r, it can be flipped where the triangles on both sides form a convex quad
+				const FSideIndex opposite = _halfedges[e];
+				const FVector2D u = r_pos(s_begin_r(e));
+				const FVector2D q1 = r_pos(s_begin_r(s_prev_s(e)));
+				const FVector2D q2 = r_pos(s_begin_r(s_prev_s(opposite)));
+				const double tolerance = (FMath::Abs(Orient(u, center, q1)) + FMath::Abs(Orient(u, center, q2)))
+					* EditTolerance;
+				const double sideU = Orient(q1, q2, u);
+				const double sideR = Orient(q1, q2, center);
+				const bool bConvex = sideU * sideR < 0.0 && FMath::Abs(sideR) > tolerance;
+				if (FMath::Abs(sideU) > tolerance && (bConvex || (bAllowFlat && FMath::Abs(sideR) <= tolerance)))
+				{
+					logFlip(e);
+					FlipSide(e, OutEdit);
+					bFlipped = true;
+					break;
+				}
+			}
+			if (bFlipped)
+			{
+				break;
+			}
+		}
+		if (!bFlipped)
+		{
+			UE_LOG(LogDualMesh, Warning, TEXT("Could not detach region %d, its neighbors are degenerate."),
+			       static_cast<int32>(r));
+			rollBack();
+			return false;
+		}
+		gatherIncoming();
+	}
+
+	// Merge the last three triangles into the first one, each loses the side facing r
+	const FPointIndex u0 = s_begin_r(incoming[0]);
+	const FPointIndex u1 = s_begin_r(incoming[1]);
+	const FPointIndex u2 = s_begin_r(incoming[2]);
+	const FSideIndex o0 = _halfedges[s_prev_s(incoming[0])];
+	const FSideIndex o1 = _halfedges[s_prev_s(incoming[1])];
+	const FSideIndex o2 = _halfedges[s_prev_s(incoming[2])];
+	const FTriangleIndex merged = s_to_t(incoming[0]);
+	SetTriangle(merged, u1, u0, u2, OutEdit);
+	LinkSides(3 * merged, o0);
+	LinkSides(3 * merged + 1, o2);
+	LinkSides(3 * merged + 2, o1);
+	_r_in_s[r] = FSideIndex();
+	OutSpareA = s_to_t(incoming[1]);
+	OutSpareB = s_to_t(incoming[2]);
+	legalizeHole(OutSpareA, OutSpareB);
+	return true;
+}
+
+void UTriangleDualMesh::MoveTriangleSlot(FTriangleIndex From, FTriangleIndex To)
+{
+	for (int32 k = 0; k < 3; k++)
+	{
+		Mesh.DelaunayTriangles[3 * To + k] = Mesh.DelaunayTriangles[3 * From + k];
+	}
+	for (int32 k = 0; k < 3; k++)
+	{
+		const FSideIndex from = 3 * From + k;
+		const FSideIndex to = 3 * To + k;
+		LinkSides(to, _halfedges[from]);
+		const FPointIndex end = s_end_r(to);
+		if (_r_in_s[end] == from)
+		{
+			_r_in_s[end] = to;
+		}
+	}
+	if (bCompactPositions)
+	{
+		_t_vertex_compact[To] = _t_vertex_compact[From];
+	}
+	else
+	{
+		_t_vertex[To] = _t_vertex[From];
+	}
+}
+
+void UTriangleDualMesh::GrowSolidStorage()
+{
+	const int32 oldSolidSides = NumSolidSides;
+	const FPointIndex oldGhost = ghost_r();
+	// The ghost sides move up by two triangles, from the back so no _r_in_s entry moves twice
+	for (int32 s = NumSides - 1; s >= oldSolidSides; s--)
+	{
+		const FSideIndex opposite = _halfedges[s];
+		if (opposite >= static_cast<SIZE_T>(oldSolidSides))
+		{
+			_halfedges[s] = opposite + 6;
+			Mesh.HalfEdges[s] = opposite + 6;
+		}
+		else
+		{
+			_halfedges[opposite] = s + 6;
+			Mesh.HalfEdges[opposite] = s + 6;
+		}
+		const FPointIndex end = s_end_r(s);
+		if (_r_in_s[end] == static_cast<SIZE_T>(s))
+		{
+			_r_in_s[end] = s + 6;
+		}
+	}
+	for (int32 s = oldSolidSides; s < NumSides; s++)
+	{
+		if (Mesh.DelaunayTriangles[s] == oldGhost)
+		{
+			Mesh.DelaunayTriangles[s] = oldGhost + 1;
+		}
+	}
+
+	Mesh.DelaunayTriangles.InsertDefaulted(oldSolidSides, 6);
+	Mesh.HalfEdges.InsertDefaulted(oldSolidSides, 6);
+	_halfedges.InsertDefaulted(oldSolidSides, 6);
+	if (bCompactPositions)
+	{
+		_r_vertex_compact.InsertZeroed(static_cast<int32>(oldGhost));
+		_t_vertex_compact.InsertZeroed(NumSolidTriangles, 2);
+	}
+	else
+	{
+		_r_vertex.InsertZeroed(static_cast<int32>(oldGhost));
+		Mesh.Coordinates.InsertZeroed(static_cast<int32>(oldGhost));
+		_t_vertex.InsertZeroed(NumSolidTriangles, 2);
+	}
+	_r_in_s.InsertDefaulted(static_cast<int32>(oldGhost));
+
+	NumSides += 6;
+	NumSolidSides += 6;
+	Mesh.NumSolidSides = NumSolidSides;
+	NumRegions++;
+	NumSolidRegions++;
+	NumTriangles += 2;
+	NumSolidTriangles += 2;
+}
+
+void UTriangleDualMesh::ShrinkSolidStorage()
+{
+	const int32 oldSolidSides = NumSolidSides;
+	const FPointIndex oldGhost = ghost_r();
+	// The ghost sides move down by two triangles, from the front so no _r_in_s entry moves twice
+	for (int32 s = oldSolidSides; s < NumSides; s++)
+	{
+		const FSideIndex opposite = _halfedges[s];
+		if (opposite >= static_cast<SIZE_T>(oldSolidSides))
+		{
+			_halfedges[s] = opposite - 6;
+			Mesh.HalfEdges[s] = opposite - 6;
+		}
+		else
+		{
+			_halfedges[opposite] = s - 6;
+			Mesh.HalfEdges[opposite] = s - 6;
+		}
+		const FPointIndex end = s_end_r(s);
+		if (_r_in_s[end] == static_cast<SIZE_T>(s))
+		{
+			_r_in_s[end] = s - 6;
+		}
+	}
+	for (int32 s = oldSolidSides; s < NumSides; s++)
+	{
+		if (Mesh.DelaunayTriangles[s] == oldGhost)
+		{
+			Mesh.DelaunayTriangles[s] = oldGhost - 1;
+		}
+	}
+
+	Mesh.DelaunayTriangles.RemoveAt(oldSolidSides - 6, 6, EAllowShrinking::No);
+	Mesh.HalfEdges.RemoveAt(oldSolidSides - 6, 6, EAllowShrinking::No);
+	_halfedges.RemoveAt(oldSolidSides - 6, 6, EAllowShrinking::No);
+	if (bCompactPositions)
+	{
+		_r_vertex_compact.RemoveAt(static_cast<int32>(oldGhost) - 1, 1, EAllowShrinking::No);
+		_t_vertex_compact.RemoveAt(NumSolidTriangles - 2, 2, EAllowShrinking::No);
+	}
+	else
+	{
+		_r_vertex.RemoveAt(static_cast<int32>(oldGhost) - 1, 1, EAllowShrinking::No);
+		Mesh.Coordinates.RemoveAt(static_cast<int32>(oldGhost) - 1, 1, EAllowShrinking::No);
+		_t_vertex.RemoveAt(NumSolidTriangles - 2, 2, EAllowShrinking::No);
+	}
+	_r_in_s.RemoveAt(static_cast<int32>(oldGhost) - 1, 1, EAllowShrinking::No);
+
+	NumSides -= 6;
+	NumSolidSides -= 6;
+	Mesh.NumSolidSides = NumSolidSides;
+	NumRegions--;
+	NumSolidRegions--;
+	NumTriangles -= 2;
+	NumSolidTriangles -= 2;
+}
+
+void UTriangleDualMesh::FinishEdit(FDualMeshEdit& OutEdit)
+{
+	Algo::Sort(OutEdit.DirtyTriangles);
+	OutEdit.DirtyTriangles.SetNum(Algo::Unique(OutEdit.DirtyTriangles));
+	for (const FTriangleIndex t : OutEdit.DirtyTriangles)
+	{
+		const TStaticArray<FPointIndex, 3> corners = t_circulate_r(t);
+		const FVector2D a = r_pos(corners[0]);
+		const FVector2D b = r_pos(corners[1]);
+		const FVector2D c = r_pos(corners[2]);
+		// Same centroid as InitializeMesh
+		const FVector2D centroid((a.X + b.X + c.X) / 3.0f, (a.Y + b.Y + c.Y) / 3.0f);
+		if (bCompactPositions)
+		{
+			_t_vertex_compact[t] = FVector2f(centroid);
+		}
+		else
+		{
+			_t_vertex[t] = centroid;
+		}
+		OutEdit.DirtyRegions.Append(corners.GetData(), 3);
+	}
+	Algo::Sort(OutEdit.DirtyRegions);
+	OutEdit.DirtyRegions.SetNum(Algo::Unique(OutEdit.DirtyRegions));
+
+	_triangles.Empty();
+	InvalidateRegionGrid();
+	if (HasAdjacency())
+	{
+		BuildAdjacency();
+	}
+}
+
+bool UTriangleDualMesh::MoveRegion(FPointIndex r, const FVector2D& Position, FDualMeshEdit& OutEdit)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UTriangleDualMesh::MoveRegion)
+	FTriangleIndex t;
+	FSideIndex onSide;
+	if (!r_interior(r) || !CanInsertAt(Position, s_to_t(_r_in_s[r]), r, t, onSide))
+	{
+		return false;
+	}
+	const FVector2D oldPosition = r_pos(r);
+	if (oldPosition == Position)
+	{
+		return true;
+	}
+	const FPointIndex neighbor = s_begin_r(_r_in_s[r]);
+	FTriangleIndex spareA;
+	FTriangleIndex spareB;
+	if (!DetachRegion(r, spareA, spareB, OutEdit))
+	{
+		return false;
+	}
+
+	// The hull did not change, so Position is still inside it
+	const FTriangleIndex start = s_to_t(_r_in_s[neighbor]);
+	SetRegionPosition(r, Position);
+	if (!LocateTriangle(Position, start, t, onSide))
+	{
+		UE_LOG(LogDualMesh, Warning, TEXT("Lost region %d while moving it, putting it back."), static_cast<int32>(r));
+		SetRegionPosition(r, oldPosition);
+		LocateTriangle(oldPosition, start, t, onSide);
+	}
+	InsertIntoTriangles(r, t, onSide, spareA, spareB, OutEdit);
+	FinishEdit(OutEdit);
+	return true;
+}
+
+FPointIndex UTriangleDualMesh::AddRegion(const FVector2D& Position, FDualMeshEdit& OutEdit)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UTriangleDualMesh::AddRegion)
+	if (NumSolidTriangles <= 0)
+	{
+		return FPointIndex();
+	}
+	// Start next to the closest region if the grid is there anyway, the walk gets there from anywhere
+	FTriangleIndex start(0);
+	if (bRegionGridBuilt.load(std::memory_order_acquire))
+	{
+		const FPointIndex closest = ClosestRegion(Position);
+		if (closest.IsValid() && _r_in_s[closest].IsValid())
+		{
+			start = s_to_t(_r_in_s[closest]);
+		}
+	}
+	FTriangleIndex t;
+	FSideIndex onSide;
+	if (!CanInsertAt(Position, start, FPointIndex(), t, onSide))
+	{
+		return FPointIndex();
+	}
+
+	// t and onSide are solid, so they keep their index
+	const FTriangleIndex spareA = NumSolidTriangles;
+	const FTriangleIndex spareB = NumSolidTriangles + 1;
+	GrowSolidStorage();
+	const FPointIndex r = NumSolidRegions - 1;
+	SetRegionPosition(r, Position);
+	InsertIntoTriangles(r, t, onSide, spareA, spareB, OutEdit);
+	OutEdit.bGhostsRenumbered = true;
+	FinishEdit(OutEdit);
+	return r;
+}
+
+bool UTriangleDualMesh::RemoveRegion(FPointIndex r, FDualMeshEdit& OutEdit)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UTriangleDualMesh::RemoveRegion)
+	if (!r_interior(r))
+	{
+		return false;
+	}
+	FTriangleIndex spareA;
+	FTriangleIndex spareB;
+	if (!DetachRegion(r, spareA, spareB, OutEdit))
+	{
+		return false;
+	}
+
+	// The last solid region takes the freed slot
+	OutEdit.DirtyRegions.Remove(r);
+	const FPointIndex last = NumSolidRegions - 1;
+	if (r != last)
+	{
+		const FSideIndex s0 = _r_in_s[last];
+		FSideIndex incoming = s0;
+		do
+		{
+			Mesh.DelaunayTriangles[s_next_s(incoming)] = r;
+			incoming = _halfedges[s_next_s(incoming)];
+		}
+		while (incoming != s0);
+		SetRegionPosition(r, r_pos(last));
+		_r_in_s[r] = _r_in_s[last];
+		OutEdit.MovedRegions.Add(TPair<FPointIndex, FPointIndex>(last, r));
+		for (FPointIndex& dirty : OutEdit.DirtyRegions)
+		{
+			if (dirty == last)
+			{
+				dirty = r;
+			}
+		}
+	}
+
+	// The last two solid triangles take the freed slots, unless they are the freed ones
+	const FTriangleIndex tail = NumSolidTriangles - 2;
+	TArray<FTriangleIndex, TInlineAllocator<2>> targets;
+	TArray<FTriangleIndex, TInlineAllocator<2>> sources;
+	for (const FTriangleIndex spare : {spareA, spareB})
+	{
+		if (spare < tail)
+		{
+			targets.Add(spare);
+		}
+	}
+	for (const FTriangleIndex t : {tail, FTriangleIndex(tail + 1)})
+	{
+		if (t != spareA && t != spareB)
+		{
+			sources.Add(t);
+		}
+	}
+	for (int32 i = 0; i < sources.Num(); i++)
+	{
+		MoveTriangleSlot(sources[i], targets[i]);
+		OutEdit.MovedTriangles.Add(TPair<FTriangleIndex, FTriangleIndex>(sources[i], targets[i]));
+		for (FTriangleIndex& dirty : OutEdit.DirtyTriangles)
+		{
+			if (dirty == sources[i])
+			{
+				dirty = targets[i];
+			}
+		}
+	}
+	OutEdit.DirtyTriangles.RemoveAll([tail](const FTriangleIndex t) { return t >= tail; });
+
+	ShrinkSolidStorage();
+	OutEdit.bGhostsRenumbered = true;
+	FinishEdit(OutEdit);
+	return true;
+}
+
+FVector2D UTriangleDualMesh::GetSize() const
+{
+	return Mesh.MaxSize;
+}
+
+
+TArray<FVector2D>& UTriangleDualMesh::GetPoints()
+{
+	return _r_vertex;
+}
+
+TArray<FVector2D>& UTriangleDualMesh::GetTriangleCentroids()
+{
+	return _t_vertex;
+}
+
+const TArray<FVector2f>& UTriangleDualMesh::GetCompactPoints() const
+{
+	return _r_vertex_compact;
+}
+
+const TArray<FVector2f>& UTriangleDualMesh::GetCompactTriangleCentroids() const
+{
+	return _t_vertex_compact;
+}
+
+TArray<FSideIndex>& UTriangleDualMesh::GetHalfEdges()
+{
+	return _halfedges;
+}
+
+TArray<FDelaunayTriangle>& UTriangleDualMesh::GetTriangles()
+{
+	if (_triangles.Num() != NumTriangles)
+	{
+		_triangles.SetNum(NumTriangles);
+		for (FTriangleIndex t = 0; t < NumTriangles; t++)
+		{
+			_triangles[t] = t_triangle(t);
+		}
+	}
+	return _triangles;
+}
+
+FDualMesh& UTriangleDualMesh::GetRawMesh()
+{
+	return Mesh;
+}
+
+FPointIndex UTriangleDualMesh::PointInRegion(const FVector2D& Point) const
+{
+	const FPointIndex ClosestRegionIndex = ClosestRegion(Point);
+	if (!ClosestRegionIndex.IsValid())
+	{
+		return FPointIndex();
+	}
+	TArray<FPointIndex> NearRegions;
 	NearRegions.Empty(6);
 	NearRegions.Append(r_circulate_r(ClosestRegionIndex));
 	FPointIndex TargetRegion;
@@ -474,18 +1721,104 @@ FPointIndex UTriangleDualMesh::PointInRegion(const FVector2D& Point) const
 
 FPointIndex UTriangleDualMesh::ClosestRegion(const FVector2D& Point) const
 {
-	int32 ClosestRegion = -1;
-	double ClosestDistSquared = DBL_MAX;
-	for (int32 RegionIndex = 0; RegionIndex < _r_vertex.Num(); ++RegionIndex)
+	EnsureRegionGrid();
+	const int32 ClosestRegion = bCompactPositions
+		? RegionGrid.FindClosest(_r_vertex_compact, Point)
+		: RegionGrid.FindClosest(_r_vertex, Point);
+	return ClosestRegion == INDEX_NONE ? FPointIndex() : FPointIndex(ClosestRegion);
+}
+
+TArray<FPointIndex> UTriangleDualMesh::ClosestRegions(TArrayView<const FVector2D> Points) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UTriangleDualMesh::ClosestRegions)
+	EnsureRegionGrid();
+	TArray<FPointIndex> Regions;
+	Regions.SetNum(Points.Num());
+	ParallelFor(Points.Num(), [this, &Points, &Regions](const int32 Index)
+	{
+		const int32 ClosestRegion = bCompactPositions
+			? RegionGrid.FindClosest(_r_vertex_compact, Points[Index])
+			: RegionGrid.FindClosest(_r_vertex, Points[Index]);
+		Regions[Index] = ClosestRegion == INDEX_NONE ? FPointIndex() : FPointIndex(ClosestRegion);
+	});
+	return Regions;
+}
+
+void UTriangleDualMesh::SerializeMeshData(FArchive& Ar)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UTriangleDualMesh::SerializeMeshData)
+	using namespace DualMeshArchive;
+	SerializeArray(Ar, Mesh.Coordinates);
+	SerializeArray(Ar, Mesh.HalfEdges);
+	SerializeArray(Ar, Mesh.PointToEdge);
+	SerializeIndex(Ar, Mesh.HullStart);
+	SerializeArray(Ar, Mesh.HullTriangles);
+	SerializeArray(Ar, Mesh.HullPrevious);
+	SerializeArray(Ar, Mesh.HullNext);
+	SerializeArray(Ar, Mesh.DelaunayTriangles);
+	Ar << Mesh.MaxSize;
+	Ar << Mesh.NumSolidSides;
+
+	SerializeArray(Ar, _halfedges);
+	Ar << bCompactPositions;
+	SerializeArray(Ar, _r_vertex);
+	SerializeArray(Ar, _t_vertex);
+	SerializeArray(Ar, _r_vertex_compact);
+	SerializeArray(Ar, _t_vertex_compact);
+	SerializeArray(Ar, _r_in_s);
+	SerializeArray(Ar, _r_adjacency_offsets);
+	SerializeArray(Ar, _r_adjacent_s);
+	SerializeArray(Ar, _r_adjacent_r);
+	SerializeArray(Ar, _r_adjacent_t);
+
+	Ar << NumSides;
+	Ar << NumSolidSides;
+	Ar << NumRegions;
+	Ar << NumSolidRegions;
+	Ar << NumTriangles;
+	Ar << NumSolidTriangles;
+	Ar << NumBoundaryRegions;
+
+	if (Ar.IsLoading())
 	{
-		double Dist = FVector2D::DistSquared(_r_vertex[RegionIndex], Point);
-		if (ClosestDistSquared > Dist)
+		InvalidateRegionGrid();
+		_triangles.Empty();
+		const int32 numPositions = bCompactPositions ? _r_vertex_compact.Num() : _r_vertex.Num();
+		const int32 numCentroids = bCompactPositions ? _t_vertex_compact.Num() : _t_vertex.Num();
+		if (numPositions != NumRegions || _halfedges.Num() != NumSides || numCentroids != NumTriangles)
 		{
-			ClosestDistSquared = Dist;
-			ClosestRegion = RegionIndex;
+			UE_LOG(LogDualMesh, Error, TEXT("Loaded mesh data is inconsistent!"));
+			Ar.SetError();
 		}
 	}
-	return ClosestRegion;
+}
+
+void UTriangleDualMesh::InvalidateRegionGrid()
+{
+	FScopeLock Lock(&RegionGridLock);
+	RegionGrid.Reset();
+	bRegionGridBuilt.store(false, std::memory_order_release);
+}
+
+void UTriangleDualMesh::EnsureRegionGrid() const
+{
+	if (bRegionGridBuilt.load(std::memory_order_acquire))
+	{
+		return;
+	}
+	FScopeLock Lock(&RegionGridLock);
+	if (!bRegionGridBuilt.load(std::memory_order_relaxed))
+	{
+		if (bCompactPositions)
+		{
+			RegionGrid.Build(_r_vertex_compact);
+		}
+		else
+		{
+			RegionGrid.Build(_r_vertex);
+		}
+		bRegionGridBuilt.store(true, std::memory_order_release);
+	}
 }
 
 void UTriangleDualMesh::Draw(const AActor* WorldObject) const
@@ -505,9 +1838,9 @@ void UTriangleDualMesh::DrawDelaunayVertices(const UWorld* World) const
 {
 	// Draw delaunay vertices as red dots
 	int32 count = 0;
-	for (int r = 0; r < _r_vertex.Num(); r++)
+	for (int r = 0; r < NumRegions; r++)
 	{
-		FVector2D vertex = _r_vertex[r];
+		FVector2D vertex = r_pos(r);
 		float zCoord = r_ghost(r) ? -500.0f : 0.0f;
 		FVector vertexWorldSpace = FVector(vertex.X, vertex.Y, zCoord);
 		DrawDebugPoint(World, vertexWorldSpace, 10.0f, FColor::Red, false, 999.0f);
@@ -518,14 +1851,20 @@ void UTriangleDualMesh::DrawDelaunayVertices(const UWorld* World) const
 
 void UTriangleDualMesh::DrawVoronoiEdges(const UWorld* World) const
 {
+	ULineBatchComponent* lineBatcher = GetPersistentLineBatcher(World);
+	if (lineBatcher == nullptr)
+	{
+		return;
+	}
 	// Draw voronoi polygons as green lines
-	int32 count = 0;
+	TArray<FBatchedLine> lines;
+	lines.Reserve(_halfedges.Num() / 2);
 	for (int e = 0; e < _halfedges.Num(); e++)
 	{
 		if (e < _halfedges[e])
 		{
-			FDelaunayTriangle triangleP = UDelaunayHelper::GetTriangleFromHalfEdge(Mesh, e);
-			FDelaunayTriangle triangleQ = UDelaunayHelper::GetTriangleFromHalfEdge(Mesh, _halfedges[e]);
+			FDelaunayTriangle triangleP = t_triangle(s_to_t(e));
+			FDelaunayTriangle triangleQ = t_triangle(s_to_t(_halfedges[e]));
 			if (!triangleP.IsValid() || !triangleQ.IsValid()) // || s_ghost(e) || s_ghost(_halfedges[e]))
 			{
 				continue;
@@ -534,47 +1873,65 @@ void UTriangleDualMesh::DrawVoronoiEdges(const UWorld* World) const
 			FVector2D q = triangleQ.GetCircumcenter();
 			FVector pVector = FVector(p.X, p.Y, 0.0f);
 			FVector qVector = FVector(q.X, q.Y, 0.0f);
-			UE_LOG(LogDualMesh, Log, TEXT("Voronoi edge: (%f, %f) -> (%f, %f)"), pVector.X, pVector.Y, qVector.X,
-			       qVector.Y);
-			DrawDebugLine(World, pVector, qVector, FColor::Green, false, 999.0f);
-			count++;
+			lines.Emplace(pVector, qVector, FLinearColor(FColor::Green), 999.0f, 0.0f, SDPG_World);
 		}
 	}
-	UE_LOG(LogDualMesh, Log, TEXT("Drew %d voronoi edges."), count);
+	lineBatcher->DrawLines(lines);
+	UE_LOG(LogDualMesh, Log, TEXT("Drew %d voronoi edges."), lines.Num());
 }
 
 void UTriangleDualMesh::DrawDelaunayEdges(const UWorld* World) const
 {
+	ULineBatchComponent* lineBatcher = GetPersistentLineBatcher(World);
+	if (lineBatcher == nullptr)
+	{
+		return;
+	}
+	const FLinearColor color = FColor::Magenta;
+	const float arrowSize = 10.0f;
 	int32 count = 0;
+	// The edge and the two lines of its arrow head
+	TArray<FBatchedLine> lines;
+	lines.Reserve(3 * (_halfedges.Num() / 2));
 	for (FSideIndex e = 0; e < _halfedges.Num(); e++)
 	{
 		if (e < _halfedges[e])
 		{
 			FPointIndex pIndex = UDelaunayHelper::GetPointIndexFromHalfEdge(Mesh, e);
 			FPointIndex qIndex = UDelaunayHelper::GetPointIndexFromHalfEdge(Mesh, UDelaunayHelper::NextHalfEdge(e));
-			const FVector2D p = _r_vertex[pIndex];
-			const FVector2D q = _r_vertex[qIndex];
+			const FVector2D p = r_pos(pIndex);
+			const FVector2D q = r_pos(qIndex);
 			float pZCoord = r_ghost(pIndex) ? -1000.0f : 0.0f;
 			float qZCoord = r_ghost(qIndex) ? -1000.0f : 0.0f;
 			FVector pVector = FVector(p.X, p.Y, pZCoord);
 			FVector qVector = FVector(q.X, q.Y, qZCoord);
-			DrawDebugDirectionalArrow(World, pVector, qVector, 10.0f, FColor::Magenta, false, 999.0f);
+			const FVector direction = (qVector - pVector).GetSafeNormal();
+			FVector side = FVector::CrossProduct(direction, FVector::UpVector).GetSafeNormal();
+			if (side.IsNearlyZero())
+			{
+				side = FVector::RightVector;
+			}
+			const FVector arrowBase = qVector - direction * arrowSize;
+			lines.Emplace(pVector, qVector, color, 999.0f, 0.0f, SDPG_World);
+			lines.Emplace(qVector, arrowBase + side * arrowSize, color, 999.0f, 0.0f, SDPG_World);
+			lines.Emplace(qVector, arrowBase - side * arrowSize, color, 999.0f, 0.0f, SDPG_World);
 			count++;
 		}
 	}
+	lineBatcher->DrawLines(lines);
 	UE_LOG(LogDualMesh, Log, TEXT("Drew %d delaunay edges."), count);
 }
 
 void UTriangleDualMesh::DrawVoronoiPoints(const UWorld* World) const
 {
 	int32 count = 0;
-	for (FTriangleIndex t = 0; t < _triangles.Num(); t++)
+	for (FTriangleIndex t = 0; t < NumTriangles; t++)
 	{
 		if (t_ghost(t))
 		{
 			continue;
 		}
-		FDelaunayTriangle triangle = _triangles[t];
+		FDelaunayTriangle triangle = t_triangle(t);
 		FVector2D vertex = triangle.GetCircumcenter();
 		FVector vertexWorldSpace = FVector(vertex.X, vertex.Y, 0.0f);
 		DrawDebugPoint(World, vertexWorldSpace, 10.0f, FColor::Blue, false, 999.0f);
@@ -0,0 +1,43 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Raw array serialization for the mesh and map caches.
+ * Element bytes are written as they are in memory, so these archives only round trip on the same platform.
+ */
+namespace DualMeshArchive
+{
+	/** Element types must be plain values (index wrappers, vectors, scalars) without owned memory. */
+	template <typename T, typename AllocatorType>
+	void SerializeArray(FArchive& Ar, TArray<T, AllocatorType>& Array)
+	{
+		static_assert(TIsTriviallyDestructible<T>::Value, "Only plain value arrays can be serialized in bulk");
+		int32 Num = Array.Num();
+		Ar << Num;
+		if (Ar.IsLoading())
+		{
+			if (Num < 0)
+			{
+				Ar.SetError();
+				return;
+			}
+			Array.SetNumUninitialized(Num);
+		}
+		if (Num > 0)
+		{
+			Ar.Serialize(Array.GetData(), static_cast<int64>(Num) * sizeof(T));
+		}
+	}
+
+	/** Index wrappers hold a SIZE_T, which is stored as 64 bits everywhere. */
+	template <typename IndexType>
+	void SerializeIndex(FArchive& Ar, IndexType& Index)
+	{
+		uint64 Value = Index.Value;
+		Ar << Value;
+		Index.Value = Value;
+	}
+}
@@ -41,6 +41,7 @@ protected:
 	TArray<FVector2D> Points;
 	int32 NumBoundaryRegions;
 	FVector2D MaxMeshSize;
+	EDelaunayTriangulator Triangulator;
 
 protected:
 	TArray<FVector2D> AddBoundaryPoints(int32 Spacing, const FVector2D& Size);
@@ -55,6 +56,19 @@ public:
 	TArray<FVector2D> GetBoundaryPoints() const;
 	void ClearNonBoundaryPoints();
 	void AddPoisson(FRandomStream& Rng, FVector2D MapOffset = FVector2D(0.0f, 0.0f), float Spacing = 1.0f, int32 MaxStepSamples = 30);
+	void AddTiledPoisson(FRandomStream& Rng, FVector2D MapOffset = FVector2D(0.0f, 0.0f), float Spacing = 1.0f, int32 MaxStepSamples = 30, int32 TileCells = 64);
+	// Which triangulation Create uses, automatic by default. Kept by Initialize.
+	void SetTriangulator(EDelaunayTriangulator NewTriangulator);
 
-	UTriangleDualMesh* Create();
+	// bSortSpatially numbers the boundary regions, the other regions and the solid triangles each along a Hilbert
+	// curve, so neighbors sit close together in every per-element array. Changes the numbering, not the mesh.
+	UTriangleDualMesh* Create(bool bSortSpatially = false);
+	// Same as Create but rebuilds an existing mesh, so it can run where no UObject may be created.
+	bool CreateInto(UTriangleDualMesh* Mesh, bool bSortSpatially = false) const;
+
+	// A regular grid over the size passed to Initialize, see FDualMesh. Skips the triangulation, so the added
+	// points and the boundary spacing are ignored; the outer ring of the grid becomes the boundary regions.
+	UTriangleDualMesh* CreateGrid(int32 Columns, int32 Rows, bool bHexagonal, bool bSortSpatially = false);
+	bool CreateGridInto(UTriangleDualMesh* Mesh, int32 Columns, int32 Rows, bool bHexagonal,
+	                    bool bSortSpatially = false) const;
 };
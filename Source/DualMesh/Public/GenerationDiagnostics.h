@@ -0,0 +1,75 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/ParallelFor.h"
+
+/**
+ * Counts the problems a generation runs into by category and keeps the first few element indices of each, so loops
+ * over every element report them once per generation instead of logging every element. Thread safe.
+ * Code without a collector at hand reports to the active one of its thread, see FGenerationDiagnosticsScope.
+ * Worker threads do not see it, so ParallelFor bodies that may report run through ParallelForWithDiagnostics.
+ */
+class DUALMESH_API FGenerationDiagnostics
+{
+public:
+	static constexpr int32 MaxSamples = 4;
+
+	struct FCategory
+	{
+		// Categories are compared by pointer, they are meant to be string literals
+		const TCHAR* Name = nullptr;
+		int64 Count = 0;
+		TArray<int64, TInlineAllocator<MaxSamples>> Samples;
+	};
+
+	/** Counts one occurrence of Category, Index is kept as a sample while there are fewer than MaxSamples. */
+	void Add(const TCHAR* Category, int64 Index = INDEX_NONE);
+
+	void Reset();
+
+	/** Replaces every category with those of Other, for results that were generated elsewhere. */
+	void Assign(const FGenerationDiagnostics& Other);
+
+	bool IsEmpty() const;
+
+	int64 GetCount(const TCHAR* Category) const;
+
+	/** A copy of every category in the order they were first reported. */
+	TArray<FCategory> GetCategories() const;
+
+	/** The collector of the scope this thread is in, nullptr outside of one. */
+	static FGenerationDiagnostics* GetActive();
+
+	/** Adds to the active collector. False without one, the caller should then log the element itself. */
+	static bool AddActive(const TCHAR* Category, int64 Index = INDEX_NONE);
+
+private:
+	mutable FCriticalSection Lock;
+	TArray<FCategory> Categories;
+};
+
+/** Makes a collector the active one of this thread until the scope ends, nullptr keeps the current one. */
+struct DUALMESH_API FGenerationDiagnosticsScope
+{
+	explicit FGenerationDiagnosticsScope(FGenerationDiagnostics* Diagnostics);
+	~FGenerationDiagnosticsScope();
+
+	UE_NONCOPYABLE(FGenerationDiagnosticsScope)
+
+private:
+	FGenerationDiagnostics* Previous;
+};
+
+/** ParallelFor whose bodies report to the collector that is active on the calling thread. */
+template <typename BodyType>
+void ParallelForWithDiagnostics(const int32 Num, BodyType&& Body, const EParallelForFlags Flags = EParallelForFlags::None)
+{
+	FGenerationDiagnostics* const Diagnostics = FGenerationDiagnostics::GetActive();
+	ParallelFor(Num, [Diagnostics, &Body](const int32 Index)
+	{
+		FGenerationDiagnosticsScope Scope(Diagnostics);
+		Body(Index);
+	}, Flags);
+}
@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Math/RandomStream.h"
+
+/**
+ * Counter-based random numbers. Every value is a hash of the seed, a stream and an element index, so a stage can
+ * draw them in any order and on any number of threads and still produce the same island.
+ * Use the element a draw is for (a region, a triangle, ...) as the index, and a substream for every further draw
+ * the same element needs.
+ */
+struct FCounterRandom
+{
+	FCounterRandom() = default;
+
+	explicit FCounterRandom(const int32 Seed, const uint32 Stream = 0)
+		: Key(Mix((static_cast<uint64>(static_cast<uint32>(Seed)) << 32) | Stream))
+	{
+	}
+
+	// Takes the next seed of Stream, which moves on as if it had produced one number.
+	explicit FCounterRandom(FRandomStream& Stream)
+		: FCounterRandom(Stream.GetCurrentSeed())
+	{
+		Stream.GetUnsignedInt();
+	}
+
+	// An independent sequence with the same seed, e.g. one per chunk or per pass of a stage.
+	FCounterRandom Substream(const uint32 Stream) const
+	{
+		FCounterRandom substream;
+		substream.Key = Mix(Key ^ (static_cast<uint64>(Stream) + 0x9E3779B97F4A7C15ull));
+		return substream;
+	}
+
+	uint32 GetUnsignedInt(const uint64 Index) const
+	{
+		return static_cast<uint32>(Mix(Key + Index * 0x9E3779B97F4A7C15ull) >> 32);
+	}
+
+	// In [0, 1).
+	float GetFraction(const uint64 Index) const
+	{
+		return static_cast<float>(GetUnsignedInt(Index) >> 8) * (1.0f / 16777216.0f);
+	}
+
+	// In [Min, Max], like FRandomStream::RandRange.
+	int32 RandRange(const uint64 Index, const int32 Min, const int32 Max) const
+	{
+		const uint64 range = static_cast<uint64>(static_cast<int64>(Max) - Min) + 1;
+		return Max > Min ? static_cast<int32>(Min + static_cast<int64>((GetUnsignedInt(Index) * range) >> 32)) : Min;
+	}
+
+	float FRandRange(const uint64 Index, const float Min, const float Max) const
+	{
+		return Min + (Max - Min) * GetFraction(Index);
+	}
+
+private:
+	// The SplitMix64 finalizer, every input bit affects every output bit.
+	static uint64 Mix(uint64 Value)
+	{
+		Value = (Value ^ (Value >> 30)) * 0xBF58476D1CE4E5B9ull;
+		Value = (Value ^ (Value >> 27)) * 0x94D049BB133111EBull;
+		return Value ^ (Value >> 31);
+	}
+
+	uint64 Key = 0;
+};
@@ -43,6 +43,21 @@ public:
 	UFUNCTION(BlueprintCallable, BlueprintPure, meta = (DisplayName = "Distribute in 2D (Poisson Disc)"), Category = "Procedural Generation|Random Sampling|Distribution")
 	static void Distribute2D(TArray<FVector2D>& Samples, int32 Seed = 0, FVector2D Size = FVector2D(1.0, 1.0), FVector2D StartLocation = FVector2D(0.0f, 0.0f), float MinimumDistance = 1.0f, int32 MaxStepSamples = 30, bool WrapX = false, bool WrapY = false);
 
+	/**
+	* Generate samples using a PoissonDisc distribution in 2D space, filling square tiles of the grid in parallel.
+	* Tiles are processed in four phases so that no two concurrent tiles can see each other's samples,
+	* and every tile first grows the samples its finished neighbors left along the shared border.
+	* The output only depends on the seed and the tile size, never on the number of worker threads.
+	* @param Samples - Returned TArray of FVector2D containing the sample positions.
+	* @param Seed - Seed used for generation of samples.
+	* @param Size - Size of area to generate samples in.
+	* @param MininumDistance - Minimum distance between samples.
+	* @param MaxStepSamples - Maximum samples to generate each step.
+	* @param TileCells - Width of a tile in grid cells, each cell is MinimumDistance / sqrt(2) wide.
+	*/
+	UFUNCTION(BlueprintCallable, BlueprintPure, meta = (DisplayName = "Distribute in 2D (Tiled Poisson Disc)"), Category = "Procedural Generation|Random Sampling|Distribution")
+	static void DistributeTiled2D(TArray<FVector2D>& Samples, int32 Seed = 0, FVector2D Size = FVector2D(1.0, 1.0), FVector2D StartLocation = FVector2D(0.0f, 0.0f), float MinimumDistance = 1.0f, int32 MaxStepSamples = 30, int32 TileCells = 64);
+
 	/**
 	* Generate samples using a PoissonDisc distribution in 3D space.
 	* @param Samples - Returned TArray of FVector containing the sample positions.
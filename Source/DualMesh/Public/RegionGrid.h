@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Uniform grid over a set of points, used for nearest region center queries.
+ * The grid only stores indices, queries take the same point array it was built from.
+ */
+struct DUALMESH_API FRegionGrid
+{
+	void Build(const TArray<FVector2D>& Points);
+	void Build(const TArray<FVector2f>& Points);
+
+	void Reset();
+
+	bool IsEmpty() const
+	{
+		return CellOffsets.IsEmpty();
+	}
+
+	/** Same result as a linear scan for the lowest index at the smallest distance, or INDEX_NONE if empty. */
+	int32 FindClosest(const TArray<FVector2D>& Points, const FVector2D& Point) const;
+	int32 FindClosest(const TArray<FVector2f>& Points, const FVector2D& Point) const;
+
+	SIZE_T GetAllocatedSize() const
+	{
+		return CellOffsets.GetAllocatedSize() + CellPoints.GetAllocatedSize();
+	}
+
+protected:
+	template <typename PointType>
+	void BuildFrom(const TArray<PointType>& Points);
+	template <typename PointType>
+	int32 FindClosestIn(const TArray<PointType>& Points, const FVector2D& Point) const;
+
+	FORCEINLINE int32 CellIndex(const int32 CellX, const int32 CellY) const
+	{
+		return CellY * CellCount.X + CellX;
+	}
+
+	FORCEINLINE FIntPoint ClampedCellOf(const FVector2D& Point) const
+	{
+		return FIntPoint(FMath::Clamp(FMath::FloorToInt32((Point.X - Origin.X) / CellSize), 0, CellCount.X - 1),
+		                 FMath::Clamp(FMath::FloorToInt32((Point.Y - Origin.Y) / CellSize), 0, CellCount.Y - 1));
+	}
+
+	FVector2D Origin = FVector2D::ZeroVector;
+	double CellSize = 1.;
+	FIntPoint CellCount = FIntPoint::ZeroValue;
+	/** Offsets into CellPoints, one entry per cell plus a terminator. */
+	TArray<int32> CellOffsets;
+	TArray<int32> CellPoints;
+};
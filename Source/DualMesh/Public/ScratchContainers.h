@@ -0,0 +1,28 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/MemStack.h"
+
+/**
+ * Containers for temporaries that die with the function building them. They allocate from the memory stack of the
+ * calling thread, whose pages are pooled, so a generation does not go through malloc for them once warmed up.
+ * Open an FMemMark before the first container and keep it alive longer than all of them:
+ *
+ *     FMemMark mark(FMemStack::Get());
+ *     TScratchSet<FTriangleIndex> visited;
+ *
+ * Never return them or store them past the mark. Each thread has its own stack, so tasks open their own marks.
+ */
+using FScratchAllocator = TMemStackAllocator<>;
+using FScratchSetAllocator = TSetAllocator<TSparseArrayAllocator<FScratchAllocator, FScratchAllocator>, FScratchAllocator>;
+
+template <typename ElementType>
+using TScratchArray = TArray<ElementType, FScratchAllocator>;
+
+template <typename ElementType>
+using TScratchSet = TSet<ElementType, DefaultKeyFuncs<ElementType>, FScratchSetAllocator>;
+
+template <typename KeyType, typename ValueType>
+using TScratchMap = TMap<KeyType, ValueType, FScratchSetAllocator>;
@@ -0,0 +1,70 @@
+// Copyright 2018 Schemepunk Studios
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Dom/JsonObject.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonSerializer.h"
+
+/**
+ * Shared by the benchmark automation tests of the DualMesh and PolygonalMapGenerator modules, so all of them write
+ * Saved/Benchmarks/<Benchmark>_<Size>.json in the same layout and reports of two commits compare entry by entry.
+ * Only include it from test headers, the including module needs the Json module.
+ */
+namespace BenchmarkReport
+{
+	constexpr int32 Repetitions = 5;
+
+	/** Runs Func a few times and describes the fastest and the median run, Func returns something derived from its work. */
+	template <typename FuncType>
+	TSharedRef<FJsonObject> Measure(const TCHAR* Name, const int32 ItemNum, FuncType&& Func)
+	{
+		TArray<double> seconds;
+		double checksum = 0.;
+		for (int32 i = 0; i < Repetitions; i++)
+		{
+			const double start = FPlatformTime::Seconds();
+			checksum += static_cast<double>(Func());
+			seconds.Add(FPlatformTime::Seconds() - start);
+		}
+		seconds.Sort();
+		const TSharedRef<FJsonObject> result = MakeShared<FJsonObject>();
+		result->SetStringField(TEXT("name"), Name);
+		result->SetNumberField(TEXT("items"), ItemNum);
+		result->SetNumberField(TEXT("minSeconds"), seconds[0]);
+		result->SetNumberField(TEXT("medianSeconds"), seconds[Repetitions / 2]);
+		result->SetNumberField(TEXT("nanosecondsPerItem"), seconds[0] * 1e9 / FMath::Max(ItemNum, 1));
+		// Keeps the work observable, and differs between commits only if the results did
+		result->SetNumberField(TEXT("checksum"), checksum / Repetitions);
+		return result;
+	}
+
+	/** Starts the report of one benchmark run, Size is the test command the run was started with. */
+	inline TSharedRef<FJsonObject> Create(const TCHAR* Benchmark, const FString& Size)
+	{
+		const TSharedRef<FJsonObject> report = MakeShared<FJsonObject>();
+		report->SetStringField(TEXT("benchmark"), Benchmark);
+		report->SetStringField(TEXT("size"), Size);
+		return report;
+	}
+
+	/** Writes a report started by Create to Saved/Benchmarks and tells Test where it went, or that it could not. */
+	inline bool Save(FAutomationTestBase& Test, const TSharedRef<FJsonObject>& Report)
+	{
+		FString json;
+		FJsonSerializer::Serialize(Report, TJsonWriterFactory<>::Create(&json));
+		const FString path = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Benchmarks"),
+		                                     FString::Printf(TEXT("%s_%s.json"), *Report->GetStringField(TEXT("benchmark")),
+		                                                     *Report->GetStringField(TEXT("size"))));
+		if (!FFileHelper::SaveStringToFile(json, *path))
+		{
+			Test.AddError(FString::Printf(TEXT("Could not write %s."), *path));
+			return false;
+		}
+		Test.AddInfo(FString::Printf(TEXT("Wrote %s."), *path));
+		return true;
+	}
+}
@@ -21,8 +21,12 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Containers/StaticArray.h"
 #include "UObject/NoExportTypes.h"
 #include "Delaunator/Public/DelaunayHelper.h"
+#include "GenerationDiagnostics.h"
+#include "RegionGrid.h"
+#include <atomic>
 #include "TriangleDualMesh.generated.h"
 
 USTRUCT(BlueprintType)
@@ -43,9 +47,47 @@ public:
 		MaxSize = FVector2D::ZeroVector;
 	}
 
-	FDualMesh(const TArray<FVector2D>& GivenPoints, const FVector2D& MaxMapSize);
+	// bSortTriangles numbers the solid triangles along a Hilbert curve instead of in triangulation order
+	FDualMesh(const TArray<FVector2D>& GivenPoints, const FVector2D& MaxMapSize, bool bSortTriangles = false,
+	          EDelaunayTriangulator Triangulator = EDelaunayTriangulator::DT_Delaunator);
+
+	// A regular grid of Columns by Rows points spanning MaxMapSize, triangulated directly instead of by Delaunator.
+	// Hexagonal grids shift every odd row by half a column, so their triangles are close to equilateral.
+	// The outer ring of points comes first, see GridBoundaryRegionNum, the other points follow row by row.
+	FDualMesh(int32 Columns, int32 Rows, const FVector2D& MaxMapSize, bool bHexagonal, bool bSortTriangles = false);
+
+	// Distance of Point along a Hilbert curve filling MaxMapSize, points close to each other get close values.
+	static uint32 HilbertIndex(const FVector2D& Point, const FVector2D& MaxMapSize);
+	// Points on the outer ring of a Columns by Rows grid.
+	static int32 GridBoundaryRegionNum(int32 Columns, int32 Rows);
 private:
+	void SortTrianglesSpatially();
 	void AddGhostStructure();
+	// Pairs every side with the side running the other way between the same regions, or none on the hull.
+	void LinkHalfEdges();
+};
+
+/**
+* What the local edits of a UTriangleDualMesh changed, in the numbering after the edit.
+* Edits add to it, so one FDualMeshEdit can collect a batch of edits; Reset it between batches.
+*
+* AddRegion appends the region right before the ghost region and two triangles right before the ghost triangles,
+* so the ghost region and every ghost triangle move up. RemoveRegion moves the last solid region into the freed
+* region slot and the last solid triangles into the two freed triangle slots, then the ghost elements move down.
+*/
+struct DUALMESH_API FDualMeshEdit
+{
+	// Solid regions whose position or neighbors changed, sorted.
+	TArray<FPointIndex> DirtyRegions;
+	// Solid triangles whose corners changed, sorted.
+	TArray<FTriangleIndex> DirtyTriangles;
+	// Old and new index of the solid elements RemoveRegion renumbered, in the order it moved them.
+	TArray<TPair<FPointIndex, FPointIndex>> MovedRegions;
+	TArray<TPair<FTriangleIndex, FTriangleIndex>> MovedTriangles;
+	// Set once regions were added or removed, the ghost region and the ghost triangles have new indices.
+	bool bGhostsRenumbered = false;
+
+	void Reset();
 };
 
 /**
@@ -87,14 +129,62 @@ class DUALMESH_API UTriangleDualMesh : public UObject
 
 protected:
 	TArray<FSideIndex> _halfedges;
+	// Only filled by GetTriangles, t_triangle derives the same triangle from the indices.
 	TArray<FDelaunayTriangle> _triangles;
 	TArray<FVector2D> _r_vertex;
 	TArray<FVector2D> _t_vertex;
-	TMap<FPointIndex, FSideIndex> _r_in_s;
+	// Replace _r_vertex, _t_vertex and the raw coordinates once CompactPositions has been called.
+	TArray<FVector2f> _r_vertex_compact;
+	TArray<FVector2f> _t_vertex_compact;
+	bool bCompactPositions = false;
+	// One incoming side per region, invalid if the region has none.
+	TArray<FSideIndex> _r_in_s;
+
+	// Optional compressed rows of the region circulators, see BuildAdjacency.
+	// All three tables share the same row offsets.
+	TArray<int32> _r_adjacency_offsets;
+	TArray<FSideIndex> _r_adjacent_s;
+	TArray<FPointIndex> _r_adjacent_r;
+	TArray<FTriangleIndex> _r_adjacent_t;
+
+	// Grid over _r_vertex for the region queries, built on first use.
+	mutable FRegionGrid RegionGrid;
+	mutable std::atomic<bool> bRegionGridBuilt = false;
+	mutable FCriticalSection RegionGridLock;
+	void EnsureRegionGrid() const;
+
+	// Where the circulators report regions without sides, see SetDiagnostics
+	std::atomic<FGenerationDiagnostics*> Diagnostics = nullptr;
+	void ReportMissingRegion(FPointIndex r) const;
+
+	// Building blocks of the local edits, they keep _halfedges, the raw mesh and _r_in_s in sync.
+	bool r_interior(FPointIndex r) const;
+	bool LocateTriangle(const FVector2D& Point, FTriangleIndex Start, FTriangleIndex& OutTriangle,
+	                    FSideIndex& OutOnSide) const;
+	bool CanInsertAt(const FVector2D& Point, FTriangleIndex Start, FPointIndex Ignore, FTriangleIndex& OutTriangle,
+	                 FSideIndex& OutOnSide) const;
+	void SetRegionPosition(FPointIndex r, const FVector2D& Position);
+	void SetTriangle(FTriangleIndex t, FPointIndex a, FPointIndex b, FPointIndex c, FDualMeshEdit& OutEdit);
+	void LinkSides(FSideIndex a, FSideIndex b);
+	void FlipSide(FSideIndex a, FDualMeshEdit& OutEdit);
+	void Legalize(TArray<FSideIndex>& Sides, FDualMeshEdit& OutEdit);
+	void InsertIntoTriangles(FPointIndex r, FTriangleIndex t, FSideIndex OnSide, FTriangleIndex SpareA,
+	                         FTriangleIndex SpareB, FDualMeshEdit& OutEdit);
+	bool DetachRegion(FPointIndex r, FTriangleIndex& OutSpareA, FTriangleIndex& OutSpareB, FDualMeshEdit& OutEdit);
+	void MoveTriangleSlot(FTriangleIndex From, FTriangleIndex To);
+	void GrowSolidStorage();
+	void ShrinkSolidStorage();
+	void FinishEdit(FDualMeshEdit& OutEdit);
 
 	FDualMesh Mesh;
 
 public:
+	// Problems found while the mesh is used go to Diagnostics instead of the log, nullptr logs them again
+	void SetDiagnostics(FGenerationDiagnostics* InDiagnostics)
+	{
+		Diagnostics = InDiagnostics;
+	}
+
 	int32 NumSides;
 	int32 NumSolidSides;
 	int32 NumRegions;
@@ -119,6 +209,8 @@ public:
 
 	FVector2D r_pos(FPointIndex r) const;
 	FVector2D t_pos(FTriangleIndex t) const;
+	// The corners of a triangle, built from the side indices.
+	FDelaunayTriangle t_triangle(FTriangleIndex t) const;
 
 	FPointIndex s_begin_r(FSideIndex s) const;
 	FPointIndex s_end_r(FSideIndex s) const;
@@ -128,14 +220,46 @@ public:
 
 	FSideIndex s_opposite_s(FSideIndex s) const;
 
-	TArray<FSideIndex> t_circulate_s(FTriangleIndex t) const;
-	TArray<FPointIndex> t_circulate_r(FTriangleIndex t) const;
-	TArray<FTriangleIndex> t_circulate_t(FTriangleIndex t) const;
+	TStaticArray<FSideIndex, 3> t_circulate_s(FTriangleIndex t) const;
+	TStaticArray<FPointIndex, 3> t_circulate_r(FTriangleIndex t) const;
+	TStaticArray<FTriangleIndex, 3> t_circulate_t(FTriangleIndex t) const;
 
 	TArray<FSideIndex> r_circulate_s(FPointIndex r) const;
 	TArray<FPointIndex> r_circulate_r(FPointIndex r) const;
 	TArray<FTriangleIndex> r_circulate_t(FPointIndex r) const;
 
+	// Visit the same elements in the same order as the overloads above, without allocating.
+	void r_circulate_s(FPointIndex r, TFunctionRef<void(FSideIndex)> Visitor) const;
+	void r_circulate_r(FPointIndex r, TFunctionRef<void(FPointIndex)> Visitor) const;
+	void r_circulate_t(FPointIndex r, TFunctionRef<void(FTriangleIndex)> Visitor) const;
+
+	// Flattens the region circulators into contiguous tables. Once built, r_circulate_* read from them
+	// instead of walking the half-edges. Costs roughly three indices per side.
+	void BuildAdjacency();
+	void ResetAdjacency();
+	bool HasAdjacency() const;
+	SIZE_T GetAdjacencyAllocatedSize() const;
+	// Every table of the mesh, including the raw triangulation, the adjacency and the region grid.
+	SIZE_T GetAllocatedSize() const;
+	// Region and triangle positions, of the mesh and of the raw triangulation.
+	SIZE_T GetPointsAllocatedSize() const;
+	// Half-edges, triangles and the other connectivity tables, without the adjacency.
+	SIZE_T GetTopologyAllocatedSize() const;
+	SIZE_T GetRegionGridAllocatedSize() const;
+	// What GetAllocatedSize will about return for a mesh of NumRegions regions.
+	static SIZE_T EstimateAllocatedSize(int32 NumRegions, bool bWithAdjacency, bool bWithCompactPositions = false);
+
+	// Moves the region and triangle positions to single precision and drops the raw triangulation's copy of the
+	// region positions, which roughly quarters the memory of the positions. GetPoints, GetTriangleCentroids and the
+	// raw coordinates are empty afterwards, r_pos and t_pos keep working. InitializeMesh goes back to full precision.
+	void CompactPositions();
+	bool HasCompactPositions() const;
+
+	// Rows of the adjacency tables, empty if BuildAdjacency has not been called.
+	TArrayView<const FSideIndex> r_adjacent_s(FPointIndex r) const;
+	TArrayView<const FPointIndex> r_adjacent_r(FPointIndex r) const;
+	TArrayView<const FTriangleIndex> r_adjacent_t(FPointIndex r) const;
+
 	FPointIndex ghost_r() const;
 	bool s_ghost(FSideIndex s) const;
 	bool r_ghost(FPointIndex r) const;
@@ -145,16 +269,37 @@ public:
 	bool r_boundary(FPointIndex r) const;
 
 	void InitializeMesh(const FDualMesh& Input, int32 BoundaryRegions);
+
+	// Local edits that keep the triangulation Delaunay by flipping the sides around the edited region, instead of
+	// triangulating every region again. Only regions off the hull can be moved or removed and positions have to
+	// stay inside the hull, apart from an existing region; otherwise nothing changes and the edit fails.
+	// Adjacency tables are rebuilt if present and the region grid is rebuilt on the next query. The raw
+	// triangulation's PointToEdge and hull tables keep describing the mesh as it was built.
+	bool MoveRegion(FPointIndex r, const FVector2D& Position, FDualMeshEdit& OutEdit);
+	// Returns the new region, NumSolidRegions - 1 after the edit, or an invalid index.
+	FPointIndex AddRegion(const FVector2D& Position, FDualMeshEdit& OutEdit);
+	bool RemoveRegion(FPointIndex r, FDualMeshEdit& OutEdit);
+
+	// Writes or reads the complete mesh including the derived tables, so loading skips InitializeMesh.
+	void SerializeMeshData(FArchive& Ar);
 	FVector2D GetSize() const;
 
+	// Empty once CompactPositions has been called, see GetCompactPoints.
 	TArray<FVector2D>& GetPoints();
 	TArray<FVector2D>& GetTriangleCentroids();
+	const TArray<FVector2f>& GetCompactPoints() const;
+	const TArray<FVector2f>& GetCompactTriangleCentroids() const;
 	TArray<FSideIndex>& GetHalfEdges();
+	// Builds every triangle on the first call and keeps them until the next InitializeMesh.
 	TArray<FDelaunayTriangle>& GetTriangles();
 	FDualMesh& GetRawMesh();
 
 	FPointIndex PointInRegion(const FVector2D& Point) const;
 	FPointIndex ClosestRegion(const FVector2D& Point) const;
+	// ClosestRegion for every point, in parallel.
+	TArray<FPointIndex> ClosestRegions(TArrayView<const FVector2D> Points) const;
+	// Call after moving region centers through GetPoints so the next query rebuilds the grid.
+	void InvalidateRegionGrid();
 
 	void Draw(const AActor* WorldObject) const;
 	void Draw(const UWorld* World) const;
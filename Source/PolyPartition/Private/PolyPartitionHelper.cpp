@@ -2,14 +2,18 @@
 
 #include "PolyPartitionLib.h"
 
-TPPLPartition UPolyPartitionHelper::PolyPartition = TPPLPartition();
-
-void UPolyPartitionHelper::Triangulate(const TArray<FVector2D>& Points, const TArray<int32>& PointId,
-                                       TArray<FPolyTriangle2D>& Triangles)
+void UPolyPartitionHelper::Triangulate(TPPLPolyList& Polys, TArray<FPolyTriangle2D>& Triangles,
+                                       const EPolyTriangulationMethod Method)
 {
-	TPPLPoly Poly = MakePoly(Points, PointId);
+	// TPPLPartition keeps no state between calls, a local instance keeps concurrent calls apart
+	TPPLPartition PolyPartition;
 	TPPLPolyList PolyTriangles;
-	PolyPartition.Triangulate_EC(&Poly, &PolyTriangles);
+	if (Method != EPolyTriangulationMethod::PTM_Monotone || !PolyPartition.Triangulate_MONO(&Polys, &PolyTriangles))
+	{
+		PolyTriangles.clear();
+		PolyPartition.Triangulate_EC(&Polys, &PolyTriangles);
+	}
+	Triangles.Reserve(Triangles.Num() + PolyTriangles.size());
 	for (TPPLPolyList::iterator TriIt = PolyTriangles.begin(); TriIt != PolyTriangles.end(); ++TriIt)
 	{
 		const TPPLPoly& Tri = *TriIt;
@@ -20,23 +24,23 @@ void UPolyPartitionHelper::Triangulate(const TArray<FVector2D>& Points, const TA
 	}
 }
 
+void UPolyPartitionHelper::Triangulate(const TArray<FVector2D>& Points, const TArray<int32>& PointId,
+                                       TArray<FPolyTriangle2D>& Triangles, const EPolyTriangulationMethod Method)
+{
+	TPPLPolyList Polys;
+	Polys.push_back(MakePoly(Points, PointId));
+	Triangulate(Polys, Triangles, Method);
+}
+
 void UPolyPartitionHelper::TriangulateWithHole(const TArray<FVector2D>& Points, const TArray<int32>& PointId,
                                                const TArray<FVector2D>& HolePoints, const TArray<int32>& HolePointId,
-                                               TArray<FPolyTriangle2D>& Triangles)
+                                               TArray<FPolyTriangle2D>& Triangles,
+                                               const EPolyTriangulationMethod Method)
 {
 	TPPLPolyList Polys;
 	Polys.push_back(MakePoly(Points, PointId));
 	Polys.push_back(MakePoly(HolePoints, HolePointId, true));
-	TPPLPolyList PolyTriangles;
-	PolyPartition.Triangulate_EC(&Polys, &PolyTriangles);
-	for (TPPLPolyList::iterator TriIt = PolyTriangles.begin(); TriIt != PolyTriangles.end(); ++TriIt)
-	{
-		const TPPLPoly& Tri = *TriIt;
-		const TPPLPoint& V0 = Tri.GetPoint(0);
-		const TPPLPoint& V1 = Tri.GetPoint(1);
-		const TPPLPoint& V2 = Tri.GetPoint(2);
-		Triangles.Add(FPolyTriangle2D(V0, V0.id, V1, V1.id, V2, V2.id));
-	}
+	Triangulate(Polys, Triangles, Method);
 }
 
 TPPLPoly UPolyPartitionHelper::MakePoly(const TArray<FVector2D>& Points, const TArray<int32>& PointId, bool bIsHole)
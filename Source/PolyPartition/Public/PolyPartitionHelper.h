@@ -9,6 +9,15 @@
 #include "PolyPartitionLib.h"
 #include "PolyPartitionHelper.generated.h"
 
+UENUM(BlueprintType)
+enum class EPolyTriangulationMethod : uint8
+{
+	// Ear clipping, O(n^2)
+	PTM_EarClipping UMETA(DisplayName="Ear Clipping"),
+	// Monotone partition, O(n log n). Falls back to ear clipping if the polygon cannot be partitioned
+	PTM_Monotone UMETA(DisplayName="Monotone"),
+};
+
 USTRUCT(BlueprintType)
 struct FPolyTriangle2D
 {
@@ -34,18 +43,21 @@ class POLYPARTITION_API UPolyPartitionHelper : public UBlueprintFunctionLibrary
 	GENERATED_BODY()
 
 protected:
-	static TPPLPartition PolyPartition;
+	static void Triangulate(TPPLPolyList& Polys, TArray<FPolyTriangle2D>& Triangles, EPolyTriangulationMethod Method);
 
 public:
+	// Appends the triangles to Triangles. Safe to call from several threads at once.
 	UFUNCTION(BlueprintCallable, Category = "Procedural Generation|PolyPartition")
 	static void Triangulate(const TArray<FVector2D>& Points, const TArray<int32>& PointId,
-	                        TArray<FPolyTriangle2D>& Triangles);
+	                        TArray<FPolyTriangle2D>& Triangles,
+	                        EPolyTriangulationMethod Method = EPolyTriangulationMethod::PTM_EarClipping);
 
 	UFUNCTION(BlueprintCallable, Category = "Procedural Generation|PolyPartition")
 	static void TriangulateWithHole(
 		const TArray<FVector2D>& Points, const TArray<int32>& PointId,
 		const TArray<FVector2D>& HolePoints, const TArray<int32>& HolePointId,
-		TArray<FPolyTriangle2D>& Triangles
+		TArray<FPolyTriangle2D>& Triangles,
+		EPolyTriangulationMethod Method = EPolyTriangulationMethod::PTM_EarClipping
 	);
 
 	static TPPLPoly MakePoly(const TArray<FVector2D>& Points, const TArray<int32>& PointId, bool bIsHole = false);
@@ -46,9 +46,16 @@ public class PolygonalMapGenerator : ModuleRules
 			new string[]
 			{
 				"CoreUObject",
+				"DynamicMesh",
 				"Engine",
+				"Json",
+				"MeshConversion",
+				"MeshDescription",
+				"PolygonalMapGeneratorShaders",
+				"Projects",
 				"Slate",
-				"SlateCore"
+				"SlateCore",
+				"StaticMeshDescription"
 				// ... add private dependencies that you statically link with here ...	
 			}
 			);
@@ -61,6 +68,8 @@ public class PolygonalMapGenerator : ModuleRules
 			}
 			);
 			
+		AddEngineThirdPartyPrivateStaticDependencies(ROTargetRules, "zlib");
+
 		PrivateDefinitions.Add("CANVAS_ITY_IMPLEMENTATION");
 	}
 }
@@ -0,0 +1,171 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Biomes/BiomeLookupTable.h"
+
+#include "Algo/BinarySearch.h"
+#include "Algo/Unique.h"
+#include "Engine/DataTable.h"
+#include "GenerationDiagnostics.h"
+#include "PolygonalMapGenerator.h"
+
+const TCHAR* const FBiomeLookupTable::AmbiguousBiomeCategory = TEXT("Several biomes matched a region");
+
+namespace
+{
+	constexpr int32 ClassNum = 8;
+	/** Tables with more cells than this per class resolve through the filter cascade instead. */
+	constexpr int32 MaxCellsPerClass = 1 << 16;
+
+	void AddBreaks(TArray<float>& Breaks)
+	{
+		// Zero always gets its own bucket, GetBiome treats a zero value and a zero lower bound specially.
+		Breaks.Add(0.f);
+		Breaks.Sort();
+		Breaks.SetNum(Algo::Unique(Breaks));
+	}
+
+	/** Any value inside the bucket, the upper bound itself or something past the last bound. */
+	float BucketValue(const TArray<float>& Breaks, const int32 Bucket)
+	{
+		return Bucket < Breaks.Num() ? Breaks[Bucket] : Breaks.Last() + 1.f;
+	}
+}
+
+void FBiomeLookupTable::Build(const UDataTable* BiomeData)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FBiomeLookupTable::Build)
+	Reset();
+	if (BiomeData == nullptr)
+	{
+		return;
+	}
+	for (const TPair<FName, uint8*>& Row : BiomeData->GetRowMap())
+	{
+		check(Row.Value != nullptr);
+		const FBiomeData& Biome = *reinterpret_cast<const FBiomeData*>(Row.Value);
+		Biomes.Add(Biome);
+		MoistureBreaks.Add(Biome.MinMoisture);
+		MoistureBreaks.Add(Biome.MaxMoisture);
+		TemperatureBreaks.Add(Biome.MinTemperature);
+		TemperatureBreaks.Add(Biome.MaxTemperature);
+	}
+	AddBreaks(MoistureBreaks);
+	AddBreaks(TemperatureBreaks);
+
+	const int32 MoistureBuckets = MoistureBreaks.Num() + 1;
+	const int32 TemperatureBuckets = TemperatureBreaks.Num() + 1;
+	if (MoistureBuckets * TemperatureBuckets > MaxCellsPerClass || Biomes.Num() > TNumericLimits<int16>::Max())
+	{
+		return;
+	}
+	Cells.SetNumUninitialized(ClassNum * MoistureBuckets * TemperatureBuckets);
+	AmbiguousCells.Init(false, Cells.Num());
+	int32 Cell = 0;
+	for (int32 Class = 0; Class < ClassNum; ++Class)
+	{
+		for (int32 TemperatureBucket = 0; TemperatureBucket < TemperatureBuckets; ++TemperatureBucket)
+		{
+			const float Temperature = BucketValue(TemperatureBreaks, TemperatureBucket);
+			for (int32 MoistureBucket = 0; MoistureBucket < MoistureBuckets; ++MoistureBucket)
+			{
+				bool bAmbiguous = false;
+				Cells[Cell] = static_cast<int16>(Evaluate((Class & 4) != 0, (Class & 2) != 0, (Class & 1) != 0,
+				                                          Temperature, BucketValue(MoistureBreaks, MoistureBucket),
+				                                          bAmbiguous));
+				AmbiguousCells[Cell++] = bAmbiguous;
+			}
+		}
+	}
+}
+
+void FBiomeLookupTable::Reset()
+{
+	Biomes.Reset();
+	MoistureBreaks.Reset();
+	TemperatureBreaks.Reset();
+	Cells.Reset();
+	AmbiguousCells.Reset();
+}
+
+int32 FBiomeLookupTable::Resolve(const bool bIsOcean, const bool bIsWater, const bool bIsCoast, float Temperature,
+                                 float Moisture, const int64 Region) const
+{
+	Moisture = FMath::Clamp(Moisture, 0.0f, 1.0f);
+	Temperature = FMath::Clamp(Temperature, 0.0f, 1.0f);
+	if (Cells.IsEmpty())
+	{
+		bool bAmbiguous = false;
+		const int32 Result = Evaluate(bIsOcean, bIsWater, bIsCoast, Temperature, Moisture, bAmbiguous);
+		if (bAmbiguous)
+		{
+			ReportAmbiguous(Temperature, Moisture, Region);
+		}
+		return Result;
+	}
+	const int32 MoistureBuckets = MoistureBreaks.Num() + 1;
+	const int32 TemperatureBuckets = TemperatureBreaks.Num() + 1;
+	const int32 Cell = (ClassIndex(bIsOcean, bIsWater, bIsCoast) * TemperatureBuckets
+		+ FindBucket(TemperatureBreaks, Temperature)) * MoistureBuckets + FindBucket(MoistureBreaks, Moisture);
+	if (AmbiguousCells[Cell])
+	{
+		ReportAmbiguous(Temperature, Moisture, Region);
+	}
+	return Cells[Cell];
+}
+
+void FBiomeLookupTable::ReportAmbiguous(const float Temperature, const float Moisture, const int64 Region)
+{
+	if (!FGenerationDiagnostics::AddActive(AmbiguousBiomeCategory, Region))
+	{
+		UE_LOG(LogMapGen, Warning, TEXT("Several biomes matched temperature %f and moisture %f."), Temperature,
+		       Moisture);
+	}
+}
+
+int32 FBiomeLookupTable::Evaluate(const bool bIsOcean, const bool bIsWater, const bool bIsCoast,
+                                  const float Temperature, const float Moisture, bool& bOutAmbiguous) const
+{
+	bOutAmbiguous = false;
+	// Same stages as GetBiome: every stage narrows the candidates, a single survivor wins immediately.
+	TArray<int32, TInlineAllocator<32>> Candidates;
+	for (int32 Index = 0; Index < Biomes.Num(); ++Index)
+	{
+		Candidates.Add(Index);
+	}
+	auto Narrow = [this, &Candidates](auto&& Predicate, int32& OutResult)
+	{
+		Candidates.RemoveAll([this, &Predicate](const int32 Index) { return !Predicate(Biomes[Index]); });
+		if (Candidates.Num() <= 1)
+		{
+			OutResult = Candidates.IsEmpty() ? INDEX_NONE : Candidates[0];
+			return true;
+		}
+		return false;
+	};
+
+	int32 Result = INDEX_NONE;
+	if (Narrow([bIsOcean](const FBiomeData& Biome) { return Biome.bIsOcean == bIsOcean; }, Result)
+		|| Narrow([bIsWater](const FBiomeData& Biome) { return Biome.bIsWater == bIsWater; }, Result)
+		|| Narrow([bIsCoast](const FBiomeData& Biome) { return Biome.bIsCoast == bIsCoast; }, Result)
+		|| Narrow([Moisture](const FBiomeData& Biome)
+		{
+			return (Biome.MinMoisture < Moisture || Biome.MinMoisture == 0.0f && Moisture == 0.0f)
+				&& Biome.MaxMoisture >= Moisture;
+		}, Result)
+		|| Narrow([Temperature](const FBiomeData& Biome)
+		{
+			return (Biome.MinTemperature < Temperature || Biome.MinTemperature == 0.0f && Temperature == 0.0f)
+				&& Biome.MaxTemperature >= Temperature;
+		}, Result))
+	{
+		return Result;
+	}
+	// Several candidates left, GetBiome takes the first row
+	bOutAmbiguous = true;
+	return Candidates[0];
+}
+
+int32 FBiomeLookupTable::FindBucket(const TArray<float>& Breaks, const float Value)
+{
+	return Algo::LowerBound(Breaks, Value);
+}
@@ -17,32 +17,27 @@
 */
 
 #include "Biomes/IslandBiome.h"
+#include "Biomes/BiomeLookupTable.h"
+#include "PolygonalMapGenerator.h"
 
 void UIslandBiome::AssignCoast_Implementation(TArray<bool>& r_coast, UTriangleDualMesh* Mesh, const TArray<bool>& r_ocean) const
 {
-	r_coast.Empty(Mesh->NumRegions);
-	r_coast.SetNumZeroed(Mesh->NumRegions);
+	UIslandMapUtils::ResetLayer(r_coast, Mesh->NumRegions);
 	for (FPointIndex r1 = 0; r1 < r_coast.Num(); r1++)
 	{
 		if (!r_ocean[r1])
 		{
-			TArray<FPointIndex> out_r = Mesh->r_circulate_r(r1);
-			for (FPointIndex r2 : out_r)
+			Mesh->r_circulate_r(r1, [&r_coast, &r_ocean, r1](FPointIndex r2)
 			{
-				if (r_ocean[r2])
-				{
-					r_coast[r1] = true;
-					break;
-				}
-			}
+				r_coast[r1] |= r_ocean[r2];
+			});
 		}
 	}
 }
 
 void UIslandBiome::AssignTemperature_Implementation(TArray<float>& r_temperature, UTriangleDualMesh* Mesh, const TArray<bool>& r_ocean, const TArray<bool>& r_water, const TArray<float>& r_elevation, const TArray<float>& r_moisture, float NorthernTemperature, float SouthernTemperature) const
 {
-	r_temperature.Empty(Mesh->NumRegions);
-	r_temperature.SetNumZeroed(Mesh->NumRegions);
+	UIslandMapUtils::ResetLayer(r_temperature, Mesh->NumRegions);
 	for (FPointIndex r = 0; r < r_temperature.Num(); r++)
 	{
 		float lat = Mesh->r_y(r) / Mesh->GetSize().Y; // 0.0 - 1.0
@@ -53,25 +48,88 @@ void UIslandBiome::AssignTemperature_Implementation(TArray<float>& r_temperature
 
 void UIslandBiome::AssignBiome_Implementation(TArray<FBiomeData>& r_biome, UTriangleDualMesh* Mesh, const TArray<bool>& r_ocean, const TArray<bool>& r_water, const TArray<bool>& r_coast, const TArray<float>& r_temperature, const TArray<float>& r_moisture) const
 {
-	r_biome.Empty(Mesh->NumRegions);
-	r_biome.SetNumZeroed(Mesh->NumRegions);
+	TArray<ERegionFlags> r_flags;
+	UIslandMapUtils::PackRegionFlags(Mesh, r_water, r_ocean, r_coast, r_flags);
+	TArray<uint8> r_biome_index;
+	TArray<FBiomeData> palette;
+	AssignBiomeIndices(r_biome_index, palette, Mesh, r_flags, r_temperature, r_moisture);
+	r_biome.Empty(r_biome_index.Num());
+	for (uint8 biome : r_biome_index)
+	{
+		r_biome.Add(palette[biome]);
+	}
+}
+
+void UIslandBiome::AssignBiomeIndices(TArray<uint8>& r_biome, TArray<FBiomeData>& BiomePalette, UTriangleDualMesh* Mesh, TConstArrayView<ERegionFlags> r_flags, const TArray<float>& r_temperature, const TArray<float>& r_moisture) const
+{
+	UIslandMapUtils::ResetLayer(r_biome, Mesh->NumRegions);
+	BiomePalette.Empty();
+	BiomePalette.AddDefaulted();
+	if (BiomeData == NULL)
+	{
+		UE_LOG(LogMapGen, Error, TEXT("Passed in an empty Biome Data table! Can't determine any biomes."));
+		return;
+	}
+
+	FBiomeLookupTable lookup;
+	lookup.Build(BiomeData);
+	// Palette entry 0 is the default biome, which leaves room for 255 rows
+	const int32 maxBiomes = TNumericLimits<uint8>::Max();
+	if (lookup.GetBiomes().Num() > maxBiomes)
+	{
+		UE_LOG(LogMapGen, Error, TEXT("%s has %d biomes, only %d fit into a region biome index!"), *BiomeData->GetName(),
+		       lookup.GetBiomes().Num(), maxBiomes);
+	}
+	const int32 numBiomes = FMath::Min(lookup.GetBiomes().Num(), maxBiomes);
+	BiomePalette.Append(lookup.GetBiomes().GetData(), numBiomes);
+
+	int32 unresolved = 0;
 	for (FPointIndex r = 0; r < r_biome.Num(); r++)
 	{
-		r_biome[r] = UIslandMapUtils::GetBiome(BiomeData, r_ocean[r], r_water[r], r_coast[r], r_temperature[r], r_moisture[r]);
+		const ERegionFlags flags = r_flags[r];
+		const int32 biome = lookup.Resolve(EnumHasAnyFlags(flags, ERegionFlags::Ocean), EnumHasAnyFlags(flags, ERegionFlags::Water),
+		                                   EnumHasAnyFlags(flags, ERegionFlags::Coast), r_temperature[r], r_moisture[r], r);
+		if (biome == INDEX_NONE || biome >= numBiomes)
+		{
+			unresolved++;
+			continue;
+		}
+		r_biome[r] = static_cast<uint8>(biome + 1);
+	}
+	if (unresolved > 0)
+	{
+		UE_LOG(LogMapGen, Error, TEXT("Could not find a biome for %d regions in %s!"), unresolved, *BiomeData->GetName());
 	}
 }
 
 void UIslandBiome::assign_r_coast(TArray<bool>& r_coast, UTriangleDualMesh* Mesh, const TArray<bool>& r_ocean) const
 {
-	AssignCoast(r_coast, Mesh, r_ocean);
+	ISLAND_CALL_NATIVE_OR_EVENT(UIslandBiome, AssignCoast, r_coast, Mesh, r_ocean);
 }
 
 void UIslandBiome::assign_r_temperature(TArray<float>& r_temperature, UTriangleDualMesh* Mesh, const TArray<bool>& r_ocean, const TArray<bool>& r_water, const TArray<float>& r_elevation, const TArray<float>& r_moisture, float NorthernTemperature, float SouthernTemperature) const
 {
-	AssignTemperature(r_temperature, Mesh, r_ocean, r_water, r_elevation, r_moisture, NorthernTemperature, SouthernTemperature);
+	ISLAND_CALL_NATIVE_OR_EVENT(UIslandBiome, AssignTemperature, r_temperature, Mesh, r_ocean, r_water, r_elevation, r_moisture, NorthernTemperature, SouthernTemperature);
 }
 
 void UIslandBiome::assign_r_biome(TArray<FBiomeData>& r_biome, UTriangleDualMesh* Mesh, const TArray<bool>& r_ocean, const TArray<bool>& r_water, const TArray<bool>& r_coast, const TArray<float>& r_temperature, const TArray<float>& r_moisture) const
 {
-	AssignBiome(r_biome, Mesh, r_ocean, r_water, r_coast, r_temperature, r_moisture);
+	ISLAND_CALL_NATIVE_OR_EVENT(UIslandBiome, AssignBiome, r_biome, Mesh, r_ocean, r_water, r_coast, r_temperature, r_moisture);
+}
+
+void UIslandBiome::assign_r_biome(TArray<uint8>& r_biome, TArray<FBiomeData>& BiomePalette, UTriangleDualMesh* Mesh, TConstArrayView<ERegionFlags> r_flags, const TArray<float>& r_temperature, const TArray<float>& r_moisture) const
+{
+	if (UIslandMapUtils::IsImplementedInScript(this, GET_FUNCTION_NAME_CHECKED(UIslandBiome, AssignBiome)))
+	{
+		// Blueprint overrides take bools and only produce full biomes, so unpack before and pack afterwards
+		TArray<bool> r_ocean, r_water, r_coast;
+		UIslandMapUtils::UnpackRegionFlags(r_flags, ERegionFlags::Ocean, r_ocean);
+		UIslandMapUtils::UnpackRegionFlags(r_flags, ERegionFlags::Water, r_water);
+		UIslandMapUtils::UnpackRegionFlags(r_flags, ERegionFlags::Coast, r_coast);
+		TArray<FBiomeData> biomes;
+		AssignBiome(biomes, Mesh, r_ocean, r_water, r_coast, r_temperature, r_moisture);
+		UIslandMapUtils::PackBiomes(biomes, r_biome, BiomePalette);
+		return;
+	}
+	AssignBiomeIndices(r_biome, BiomePalette, Mesh, r_flags, r_temperature, r_moisture);
 }
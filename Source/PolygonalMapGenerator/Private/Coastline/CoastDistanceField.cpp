@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Coastline/CoastDistanceField.h"
+
+#include "Async/ParallelFor.h"
+#include "Coastline/CoastlineSpatialIndex.h"
+
+void FCoastDistanceField::Bake(const FCoastlineSpatialIndex& SpatialIndex, const FVector2D& MapSize,
+                               const int32 Resolution, const double InMaxDistance)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FCoastDistanceField::Bake)
+	Reset();
+	if (Resolution <= 0 || InMaxDistance <= 0. || MapSize.GetMin() <= 0.)
+	{
+		return;
+	}
+	MaxDistance = InMaxDistance;
+	TexelSize = MapSize.GetMax() / Resolution;
+	Size.X = FMath::CeilToInt32(MapSize.X / TexelSize) + 1;
+	Size.Y = FMath::CeilToInt32(MapSize.Y / TexelSize) + 1;
+	// Texel centers sit on multiples of TexelSize so the field reaches both map borders.
+	Origin = FVector2D(-0.5 * TexelSize);
+	Distances.SetNumUninitialized(Size.X * Size.Y);
+	ParallelFor(Size.Y, [this, &SpatialIndex](const int32 Row)
+	{
+		for (int32 Col = 0; Col < Size.X; ++Col)
+		{
+			const FVector2D Point = Origin + FVector2D(Col + 0.5, Row + 0.5) * TexelSize;
+			const double Distance = SpatialIndex.DistanceToCoast(Point, MaxDistance);
+			const double Signed = SpatialIndex.IsInside(Point) ? -Distance : Distance;
+			Distances[Row * Size.X + Col] = FFloat16(static_cast<float>(Signed / MaxDistance));
+		}
+	});
+}
+
+void FCoastDistanceField::Reset()
+{
+	Size = FIntPoint::ZeroValue;
+	MaxDistance = 0.;
+	Distances.Empty();
+}
+
+double FCoastDistanceField::Sample(const FVector2D& Point) const
+{
+	if (!IsValid())
+	{
+		return MaxDistance;
+	}
+	const double U = FMath::Clamp((Point.X - Origin.X) / TexelSize - 0.5, 0., Size.X - 1.);
+	const double V = FMath::Clamp((Point.Y - Origin.Y) / TexelSize - 0.5, 0., Size.Y - 1.);
+	const int32 X0 = FMath::Min(FMath::FloorToInt32(U), Size.X - 2);
+	const int32 Y0 = FMath::Min(FMath::FloorToInt32(V), Size.Y - 2);
+	const double FracX = U - X0;
+	const double FracY = V - Y0;
+	const FFloat16* Row0 = Distances.GetData() + Y0 * Size.X + X0;
+	const FFloat16* Row1 = Row0 + Size.X;
+	const double Top = FMath::Lerp<double>(Row0[0].GetFloat(), Row0[1].GetFloat(), FracX);
+	const double Bottom = FMath::Lerp<double>(Row1[0].GetFloat(), Row1[1].GetFloat(), FracX);
+	return FMath::Lerp(Top, Bottom, FracY) * MaxDistance;
+}
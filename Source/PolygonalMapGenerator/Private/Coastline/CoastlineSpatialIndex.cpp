@@ -0,0 +1,198 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Coastline/CoastlineSpatialIndex.h"
+
+#include "Coastline/IslandCoastline.h"
+
+namespace
+{
+	/** Upper bound of cells along one axis, keeps the grid small for sparse coastlines on big maps. */
+	constexpr int32 MaxCellsPerAxis = 512;
+}
+
+void FCoastlineSpatialIndex::Build(const TArray<FCoastlinePolygon>& Coastlines)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FCoastlineSpatialIndex::Build)
+	Reset();
+
+	FBox2D Bounds(ForceInit);
+	double TotalLength = 0.;
+	for (const FCoastlinePolygon& Coastline : Coastlines)
+	{
+		const TArray<FVector2D>& Polygon = Coastline.Positions;
+		// Same vertex pairing as UIslandMapUtils::PointInPolygon2D so the crossing math matches bit for bit.
+		for (int32 i = 0, j = Polygon.Num() - 1; i < Polygon.Num(); j = i++)
+		{
+			SegmentStarts.Emplace(Polygon[i]);
+			SegmentEnds.Emplace(Polygon[j]);
+			Bounds += Polygon[i];
+			TotalLength += FVector2D::Distance(Polygon[i], Polygon[j]);
+		}
+	}
+	const int32 SegmentNum = SegmentStarts.Num();
+	if (SegmentNum == 0)
+	{
+		return;
+	}
+
+	const FVector2D Extent = Bounds.GetSize();
+	CellSize = FMath::Max3(2. * TotalLength / SegmentNum, Extent.GetMax() / MaxCellsPerAxis, UE_KINDA_SMALL_NUMBER);
+	// One empty ring of cells around the coast guarantees the first column of every row is outside.
+	Origin = Bounds.Min - FVector2D(CellSize);
+	CellCount.X = FMath::CeilToInt32(Extent.X / CellSize) + 2;
+	CellCount.Y = FMath::CeilToInt32(Extent.Y / CellSize) + 2;
+	const int32 CellNum = CellCount.X * CellCount.Y;
+
+	// Segments touching a cell border are listed in both cells, so crossings on the border are never lost.
+	const FVector2D BorderSlack(CellSize * 1e-6);
+	auto ForEachOverlappedCell = [this, BorderSlack](const int32 Segment, auto&& Func)
+	{
+		const FIntPoint MinCell = CellOf(FVector2D::Min(SegmentStarts[Segment], SegmentEnds[Segment]) - BorderSlack);
+		const FIntPoint MaxCell = CellOf(FVector2D::Max(SegmentStarts[Segment], SegmentEnds[Segment]) + BorderSlack);
+		for (int32 CellY = FMath::Max(MinCell.Y, 0); CellY <= FMath::Min(MaxCell.Y, CellCount.Y - 1); ++CellY)
+		{
+			for (int32 CellX = FMath::Max(MinCell.X, 0); CellX <= FMath::Min(MaxCell.X, CellCount.X - 1); ++CellX)
+			{
+				Func(CellIndex(CellX, CellY));
+			}
+		}
+	};
+
+	CellOffsets.SetNumZeroed(CellNum + 1);
+	for (int32 Segment = 0; Segment < SegmentNum; ++Segment)
+	{
+		ForEachOverlappedCell(Segment, [this](const int32 Cell) { ++CellOffsets[Cell + 1]; });
+	}
+	for (int32 Cell = 0; Cell < CellNum; ++Cell)
+	{
+		CellOffsets[Cell + 1] += CellOffsets[Cell];
+	}
+	CellSegments.SetNumUninitialized(CellOffsets[CellNum]);
+	TArray<int32> Cursor(CellOffsets.GetData(), CellNum);
+	for (int32 Segment = 0; Segment < SegmentNum; ++Segment)
+	{
+		ForEachOverlappedCell(Segment, [this, &Cursor, Segment](const int32 Cell)
+		{
+			CellSegments[Cursor[Cell]++] = Segment;
+		});
+	}
+
+	// Walk every row of cell centers from the outside, flipping the state at each crossing.
+	CellCenterInside.Init(false, CellNum);
+	for (int32 CellY = 0; CellY < CellCount.Y; ++CellY)
+	{
+		const double Y = CellCenter(0, CellY).Y;
+		bool bInside = false;
+		for (int32 CellX = 0; CellX < CellCount.X; ++CellX)
+		{
+			const int32 Cell = CellIndex(CellX, CellY);
+			const double CellMinX = Origin.X + CellX * CellSize;
+			int32 Crossings = CountHorizontalCrossings(Cell, Y, CellMinX, CellCenter(CellX, CellY).X);
+			if (CellX > 0)
+			{
+				Crossings += CountHorizontalCrossings(Cell - 1, Y, CellCenter(CellX - 1, CellY).X, CellMinX);
+			}
+			bInside ^= (Crossings & 1) != 0;
+			CellCenterInside[Cell] = bInside;
+		}
+	}
+}
+
+void FCoastlineSpatialIndex::Reset()
+{
+	SegmentStarts.Reset();
+	SegmentEnds.Reset();
+	CellCount = FIntPoint::ZeroValue;
+	CellOffsets.Reset();
+	CellSegments.Reset();
+	CellCenterInside.Reset();
+}
+
+bool FCoastlineSpatialIndex::IsInside(const FVector2D& Point) const
+{
+	if (IsEmpty())
+	{
+		return false;
+	}
+	const FIntPoint Cell2D = CellOf(Point);
+	if (Cell2D.X < 0 || Cell2D.Y < 0 || Cell2D.X >= CellCount.X || Cell2D.Y >= CellCount.Y)
+	{
+		return false;
+	}
+	// Move from the cell center to the point with one horizontal and one vertical step, both inside the cell.
+	const int32 Cell = CellIndex(Cell2D.X, Cell2D.Y);
+	const FVector2D Center = CellCenter(Cell2D.X, Cell2D.Y);
+	const int32 Crossings = CountHorizontalCrossings(Cell, Center.Y, Center.X, Point.X)
+		+ CountVerticalCrossings(Cell, Point.X, Center.Y, Point.Y);
+	return CellCenterInside[Cell] != ((Crossings & 1) != 0);
+}
+
+double FCoastlineSpatialIndex::DistanceToCoast(const FVector2D& Point, const double MaxDistance) const
+{
+	if (IsEmpty())
+	{
+		return MaxDistance;
+	}
+	const FIntPoint MinCell = CellOf(Point - FVector2D(MaxDistance));
+	const FIntPoint MaxCell = CellOf(Point + FVector2D(MaxDistance));
+	double MinDistanceSquared = FMath::Square(MaxDistance);
+	for (int32 CellY = FMath::Max(MinCell.Y, 0); CellY <= FMath::Min(MaxCell.Y, CellCount.Y - 1); ++CellY)
+	{
+		for (int32 CellX = FMath::Max(MinCell.X, 0); CellX <= FMath::Min(MaxCell.X, CellCount.X - 1); ++CellX)
+		{
+			const int32 Cell = CellIndex(CellX, CellY);
+			for (int32 Offset = CellOffsets[Cell]; Offset < CellOffsets[Cell + 1]; ++Offset)
+			{
+				const int32 Segment = CellSegments[Offset];
+				const FVector2D Closest = FMath::ClosestPointOnSegment2D(Point, SegmentStarts[Segment],
+				                                                         SegmentEnds[Segment]);
+				MinDistanceSquared = FMath::Min(MinDistanceSquared, FVector2D::DistSquared(Point, Closest));
+			}
+		}
+	}
+	return FMath::Sqrt(MinDistanceSquared);
+}
+
+int32 FCoastlineSpatialIndex::CountHorizontalCrossings(const int32 Cell, const double Y, const double FromX,
+                                                       const double ToX) const
+{
+	const double MinX = FMath::Min(FromX, ToX);
+	const double MaxX = FMath::Max(FromX, ToX);
+	int32 Crossings = 0;
+	for (int32 Offset = CellOffsets[Cell]; Offset < CellOffsets[Cell + 1]; ++Offset)
+	{
+		const FVector2D& A = SegmentStarts[CellSegments[Offset]];
+		const FVector2D& B = SegmentEnds[CellSegments[Offset]];
+		if ((A.Y > Y) != (B.Y > Y))
+		{
+			const double X = (B.X - A.X) * (Y - A.Y) / (B.Y - A.Y) + A.X;
+			if (MinX < X && X <= MaxX)
+			{
+				++Crossings;
+			}
+		}
+	}
+	return Crossings;
+}
+
+int32 FCoastlineSpatialIndex::CountVerticalCrossings(const int32 Cell, const double X, const double FromY,
+                                                     const double ToY) const
+{
+	const double MinY = FMath::Min(FromY, ToY);
+	const double MaxY = FMath::Max(FromY, ToY);
+	int32 Crossings = 0;
+	for (int32 Offset = CellOffsets[Cell]; Offset < CellOffsets[Cell + 1]; ++Offset)
+	{
+		const FVector2D& A = SegmentStarts[CellSegments[Offset]];
+		const FVector2D& B = SegmentEnds[CellSegments[Offset]];
+		if ((A.X > X) != (B.X > X))
+		{
+			const double Y = (B.Y - A.Y) * (X - A.X) / (B.X - A.X) + A.Y;
+			if (MinY < Y && Y <= MaxY)
+			{
+				++Crossings;
+			}
+		}
+	}
+	return Crossings;
+}
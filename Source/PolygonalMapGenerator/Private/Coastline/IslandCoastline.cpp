@@ -2,85 +2,104 @@
 
 
 #include "Coastline/IslandCoastline.h"
+#include "Async/ParallelFor.h"
+#include "DualMeshArchive.h"
 #include "IslandMapData.h"
 #include "PolyPartitionHelper.h"
 
-void UIslandCoastline::Initialize(const UTriangleDualMesh* Mesh, TArray<bool> OceanRegions, TArray<bool> CoastRegions)
+void UIslandCoastline::Initialize(const UTriangleDualMesh* Mesh, const TArray<ERegionFlags>& RegionFlags,
+                                  TConstArrayView<float> SimplificationTolerances)
 {
-	TMap<FTriangleIndex, FRegionEdge*> BMap;
+	TRACE_CPUPROFILER_EVENT_SCOPE(UIslandCoastline::Initialize)
+	TArray<FRegionEdge> Edges;
 	for (FPointIndex PointIndex(0); PointIndex < Mesh->NumSolidRegions; ++PointIndex)
 	{
-		if (!CoastRegions[PointIndex])
+		if (!EnumHasAnyFlags(RegionFlags[PointIndex], ERegionFlags::Coast))
 		{
 			continue;
 		}
-		TArray<FSideIndex> Sides = Mesh->r_circulate_s(PointIndex);
-		for (const FSideIndex& Side : Sides)
+		Mesh->r_circulate_s(PointIndex, [&](const FSideIndex Side)
 		{
 			FPointIndex OuterRegion = Mesh->s_end_r(Side);
-			if (!OceanRegions[OuterRegion])
+			if (!EnumHasAnyFlags(RegionFlags[OuterRegion], ERegionFlags::Ocean))
 			{
-				continue;
+				return;
 			}
 			const FTriangleIndex AIndex = Mesh->s_inner_t(Side);
 			const FTriangleIndex BIndex = Mesh->s_outer_t(Side);
-			TSharedPtr<FRegionEdge> Edge = MakeShared<FRegionEdge>(
-				AIndex, Mesh->t_pos(AIndex), BIndex, Mesh->t_pos(BIndex));
-			Edges.Add(Edge);
-			BMap.Add(BIndex, Edge.Get());
-		}
+			Edges.Emplace(AIndex, Mesh->t_pos(AIndex), BIndex, Mesh->t_pos(BIndex));
+		});
 	}
 
-	for (const TSharedPtr<FRegionEdge>& Edge : Edges)
+	TArray<int32> LoopOffsets;
+	TArray<int32> LoopEdges;
+	UIslandMapUtils::ExtractBoundaryLoops(Edges, LoopOffsets, LoopEdges);
+	Coastlines.Reset();
+	Coastlines.SetNum(LoopOffsets.Num() - 1);
+	ParallelFor(Coastlines.Num(), [this, &Edges, &LoopOffsets, &LoopEdges](const int32 Loop)
 	{
-		FRegionEdge* PrevEdge = BMap.FindChecked(Edge->AIndex);
-		if (!PrevEdge->Next.IsValid())
-		{
-			PrevEdge->Next = Edge;
-		}
+		FCoastlinePolygon& Coastline = Coastlines[Loop];
+		const int32 Begin = LoopOffsets[Loop];
+		Coastline.IslandId = Edges[LoopEdges[Begin]].AIndex;
+		UIslandMapUtils::FillContour(Coastline, Edges,
+		                             TConstArrayView<int32>(LoopEdges.GetData() + Begin, LoopOffsets[Loop + 1] - Begin));
+		UIslandMapUtils::TriangulateContour(Coastline, Coastline.Triangles);
+	});
+
+	// All loops are simplified together, so that no simplified loop crosses another
+	TArray<float> Tolerances(SimplificationTolerances);
+	Tolerances.Sort();
+	TArray<const FAreaContour*> Contours;
+	for (const FCoastlinePolygon& Coastline : Coastlines)
+	{
+		Contours.Add(&Coastline);
 	}
-	TMap<FRegionEdge*, int32> IslandIdMap;
-	IslandIdMap.Empty(Edges.Num());
-	for (const TSharedPtr<FRegionEdge>& Edge : Edges)
+	TArray<FAreaContour> Simplified;
+	for (const float Tolerance : Tolerances)
 	{
-		if (IslandIdMap.Contains(Edge.Get()))
-			continue;
-		Coastlines.Add(FCoastlinePolygon());
-		FCoastlinePolygon& Coastline = Coastlines.Last();
-		Coastline.IslandId = Edge->AIndex;
-		Coastline.Begin = Edge;
-		TWeakPtr<FRegionEdge> NowEdge = Edge;
-		int32 EdgeNum = 0;
-		while (true)
+		if (Tolerance <= 0.f)
 		{
-			++EdgeNum;
-			IslandIdMap.Add(NowEdge.Pin().Get(), Edge->AIndex);
-			TWeakPtr<FRegionEdge> NextEdge = NowEdge.Pin()->Next;
-			if (NextEdge == Edge)
-			{
-				Coastline.End = NowEdge;
-				break;
-			}
-			NowEdge = NextEdge;
+			continue;
 		}
-		NowEdge = Coastline.Begin;
-		Coastline.Indices.Empty(EdgeNum);
-		Coastline.Positions.Empty(EdgeNum);
-		while (true)
+		UIslandMapUtils::SimplifyContours(Contours, Tolerance, Simplified);
+		for (int32 Loop = 0; Loop < Coastlines.Num(); ++Loop)
 		{
-			Coastline.Indices.Add(NowEdge.Pin()->AIndex);
-			Coastline.Positions.Add(NowEdge.Pin()->APosition);
-			TWeakPtr<FRegionEdge> NextEdge = NowEdge.Pin()->Next;
-			if (NextEdge == Coastline.Begin)
-				break;
-			NowEdge = NextEdge;
+			Coastlines[Loop].SimplifiedTolerances.Add(Tolerance);
+			Coastlines[Loop].SimplifiedContours.Add(MoveTemp(Simplified[Loop]));
 		}
 	}
 
-	// Triangulate
+	SpatialIndex.Build(Coastlines);
+}
+
+void UIslandCoastline::SerializeCoastlines(FArchive& Ar)
+{
+	int32 CoastlineNum = Coastlines.Num();
+	Ar << CoastlineNum;
+	if (Ar.IsLoading())
+	{
+		Coastlines.Reset();
+		Coastlines.SetNum(FMath::Max(CoastlineNum, 0));
+	}
 	for (FCoastlinePolygon& Coastline : Coastlines)
 	{
-		UIslandMapUtils::TriangulateContour(Coastline, Coastline.Triangles);
+		uint64 IslandId = Coastline.IslandId;
+		Ar << IslandId;
+		Coastline.IslandId = IslandId;
+		DualMeshArchive::SerializeArray(Ar, Coastline.Indices);
+		DualMeshArchive::SerializeArray(Ar, Coastline.Positions);
+		DualMeshArchive::SerializeArray(Ar, Coastline.Triangles);
+		DualMeshArchive::SerializeArray(Ar, Coastline.SimplifiedTolerances);
+		Coastline.SimplifiedContours.SetNum(Coastline.SimplifiedTolerances.Num());
+		for (FAreaContour& Contour : Coastline.SimplifiedContours)
+		{
+			DualMeshArchive::SerializeArray(Ar, Contour.Indices);
+			DualMeshArchive::SerializeArray(Ar, Contour.Positions);
+		}
+	}
+	if (Ar.IsLoading())
+	{
+		SpatialIndex.Build(Coastlines);
 	}
 }
 
@@ -88,3 +107,23 @@ const TArray<FCoastlinePolygon>& UIslandCoastline::GetCoastlines() const
 {
 	return Coastlines;
 }
+
+const FCoastlineSpatialIndex& UIslandCoastline::GetSpatialIndex() const
+{
+	return SpatialIndex;
+}
+
+SIZE_T UIslandCoastline::GetAllocatedSize() const
+{
+	SIZE_T Size = Coastlines.GetAllocatedSize() + SpatialIndex.GetAllocatedSize();
+	for (const FCoastlinePolygon& Coastline : Coastlines)
+	{
+		Size += Coastline.FAreaContour::GetAllocatedSize() + Coastline.Triangles.GetAllocatedSize()
+			+ Coastline.SimplifiedTolerances.GetAllocatedSize() + Coastline.SimplifiedContours.GetAllocatedSize();
+		for (const FAreaContour& Contour : Coastline.SimplifiedContours)
+		{
+			Size += Contour.GetAllocatedSize();
+		}
+	}
+	return Size;
+}
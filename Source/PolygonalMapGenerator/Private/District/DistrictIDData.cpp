@@ -0,0 +1,412 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "District/DistrictIDData.h"
+
+#include "Async/ParallelFor.h"
+#include "Engine/Texture2D.h"
+#include "Misc/ScopeLock.h"
+#include <atomic>
+
+namespace
+{
+	/** Pixels decoded by one ParallelFor task. */
+	constexpr int32 DecodeBatchSize = 16384;
+
+	/**
+	 * The four encoded channel values of both images of a pixel, district IDs as ID / 16 - 0.01.
+	 * Empty slots are padded with the lowest unused districts at zero proportion, as ResolveRows does.
+	 */
+	void EncodePixel(const FPackedPixelData& Pixel, float (&OutChannels)[8])
+	{
+		if (Pixel.DistrictIDs[0] == 0)
+		{
+			for (float& Channel : OutChannels)
+			{
+				Channel = 0.f;
+			}
+			return;
+		}
+		int32 NextPadding = 1;
+		for (int32 Slot = 0; Slot < 4; ++Slot)
+		{
+			int32 DistrictID = Pixel.DistrictIDs[Slot];
+			if (DistrictID == 0)
+			{
+				while (NextPadding == Pixel.DistrictIDs[0] || NextPadding == Pixel.DistrictIDs[1]
+					|| NextPadding == Pixel.DistrictIDs[2] || NextPadding == Pixel.DistrictIDs[3])
+				{
+					++NextPadding;
+				}
+				DistrictID = NextPadding++;
+			}
+			OutChannels[Slot * 2] = DistrictID / 16.f - 0.01f;
+			OutChannels[Slot * 2 + 1] = Pixel.Proportions[Slot] / 255.f;
+		}
+	}
+
+	template <typename PixelType, typename DecodeIDType, typename DecodeProportionType>
+	TSharedRef<FIDTextueData, ESPMode::ThreadSafe> DecodeImages(const PixelType* IDImage1, const PixelType* IDImage2,
+	                                                            const int32 Width, const int32 Height,
+	                                                            DecodeIDType DecodeID,
+	                                                            DecodeProportionType DecodeProportion)
+	{
+		const int32 PixelCount = Width * Height;
+		TSharedRef<FIDTextueData, ESPMode::ThreadSafe> Result = MakeShared<FIDTextueData, ESPMode::ThreadSafe>();
+		FIDTextueData& TextureData = Result.Get();
+		TextureData.Width = Width;
+		TextureData.Height = Height;
+		TextureData.Data.SetNum(PixelCount);
+		// Every batch writes its own pixels, a missing image leaves its two districts empty
+		auto DecodeImage = [&](const PixelType* IDImage, const int32 FirstSlot)
+		{
+			if (IDImage == nullptr)
+			{
+				return;
+			}
+			ParallelFor(FMath::DivideAndRoundUp(PixelCount, DecodeBatchSize), [&](const int32 Batch)
+			{
+				const int32 End = FMath::Min((Batch + 1) * DecodeBatchSize, PixelCount);
+				for (int32 D = Batch * DecodeBatchSize; D < End; ++D)
+				{
+					const PixelType* Pixel = IDImage + D * 4;
+					FPackedPixelData& PixelData = TextureData.Data[D];
+					PixelData.DistrictIDs[FirstSlot] = DecodeID(Pixel[0]);
+					PixelData.Proportions[FirstSlot] = DecodeProportion(Pixel[1]);
+					PixelData.DistrictIDs[FirstSlot + 1] = DecodeID(Pixel[2]);
+					PixelData.Proportions[FirstSlot + 1] = DecodeProportion(Pixel[3]);
+				}
+			});
+		};
+		DecodeImage(IDImage1, 0);
+		DecodeImage(IDImage2, 2);
+		return Result;
+	}
+
+	template <typename PixelType, typename EncodeType>
+	void EncodeImages(const FIDTextueData& Data, PixelType* IDImage1, PixelType* IDImage2, EncodeType Encode)
+	{
+		const int32 PixelCount = Data.Width * Data.Height;
+		ParallelFor(FMath::DivideAndRoundUp(PixelCount, DecodeBatchSize), [&](const int32 Batch)
+		{
+			const int32 End = FMath::Min((Batch + 1) * DecodeBatchSize, PixelCount);
+			for (int32 D = Batch * DecodeBatchSize; D < End; ++D)
+			{
+				float Channels[8];
+				EncodePixel(Data.Data[D], Channels);
+				for (int32 Channel = 0; Channel < 4; ++Channel)
+				{
+					IDImage1[D * 4 + Channel] = Encode(Channels[Channel]);
+					IDImage2[D * 4 + Channel] = Encode(Channels[Channel + 4]);
+				}
+			}
+		});
+	}
+}
+
+void FDistrictProportionBlend::Add(const FPackedPixelData& Pixel, const float Weight)
+{
+	TotalWeight += Weight;
+	for (int32 Rank = 0; Rank < 4; ++Rank)
+	{
+		if (Pixel.Proportions[Rank] == 0)
+		{
+			continue;
+		}
+		const int32 DistrictID = Pixel.DistrictIDs[Rank];
+		const float Proportion = Pixel.Proportions[Rank] / 255.f * Weight;
+		TPair<int32, float>* District = Districts.FindByPredicate([DistrictID](const TPair<int32, float>& Pair)
+		{
+			return Pair.Key == DistrictID;
+		});
+		if (District)
+		{
+			District->Value += Proportion;
+		}
+		else
+		{
+			Districts.Emplace(DistrictID, Proportion);
+		}
+	}
+}
+
+FPixelData FDistrictProportionBlend::Resolve() const
+{
+	return ResolvePacked().Unpack();
+}
+
+FPackedPixelData FDistrictProportionBlend::ResolvePacked() const
+{
+	FPackedPixelData Pixel;
+	if (TotalWeight <= 0.f)
+	{
+		return Pixel;
+	}
+	// Ties go to the lower ID so that the result does not depend on the order of the pixels
+	TArray<TPair<int32, float>, TInlineAllocator<16>> Sorted = Districts;
+	Sorted.Sort([](const TPair<int32, float>& A, const TPair<int32, float>& B)
+	{
+		return A.Value != B.Value ? A.Value > B.Value : A.Key < B.Key;
+	});
+	for (int32 Rank = 0; Rank < FMath::Min(Sorted.Num(), 4); ++Rank)
+	{
+		Pixel.DistrictIDs[Rank] = FPackedPixelData::PackDistrictID(Sorted[Rank].Key);
+		Pixel.Proportions[Rank] = FPackedPixelData::PackProportion(Sorted[Rank].Value / TotalWeight);
+	}
+	return Pixel;
+}
+
+TSharedRef<FIDTextueData, ESPMode::ThreadSafe> DistrictIDTexture::Decode(const FFloat16* FloatIDImage1,
+                                                                         const FFloat16* FloatIDImage2,
+                                                                         const int32 Width, const int32 Height)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(DistrictIDTexture::Decode)
+	return DecodeImages(FloatIDImage1, FloatIDImage2, Width, Height, [](const FFloat16 Value)
+	{
+		return FPackedPixelData::PackDistrictID(FMath::RoundHalfToEven(Value.GetFloat() * 16));
+	}, [](const FFloat16 Value)
+	{
+		return FPackedPixelData::PackProportion(Value.GetFloat());
+	});
+}
+
+TSharedRef<FIDTextueData, ESPMode::ThreadSafe> DistrictIDTexture::DecodeUnorm8(const uint8* IDImage1,
+                                                                               const uint8* IDImage2,
+                                                                               const int32 Width, const int32 Height)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(DistrictIDTexture::DecodeUnorm8)
+	return DecodeImages(IDImage1, IDImage2, Width, Height, [](const uint8 Value)
+	{
+		return FPackedPixelData::PackDistrictID(FMath::RoundHalfToEven(Value / 255.f * 16));
+	}, [](const uint8 Value)
+	{
+		return Value;
+	});
+}
+
+bool DistrictIDTexture::EncodeUnorm8(const FIDTextueData& Data, uint8* IDImage1, uint8* IDImage2)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(DistrictIDTexture::EncodeUnorm8)
+	std::atomic<bool> bClamped = false;
+	EncodeImages(Data, IDImage1, IDImage2, [&bClamped](const float Value)
+	{
+		if (Value > 1.f)
+		{
+			bClamped.store(true, std::memory_order_relaxed);
+		}
+		return static_cast<uint8>(FMath::RoundToInt32(FMath::Clamp(Value, 0.f, 1.f) * 255.f));
+	});
+	return !bClamped.load();
+}
+
+void DistrictIDTexture::EncodeFloat16(const FIDTextueData& Data, FFloat16* FloatIDImage1, FFloat16* FloatIDImage2)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(DistrictIDTexture::EncodeFloat16)
+	EncodeImages(Data, FloatIDImage1, FloatIDImage2, [](const float Value)
+	{
+		return FFloat16(Value);
+	});
+}
+
+TArray<int32> DistrictIDTexture::FindDistricts(const FIDTextueData& Data)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(DistrictIDTexture::FindDistricts)
+	const int32 PixelCount = FMath::Min(Data.Width * Data.Height, Data.Data.Num());
+	const int32 BatchNum = FMath::DivideAndRoundUp(PixelCount, DecodeBatchSize);
+	// One bit per ID and batch, merged once all batches are done
+	TArray<TBitArray<>> BatchDistricts;
+	BatchDistricts.Init(TBitArray<>(false, 256), BatchNum);
+	ParallelFor(BatchNum, [&](const int32 Batch)
+	{
+		TBitArray<>& Districts = BatchDistricts[Batch];
+		const int32 End = FMath::Min((Batch + 1) * DecodeBatchSize, PixelCount);
+		for (int32 D = Batch * DecodeBatchSize; D < End; ++D)
+		{
+			const FPackedPixelData& Pixel = Data.Data[D];
+			for (int32 Rank = 0; Rank < 4; ++Rank)
+			{
+				if (Pixel.DistrictIDs[Rank] != 0 && Pixel.Proportions[Rank] != 0)
+				{
+					Districts[Pixel.DistrictIDs[Rank]] = true;
+				}
+			}
+		}
+	});
+	TArray<int32> Result;
+	for (int32 DistrictID = 1; DistrictID < 256; ++DistrictID)
+	{
+		for (const TBitArray<>& Districts : BatchDistricts)
+		{
+			if (Districts[DistrictID])
+			{
+				Result.Add(DistrictID);
+				break;
+			}
+		}
+	}
+	return Result;
+}
+
+TSharedRef<const FIDTextueMipChain, ESPMode::ThreadSafe> DistrictIDTexture::BuildMipChain(
+	const TSharedRef<const FIDTextueData, ESPMode::ThreadSafe>& Data)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(DistrictIDTexture::BuildMipChain)
+	TSharedRef<FIDTextueMipChain, ESPMode::ThreadSafe> MipChain = MakeShared<FIDTextueMipChain, ESPMode::ThreadSafe>();
+	MipChain->Levels.Add(Data);
+	while (MipChain->Levels.Last()->Width > 1 || MipChain->Levels.Last()->Height > 1)
+	{
+		const FIDTextueData& Source = MipChain->Levels.Last().Get();
+		if (Source.Width <= 0 || Source.Height <= 0 || Source.Data.Num() < Source.Width * Source.Height)
+		{
+			break;
+		}
+		TSharedRef<FIDTextueData, ESPMode::ThreadSafe> Level = MakeShared<FIDTextueData, ESPMode::ThreadSafe>();
+		Level->Width = FMath::DivideAndRoundUp(Source.Width, 2);
+		Level->Height = FMath::DivideAndRoundUp(Source.Height, 2);
+		Level->Data.SetNum(Level->Width * Level->Height);
+		ParallelFor(Level->Height, [&Source, &Level](const int32 Y)
+		{
+			for (int32 X = 0; X < Level->Width; ++X)
+			{
+				// Odd sizes repeat the last row or column
+				FDistrictProportionBlend Blend;
+				for (int32 Offset = 0; Offset < 4; ++Offset)
+				{
+					const int32 SourceX = FMath::Min(X * 2 + (Offset & 1), Source.Width - 1);
+					const int32 SourceY = FMath::Min(Y * 2 + (Offset >> 1), Source.Height - 1);
+					Blend.Add(Source.Data[SourceX + SourceY * Source.Width], 1.f);
+				}
+				Level->Data[X + Y * Level->Width] = Blend.ResolvePacked();
+			}
+		});
+		MipChain->Levels.Add(Level);
+	}
+	return MipChain;
+}
+
+FDistrictIDDataCache& FDistrictIDDataCache::Get()
+{
+	static FDistrictIDDataCache Cache;
+	return Cache;
+}
+
+TSharedPtr<const FIDTextueData, ESPMode::ThreadSafe> FDistrictIDDataCache::Find(const UTexture2D* Texture1,
+                                                                               const UTexture2D* Texture2)
+{
+	const uint32 Revision = HashCombine(GetRevision(Texture1), GetRevision(Texture2));
+	FScopeLock ScopeLock(&Lock);
+	Entries.RemoveAll([](const FEntry& Entry) { return !Entry.Texture1.IsValid() || !Entry.Texture2.IsValid(); });
+	for (const FEntry& Entry : Entries)
+	{
+		if (Entry.Texture1.Get() == Texture1 && Entry.Texture2.Get() == Texture2 && Entry.Revision == Revision)
+		{
+			return Entry.Data;
+		}
+	}
+	return nullptr;
+}
+
+void FDistrictIDDataCache::Add(const UTexture2D* Texture1, const UTexture2D* Texture2,
+                               const TSharedRef<const FIDTextueData, ESPMode::ThreadSafe>& Data,
+                               const TSharedPtr<const FIDTextueMipChain, ESPMode::ThreadSafe>& MipChain)
+{
+	const uint32 Revision = HashCombine(GetRevision(Texture1), GetRevision(Texture2));
+	FScopeLock ScopeLock(&Lock);
+	Entries.RemoveAll([Texture1, Texture2](const FEntry& Entry)
+	{
+		return !Entry.Texture1.IsValid() || !Entry.Texture2.IsValid()
+			|| (Entry.Texture1.Get() == Texture1 && Entry.Texture2.Get() == Texture2);
+	});
+	Entries.Add({Texture1, Texture2, Revision, Data, MipChain});
+}
+
+TSharedRef<const FIDTextueData, ESPMode::ThreadSafe> FDistrictIDDataCache::FindOrDecode(const UTexture2D* Texture1,
+	const UTexture2D* Texture2)
+{
+	if (TSharedPtr<const FIDTextueData, ESPMode::ThreadSafe> Cached = Find(Texture1, Texture2))
+	{
+		return Cached.ToSharedRef();
+	}
+	const FTexturePlatformData* PlatformData1 = Texture1->GetPlatformData();
+	const FTexturePlatformData* PlatformData2 = Texture2->GetPlatformData();
+	const void* BulkData1 = PlatformData1 ? PlatformData1->Mips[0].BulkData.LockReadOnly() : nullptr;
+	const void* BulkData2 = PlatformData2 ? PlatformData2->Mips[0].BulkData.LockReadOnly() : nullptr;
+	const bool bUnorm8 = Texture1->GetPixelFormat() == PF_R8G8B8A8;
+	TSharedRef<const FIDTextueData, ESPMode::ThreadSafe> Data = bUnorm8
+		? DistrictIDTexture::DecodeUnorm8(static_cast<const uint8*>(BulkData1), static_cast<const uint8*>(BulkData2),
+		                                  Texture1->GetSizeX(), Texture1->GetSizeY())
+		: DistrictIDTexture::Decode(static_cast<const FFloat16*>(BulkData1), static_cast<const FFloat16*>(BulkData2),
+		                            Texture1->GetSizeX(), Texture1->GetSizeY());
+	if (PlatformData1)
+	{
+		PlatformData1->Mips[0].BulkData.Unlock();
+	}
+	if (PlatformData2)
+	{
+		PlatformData2->Mips[0].BulkData.Unlock();
+	}
+	Add(Texture1, Texture2, Data);
+	return Data;
+}
+
+TSharedRef<const FIDTextueMipChain, ESPMode::ThreadSafe> FDistrictIDDataCache::FindOrBuildMipChain(
+	const UTexture2D* Texture1, const UTexture2D* Texture2)
+{
+	const TSharedRef<const FIDTextueData, ESPMode::ThreadSafe> Data = FindOrDecode(Texture1, Texture2);
+	{
+		FScopeLock ScopeLock(&Lock);
+		for (const FEntry& Entry : Entries)
+		{
+			if (Entry.Data == Data && Entry.MipChain.IsValid())
+			{
+				return Entry.MipChain.ToSharedRef();
+			}
+		}
+	}
+	// Built outside of the lock, two callers racing for the same data both build it and the first one is kept
+	TSharedRef<const FIDTextueMipChain, ESPMode::ThreadSafe> MipChain = DistrictIDTexture::BuildMipChain(Data);
+	FScopeLock ScopeLock(&Lock);
+	for (FEntry& Entry : Entries)
+	{
+		if (Entry.Data == Data)
+		{
+			if (!Entry.MipChain.IsValid())
+			{
+				Entry.MipChain = MipChain;
+			}
+			return Entry.MipChain.ToSharedRef();
+		}
+	}
+	return MipChain;
+}
+
+uint32 FDistrictIDDataCache::FindOrComputeContentCrc(const UTexture2D* Texture1, const UTexture2D* Texture2)
+{
+	const TSharedRef<const FIDTextueData, ESPMode::ThreadSafe> Data = FindOrDecode(Texture1, Texture2);
+	{
+		FScopeLock ScopeLock(&Lock);
+		for (const FEntry& Entry : Entries)
+		{
+			if (Entry.Data == Data && Entry.ContentCrc.IsSet())
+			{
+				return Entry.ContentCrc.GetValue();
+			}
+		}
+	}
+	uint32 ContentCrc = FCrc::MemCrc32(&Data->Width, sizeof(Data->Width));
+	ContentCrc = FCrc::MemCrc32(&Data->Height, sizeof(Data->Height), ContentCrc);
+	ContentCrc = FCrc::MemCrc32(Data->Data.GetData(), Data->Data.NumBytes(), ContentCrc);
+	FScopeLock ScopeLock(&Lock);
+	for (FEntry& Entry : Entries)
+	{
+		if (Entry.Data == Data)
+		{
+			Entry.ContentCrc = ContentCrc;
+		}
+	}
+	return ContentCrc;
+}
+
+uint32 FDistrictIDDataCache::GetRevision(const UTexture2D* Texture)
+{
+	return HashCombine(GetTypeHash(Texture->GetLightingGuid()), PointerHash(Texture->GetPlatformData()));
+}
@@ -0,0 +1,311 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "District/DistrictIDTexture.h"
+
+namespace
+{
+	bool PrecedesCoverage(const uint8 District, const uint16 Coverage, const FDistrictCoverage& Other)
+	{
+		return Other.District == 0 || Coverage > Other.Coverage
+			|| (Coverage == Other.Coverage && District < Other.District);
+	}
+
+	/** Spreads the coverage of a district that did not fit over the kept ones, so the pixel keeps its total. */
+	void RedistributeCoverage(FDistrictCoverage* Slots, const uint16 Dropped)
+	{
+		int32 Kept = 0;
+		for (int32 Index = 0; Index < DistrictIDTexture::TopDistricts; ++Index)
+		{
+			Kept += Slots[Index].Coverage;
+		}
+		if (Kept == 0 || Dropped == 0)
+		{
+			return;
+		}
+		// One factor for every slot keeps them ordered
+		const float Scale = static_cast<float>(FMath::Min<int32>(Kept + Dropped, DistrictIDTexture::FullCoverage)) / Kept;
+		for (int32 Index = 0; Index < DistrictIDTexture::TopDistricts; ++Index)
+		{
+			Slots[Index].Coverage = static_cast<uint16>(FMath::Min<int32>(FMath::RoundToInt32(Slots[Index].Coverage * Scale),
+			                                                              DistrictIDTexture::FullCoverage));
+		}
+	}
+
+	/**
+	 * Merges a coverage sample into a pixel's slots, keeping them ordered largest first.
+	 * A district pushed out of the slots, or one that never gets in, is redistributed over the others.
+	 */
+	void InsertCoverage(FDistrictCoverage* Slots, const uint8 District, uint16 Coverage)
+	{
+		int32 Slot = DistrictIDTexture::TopDistricts - 1;
+		bool bFound = false;
+		for (int32 Index = 0; Index < DistrictIDTexture::TopDistricts; ++Index)
+		{
+			if (Slots[Index].District == District)
+			{
+				Coverage = static_cast<uint16>(FMath::Min<int32>(Slots[Index].Coverage + Coverage,
+				                                                 DistrictIDTexture::FullCoverage));
+				Slot = Index;
+				bFound = true;
+				break;
+			}
+		}
+		if (!bFound && !PrecedesCoverage(District, Coverage, Slots[Slot]))
+		{
+			RedistributeCoverage(Slots, Coverage);
+			return;
+		}
+		const uint16 Evicted = bFound ? 0 : Slots[Slot].Coverage;
+		while (Slot > 0 && PrecedesCoverage(District, Coverage, Slots[Slot - 1]))
+		{
+			Slots[Slot] = Slots[Slot - 1];
+			--Slot;
+		}
+		Slots[Slot].District = District;
+		Slots[Slot].Coverage = Coverage;
+		RedistributeCoverage(Slots, Evicted);
+	}
+
+	/**
+	 * Splits an edge where it crosses the first and last column border and moves the parts outside onto the border.
+	 * A part moved onto the border covers the same area inside the columns, which clamping the end points does not.
+	 */
+	template <typename FAccumulate>
+	void ClipEdgeToColumns(const FVector2f& P0, const FVector2f& P1, const float MaxX, FAccumulate&& Accumulate)
+	{
+		FVector2f Points[4];
+		int32 PointNum = 0;
+		Points[PointNum++] = P0;
+		float Crossings[2];
+		int32 CrossingNum = 0;
+		for (const float Border : {0.f, MaxX})
+		{
+			if ((P0.X < Border) != (P1.X < Border))
+			{
+				Crossings[CrossingNum++] = (Border - P0.X) / (P1.X - P0.X);
+			}
+		}
+		if (CrossingNum == 2 && Crossings[0] > Crossings[1])
+		{
+			Swap(Crossings[0], Crossings[1]);
+		}
+		for (int32 Index = 0; Index < CrossingNum; ++Index)
+		{
+			Points[PointNum++] = P0 + (P1 - P0) * Crossings[Index];
+		}
+		Points[PointNum++] = P1;
+		for (int32 Index = 0; Index + 1 < PointNum; ++Index)
+		{
+			FVector2f A = Points[Index];
+			FVector2f B = Points[Index + 1];
+			A.X = FMath::Clamp(A.X, 0.f, MaxX);
+			B.X = FMath::Clamp(B.X, 0.f, MaxX);
+			Accumulate(A, B);
+		}
+	}
+
+	/**
+	 * Adds the signed area of one edge to the accumulation buffer, one row at a time.
+	 * A running sum along each row then yields the exact coverage of every pixel.
+	 */
+	void AccumulateEdge(float* Accumulation, const int32 Stride, const int32 Rows, FVector2f P0, FVector2f P1)
+	{
+		if (FMath::Abs(P0.Y - P1.Y) <= UE_SMALL_NUMBER)
+		{
+			return;
+		}
+		float Direction = 1.f;
+		if (P0.Y > P1.Y)
+		{
+			Swap(P0, P1);
+			Direction = -1.f;
+		}
+		const float DxDy = (P1.X - P0.X) / (P1.Y - P0.Y);
+		const int32 RowFirst = FMath::Max(FMath::FloorToInt32(P0.Y), 0);
+		const int32 RowLast = FMath::Min(FMath::CeilToInt32(P1.Y), Rows);
+		float X = P0.X + DxDy * (FMath::Max(P0.Y, static_cast<float>(RowFirst)) - P0.Y);
+		for (int32 Row = RowFirst; Row < RowLast; ++Row)
+		{
+			const float Dy = FMath::Min(Row + 1.f, P1.Y) - FMath::Max(static_cast<float>(Row), P0.Y);
+			const float XNext = X + DxDy * Dy;
+			const float D = Dy * Direction;
+			float* Line = Accumulation + Row * Stride;
+			const float X0 = FMath::Min(X, XNext);
+			const float X1 = FMath::Max(X, XNext);
+			const float X0Floor = FMath::FloorToFloat(X0);
+			const int32 X0i = static_cast<int32>(X0Floor);
+			const float X1Ceil = FMath::CeilToFloat(X1);
+			const int32 X1i = static_cast<int32>(X1Ceil);
+			if (X1i <= X0i + 1)
+			{
+				const float XMf = 0.5f * (X + XNext) - X0Floor;
+				Line[X0i] += D - D * XMf;
+				Line[X0i + 1] += D * XMf;
+			}
+			else
+			{
+				const float S = 1.f / (X1 - X0);
+				const float X0f = X0 - X0Floor;
+				const float A0 = 0.5f * S * (1.f - X0f) * (1.f - X0f);
+				const float X1f = X1 - X1Ceil + 1.f;
+				const float Am = 0.5f * S * X1f * X1f;
+				Line[X0i] += D * A0;
+				if (X1i == X0i + 2)
+				{
+					Line[X0i + 1] += D * (1.f - A0 - Am);
+				}
+				else
+				{
+					const float A1 = S * (1.5f - X0f);
+					Line[X0i + 1] += D * (A1 - A0);
+					for (int32 Xi = X0i + 2; Xi < X1i - 1; ++Xi)
+					{
+						Line[Xi] += D * S;
+					}
+					const float A2 = A1 + (X1i - X0i - 3) * S;
+					Line[X1i - 1] += D * (1.f - A2 - Am);
+				}
+				Line[X1i] += D * Am;
+			}
+			X = XNext;
+		}
+	}
+}
+
+void DistrictIDTexture::PreparePolygons(TArray<FDistrictRasterPolygon>& OutPolygons,
+                                        const TArray<FDistrictRegion>& DistrictRegions, const FVector2D& Scale)
+{
+	OutPolygons.Empty(DistrictRegions.Num());
+	for (const FDistrictRegion& DistrictRegion : DistrictRegions)
+	{
+		if (DistrictRegion.District < 0 || DistrictRegion.District >= MaxDistricts
+			|| DistrictRegion.Positions.Num() < 3)
+		{
+			continue;
+		}
+		FDistrictRasterPolygon& Polygon = OutPolygons.Emplace_GetRef();
+		Polygon.District = static_cast<uint8>(DistrictRegion.District + 1);
+		Polygon.Points.SetNumUninitialized(DistrictRegion.Positions.Num());
+		for (int32 Index = 0; Index < DistrictRegion.Positions.Num(); ++Index)
+		{
+			Polygon.Points[Index] = FVector2f(DistrictRegion.Positions[Index] * Scale);
+			Polygon.Bounds += Polygon.Points[Index];
+		}
+	}
+}
+
+void DistrictIDTexture::RasterizeRows(TArray<FDistrictCoverage>& OutCoverage,
+                                      const TArray<FDistrictRasterPolygon>& Polygons, const int32 Width,
+                                      const int32 RowBegin, const int32 RowEnd)
+{
+	const int32 Rows = RowEnd - RowBegin;
+	OutCoverage.Reset();
+	OutCoverage.SetNumZeroed(Rows * Width * TopDistricts);
+	TArray<float> Accumulation;
+	for (const FDistrictRasterPolygon& Polygon : Polygons)
+	{
+		if (Polygon.Bounds.Max.Y <= RowBegin || Polygon.Bounds.Min.Y >= RowEnd)
+		{
+			continue;
+		}
+		const int32 MinCol = FMath::Clamp(FMath::FloorToInt32(Polygon.Bounds.Min.X), 0, Width);
+		const int32 MaxCol = FMath::Clamp(FMath::CeilToInt32(Polygon.Bounds.Max.X), 0, Width);
+		const int32 LocalWidth = MaxCol - MinCol;
+		if (LocalWidth <= 0)
+		{
+			continue;
+		}
+		// Two extra columns take the spill of edges lying on the right border.
+		const int32 Stride = LocalWidth + 2;
+		Accumulation.Reset();
+		Accumulation.SetNumZeroed(Rows * Stride);
+		const FVector2f Origin(MinCol, RowBegin);
+		const int32 PointNum = Polygon.Points.Num();
+		for (int32 Index = 0; Index < PointNum; ++Index)
+		{
+			const FVector2f P0 = Polygon.Points[Index] - Origin;
+			const FVector2f P1 = Polygon.Points[(Index + 1) % PointNum] - Origin;
+			// Only the part of the polygon inside the texture matters, so edges are clipped to its columns.
+			ClipEdgeToColumns(P0, P1, static_cast<float>(LocalWidth), [&](const FVector2f& A, const FVector2f& B)
+			{
+				AccumulateEdge(Accumulation.GetData(), Stride, Rows, A, B);
+			});
+		}
+		for (int32 Row = 0; Row < Rows; ++Row)
+		{
+			const float* Line = Accumulation.GetData() + Row * Stride;
+			FDistrictCoverage* RowCoverage = OutCoverage.GetData() + (Row * Width + MinCol) * TopDistricts;
+			float Sum = 0.f;
+			for (int32 Col = 0; Col < LocalWidth; ++Col)
+			{
+				Sum += Line[Col];
+				const int32 Coverage = FMath::RoundToInt32(FMath::Min(FMath::Abs(Sum), 1.f) * FullCoverage);
+				if (Coverage > 0)
+				{
+					InsertCoverage(RowCoverage + Col * TopDistricts, Polygon.District, static_cast<uint16>(Coverage));
+				}
+			}
+		}
+	}
+}
+
+void DistrictIDTexture::ResolveRows(const TArray<FDistrictRasterPolygon>& Polygons, const int32 Width,
+                                    const int32 RowBegin, const int32 RowEnd, FFloat16* FloatIDImageBuffer1,
+                                    FFloat16* FloatIDImageBuffer2)
+{
+	TArray<FDistrictCoverage> Coverage;
+	RasterizeRows(Coverage, Polygons, Width, RowBegin, RowEnd);
+	const int32 PixelNum = (RowEnd - RowBegin) * Width;
+	for (int32 LocalIndex = 0; LocalIndex < PixelNum; ++LocalIndex)
+	{
+		const FDistrictCoverage* Slots = Coverage.GetData() + LocalIndex * TopDistricts;
+		const int32 PixelIndex = RowBegin * Width + LocalIndex;
+		FFloat16* Pixel1 = FloatIDImageBuffer1 + PixelIndex * 4;
+		FFloat16* Pixel2 = FloatIDImageBuffer2 + PixelIndex * 4;
+		if (Slots[0].District == 0)
+		{
+			for (int32 Channel = 0; Channel < 4; ++Channel)
+			{
+				Pixel1[Channel] = FFloat16(0.f);
+				Pixel2[Channel] = FFloat16(0.f);
+			}
+			continue;
+		}
+		// Empty slots are padded with the lowest unused districts at zero proportion, as the full sort did.
+		int32 Districts[TopDistricts];
+		float Proportions[TopDistricts];
+		int32 NextPadding = 1;
+		for (int32 Slot = 0; Slot < TopDistricts; ++Slot)
+		{
+			if (Slots[Slot].District != 0)
+			{
+				Districts[Slot] = Slots[Slot].District;
+				Proportions[Slot] = static_cast<float>(Slots[Slot].Coverage) / FullCoverage;
+				continue;
+			}
+			auto IsUsed = [Slots](const int32 District)
+			{
+				for (int32 Index = 0; Index < TopDistricts; ++Index)
+				{
+					if (Slots[Index].District == District)
+						return true;
+				}
+				return false;
+			};
+			while (IsUsed(NextPadding))
+			{
+				++NextPadding;
+			}
+			Districts[Slot] = NextPadding++;
+			Proportions[Slot] = 0.f;
+		}
+		Pixel1[0] = FFloat16(Districts[0] / 16.f - 0.01f);
+		Pixel1[1] = FFloat16(Proportions[0]);
+		Pixel1[2] = FFloat16(Districts[1] / 16.f - 0.01f);
+		Pixel1[3] = FFloat16(Proportions[1]);
+		Pixel2[0] = FFloat16(Districts[2] / 16.f - 0.01f);
+		Pixel2[1] = FFloat16(Proportions[2]);
+		Pixel2[2] = FFloat16(Districts[3] / 16.f - 0.01f);
+		Pixel2[3] = FFloat16(Proportions[3]);
+	}
+}
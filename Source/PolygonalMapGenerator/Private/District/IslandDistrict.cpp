@@ -1,91 +1,268 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "District/IslandDistrict.h"
+#include "Async/ParallelFor.h"
+#include "GenerationDiagnostics.h"
 #include "TriangleDualMesh.h"
 #include "DelaunayHelper.h"
+#include "RegionGrid.h"
+#include "ScratchContainers.h"
+
+namespace
+{
+	// Frontier entries per task of the district growth
+	constexpr int32 FrontierBatchSize = 256;
+
+	// Set while AssignRegionDistricts runs, the base AssignDistrict keeps the district of every region in it
+	thread_local TArray<int32>* RegionDistrictsSink = nullptr;
+
+	bool IsPointInTriangle(const FVector2D& Point, const FPolyTriangle2D& Triangle)
+	{
+		const double D0 = FVector2D::CrossProduct(Triangle.V1 - Triangle.V0, Point - Triangle.V0);
+		const double D1 = FVector2D::CrossProduct(Triangle.V2 - Triangle.V1, Point - Triangle.V1);
+		const double D2 = FVector2D::CrossProduct(Triangle.V0 - Triangle.V2, Point - Triangle.V2);
+		// Either winding
+		return (D0 >= 0 && D1 >= 0 && D2 >= 0) || (D0 <= 0 && D1 <= 0 && D2 <= 0);
+	}
+
+	struct FRegionDistrict
+	{
+		int32 DistrictIndex;
+		FPointIndex RegionIndex;
+		FRegionDistrict() = default;
+
+		FRegionDistrict(const int32& DI, const FPointIndex& RI) : DistrictIndex(DI), RegionIndex(RI)
+		{
+		}
+	};
+
+	/**
+	 * Grows the districts from Frontier one ring at a time, in parallel. A region goes to the earliest frontier
+	 * entry next to it that may claim it, and the next ring is ordered by claiming entry, then by neighbour order.
+	 * That is exactly what a single FIFO queue would do, so the result never depends on thread scheduling.
+	 */
+	void GrowDistricts(TArray<int32>& DistrictRegions, const UTriangleDualMesh* Mesh, TArray<FRegionDistrict> Frontier,
+	                   TFunctionRef<bool(FPointIndex, int32)> CanClaim)
+	{
+		// Lowest frontier position that wants each region in the current ring
+		TArray<int32> Claims;
+		Claims.Init(MAX_int32, DistrictRegions.Num());
+		TArray<TArray<FRegionDistrict>> BatchFrontiers;
+		while (!Frontier.IsEmpty())
+		{
+			const int32 BatchNum = FMath::DivideAndRoundUp(Frontier.Num(), FrontierBatchSize);
+			ParallelForWithDiagnostics(BatchNum, [&](const int32 Batch)
+			{
+				const int32 End = FMath::Min((Batch + 1) * FrontierBatchSize, Frontier.Num());
+				for (int32 Position = Batch * FrontierBatchSize; Position < End; ++Position)
+				{
+					const FRegionDistrict& Entry = Frontier[Position];
+					Mesh->r_circulate_r(Entry.RegionIndex, [&](const FPointIndex RegionIndex)
+					{
+						if (DistrictRegions[RegionIndex] != -1 || !CanClaim(RegionIndex, Entry.DistrictIndex))
+						{
+							return;
+						}
+						int32 Current = FPlatformAtomics::AtomicRead(&Claims[RegionIndex]);
+						while (Position < Current)
+						{
+							const int32 Previous = FPlatformAtomics::InterlockedCompareExchange(
+								&Claims[RegionIndex], Position, Current);
+							if (Previous == Current)
+							{
+								break;
+							}
+							Current = Previous;
+						}
+					});
+				}
+			});
+
+			// Only the winning entry touches a claimed region from here on
+			BatchFrontiers.SetNum(BatchNum);
+			ParallelForWithDiagnostics(BatchNum, [&](const int32 Batch)
+			{
+				TArray<FRegionDistrict>& BatchFrontier = BatchFrontiers[Batch];
+				BatchFrontier.Reset();
+				const int32 End = FMath::Min((Batch + 1) * FrontierBatchSize, Frontier.Num());
+				for (int32 Position = Batch * FrontierBatchSize; Position < End; ++Position)
+				{
+					const FRegionDistrict& Entry = Frontier[Position];
+					Mesh->r_circulate_r(Entry.RegionIndex, [&](const FPointIndex RegionIndex)
+					{
+						if (FPlatformAtomics::AtomicRead(&Claims[RegionIndex]) != Position)
+						{
+							return;
+						}
+						FPlatformAtomics::AtomicStore(&Claims[RegionIndex], MAX_int32);
+						DistrictRegions[RegionIndex] = Entry.DistrictIndex;
+						BatchFrontier.Emplace(Entry.DistrictIndex, RegionIndex);
+					});
+				}
+			});
+
+			Frontier.Reset();
+			for (const TArray<FRegionDistrict>& BatchFrontier : BatchFrontiers)
+			{
+				Frontier.Append(BatchFrontier);
+			}
+		}
+	}
+}
 
 void UIslandDistrict::AssignDistrict(TArray<FDistrictRegion>& DistrictRegions, UTriangleDualMesh* Mesh,
                                      const TArray<bool>& OceanRegions, FRandomStream& Rng) const
 {
-	TArray<FPointIndex> DistrictStarts;
-	ScatterDistrictStarts(DistrictStarts, Mesh, OceanRegions, Rng);
 	TArray<int32> RegionDistricts;
-	FillDistricts(RegionDistricts, Mesh, DistrictStarts, OceanRegions);
-	TMap<int32, TMap<FTriangleIndex, TSharedPtr<FRegionEdge>>> DistrictInfos;
-	for (int32 RegionIndex = 0; RegionIndex < RegionDistricts.Num(); ++RegionIndex)
+	TArray<int32>& Target = RegionDistrictsSink != nullptr ? *RegionDistrictsSink : RegionDistricts;
+	TGuardValue<TArray<int32>*> SinkGuard(RegionDistrictsSink, nullptr);
+	BuildDistricts(DistrictRegions, Target, Mesh, OceanRegions, Rng);
+}
+
+void UIslandDistrict::AssignRegionDistricts(TArray<FDistrictRegion>& DistrictRegions, TArray<int32>& RegionDistricts,
+                                            UTriangleDualMesh* Mesh, const TArray<bool>& OceanRegions,
+                                            FRandomStream& Rng) const
+{
+	RegionDistricts.Reset();
 	{
-		int32 District = RegionDistricts[RegionIndex];
-		if (District == -1)
+		TGuardValue<TArray<int32>*> SinkGuard(RegionDistrictsSink, &RegionDistricts);
+		AssignDistrict(DistrictRegions, Mesh, OceanRegions, Rng);
+	}
+	if (RegionDistricts.Num() != OceanRegions.Num())
+	{
+		// The override of AssignDistrict did not call its parent
+		LocateRegionDistricts(RegionDistricts, DistrictRegions, Mesh, OceanRegions);
+	}
+}
+
+void UIslandDistrict::LocateRegionDistricts(TArray<int32>& RegionDistricts,
+                                            const TArray<FDistrictRegion>& DistrictRegions,
+                                            const UTriangleDualMesh* Mesh, const TArray<bool>& OceanRegions)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UIslandDistrict::LocateRegionDistricts)
+	RegionDistricts.Init(-1, OceanRegions.Num());
+	TArray<FBox2D> Bounds;
+	Bounds.Reserve(DistrictRegions.Num());
+	for (const FDistrictRegion& DistrictRegion : DistrictRegions)
+	{
+		FBox2D& DistrictBounds = Bounds.Emplace_GetRef(ForceInit);
+		for (const FPolyTriangle2D& Triangle : DistrictRegion.Triangles)
 		{
-			continue;
+			DistrictBounds += Triangle.V0;
+			DistrictBounds += Triangle.V1;
+			DistrictBounds += Triangle.V2;
 		}
-		TMap<FTriangleIndex, TSharedPtr<FRegionEdge>>* DistrictEdges = DistrictInfos.Find(District);
-		if (DistrictEdges == nullptr)
+	}
+	ParallelFor(FMath::Min(Mesh->NumSolidRegions, OceanRegions.Num()), [&](const int32 RegionIndex)
+	{
+		if (OceanRegions[RegionIndex])
 		{
-			DistrictInfos.Add(District, TMap<FTriangleIndex, TSharedPtr<FRegionEdge>>());
-			DistrictEdges = DistrictInfos.Find(District);
+			return;
 		}
-		TArray<FSideIndex> Sides = Mesh->r_circulate_s(RegionIndex);
-		for (const FSideIndex& Side : Sides)
+		const FVector2D Position = Mesh->r_pos(RegionIndex);
+		for (int32 Slot = 0; Slot < DistrictRegions.Num(); ++Slot)
 		{
-			FPointIndex OuterRegion = Mesh->s_end_r(Side);
-			int32 OuterDistrict = RegionDistricts[OuterRegion];
-			if (OuterDistrict == District)
+			if (!Bounds[Slot].IsInside(Position))
 			{
 				continue;
 			}
-			const FTriangleIndex AIndex = Mesh->s_inner_t(Side);
-			const FTriangleIndex BIndex = Mesh->s_outer_t(Side);
-			DistrictEdges->Add(
-				BIndex,
-				MakeShared<FRegionEdge>(
-					AIndex, Mesh->t_pos(AIndex), BIndex, Mesh->t_pos(BIndex)
-				)
-			);
+			for (const FPolyTriangle2D& Triangle : DistrictRegions[Slot].Triangles)
+			{
+				if (IsPointInTriangle(Position, Triangle))
+				{
+					RegionDistricts[RegionIndex] = DistrictRegions[Slot].District;
+					return;
+				}
+			}
 		}
-	}
+	});
+}
 
-	DistrictRegions.Empty(DistrictInfos.Num());
-	for (TPair<int32, TMap<FTriangleIndex, TSharedPtr<FRegionEdge>>>& DistrictInfo : DistrictInfos)
+void UIslandDistrict::BuildDistricts(TArray<FDistrictRegion>& DistrictRegions, TArray<int32>& RegionDistricts,
+                                     UTriangleDualMesh* Mesh, const TArray<bool>& OceanRegions,
+                                     FRandomStream& Rng) const
+{
+	TArray<FPointIndex> DistrictStarts;
+	ScatterDistrictStarts(DistrictStarts, Mesh, OceanRegions, Rng);
+	FillDistricts(RegionDistricts, Mesh, DistrictStarts, OceanRegions);
+
+	// Districts keep the order of their lowest region, their regions are listed district by district
+	FMemMark Mark(FMemStack::Get());
+	TScratchMap<int32, int32> DistrictSlots;
+	TScratchArray<int32> SlotOffsets;
+	for (const int32 District : RegionDistricts)
 	{
-		TMap<FTriangleIndex, TSharedPtr<FRegionEdge>>& BMap = DistrictInfo.Value;
-		int32 EdgeNum = BMap.Num();
-		DistrictRegions.Add(FDistrictRegion());
-		FDistrictRegion& DistrictRegion = DistrictRegions.Last();
-		DistrictRegion.District = DistrictInfo.Key;
-		DistrictRegion.Edges.SetNum(EdgeNum);
-		for (TPair<FTriangleIndex, TSharedPtr<FRegionEdge>>& EdgeInfo : BMap)
+		if (District == -1)
 		{
-			DistrictRegion.Edges.Add(EdgeInfo.Value);
-			if (!DistrictRegion.Begin.IsValid())
-				DistrictRegion.Begin = EdgeInfo.Value;
-			TSharedPtr<FRegionEdge>& PrevEdge = BMap.FindChecked(EdgeInfo.Value.Get()->AIndex);
-			if (PrevEdge == DistrictRegion.Begin)
-				DistrictRegion.End = EdgeInfo.Value;
-			if (!PrevEdge.Get()->Next.IsValid())
-			{
-				PrevEdge.Get()->Next = EdgeInfo.Value;
-			}
+			continue;
 		}
-		TWeakPtr<FRegionEdge> NowEdge = DistrictRegion.Begin;
-		DistrictRegion.Indices.Empty(EdgeNum);
-		DistrictRegion.Positions.Empty(EdgeNum);
-		while (true)
+		const int32 Slot = DistrictSlots.FindOrAdd(District, DistrictSlots.Num());
+		if (SlotOffsets.Num() <= Slot + 1)
 		{
-			DistrictRegion.Indices.Add(NowEdge.Pin()->AIndex);
-			DistrictRegion.Positions.Add(NowEdge.Pin()->APosition);
-			TWeakPtr<FRegionEdge> NextEdge = NowEdge.Pin()->Next;
-			if (NextEdge == DistrictRegion.Begin)
-				break;
-			NowEdge = NextEdge;
+			SlotOffsets.SetNumZeroed(Slot + 2);
+		}
+		++SlotOffsets[Slot + 1];
+	}
+	const int32 SlotNum = DistrictSlots.Num();
+	for (int32 Slot = 0; Slot < SlotNum; ++Slot)
+	{
+		SlotOffsets[Slot + 1] += SlotOffsets[Slot];
+	}
+	TScratchArray<int32> SlotRegions;
+	SlotRegions.SetNumUninitialized(SlotOffsets.IsEmpty() ? 0 : SlotOffsets.Last());
+	TScratchArray<int32> Cursor(SlotOffsets.GetData(), SlotNum);
+	for (int32 RegionIndex = 0; RegionIndex < RegionDistricts.Num(); ++RegionIndex)
+	{
+		if (RegionDistricts[RegionIndex] != -1)
+		{
+			SlotRegions[Cursor[DistrictSlots.FindChecked(RegionDistricts[RegionIndex])]++] = RegionIndex;
 		}
 	}
 
-	// Triangulate
-	for (FDistrictRegion& DistrictRegion : DistrictRegions)
+	DistrictRegions.Reset();
+	DistrictRegions.SetNum(SlotNum);
+	for (const TPair<int32, int32>& DistrictSlot : DistrictSlots)
 	{
-		UIslandMapUtils::TriangulateContour(DistrictRegion, DistrictRegion.Triangles);
+		DistrictRegions[DistrictSlot.Value].District = DistrictSlot.Key;
 	}
+	ParallelForWithDiagnostics(SlotNum, [&](const int32 Slot)
+	{
+		FDistrictRegion& DistrictRegion = DistrictRegions[Slot];
+		// One edge per outer triangle, a later side ending in the same triangle replaces the earlier one
+		FMemMark SlotMark(FMemStack::Get());
+		TArray<FRegionEdge> Edges;
+		TScratchMap<FTriangleIndex, int32> EdgeSlots;
+		for (int32 Offset = SlotOffsets[Slot]; Offset < SlotOffsets[Slot + 1]; ++Offset)
+		{
+			Mesh->r_circulate_s(SlotRegions[Offset], [&](const FSideIndex Side)
+			{
+				if (RegionDistricts[Mesh->s_end_r(Side)] == DistrictRegion.District)
+				{
+					return;
+				}
+				const FTriangleIndex AIndex = Mesh->s_inner_t(Side);
+				const FTriangleIndex BIndex = Mesh->s_outer_t(Side);
+				const FRegionEdge Edge(AIndex, Mesh->t_pos(AIndex), BIndex, Mesh->t_pos(BIndex));
+				if (const int32* EdgeSlot = EdgeSlots.Find(BIndex))
+				{
+					Edges[*EdgeSlot] = Edge;
+					return;
+				}
+				EdgeSlots.Add(BIndex, Edges.Add(Edge));
+			});
+		}
+
+		// Only the outline through the first edge, other pieces and holes are not kept
+		TArray<int32> LoopOffsets;
+		TArray<int32> LoopEdges;
+		UIslandMapUtils::ExtractBoundaryLoops(Edges, LoopOffsets, LoopEdges, 1);
+		if (LoopOffsets.Num() < 2)
+		{
+			return;
+		}
+		UIslandMapUtils::FillContour(DistrictRegion, Edges, TConstArrayView<int32>(LoopEdges.GetData(), LoopOffsets[1]));
+		UIslandMapUtils::TriangulateContour(DistrictRegion, DistrictRegion.Triangles);
+	});
 }
 
 void UIslandDistrict::ScatterDistrictStarts(TArray<FPointIndex>& DistrictStarts,
@@ -98,38 +275,79 @@ void UIslandDistrict::FillDistricts(TArray<int32>& DistrictRegions, UTriangleDua
                                     const TArray<FPointIndex>& DistrictStarts,
                                     const TArray<bool>& OceanRegions) const
 {
+	TRACE_CPUPROFILER_EVENT_SCOPE(UIslandDistrict::FillDistricts)
 	const int32 DistrictNum = DistrictStarts.Num();
-	struct FRegionDistrict
+	DistrictRegions.Init(-1, OceanRegions.Num());
+	auto IsLand = [Mesh, &OceanRegions](const FPointIndex RegionIndex)
 	{
-		int32 DistrictIndex;
-		FPointIndex RegionIndex;
-		FRegionDistrict() = default;
+		return !Mesh->r_ghost(RegionIndex) && !OceanRegions[RegionIndex];
+	};
 
-		FRegionDistrict(const int32& DI, const FPointIndex& RI) : DistrictIndex(DI), RegionIndex(RI)
+	if (FillMode != EDistrictFillMode::DFM_NearestStart)
+	{
+		TArray<FRegionDistrict> Frontier;
+		Frontier.Reserve(DistrictNum);
+		for (int32 DistrictIndex = 0; DistrictIndex < DistrictNum; ++DistrictIndex)
 		{
+			DistrictRegions[DistrictStarts[DistrictIndex]] = DistrictIndex;
+			Frontier.Emplace(DistrictIndex, DistrictStarts[DistrictIndex]);
 		}
-	};
-	DistrictRegions.Init(-1, OceanRegions.Num());
-	TQueue<FRegionDistrict> Regions;
+		GrowDistricts(DistrictRegions, Mesh, MoveTemp(Frontier), [&IsLand](const FPointIndex RegionIndex, int32)
+		{
+			return IsLand(RegionIndex);
+		});
+		return;
+	}
+
+	// A region picked twice keeps its first district
+	TArray<int32> StartDistricts;
+	TArray<FVector2D> StartPositions;
+	TArray<FRegionDistrict> Frontier;
 	for (int32 DistrictIndex = 0; DistrictIndex < DistrictNum; ++DistrictIndex)
 	{
-		DistrictRegions[DistrictStarts[DistrictIndex]] = DistrictIndex;
-		Regions.Enqueue(FRegionDistrict(DistrictIndex, DistrictStarts[DistrictIndex]));
+		const FPointIndex Start = DistrictStarts[DistrictIndex];
+		if (DistrictRegions[Start] != -1)
+		{
+			continue;
+		}
+		DistrictRegions[Start] = DistrictIndex;
+		StartDistricts.Add(DistrictIndex);
+		StartPositions.Add(Mesh->r_pos(Start));
+		Frontier.Emplace(DistrictIndex, Start);
 	}
+	if (Frontier.IsEmpty())
+	{
+		return;
+	}
+
+	FRegionGrid StartGrid;
+	StartGrid.Build(StartPositions);
+	TArray<int32> NearestDistricts;
+	NearestDistricts.SetNumUninitialized(DistrictRegions.Num());
+	ParallelFor(NearestDistricts.Num(), [&](const int32 RegionIndex)
+	{
+		NearestDistricts[RegionIndex] = IsLand(RegionIndex)
+			                                ? StartDistricts[StartGrid.FindClosest(StartPositions, Mesh->r_pos(RegionIndex))]
+			                                : -1;
+	});
 
-	while (!Regions.IsEmpty())
+	// Keep the part of every closest-start cell that is connected to its start, then let the districts
+	// grow over whatever got cut off, starting from the kept regions in region order
+	GrowDistricts(DistrictRegions, Mesh, MoveTemp(Frontier), [&NearestDistricts](const FPointIndex RegionIndex,
+	              const int32 DistrictIndex)
+	{
+		return NearestDistricts[RegionIndex] == DistrictIndex;
+	});
+	Frontier.Reset();
+	for (int32 RegionIndex = 0; RegionIndex < DistrictRegions.Num(); ++RegionIndex)
 	{
-		FRegionDistrict Region;
-		Regions.Dequeue(Region);
-		TArray<FPointIndex> RoundRegions = Mesh->r_circulate_r(Region.RegionIndex);
-		for (const FPointIndex& RegionIndex : RoundRegions)
+		if (DistrictRegions[RegionIndex] != -1)
 		{
-			if (Mesh->r_ghost(RegionIndex) || OceanRegions[RegionIndex] || DistrictRegions[RegionIndex] != -1)
-			{
-				continue;
-			}
-			DistrictRegions[RegionIndex] = Region.DistrictIndex;
-			Regions.Enqueue(FRegionDistrict(Region.DistrictIndex, RegionIndex));
+			Frontier.Emplace(DistrictRegions[RegionIndex], RegionIndex);
 		}
 	}
+	GrowDistricts(DistrictRegions, Mesh, MoveTemp(Frontier), [&IsLand](const FPointIndex RegionIndex, int32)
+	{
+		return IsLand(RegionIndex);
+	});
 }
@@ -11,13 +11,12 @@ void UIslandPoissonDistrict::ScatterDistrictStarts(TArray<FPointIndex>& District
                                                    const TArray<bool>& OceanRegions,
                                                    FRandomStream& Rng) const
 {
-	TArray<FVector2D> RegionPositions = Mesh->GetPoints();
 	FVector4 Border(DBL_MAX, DBL_MAX, DBL_MIN, DBL_MIN);
-	for (int32 RegionIndex = 0; RegionIndex < RegionPositions.Num(); ++RegionIndex)
+	for (int32 RegionIndex = 0; RegionIndex < Mesh->NumRegions; ++RegionIndex)
 	{
 		if (Mesh->r_ghost(RegionIndex) || OceanRegions[RegionIndex])
 			continue;
-		const FVector2D& Pos = RegionPositions[RegionIndex];
+		const FVector2D Pos = Mesh->r_pos(RegionIndex);
 		if (Border.X > Pos.X)
 		{
 			Border.X = Pos.X;
@@ -45,11 +44,11 @@ void UIslandPoissonDistrict::ScatterDistrictStarts(TArray<FPointIndex>& District
 		FMath::Min(ValidMapSize.X, ValidMapSize.Y) * DistrictDistanceRate,
 		3
 	);
+	const TArray<FPointIndex> ClosestRegions = Mesh->ClosestRegions(Points);
 	TSet<FPointIndex> RegionFilter;
-	for (const FVector2D& Point : Points)
+	for (const FPointIndex& PointIndex : ClosestRegions)
 	{
-		FPointIndex PointIndex = Mesh->ClosestRegion(Point);
-		if (Mesh->r_ghost(PointIndex) || OceanRegions[PointIndex])
+		if (!PointIndex.IsValid() || Mesh->r_ghost(PointIndex) || OceanRegions[PointIndex])
 		{
 			continue;
 		}
@@ -3,6 +3,7 @@
 
 #include "District/IslandScatterDistrict.h"
 #include "TriangleDualMesh.h"
+#include "RandomSampling/CounterRandom.h"
 
 void UIslandScatterDistrict::ScatterDistrictStarts(TArray<FPointIndex>& DistrictStarts, UTriangleDualMesh* Mesh,
                                                    const TArray<bool>& OceanRegions,
@@ -17,10 +18,9 @@ void UIslandScatterDistrict::ScatterDistrictStarts(TArray<FPointIndex>& District
 		}
 	}
 	TArray<int32> IslandRegions = IslandRegionSet.Array();
-	int32 RandomTimes = DistrictAmount;
-	while (RandomTimes > 0)
+	const FCounterRandom Random(Rng);
+	for (int32 StartIndex = 0; StartIndex < DistrictAmount; ++StartIndex)
 	{
-		--RandomTimes;
-		DistrictStarts.Add(IslandRegions[Rng.RandRange(0, IslandRegionSet.Num() - 1)]);
+		DistrictStarts.Add(IslandRegions[Random.RandRange(StartIndex, 0, IslandRegionSet.Num() - 1)]);
 	}
 }
@@ -3,20 +3,30 @@
 
 #include "DynamicMesh/IslandDynamicMeshActor.h"
 
-#include "canvas_ity.hpp"
+#include "Async/ParallelFor.h"
 #include "Clipper2Helper.h"
 #include "IslandMapData.h"
+#include "RegionGrid.h"
+#include "ScratchContainers.h"
 #include "Coastline/IslandCoastline.h"
+#include "District/DistrictIDTexture.h"
 #include "GeometryScript/MeshBasicEditFunctions.h"
 #include "GeometryScript/MeshBooleanFunctions.h"
 #include "GeometryScript/MeshDeformFunctions.h"
 #include "GeometryScript/MeshNormalsFunctions.h"
 #include "GeometryScript/MeshPrimitiveFunctions.h"
+#include "GeometryScript/MeshSelectionFunctions.h"
 #include "GeometryScript/MeshSubdivideFunctions.h"
 #include "DynamicMesh/DynamicMeshAttributeSet.h"
 #include "DynamicMesh/DynamicMeshOverlay.h"
 #include "GeometryScript/MeshVoxelFunctions.h"
 
+namespace
+{
+	/** Vertex ID range handled by one task of the border depth pass. */
+	constexpr int32 DepthBatchSize = 1024;
+}
+
 void AIslandDynamicMeshActor::GenerateIslandTexture()
 {
 	TRACE_CPUPROFILER_EVENT_SCOPE(AIslandDynamicMeshActor::GenerateDistrictIDTexture)
@@ -25,172 +35,16 @@ void AIslandDynamicMeshActor::GenerateIslandTexture()
 		return;
 	}
 	const FVector2D Scale = FVector2D(DistrictIDTextureWidth, DistrictIDTextureHeight) / MapData->GetMapSize();
-	canvas_ity::canvas_20 Canvas(DistrictIDTextureWidth, DistrictIDTextureHeight);
-	for (const FDistrictRegion& DistrictRegion : MapData->GetDistrictRegions())
-	{
-		canvas_ity::rgba_20 Data;
-		Data.a = 1.f;
-		switch (DistrictRegion.District)
-		{
-		case 0:
-			Data.d_a = 1.f;
-			Canvas.set_data_color(canvas_ity::fill_style, Data);
-			break;
-		case 1:
-			Data.d_b = 1.f;
-			Canvas.set_data_color(canvas_ity::fill_style, Data);
-			break;
-		case 2:
-			Data.d_c = 1.f;
-			Canvas.set_data_color(canvas_ity::fill_style, Data);
-			break;
-		case 3:
-			Data.d_d = 1.f;
-			Canvas.set_data_color(canvas_ity::fill_style, Data);
-			break;
-		case 4:
-			Data.d_e = 1.f;
-			Canvas.set_data_color(canvas_ity::fill_style, Data);
-			break;
-		case 5:
-			Data.d_f = 1.f;
-			Canvas.set_data_color(canvas_ity::fill_style, Data);
-			break;
-		case 6:
-			Data.d_g = 1.f;
-			Canvas.set_data_color(canvas_ity::fill_style, Data);
-			break;
-		case 7:
-			Data.d_h = 1.f;
-			Canvas.set_data_color(canvas_ity::fill_style, Data);
-			break;
-		case 8:
-			Data.d_i = 1.f;
-			Canvas.set_data_color(canvas_ity::fill_style, Data);
-			break;
-		case 9:
-			Data.d_j = 1.f;
-			Canvas.set_data_color(canvas_ity::fill_style, Data);
-			break;
-		case 10:
-			Data.d_k = 1.f;
-			Canvas.set_data_color(canvas_ity::fill_style, Data);
-			break;
-		case 11:
-			Data.d_l = 1.f;
-			Canvas.set_data_color(canvas_ity::fill_style, Data);
-			break;
-		case 12:
-			Data.d_m = 1.f;
-			Canvas.set_data_color(canvas_ity::fill_style, Data);
-			break;
-		case 13:
-			Data.d_n = 1.f;
-			Canvas.set_data_color(canvas_ity::fill_style, Data);
-			break;
-		case 14:
-			Data.d_o = 1.f;
-			Canvas.set_data_color(canvas_ity::fill_style, Data);
-			break;
-		case 15:
-			Data.d_p = 1.f;
-			Canvas.set_data_color(canvas_ity::fill_style, Data);
-			break;
-		default:
-			Canvas.set_data_color(canvas_ity::fill_style, Data);
-			break;
-		}
-
-		Canvas.begin_path();
-		const FVector2d FirstPos = DistrictRegion.Positions[0] * Scale;
-		Canvas.move_to(FirstPos.X, FirstPos.Y);
-		for (int32 PositionIndex = 1; PositionIndex < DistrictRegion.Positions.Num(); ++PositionIndex)
-		{
-			const FVector2d Pos = DistrictRegion.Positions[PositionIndex] * Scale;
-			Canvas.line_to(Pos.X, Pos.Y);
-		}
-		Canvas.close_path();
-		Canvas.fill();
-	}
-	canvas_ity::rgba_20* Bitmap = Canvas.get_bitmap();
+	TArray<FDistrictRasterPolygon> Polygons;
+	DistrictIDTexture::PreparePolygons(Polygons, MapData->GetDistrictRegions(), Scale);
 
 	int32 FloatImageBufferLength = DistrictIDTextureWidth * DistrictIDTextureHeight * 4;
 	TArray<FFloat16> FloatIDImageBuffer1;
-	FloatIDImageBuffer1.Empty(FloatImageBufferLength);
+	FloatIDImageBuffer1.SetNumUninitialized(FloatImageBufferLength);
 	TArray<FFloat16> FloatIDImageBuffer2;
-	FloatIDImageBuffer2.Empty(FloatImageBufferLength);
-
-	for (int32 Row = 0; Row < DistrictIDTextureHeight; ++Row)
-	{
-		for (int32 Col = 0; Col < DistrictIDTextureWidth; ++Col)
-		{
-			const canvas_ity::rgba_20& ColorData = *(Bitmap + static_cast<int>(Row * DistrictIDTextureWidth + Col));
-			struct
-			{
-				int32 District;
-				float Proportion;
-			} Proportions[16];
-			Proportions[0].District = 1;
-			Proportions[1].District = 2;
-			Proportions[2].District = 3;
-			Proportions[3].District = 4;
-			Proportions[4].District = 5;
-			Proportions[5].District = 6;
-			Proportions[6].District = 7;
-			Proportions[7].District = 8;
-			Proportions[8].District = 9;
-			Proportions[9].District = 10;
-			Proportions[10].District = 11;
-			Proportions[11].District = 12;
-			Proportions[12].District = 13;
-			Proportions[13].District = 14;
-			Proportions[14].District = 15;
-			Proportions[15].District = 16;
-			Proportions[0].Proportion = ColorData.d_a;
-			Proportions[1].Proportion = ColorData.d_b;
-			Proportions[2].Proportion = ColorData.d_c;
-			Proportions[3].Proportion = ColorData.d_d;
-			Proportions[4].Proportion = ColorData.d_e;
-			Proportions[5].Proportion = ColorData.d_f;
-			Proportions[6].Proportion = ColorData.d_g;
-			Proportions[7].Proportion = ColorData.d_h;
-			Proportions[8].Proportion = ColorData.d_i;
-			Proportions[9].Proportion = ColorData.d_j;
-			Proportions[10].Proportion = ColorData.d_k;
-			Proportions[11].Proportion = ColorData.d_l;
-			Proportions[12].Proportion = ColorData.d_m;
-			Proportions[13].Proportion = ColorData.d_n;
-			Proportions[14].Proportion = ColorData.d_o;
-			Proportions[15].Proportion = ColorData.d_p;
-			for (int32 i = 0; i < 15; i++)
-				for (int32 j = 0; j < 15 - i; j++)
-					if (Proportions[j].Proportion < Proportions[j + 1].Proportion)
-						std::swap(Proportions[j], Proportions[j + 1]);
-
-			if (Proportions[0].Proportion > 0)
-			{
-				FloatIDImageBuffer1.Emplace(Proportions[0].District / 16.f - 0.01f);
-				FloatIDImageBuffer1.Emplace(Proportions[0].Proportion);
-				FloatIDImageBuffer1.Emplace(Proportions[1].District / 16.f - 0.01f);
-				FloatIDImageBuffer1.Emplace(Proportions[1].Proportion);
-				FloatIDImageBuffer2.Emplace(Proportions[2].District / 16.f - 0.01f);
-				FloatIDImageBuffer2.Emplace(Proportions[2].Proportion);
-				FloatIDImageBuffer2.Emplace(Proportions[3].District / 16.f - 0.01f);
-				FloatIDImageBuffer2.Emplace(Proportions[3].Proportion);
-			}
-			else
-			{
-				FloatIDImageBuffer1.Emplace(0.f);
-				FloatIDImageBuffer1.Emplace(0.f);
-				FloatIDImageBuffer1.Emplace(0.f);
-				FloatIDImageBuffer1.Emplace(0.f);
-				FloatIDImageBuffer2.Emplace(0.f);
-				FloatIDImageBuffer2.Emplace(0.f);
-				FloatIDImageBuffer2.Emplace(0.f);
-				FloatIDImageBuffer2.Emplace(0.f);
-			}
-		}
-	}
+	FloatIDImageBuffer2.SetNumUninitialized(FloatImageBufferLength);
+	DistrictIDTexture::ResolveRows(Polygons, DistrictIDTextureWidth, 0, DistrictIDTextureHeight,
+	                               FloatIDImageBuffer1.GetData(), FloatIDImageBuffer2.GetData());
 	{
 		DistrictIDTexture01 = UTexture2D::CreateTransient(DistrictIDTextureWidth, DistrictIDTextureHeight,
 		                                                  EPixelFormat::PF_FloatRGBA);
@@ -235,6 +89,9 @@ void AIslandDynamicMeshActor::GenerateIslandMesh(UDynamicMesh* DynamicMesh, cons
 	case EGenerateMeshType::GMT_Voxelization:
 		GenerateMeshVoxelization(DynamicMesh, Transform);
 		break;
+	case EGenerateMeshType::GMT_Heightfield:
+		GenerateMeshHeightfield(DynamicMesh, Transform);
+		break;
 	}
 }
 
@@ -245,51 +102,50 @@ void AIslandDynamicMeshActor::GenerateMeshDelaunator(UDynamicMesh* DynamicMesh,
 	UTriangleDualMesh* Mesh = MapData->Mesh;
 	FGeometryScriptSimpleMeshBuffers Buffers;
 
-	TMap<FTriangleIndex, int32> VertexIndicesMap;
-	for (int32 PointIndex = 0; PointIndex < Mesh->NumSolidRegions; ++PointIndex)
+	// Land fans, one per region, see UIslandMapUtils::BuildRegionFans
+	TArray<FTriangleIndex> VertexTriangles;
+	TArray<int32> VertexIndices;
+	UIslandMapUtils::BuildRegionFans(Mesh, [this](const FPointIndex PointIndex)
+	{
+		return !MapData->IsPointOcean(PointIndex);
+	}, VertexTriangles, Buffers.Triangles, VertexIndices);
+	Buffers.Vertices.SetNumUninitialized(VertexTriangles.Num());
+	Buffers.UV0.SetNumUninitialized(VertexTriangles.Num());
+	ParallelFor(VertexTriangles.Num(), [&](const int32 VertexIndex)
+	{
+		const FVector2D Position2D = Mesh->t_pos(VertexTriangles[VertexIndex]);
+		Buffers.UV0[VertexIndex] = Position2D / MapSize;
+		Buffers.Vertices[VertexIndex] = FVector(Position2D, 0);
+	});
+
+	// Island expand border
+	// Every coastline writes its border into its own buffers. New vertices are numbered from VertexBase as if
+	// they came first, the coastline vertices keep their land IDs, and both are offset when the buffers are joined.
+	struct FBorderBuffers
 	{
-		if (MapData->IsPointOcean(PointIndex))
-			continue;
-		const TArray<FTriangleIndex>& TriangleIndices = Mesh->r_circulate_t(PointIndex);
-		if (TriangleIndices.Num() < 3)
+		TArray<FVector> Vertices;
+		TArray<FVector2D> UV0;
+		TArray<FIntVector> Triangles;
+
+		int32 AddVertex(const int32 VertexBase, const FVector2D& Position, const FVector2D& MapSize)
 		{
-			continue;
+			UV0.Emplace(Position / MapSize);
+			return VertexBase + Vertices.Emplace(FVector(Position, 0));
 		}
-		int32 FirstVertexIndex = -1;
-		int32 PrevVertexIndex = -1;
-		for (int32 Index = 0; Index < TriangleIndices.Num(); ++Index)
+	};
+	const TArray<FCoastlinePolygon>& Coastlines = MapData->GetCoastLines();
+	const int32 VertexBase = Buffers.Vertices.Num();
+	TArray<FBorderBuffers> BorderBuffers;
+	BorderBuffers.SetNum(Coastlines.Num());
+	auto GetCoastlineVertexIDs = [&VertexIndices](const FCoastlinePolygon& Coastline, TArray<int32>& OutIDs)
+	{
+		OutIDs.Empty(Coastline.Indices.Num());
+		for (const FTriangleIndex& TriangleIndex : Coastline.Indices)
 		{
-			const FTriangleIndex& TriangleIndex = TriangleIndices[Index];
-			int32 VertexIndex;
-			if (VertexIndicesMap.Contains(TriangleIndex))
-			{
-				VertexIndex = VertexIndicesMap.FindRef(TriangleIndex);
-			}
-			else
-			{
-				FVector2D Position2D = Mesh->t_pos(TriangleIndex);
-				Buffers.UV0.Emplace(Position2D / MapSize);
-				FVector Position(Position2D, 0);
-				VertexIndex = VertexIndicesMap.Emplace(TriangleIndex, Buffers.Vertices.Emplace(Position));
-			}
-			if (Index == 0)
-			{
-				FirstVertexIndex = VertexIndex;
-			}
-			else if (Index == 1)
-			{
-				PrevVertexIndex = VertexIndex;
-			}
-			else
-			{
-				Buffers.Triangles.Emplace(FIntVector(VertexIndex, PrevVertexIndex, FirstVertexIndex));
-				PrevVertexIndex = VertexIndex;
-			}
+			check(VertexIndices[TriangleIndex] != INDEX_NONE);
+			OutIDs.Emplace(VertexIndices[TriangleIndex]);
 		}
-	}
-
-	// Island expand border
-	const TArray<FCoastlinePolygon>& Coastlines = MapData->GetCoastLines();
+	};
 	if (DelaunatorBorderProcessMethod == EDelaunatorBorderProcess::DBP_StepDiffusion)
 	{
 		struct FBorderStepPoly
@@ -297,16 +153,15 @@ void AIslandDynamicMeshActor::GenerateMeshDelaunator(UDynamicMesh* DynamicMesh,
 			TArray<FVector2D> Points;
 			TArray<int32> IDs;
 		};
-		TArray<FBorderStepPoly> BorderPolys;
-		for (const FCoastlinePolygon& Coastline : Coastlines)
+		ParallelFor(Coastlines.Num(), [&](const int32 CoastlineIndex)
 		{
+			const FCoastlinePolygon& Coastline = Coastlines[CoastlineIndex];
+			FBorderBuffers& Border = BorderBuffers[CoastlineIndex];
+			FClipper2Workspace Clipper;
+			TArray<FBorderStepPoly> BorderPolys;
 			BorderPolys.SetNumZeroed(BorderTessellationTimes + 1);
 			BorderPolys[0].Points = Coastline.Positions;
-			BorderPolys[0].IDs.Empty(Coastline.Indices.Num());
-			for (const FTriangleIndex& TriangleIndex : Coastline.Indices)
-			{
-				BorderPolys[0].IDs.Emplace(VertexIndicesMap.FindChecked(TriangleIndex));
-			}
+			GetCoastlineVertexIDs(Coastline, BorderPolys[0].IDs);
 			int32 BiasIndex = FMath::Clamp(BorderTessellationStartStep, 0, BorderTessellationTimes - 1);
 			int32 Step = BiasIndex + 1;
 			int32 PrevStep = 0;
@@ -320,25 +175,25 @@ void AIslandDynamicMeshActor::GenerateMeshDelaunator(UDynamicMesh* DynamicMesh,
 				if (PrevStep == 0)
 				{
 					TArray<FVector2D> OffsetPoints;
-					UClipper2Helper::Offset(OffsetPoints, InnerPoints, BorderOffset * Scale, 0);
+					Clipper.Offset(OffsetPoints, Coastline.GetContour(CoastSimplificationTolerance).Positions,
+					               BorderOffset * Scale, 0);
 					SubdivisionPolygon(ExpandPoints, OffsetPoints);
 				}
 				else
 				{
-					UClipper2Helper::Offset(ExpandPoints, InnerPoints, BorderOffset * Scale, 0);
+					Clipper.Offset(ExpandPoints, InnerPoints, BorderOffset * Scale, 0);
 				}
 				int32 ExpandPointNum = ExpandPoints.Num();
 				ExpandPointIDs.Empty(ExpandPointNum);
 				for (int32 Index = 0; Index < ExpandPointNum; ++Index)
 				{
-					ExpandPointIDs.Emplace(Buffers.Vertices.Emplace(FVector(ExpandPoints[Index], 0)));
-					Buffers.UV0.Emplace(ExpandPoints[Index] / MapSize);
+					ExpandPointIDs.Emplace(Border.AddVertex(VertexBase, ExpandPoints[Index], MapSize));
 				}
 				if (PrevStep != 0)
 				{
 					TArray<FIntVector> OuterTriangles;
 					TriangulateRing(OuterTriangles, ExpandPoints, ExpandPointIDs, InnerPoints, InnerPointIDs);
-					Buffers.Triangles.Append(OuterTriangles);
+					Border.Triangles.Append(OuterTriangles);
 				}
 				PrevStep = Step;
 			}
@@ -352,21 +207,20 @@ void AIslandDynamicMeshActor::GenerateMeshDelaunator(UDynamicMesh* DynamicMesh,
 				TArray<int32>& InnerPointIDs = BorderPolys[Step].IDs;
 				if (Step != 0)
 				{
-					UClipper2Helper::Offset(InnerPoints, ExpandPoints, -BorderOffset / BorderTessellationTimes, 0);
+					Clipper.Offset(InnerPoints, ExpandPoints, -BorderOffset / BorderTessellationTimes, 0);
 					int32 InnerPointNum = InnerPoints.Num();
 					InnerPointIDs.Empty(InnerPointNum);
 					for (int32 Index = 0; Index < InnerPointNum; ++Index)
 					{
-						InnerPointIDs.Emplace(Buffers.Vertices.Emplace(FVector(InnerPoints[Index], 0)));
-						Buffers.UV0.Emplace(InnerPoints[Index] / MapSize);
+						InnerPointIDs.Emplace(Border.AddVertex(VertexBase, InnerPoints[Index], MapSize));
 					}
 				}
 				TArray<FIntVector> OuterTriangles;
 				TriangulateRing(OuterTriangles, ExpandPoints, ExpandPointIDs, InnerPoints, InnerPointIDs);
-				Buffers.Triangles.Append(OuterTriangles);
+				Border.Triangles.Append(OuterTriangles);
 				PrevStep = Step;
 			}
-		}
+		});
 	}
 	else if (DelaunatorBorderProcessMethod == EDelaunatorBorderProcess::DBP_StepTwoWay)
 	{
@@ -377,49 +231,50 @@ void AIslandDynamicMeshActor::GenerateMeshDelaunator(UDynamicMesh* DynamicMesh,
 			TArray<FVector2D> UnionPoints;
 			TArray<int32> UnionPointIDs;
 		};
-		TArray<FBorderStepTwoWayPoly> BorderStepPolys;
 		float StepBorderOffset = BorderOffset / BorderTessellationTimes;
-		for (const FCoastlinePolygon& Coastline : Coastlines)
+		ParallelFor(Coastlines.Num(), [&](const int32 CoastlineIndex)
 		{
+			const FCoastlinePolygon& Coastline = Coastlines[CoastlineIndex];
+			FBorderBuffers& Border = BorderBuffers[CoastlineIndex];
 			const TArray<FVector2D>& InnermostPoints = Coastline.Positions;
+			// The rings are only offset from the simplified coast, they are still stitched to the full one
+			const TArray<FVector2D>& OffsetPoints = Coastline.GetContour(CoastSimplificationTolerance).Positions;
+			FClipper2Workspace Clipper;
 			TArray<FVector2D> OutermostPoints;
-			UClipper2Helper::Offset(OutermostPoints, InnermostPoints,
-			                        BorderOffset + StepBorderOffset, 0);
-			BorderStepPolys.SetNumZeroed(BorderTessellationTimes);
+			Clipper.Offset(OutermostPoints, OffsetPoints, BorderOffset + StepBorderOffset, 0);
+			// Every step ring is offset from the innermost or the outermost ring directly, not from its neighbour
+			TArray<double, TInlineAllocator<16>> OuterDeltas;
+			TArray<double, TInlineAllocator<16>> InnerDeltas;
 			for (int32 Step = 0; Step < BorderTessellationTimes; ++Step)
 			{
-				UClipper2Helper::Offset(
-					BorderStepPolys[Step].InnerToOuterPoints,
-					Step == 0 ? InnermostPoints : BorderStepPolys[Step - 1].InnerToOuterPoints,
-					StepBorderOffset, 0
-				);
-				int32 ReverseStep = BorderTessellationTimes - Step - 1;
-				UClipper2Helper::Offset(
-					BorderStepPolys[ReverseStep].OuterToInnerPoints,
-					Step == 0 ? OutermostPoints : BorderStepPolys[ReverseStep + 1].OuterToInnerPoints,
-					-StepBorderOffset, 0
-				);
+				OuterDeltas.Add(StepBorderOffset * (Step + 1));
+				InnerDeltas.Add(-StepBorderOffset * (BorderTessellationTimes - Step));
 			}
-			TArray<int32> InnermostPointIDs;
-			InnermostPointIDs.Empty(InnermostPoints.Num());
-			for (const FTriangleIndex& TriangleIndex : Coastline.Indices)
+			TArray<TArray<FVector2D>> InnerToOuterRings;
+			TArray<TArray<FVector2D>> OuterToInnerRings;
+			Clipper.OffsetRings(InnerToOuterRings, OffsetPoints, OuterDeltas, 0);
+			Clipper.OffsetRings(OuterToInnerRings, OutermostPoints, InnerDeltas, 0);
+			TArray<FBorderStepTwoWayPoly> BorderStepPolys;
+			BorderStepPolys.SetNumZeroed(BorderTessellationTimes);
+			for (int32 Step = 0; Step < BorderTessellationTimes; ++Step)
 			{
-				InnermostPointIDs.Emplace(VertexIndicesMap.FindChecked(TriangleIndex));
+				BorderStepPolys[Step].InnerToOuterPoints = MoveTemp(InnerToOuterRings[Step]);
+				BorderStepPolys[Step].OuterToInnerPoints = MoveTemp(OuterToInnerRings[Step]);
 			}
+			TArray<int32> InnermostPointIDs;
+			GetCoastlineVertexIDs(Coastline, InnermostPointIDs);
 			for (int32 Step = 0; Step < BorderTessellationTimes; ++Step)
 			{
 				FBorderStepTwoWayPoly& BorderStepPoly = BorderStepPolys[Step];
 				TArray<FVector2D> UnionPoints;
-				UClipper2Helper::Union(UnionPoints, BorderStepPoly.InnerToOuterPoints,
-				                       BorderStepPoly.OuterToInnerPoints);
+				Clipper.Union(UnionPoints, BorderStepPoly.InnerToOuterPoints, BorderStepPoly.OuterToInnerPoints);
 				SubdivisionPolygon(BorderStepPoly.UnionPoints, UnionPoints);
 				int32 StepBorderPointNum = BorderStepPoly.UnionPoints.Num();
 				BorderStepPoly.UnionPointIDs.Empty(StepBorderPointNum);
 				for (int32 Index = 0; Index < StepBorderPointNum; ++Index)
 				{
 					BorderStepPoly.UnionPointIDs.Emplace(
-						Buffers.Vertices.Emplace(FVector(BorderStepPoly.UnionPoints[Index], 0)));
-					Buffers.UV0.Emplace(BorderStepPoly.UnionPoints[Index] / MapSize);
+						Border.AddVertex(VertexBase, BorderStepPoly.UnionPoints[Index], MapSize));
 				}
 				const TArray<FVector2D>& InnerPoints =
 					Step == 0
@@ -433,119 +288,507 @@ void AIslandDynamicMeshActor::GenerateMeshDelaunator(UDynamicMesh* DynamicMesh,
 					BorderStepPoly.UnionPoints, BorderStepPoly.UnionPointIDs,
 					InnerPoints, InnerPointIDs
 				);
-				Buffers.Triangles.Append(SpanTriangles);
+				Border.Triangles.Append(SpanTriangles);
 			}
-		}
+		});
+	}
+
+	// Join the borders in coastline order, which numbers the vertices exactly like a serial pass would
+	TArray<int32> VertexOffsets;
+	TArray<int32> TriangleOffsets;
+	VertexOffsets.SetNumUninitialized(BorderBuffers.Num() + 1);
+	TriangleOffsets.SetNumUninitialized(BorderBuffers.Num() + 1);
+	VertexOffsets[0] = VertexBase;
+	TriangleOffsets[0] = Buffers.Triangles.Num();
+	for (int32 CoastlineIndex = 0; CoastlineIndex < BorderBuffers.Num(); ++CoastlineIndex)
+	{
+		VertexOffsets[CoastlineIndex + 1] = VertexOffsets[CoastlineIndex] + BorderBuffers[CoastlineIndex].Vertices.Num();
+		TriangleOffsets[CoastlineIndex + 1] = TriangleOffsets[CoastlineIndex] + BorderBuffers[CoastlineIndex].Triangles.Num();
 	}
+	Buffers.Vertices.SetNumUninitialized(VertexOffsets.Last());
+	Buffers.UV0.SetNumUninitialized(VertexOffsets.Last());
+	Buffers.Triangles.SetNumUninitialized(TriangleOffsets.Last());
+	ParallelFor(BorderBuffers.Num(), [&](const int32 CoastlineIndex)
+	{
+		const FBorderBuffers& Border = BorderBuffers[CoastlineIndex];
+		const int32 VertexOffset = VertexOffsets[CoastlineIndex];
+		FMemory::Memcpy(Buffers.Vertices.GetData() + VertexOffset, Border.Vertices.GetData(),
+		                Border.Vertices.Num() * sizeof(FVector));
+		FMemory::Memcpy(Buffers.UV0.GetData() + VertexOffset, Border.UV0.GetData(),
+		                Border.UV0.Num() * sizeof(FVector2D));
+		const int32 Shift = VertexOffset - VertexBase;
+		auto Remap = [VertexBase, Shift](const int32 VertexID)
+		{
+			return VertexID >= VertexBase ? VertexID + Shift : VertexID;
+		};
+		FIntVector* Triangles = Buffers.Triangles.GetData() + TriangleOffsets[CoastlineIndex];
+		for (int32 Index = 0; Index < Border.Triangles.Num(); ++Index)
+		{
+			const FIntVector& Triangle = Border.Triangles[Index];
+			Triangles[Index] = FIntVector(Remap(Triangle.X), Remap(Triangle.Y), Remap(Triangle.Z));
+		}
+	});
 	FGeometryScriptIndexList TriangleIndices;
 	UGeometryScriptLibrary_MeshBasicEditFunctions::AppendBuffersToMesh(DynamicMesh, Buffers, TriangleIndices);
 
-	UGeometryScriptLibrary_MeshSubdivideFunctions::ApplyPNTessellation(
-		DynamicMesh,
-		FGeometryScriptPNTessellateOptions(),
-		TessellationLevel
-	);
+	if (bAdaptiveTessellation)
+	{
+		// The mesh is still flat here, so PN tessellation would only split triangles in the plane. Selective
+		// tessellation gives the same vertices around the coast and leaves the interior alone.
+		TArray<int32> SelectedTriangles;
+		DynamicMesh->ProcessMesh([&](const FDynamicMesh3& ReadMesh)
+		{
+			TArray<bool> VertexInBand;
+			VertexInBand.SetNumZeroed(ReadMesh.MaxVertexID());
+			ParallelFor(FMath::DivideAndRoundUp(ReadMesh.MaxVertexID(), DepthBatchSize), [&](const int32 Batch)
+			{
+				const int32 End = FMath::Min((Batch + 1) * DepthBatchSize, ReadMesh.MaxVertexID());
+				for (int32 Index = Batch * DepthBatchSize; Index < End; ++Index)
+				{
+					if (ReadMesh.IsVertex(Index))
+					{
+						const FVector3d Position = ReadMesh.GetVertex(Index);
+						VertexInBand[Index] = MapData->GetSignedCoastDistance({Position.X, Position.Y},
+						                                                      AdaptiveTessellationBand)
+							> -AdaptiveTessellationBand;
+					}
+				}
+			});
+			for (const int32 TriangleID : ReadMesh.TriangleIndicesItr())
+			{
+				const UE::Geometry::FIndex3i Triangle = ReadMesh.GetTriangle(TriangleID);
+				if (VertexInBand[Triangle.A] || VertexInBand[Triangle.B] || VertexInBand[Triangle.C])
+				{
+					SelectedTriangles.Add(TriangleID);
+				}
+			}
+		});
+		FGeometryScriptMeshSelection Selection;
+		UGeometryScriptLibrary_MeshSelectionFunctions::ConvertIndexArrayToMeshSelection(
+			DynamicMesh, SelectedTriangles, EGeometryScriptMeshSelectionType::Triangles, Selection);
+		UGeometryScriptLibrary_MeshSubdivideFunctions::ApplySelectiveTessellation(
+			DynamicMesh,
+			Selection,
+			FGeometryScriptSelectiveTessellateOptions(),
+			TessellationLevel
+		);
+	}
+	else if (!bHeadless)
+	{
+		UGeometryScriptLibrary_MeshSubdivideFunctions::ApplyPNTessellation(
+			DynamicMesh,
+			FGeometryScriptPNTessellateOptions(),
+			TessellationLevel
+		);
+	}
 
 	DynamicMesh->EditMesh([&](FDynamicMesh3& EditMesh)
 	{
-		int NumVertices = EditMesh.MaxVertexID();
-		for (int Index = 0; Index < NumVertices; ++Index)
+		TRACE_CPUPROFILER_EVENT_SCOPE(AIslandDynamicMeshActor::ApplyBorderDepth)
+		const int32 NumVertices = EditMesh.MaxVertexID();
+		// The coast lookups are read only, positions are computed per vertex ID range and written back afterwards
+		// so the mesh change stamps are only touched from this thread.
+		TArray<FVector3d> Positions;
+		Positions.SetNumUninitialized(NumVertices);
+		ParallelFor(FMath::DivideAndRoundUp(NumVertices, DepthBatchSize), [&](const int32 Batch)
 		{
-			if (!EditMesh.IsVertex(Index))
-				continue;
-			FVector3d Position = EditMesh.GetVertex(Index);
-			FVector2D Point = {Position.X, Position.Y};
-			bool bPointInPolygon2D = false;
-			double MinDistance = std::numeric_limits<double>::max();
-			for (const FCoastlinePolygon& CoastLine : MapData->GetCoastLines())
+			const int32 End = FMath::Min((Batch + 1) * DepthBatchSize, NumVertices);
+			for (int32 Index = Batch * DepthBatchSize; Index < End; ++Index)
 			{
-				bPointInPolygon2D = UIslandMapUtils::PointInPolygon2D(Point, CoastLine.Positions);
-				if (bPointInPolygon2D)
-					break;
-				MinDistance = FMath::Min(MinDistance, UIslandMapUtils::DistanceToPolygon2D(Point, CoastLine.Positions));
+				if (!EditMesh.IsVertex(Index))
+				{
+					continue;
+				}
+				FVector3d Position = EditMesh.GetVertex(Index);
+				FVector2D Point = {Position.X, Position.Y};
+				const double CoastDistance = MapData->GetSignedCoastDistance(Point, BorderOffset);
+				if (CoastDistance > 0.)
+				{
+					float UnitDepth = FMath::Clamp((BorderOffset - CoastDistance) / BorderOffset, 0, 1);
+					UnitDepth = UIslandMapUtils::Remap(UnitDepth, BorderDepthRemapMethod);
+					Position.Z += (UnitDepth - 1) * BorderDepth;
+				}
+				Positions[Index] = Transform.TransformPosition(Position);
 			}
-			if (!bPointInPolygon2D)
+		});
+		for (int32 Index = 0; Index < NumVertices; ++Index)
+		{
+			if (EditMesh.IsVertex(Index))
 			{
-				float UnitDepth = FMath::Clamp((BorderOffset - MinDistance) / BorderOffset, 0, 1);
-				UnitDepth = UIslandMapUtils::Remap(UnitDepth, BorderDepthRemapMethod);
-				Position.Z += (UnitDepth - 1) * BorderDepth;
+				EditMesh.SetVertex(Index, Positions[Index]);
 			}
-			EditMesh.SetVertex(Index, Transform.TransformPosition(Position));
 		}
 	}, EDynamicMeshChangeType::GeneralEdit, EDynamicMeshAttributeChangeFlags::Unknown, false);
 
-	UGeometryScriptLibrary_MeshNormalsFunctions::SetPerVertexNormals(DynamicMesh);
+	if (!bHeadless)
+	{
+		UGeometryScriptLibrary_MeshNormalsFunctions::SetPerVertexNormals(DynamicMesh);
+	}
 }
 
 void AIslandDynamicMeshActor::GenerateMeshVoxelization(UDynamicMesh* DynamicMesh, const FTransform& Transform)
 {
 	const TArray<FCoastlinePolygon>& Coastlines = MapData->GetCoastLines();
 	FVector2D MapSize = MapData->Mesh->GetSize();
+	const FVector2D WholeBaseSize = MapSize + FVector2D(BorderOffset * 2 + 100);
 
-	// Build island meshes
-	for (const FCoastlinePolygon& Coastline : Coastlines)
+	if (VoxelizationRegion == EVoxelizationRegion::VR_WholeMap)
 	{
-		FGeometryScriptSimpleMeshBuffers Buffers;
-		int32 VertexNum = Coastline.Positions.Num();
-		int32 TriangleNum = Coastline.Triangles.Num();
-		Buffers.Vertices.Empty(VertexNum * 2);
-		Buffers.Triangles.Empty(TriangleNum + VertexNum * 2);
-		TMap<int32, int32> IndexMap;
-		for (int32 Index = 0; Index < VertexNum; ++Index)
+		// Build island meshes
+		for (const FCoastlinePolygon& Coastline : Coastlines)
 		{
-			IndexMap.Emplace(Coastline.Indices[Index], Index);
-			Buffers.Vertices.Emplace(Transform.TransformPosition(FVector(Coastline.Positions[Index], 0)));
+			AppendVoxelizationIsland(DynamicMesh, Coastline, Transform);
 		}
-		for (const FPolyTriangle2D& Tri : Coastline.Triangles)
+		SolidifyVoxelization(DynamicMesh, SolidifyOptions, FVector2D::ZeroVector, WholeBaseSize);
+	}
+	else
+	{
+		// Islands whose bands overlap have to be solidified together, otherwise their unions would differ
+		const int32 CoastlineNum = Coastlines.Num();
+		TArray<FBox2D> Bands;
+		Bands.Reserve(CoastlineNum);
+		for (const FCoastlinePolygon& Coastline : Coastlines)
 		{
-			Buffers.Triangles.Emplace(FIntVector(IndexMap[Tri.V2Index], IndexMap[Tri.V1Index], IndexMap[Tri.V0Index]));
+			FBox2D Band(ForceInit);
+			for (const FVector2D& Position : Coastline.Positions)
+			{
+				Band += FVector2D(Transform.TransformPosition(FVector(Position, 0)));
+			}
+			Bands.Emplace(Band.ExpandBy(BorderOffset + 50));
+		}
+		TArray<int32> Groups;
+		Groups.SetNumUninitialized(CoastlineNum);
+		for (int32 Index = 0; Index < CoastlineNum; ++Index)
+		{
+			Groups[Index] = Index;
+		}
+		auto FindGroup = [&Groups](int32 Index)
+		{
+			while (Groups[Index] != Index)
+			{
+				Index = Groups[Index] = Groups[Groups[Index]];
+			}
+			return Index;
+		};
+		for (int32 Index = 0; Index < CoastlineNum; ++Index)
+		{
+			for (int32 Other = Index + 1; Other < CoastlineNum; ++Other)
+			{
+				if (Bands[Index].Intersect(Bands[Other]))
+				{
+					Groups[FindGroup(Other)] = FindGroup(Index);
+				}
+			}
+		}
+		TArray<int32> GroupRoots;
+		TArray<TArray<int32>> GroupCoastlines;
+		TArray<FBox2D> GroupBands;
+		for (int32 Index = 0; Index < CoastlineNum; ++Index)
+		{
+			const int32 Root = FindGroup(Index);
+			int32 GroupIndex = GroupRoots.Find(Root);
+			if (GroupIndex == INDEX_NONE)
+			{
+				GroupIndex = GroupRoots.Add(Root);
+				GroupCoastlines.AddDefaulted();
+				GroupBands.Emplace(ForceInit);
+			}
+			GroupCoastlines[GroupIndex].Add(Index);
+			GroupBands[GroupIndex] += Bands[Index];
 		}
 
-		// Island expand border
-		TArray<FVector2D> ExpandPoints;
-		UClipper2Helper::Offset(ExpandPoints, Coastline.Positions, BorderOffset, 0);
-		int32 ExpandPointNum = ExpandPoints.Num();
-		TArray<int32> ExpandPointIds;
-		ExpandPointIds.Empty(ExpandPointNum);
-		for (int32 Index = 0; Index < ExpandPointNum; ++Index)
+		// Keep the cell size of the whole map grid, a fixed resolution would get finer on every small island
+		FGeometryScriptSolidifyOptions GroupOptions = SolidifyOptions;
+		if (GroupOptions.GridParameters.SizeMethod == EGeometryScriptGridSizingMethod::GridResolution)
 		{
-			Buffers.Vertices.Emplace(Transform.TransformPosition(FVector(ExpandPoints[Index], -BorderDepth)));
+			GroupOptions.GridParameters.SizeMethod = EGeometryScriptGridSizingMethod::GridCellSize;
+			GroupOptions.GridParameters.GridCellSize = WholeBaseSize.GetMax()
+				/ FMath::Max(SolidifyOptions.GridParameters.GridResolution, 1);
 		}
-		TArray<FPolyTriangle2D> ExpandTriangles;
-		UPolyPartitionHelper::Triangulate(
-			ExpandPoints, ExpandPointIds,
-			ExpandTriangles
-		);
-		for (const FPolyTriangle2D& Tri : ExpandTriangles)
+		TArray<UDynamicMesh*> GroupMeshes;
+		for (int32 GroupIndex = 0; GroupIndex < GroupRoots.Num(); ++GroupIndex)
+		{
+			GroupMeshes.Emplace(NewObject<UDynamicMesh>(this));
+		}
+		ParallelFor(GroupMeshes.Num(), [&](const int32 GroupIndex)
+		{
+			for (const int32 CoastlineIndex : GroupCoastlines[GroupIndex])
+			{
+				AppendVoxelizationIsland(GroupMeshes[GroupIndex], Coastlines[CoastlineIndex], Transform);
+			}
+			SolidifyVoxelization(GroupMeshes[GroupIndex], GroupOptions, GroupBands[GroupIndex].GetCenter(),
+			                     GroupBands[GroupIndex].GetSize());
+		});
+		for (UDynamicMesh* GroupMesh : GroupMeshes)
+		{
+			UGeometryScriptLibrary_MeshBasicEditFunctions::AppendMesh(DynamicMesh, GroupMesh, FTransform::Identity);
+		}
+	}
+
+	if (bHeadless)
+	{
+		return;
+	}
+	FDynamicMesh3& Mesh = DynamicMesh->GetMeshRef();
+	// UV
+	DynamicMesh->EditMesh([&](FDynamicMesh3& EditMesh)
+	{
+		UE::Geometry::FDynamicMeshUVOverlay* UVOverlay = EditMesh.Attributes()->GetUVLayer(0);
+		for (int TriIndex : Mesh.TriangleIndicesItr())
+		{
+			FVector3d V0Pos, V1Pos, V2Pos;
+			Mesh.GetTriVertices(TriIndex, V0Pos, V1Pos, V2Pos);
+			if (UVOverlay != nullptr)
+			{
+				int32 Elem0 = UVOverlay->AppendElement(
+					FVector2f(V0Pos.X / MapSize.X - 0.5f, V0Pos.Y / MapSize.Y - 0.5f));
+				int32 Elem1 = UVOverlay->AppendElement(
+					FVector2f(V1Pos.X / MapSize.X - 0.5f, V1Pos.Y / MapSize.Y - 0.5f));
+				int32 Elem2 = UVOverlay->AppendElement(
+					FVector2f(V2Pos.X / MapSize.X - 0.5f, V2Pos.Y / MapSize.Y - 0.5f));
+				UVOverlay->SetTriangle(TriIndex, UE::Geometry::FIndex3i(Elem0, Elem1, Elem2), true);
+			}
+		}
+	}, EDynamicMeshChangeType::GeneralEdit, EDynamicMeshAttributeChangeFlags::Unknown, false);
+}
+
+void AIslandDynamicMeshActor::GenerateMeshHeightfield(UDynamicMesh* DynamicMesh, const FTransform& Transform)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(AIslandDynamicMeshActor::GenerateMeshHeightfield)
+	const FVector2D MapSize = MapData->Mesh->GetSize();
+	const FVector2D CellSize(FMath::Max(MeshPixelWidth, 1), FMath::Max(MeshPixelHeight, 1));
+	const FVector2D Origin(-BorderOffset);
+	const int32 CellNumX = FMath::CeilToInt32((MapSize.X + 2 * BorderOffset) / CellSize.X);
+	const int32 CellNumY = FMath::CeilToInt32((MapSize.Y + 2 * BorderOffset) / CellSize.Y);
+	const int32 RowLength = CellNumX + 1;
+	const int32 CornerNum = RowLength * (CellNumY + 1);
+
+	// Every grid corner, the border ends where the coast distance reaches BorderOffset
+	TArray<FVector2D> Corners;
+	TArray<double> Distances;
+	Corners.SetNumUninitialized(CornerNum);
+	Distances.SetNumUninitialized(CornerNum);
+	ParallelFor(CellNumY + 1, [&](const int32 Y)
+	{
+		for (int32 X = 0; X < RowLength; ++X)
+		{
+			const int32 Index = Y * RowLength + X;
+			Corners[Index] = Origin + FVector2D(X, Y) * CellSize;
+			Distances[Index] = MapData->GetSignedCoastDistance(Corners[Index], BorderOffset);
+		}
+	});
+	TArray<float> Elevations;
+	if (HeightfieldElevationScale != 0)
+	{
+		Elevations.SetNumUninitialized(CornerNum);
+		MapData->GetMapQuery()->GetElevationsAt(Corners, Elevations);
+	}
+	auto IsInside = [&Distances, this](const int32 Corner)
+	{
+		return Distances[Corner] < BorderOffset;
+	};
+	auto GetHeight = [this](const double CoastDistance, const float Elevation)
+	{
+		if (CoastDistance > 0.)
 		{
-			Buffers.Triangles.Emplace(
-				FIntVector(Tri.V0Index, Tri.V1Index, Tri.V2Index) + FIntVector(VertexNum, VertexNum, VertexNum));
+			const float UnitDepth = FMath::Clamp((BorderOffset - CoastDistance) / BorderOffset, 0, 1);
+			return (UIslandMapUtils::Remap(UnitDepth, BorderDepthRemapMethod) - 1) * BorderDepth;
+		}
+		return FMath::Max(Elevation, 0.f) * HeightfieldElevationScale;
+	};
+
+	// Vertices on the inside corners and where the outer edge of the border crosses a cell side.
+	// EdgeX runs from corner (X, Y) to (X + 1, Y), EdgeY from (X, Y) to (X, Y + 1).
+	TArray<int32> CornerIDs;
+	TArray<int32> EdgeXIDs;
+	TArray<int32> EdgeYIDs;
+	CornerIDs.Init(INDEX_NONE, CornerNum);
+	EdgeXIDs.Init(INDEX_NONE, CellNumX * (CellNumY + 1));
+	EdgeYIDs.Init(INDEX_NONE, RowLength * CellNumY);
+	struct FEdgeVertex
+	{
+		int32 From;
+		int32 To;
+	};
+	TArray<FEdgeVertex> EdgeVertices;
+	int32 VertexNum = 0;
+	for (int32 Corner = 0; Corner < CornerNum; ++Corner)
+	{
+		if (IsInside(Corner))
+		{
+			CornerIDs[Corner] = VertexNum++;
+		}
+	}
+	for (int32 Y = 0; Y <= CellNumY; ++Y)
+	{
+		for (int32 X = 0; X < RowLength; ++X)
+		{
+			const int32 Corner = Y * RowLength + X;
+			if (X < CellNumX && IsInside(Corner) != IsInside(Corner + 1))
+			{
+				EdgeXIDs[Y * CellNumX + X] = VertexNum++;
+				EdgeVertices.Add({Corner, Corner + 1});
+			}
+			if (Y < CellNumY && IsInside(Corner) != IsInside(Corner + RowLength))
+			{
+				EdgeYIDs[Corner] = VertexNum++;
+				EdgeVertices.Add({Corner, Corner + RowLength});
+			}
+		}
+	}
+
+	FGeometryScriptSimpleMeshBuffers Buffers;
+	Buffers.Vertices.SetNumUninitialized(VertexNum);
+	Buffers.UV0.SetNumUninitialized(VertexNum);
+	auto SetVertex = [&](const int32 VertexID, const FVector2D& Position, const double Height)
+	{
+		Buffers.Vertices[VertexID] = Transform.TransformPosition(FVector(Position, Height));
+		Buffers.UV0[VertexID] = Position / MapSize;
+	};
+	ParallelFor(CellNumY + 1, [&](const int32 Y)
+	{
+		for (int32 Corner = Y * RowLength; Corner < (Y + 1) * RowLength; ++Corner)
+		{
+			if (CornerIDs[Corner] != INDEX_NONE)
+			{
+				SetVertex(CornerIDs[Corner], Corners[Corner],
+				          GetHeight(Distances[Corner], Elevations.IsEmpty() ? 0.f : Elevations[Corner]));
+			}
+		}
+	});
+	const int32 CornerVertexNum = VertexNum - EdgeVertices.Num();
+	ParallelFor(EdgeVertices.Num(), [&](const int32 Index)
+	{
+		// Where the distance interpolated along the side reaches BorderOffset, the bottom of the border
+		const FEdgeVertex& Edge = EdgeVertices[Index];
+		const int32 Inside = IsInside(Edge.From) ? Edge.From : Edge.To;
+		const int32 Outside = Inside == Edge.From ? Edge.To : Edge.From;
+		const double Span = Distances[Outside] - Distances[Inside];
+		const double Alpha = Span > 0. ? FMath::Clamp((BorderOffset - Distances[Inside]) / Span, 0., 1.) : 0.5;
+		SetVertex(CornerVertexNum + Index, FMath::Lerp(Corners[Inside], Corners[Outside], Alpha), -BorderDepth);
+	});
+
+	// Marching squares: every cell keeps the polygon of its inside corners and crossings, fanned from its first vertex
+	TArray<TArray<FIntVector>> RowTriangles;
+	RowTriangles.SetNum(CellNumY);
+	ParallelFor(CellNumY, [&](const int32 Y)
+	{
+		TArray<FIntVector>& Triangles = RowTriangles[Y];
+		for (int32 X = 0; X < CellNumX; ++X)
+		{
+			const int32 Corner = Y * RowLength + X;
+			const int32 CellCorners[4] = {Corner, Corner + 1, Corner + RowLength + 1, Corner + RowLength};
+			const int32 CellEdges[4] = {
+				EdgeXIDs[Y * CellNumX + X], EdgeYIDs[Corner + 1], EdgeXIDs[(Y + 1) * CellNumX + X], EdgeYIDs[Corner]
+			};
+			TArray<int32, TInlineAllocator<6>> Polygon;
+			for (int32 Side = 0; Side < 4; ++Side)
+			{
+				if (CornerIDs[CellCorners[Side]] != INDEX_NONE)
+				{
+					Polygon.Add(CornerIDs[CellCorners[Side]]);
+				}
+				if (CellEdges[Side] != INDEX_NONE)
+				{
+					Polygon.Add(CellEdges[Side]);
+				}
+			}
+			// Counterclockwise in the plane, so the fan is wound the other way to face up
+			for (int32 Index = 2; Index < Polygon.Num(); ++Index)
+			{
+				Triangles.Emplace(Polygon[0], Polygon[Index], Polygon[Index - 1]);
+			}
 		}
-		TArray<FIntVector> OuterTriangles;
-		TriangulateRing(OuterTriangles, ExpandPoints, Coastline.Positions);
-		Buffers.Triangles.Append(OuterTriangles);
+	});
+	for (TArray<FIntVector>& Triangles : RowTriangles)
+	{
+		Buffers.Triangles.Append(MoveTemp(Triangles));
+	}
+	FGeometryScriptIndexList TriangleIndices;
+	UGeometryScriptLibrary_MeshBasicEditFunctions::AppendBuffersToMesh(DynamicMesh, Buffers, TriangleIndices);
+
+	if (!bHeadless)
+	{
+		UGeometryScriptLibrary_MeshNormalsFunctions::SetPerVertexNormals(DynamicMesh);
+	}
+}
+
+void AIslandDynamicMeshActor::AppendVoxelizationIsland(UDynamicMesh* DynamicMesh, const FCoastlinePolygon& Coastline,
+                                                       const FTransform& Transform) const
+{
+	FGeometryScriptSimpleMeshBuffers Buffers;
+	// The island is voxelized anyway, a simplified coast only has to be triangulated
+	const FAreaContour& Contour = Coastline.GetContour(CoastSimplificationTolerance);
+	TArray<FPolyTriangle2D> SimplifiedTriangles;
+	if (&Contour != &Coastline)
+	{
+		UIslandMapUtils::TriangulateContour(Contour, SimplifiedTriangles);
+	}
+	const TArray<FPolyTriangle2D>& Triangles = &Contour != &Coastline ? SimplifiedTriangles : Coastline.Triangles;
+	int32 VertexNum = Contour.Positions.Num();
+	int32 TriangleNum = Triangles.Num();
+	Buffers.Vertices.Empty(VertexNum * 2);
+	Buffers.Triangles.Empty(TriangleNum + VertexNum * 2);
+	TMap<int32, int32> IndexMap;
+	for (int32 Index = 0; Index < VertexNum; ++Index)
+	{
+		IndexMap.Emplace(Contour.Indices[Index], Index);
+		Buffers.Vertices.Emplace(Transform.TransformPosition(FVector(Contour.Positions[Index], 0)));
+	}
+	for (const FPolyTriangle2D& Tri : Triangles)
+	{
+		Buffers.Triangles.Emplace(FIntVector(IndexMap[Tri.V2Index], IndexMap[Tri.V1Index], IndexMap[Tri.V0Index]));
+	}
 
-		FGeometryScriptIndexList TriangleIndices;
-		UGeometryScriptLibrary_MeshBasicEditFunctions::AppendBuffersToMesh(DynamicMesh, Buffers, TriangleIndices);
+	// Island expand border
+	TArray<FVector2D> ExpandPoints;
+	UClipper2Helper::Offset(ExpandPoints, Contour.Positions, BorderOffset, 0);
+	int32 ExpandPointNum = ExpandPoints.Num();
+	TArray<int32> ExpandPointIds;
+	ExpandPointIds.Empty(ExpandPointNum);
+	for (int32 Index = 0; Index < ExpandPointNum; ++Index)
+	{
+		Buffers.Vertices.Emplace(Transform.TransformPosition(FVector(ExpandPoints[Index], -BorderDepth)));
 	}
+	TArray<FPolyTriangle2D> ExpandTriangles;
+	UPolyPartitionHelper::Triangulate(
+		ExpandPoints, ExpandPointIds,
+		ExpandTriangles, EPolyTriangulationMethod::PTM_Monotone
+	);
+	for (const FPolyTriangle2D& Tri : ExpandTriangles)
+	{
+		Buffers.Triangles.Emplace(
+			FIntVector(Tri.V0Index, Tri.V1Index, Tri.V2Index) + FIntVector(VertexNum, VertexNum, VertexNum));
+	}
+	TArray<FIntVector> OuterTriangles;
+	TriangulateRing(OuterTriangles, ExpandPoints, Contour.Positions);
+	Buffers.Triangles.Append(OuterTriangles);
+
+	FGeometryScriptIndexList TriangleIndices;
+	UGeometryScriptLibrary_MeshBasicEditFunctions::AppendBuffersToMesh(DynamicMesh, Buffers, TriangleIndices);
+}
 
+void AIslandDynamicMeshActor::SolidifyVoxelization(UDynamicMesh* DynamicMesh,
+                                                   const FGeometryScriptSolidifyOptions& Options,
+                                                   const FVector2D& BaseCenter, const FVector2D& BaseSize) const
+{
 	// Add base box to slight bend border
 	{
 		FTransform BaseBoxTransform;
 		const float BaseHeight = BorderDepth;
-		BaseBoxTransform.SetLocation(FVector(0, 0, -BorderDepth - BaseHeight - 100));
+		BaseBoxTransform.SetLocation(FVector(BaseCenter, -BorderDepth - BaseHeight - 100));
 		UGeometryScriptLibrary_MeshPrimitiveFunctions::AppendBox(
 			DynamicMesh,
 			FGeometryScriptPrimitiveOptions(),
 			BaseBoxTransform,
-			MapSize.X + BorderOffset * 2 + 100,
-			MapSize.Y + BorderOffset * 2 + 100,
+			BaseSize.X,
+			BaseSize.Y,
 			BaseHeight
 		);
 	}
 
 	// Voxelization
-	UGeometryScriptLibrary_MeshVoxelFunctions::ApplyMeshSolidify(DynamicMesh, SolidifyOptions);
+	UGeometryScriptLibrary_MeshVoxelFunctions::ApplyMeshSolidify(DynamicMesh, Options);
 
 	FGeometryScriptIterativeMeshSmoothingOptions SmoothingOptions;
 	SmoothingOptions.NumIterations = 3;
@@ -555,11 +798,14 @@ void AIslandDynamicMeshActor::GenerateMeshVoxelization(UDynamicMesh* DynamicMesh
 		SmoothingOptions
 	);
 
-	UGeometryScriptLibrary_MeshSubdivideFunctions::ApplyPNTessellation(
-		DynamicMesh,
-		FGeometryScriptPNTessellateOptions(),
-		TessellationLevel
-	);
+	if (!bHeadless)
+	{
+		UGeometryScriptLibrary_MeshSubdivideFunctions::ApplyPNTessellation(
+			DynamicMesh,
+			FGeometryScriptPNTessellateOptions(),
+			TessellationLevel
+		);
+	}
 
 	// Cut the section of mesh that under ocean
 	{
@@ -571,29 +817,10 @@ void AIslandDynamicMeshActor::GenerateMeshVoxelization(UDynamicMesh* DynamicMesh
 		CutOptions.bFillSpans = false;
 		UGeometryScriptLibrary_MeshBooleanFunctions::ApplyMeshPlaneCut(DynamicMesh, CutFrame, CutOptions);
 	}
-	UGeometryScriptLibrary_MeshNormalsFunctions::SetPerVertexNormals(DynamicMesh);
-
-	FDynamicMesh3& Mesh = DynamicMesh->GetMeshRef();
-	// UV
-	DynamicMesh->EditMesh([&](FDynamicMesh3& EditMesh)
+	if (!bHeadless)
 	{
-		UE::Geometry::FDynamicMeshUVOverlay* UVOverlay = EditMesh.Attributes()->GetUVLayer(0);
-		for (int TriIndex : Mesh.TriangleIndicesItr())
-		{
-			FVector3d V0Pos, V1Pos, V2Pos;
-			Mesh.GetTriVertices(TriIndex, V0Pos, V1Pos, V2Pos);
-			if (UVOverlay != nullptr)
-			{
-				int32 Elem0 = UVOverlay->AppendElement(
-					FVector2f(V0Pos.X / MapSize.X - 0.5f, V0Pos.Y / MapSize.Y - 0.5f));
-				int32 Elem1 = UVOverlay->AppendElement(
-					FVector2f(V1Pos.X / MapSize.X - 0.5f, V1Pos.Y / MapSize.Y - 0.5f));
-				int32 Elem2 = UVOverlay->AppendElement(
-					FVector2f(V2Pos.X / MapSize.X - 0.5f, V2Pos.Y / MapSize.Y - 0.5f));
-				UVOverlay->SetTriangle(TriIndex, UE::Geometry::FIndex3i(Elem0, Elem1, Elem2), true);
-			}
-		}
-	}, EDynamicMeshChangeType::GeneralEdit, EDynamicMeshAttributeChangeFlags::Unknown, false);
+		UGeometryScriptLibrary_MeshNormalsFunctions::SetPerVertexNormals(DynamicMesh);
+	}
 }
 
 void AIslandDynamicMeshActor::SetMaterialParameters(UMaterialInstanceDynamic* MaterialInstance)
@@ -624,25 +851,22 @@ void AIslandDynamicMeshActor::TriangulateRing(TArray<FIntVector>& Triangles,
 void AIslandDynamicMeshActor::TriangulateRing(TArray<FIntVector>& Triangles, const TArray<FVector2D>& OuterPoly,
                                               const TArray<FVector2D>& InnerPoly)
 {
-	TArray<int32> OuterLinkedInner;
+	FMemMark Mark(FMemStack::Get());
+	TScratchArray<int32> OuterLinkedInner;
 	const int32 OuterNum = OuterPoly.Num();
 	const int32 InnerNum = InnerPoly.Num();
-	OuterLinkedInner.SetNumZeroed(OuterNum);
+	if (OuterNum == 0 || InnerNum == 0)
+	{
+		Triangles.Empty();
+		return;
+	}
+	// Same closest inner point as scanning the whole inner ring, lowest index on ties
+	FRegionGrid InnerGrid;
+	InnerGrid.Build(InnerPoly);
+	OuterLinkedInner.SetNumUninitialized(OuterNum);
 	for (int32 OuterIndex = 0; OuterIndex < OuterNum; ++OuterIndex)
 	{
-		const FVector2D& OuterPos = OuterPoly[OuterIndex];
-		double ClosestInnerPointDistSquared = DBL_MAX;
-		int32 ClosestInnerPointIndex = 0;
-		for (int32 InnerIndex = 0; InnerIndex < InnerNum; ++InnerIndex)
-		{
-			double Dist = FVector2D::DistSquared(OuterPos, InnerPoly[InnerIndex]);
-			if (Dist < ClosestInnerPointDistSquared)
-			{
-				ClosestInnerPointIndex = InnerIndex;
-				ClosestInnerPointDistSquared = Dist;
-			}
-		}
-		OuterLinkedInner[OuterIndex] = ClosestInnerPointIndex;
+		OuterLinkedInner[OuterIndex] = InnerGrid.FindClosest(InnerPoly, OuterPoly[OuterIndex]);
 	}
 	Triangles.Empty(FMath::Max(OuterNum, InnerNum) * 2);
 	for (int32 OuterIndex = 0, LinkedInnerIndex = OuterLinkedInner[OuterIndex]; OuterIndex < OuterNum;)
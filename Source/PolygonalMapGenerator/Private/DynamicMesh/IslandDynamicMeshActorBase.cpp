@@ -2,6 +2,15 @@
 
 #include "DynamicMesh/IslandDynamicMeshActorBase.h"
 
+#include "DynamicMeshToMeshDescription.h"
+#include "MeshSimplification.h"
+#include "PolygonalMapGenerator.h"
+#include "StaticMeshAttributes.h"
+#include "Async/ParallelFor.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "GeometryScript/MeshAssetFunctions.h"
+
 struct FCoastlinePolygon;
 
 UIslandMapData* AIslandDynamicMeshActorBase::SetMapData(UIslandMapData* InMapData)
@@ -25,19 +34,27 @@ bool AIslandDynamicMeshActorBase::GenerateIsland(UIslandMapData* InMapData, cons
 		PostGenerateIsland(false);
 		return false;
 	}
-	GenerateIslandTexture();
+	ResetStaticMesh();
+	bHeadless = UIslandMapUtils::IsHeadlessProfile(GenerationProfile);
+	if (!bHeadless)
+		GenerateIslandTexture();
 	UDynamicMesh* DynamicMesh = DynamicMeshComponent->GetDynamicMesh();
 	GenerateIslandMesh(DynamicMesh, Transform);
 	if (bGenerateCollision)
 		UGeometryScriptLibrary_CollisionFunctions::SetDynamicMeshCollisionFromMesh(
 			DynamicMesh, DynamicMeshComponent, GenerateCollisionOptions);
-	if (IsValid(IslandMaterial))
+	LODMeshes.Reset();
+	if (bGenerateLODs && !bHeadless)
+		GenerateLODs(DynamicMesh, Transform);
+	if (IsValid(IslandMaterial) && !bHeadless)
 	{
 		UMaterialInstanceDynamic* MaterialInstance = UMaterialInstanceDynamic::Create(IslandMaterial, this);
 		SetMaterialParameters(MaterialInstance);
 		GetDynamicMeshComponent()->SetMaterial(0, MaterialInstance);
 	}
 	PostGenerateIsland(true);
+	if (bConvertToStaticMesh && !bHeadless)
+		ConvertToStaticMesh();
 	return true;
 }
 
@@ -46,6 +63,233 @@ void AIslandDynamicMeshActorBase::PostGenerateIsland_Implementation(bool bSuccee
 	// Empty
 }
 
+bool AIslandDynamicMeshActorBase::ConvertToStaticMesh()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(AIslandDynamicMeshActorBase::ConvertToStaticMesh)
+	check(IsInGameThread());
+	using namespace UE::Geometry;
+	FDynamicMesh3 Mesh;
+	DynamicMeshComponent->GetDynamicMesh()->ProcessMesh([&Mesh](const FDynamicMesh3& ReadMesh)
+	{
+		Mesh = ReadMesh;
+	});
+	if (Mesh.TriangleCount() == 0)
+	{
+		UE_LOG(LogMapGen, Warning, TEXT("%s has no island mesh to convert into a static mesh."), *GetName());
+		return false;
+	}
+	// Drops a conversion still in flight along with its ticker
+	ResetStaticMesh();
+
+	// The mesh description is built from the copy on a worker, only the static mesh is set up on the game thread
+	const int32 Serial = ++ConversionSerial;
+	TSharedRef<FMeshDescription, ESPMode::ThreadSafe> MeshDescription = MakeShared<FMeshDescription, ESPMode::ThreadSafe>();
+	FGraphEventArray Prerequisites;
+	Prerequisites.Emplace(FFunctionGraphTask::CreateAndDispatchWhenReady([MeshDescription, Mesh = MoveTemp(Mesh)]
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(AIslandDynamicMeshActorBase::ConvertMeshDescription)
+		FStaticMeshAttributes Attributes(*MeshDescription);
+		Attributes.Register();
+		FDynamicMeshToMeshDescription Converter;
+		Converter.Convert(&Mesh, *MeshDescription);
+	}));
+	FFunctionGraphTask::CreateAndDispatchWhenReady(
+		[WeakThis = TWeakObjectPtr<AIslandDynamicMeshActorBase>(this), Serial, MeshDescription]
+		{
+			AIslandDynamicMeshActorBase* This = WeakThis.Get();
+			if (This != nullptr && This->ConversionSerial == Serial)
+			{
+				This->BuildStaticMesh(MoveTemp(*MeshDescription));
+			}
+		}, TStatId(), &Prerequisites, ENamedThreads::GameThread);
+	return true;
+}
+
+void AIslandDynamicMeshActorBase::PostConvertToStaticMesh_Implementation(bool bSucceed)
+{
+	// Empty
+}
+
+void AIslandDynamicMeshActorBase::BuildStaticMesh(FMeshDescription&& MeshDescription)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(AIslandDynamicMeshActorBase::BuildStaticMesh)
+	PendingStaticMesh = NewObject<UStaticMesh>(this, NAME_None, RF_Transient);
+	PendingStaticMesh->GetStaticMaterials().Emplace(DynamicMeshComponent->GetMaterial(0));
+#if WITH_EDITOR
+	// Built by the static mesh compiling manager, which runs the Nanite builder on workers where it can
+	PendingStaticMesh->NaniteSettings.bEnabled = true;
+	PendingStaticMesh->SetNumSourceModels(1);
+	FMeshBuildSettings& BuildSettings = PendingStaticMesh->GetSourceModel(0).BuildSettings;
+	BuildSettings.bRecomputeNormals = false;
+	BuildSettings.bGenerateLightmapUVs = false;
+	PendingStaticMesh->CreateMeshDescription(0, MoveTemp(MeshDescription));
+	PendingStaticMesh->CommitMeshDescription(0);
+	PendingStaticMesh->Build(true);
+#else
+	UStaticMesh::FBuildMeshDescriptionsParams Params;
+	Params.bFastBuild = true;
+	Params.bAllowCpuAccess = false;
+	if (!PendingStaticMesh->BuildFromMeshDescriptions({&MeshDescription}, Params))
+	{
+		UE_LOG(LogMapGen, Error, TEXT("Failed to build the static mesh of %s."), *GetName());
+		PendingStaticMesh = nullptr;
+		PostConvertToStaticMesh(false);
+		return;
+	}
+#endif
+	if (PendingStaticMesh->IsCompiling())
+	{
+		ConversionTickerHandle = FTSTicker::GetCoreTicker().AddTicker(
+			FTickerDelegate::CreateUObject(this, &AIslandDynamicMeshActorBase::TickStaticMeshBuild));
+	}
+	else
+	{
+		ShowStaticMesh();
+	}
+}
+
+bool AIslandDynamicMeshActorBase::TickStaticMeshBuild(float DeltaTime)
+{
+	if (!IsValid(PendingStaticMesh))
+	{
+		ConversionTickerHandle.Reset();
+		return false;
+	}
+	if (PendingStaticMesh->IsCompiling())
+	{
+		return true;
+	}
+	ConversionTickerHandle.Reset();
+	ShowStaticMesh();
+	return false;
+}
+
+void AIslandDynamicMeshActorBase::ShowStaticMesh()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(AIslandDynamicMeshActorBase::ShowStaticMesh)
+	IslandStaticMesh = PendingStaticMesh;
+	PendingStaticMesh = nullptr;
+	if (!IsValid(StaticMeshComponent))
+	{
+		StaticMeshComponent = NewObject<UStaticMeshComponent>(this, TEXT("IslandStaticMeshComponent"), RF_Transient);
+		StaticMeshComponent->SetupAttachment(DynamicMeshComponent);
+		StaticMeshComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		StaticMeshComponent->RegisterComponent();
+	}
+	StaticMeshComponent->SetStaticMesh(IslandStaticMesh);
+	StaticMeshComponent->SetMaterial(0, DynamicMeshComponent->GetMaterial(0));
+	StaticMeshComponent->SetVisibility(true);
+
+	// Collision stays on the dynamic mesh component, its simple shapes outlive the mesh
+	DynamicMeshComponent->SetVisibility(false);
+	LODMeshes.Reset();
+	if (!DynamicMeshComponent->bEnableComplexCollision)
+	{
+		DynamicMeshComponent->GetDynamicMesh()->Reset();
+	}
+	PostConvertToStaticMesh(true);
+}
+
+void AIslandDynamicMeshActorBase::ResetStaticMesh()
+{
+	++ConversionSerial;
+	if (ConversionTickerHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(ConversionTickerHandle);
+		ConversionTickerHandle.Reset();
+	}
+	PendingStaticMesh = nullptr;
+	IslandStaticMesh = nullptr;
+	if (IsValid(StaticMeshComponent))
+	{
+		StaticMeshComponent->SetStaticMesh(nullptr);
+		StaticMeshComponent->SetVisibility(false);
+	}
+	DynamicMeshComponent->SetVisibility(true);
+}
+
+void AIslandDynamicMeshActorBase::BeginDestroy()
+{
+	if (ConversionTickerHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(ConversionTickerHandle);
+		ConversionTickerHandle.Reset();
+	}
+	Super::BeginDestroy();
+}
+
+bool AIslandDynamicMeshActorBase::CopyToStaticMesh(UStaticMesh* StaticMesh)
+{
+#if WITH_EDITOR
+	if (!IsValid(StaticMesh))
+	{
+		UE_LOG(LogMapGen, Error, TEXT("Cannot copy the island mesh into an invalid static mesh."));
+		return false;
+	}
+	TArray<UDynamicMesh*> SourceMeshes = {DynamicMeshComponent->GetDynamicMesh()};
+	SourceMeshes.Append(LODMeshes);
+	for (int32 LODIndex = 0; LODIndex < SourceMeshes.Num(); ++LODIndex)
+	{
+		FGeometryScriptMeshWriteLOD TargetLOD;
+		TargetLOD.LODIndex = LODIndex;
+		EGeometryScriptOutcomePins Outcome;
+		UGeometryScriptLibrary_StaticMeshFunctions::CopyMeshToStaticMesh(
+			SourceMeshes[LODIndex], StaticMesh, FGeometryScriptCopyMeshToAssetOptions(), TargetLOD, Outcome);
+		if (Outcome != EGeometryScriptOutcomePins::Success)
+		{
+			UE_LOG(LogMapGen, Error, TEXT("Failed to write LOD %d of the island mesh."), LODIndex);
+			return false;
+		}
+	}
+	return true;
+#else
+	UE_LOG(LogMapGen, Error, TEXT("%s can only copy its mesh into a static mesh asset in the editor."), *GetName());
+	return false;
+#endif
+}
+
+void AIslandDynamicMeshActorBase::GenerateLODs(const UDynamicMesh* SourceMesh, const FTransform& Transform)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(AIslandDynamicMeshActorBase::GenerateLODs)
+	using namespace UE::Geometry;
+	FDynamicMesh3 Source;
+	SourceMesh->ProcessMesh([&Source](const FDynamicMesh3& ReadMesh)
+	{
+		Source = ReadMesh;
+	});
+	// The same vertices are locked in every LOD so neighbouring islands and the sea keep meeting them
+	FMeshConstraints Constraints;
+	const FTransform InverseTransform = Transform.Inverse();
+	for (const int32 VertexID : Source.VertexIndicesItr())
+	{
+		const FVector MapPosition = InverseTransform.TransformPosition(Source.GetVertex(VertexID));
+		if (Source.IsBoundaryVertex(VertexID)
+			|| FMath::Abs(MapData->GetSignedCoastDistance(FVector2D(MapPosition), LODCoastlineTolerance))
+			< LODCoastlineTolerance)
+		{
+			Constraints.SetOrUpdateVertexConstraint(VertexID, FVertexConstraint(true, false));
+		}
+	}
+
+	TArray<FDynamicMesh3> Results;
+	Results.SetNum(LODTriangleRatios.Num());
+	ParallelFor(Results.Num(), [&](const int32 LODIndex)
+	{
+		FDynamicMesh3& Result = Results[LODIndex];
+		Result = Source;
+		FQEMSimplification Simplifier(&Result);
+		Simplifier.SetExternalConstraints(Constraints);
+		Simplifier.SimplifyToTriangleCount(
+			FMath::Max(FMath::RoundToInt32(Source.TriangleCount() * LODTriangleRatios[LODIndex]), 1));
+	});
+	for (FDynamicMesh3& Result : Results)
+	{
+		UDynamicMesh* LODMesh = NewObject<UDynamicMesh>(this);
+		LODMesh->SetMesh(MoveTemp(Result));
+		LODMeshes.Emplace(LODMesh);
+	}
+}
+
 void AIslandDynamicMeshActorBase::GenerateIslandTexture()
 {
 	// Empty
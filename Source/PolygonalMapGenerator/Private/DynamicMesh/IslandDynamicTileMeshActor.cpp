@@ -1,8 +1,12 @@
 ﻿#include "DynamicMesh/IslandDynamicTileMeshActor.h"
+#include "DynamicMesh/IslandTileMeshComponent.h"
 #include "DynamicMeshActor.h"
 #include "GeometryScript/GeometryScriptTypes.h"
 #include "GeometryScript/MeshBasicEditFunctions.h"
-#include "GeometryScript/MeshNormalsFunctions.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "DynamicMesh/DynamicMesh3.h"
+#include "DynamicMeshEditor.h"
 
 DEFINE_LOG_CATEGORY(LogIslandDynamicActor)
 
@@ -22,84 +26,546 @@ void AIslandDynamicTileMeshActor::AsyncGenerateDynamicMesh(UIslandDynamicAssets*
 	}
 	Assets = InAssets;
 	CompletedTilesCount = 0;
+	bIslandCompleted = false;
 	SpawnedTileActorsCount = 0;
+	SpawningTile = INDEX_NONE;
+	SpawnStats = FTileSpawnStats();
 	int32 TileAmount = Assets->GetTileAmount();
-	TileActors.SetNum(TileAmount);
+	TileCollisionReady.Init(false, TileAmount);
+	TileBuilt.Init(false, TileAmount);
+	TileCompleted.Init(false, TileAmount);
+	CookingCollisionTiles.Reset();
+	TileActors.Init(nullptr, TileAmount);
+	TileComponents.Init(nullptr, TileAmount);
+	BatchComponents.Reset();
+	BatchPendingTiles.Reset();
+	if (SpawnMode == ETileSpawnMode::TSM_MergedBatches)
+	{
+		for (int32 Index = 0; Index < TileAmount; ++Index)
+		{
+			const int32 Batch = GetTileBatch(Index);
+			if (Batch >= BatchPendingTiles.Num())
+			{
+				BatchPendingTiles.SetNumZeroed(Batch + 1);
+			}
+			++BatchPendingTiles[Batch];
+		}
+		BatchComponents.SetNumZeroed(BatchPendingTiles.Num());
+	}
+	SharedMaterialInstance = nullptr;
+	FGraphEventArray CreateMaterialPrerequisites;
+	CreateMaterialPrerequisites.Emplace(Assets->GenDistrictIDTextureTask);
+	CreateMaterialTask = FFunctionGraphTask::CreateAndDispatchWhenReady([this]
+	{
+		// Headless assets have no textures to bind and nothing renders the tiles
+		if (IsValid(IslandMaterial) && !Assets->IsHeadless())
+		{
+			SharedMaterialInstance = UMaterialInstanceDynamic::Create(IslandMaterial, this);
+			SharedMaterialInstance->SetTextureParameterValue(DistrictIDTexture01ParamName,
+			                                                 Assets->GetDistrictIDTexture01());
+			SharedMaterialInstance->SetTextureParameterValue(DistrictIDTexture02ParamName,
+			                                                 Assets->GetDistrictIDTexture02());
+		}
+	}, TStatId(), &CreateMaterialPrerequisites, ENamedThreads::GameThread);
+	const FIslandAssetsCancelToken Token = Assets->GetCancelToken();
 	for (int32 Index = 0; Index < TileAmount; ++Index)
 	{
 		FGraphEventArray ApplyBuffersPrerequisites;
 		ApplyBuffersPrerequisites.Emplace(Assets->TileInfo[Index].Task);
-		FFunctionGraphTask::CreateAndDispatchWhenReady([this, Index]
+		FFunctionGraphTask::CreateAndDispatchWhenReady([this, Index, Token]
 		{
-			TileToSpawnQueue.Enqueue(Index);
+			// Tiles of a cancelled run were never built
+			if (!Token.IsValid() || !Token->load())
+			{
+				TileToSpawnQueue.Enqueue(Index);
+			}
 		}, TStatId(), &ApplyBuffersPrerequisites);
 	}
 }
 
-void AIslandDynamicTileMeshActor::CheckIfAllTilesAreCompleted()
+void AIslandDynamicTileMeshActor::AddStreamingViewer(AActor* Viewer)
 {
-	if (++CompletedTilesCount == Assets->GetTileAmount())
+	if (IsValid(Viewer))
 	{
-		PostGenerateIsland(true);
+		StreamingViewers.AddUnique(Viewer);
 	}
 }
 
-void AIslandDynamicTileMeshActor::Tick(float DeltaSeconds)
+void AIslandDynamicTileMeshActor::RemoveStreamingViewer(AActor* Viewer)
 {
-	const FTimespan MaxTick(ETimespan::TicksPerSecond * MaxSpawnTileTickTime);
-	FDateTime TickStartTime = FDateTime::Now();
-	Super::Tick(DeltaSeconds);
-	while (SpawnedTileActorsCount < Assets->GetTileAmount())
+	StreamingViewers.Remove(Viewer);
+}
+
+void AIslandDynamicTileMeshActor::SetStreamingPoints(const TArray<FVector>& Points)
+{
+	StreamingPoints = Points;
+}
+
+void AIslandDynamicTileMeshActor::GatherStreamingLocations(TArray<FVector>& OutLocations) const
+{
+	OutLocations = StreamingPoints;
+	for (const TWeakObjectPtr<AActor>& Viewer : StreamingViewers)
 	{
-		if (int32 TaskIndex; TileToSpawnQueue.Dequeue(TaskIndex))
+		if (Viewer.IsValid())
+		{
+			OutLocations.Emplace(Viewer->GetActorLocation());
+		}
+	}
+	if (!OutLocations.IsEmpty())
+	{
+		return;
+	}
+	for (FConstPlayerControllerIterator Iterator = GetWorld()->GetPlayerControllerIterator(); Iterator; ++Iterator)
+	{
+		if (const APlayerController* PlayerController = Iterator->Get())
+		{
+			FVector Location;
+			FRotator Rotation;
+			PlayerController->GetPlayerViewPoint(Location, Rotation);
+			OutLocations.Emplace(Location);
+		}
+	}
+}
+
+double AIslandDynamicTileMeshActor::GetTileViewerDistance(const int32 TileIndex, const TArray<FVector>& Locations) const
+{
+	// Nothing to stream around, every tile counts as in range
+	if (Locations.IsEmpty())
+	{
+		return 0.;
+	}
+	const FVector TileCenter = GetActorTransform().TransformPosition(GetTileLocation(TileIndex));
+	double Distance = TNumericLimits<double>::Max();
+	for (const FVector& Location : Locations)
+	{
+		Distance = FMath::Min(Distance, FVector::Dist2D(TileCenter, Location));
+	}
+	return Distance;
+}
+
+int32 AIslandDynamicTileMeshActor::FindNextStreamingTile(const TArray<FVector>& Locations) const
+{
+	int32 NextTile = INDEX_NONE;
+	double NextDistance = StreamingRadius;
+	for (TConstSetBitIterator<> It(TileBuilt); It; ++It)
+	{
+		const int32 TileIndex = It.GetIndex();
+		if (TileComponents[TileIndex] != nullptr)
+		{
+			continue;
+		}
+		const double Distance = GetTileViewerDistance(TileIndex, Locations);
+		if (Distance <= NextDistance)
+		{
+			NextTile = TileIndex;
+			NextDistance = Distance;
+		}
+	}
+	return NextTile;
+}
+
+void AIslandDynamicTileMeshActor::UnloadDistantTiles(const TArray<FVector>& Locations)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(AIslandDynamicTileMeshActor::UnloadDistantTiles)
+	if (SpawnMode == ETileSpawnMode::TSM_MergedBatches)
+	{
+		return;
+	}
+	for (int32 TileIndex = 0; TileIndex < TileComponents.Num(); ++TileIndex)
+	{
+		if (TileComponents[TileIndex] == nullptr || TileIndex == SpawningTile
+			|| GetTileViewerDistance(TileIndex, Locations) <= UnloadRadius)
+		{
+			continue;
+		}
+		// The buffers stay in the assets, a tile coming back into range is rebuilt from them
+		DestroyTile(TileIndex);
+	}
+}
+
+int32 AIslandDynamicTileMeshActor::GetTileBatch(const int32 TileIndex) const
+{
+	const int32 TilesPerSide = Assets->TileDivisions + 1;
+	const int32 BatchSide = FMath::Max(TilesPerBatchSide.GetValue(), 1);
+	const int32 BatchesPerSide = FMath::DivideAndRoundUp(TilesPerSide, BatchSide);
+	return TileIndex / TilesPerSide / BatchSide * BatchesPerSide + TileIndex % TilesPerSide / BatchSide;
+}
+
+bool AIslandDynamicTileMeshActor::CanRespawnTiles() const
+{
+	// Merged batches are never unloaded
+	return bStreamTiles && SpawnMode != ETileSpawnMode::TSM_MergedBatches;
+}
+
+FVector AIslandDynamicTileMeshActor::GetTileLocation(const int32 TileIndex) const
+{
+	const FVector2D Offset = Assets->MapData->GetMapSize() * Pivot;
+	return FVector(Assets->TileInfo[TileIndex].TileCenter - Offset, 0);
+}
+
+void AIslandDynamicTileMeshActor::SpawnTile(const int32 TileIndex)
+{
+	const FDynamicTileInfo& TileInfo = Assets->TileInfo[TileIndex];
+	const FVector Location = GetTileLocation(TileIndex);
+	switch (SpawnMode)
+	{
+	case ETileSpawnMode::TSM_Actors:
 		{
-			++SpawnedTileActorsCount;
-			FDynamicTileInfo TileInfo = Assets->TileInfo[TaskIndex];
-			TRACE_CPUPROFILER_EVENT_SCOPE(AsyncGenerateDynamicMesh::SpawnTileActor);
 			FActorSpawnParameters SpawnParameters;
 			SpawnParameters.Name =
 				FName(FString::Printf(TEXT("IslandDynamicTileActor_%d_%d"), TileInfo.TileRow, TileInfo.TileCol));
-			FVector2D Offset = Assets->MapData->GetMapSize() * Pivot;
-			FVector Location = FVector::Zero();
-			Location.X = TileInfo.TileCenter.X - Offset.X;
-			Location.Y = TileInfo.TileCenter.Y - Offset.Y;
-			ADynamicMeshActor* TileActor = GetWorld()->SpawnActor<ADynamicMeshActor>(
+			// A streamed tile can come back before its destroyed actor released the name
+			SpawnParameters.NameMode = FActorSpawnParameters::ESpawnActorNameMode::Requested;
+			AIslandTileMeshActor* TileActor = GetWorld()->SpawnActor<AIslandTileMeshActor>(
 				Location, FRotator::ZeroRotator, SpawnParameters);
-			TileActors[TaskIndex] = TileActor;
 			TileActor->AttachToActor(this, FAttachmentTransformRules(EAttachmentRule::KeepRelative, false));
+			TileActors[TileIndex] = TileActor;
+			TileComponents[TileIndex] = TileActor->GetDynamicMeshComponent();
+			break;
+		}
+	case ETileSpawnMode::TSM_Components:
+		{
+			UDynamicMeshComponent* Component = NewObject<UIslandTileMeshComponent>(this, MakeUniqueObjectName(
+				this, UIslandTileMeshComponent::StaticClass(),
+				FName(FString::Printf(TEXT("IslandTile_%d_%d"), TileInfo.TileRow, TileInfo.TileCol))));
+			Component->SetupAttachment(RootComponent);
+			Component->SetRelativeLocation(Location);
+			Component->RegisterComponent();
+			AddInstanceComponent(Component);
+			TileComponents[TileIndex] = Component;
+			break;
+		}
+	case ETileSpawnMode::TSM_MergedBatches:
+		{
+			const int32 Batch = GetTileBatch(TileIndex);
+			if (BatchComponents[Batch] == nullptr)
+			{
+				UDynamicMeshComponent* Component = NewObject<UIslandTileMeshComponent>(this, MakeUniqueObjectName(
+					this, UIslandTileMeshComponent::StaticClass(),
+					FName(FString::Printf(TEXT("IslandTileBatch_%d"), Batch))));
+				Component->SetupAttachment(RootComponent);
+				Component->RegisterComponent();
+				AddInstanceComponent(Component);
+				BatchComponents[Batch] = Component;
+			}
+			TileComponents[TileIndex] = BatchComponents[Batch];
+			break;
+		}
+	}
+}
+
+void AIslandDynamicTileMeshActor::DestroyTile(const int32 TileIndex)
+{
+	if (TileActors[TileIndex] != nullptr)
+	{
+		TileActors[TileIndex]->Destroy();
+		TileActors[TileIndex] = nullptr;
+	}
+	else if (TileComponents[TileIndex] != nullptr)
+	{
+		TileComponents[TileIndex]->DestroyComponent();
+	}
+	TileComponents[TileIndex] = nullptr;
+	TileCollisionReady[TileIndex] = false;
+	CookingCollisionTiles.Remove(TileIndex);
+	--SpawnedTileActorsCount;
+}
 
-			UDynamicMeshComponent* DynamicMeshComponent = TileActor->GetDynamicMeshComponent();
-			UDynamicMesh* DynamicMesh = DynamicMeshComponent->GetDynamicMesh();
-			FGeometryScriptIndexList TriangleIndices;
+void AIslandDynamicTileMeshActor::ApplyTileMaterial(UDynamicMeshComponent* Component, const int32 TileIndex)
+{
+	const FDynamicTileInfo& TileInfo = Assets->TileInfo[TileIndex];
+	if (SharedMaterialInstance != nullptr)
+	{
+		Component->SetMaterial(0, SharedMaterialInstance);
+	}
+	if (Assets->HasRiverRibbons())
+	{
+		Component->SetMaterial(UIslandDynamicAssets::RiverMaterialID, Assets->RiverMaterial);
+	}
+	if (TileCustomPrimitiveDataIndex != INDEX_NONE && SpawnMode != ETileSpawnMode::TSM_MergedBatches)
+	{
+		Component->SetCustomPrimitiveDataFloat(TileCustomPrimitiveDataIndex, TileInfo.TileRow);
+		Component->SetCustomPrimitiveDataFloat(TileCustomPrimitiveDataIndex + 1, TileInfo.TileCol);
+	}
+	// A merged batch completes all of its tiles at once
+	for (int32 Index = 0; Index < TileComponents.Num(); ++Index)
+	{
+		if (TileComponents[Index] == Component && !TileCompleted[Index])
+		{
+			TileCompleted[Index] = true;
+			CheckIfAllTilesAreCompleted();
+		}
+	}
+}
 
-			UGeometryScriptLibrary_MeshBasicEditFunctions::AppendBuffersToMesh(
-				DynamicMesh, TileInfo.Buffers, TriangleIndices, 0, true
-			);
-			UGeometryScriptLibrary_MeshNormalsFunctions::SetPerVertexNormals(DynamicMesh);
-			if (bGenerateCollision)
+bool AIslandDynamicTileMeshActor::IsTileCollisionReady(const int32 TileIndex) const
+{
+	return TileCollisionReady.IsValidIndex(TileIndex) && TileCollisionReady[TileIndex];
+}
+
+void AIslandDynamicTileMeshActor::UpdateCookingCollisionTiles()
+{
+	for (int32 Index = CookingCollisionTiles.Num() - 1; Index >= 0; --Index)
+	{
+		const int32 TileIndex = CookingCollisionTiles[Index];
+		const UDynamicMeshComponent* Component = TileComponents[TileIndex];
+		// The body is only created once the cooked mesh arrives
+		if (!IsValid(Component) || Component->GetBodyInstance()->IsValidBodyInstance())
+		{
+			for (int32 Other = 0; Other < TileComponents.Num(); ++Other)
 			{
-				UGeometryScriptLibrary_CollisionFunctions::SetDynamicMeshCollisionFromMesh(
-					DynamicMesh, DynamicMeshComponent, GenerateCollisionOptions);
+				if (TileComponents[Other] == Component)
+				{
+					TileCollisionReady[Other] = IsValid(Component);
+				}
 			}
-			FGraphEventArray SetMaterialsPrerequisites;
-			SetMaterialsPrerequisites.Emplace(Assets->GenDistrictIDTextureTask);
-			FFunctionGraphTask::CreateAndDispatchWhenReady([this, TileActor]
+			CookingCollisionTiles.RemoveAtSwap(Index);
+		}
+	}
+}
+
+void AIslandDynamicTileMeshActor::CheckIfAllTilesAreCompleted()
+{
+	if (++CompletedTilesCount == Assets->GetTileAmount() && !bIslandCompleted)
+	{
+		bIslandCompleted = true;
+		PostGenerateIsland(true);
+	}
+}
+
+void AIslandDynamicTileMeshActor::CheckIfStreamedTilesAreCompleted(const TArray<FVector>& Locations)
+{
+	if (bIslandCompleted || SpawningTile != INDEX_NONE
+		|| TileBuilt.CountSetBits() != Assets->GetTileAmount())
+	{
+		return;
+	}
+	// Tiles out of range may never spawn, the island is done once the ones in range are
+	for (int32 TileIndex = 0; TileIndex < TileComponents.Num(); ++TileIndex)
+	{
+		if ((TileComponents[TileIndex] == nullptr || !TileCompleted[TileIndex])
+			&& GetTileViewerDistance(TileIndex, Locations) <= StreamingRadius)
+		{
+			return;
+		}
+	}
+	bIslandCompleted = true;
+	PostGenerateIsland(true);
+}
+
+void AIslandDynamicTileMeshActor::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+	if (!Assets)
+	{
+		return;
+	}
+	UpdateCookingCollisionTiles();
+	const double TickStartTime = FPlatformTime::Seconds();
+	TArray<FVector> StreamingLocations;
+	if (bStreamTiles)
+	{
+		for (int32 TileIndex; TileToSpawnQueue.Dequeue(TileIndex);)
+		{
+			TileBuilt[TileIndex] = true;
+		}
+		GatherStreamingLocations(StreamingLocations);
+		UnloadDistantTiles(StreamingLocations);
+	}
+	double Now = TickStartTime;
+	bool bWorked = false;
+	for (;;)
+	{
+		if (SpawningTile == INDEX_NONE)
+		{
+			if (bStreamTiles)
 			{
-				UDynamicMeshComponent* DynamicMeshComponent = TileActor->GetDynamicMeshComponent();
-				if (IsValid(IslandMaterial))
+				SpawningTile = FindNextStreamingTile(StreamingLocations);
+				if (SpawningTile == INDEX_NONE)
 				{
-					UMaterialInstanceDynamic* MaterialInstance = UMaterialInstanceDynamic::Create(IslandMaterial, this);
-					MaterialInstance->SetTextureParameterValue(DistrictIDTexture01ParamName,
-					                                           Assets->GetDistrictIDTexture01());
-					MaterialInstance->SetTextureParameterValue(DistrictIDTexture02ParamName,
-					                                           Assets->GetDistrictIDTexture02());
-					DynamicMeshComponent->SetMaterial(0, MaterialInstance);
+					break;
 				}
-				CheckIfAllTilesAreCompleted();
-			}, TStatId(), &SetMaterialsPrerequisites, ENamedThreads::GameThread);
+			}
+			else if (!TileToSpawnQueue.Dequeue(SpawningTile))
+			{
+				break;
+			}
+			SpawningPhase = ETileSpawnPhase::TSP_Spawn;
 		}
-		if (FDateTime::Now() - TickStartTime > MaxTick)
+		const ETileSpawnPhase Phase = SpawningPhase;
+		RunTileSpawnPhase();
+		const double PhaseEnd = FPlatformTime::Seconds();
+		const double PhaseSeconds = PhaseEnd - Now;
+		Now = PhaseEnd;
+		bWorked = true;
+		switch (Phase)
 		{
+		case ETileSpawnPhase::TSP_Spawn:
+			SpawnStats.SpawnSeconds += PhaseSeconds;
+			break;
+		case ETileSpawnPhase::TSP_Mesh:
+			SpawnStats.MeshSeconds += PhaseSeconds;
+			break;
+		case ETileSpawnPhase::TSP_Collision:
+			SpawnStats.CollisionSeconds += PhaseSeconds;
+			break;
+		case ETileSpawnPhase::TSP_Material:
+			SpawnStats.MaterialSeconds += PhaseSeconds;
+			break;
+		}
+		if (Now - TickStartTime > MaxSpawnTileTickTime)
+		{
+			break;
+		}
+	}
+	if (bWorked)
+	{
+		++SpawnStats.TickCount;
+		SpawnStats.MaxTickSeconds = FMath::Max(SpawnStats.MaxTickSeconds, Now - TickStartTime);
+	}
+	if (bStreamTiles)
+	{
+		CheckIfStreamedTilesAreCompleted(StreamingLocations);
+	}
+}
+
+void AIslandDynamicTileMeshActor::RunTileSpawnPhase()
+{
+	const int32 TileIndex = SpawningTile;
+	FDynamicTileInfo& TileInfo = Assets->TileInfo[TileIndex];
+	switch (SpawningPhase)
+	{
+	case ETileSpawnPhase::TSP_Spawn:
+		{
+			TRACE_CPUPROFILER_EVENT_SCOPE(AsyncGenerateDynamicMesh::SpawnTileActor);
+			++SpawnedTileActorsCount;
+			SpawnTile(TileIndex);
+			SpawningPhase = ETileSpawnPhase::TSP_Mesh;
+			break;
+		}
+	case ETileSpawnPhase::TSP_Mesh:
+		{
+			TRACE_CPUPROFILER_EVENT_SCOPE(AsyncGenerateDynamicMesh::SetTileMesh);
+			UDynamicMesh* DynamicMesh = TileComponents[TileIndex]->GetDynamicMesh();
+			if (SpawnMode == ETileSpawnMode::TSM_MergedBatches)
+			{
+				TSharedPtr<UE::Geometry::FDynamicMesh3, ESPMode::ThreadSafe> TileMesh = TileInfo.Mesh;
+				if (!TileMesh.IsValid())
+				{
+					TileMesh = MakeShared<UE::Geometry::FDynamicMesh3, ESPMode::ThreadSafe>();
+					UIslandDynamicAssets::BuildTileMesh(*TileMesh, TileInfo.Buffers, !Assets->IsHeadless());
+				}
+				const FVector3d Location = GetTileLocation(TileIndex);
+				DynamicMesh->EditMesh([&](FDynamicMesh3& EditMesh)
+				{
+					if (EditMesh.TriangleCount() == 0)
+					{
+						EditMesh.EnableMatchingAttributes(*TileMesh);
+					}
+					UE::Geometry::FDynamicMeshEditor Editor(&EditMesh);
+					UE::Geometry::FMeshIndexMappings Mappings;
+					Editor.AppendMesh(TileMesh.Get(), Mappings, [Location](int32, const FVector3d& Position)
+					{
+						return Position + Location;
+					});
+				});
+				TileInfo.Mesh.Reset();
+				if (!bKeepTileBuffers)
+				{
+					TileInfo.Buffers = FGeometryScriptSimpleMeshBuffers();
+				}
+				// Collision and material wait for the last tile of the batch
+				if (--BatchPendingTiles[GetTileBatch(TileIndex)] > 0)
+				{
+					SpawningTile = INDEX_NONE;
+					break;
+				}
+			}
+			else if (TileInfo.Mesh.IsValid())
+			{
+				// Appending and normals already ran on the tile task
+				DynamicMesh->SetMesh(MoveTemp(*TileInfo.Mesh));
+				TileInfo.Mesh.Reset();
+			}
+			else
+			{
+				// AppendBuffersToMesh would put the river ribbons on material 0 as well
+				UE::Geometry::FDynamicMesh3 TileMesh;
+				UIslandDynamicAssets::BuildTileMesh(TileMesh, TileInfo.Buffers, !Assets->IsHeadless());
+				DynamicMesh->SetMesh(MoveTemp(TileMesh));
+			}
+			if (!bKeepTileBuffers && !CanRespawnTiles())
+			{
+				TileInfo.Buffers = FGeometryScriptSimpleMeshBuffers();
+			}
+			SpawningPhase = bGenerateCollision ? ETileSpawnPhase::TSP_Collision : ETileSpawnPhase::TSP_Material;
+			break;
+		}
+	case ETileSpawnPhase::TSP_Collision:
+		{
+			TRACE_CPUPROFILER_EVENT_SCOPE(AsyncGenerateDynamicMesh::SetTileCollision);
+			UDynamicMeshComponent* DynamicMeshComponent = TileComponents[TileIndex];
+			if (CollisionMode == ETileCollisionMode::TCM_AsyncComplex)
+			{
+				// The river ribbons are left out of the cooked triangles
+				if (UIslandTileMeshComponent* TileMeshComponent = Cast<UIslandTileMeshComponent>(DynamicMeshComponent))
+				{
+					TileMeshComponent->NoCollisionMaterialID =
+						Assets->HasRiverRibbons() ? UIslandDynamicAssets::RiverMaterialID : INDEX_NONE;
+				}
+				DynamicMeshComponent->bUseAsyncCooking = true;
+				DynamicMeshComponent->SetComplexAsSimpleCollisionEnabled(true, true);
+				CookingCollisionTiles.Add(TileIndex);
+			}
+			else
+			{
+				UDynamicMesh* CollisionMesh = DynamicMeshComponent->GetDynamicMesh();
+				if (Assets->HasRiverRibbons())
+				{
+					// The shapes are fitted to the terrain only, the ribbons float above it
+					CollisionMesh = NewObject<UDynamicMesh>(this);
+					UE::Geometry::FDynamicMesh3 TerrainMesh;
+					DynamicMeshComponent->GetDynamicMesh()->ProcessMesh([&TerrainMesh](const FDynamicMesh3& Mesh)
+					{
+						UIslandDynamicAssets::CopyTerrainMesh(Mesh, TerrainMesh);
+					});
+					CollisionMesh->SetMesh(MoveTemp(TerrainMesh));
+				}
+				UGeometryScriptLibrary_CollisionFunctions::SetDynamicMeshCollisionFromMesh(
+					CollisionMesh, DynamicMeshComponent, GenerateCollisionOptions);
+				for (int32 Index = 0; Index < TileComponents.Num(); ++Index)
+				{
+					if (TileComponents[Index] == DynamicMeshComponent)
+					{
+						TileCollisionReady[Index] = true;
+					}
+				}
+			}
+			SpawningPhase = ETileSpawnPhase::TSP_Material;
+			break;
+		}
+	case ETileSpawnPhase::TSP_Material:
+		{
+			TRACE_CPUPROFILER_EVENT_SCOPE(AsyncGenerateDynamicMesh::SetTileMaterial);
+			UDynamicMeshComponent* Component = TileComponents[TileIndex];
+			if (CreateMaterialTask->IsComplete())
+			{
+				ApplyTileMaterial(Component, TileIndex);
+			}
+			else
+			{
+				FGraphEventArray SetMaterialsPrerequisites;
+				SetMaterialsPrerequisites.Emplace(CreateMaterialTask);
+				FFunctionGraphTask::CreateAndDispatchWhenReady(
+					[this, WeakComponent = TWeakObjectPtr<UDynamicMeshComponent>(Component), TileIndex]
+					{
+						if (WeakComponent.IsValid())
+						{
+							ApplyTileMaterial(WeakComponent.Get(), TileIndex);
+						}
+					}, TStatId(), &SetMaterialsPrerequisites, ENamedThreads::GameThread);
+			}
+			SpawningTile = INDEX_NONE;
 			break;
 		}
 	}
@@ -0,0 +1,33 @@
+﻿#include "DynamicMesh/IslandTileMeshComponent.h"
+#include "Interfaces/Interface_CollisionDataProvider.h"
+
+bool UIslandTileMeshComponent::GetPhysicsTriMeshData(FTriMeshCollisionData* CollisionData, bool InUseAllTriData)
+{
+	if (!Super::GetPhysicsTriMeshData(CollisionData, InUseAllTriData))
+	{
+		return false;
+	}
+	if (NoCollisionMaterialID == INDEX_NONE || CollisionData->MaterialIndices.Num() != CollisionData->Indices.Num())
+	{
+		return true;
+	}
+	// Only the triangles are filtered, the vertices stay as they are
+	int32 KeptNum = 0;
+	for (int32 Index = 0; Index < CollisionData->Indices.Num(); ++Index)
+	{
+		if (CollisionData->MaterialIndices[Index] != NoCollisionMaterialID)
+		{
+			CollisionData->Indices[KeptNum] = CollisionData->Indices[Index];
+			CollisionData->MaterialIndices[KeptNum] = CollisionData->MaterialIndices[Index];
+			++KeptNum;
+		}
+	}
+	CollisionData->Indices.SetNum(KeptNum);
+	CollisionData->MaterialIndices.SetNum(KeptNum);
+	return KeptNum > 0;
+}
+
+AIslandTileMeshActor::AIslandTileMeshActor(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer.SetDefaultSubobjectClass<UIslandTileMeshComponent>(TEXT("DynamicMeshComponent")))
+{
+}
@@ -16,10 +16,17 @@
 * limitations under the License.
 */
 #include "Elevation/IslandElevation.h"
+#include "Async/ParallelFor.h"
+#include "Containers/Deque.h"
+#include "GenerationDiagnostics.h"
+#include "IslandMapUtils.h"
+#include "RandomSampling/CounterRandom.h"
+#include "ScratchContainers.h"
 
 TArray<FTriangleIndex> UIslandElevation::FindCoastTriangles(UTriangleDualMesh* Mesh, const TArray<bool>& r_ocean) const
 {
-	TSet<FTriangleIndex> coasts_t;
+	FMemMark mark(FMemStack::Get());
+	TScratchSet<FTriangleIndex> coasts_t;
 	for (FSideIndex s = 0; s < Mesh->NumSides; s++)
 	{
 		// Get the points at the start and end of each side
@@ -40,7 +47,7 @@ TArray<FTriangleIndex> UIslandElevation::FindCoastTriangles(UTriangleDualMesh* M
 
 bool UIslandElevation::IsTriangleOcean(FTriangleIndex t, UTriangleDualMesh* Mesh, const TArray<bool>& r_ocean) const
 {
-	TArray<FPointIndex> trianglePoints = Mesh->t_circulate_r(t);
+	const TStaticArray<FPointIndex, 3> trianglePoints = Mesh->t_circulate_r(t);
 	int count = 0;
 	for (FPointIndex r : trianglePoints)
 	{
@@ -85,7 +92,7 @@ void UIslandElevation::UpdateCoastDistance(TArray<int32> &t_coastdistance, UTria
 {
 	// Update the coast distance array to make sure we're still pointing to the nearest coast
 	t_coastdistance[Triangle] = Distance;
-	TArray<FSideIndex> out_s = Mesh->t_circulate_s(Triangle);
+	const TStaticArray<FSideIndex, 3> out_s = Mesh->t_circulate_s(Triangle);
 	for (int i = 0; i < out_s.Num(); i++)
 	{
 		FSideIndex s = out_s[i];
@@ -102,37 +109,49 @@ void UIslandElevation::AssignTriangleElevations_Implementation(TArray<float>& t_
 	// TODO: this messes up lakes, as they will no longer all be at the same elevation
 
 	// Initialize all triangles to be -1 triangles away from the nearest coast
-	t_coastdistance.Empty(Mesh->NumTriangles);
-	t_coastdistance.SetNumZeroed(Mesh->NumTriangles);
-	for (int i = 0; i < t_coastdistance.Num(); i++)
-	{
-		t_coastdistance[i] = -1;
-	}
+	UIslandMapUtils::ResetLayer(t_coastdistance, Mesh->NumTriangles, -1);
 	// Initialize all downslopes to point to an invalid index
-	t_downslope_s.Empty(Mesh->NumTriangles);
-	t_downslope_s.SetNumZeroed(Mesh->NumTriangles);
-	for (int i = 0; i < t_downslope_s.Num(); i++)
-	{
-		t_downslope_s[i] = FSideIndex();
-	}
+	UIslandMapUtils::ResetLayer(t_downslope_s, Mesh->NumTriangles, FSideIndex());
 
 	// Reset the elevation arrays to 0
-	t_elevation.Empty(Mesh->NumTriangles);
-	t_elevation.SetNumZeroed(Mesh->NumTriangles);
+	UIslandMapUtils::ResetLayer(t_elevation, Mesh->NumTriangles);
 
 	// Find all coasts and set them to be 0 distance away from the nearest coast
-	TArray<FTriangleIndex> queue_t = FindCoastTriangles(Mesh, r_ocean);
-	if (queue_t.Num() == 0)
+	const TArray<FTriangleIndex> coasts_t = FindCoastTriangles(Mesh, r_ocean);
+	if (coasts_t.Num() == 0)
 	{
 		UE_LOG(LogMapGen, Error, TEXT("No triangles were marked as coast!"));
 		return;
 	}
 
-	for (int t = 0; t < queue_t.Num(); t++)
+	FMemMark mark(FMemStack::Get());
+	// The search reaches every triangle from up to three sides, so classify each one once up front.
+	// Bit 0 is set for ocean triangles, bit 1 + i if side i of the triangle touches a lake.
+	constexpr uint8 oceanBit = 1;
+	TScratchArray<uint8> t_class;
+	t_class.SetNumUninitialized(Mesh->NumTriangles);
+	ParallelForWithDiagnostics(Mesh->NumTriangles, [this, Mesh, &r_ocean, &r_water, &t_class](const int32 t)
+	{
+		int32 bits = IsTriangleOcean(t, Mesh, r_ocean) ? oceanBit : 0;
+		for (int32 i = 0; i < 3; i++)
+		{
+			bits |= IsSideLake(FSideIndex(3 * t + i), Mesh, r_water, r_ocean) ? 2 << i : 0;
+		}
+		t_class[t] = static_cast<uint8>(bits);
+	});
+
+	// Lakes are pushed to the front and everything else to the back (a 0-1 BFS), so use a ring buffer
+	TDeque<FTriangleIndex, FScratchAllocator> queue_t;
+	queue_t.Reserve(Mesh->NumTriangles);
+	for (FTriangleIndex t : coasts_t)
 	{
-		t_coastdistance[queue_t[t]] = 0;
+		t_coastdistance[t] = 0;
+		queue_t.PushLast(t);
 	}
 
+	// The side order of a triangle only depends on the triangle, not on when the search reaches it
+	const FCounterRandom drainage(DrainageRng);
+
 	// Distance underwater to nearest shore
 	int32 minDistance = 1;
 	// Distance overland to nearest shore
@@ -140,21 +159,22 @@ void UIslandElevation::AssignTriangleElevations_Implementation(TArray<float>& t_
 	while (queue_t.Num() > 0)
 	{
 		// Get the next triangle and pop it from the queue
-		FTriangleIndex current_t = queue_t[0];
-		queue_t.RemoveAt(0);
+		FTriangleIndex current_t = queue_t.First();
+		queue_t.PopFirst();
 		// Find all sides of the current triangle
-		TArray<FSideIndex> out_s = Mesh->t_circulate_s(current_t);
+		const TStaticArray<FSideIndex, 3> out_s = Mesh->t_circulate_s(current_t);
 
 		// Iterate over each side of the triangle, starting from a random offset
-		int32 iOffset = DrainageRng.RandRange(0, out_s.Num() - 1);
+		int32 iOffset = drainage.RandRange(current_t, 0, out_s.Num() - 1);
 		for (int i = 0; i < out_s.Num(); i++)
 		{
 			// Get the index of the side we're working on
-			FSideIndex s = out_s[(i + iOffset) % out_s.Num()];
+			const int32 side = (i + iOffset) % out_s.Num();
+			FSideIndex s = out_s[side];
 			// Check to see if this side is a lake
 			// If it is, keep the distance from the nearest coast the same (to ensure that lakes keep elevation)
 			// If it isn't, increment the distance from the nearest coast
-			bool lake = IsSideLake(s, Mesh, r_water, r_ocean);
+			bool lake = (t_class[current_t] & (2 << side)) != 0;
 			int32 newDistance = (lake ? 0 : 1) + t_coastdistance[current_t];
 
 			// Get the next triangle down the line
@@ -170,32 +190,40 @@ void UIslandElevation::AssignTriangleElevations_Implementation(TArray<float>& t_
 
 				// If this tile is ocean, see if we need to update how far away this underwater tile 
 				// is from a coast
-				if (IsTriangleOcean(neighbor_t, Mesh, r_ocean) && newDistance > minDistance) { minDistance = newDistance; }
+				const bool bNeighborOcean = (t_class[neighbor_t] & oceanBit) != 0;
+				if (bNeighborOcean && newDistance > minDistance) { minDistance = newDistance; }
 				// If this tile is land, see if we need to update how far away this land tile is from a coast
-				else if (!IsTriangleOcean(neighbor_t, Mesh, r_ocean) && newDistance > maxDistance) { maxDistance = newDistance; }
+				else if (!bNeighborOcean && newDistance > maxDistance) { maxDistance = newDistance; }
 
 				if (lake)
 				{
 					// If we're a lake, make sure we're processed next
-					queue_t.Insert(neighbor_t, 0);
+					queue_t.PushFirst(neighbor_t);
 				}
 				else
 				{
 					// Otherwise, add us to the end of the queue
-					queue_t.Add(neighbor_t);
+					queue_t.PushLast(neighbor_t);
 				}
 			}
 		}
 
 		if (queue_t.Num() == 0)
 		{
+			// Counted by the generation, or logged once here outside of one
+			int32 unreached = 0;
 			for (FTriangleIndex t = 0; t < t_coastdistance.Num(); t++)
 			{
-				if (t_coastdistance[t] == -1)
+				if (t_coastdistance[t] == -1
+					&& !FGenerationDiagnostics::AddActive(TEXT("Triangle without a coast distance"), t))
 				{
-					UE_LOG(LogMapGen, Warning, TEXT("Found unitialized coast distance triangle: %d"), static_cast<int32>(t));
+					unreached++;
 				}
 			}
+			if (unreached > 0)
+			{
+				UE_LOG(LogMapGen, Warning, TEXT("Found %d unitialized coast distance triangles."), unreached);
+			}
 		}
 	}
 
@@ -209,8 +237,10 @@ void UIslandElevation::RedistributeTriangleElevations_Implementation(TArray<floa
 	// elevation barely shows up on the map, so we set it to 1.1.
 	const float SCALE_FACTOR = 1.1f;
 
-	TArray<FTriangleIndex> nonocean_t;
-	for (FTriangleIndex t = 0; t < t_elevation.Num(); t++)
+	TRACE_CPUPROFILER_EVENT_SCOPE(UIslandElevation::RedistributeTriangleElevations)
+	TArray<int32> nonocean_t;
+	nonocean_t.Reserve(t_elevation.Num());
+	for (int32 t = 0; t < t_elevation.Num(); t++)
 	{
 		if (!IsTriangleOcean(t, Mesh, r_ocean))
 		{
@@ -218,17 +248,14 @@ void UIslandElevation::RedistributeTriangleElevations_Implementation(TArray<floa
 		}
 	}
 
-	nonocean_t.Sort([t_elevation](const FTriangleIndex& A, const FTriangleIndex& B)
-	{
-		return t_elevation[A] < t_elevation[B];
-	});
+	UIslandMapUtils::SortIndicesByValue(nonocean_t, t_elevation);
 
 	if (nonocean_t.Num() > 0)
 	{
 		UE_LOG(LogMapGen, Log, TEXT("Sorted non-ocean bottom value: %f. Sorted non-ocean top value: %f"), t_elevation[nonocean_t[0]], t_elevation[nonocean_t[nonocean_t.Num() - 1]]);
 	}
 
-	for (int i = 0; i < nonocean_t.Num(); i++)
+	ParallelFor(nonocean_t.Num(), [&t_elevation, &nonocean_t, SCALE_FACTOR](const int32 i)
 	{
 		// Let y(x) be the total area that we want at elevation <= x.
 		// We want the higher elevations to occur less than lower
@@ -245,29 +272,27 @@ void UIslandElevation::RedistributeTriangleElevations_Implementation(TArray<floa
 		{
 			x = 1.0;
 		}
-		//UE_LOG(LogMapGen, Log, TEXT("Redistributing elevation for triangle %d for %f to %f."), nonocean_t[i], t_elevation[nonocean_t[i]], x);
 		t_elevation[nonocean_t[i]] = x;
-	}
+	});
 }
 
 void UIslandElevation::AssignRegionElevations_Implementation(TArray<float>& r_elevation, UTriangleDualMesh* Mesh, const TArray<float>& t_elevation, const TArray<bool>& r_ocean) const
 {
 	const float max_ocean_elevation = -0.01;
 
-	r_elevation.Empty(Mesh->NumRegions);
-	r_elevation.SetNumZeroed(Mesh->NumRegions);
+	UIslandMapUtils::ResetLayer(r_elevation, Mesh->NumRegions);
 
-	TArray<FTriangleIndex> out_t;
 	for (FPointIndex r = 0; r < Mesh->NumRegions; r++)
 	{
-		out_t = Mesh->r_circulate_t(r);
 		float elevation = 0.0f;
-		for (FTriangleIndex t : out_t)
+		int32 count = 0;
+		Mesh->r_circulate_t(r, [&elevation, &count, &t_elevation](FTriangleIndex t)
 		{
 			elevation += t_elevation[t];
-		}
+			count++;
+		});
 
-		r_elevation[r] = elevation / out_t.Num();
+		r_elevation[r] = elevation / count;
 		if (r_ocean[r] && r_elevation[r] > max_ocean_elevation)
 		{
 			r_elevation[r] = max_ocean_elevation;
@@ -277,15 +302,15 @@ void UIslandElevation::AssignRegionElevations_Implementation(TArray<float>& r_el
 
 void UIslandElevation::assign_t_elevation(TArray<float>& t_elevation, TArray<int32>& t_coastdistance, TArray<FSideIndex>& t_downslope_s, UTriangleDualMesh* Mesh, const TArray<bool>& r_ocean, const TArray<bool>& r_water, FRandomStream& DrainageRng) const
 {
-	AssignTriangleElevations(t_elevation, t_coastdistance, t_downslope_s, Mesh, r_ocean, r_water, DrainageRng);
+	ISLAND_CALL_NATIVE_OR_EVENT(UIslandElevation, AssignTriangleElevations, t_elevation, t_coastdistance, t_downslope_s, Mesh, r_ocean, r_water, DrainageRng);
 }
 
 void UIslandElevation::redistribute_t_elevation(TArray<float>& t_elevation, UTriangleDualMesh* Mesh, const TArray<bool>& r_ocean) const
 {
-	RedistributeTriangleElevations(t_elevation, Mesh, r_ocean);
+	ISLAND_CALL_NATIVE_OR_EVENT(UIslandElevation, RedistributeTriangleElevations, t_elevation, Mesh, r_ocean);
 }
 
 void UIslandElevation::assign_r_elevation(TArray<float>& r_elevation, UTriangleDualMesh* Mesh, const TArray<float>& t_elevation, const TArray<bool>& r_ocean) const
 {
-	AssignRegionElevations(r_elevation, Mesh, t_elevation, r_ocean);
+	ISLAND_CALL_NATIVE_OR_EVENT(UIslandElevation, AssignRegionElevations, r_elevation, Mesh, t_elevation, r_ocean);
 }
@@ -0,0 +1,53 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "IslandBakeCommandlet.h"
+#include "IslandBakedData.h"
+#include "PolygonalMapGenerator.h"
+#include "Misc/PackageName.h"
+#include "UObject/Package.h"
+#include "UObject/SavePackage.h"
+
+int32 UIslandBakeCommandlet::Main(const FString& Params)
+{
+#if WITH_EDITOR
+	FString AssetList;
+	if (!FParse::Value(*Params, TEXT("Assets="), AssetList, false))
+	{
+		UE_LOG(LogMapGen, Error, TEXT("IslandBake needs -Assets=<path>+<path>..."));
+		return 1;
+	}
+	TArray<FString> AssetPaths;
+	AssetList.ParseIntoArray(AssetPaths, TEXT("+"));
+
+	int32 FailedNum = 0;
+	for (const FString& AssetPath : AssetPaths)
+	{
+		UIslandBakedData* BakedData = LoadObject<UIslandBakedData>(nullptr, *AssetPath);
+		if (BakedData == nullptr)
+		{
+			UE_LOG(LogMapGen, Error, TEXT("%s is not an island bake."), *AssetPath);
+			++FailedNum;
+			continue;
+		}
+		BakedData->Bake();
+		if (!BakedData->HasIsland())
+		{
+			++FailedNum;
+			continue;
+		}
+		UPackage* Package = BakedData->GetPackage();
+		const FString Filename = FPackageName::LongPackageNameToFilename(Package->GetName(),
+		                                                                 FPackageName::GetAssetPackageExtension());
+		FSavePackageArgs SaveArgs;
+		SaveArgs.TopLevelFlags = RF_Public | RF_Standalone;
+		if (!UPackage::SavePackage(Package, BakedData, *Filename, SaveArgs))
+		{
+			UE_LOG(LogMapGen, Error, TEXT("Could not save %s."), *Filename);
+			++FailedNum;
+		}
+	}
+	return FailedNum == 0 ? 0 : 1;
+#else
+	return 1;
+#endif
+}
@@ -0,0 +1,104 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "IslandBakedData.h"
+#include "IslandMapData.h"
+#include "PolygonalMapGenerator.h"
+#include "District/DistrictIDTexture.h"
+#include "Engine/Texture2D.h"
+
+#if WITH_EDITOR
+namespace
+{
+	// Reuses the texture of an earlier bake, so references to it stay valid. Never streamed, so cooked builds keep
+	// the pixels in the first mip for FDistrictIDDataCache::FindOrDecode.
+	UTexture2D* BakeDistrictIDTexture(UIslandBakedData* Owner, UTexture2D* Existing, const TCHAR* Name,
+	                                  const int32 Width, const int32 Height, const TArray<FFloat16>& Pixels)
+	{
+		UTexture2D* Texture = Existing != nullptr ? Existing : NewObject<UTexture2D>(Owner, Name, RF_Public);
+		Texture->Modify();
+		Texture->Source.Init(Width, Height, 1, 1, TSF_RGBA16F, reinterpret_cast<const uint8*>(Pixels.GetData()));
+		Texture->SRGB = false;
+		Texture->LODGroup = TEXTUREGROUP_16BitData;
+		Texture->CompressionSettings = TC_HDR;
+		Texture->MipGenSettings = TMGS_NoMipmaps;
+		Texture->NeverStream = true;
+		Texture->PostEditChange();
+		return Texture;
+	}
+}
+#endif
+
+void UIslandBakedData::Serialize(FArchive& Ar)
+{
+	Super::Serialize(Ar);
+	IslandData.Serialize(Ar, this);
+}
+
+void UIslandBakedData::GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize)
+{
+	Super::GetResourceSizeEx(CumulativeResourceSize);
+	CumulativeResourceSize.AddDedicatedSystemMemoryBytes(IslandData.GetBulkDataSize());
+}
+
+#if WITH_EDITOR
+void UIslandBakedData::Bake()
+{
+	if (MapData == nullptr)
+	{
+		UE_LOG(LogMapGen, Error, TEXT("%s has no map data to bake."), *GetPathName());
+		return;
+	}
+	// Generate for real even if the map data points at this or another bake
+	TGuardValue<TObjectPtr<UIslandBakedData>> BakedIslandGuard(MapData->BakedIsland, nullptr);
+	TGuardValue<bool> DiskCacheGuard(MapData->bUseDiskCache, false);
+	MapData->GenerateIsland();
+	BakeFrom(MapData);
+}
+
+bool UIslandBakedData::BakeFrom(UIslandMapData* InMapData)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UIslandBakedData::BakeFrom)
+	TArray<uint8> Bytes;
+	if (InMapData == nullptr || !InMapData->SaveIslandToBytes(Bytes))
+	{
+		UE_LOG(LogMapGen, Error, TEXT("%s: there is no generated island to bake."), *GetPathName());
+		return false;
+	}
+	Modify();
+	CacheKey = InMapData->GetCacheKey();
+	CacheVersion = UIslandMapData::GetCacheVersion();
+	NumRegions = InMapData->Mesh->NumSolidRegions;
+	// Stored next to the package instead of inline, so loading the asset does not load the island
+	IslandData.SetBulkDataFlags(BULKDATA_Force_NOT_InlinePayload);
+	IslandData.Lock(LOCK_READ_WRITE);
+	FMemory::Memcpy(IslandData.Realloc(Bytes.Num()), Bytes.GetData(), Bytes.Num());
+	IslandData.Unlock();
+
+	if (DistrictIDTextureWidth > 0 && DistrictIDTextureHeight > 0)
+	{
+		const FVector2D Scale = FVector2D(DistrictIDTextureWidth, DistrictIDTextureHeight) / InMapData->GetMapSize();
+		TArray<FDistrictRasterPolygon> Polygons;
+		DistrictIDTexture::PreparePolygons(Polygons, InMapData->GetDistrictRegions(), Scale);
+		const int32 PixelNum = DistrictIDTextureWidth * DistrictIDTextureHeight * 4;
+		TArray<FFloat16> Pixels1;
+		Pixels1.SetNumUninitialized(PixelNum);
+		TArray<FFloat16> Pixels2;
+		Pixels2.SetNumUninitialized(PixelNum);
+		DistrictIDTexture::ResolveRows(Polygons, DistrictIDTextureWidth, 0, DistrictIDTextureHeight,
+		                               Pixels1.GetData(), Pixels2.GetData());
+		DistrictIDTexture01 = BakeDistrictIDTexture(this, DistrictIDTexture01, TEXT("DistrictIDTexture01"),
+		                                            DistrictIDTextureWidth, DistrictIDTextureHeight, Pixels1);
+		DistrictIDTexture02 = BakeDistrictIDTexture(this, DistrictIDTexture02, TEXT("DistrictIDTexture02"),
+		                                            DistrictIDTextureWidth, DistrictIDTextureHeight, Pixels2);
+	}
+	else
+	{
+		DistrictIDTexture01 = nullptr;
+		DistrictIDTexture02 = nullptr;
+	}
+	MarkPackageDirty();
+	UE_LOG(LogMapGen, Log, TEXT("Baked %d regions into %s, %d bytes of island data."), NumRegions, *GetPathName(),
+	       Bytes.Num());
+	return true;
+}
+#endif
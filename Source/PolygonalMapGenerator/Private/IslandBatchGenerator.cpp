@@ -0,0 +1,211 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "IslandBatchGenerator.h"
+
+#include "DualMeshBuilder.h"
+#include "PolygonalMapGenerator.h"
+#include "Coastline/IslandCoastline.h"
+
+bool UIslandBatchGenerator::GenerateBatch(UIslandMapData* InTemplate, const TArray<FIslandBatchCandidate>& InCandidates)
+{
+	check(IsInGameThread());
+	CancelBatch();
+	if (!IsValid(InTemplate) || !HasNativeGenerators(InTemplate))
+	{
+		UE_LOG(LogMapGen, Error, TEXT("Island batches need map data whose class and generators are all native"));
+		return false;
+	}
+	if (Template != InTemplate)
+	{
+		WorkerMapData.Reset();
+	}
+	Template = InTemplate;
+	Candidates = InCandidates;
+	Summaries.Reset();
+	Summaries.SetNum(Candidates.Num());
+	NextCandidate = 0;
+	bCancelled = false;
+
+	const int32 WorkerLimit = MaxWorkers > 0 ? MaxWorkers : FTaskGraphInterface::Get().GetNumWorkerThreads();
+	const int32 WorkerNum = FMath::Clamp(Candidates.Num(), 1, FMath::Max(WorkerLimit, 1));
+	while (WorkerMapData.Num() < WorkerNum)
+	{
+		WorkerMapData.Add(CreateScratch(Template, this));
+	}
+
+	FGraphEventArray WorkerTasks;
+	for (int32 Worker = 0; Worker < WorkerNum; Worker++)
+	{
+		UIslandMapData* Scratch = WorkerMapData[Worker];
+		WorkerTasks.Emplace(FFunctionGraphTask::CreateAndDispatchWhenReady([this, Scratch]
+		{
+			GenerateCandidates(Scratch);
+		}));
+	}
+	CompletionTask = FFunctionGraphTask::CreateAndDispatchWhenReady([this]
+	{
+		OnBatchGenerated.Broadcast(Summaries);
+	}, TStatId(), &WorkerTasks, ENamedThreads::GameThread);
+	return true;
+}
+
+void UIslandBatchGenerator::CancelBatch()
+{
+	check(IsInGameThread());
+	bCancelled = true;
+	if (IsGenerating())
+	{
+		FTaskGraphInterface::Get().WaitUntilTaskCompletes(CompletionTask, ENamedThreads::GameThread);
+	}
+}
+
+bool UIslandBatchGenerator::IsGenerating() const
+{
+	return CompletionTask.IsValid() && !CompletionTask->IsComplete();
+}
+
+UIslandMapData* UIslandBatchGenerator::CreateCandidateMapData(int32 Candidate, UObject* Outer) const
+{
+	check(IsInGameThread());
+	if (!IsValid(Template) || !Candidates.IsValidIndex(Candidate))
+	{
+		return nullptr;
+	}
+	UIslandMapData* MapData = DuplicateObject<UIslandMapData>(Template, Outer ? Outer : GetTransientPackage());
+	ApplyCandidate(MapData, Candidates[Candidate]);
+	MapData->InvalidateGenerationCache();
+	MapData->GenerateIsland();
+	return MapData;
+}
+
+FIslandBatchSummary UIslandBatchGenerator::Summarize(const UIslandMapData* MapData)
+{
+	FIslandBatchSummary Summary;
+	const UTriangleDualMesh* Mesh = MapData->Mesh;
+	if (Mesh == nullptr || MapData->GetRegionFlags().Num() < Mesh->NumSolidRegions)
+	{
+		return Summary;
+	}
+	Summary.bGenerated = true;
+	int32 LandNum = 0;
+	for (int32 Region = 0; Region < Mesh->NumSolidRegions; Region++)
+	{
+		LandNum += MapData->IsPointWater(Region) ? 0 : 1;
+	}
+	Summary.LandRatio = Mesh->NumSolidRegions > 0 ? static_cast<float>(LandNum) / Mesh->NumSolidRegions : 0.f;
+	for (const FCoastlinePolygon& Coastline : MapData->GetCoastLines())
+	{
+		const TArray<FVector2D>& Positions = Coastline.Positions;
+		for (int32 i = 0, j = Positions.Num() - 1; i < Positions.Num(); j = i++)
+		{
+			Summary.CoastlineLength += FVector2D::Distance(Positions[i], Positions[j]);
+		}
+	}
+	Summary.CoastlineNum = MapData->GetCoastLines().Num();
+	Summary.LakeNum = MapData->NumLakes;
+	Summary.RiverSegmentNum = MapData->GetRiverNetwork().Num();
+	for (const FDistrictRegion& Region : MapData->GetDistrictRegions())
+	{
+		if (Region.District >= Summary.DistrictRegionNums.Num())
+		{
+			Summary.DistrictRegionNums.SetNumZeroed(Region.District + 1);
+		}
+		if (Region.District >= 0)
+		{
+			Summary.DistrictRegionNums[Region.District]++;
+		}
+	}
+	return Summary;
+}
+
+void UIslandBatchGenerator::BeginDestroy()
+{
+	// Worker tasks hold a raw pointer to this object
+	if (IsGenerating())
+	{
+		OnBatchGenerated.Clear();
+		CancelBatch();
+	}
+	Super::BeginDestroy();
+}
+
+bool UIslandBatchGenerator::HasNativeGenerators(const UIslandMapData* MapData)
+{
+	const UObject* Generators[] = {
+		MapData->PointGenerator, MapData->Water, MapData->Elevation, MapData->Rivers, MapData->Moisture,
+		MapData->Biomes
+	};
+	for (const UObject* Generator : Generators)
+	{
+		if (Generator == nullptr || !Generator->GetClass()->IsNative())
+		{
+			return false;
+		}
+	}
+	// Districts are optional
+	return (MapData->District == nullptr || MapData->District->GetClass()->IsNative())
+		&& MapData->GetClass()->IsNative();
+}
+
+void UIslandBatchGenerator::ApplyCandidate(UIslandMapData* MapData, const FIslandBatchCandidate& Candidate)
+{
+	MapData->Seed = Candidate.Seed;
+	MapData->DrainageSeed = Candidate.DrainageSeed;
+	MapData->RiverSeed = Candidate.RiverSeed;
+	MapData->DistrictSeed = Candidate.DistrictSeed;
+	MapData->bDetermineRandomSeedAtRuntime = false;
+}
+
+UIslandMapData* UIslandBatchGenerator::CreateScratch(const UIslandMapData* Template, UObject* Outer)
+{
+	UIslandMapData* Scratch = DuplicateObject<UIslandMapData>(Template, Outer);
+	// Nobody listens to a scratch copy, and the bindings of the template must not fire from a worker
+	Scratch->OnIslandPointGenerationComplete.Clear();
+	Scratch->OnIslandWaterGenerationComplete.Clear();
+	Scratch->OnIslandElevationGenerationComplete.Clear();
+	Scratch->OnIslandRiverGenerationComplete.Clear();
+	Scratch->OnIslandMoistureGenerationComplete.Clear();
+	Scratch->OnIslandBiomeGenerationComplete.Clear();
+	Scratch->OnIslandGenerationComplete.Clear();
+	Scratch->OnIslandCoarseGenerationComplete.Clear();
+	Scratch->bUseDiskCache = false;
+	// A bake only matches the settings of the template, loading it from a worker would only warn
+	Scratch->BakedIsland = nullptr;
+	Scratch->bIncrementalRegeneration = false;
+	Scratch->bRunStagesConcurrently = false;
+	Scratch->bBakeCoastDistanceField = false;
+	Scratch->bPublishSnapshots = false;
+	Scratch->InvalidateGenerationCache();
+	// Generators can keep state between their calls, like the start angle of the radial water
+	Scratch->PointGenerator = DuplicateObject(Template->PointGenerator, Scratch);
+	Scratch->Water = DuplicateObject(Template->Water, Scratch);
+	Scratch->Elevation = DuplicateObject(Template->Elevation, Scratch);
+	Scratch->Rivers = DuplicateObject(Template->Rivers, Scratch);
+	Scratch->Moisture = DuplicateObject(Template->Moisture, Scratch);
+	Scratch->Biomes = DuplicateObject(Template->Biomes, Scratch);
+	Scratch->District = DuplicateObject(Template->District, Scratch);
+	// The duplicate still points at the objects of the template
+	Scratch->ScratchMeshBuilder = NewObject<UDualMeshBuilder>(Scratch);
+	Scratch->Mesh = NewObject<UTriangleDualMesh>(Scratch);
+	Scratch->IslandCoastline = NewObject<UIslandCoastline>(Scratch);
+	return Scratch;
+}
+
+void UIslandBatchGenerator::GenerateCandidates(UIslandMapData* Scratch)
+{
+	for (int32 Candidate = NextCandidate++; Candidate < Candidates.Num() && !bCancelled; Candidate = NextCandidate++)
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(UIslandBatchGenerator::GenerateCandidate)
+		ApplyCandidate(Scratch, Candidates[Candidate]);
+		TArray<UIslandMapData::FGenerationStage> Stages;
+		uint64 CacheKey = 0;
+		bool bConcurrent = false;
+		if (Scratch->BeginGeneration(Stages, CacheKey, bConcurrent) == UIslandMapData::EGenerationStart::RunStages)
+		{
+			// Candidates already run side by side, so the stages of one candidate stay on this worker
+			Scratch->RunGenerationStages(Stages, false);
+			Summaries[Candidate] = Summarize(Scratch);
+		}
+		Summaries[Candidate].Candidate = Candidate;
+	}
+}
@@ -1,245 +1,574 @@
 ﻿#include "IslandDynamicAssets.h"
 
+#include "clipper.rectclip.h"
 #include "Coastline/IslandCoastline.h"
-#include "canvas_ity.hpp"
+#include "District/DistrictIDData.h"
+#include "District/DistrictIDTexture.h"
+#include "DistrictIDTextureGPU.h"
+#include "IslandBakedData.h"
 #include "GeometryScript/MeshBasicEditFunctions.h"
+#include "DynamicMesh/DynamicMesh3.h"
+#include "DynamicMesh/DynamicMeshAttributeSet.h"
+#include "DynamicMesh/MeshNormals.h"
+#include "PolygonalMapGenerator.h"
 
-void UIslandDynamicAssets::AsyncGenerateAssets()
+namespace
 {
-	GenerateMapDataTask = FFunctionGraphTask::CreateAndDispatchWhenReady([this]
+	/** Rows of the district ID texture resolved by one task. */
+	constexpr int32 DistrictIDTextureBandRows = 64;
+
+	struct FDistrictIDTextureBuildData
 	{
-		if (MapData)
-			MapData->GenerateIsland();
-	});
+		TArray<FDistrictRasterPolygon> Polygons;
+		// Only Unorm8 resolves into these, Float16 resolves straight into the first mips
+		TArray<FFloat16> FloatIDImageBuffer1;
+		TArray<FFloat16> FloatIDImageBuffer2;
+		FFloat16* ResolveTarget1 = nullptr;
+		FFloat16* ResolveTarget2 = nullptr;
+		// Every mip of both textures, locked from their creation until their resources are created
+		TArray<void*, TInlineAllocator<16>> MipData1;
+		TArray<void*, TInlineAllocator<16>> MipData2;
+	};
 
-	FGraphEventArray GenDistrictTexPrerequisites;
-	GenDistrictTexPrerequisites.Emplace(GenerateMapDataTask);
-	GenDistrictIDTextureTask = AsyncGenerateDistrictIDTexture(GenDistrictTexPrerequisites);
+	static_assert(DistrictIDTextureGPU::MaxDistricts == DistrictIDTexture::MaxDistricts);
 
-	const int32 TileAmount = GetTileAmount();
-	TileInfo.Empty(TileAmount);
-	FGraphEventArray CalcTilePrerequisites;
-	CalcTilePrerequisites.Emplace(GenerateMapDataTask);
-	for (int32 Index = 0; Index < TileAmount; Index++)
+	struct FDistrictIDTriangleData
 	{
-		FGraphEventRef CalcTileMeshBuffersTask = FFunctionGraphTask::CreateAndDispatchWhenReady(
-			[&, Index] { CalcTileMeshBuffer(Index); },
-			TStatId(), &CalcTilePrerequisites);
-		TileInfo.Emplace(CalcTileMeshBuffersTask);
+		TArray<FVector2f> Positions;
+		TArray<uint32> Districts;
+	};
+
+	/** Coastline positions are snapped to 1 / TileClipScale units for the integer rect clipping. */
+	constexpr double TileClipScale = 100.;
+
+	/**
+	 * Clips the coastlines to Bounds. Polygons that enclose all of Bounds only count towards bOutInside, they are
+	 * added back as the outline of Bounds only when some other polygon crosses Bounds and Out is not empty anyway.
+	 */
+	void ClipCoastlines(const TArray<FCoastlinePolygon>& Coastlines, const TArray<FBox2D>& CoastlineBounds,
+	                    const FBox2D& Bounds, TArray<FCoastlinePolygon>& Out, bool& bOutInside)
+	{
+		auto ToClip = [](const double Value) { return FMath::RoundToInt64(Value * TileClipScale); };
+		const Clipper2Lib::Rect64 Rect(ToClip(Bounds.Min.X), ToClip(Bounds.Min.Y), ToClip(Bounds.Max.X),
+		                               ToClip(Bounds.Max.Y));
+		Clipper2Lib::Paths64 Subjects;
+		for (int32 Index = 0; Index < Coastlines.Num(); Index++)
+		{
+			if (!CoastlineBounds[Index].Intersect(Bounds))
+			{
+				continue;
+			}
+			Clipper2Lib::Path64& Subject = Subjects.emplace_back();
+			Subject.reserve(Coastlines[Index].Positions.Num());
+			for (const FVector2D& Position : Coastlines[Index].Positions)
+			{
+				Subject.emplace_back(ToClip(Position.X), ToClip(Position.Y));
+			}
+		}
+		const double RectArea = static_cast<double>(Rect.Width()) * Rect.Height();
+		int32 EnclosingNum = 0;
+		for (const Clipper2Lib::Path64& Path : Clipper2Lib::RectClip64(Rect).Execute(Subjects))
+		{
+			if (FMath::Abs(Clipper2Lib::Area(Path)) >= RectArea - 1.)
+			{
+				EnclosingNum++;
+				continue;
+			}
+			TArray<FVector2D>& Positions = Out.AddDefaulted_GetRef().Positions;
+			Positions.Reserve(Path.size());
+			for (const Clipper2Lib::Point64& Point : Path)
+			{
+				Positions.Emplace(Point.x / TileClipScale, Point.y / TileClipScale);
+			}
+		}
+		bOutInside = EnclosingNum % 2 == 1;
+		// An even number of enclosing polygons cancels out in the parity test
+		if (bOutInside && !Out.IsEmpty())
+		{
+			TArray<FVector2D>& Positions = Out.AddDefaulted_GetRef().Positions;
+			Positions = {
+				Bounds.Min, FVector2D(Bounds.Max.X, Bounds.Min.Y), Bounds.Max, FVector2D(Bounds.Min.X, Bounds.Max.Y)
+			};
+		}
 	}
-}
 
-FGraphEventRef UIslandDynamicAssets::AsyncGenerateDistrictIDTexture(const FGraphEventArray& Prerequisites)
-{
-	FGraphEventRef GenTextureDataTask = FFunctionGraphTask::CreateAndDispatchWhenReady(
-		[this]
+	struct FTileNode
 	{
-		TRACE_CPUPROFILER_EVENT_SCOPE(AIslandDynamicMeshActor::GenerateDistrictIDTexture)
-		const FVector2D Scale = FVector2D(DistrictIDTextureWidth, DistrictIDTextureHeight) / MapData->GetMapSize();
-		canvas_ity::canvas_20 Canvas(DistrictIDTextureWidth, DistrictIDTextureHeight);
-		for (const FDistrictRegion& DistrictRegion : MapData->GetDistrictRegions())
+		int32 I0;
+		int32 J0;
+		int32 I1;
+		int32 J1;
+	};
+
+	/**
+	 * Replaces the full (Resolution + 1)^2 grid in Buffers, with the unit depth in Z, by the leaves of a quadtree.
+	 * A node is split until all of its samples share one depth or it is a single cell. Leaves that have finer
+	 * neighbours get a center vertex and a fan over every vertex on their boundary, so there are no T-junctions.
+	 */
+	void BuildAdaptiveTile(FGeometryScriptSimpleMeshBuffers& Buffers, const int32 Resolution)
+	{
+		const int32 Stride = Resolution + 1;
+		auto Depth = [&Buffers, Stride](const int32 I, const int32 J)
+		{
+			return Buffers.Vertices[I * Stride + J].Z;
+		};
+		auto IsFlat = [&Depth](const FTileNode& Node)
 		{
-			canvas_ity::rgba_20 Data;
-			Data.a = 1.f;
-			switch (DistrictRegion.District)
+			const double First = Depth(Node.I0, Node.J0);
+			for (int32 I = Node.I0; I <= Node.I1; ++I)
 			{
-			case 0:
-				Data.d_a = 1.f;
-				Canvas.set_data_color(canvas_ity::fill_style, Data);
-				break;
-			case 1:
-				Data.d_b = 1.f;
-				Canvas.set_data_color(canvas_ity::fill_style, Data);
-				break;
-			case 2:
-				Data.d_c = 1.f;
-				Canvas.set_data_color(canvas_ity::fill_style, Data);
-				break;
-			case 3:
-				Data.d_d = 1.f;
-				Canvas.set_data_color(canvas_ity::fill_style, Data);
-				break;
-			case 4:
-				Data.d_e = 1.f;
-				Canvas.set_data_color(canvas_ity::fill_style, Data);
-				break;
-			case 5:
-				Data.d_f = 1.f;
-				Canvas.set_data_color(canvas_ity::fill_style, Data);
-				break;
-			case 6:
-				Data.d_g = 1.f;
-				Canvas.set_data_color(canvas_ity::fill_style, Data);
-				break;
-			case 7:
-				Data.d_h = 1.f;
-				Canvas.set_data_color(canvas_ity::fill_style, Data);
-				break;
-			case 8:
-				Data.d_i = 1.f;
-				Canvas.set_data_color(canvas_ity::fill_style, Data);
-				break;
-			case 9:
-				Data.d_j = 1.f;
-				Canvas.set_data_color(canvas_ity::fill_style, Data);
-				break;
-			case 10:
-				Data.d_k = 1.f;
-				Canvas.set_data_color(canvas_ity::fill_style, Data);
-				break;
-			case 11:
-				Data.d_l = 1.f;
-				Canvas.set_data_color(canvas_ity::fill_style, Data);
-				break;
-			case 12:
-				Data.d_m = 1.f;
-				Canvas.set_data_color(canvas_ity::fill_style, Data);
-				break;
-			case 13:
-				Data.d_n = 1.f;
-				Canvas.set_data_color(canvas_ity::fill_style, Data);
-				break;
-			case 14:
-				Data.d_o = 1.f;
-				Canvas.set_data_color(canvas_ity::fill_style, Data);
-				break;
-			case 15:
-				Data.d_p = 1.f;
-				Canvas.set_data_color(canvas_ity::fill_style, Data);
-				break;
-			default:
-				Canvas.set_data_color(canvas_ity::fill_style, Data);
-				break;
+				for (int32 J = Node.J0; J <= Node.J1; ++J)
+				{
+					if (!FMath::IsNearlyEqual(Depth(I, J), First))
+					{
+						return false;
+					}
+				}
 			}
+			return true;
+		};
 
-			Canvas.begin_path();
-			const FVector2d FirstPos = DistrictRegion.Positions[0] * Scale;
-			Canvas.move_to(FirstPos.X, FirstPos.Y);
-			for (int32 PositionIndex = 1; PositionIndex < DistrictRegion.Positions.Num(); ++PositionIndex)
+		TArray<FTileNode> Leaves;
+		TArray<FTileNode> Stack;
+		Stack.Push({0, 0, Resolution, Resolution});
+		while (!Stack.IsEmpty())
+		{
+			const FTileNode Node = Stack.Pop(EAllowShrinking::No);
+			const bool bSplitI = Node.I1 - Node.I0 > 1;
+			const bool bSplitJ = Node.J1 - Node.J0 > 1;
+			if ((!bSplitI && !bSplitJ) || IsFlat(Node))
+			{
+				Leaves.Add(Node);
+				continue;
+			}
+			// Splits only depend on the node, so neighbouring tiles of the same resolution build the same tree
+			const int32 IM = bSplitI ? (Node.I0 + Node.I1) / 2 : Node.I1;
+			const int32 JM = bSplitJ ? (Node.J0 + Node.J1) / 2 : Node.J1;
+			Stack.Push({Node.I0, Node.J0, IM, JM});
+			if (bSplitI)
+			{
+				Stack.Push({IM, Node.J0, Node.I1, JM});
+			}
+			if (bSplitJ)
+			{
+				Stack.Push({Node.I0, JM, IM, Node.J1});
+			}
+			if (bSplitI && bSplitJ)
 			{
-				const FVector2d Pos = DistrictRegion.Positions[PositionIndex] * Scale;
-				Canvas.line_to(Pos.X, Pos.Y);
+				Stack.Push({IM, JM, Node.I1, Node.J1});
 			}
-			Canvas.close_path();
-			Canvas.fill();
 		}
-		canvas_ity::rgba_20* Bitmap = Canvas.get_bitmap();
 
-		int32 FloatImageBufferLength = DistrictIDTextureWidth * DistrictIDTextureHeight * 4;
-		TArray<FFloat16> FloatIDImageBuffer1;
-		FloatIDImageBuffer1.Empty(FloatImageBufferLength);
-		TArray<FFloat16> FloatIDImageBuffer2;
-		FloatIDImageBuffer2.Empty(FloatImageBufferLength);
+		TArray<int32> VertexIDs;
+		VertexIDs.Init(INDEX_NONE, Stride * Stride);
+		for (const FTileNode& Leaf : Leaves)
+		{
+			VertexIDs[Leaf.I0 * Stride + Leaf.J0] = 0;
+			VertexIDs[Leaf.I0 * Stride + Leaf.J1] = 0;
+			VertexIDs[Leaf.I1 * Stride + Leaf.J0] = 0;
+			VertexIDs[Leaf.I1 * Stride + Leaf.J1] = 0;
+		}
+		TArray<FVector> Vertices;
+		for (int32 Index = 0; Index < VertexIDs.Num(); ++Index)
+		{
+			if (VertexIDs[Index] != INDEX_NONE)
+			{
+				VertexIDs[Index] = Vertices.Emplace(Buffers.Vertices[Index]);
+			}
+		}
+
+		Buffers.Triangles.Reset();
+		TArray<int32, TInlineAllocator<32>> Ring;
+		for (const FTileNode& Leaf : Leaves)
+		{
+			// Same winding as the two triangles of a full grid cell
+			Ring.Reset();
+			auto AddRingVertex = [&](const int32 I, const int32 J)
+			{
+				if (VertexIDs[I * Stride + J] != INDEX_NONE)
+				{
+					Ring.Add(VertexIDs[I * Stride + J]);
+				}
+			};
+			for (int32 J = Leaf.J0; J < Leaf.J1; ++J)
+			{
+				AddRingVertex(Leaf.I0, J);
+			}
+			for (int32 I = Leaf.I0; I < Leaf.I1; ++I)
+			{
+				AddRingVertex(I, Leaf.J1);
+			}
+			for (int32 J = Leaf.J1; J > Leaf.J0; --J)
+			{
+				AddRingVertex(Leaf.I1, J);
+			}
+			for (int32 I = Leaf.I1; I > Leaf.I0; --I)
+			{
+				AddRingVertex(I, Leaf.J0);
+			}
+			if (Ring.Num() == 4)
+			{
+				Buffers.Triangles.Emplace(Ring[0], Ring[1], Ring[3]);
+				Buffers.Triangles.Emplace(Ring[1], Ring[2], Ring[3]);
+				continue;
+			}
+			const int32 Center = Vertices.Emplace(
+				(Buffers.Vertices[Leaf.I0 * Stride + Leaf.J0] + Buffers.Vertices[Leaf.I1 * Stride + Leaf.J1]) / 2);
+			for (int32 Index = 0; Index < Ring.Num(); ++Index)
+			{
+				Buffers.Triangles.Emplace(Ring[Index], Ring[(Index + 1) % Ring.Num()], Center);
+			}
+		}
+		Buffers.Vertices = MoveTemp(Vertices);
+	}
+}
+
+void UIslandDynamicAssets::AsyncGenerateAssets()
+{
+	check(IsInGameThread());
+	CancelAsyncGeneration();
+	if (!MapData)
+	{
+		UE_LOG(LogMapGen, Error, TEXT("Island dynamic assets have no map data to generate from"));
+		OnAssetsGenerated.Broadcast(false);
+		return;
+	}
+	const FIslandAssetsCancelToken Token = MakeShared<std::atomic<bool>, ESPMode::ThreadSafe>(false);
+	CancelToken = Token;
+	bHeadlessRun = UIslandMapUtils::IsHeadlessProfile(GenerationProfile);
 
-		// TODO: This part would spend 5s, using task graph to optimization
-		for (int32 Row = 0; Row < DistrictIDTextureHeight; ++Row)
+	// GenerateIsland creates UObjects and broadcasts Blueprint events, so it stays on the game thread
+	GenerateMapDataTask = FFunctionGraphTask::CreateAndDispatchWhenReady([this, Token]
+	{
+		if (!Token->load())
 		{
-			for (int32 Col = 0; Col < DistrictIDTextureWidth; ++Col)
+			MapData->GenerateIsland();
+			const TArray<FCoastlinePolygon>& Coastlines = MapData->GetCoastLines();
+			CoastlineBounds.Reset(Coastlines.Num());
+			for (const FCoastlinePolygon& Coastline : Coastlines)
+			{
+				CoastlineBounds.Emplace(Coastline.Positions);
+			}
+			PrepareRiverRibbons();
+		}
+	}, TStatId(), nullptr, ENamedThreads::GameThread);
+
+	if (bHeadlessRun)
+	{
+		// Waiting on it stays valid for the consumers of the textures, which then find none
+		DistrictIDTexture01 = nullptr;
+		DistrictIDTexture02 = nullptr;
+		GenDistrictIDTextureTask = GenerateMapDataTask;
+	}
+	else if (MapData->BakedIsland && MapData->BakedIsland->HasDistrictIDTextures() && !bShareDistrictIDData)
+	{
+		// Only known after the generation, which loads the bake only while the seeds and settings still match it
+		FGraphEventArray GenDistrictTexPrerequisites;
+		GenDistrictTexPrerequisites.Emplace(GenerateMapDataTask);
+		GenDistrictIDTextureTask = FFunctionGraphTask::CreateAndDispatchWhenReady(
+			[this, Token](ENamedThreads::Type, const FGraphEventRef& MyCompletionGraphEvent)
 			{
-				const canvas_ity::rgba_20& ColorData = *(Bitmap + static_cast<int>(Row * DistrictIDTextureWidth + Col));
-				struct
+				if (Token->load())
 				{
-					int32 District;
-					float Proportion;
-				} Proportions[16];
-				Proportions[0].District = 1;
-				Proportions[1].District = 2;
-				Proportions[2].District = 3;
-				Proportions[3].District = 4;
-				Proportions[4].District = 5;
-				Proportions[5].District = 6;
-				Proportions[6].District = 7;
-				Proportions[7].District = 8;
-				Proportions[8].District = 9;
-				Proportions[9].District = 10;
-				Proportions[10].District = 11;
-				Proportions[11].District = 12;
-				Proportions[12].District = 13;
-				Proportions[13].District = 14;
-				Proportions[14].District = 15;
-				Proportions[15].District = 16;
-				Proportions[0].Proportion = ColorData.d_a;
-				Proportions[1].Proportion = ColorData.d_b;
-				Proportions[2].Proportion = ColorData.d_c;
-				Proportions[3].Proportion = ColorData.d_d;
-				Proportions[4].Proportion = ColorData.d_e;
-				Proportions[5].Proportion = ColorData.d_f;
-				Proportions[6].Proportion = ColorData.d_g;
-				Proportions[7].Proportion = ColorData.d_h;
-				Proportions[8].Proportion = ColorData.d_i;
-				Proportions[9].Proportion = ColorData.d_j;
-				Proportions[10].Proportion = ColorData.d_k;
-				Proportions[11].Proportion = ColorData.d_l;
-				Proportions[12].Proportion = ColorData.d_m;
-				Proportions[13].Proportion = ColorData.d_n;
-				Proportions[14].Proportion = ColorData.d_o;
-				Proportions[15].Proportion = ColorData.d_p;
-				for (int32 i = 0; i < 15; i++)
-					for (int32 j = 0; j < 15 - i; j++)
-						if (Proportions[j].Proportion < Proportions[j + 1].Proportion)
-							std::swap(Proportions[j], Proportions[j + 1]);
-
-				if (Proportions[0].Proportion > 0)
+					return;
+				}
+				if (MapData->GetGenerationReport().bLoadedFromBake)
 				{
-					FloatIDImageBuffer1.Emplace(Proportions[0].District / 16.f - 0.01f);
-					FloatIDImageBuffer1.Emplace(Proportions[0].Proportion);
-					FloatIDImageBuffer1.Emplace(Proportions[1].District / 16.f - 0.01f);
-					FloatIDImageBuffer1.Emplace(Proportions[1].Proportion);
-					FloatIDImageBuffer2.Emplace(Proportions[2].District / 16.f - 0.01f);
-					FloatIDImageBuffer2.Emplace(Proportions[2].Proportion);
-					FloatIDImageBuffer2.Emplace(Proportions[3].District / 16.f - 0.01f);
-					FloatIDImageBuffer2.Emplace(Proportions[3].Proportion);
+					DistrictIDTexture01 = MapData->BakedIsland->DistrictIDTexture01;
+					DistrictIDTexture02 = MapData->BakedIsland->DistrictIDTexture02;
 				}
 				else
 				{
-					FloatIDImageBuffer1.Emplace(0.f);
-					FloatIDImageBuffer1.Emplace(0.f);
-					FloatIDImageBuffer1.Emplace(0.f);
-					FloatIDImageBuffer1.Emplace(0.f);
-					FloatIDImageBuffer2.Emplace(0.f);
-					FloatIDImageBuffer2.Emplace(0.f);
-					FloatIDImageBuffer2.Emplace(0.f);
-					FloatIDImageBuffer2.Emplace(0.f);
+					MyCompletionGraphEvent->DontCompleteUntil(AsyncGenerateDistrictIDTexture({}));
 				}
+			}, TStatId(), &GenDistrictTexPrerequisites, ENamedThreads::GameThread);
+	}
+	else
+	{
+		FGraphEventArray GenDistrictTexPrerequisites;
+		GenDistrictTexPrerequisites.Emplace(GenerateMapDataTask);
+		GenDistrictIDTextureTask = AsyncGenerateDistrictIDTexture(GenDistrictTexPrerequisites);
+	}
+
+	// Sized before any tile task exists, every task only writes its own element
+	const int32 TileAmount = GetTileAmount();
+	TileInfo.Reset();
+	TileInfo.SetNum(TileAmount);
+	FGraphEventArray CalcTilePrerequisites;
+	CalcTilePrerequisites.Emplace(GenerateMapDataTask);
+	FGraphEventArray CompletionPrerequisites;
+	CompletionPrerequisites.Emplace(GenDistrictIDTextureTask);
+	for (int32 Index = 0; Index < TileAmount; Index++)
+	{
+		TileInfo[Index].Task = FFunctionGraphTask::CreateAndDispatchWhenReady([this, Index, Token]
+		{
+			if (!Token->load())
+			{
+				CalcTileMeshBuffer(Index);
 			}
+		}, TStatId(), &CalcTilePrerequisites);
+		CompletionPrerequisites.Emplace(TileInfo[Index].Task);
+	}
+
+	CompletionTask = FFunctionGraphTask::CreateAndDispatchWhenReady([this, Token]
+	{
+		OnAssetsGenerated.Broadcast(!Token->load());
+	}, TStatId(), &CompletionPrerequisites, ENamedThreads::GameThread);
+}
+
+void UIslandDynamicAssets::CancelAsyncGeneration()
+{
+	check(IsInGameThread());
+	if (CancelToken.IsValid())
+	{
+		CancelToken->store(true);
+	}
+	if (IsGenerating())
+	{
+		// Also runs the game thread tasks of the run, so this can not dead lock on them
+		FTaskGraphInterface::Get().WaitUntilTaskCompletes(CompletionTask, ENamedThreads::GameThread);
+	}
+}
+
+bool UIslandDynamicAssets::IsGenerating() const
+{
+	return CompletionTask.IsValid() && !CompletionTask->IsComplete();
+}
+
+void UIslandDynamicAssets::BeginDestroy()
+{
+	// The tasks of a run hold a raw pointer to this object
+	if (IsGenerating())
+	{
+		OnAssetsGenerated.Clear();
+		CancelAsyncGeneration();
+	}
+	Super::BeginDestroy();
+}
+
+UTexture2D* UIslandDynamicAssets::CreateDistrictIDTexture(const int32 Width, const int32 Height,
+                                                          const EDistrictIDTextureFormat Format, const int32 MipNum)
+{
+	check(IsInGameThread());
+	const bool bUnorm8 = Format == EDistrictIDTextureFormat::DTF_Unorm8;
+	UTexture2D* Texture = UTexture2D::CreateTransient(Width, Height, bUnorm8 ? PF_R8G8B8A8 : PF_FloatRGBA);
+	Texture->bNotOfflineProcessed = true;
+	Texture->SRGB = false;
+	Texture->LODGroup = TEXTUREGROUP_16BitData;
+	Texture->CompressionSettings = bUnorm8 ? TC_VectorDisplacementmap : TC_HDR;
+	// The further levels are allocated here, their pixels are written with the first one
+	FTexturePlatformData* PlatformData = Texture->GetPlatformData();
+	const int32 BytesPerPixel = GPixelFormats[PlatformData->PixelFormat].BlockBytes;
+	for (int32 Level = 1; Level < MipNum; ++Level)
+	{
+		FTexture2DMipMap* Mip = new FTexture2DMipMap(FMath::Max(Width >> Level, 1), FMath::Max(Height >> Level, 1));
+		PlatformData->Mips.Add(Mip);
+		Mip->BulkData.Lock(LOCK_READ_WRITE);
+		Mip->BulkData.Realloc(static_cast<int64>(Mip->SizeX) * Mip->SizeY * BytesPerPixel);
+		Mip->BulkData.Unlock();
+	}
+	return Texture;
+}
+
+FGraphEventRef UIslandDynamicAssets::AsyncGenerateDistrictIDTexture(const FGraphEventArray& Prerequisites)
+{
+	if (bGenerateDistrictIDTextureOnGPU && !bShareDistrictIDData
+		&& DistrictIDTextureGPU::IsSupported(DistrictIDTextureWidth, DistrictIDTextureHeight))
+	{
+		return AsyncGenerateDistrictIDTextureOnGPU(Prerequisites);
+	}
+	const int32 TextureWidth = DistrictIDTextureWidth;
+	const int32 TextureHeight = DistrictIDTextureHeight;
+	const FIslandAssetsCancelToken Token = CancelToken;
+	TSharedRef<FDistrictIDTextureBuildData, ESPMode::ThreadSafe> BuildData = MakeShared<
+		FDistrictIDTextureBuildData, ESPMode::ThreadSafe>();
+	const EDistrictIDTextureFormat Format = DistrictIDTextureFormat;
+	const bool bMips = bDistrictIDTextureMips && FMath::IsPowerOfTwo(TextureWidth)
+		&& FMath::IsPowerOfTwo(TextureHeight);
+	// The mip chain of the decoded data halves rounding up, which only matches the texture for powers of two
+	const int32 MipNum = bMips ? FMath::FloorLog2(FMath::Max(TextureWidth, TextureHeight)) + 1 : 1;
+	// Created here on the game thread, the worker tasks only fill the mip data before the resource exists
+	DistrictIDTexture01 = CreateDistrictIDTexture(TextureWidth, TextureHeight, Format, MipNum);
+	DistrictIDTexture02 = CreateDistrictIDTexture(TextureWidth, TextureHeight, Format, MipNum);
+	UTexture2D* Texture01 = DistrictIDTexture01;
+	UTexture2D* Texture02 = DistrictIDTexture02;
+	// The bulk data is the only CPU copy of the pixels, the workers write into it and UpdateResource uploads it
+	for (int32 Level = 0; Level < MipNum; ++Level)
+	{
+		BuildData->MipData1.Add(Texture01->GetPlatformData()->Mips[Level].BulkData.Lock(LOCK_READ_WRITE));
+		BuildData->MipData2.Add(Texture02->GetPlatformData()->Mips[Level].BulkData.Lock(LOCK_READ_WRITE));
+		check(BuildData->MipData1.Last() != nullptr && BuildData->MipData2.Last() != nullptr);
+	}
+
+	FGraphEventRef PrepareTask = FFunctionGraphTask::CreateAndDispatchWhenReady(
+		[this, BuildData, TextureWidth, TextureHeight, Token, Format]
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(UIslandDynamicAssets::PrepareDistrictIDTexture)
+		if (Token->load())
+		{
+			return;
+		}
+		const FVector2D Scale = FVector2D(TextureWidth, TextureHeight) / MapData->GetMapSize();
+		DistrictIDTexture::PreparePolygons(BuildData->Polygons, MapData->GetDistrictRegions(), Scale);
+
+		if (Format == EDistrictIDTextureFormat::DTF_Unorm8)
+		{
+			const int32 FloatImageBufferLength = TextureWidth * TextureHeight * 4;
+			BuildData->FloatIDImageBuffer1.SetNumUninitialized(FloatImageBufferLength);
+			BuildData->FloatIDImageBuffer2.SetNumUninitialized(FloatImageBufferLength);
+			BuildData->ResolveTarget1 = BuildData->FloatIDImageBuffer1.GetData();
+			BuildData->ResolveTarget2 = BuildData->FloatIDImageBuffer2.GetData();
 		}
+		else
 		{
-			DistrictIDTexture01 = UTexture2D::CreateTransient(DistrictIDTextureWidth, DistrictIDTextureHeight,
-			                                                  EPixelFormat::PF_FloatRGBA);
-			DistrictIDTexture01->bNotOfflineProcessed = true;
-			DistrictIDTexture01->SRGB = false;
-			DistrictIDTexture01->LODGroup = TEXTUREGROUP_16BitData;
-			DistrictIDTexture01->CompressionSettings = TC_HDR;
-			uint8* MipData = static_cast<uint8*>(DistrictIDTexture01->GetPlatformData()->Mips[0].BulkData.Lock(
-				LOCK_READ_WRITE));
-			check(MipData != nullptr);
-			FMemory::Memmove(MipData, FloatIDImageBuffer1.GetData(), FloatImageBufferLength * sizeof(FFloat16));
-			DistrictIDTexture01->GetPlatformData()->Mips[0].BulkData.Unlock();
-		}
-		{
-			DistrictIDTexture02 = UTexture2D::CreateTransient(DistrictIDTextureWidth, DistrictIDTextureHeight,
-			                                                  EPixelFormat::PF_FloatRGBA);
-			DistrictIDTexture02->bNotOfflineProcessed = true;
-			DistrictIDTexture02->SRGB = false;
-			DistrictIDTexture02->LODGroup = TEXTUREGROUP_16BitData;
-			DistrictIDTexture02->CompressionSettings = TC_HDR;
-			uint8* MipData = static_cast<uint8*>(DistrictIDTexture02->GetPlatformData()->Mips[0].BulkData.Lock(
-				LOCK_READ_WRITE));
-			check(MipData != nullptr);
-			FMemory::Memmove(MipData, FloatIDImageBuffer2.GetData(), FloatImageBufferLength * sizeof(FFloat16));
-			DistrictIDTexture02->GetPlatformData()->Mips[0].BulkData.Unlock();
+			BuildData->ResolveTarget1 = static_cast<FFloat16*>(BuildData->MipData1[0]);
+			BuildData->ResolveTarget2 = static_cast<FFloat16*>(BuildData->MipData2[0]);
 		}
 	}, TStatId(), &Prerequisites);
+
+	// Every band rasterizes and writes its own rows of the preallocated buffers, so the bands can run in any order.
+	FGraphEventArray ResolvePrerequisites;
+	ResolvePrerequisites.Emplace(PrepareTask);
+	FGraphEventArray ResolveTasks;
+	for (int32 RowBegin = 0; RowBegin < TextureHeight; RowBegin += DistrictIDTextureBandRows)
+	{
+		const int32 RowEnd = FMath::Min(RowBegin + DistrictIDTextureBandRows, TextureHeight);
+		ResolveTasks.Emplace(FFunctionGraphTask::CreateAndDispatchWhenReady(
+			[BuildData, TextureWidth, RowBegin, RowEnd, Token]
+			{
+				TRACE_CPUPROFILER_EVENT_SCOPE(UIslandDynamicAssets::ResolveDistrictIDTextureBand)
+				if (Token->load())
+				{
+					return;
+				}
+				DistrictIDTexture::ResolveRows(BuildData->Polygons, TextureWidth, RowBegin, RowEnd,
+				                               BuildData->ResolveTarget1, BuildData->ResolveTarget2);
+			}, TStatId(), &ResolvePrerequisites));
+	}
+
+	FGraphEventRef GenTextureDataTask = FFunctionGraphTask::CreateAndDispatchWhenReady(
+		[BuildData, TextureWidth, TextureHeight, Texture01, Texture02, Token, Format, MipNum,
+			bShare = bShareDistrictIDData]
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(UIslandDynamicAssets::FillDistrictIDTexture)
+		if (Token->load())
+		{
+			return;
+		}
+		const bool bUnorm8 = Format == EDistrictIDTextureFormat::DTF_Unorm8;
+		// The float images are the exact resolve, everything else is encoded from the decoded pixels
+		TSharedPtr<FIDTextueData, ESPMode::ThreadSafe> Decoded;
+		TSharedPtr<const FIDTextueMipChain, ESPMode::ThreadSafe> MipChain;
+		if (bUnorm8 || bShare || MipNum > 1)
+		{
+			Decoded = DistrictIDTexture::Decode(BuildData->ResolveTarget1, BuildData->ResolveTarget2, TextureWidth,
+			                                    TextureHeight);
+		}
+		if (MipNum > 1)
+		{
+			MipChain = DistrictIDTexture::BuildMipChain(Decoded.ToSharedRef());
+		}
+		for (int32 Level = bUnorm8 ? 0 : 1; Level < MipNum; ++Level)
+		{
+			const FIDTextueData* LevelData = Level == 0 ? Decoded.Get() : &MipChain->Levels[Level].Get();
+			if (bUnorm8)
+			{
+				if (!DistrictIDTexture::EncodeUnorm8(*LevelData, static_cast<uint8*>(BuildData->MipData1[Level]),
+				                                     static_cast<uint8*>(BuildData->MipData2[Level])) && Level == 0)
+				{
+					UE_LOG(LogMapGen, Warning, TEXT("Unorm8 district ID textures only hold %d districts, use Float16"),
+					       DistrictIDTexture::MaxUnorm8Districts);
+				}
+			}
+			else
+			{
+				DistrictIDTexture::EncodeFloat16(*LevelData, static_cast<FFloat16*>(BuildData->MipData1[Level]),
+				                                 static_cast<FFloat16*>(BuildData->MipData2[Level]));
+			}
+		}
+		// The float images of Unorm8 are not needed past the encode
+		BuildData->FloatIDImageBuffer1.Empty();
+		BuildData->FloatIDImageBuffer2.Empty();
+		if (bShare)
+		{
+			FDistrictIDDataCache::Get().Add(Texture01, Texture02, Decoded.ToSharedRef(), MipChain);
+		}
+	}, TStatId(), &ResolveTasks);
 	FGraphEventArray UpdateResourcePrerequisites;
 	UpdateResourcePrerequisites.Emplace(GenTextureDataTask);
-	return FFunctionGraphTask::CreateAndDispatchWhenReady([this]
+	return FFunctionGraphTask::CreateAndDispatchWhenReady([BuildData, Texture01, Texture02, Token, MipNum]
 	{
 		TRACE_CPUPROFILER_EVENT_SCOPE(AIslandDynamicMeshActor::UpdateDistrictIDTextureResource);
-		DistrictIDTexture01->UpdateResource();
-		DistrictIDTexture02->UpdateResource();
+		// Unlocked even when cancelled, the textures may still be destroyed or replaced
+		for (int32 Level = 0; Level < MipNum; ++Level)
+		{
+			Texture01->GetPlatformData()->Mips[Level].BulkData.Unlock();
+			Texture02->GetPlatformData()->Mips[Level].BulkData.Unlock();
+		}
+		if (!Token->load())
+		{
+			Texture01->UpdateResource();
+			Texture02->UpdateResource();
+		}
 	}, TStatId(), &UpdateResourcePrerequisites, ENamedThreads::GameThread);
 }
 
+FGraphEventRef UIslandDynamicAssets::AsyncGenerateDistrictIDTextureOnGPU(const FGraphEventArray& Prerequisites)
+{
+	const int32 TextureWidth = DistrictIDTextureWidth;
+	const int32 TextureHeight = DistrictIDTextureHeight;
+	const FIslandAssetsCancelToken Token = CancelToken;
+	TSharedRef<FDistrictIDTriangleData, ESPMode::ThreadSafe> TriangleData = MakeShared<
+		FDistrictIDTriangleData, ESPMode::ThreadSafe>();
+	DistrictIDTexture01 = CreateDistrictIDTexture(TextureWidth, TextureHeight, DistrictIDTextureFormat);
+	DistrictIDTexture02 = CreateDistrictIDTexture(TextureWidth, TextureHeight, DistrictIDTextureFormat);
+	UTexture2D* Texture01 = DistrictIDTexture01;
+	UTexture2D* Texture02 = DistrictIDTexture02;
+
+	FGraphEventRef PrepareTask = FFunctionGraphTask::CreateAndDispatchWhenReady(
+		[this, TriangleData, TextureWidth, TextureHeight, Token]
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(UIslandDynamicAssets::PrepareDistrictIDTriangles)
+		if (Token->load())
+		{
+			return;
+		}
+		const FVector2D Scale = FVector2D(TextureWidth, TextureHeight) / MapData->GetMapSize();
+		for (const FDistrictRegion& DistrictRegion : MapData->GetDistrictRegions())
+		{
+			if (DistrictRegion.District < 0 || DistrictRegion.District >= DistrictIDTexture::MaxDistricts)
+			{
+				continue;
+			}
+			for (const FPolyTriangle2D& Triangle : DistrictRegion.Triangles)
+			{
+				TriangleData->Positions.Emplace(Triangle.V0 * Scale);
+				TriangleData->Positions.Emplace(Triangle.V1 * Scale);
+				TriangleData->Positions.Emplace(Triangle.V2 * Scale);
+				TriangleData->Districts.Add(DistrictRegion.District + 1);
+			}
+		}
+	}, TStatId(), &Prerequisites);
+
+	// The resources are created without any pixels of ours, the render thread fills them after their init
+	FGraphEventArray RenderPrerequisites;
+	RenderPrerequisites.Emplace(PrepareTask);
+	return FFunctionGraphTask::CreateAndDispatchWhenReady(
+		[TriangleData, TextureWidth, TextureHeight, Texture01, Texture02, Token]
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(UIslandDynamicAssets::EnqueueDistrictIDTexture);
+		if (Token->load())
+		{
+			return;
+		}
+		Texture01->UpdateResource();
+		Texture02->UpdateResource();
+		DistrictIDTextureGPU::EnqueueGenerate(MoveTemp(TriangleData->Positions), MoveTemp(TriangleData->Districts),
+		                                      TextureWidth, TextureHeight, Texture01->GetResource(),
+		                                      Texture02->GetResource());
+	}, TStatId(), &RenderPrerequisites, ENamedThreads::GameThread);
+}
+
 void UIslandDynamicAssets::CalcTileMeshBuffer(const int32 TileIndex)
 {
 	TRACE_CPUPROFILER_EVENT_SCOPE(AIslandDynamicTileMeshActor::CalcTileMeshBuffer);
@@ -253,6 +582,37 @@ void UIslandDynamicAssets::CalcTileMeshBuffer(const int32 TileIndex)
 	Info.TileCenter = BoundaryMin + TileSize / 2;
 	FVector2D SubgridSize = TileSize / TileResolution;
 	int32 VerticesNum = (TileResolution + 1) * (TileResolution + 1);
+
+	// Only coast edges within BorderOffset of the tile change its depths, the clip rect edges are never closer
+	bool bTileInside = false;
+	TArray<FCoastlinePolygon> LocalCoastlines;
+	FCoastlineSpatialIndex LocalIndex;
+	const bool bClipped = BorderOffset > 0.f;
+	if (bClipped)
+	{
+		const FVector2D Margin(BorderOffset);
+		const FBox2D ClipBounds(BoundaryMin - Margin, BoundaryMin + TileSize + Margin);
+		ClipCoastlines(MapData->GetCoastLines(), CoastlineBounds, ClipBounds, LocalCoastlines, bTileInside);
+		if (LocalCoastlines.IsEmpty())
+		{
+			// No coast near the tile, so it is one flat quad without sampling a single vertex
+			const double UnitDepth = bTileInside ? 1. : 0.;
+			Buffers.Vertices = {
+				FVector(BoundaryMin.X, BoundaryMin.Y, UnitDepth),
+				FVector(BoundaryMin.X, BoundaryMin.Y + TileSize.Y, UnitDepth),
+				FVector(BoundaryMin.X + TileSize.X, BoundaryMin.Y, UnitDepth),
+				FVector(BoundaryMin.X + TileSize.X, BoundaryMin.Y + TileSize.Y, UnitDepth)
+			};
+			Buffers.Triangles = {FIntVector(0, 1, 2), FIntVector(1, 3, 2)};
+			FinishTileMeshBuffer(Info, MapSize);
+			return;
+		}
+		if (!MapData->GetCoastDistanceField().Covers(BorderOffset))
+		{
+			LocalIndex.Build(LocalCoastlines);
+		}
+	}
+
 	Buffers.Vertices.SetNumUninitialized(VerticesNum);
 	double MaxUnitDepth = 0.;
 	double MinUnitDepth = TNumericLimits<double>::Max();
@@ -262,25 +622,23 @@ void UIslandDynamicAssets::CalcTileMeshBuffer(const int32 TileIndex)
 		                           VIndex % (TileResolution + 1) * SubgridSize.Y);
 		FVector2D AbsoluteLocation = BoundaryMin + RelativeLocation;
 		double UnitDepth = 0.;
-		double MinDistance = TNumericLimits<double>::Max();
-		bool bPointInPolygon2D = false;
-		for (const FCoastlinePolygon& CoastLine : MapData->GetCoastLines())
+		double CoastDistance;
+		if (LocalIndex.IsEmpty())
 		{
-			bPointInPolygon2D = UIslandMapUtils::PointInPolygon2D(AbsoluteLocation, CoastLine.Positions);
-			if (bPointInPolygon2D)
-			{
-				break;
-			}
-			MinDistance = FMath::Min(MinDistance,
-			                         UIslandMapUtils::DistanceToPolygon2D(AbsoluteLocation, CoastLine.Positions));
+			CoastDistance = MapData->GetSignedCoastDistance(AbsoluteLocation, BorderOffset);
 		}
-		if (bPointInPolygon2D)
+		else
+		{
+			CoastDistance = LocalIndex.DistanceToCoast(AbsoluteLocation, BorderOffset);
+			CoastDistance = LocalIndex.IsInside(AbsoluteLocation) ? -CoastDistance : CoastDistance;
+		}
+		if (CoastDistance <= 0.)
 		{
 			UnitDepth = 1.;
 		}
-		else if (MinDistance <= BorderOffset)
+		else if (CoastDistance < BorderOffset)
 		{
-			UnitDepth = (BorderOffset - MinDistance) / BorderOffset;
+			UnitDepth = (BorderOffset - CoastDistance) / BorderOffset;
 		}
 		MaxUnitDepth = FMath::Max(MaxUnitDepth, UnitDepth);
 		MinUnitDepth = FMath::Min(MinUnitDepth, UnitDepth);
@@ -288,7 +646,12 @@ void UIslandDynamicAssets::CalcTileMeshBuffer(const int32 TileIndex)
 		Buffers.Vertices[VIndex].X = AbsoluteLocation.X;
 		Buffers.Vertices[VIndex].Y = AbsoluteLocation.Y;
 	}
-	if (FMath::IsNearlyEqual(MaxUnitDepth, MinUnitDepth))
+	if (bAdaptiveTileMesh)
+	{
+		BuildAdaptiveTile(Buffers, TileResolution);
+		VerticesNum = Buffers.Vertices.Num();
+	}
+	else if (FMath::IsNearlyEqual(MaxUnitDepth, MinUnitDepth))
 	{
 		// If the Tile has no height differences, the grid uses quadrilaterals without subdivisions.
 		TArray<FVector> FourCorners;
@@ -325,17 +688,201 @@ void UIslandDynamicAssets::CalcTileMeshBuffer(const int32 TileIndex)
 			Buffers.Triangles[TriBIndex].Z = Buffers.Triangles[TriAIndex].Z;
 		}
 	}
-	Buffers.UV0.SetNumUninitialized(VerticesNum);
+	FinishTileMeshBuffer(Info, MapSize);
+}
+
+void UIslandDynamicAssets::FinishTileMeshBuffer(FDynamicTileInfo& Info, const FVector2D& MapSize) const
+{
+	FGeometryScriptSimpleMeshBuffers& Buffers = Info.Buffers;
+	const int32 VerticesNum = Buffers.Vertices.Num();
+	if (!bHeadlessRun)
+	{
+		Buffers.UV0.SetNumUninitialized(VerticesNum);
+	}
 	// Calculate Positions and UVs
 	for (int32 VIndex = 0; VIndex < VerticesNum; VIndex++)
 	{
-		Buffers.UV0[VIndex] = FVector2D(Buffers.Vertices[VIndex].X, Buffers.Vertices[VIndex].Y) / MapSize;
+		if (!bHeadlessRun)
+		{
+			Buffers.UV0[VIndex] = FVector2D(Buffers.Vertices[VIndex].X, Buffers.Vertices[VIndex].Y) / MapSize;
+		}
 		Buffers.Vertices[VIndex].X -= Info.TileCenter.X;
 		Buffers.Vertices[VIndex].Y -= Info.TileCenter.Y;
 		Buffers.Vertices[VIndex].Z = (BorderDepthRemapCurve
 			                              ? BorderDepthRemapCurve->GetFloatValue(Buffers.Vertices[VIndex].Z)
 			                              : Buffers.Vertices[VIndex].Z - 1) * BorderDepth;
 	}
+	AppendRiverRibbons(Info, MapSize);
+	Info.Mesh = MakeShared<UE::Geometry::FDynamicMesh3, ESPMode::ThreadSafe>();
+	BuildTileMesh(*Info.Mesh, Buffers, !bHeadlessRun);
+}
+
+void UIslandDynamicAssets::PrepareRiverRibbons()
+{
+	RiverRibbons.Reset();
+	// Without a material the ribbons would render with the default material of their slot
+	if (!bGenerateRiverMeshes || bHeadlessRun || RiverMaterial == nullptr)
+	{
+		return;
+	}
+	const UTriangleDualMesh* Mesh = MapData->Mesh;
+	const FRiverNetwork& Rivers = MapData->GetRiverNetwork();
+	const TArray<int32>& SideFlow = MapData->GetSideFlow();
+	RiverRibbons.Reserve(Rivers.Num());
+	for (int32 Segment = 0; Segment < Rivers.Num(); ++Segment)
+	{
+		const TArrayView<const FTriangleIndex> Triangles = Rivers.GetSegmentTriangles(Segment);
+		const TArrayView<const FSideIndex> Downslopes = Rivers.GetSegmentDownslopes(Segment);
+		// A segment ending in a sink has no flow to give its last point a width, it would only add degenerate quads
+		if (Triangles.IsEmpty() || !Downslopes.Last().IsValid())
+		{
+			continue;
+		}
+		FIslandRiverRibbon& Ribbon = RiverRibbons.AddDefaulted_GetRef();
+		// Every triangle leaves through its downslope side into the next one, the last one into the coast or the
+		// segment it feeds, so the ribbon ends on the center of that triangle
+		float HalfWidth = 0.f;
+		for (int32 Index = 0; Index < Triangles.Num(); ++Index)
+		{
+			const FSideIndex Side = Downslopes[Index];
+			const int32 Flow = SideFlow[Side];
+			HalfWidth = FMath::Min(RiverWidth * FMath::Sqrt(static_cast<float>(Flow)), RiverMaxWidth) / 2;
+			Ribbon.Points.Emplace(Mesh->t_pos(Triangles[Index]));
+			Ribbon.HalfWidths.Add(HalfWidth);
+			if (Index == Triangles.Num() - 1)
+			{
+				Ribbon.Points.Emplace(Mesh->t_pos(Mesh->s_outer_t(Side)));
+				Ribbon.HalfWidths.Add(HalfWidth);
+			}
+		}
+		for (int32 Index = 0; Index < Ribbon.Points.Num(); ++Index)
+		{
+			Ribbon.Bounds += Ribbon.Points[Index] - FVector2D(Ribbon.HalfWidths[Index]);
+			Ribbon.Bounds += Ribbon.Points[Index] + FVector2D(Ribbon.HalfWidths[Index]);
+		}
+	}
+}
+
+void UIslandDynamicAssets::AppendRiverRibbons(FDynamicTileInfo& Info, const FVector2D& MapSize) const
+{
+	if (RiverRibbons.IsEmpty())
+	{
+		return;
+	}
+	TRACE_CPUPROFILER_EVENT_SCOPE(UIslandDynamicAssets::AppendRiverRibbons);
+	FGeometryScriptSimpleMeshBuffers& Buffers = Info.Buffers;
+	const FVector2D TileSize = MapSize / (TileDivisions + 1);
+	const FVector2D BoundaryMin(Info.TileCol * TileSize.X, Info.TileRow * TileSize.Y);
+	const FBox2D TileBounds(BoundaryMin, BoundaryMin + TileSize);
+	// Rivers only run over land, which FinishTileMeshBuffer puts at the height of unit depth 1
+	const double Z = (BorderDepthRemapCurve ? BorderDepthRemapCurve->GetFloatValue(1.f) : 0.) * BorderDepth
+		+ RiverHeightOffset;
+	const int32 TerrainTrianglesNum = Buffers.Triangles.Num();
+	for (const FIslandRiverRibbon& Ribbon : RiverRibbons)
+	{
+		if (!Ribbon.Bounds.Intersect(TileBounds))
+		{
+			continue;
+		}
+		const int32 PointsNum = Ribbon.Points.Num();
+		for (int32 Index = 0; Index + 1 < PointsNum; ++Index)
+		{
+			// Each piece belongs to the tile under its middle, so neighbouring tiles never both draw it
+			const FVector2D Middle = (Ribbon.Points[Index] + Ribbon.Points[Index + 1]) / 2;
+			const int32 Col = FMath::Clamp(FMath::FloorToInt32(Middle.X / TileSize.X), 0, TileDivisions);
+			const int32 Row = FMath::Clamp(FMath::FloorToInt32(Middle.Y / TileSize.Y), 0, TileDivisions);
+			if (Col != Info.TileCol || Row != Info.TileRow)
+			{
+				continue;
+			}
+			const int32 BaseIndex = Buffers.Vertices.Num();
+			for (int32 End = Index; End <= Index + 1; ++End)
+			{
+				// Both pieces at a point share its direction, so the ribbon stays closed across tiles
+				const FVector2D Direction = (Ribbon.Points[FMath::Min(End + 1, PointsNum - 1)]
+					- Ribbon.Points[FMath::Max(End - 1, 0)]).GetSafeNormal();
+				const FVector2D Offset = FVector2D(-Direction.Y, Direction.X) * Ribbon.HalfWidths[End];
+				for (const FVector2D& Position : {Ribbon.Points[End] - Offset, Ribbon.Points[End] + Offset})
+				{
+					Buffers.Vertices.Emplace(Position.X - Info.TileCenter.X, Position.Y - Info.TileCenter.Y, Z);
+					Buffers.UV0.Emplace(Position / MapSize);
+				}
+			}
+			Buffers.Triangles.Emplace(BaseIndex, BaseIndex + 1, BaseIndex + 2);
+			Buffers.Triangles.Emplace(BaseIndex + 1, BaseIndex + 3, BaseIndex + 2);
+		}
+	}
+	if (Buffers.Triangles.Num() > TerrainTrianglesNum)
+	{
+		Buffers.TriGroupIDs.Init(0, Buffers.Triangles.Num());
+		for (int32 Index = TerrainTrianglesNum; Index < Buffers.Triangles.Num(); ++Index)
+		{
+			Buffers.TriGroupIDs[Index] = RiverMaterialID;
+		}
+	}
+}
+
+void UIslandDynamicAssets::BuildTileMesh(UE::Geometry::FDynamicMesh3& Mesh,
+                                        const FGeometryScriptSimpleMeshBuffers& Buffers, const bool bRenderAttributes)
+{
+	using namespace UE::Geometry;
+	Mesh.EnableAttributes();
+	Mesh.Attributes()->EnableMaterialID();
+	FDynamicMeshUVOverlay* UVOverlay = bRenderAttributes ? Mesh.Attributes()->GetUVLayer(0) : nullptr;
+	FDynamicMeshMaterialAttribute* MaterialIDs = Mesh.Attributes()->GetMaterialID();
+	for (int32 Index = 0; Index < Buffers.Vertices.Num(); ++Index)
+	{
+		Mesh.AppendVertex(Buffers.Vertices[Index]);
+		if (UVOverlay)
+		{
+			UVOverlay->AppendElement(FVector2f(Buffers.UV0[Index]));
+		}
+	}
+	for (int32 Index = 0; Index < Buffers.Triangles.Num(); ++Index)
+	{
+		const FIntVector& Triangle = Buffers.Triangles[Index];
+		const int32 TriangleID = Mesh.AppendTriangle(Triangle.X, Triangle.Y, Triangle.Z);
+		if (TriangleID >= 0)
+		{
+			if (UVOverlay)
+			{
+				UVOverlay->SetTriangle(TriangleID, FIndex3i(Triangle.X, Triangle.Y, Triangle.Z));
+			}
+			MaterialIDs->SetValue(TriangleID, Buffers.TriGroupIDs.IsValidIndex(Index) ? Buffers.TriGroupIDs[Index] : 0);
+		}
+	}
+	if (bRenderAttributes)
+	{
+		FMeshNormals::InitializeOverlayToPerVertexNormals(Mesh.Attributes()->PrimaryNormals(), false);
+	}
+}
+
+void UIslandDynamicAssets::CopyTerrainMesh(const UE::Geometry::FDynamicMesh3& Mesh,
+                                          UE::Geometry::FDynamicMesh3& OutTerrain)
+{
+	using namespace UE::Geometry;
+	OutTerrain.Clear();
+	const FDynamicMeshMaterialAttribute* MaterialIDs = Mesh.HasAttributes() ? Mesh.Attributes()->GetMaterialID() : nullptr;
+	TArray<int32> VertexMap;
+	VertexMap.Init(INDEX_NONE, Mesh.MaxVertexID());
+	for (const int32 TriangleID : Mesh.TriangleIndicesItr())
+	{
+		if (MaterialIDs != nullptr && MaterialIDs->GetValue(TriangleID) == RiverMaterialID)
+		{
+			continue;
+		}
+		FIndex3i Triangle = Mesh.GetTriangle(TriangleID);
+		for (int32 Corner = 0; Corner < 3; ++Corner)
+		{
+			int32& Vertex = VertexMap[Triangle[Corner]];
+			if (Vertex == INDEX_NONE)
+			{
+				Vertex = OutTerrain.AppendVertex(Mesh.GetVertex(Triangle[Corner]));
+			}
+			Triangle[Corner] = Vertex;
+		}
+		OutTerrain.AppendTriangle(Triangle);
+	}
 }
 
 int32 UIslandDynamicAssets::GetTileAmount() const
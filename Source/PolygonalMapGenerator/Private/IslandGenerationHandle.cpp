@@ -0,0 +1,204 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "IslandGenerationHandle.h"
+
+void UIslandGenerationHandle::Cancel()
+{
+	bCancelled = true;
+}
+
+float UIslandGenerationHandle::GetProgress() const
+{
+	if (bDone && bSucceeded)
+	{
+		return 1.f;
+	}
+	float progress = 0.f;
+	for (const float stageProgress : StageProgress)
+	{
+		progress += stageProgress;
+	}
+	return StageProgress.IsEmpty() ? 0.f : progress / StageProgress.Num();
+}
+
+FString UIslandGenerationHandle::GetStageName(int32 Stage) const
+{
+	if (Stage == 0)
+	{
+		return TEXT("Points");
+	}
+	return Stages.IsValidIndex(Stage - 1) ? FString(Stages[Stage - 1].Name) : FString();
+}
+
+float UIslandGenerationHandle::GetStageProgress(int32 Stage) const
+{
+	return StageProgress.IsValidIndex(Stage) ? StageProgress[Stage] : 0.f;
+}
+
+void UIslandGenerationHandle::BeginDestroy()
+{
+	// Listeners must not run while the handle is torn down
+	CancelAndWait(false);
+	Super::BeginDestroy();
+}
+
+void UIslandGenerationHandle::Start(UIslandMapData* InMapData)
+{
+	check(IsInGameThread());
+	MapData = InMapData;
+	StageProgress.Init(0.f, 1);
+	TickerHandle = FTSTicker::GetCoreTicker().AddTicker(
+		FTickerDelegate::CreateUObject(this, &UIslandGenerationHandle::Tick));
+}
+
+bool UIslandGenerationHandle::Tick(float DeltaTime)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UIslandGenerationHandle::Tick)
+	if (!bBegun)
+	{
+		bBegun = true;
+		if (bCancelled || !IsValid(MapData))
+		{
+			Finish(false);
+			return false;
+		}
+		// Dispatched like a synchronous call so Blueprint and C++ overrides run, the parent implementation only
+		// queues the stages for the next ticks
+		bQueueingStages = true;
+		MapData->GenerateIsland();
+		bQueueingStages = false;
+		StageProgress[0] = 1.f;
+		if (!bStagesQueued)
+		{
+			// The override generated the island without its parent implementation
+			Finish(true);
+			return false;
+		}
+		if (GenerationStart != UIslandMapData::EGenerationStart::RunStages)
+		{
+			Finish(GenerationStart == UIslandMapData::EGenerationStart::Cached);
+			return false;
+		}
+		return true;
+	}
+
+	if (bConcurrent)
+	{
+		for (int32 index = 0; index < StageEvents.Num(); index++)
+		{
+			StageProgress[index + 1] = StageEvents[index]->IsComplete() ? 1.f : 0.f;
+		}
+		// Same as RunGenerationStages: in stage order and only once every stage task is done
+		while (NextStage < Stages.Num() && AreStageTasksComplete())
+		{
+			if (!bCancelled && Stages[NextStage].OnComplete != nullptr)
+			{
+				Stages[NextStage].OnComplete->Broadcast();
+			}
+			NextStage++;
+		}
+	}
+	else if (NextStage < Stages.Num() && !bCancelled)
+	{
+		const UIslandMapData::FGenerationStage& stage = Stages[NextStage];
+		UIslandMapData::RunGenerationStage(stage);
+		if (stage.OnComplete != nullptr)
+		{
+			stage.OnComplete->Broadcast();
+		}
+		StageProgress[++NextStage] = 1.f;
+	}
+
+	if (bCancelled)
+	{
+		if (!AreStageTasksComplete())
+		{
+			return true;
+		}
+		MapData->InvalidateGenerationCache();
+		Finish(false);
+		return false;
+	}
+	if (NextStage == Stages.Num())
+	{
+		MapData->EndGeneration(CacheKey);
+		Finish(true);
+		return false;
+	}
+	return true;
+}
+
+void UIslandGenerationHandle::QueueStages()
+{
+	if (bStagesQueued)
+	{
+		return;
+	}
+	bStagesQueued = true;
+	GenerationStart = MapData->BeginGeneration(Stages, CacheKey, bConcurrent);
+	StageProgress.SetNumZeroed(Stages.Num() + 1);
+	if (GenerationStart != UIslandMapData::EGenerationStart::RunStages || !bConcurrent)
+	{
+		return;
+	}
+	StageEvents.Reserve(Stages.Num());
+	for (const UIslandMapData::FGenerationStage& stage : Stages)
+	{
+		FGraphEventArray prerequisites;
+		for (int32 prerequisite : stage.Prerequisites)
+		{
+			prerequisites.Add(StageEvents[prerequisite]);
+		}
+		StageEvents.Add(FFunctionGraphTask::CreateAndDispatchWhenReady([this, &stage]()
+		{
+			if (!bCancelled)
+			{
+				UIslandMapData::RunGenerationStage(stage);
+			}
+		}, TStatId(), &prerequisites));
+	}
+}
+
+void UIslandGenerationHandle::Finish(bool bInSucceeded, bool bBroadcast)
+{
+	bDone = true;
+	bSucceeded = bInSucceeded;
+	TickerHandle.Reset();
+	if (MapData != nullptr && MapData->ActiveGeneration == this)
+	{
+		MapData->ActiveGeneration = nullptr;
+	}
+	if (bBroadcast)
+	{
+		OnFinished.Broadcast(bSucceeded);
+	}
+}
+
+void UIslandGenerationHandle::CancelAndWait(bool bBroadcast)
+{
+	if (bDone || !TickerHandle.IsValid())
+	{
+		return;
+	}
+	check(IsInGameThread());
+	bCancelled = true;
+	FTaskGraphInterface::Get().WaitUntilTasksComplete(StageEvents);
+	FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+	if (bBegun && MapData != nullptr)
+	{
+		MapData->InvalidateGenerationCache();
+	}
+	Finish(false, bBroadcast);
+}
+
+bool UIslandGenerationHandle::AreStageTasksComplete() const
+{
+	for (const FGraphEventRef& event : StageEvents)
+	{
+		if (!event->IsComplete())
+		{
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,126 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "IslandGenerationReport.h"
+
+#include "PolygonalMapGenerator.h"
+
+DEFINE_STAT(STAT_IslandPoints);
+DEFINE_STAT(STAT_IslandWater);
+DEFINE_STAT(STAT_IslandElevation);
+DEFINE_STAT(STAT_IslandRivers);
+DEFINE_STAT(STAT_IslandMoisture);
+DEFINE_STAT(STAT_IslandCoast);
+DEFINE_STAT(STAT_IslandTemperature);
+DEFINE_STAT(STAT_IslandBiomes);
+DEFINE_STAT(STAT_IslandDistricts);
+DEFINE_STAT(STAT_IslandCoastlines);
+DEFINE_STAT(STAT_IslandFinish);
+DEFINE_STAT(STAT_IslandLayersMemory);
+DEFINE_STAT(STAT_IslandMeshMemory);
+
+void FIslandGenerationReport::Reset()
+{
+	Stages.Reset();
+	TotalSeconds = 0.f;
+	bLoadedFromCache = false;
+	bLoadedFromBake = false;
+	NumRegions = 0;
+	LayersAllocatedSize = 0;
+	MeshAllocatedSize = 0;
+	Diagnostics.Reset();
+}
+
+void FIslandGenerationReport::SetDiagnostics(const FGenerationDiagnostics& InDiagnostics)
+{
+	Diagnostics.Reset();
+	for (const FGenerationDiagnostics::FCategory& Category : InDiagnostics.GetCategories())
+	{
+		FIslandDiagnosticCount& Entry = Diagnostics.AddDefaulted_GetRef();
+		Entry.Category = Category.Name;
+		Entry.Count = Category.Count;
+		Entry.Samples.Append(Category.Samples);
+	}
+}
+
+FIslandStageTiming& FIslandGenerationReport::AddStage(FName Stage)
+{
+	checkf(Stages.Num() < Stages.Max(), TEXT("Adding stage %s would move the entries handed out before"),
+	       *Stage.ToString());
+	FIslandStageTiming& Timing = Stages.AddDefaulted_GetRef();
+	Timing.Stage = Stage;
+	return Timing;
+}
+
+float FIslandGenerationReport::GetStageSeconds(FName Stage) const
+{
+	const FIslandStageTiming* Timing = Stages.FindByPredicate([Stage](const FIslandStageTiming& Entry)
+	{
+		return Entry.Stage == Stage;
+	});
+	return Timing != nullptr ? Timing->Seconds : 0.f;
+}
+
+void FIslandGenerationReport::Log() const
+{
+	for (const FIslandStageTiming& Timing : Stages)
+	{
+		UE_LOG(LogMapGen, Log, TEXT("%s took %f seconds%s."), *Timing.Stage.ToString(), Timing.Seconds,
+		       Timing.bSkipped ? TEXT(", reused the previous outputs") : TEXT(""));
+	}
+	for (const FIslandDiagnosticCount& Entry : Diagnostics)
+	{
+		const FString Samples = FString::JoinBy(Entry.Samples, TEXT(", "), [](const int64 Sample)
+		{
+			return LexToString(Sample);
+		});
+		UE_LOG(LogMapGen, Warning, TEXT("%s: %lld times%s%s."), *Entry.Category, Entry.Count,
+		       Samples.IsEmpty() ? TEXT("") : TEXT(", first at "), *Samples);
+	}
+	UE_LOG(LogMapGen, Log,
+	       TEXT("Total map generation time: %f seconds%s, %d regions, %lld bytes of layers and %lld of mesh."),
+	       TotalSeconds, bLoadedFromBake ? TEXT(" from the bake") : bLoadedFromCache ? TEXT(" from the cache") : TEXT(""),
+	       NumRegions, LayersAllocatedSize, MeshAllocatedSize);
+}
+
+void FIslandMemoryFootprint::Add(FName Name, SIZE_T Bytes)
+{
+	FIslandMemoryComponent& Component = Components.AddDefaulted_GetRef();
+	Component.Name = Name;
+	Component.Bytes = static_cast<int64>(Bytes);
+	TotalBytes += Component.Bytes;
+}
+
+int64 FIslandMemoryFootprint::GetBytes(FName Name) const
+{
+	int64 Bytes = 0;
+	for (const FIslandMemoryComponent& Component : Components)
+	{
+		if (Component.Name == Name)
+		{
+			Bytes += Component.Bytes;
+		}
+	}
+	return Bytes;
+}
+
+void FIslandMemoryFootprint::Log() const
+{
+	for (const FIslandMemoryComponent& Component : Components)
+	{
+		UE_LOG(LogMapGen, Log, TEXT("%s: %lld bytes."), *Component.Name.ToString(), Component.Bytes);
+	}
+	UE_LOG(LogMapGen, Log, TEXT("Total: %lld bytes."), TotalBytes);
+}
+
+FIslandStageScope::FIslandStageScope(FIslandStageTiming* InTiming, TStatId StatId)
+	: Timing(InTiming), StartCycles(FPlatformTime::Cycles64()), CycleCounter(StatId)
+{
+}
+
+FIslandStageScope::~FIslandStageScope()
+{
+	if (Timing != nullptr)
+	{
+		Timing->Seconds = FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - StartCycles);
+	}
+}
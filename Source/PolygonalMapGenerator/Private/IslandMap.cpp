@@ -17,9 +17,10 @@
 */
 
 #include "IslandMap.h"
-#include "DualMeshBuilder.h"
+#include "IslandGenerationHandle.h"
 #include "IslandMapUtils.h"
-#include "TimerManager.h"
+#include "IslandPreviewGenerator.h"
+#include "Net/UnrealNetwork.h"
 
 // Sets default values
 AIslandMap::AIslandMap()
@@ -29,12 +30,30 @@ AIslandMap::AIslandMap()
 	Seed = 0;
 	DrainageSeed = 1;
 	RiverSeed = 2;
+	DistrictSeed = 3;
 	NumRivers = 30;
-
+	bGenerateAsynchronously = false;
+	bIncrementalRegeneration = true;
+	bUseDiskCache = false;
+	bReplicationMismatch = false;
+#if WITH_EDITORONLY_DATA
+	bLivePreview = false;
+	PreviewSpacingScale = 4.f;
+	PreviewRefineDelay = 0.5f;
+#endif
 #if !UE_BUILD_SHIPPING
 	LastRegenerationTime = FDateTime::MinValue();
 #endif
 
+	MapData = CreateDefaultSubobject<UIslandMapData>(TEXT("MapData"));
+	MapData->OnIslandPointGenerationComplete.AddDynamic(this, &AIslandMap::HandleMapPointsGenerated);
+	MapData->OnIslandWaterGenerationComplete.AddDynamic(this, &AIslandMap::HandleMapWaterGenerated);
+	MapData->OnIslandElevationGenerationComplete.AddDynamic(this, &AIslandMap::HandleMapElevationGenerated);
+	MapData->OnIslandRiverGenerationComplete.AddDynamic(this, &AIslandMap::HandleMapRiversGenerated);
+	MapData->OnIslandMoistureGenerationComplete.AddDynamic(this, &AIslandMap::HandleMapMoistureGenerated);
+	MapData->OnIslandBiomeGenerationComplete.AddDynamic(this, &AIslandMap::HandleMapBiomesGenerated);
+	MapData->OnIslandGenerationComplete.AddDynamic(this, &AIslandMap::HandleMapGenerated);
+
 	OnIslandPointGenerationComplete.AddDynamic(this, &AIslandMap::OnPointGenerationComplete);
 	OnIslandWaterGenerationComplete.AddDynamic(this, &AIslandMap::OnWaterGenerationComplete);
 	OnIslandElevationGenerationComplete.AddDynamic(this, &AIslandMap::OnElevationGenerationComplete);
@@ -44,26 +63,165 @@ AIslandMap::AIslandMap()
 	OnIslandGenerationComplete.AddDynamic(this, &AIslandMap::OnIslandGenComplete);
 }
 
-/*void AIslandMap::OnConstruction(const FTransform& NewTransform)
+void AIslandMap::BeginPlay()
+{
+	Super::BeginPlay();
+	// Clients wait for the seeds of the server, which may have arrived before play began
+	if (HasAuthority() || ReplicatedIsland.IsValid())
+	{
+		GenerateIsland();
+	}
+}
+
+void AIslandMap::BeginDestroy()
 {
-	Super::OnConstruction(NewTransform);
+#if WITH_EDITOR
+	FTSTicker::GetCoreTicker().RemoveTicker(PreviewRefineHandle);
+#endif
+	Super::BeginDestroy();
+}
 
-#if !UE_BUILD_SHIPPING
-	FDateTime now = FDateTime::UtcNow();
-	FTimespan lengthBetweenRegeneration = now - LastRegenerationTime;
-	if (lengthBetweenRegeneration.GetTotalSeconds() < 1 || Rng.GetInitialSeed() == Seed && RiverRng.GetInitialSeed() == RiverSeed && DrainageRng.GetInitialSeed() == DrainageSeed)
+#if WITH_EDITOR
+void AIslandMap::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+	const UWorld* World = GetWorld();
+	if (!bLivePreview || World == nullptr || World->IsGameWorld() || HasAnyFlags(RF_ClassDefaultObject))
 	{
-		OnIslandGenComplete();
 		return;
 	}
+	FTSTicker::GetCoreTicker().RemoveTicker(PreviewRefineHandle);
+	PreviewRefineHandle.Reset();
+	if (PropertyChangedEvent.ChangeType == EPropertyChangeType::Interactive)
+	{
+		RequestPreview(PreviewSpacingScale);
+		return;
+	}
+	// Refined once the edits stop, every edit until then pushes it back
+	PreviewRefineHandle = FTSTicker::GetCoreTicker().AddTicker(
+		FTickerDelegate::CreateWeakLambda(this, [this](float)
+		{
+			PreviewRefineHandle.Reset();
+			RequestPreview(1.f);
+			return false;
+		}), PreviewRefineDelay);
+}
+
+void AIslandMap::RequestPreview(float SpacingScale)
+{
+	if (!ApplySettings())
+	{
+		return;
+	}
+	if (PreviewGenerator == nullptr)
+	{
+		PreviewGenerator = NewObject<UIslandPreviewGenerator>(this, NAME_None, RF_Transient);
+	}
+	PreviewGenerator->RequestPreview(MapData, SpacingScale);
+}
 #endif
 
-	GenerateIsland();
-}*/
+void AIslandMap::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+	DOREPLIFETIME(AIslandMap, ReplicatedIsland);
+	DOREPLIFETIME(AIslandMap, RegionPatches);
+}
 
-void AIslandMap::BeginPlay()
+void AIslandMap::OnRep_ReplicatedIsland()
+{
+	if (!ReplicatedIsland.IsValid())
+	{
+		return;
+	}
+	Seed = ReplicatedIsland.Seed;
+	DrainageSeed = ReplicatedIsland.DrainageSeed;
+	RiverSeed = ReplicatedIsland.RiverSeed;
+	DistrictSeed = ReplicatedIsland.DistrictSeed;
+	bDetermineRandomSeedAtRuntime = false;
+	bReplicationMismatch = false;
+	if (HasActorBegunPlay())
+	{
+		GenerateIsland();
+	}
+}
+
+void AIslandMap::OnRep_RegionPatches()
+{
+	// Generations in flight apply the patches once they are done
+	if (MapData->GetActiveGeneration() == nullptr)
+	{
+		ApplyPendingRegionPatches();
+	}
+}
+
+void AIslandMap::ApplyPendingRegionPatches()
 {
-	GenerateIsland();
+	if (HasAuthority() || bReplicationMismatch || !ReplicatedIsland.IsValid() || MapData->Mesh == nullptr)
+	{
+		return;
+	}
+	// The patches hold absolute values, applying them again leaves the regions as they are
+	if (!RegionPatches.IsEmpty())
+	{
+		MapData->ApplyRegionPatches(RegionPatches);
+	}
+	RegionBiomes.Reset();
+}
+
+bool AIslandMap::AddRegionPatch(const FIslandRegionPatch& Patch)
+{
+	if (!HasAuthority())
+	{
+		return false;
+	}
+
+	// Merges the edited ranges, touching ones included, so every region is sent once
+	TArray<FInt32Interval> Ranges;
+	for (const FIslandRegionPatch& RegionPatch : RegionPatches)
+	{
+		Ranges.Emplace(RegionPatch.FirstRegion, RegionPatch.FirstRegion + RegionPatch.Num());
+	}
+	Ranges.Emplace(Patch.FirstRegion, Patch.FirstRegion + Patch.Num());
+	Ranges.Sort([](const FInt32Interval& A, const FInt32Interval& B) { return A.Min < B.Min; });
+	TArray<FInt32Interval> MergedRanges;
+	for (const FInt32Interval& Range : Ranges)
+	{
+		if (!MergedRanges.IsEmpty() && Range.Min <= MergedRanges.Last().Max)
+		{
+			MergedRanges.Last().Max = FMath::Max(MergedRanges.Last().Max, Range.Max);
+		}
+		else
+		{
+			MergedRanges.Add(Range);
+		}
+	}
+	int32 PatchNum = 0;
+	for (const FInt32Interval& Range : MergedRanges)
+	{
+		PatchNum += FMath::DivideAndRoundUp(Range.Size(), MaxRegionPatchSize);
+	}
+	if (PatchNum > MaxRegionPatchNum)
+	{
+		UE_LOG(LogMapGen, Warning, TEXT("%s: the region patches would cover more than %d ranges of %d regions, regenerate the island instead"),
+		       *GetName(), MaxRegionPatchNum, MaxRegionPatchSize);
+		return false;
+	}
+
+	if (!MapData->ApplyRegionPatch(Patch))
+	{
+		return false;
+	}
+	RegionPatches.Reset(PatchNum);
+	for (const FInt32Interval& Range : MergedRanges)
+	{
+		for (int32 First = Range.Min; First < Range.Max; First += MaxRegionPatchSize)
+		{
+			RegionPatches.Add(MapData->MakeRegionPatch(First, FMath::Min(MaxRegionPatchSize, Range.Max - First)));
+		}
+	}
+	RegionBiomes.Reset();
+	return true;
 }
 
 void AIslandMap::OnPointGenerationComplete_Implementation()
@@ -101,398 +259,269 @@ void AIslandMap::OnIslandGenComplete_Implementation()
 	// Do nothing by default
 }
 
-void AIslandMap::GenerateIsland_Implementation()
+void AIslandMap::HandleMapPointsGenerated()
 {
-	if (PointGenerator == NULL || Water == NULL || Elevation == NULL || Rivers == NULL || Moisture == NULL || Biomes == NULL)
-	{
-		UE_LOG(LogMapGen, Error, TEXT("IslandMap not properly set up!"));
-		return;
-	}
-	FDateTime startTime;
-#if !UE_BUILD_SHIPPING
-	startTime = FDateTime::UtcNow();
-	LastRegenerationTime = startTime;
-#endif
-	
-	if (bDetermineRandomSeedAtRuntime)
-	{
-		startTime = FDateTime::UtcNow();
-		int multiplier = startTime.GetSecond() % 2 == 0 ? 1 : -1;
-		Seed = ((startTime.GetMillisecond() * startTime.GetMinute()) + (startTime.GetHour() * startTime.GetDayOfYear())) * multiplier;
-	}
-
-	Rng = FRandomStream();
-	Rng.Initialize(Seed);
-	if (bDetermineRandomSeedAtRuntime)
-	{
-		RiverSeed = Rng.RandRange(INT32_MIN, INT32_MAX);
-		DrainageSeed = Rng.RandRange(INT32_MIN, INT32_MAX);
-	}
-	RiverRng = FRandomStream();
-	RiverRng.Initialize(RiverSeed);
-	DrainageRng = FRandomStream();
-	DrainageRng.Initialize(DrainageSeed);
-
-	Persistence = FMath::Pow(0.5f, 1.0 + Smoothing);
-	Shape.Amplitudes.SetNum(Shape.Octaves);
-	for (int i = 0; i < Shape.Amplitudes.Num(); i++)
-	{
-		Shape.Amplitudes[i] = FMath::Pow(Persistence, i);
-	}
-
-#if !UE_BUILD_SHIPPING
-	FDateTime finishedTime = FDateTime::UtcNow();
-	FTimespan difference = finishedTime - startTime;
-	startTime = finishedTime;
-	UE_LOG(LogMapGen, Log, TEXT("Initialization took %f seconds."), difference.GetTotalSeconds());
-#endif
-
-	// Generate map points
-	Mesh = PointGenerator->GenerateDualMesh(Rng); 
+	Mesh = MapData->Mesh;
+	Rng = MapData->Rng;
+	RiverRng = MapData->RiverRng;
+	DrainageRng = MapData->DrainageRng;
+	Persistence = MapData->Persistence;
+	RegionBiomes.Reset();
 	OnIslandPointGenerationComplete.Broadcast();
+}
 
-#if !UE_BUILD_SHIPPING
-	finishedTime = FDateTime::UtcNow();
-	difference = finishedTime - startTime;
-	startTime = finishedTime;
-	UE_LOG(LogMapGen, Log, TEXT("Generating points took %f seconds."), difference.GetTotalSeconds());
-#endif
-
-	// Reset all arrays
-	CreatedRivers.Empty(NumRivers);
-	spring_t.Empty();
-	river_t.Empty(NumRivers);
-
-	r_water.Empty(Mesh->NumRegions);
-	r_water.SetNumZeroed(Mesh->NumRegions);
-	r_ocean.Empty(Mesh->NumRegions);
-	r_ocean.SetNumZeroed(Mesh->NumRegions);
-
-	t_elevation.Empty(Mesh->NumTriangles);
-	t_elevation.SetNumZeroed(Mesh->NumTriangles);
-	t_downslope_s.Empty(Mesh->NumTriangles);
-	t_downslope_s.SetNum(Mesh->NumTriangles);
-	t_coastdistance.Empty(Mesh->NumTriangles);
-	t_coastdistance.SetNumZeroed(Mesh->NumTriangles);
-	r_elevation.Empty(Mesh->NumRegions);
-	r_elevation.SetNumZeroed(Mesh->NumRegions);
-
-	s_flow.Empty(Mesh->NumSides);
-	s_flow.SetNumZeroed(Mesh->NumSides);
-
-	r_moisture.Empty(Mesh->NumRegions);
-	r_moisture.SetNumZeroed(Mesh->NumRegions);
-	r_waterdistance.Empty(Mesh->NumRegions);
-	r_waterdistance.SetNumZeroed(Mesh->NumRegions);
-
-	r_coast.Empty(Mesh->NumRegions);
-	r_coast.SetNumZeroed(Mesh->NumRegions);
-	r_temperature.Empty(Mesh->NumRegions);
-	r_temperature.SetNumZeroed(Mesh->NumRegions);
-	r_biome.Empty(Mesh->NumRegions);
-	r_biome.SetNumZeroed(Mesh->NumRegions);
-
-#if !UE_BUILD_SHIPPING
-	finishedTime = FDateTime::UtcNow();
-	difference = finishedTime - startTime;
-	startTime = finishedTime;
-	UE_LOG(LogMapGen, Log, TEXT("Resetting arrays took %f seconds."), difference.GetTotalSeconds());
-#endif
-
-	// Water
-	Water->assign_r_water(r_water, Rng, Mesh, Shape);
-	Water->assign_r_ocean(r_ocean, Mesh, r_water);
+void AIslandMap::HandleMapWaterGenerated()
+{
 	OnIslandWaterGenerationComplete.Broadcast();
+}
 
-#if !UE_BUILD_SHIPPING
-	finishedTime = FDateTime::UtcNow();
-	difference = finishedTime - startTime;
-	startTime = finishedTime;
-	UE_LOG(LogMapGen, Log, TEXT("Generated map water in %f seconds."), difference.GetTotalSeconds());
-#endif
-
-	// Elevation
-	Elevation->assign_t_elevation(t_elevation, t_coastdistance, t_downslope_s, Mesh, r_ocean, r_water, DrainageRng);
-	Elevation->redistribute_t_elevation(t_elevation, Mesh, r_ocean);
-	Elevation->assign_r_elevation(r_elevation, Mesh, t_elevation, r_ocean);
+void AIslandMap::HandleMapElevationGenerated()
+{
 	OnIslandElevationGenerationComplete.Broadcast();
+}
 
-#if !UE_BUILD_SHIPPING
-	finishedTime = FDateTime::UtcNow();
-	difference = finishedTime - startTime;
-	startTime = finishedTime;
-	UE_LOG(LogMapGen, Log, TEXT("Generated map elevation in %f seconds."), difference.GetTotalSeconds());
-#endif
-
-	// Rivers
-	spring_t = Rivers->find_spring_t(Mesh, r_water, t_elevation, t_downslope_s);
-	UIslandMapUtils::RandomShuffle(spring_t, RiverRng);
-	river_t.SetNum(NumRivers < spring_t.Num() ? NumRivers : spring_t.Num());
-	for (int i = 0; i < river_t.Num(); i++)
-	{
-		river_t[i] = spring_t[i];
-	}
-	Rivers->assign_s_flow(s_flow, CreatedRivers, Mesh, t_downslope_s, river_t, RiverRng);
+void AIslandMap::HandleMapRiversGenerated()
+{
 	OnIslandRiverGenerationComplete.Broadcast();
+}
 
-#if !UE_BUILD_SHIPPING
-	finishedTime = FDateTime::UtcNow();
-	difference = finishedTime - startTime;
-	startTime = finishedTime;
-	UE_LOG(LogMapGen, Log, TEXT("Generated %d map rivers in %f seconds."), CreatedRivers.Num(), difference.GetTotalSeconds());
-#endif
-
-	// Moisture
-	Moisture->assign_r_moisture(r_moisture, r_waterdistance, Mesh, r_water, Moisture->find_moisture_seeds_r(Mesh, s_flow, r_ocean, r_water));
-	Moisture->redistribute_r_moisture(r_moisture, Mesh, r_water, BiomeBias.Rainfall, 1.0f + BiomeBias.Rainfall);
+void AIslandMap::HandleMapMoistureGenerated()
+{
 	OnIslandMoistureGenerationComplete.Broadcast();
+}
 
-#if !UE_BUILD_SHIPPING
-	finishedTime = FDateTime::UtcNow();
-	difference = finishedTime - startTime;
-	startTime = finishedTime;
-	UE_LOG(LogMapGen, Log, TEXT("Generated map moisture in %f seconds."), difference.GetTotalSeconds());
-#endif
-
-	// Biomes
-	Biomes->assign_r_coast(r_coast, Mesh, r_ocean);
-	Biomes->assign_r_temperature(r_temperature, Mesh, r_ocean, r_water, r_elevation, r_moisture, BiomeBias.NorthernTemperature, BiomeBias.SouthernTemperature);
-	Biomes->assign_r_biome(r_biome, Mesh, r_ocean, r_water, r_coast, r_temperature, r_moisture);
+void AIslandMap::HandleMapBiomesGenerated()
+{
+	RegionBiomes.Reset();
 	OnIslandBiomeGenerationComplete.Broadcast();
-
-#if !UE_BUILD_SHIPPING
-	finishedTime = FDateTime::UtcNow();
-	difference = finishedTime - startTime;
-	startTime = finishedTime;
-	UE_LOG(LogMapGen, Log, TEXT("Generated map biomes in %f seconds."), difference.GetTotalSeconds());
-	FTimespan completedTime = finishedTime - LastRegenerationTime;
-	UE_LOG(LogMapGen, Log, TEXT("Total map generation time: %f seconds."), completedTime.GetTotalSeconds());
-#endif
-
-	// Do whatever we need to do when the island generation is done
-	OnIslandGenerationComplete.Broadcast();
 }
 
-TArray<FIslandPolygon>& AIslandMap::GetVoronoiPolygons()
-{
-	if (VoronoiPolygons.Num() == 0)
+void AIslandMap::HandleMapGenerated()
+{
+	// The seeds may have been picked at runtime
+	Seed = MapData->Seed;
+	RiverSeed = MapData->RiverSeed;
+	DrainageSeed = MapData->DrainageSeed;
+	DistrictSeed = MapData->DistrictSeed;
+	Mesh = MapData->Mesh;
+	Rng = MapData->Rng;
+	RiverRng = MapData->RiverRng;
+	DrainageRng = MapData->DrainageRng;
+	Persistence = MapData->Persistence;
+	Shape = MapData->Shape;
+	RegionBiomes.Reset();
+	CreatedRivers = MapData->GetRivers();
+	if (HasAuthority())
 	{
-		VoronoiPolygons.SetNumZeroed(Mesh->NumSolidRegions);
-		for (FPointIndex r = 0; r < Mesh->NumSolidRegions; r++)
+		ReplicatedIsland = MapData->GetReplicationState();
+		RegionPatches.Reset();
+	}
+	else if (ReplicatedIsland.IsValid())
+	{
+		bReplicationMismatch = !MapData->VerifyReplicationState(ReplicatedIsland);
+		if (bReplicationMismatch)
 		{
-			VoronoiPolygons[r].Biome = r_biome[r];
-			VoronoiPolygons[r].Vertices = Mesh->r_circulate_t(r);
-			for (FTriangleIndex t : VoronoiPolygons[r].Vertices)
-			{
-				if (!t.IsValid())
-				{
-					continue;
-				}
-				FVector2D point2D = Mesh->t_pos(t);
-				float z = t_elevation.IsValidIndex(t) ? t_elevation[t] : -1000.0f;
-				VoronoiPolygons[r].VertexPoints.Add(FVector(point2D.X, point2D.Y, z * 10000));
-			}
+			UE_LOG(LogMapGen, Error, TEXT("%s generated a different island than the server"), *GetName());
 		}
+		ApplyPendingRegionPatches();
 	}
-	return VoronoiPolygons;
+	OnIslandGenerationComplete.Broadcast();
 }
 
-TArray<bool>& AIslandMap::GetWaterRegions()
+bool AIslandMap::ApplySettings()
 {
-	return r_water;
+	if (PointGenerator == NULL || Water == NULL || Elevation == NULL || Rivers == NULL || Moisture == NULL ||
+		Biomes == NULL)
+	{
+		UE_LOG(LogMapGen, Error, TEXT("IslandMap not properly set up!"));
+		return false;
+	}
+	MapData->Seed = Seed;
+	MapData->DrainageSeed = DrainageSeed;
+	MapData->RiverSeed = RiverSeed;
+	MapData->DistrictSeed = DistrictSeed;
+	MapData->bDetermineRandomSeedAtRuntime = bDetermineRandomSeedAtRuntime;
+	MapData->BiomeBias = BiomeBias;
+	MapData->Shape = Shape;
+	MapData->NumRivers = NumRivers;
+	MapData->Smoothing = Smoothing;
+	MapData->PointGenerator = PointGenerator;
+	MapData->Biomes = Biomes;
+	MapData->Elevation = Elevation;
+	MapData->Moisture = Moisture;
+	MapData->Rivers = Rivers;
+	MapData->Water = Water;
+	MapData->District = District;
+	MapData->bIncrementalRegeneration = bIncrementalRegeneration;
+	MapData->bUseDiskCache = bUseDiskCache;
+	return true;
 }
 
-bool AIslandMap::IsPointWater(FPointIndex Region) const
+void AIslandMap::GenerateIsland_Implementation()
 {
-	if (r_water.IsValidIndex(Region))
+	if (!ApplySettings())
+	{
+		return;
+	}
+#if !UE_BUILD_SHIPPING
+	LastRegenerationTime = FDateTime::UtcNow();
+#endif
+	if (bGenerateAsynchronously)
 	{
-		return r_water[Region];
+		MapData->GenerateIslandAsync();
 	}
 	else
 	{
-		return false;
+		MapData->GenerateIsland();
 	}
 }
 
-TArray<bool>& AIslandMap::GetOceanRegions()
+const FIslandVoronoiView& AIslandMap::GetVoronoiView()
+{
+	return MapData->GetVoronoiView();
+}
+
+TArray<FIslandPolygon>& AIslandMap::GetVoronoiPolygons()
+{
+	return MapData->GetVoronoiPolygons();
+}
+
+TArray<bool> AIslandMap::GetWaterRegions() const
+{
+	return MapData->GetWaterRegions();
+}
+
+bool AIslandMap::IsPointWater(FPointIndex Region) const
+{
+	return MapData->IsPointWater(Region);
+}
+
+TArray<bool> AIslandMap::GetOceanRegions() const
 {
-	return r_ocean;
+	return MapData->GetOceanRegions();
 }
 
 bool AIslandMap::IsPointOcean(FPointIndex Region) const
 {
-	if (r_ocean.IsValidIndex(Region))
-	{
-		return r_ocean[Region];
-	}
-	else
-	{
-		return false;
-	}
+	return MapData->IsPointOcean(Region);
 }
 
-TArray<bool>& AIslandMap::GetCoastalRegions()
+TArray<bool> AIslandMap::GetCoastalRegions() const
 {
-	return r_coast;
+	return MapData->GetCoastalRegions();
 }
 
 bool AIslandMap::IsPointCoast(FPointIndex Region) const
 {
-	if (r_coast.IsValidIndex(Region))
-	{
-		return r_coast[Region];
-	}
-	else
-	{
-		return false;
-	}
+	return MapData->IsPointCoast(Region);
 }
 
-TArray<float>& AIslandMap::GetRegionElevations()
+const TArray<float>& AIslandMap::GetRegionElevations() const
 {
-	return r_elevation;
+	return MapData->GetRegionElevations();
 }
 
 float AIslandMap::GetPointElevation(FPointIndex Region) const
 {
-	if (r_elevation.IsValidIndex(Region))
-	{
-		return r_elevation[Region];
-	}
-	else
-	{
-		return -1.0f;
-	}
+	return MapData->GetPointElevation(Region);
 }
 
-TArray<int32>& AIslandMap::GetRegionWaterDistance()
+const TArray<int32>& AIslandMap::GetRegionWaterDistance() const
 {
-	return r_waterdistance;
+	return MapData->GetRegionWaterDistance();
 }
 
 int32 AIslandMap::GetPointWaterDistance(FPointIndex Region) const
 {
-	if (r_waterdistance.IsValidIndex(Region))
-	{
-		return r_waterdistance[Region];
-	}
-	else
-	{
-		return -1;
-	}
+	return MapData->GetPointWaterDistance(Region);
 }
 
-TArray<float>& AIslandMap::GetRegionMoisture()
+const TArray<float>& AIslandMap::GetRegionMoisture() const
 {
-	return r_moisture;
+	return MapData->GetRegionMoisture();
 }
 
 float AIslandMap::GetPointMoisture(FPointIndex Region) const
 {
-	if (r_moisture.IsValidIndex(Region))
-	{
-		return r_moisture[Region];
-	}
-	else
-	{
-		return -1.0f;
-	}
+	return MapData->GetPointMoisture(Region);
 }
 
-TArray<float>& AIslandMap::GetRegionTemperature()
+const TArray<float>& AIslandMap::GetRegionTemperature() const
 {
-	return r_temperature;
+	return MapData->GetRegionTemperature();
 }
 
 float AIslandMap::GetPointTemperature(FPointIndex Region) const
 {
-	if (r_temperature.IsValidIndex(Region))
-	{
-		return r_temperature[Region];
-	}
-	else
-	{
-		return -1.0f;
-	}
+	return MapData->GetPointTemperature(Region);
 }
 
 TArray<FBiomeData>& AIslandMap::GetRegionBiomes()
 {
-	return r_biome;
+	const TArray<uint8>& biomes = MapData->GetRegionBiomeIndices();
+	if (RegionBiomes.Num() != biomes.Num())
+	{
+		const TArray<FBiomeData>& palette = MapData->GetBiomePalette();
+		RegionBiomes.SetNum(biomes.Num());
+		for (int32 r = 0; r < biomes.Num(); r++)
+		{
+			RegionBiomes[r] = palette.IsValidIndex(biomes[r]) ? palette[biomes[r]] : FBiomeData();
+		}
+	}
+	return RegionBiomes;
 }
 
 FBiomeData AIslandMap::GetPointBiome(FPointIndex Region) const
 {
-	if (r_biome.IsValidIndex(Region))
-	{
-		return r_biome[Region];
-	}
-	else
-	{
-		return FBiomeData();
-	}
+	return MapData->GetPointBiome(Region);
 }
 
-TArray<int32>& AIslandMap::GetTriangleCoastDistances()
+const TArray<int32>& AIslandMap::GetTriangleCoastDistances() const
 {
-	return t_coastdistance;
+	return MapData->GetTriangleCoastDistances();
 }
 
 int32 AIslandMap::GetTriangleCoastDistance(FTriangleIndex Triangle) const
 {
-	if (t_coastdistance.IsValidIndex(Triangle))
-	{
-		return t_coastdistance[Triangle];
-	}
-	else
-	{
-		return -1;
-	}
+	return MapData->GetTriangleCoastDistance(Triangle);
 }
 
-TArray<float>& AIslandMap::GetTriangleElevations()
+const TArray<float>& AIslandMap::GetTriangleElevations() const
 {
-	return t_elevation;
+	return MapData->GetTriangleElevations();
 }
 
 float AIslandMap::GetTriangleElevation(FTriangleIndex Triangle) const
 {
-	if (t_elevation.IsValidIndex(Triangle))
-	{
-		return t_elevation[Triangle];
-	}
-	else
-	{
-		return -1.0f;
-	}
+	return MapData->GetTriangleElevation(Triangle);
 }
 
 TArray<FSideIndex>& AIslandMap::GetTriangleDownslopes()
 {
-	return t_downslope_s;
+	return MapData->GetTriangleDownslopes();
 }
 
 TArray<int32>& AIslandMap::GetSideFlow()
 {
-	return s_flow;
+	return MapData->GetSideFlow();
 }
 
 TArray<FTriangleIndex>& AIslandMap::GetSpringTriangles()
 {
-	return spring_t;
+	return MapData->GetSpringTriangles();
 }
 
 bool AIslandMap::IsTriangleSpring(FTriangleIndex Triangle) const
 {
-	return spring_t.Contains(Triangle);
+	return MapData->IsTriangleSpring(Triangle);
 }
 
 TArray<FTriangleIndex>& AIslandMap::GetRiverTriangles()
 {
-	return river_t;
+	return MapData->GetRiverTriangles();
 }
 
 bool AIslandMap::IsTriangleRiver(FTriangleIndex Triangle) const
 {
-	return river_t.Contains(Triangle);
+	return MapData->IsTriangleRiver(Triangle);
 }
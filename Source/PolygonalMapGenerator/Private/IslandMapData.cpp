@@ -17,16 +17,242 @@
 */
 
 #include "IslandMapData.h"
+#include "IslandBakedData.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "DualMeshArchive.h"
+#include "HAL/FileManager.h"
+#include "Misc/Crc.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/ObjectAndNameAsStringProxyArchive.h"
 #include "DualMeshBuilder.h"
 #include "DelaunayHelper.h"
+#include "IslandGenerationHandle.h"
 #include "IslandMapUtils.h"
+#include "LatentActions.h"
 #include "PolyPartitionHelper.h"
 #include "TimerManager.h"
 #include "Coastline/IslandCoastline.h"
+#include "Curves/CurveBase.h"
 #include "Engine/Canvas.h"
+#include "Engine/DataAsset.h"
+#include "Engine/DataTable.h"
+#include "Engine/Engine.h"
+#include "Engine/LatentActionManager.h"
+#include "Engine/World.h"
 #include "Kismet/KismetRenderingLibrary.h"
 #include "RandomSampling/PoissonDiscUtilities.h"
 
+namespace
+{
+	constexpr uint32 CacheMagic = 0x434C5349; // "ISLC"
+	// Bump whenever a layer is added or its type changes, or a seed stops producing the same island
+	constexpr int32 CacheVersion = 13;
+
+	// The full precision layer, decoded into Scratch while it is quantized
+	TConstArrayView<float> ReadLayer(const TArray<float>& Layer, const FIslandQuantizedFloatLayer& Quantized, TArray<float>& Scratch)
+	{
+		if (Quantized.Num() == 0)
+		{
+			return Layer;
+		}
+		Quantized.Decode(Scratch);
+		return Scratch;
+	}
+
+	// The full precision layer, or its copy in Decoded that is decoded on the first read while it is quantized
+	template <typename T, typename TQuantizedLayer>
+	const TArray<T>& ReadDecodedLayer(const TArray<T>& Layer, const TQuantizedLayer& Quantized, TArray<T>& Decoded,
+	                                  FCriticalSection& Lock)
+	{
+		if (Quantized.Num() == 0)
+		{
+			return Layer;
+		}
+		FScopeLock lock(&Lock);
+		if (Decoded.Num() != Quantized.Num())
+		{
+			Quantized.Decode(Decoded);
+		}
+		return Decoded;
+	}
+
+	// The meshes of bShareMeshes by mesh fingerprint and mesh options, kept while any map data holds them
+	struct FSharedMesh
+	{
+		TWeakObjectPtr<UTriangleDualMesh> Mesh;
+		FRandomStream PostMeshRng;
+	};
+	FCriticalSection SharedMeshLock;
+	TMap<uint64, FSharedMesh> SharedMeshes;
+
+	// Referenced objects whose own properties feed the generation, everything else only contributes its path
+	bool IsHashedReference(const UObject* Referenced, const UObject* Root)
+	{
+		return Referenced->IsA<UDataAsset>() || Referenced->IsA<UDataTable>() || Referenced->IsA<UCurveBase>()
+			|| Referenced->IsIn(Root);
+	}
+
+	void VisitReferencedObjects(const FProperty* Property, const void* Value, TFunctionRef<void(const UObject*)> Visit);
+
+	void VisitReferencedObjects(const UStruct* Struct, const void* Container, TFunctionRef<void(const UObject*)> Visit)
+	{
+		for (TFieldIterator<FProperty> it(Struct); it; ++it)
+		{
+			for (int32 index = 0; index < it->ArrayDim; index++)
+			{
+				VisitReferencedObjects(*it, it->ContainerPtrToValuePtr<void>(Container, index), Visit);
+			}
+		}
+	}
+
+	void VisitReferencedObjects(const FProperty* Property, const void* Value, TFunctionRef<void(const UObject*)> Visit)
+	{
+		if (const FObjectPropertyBase* objectProperty = CastField<FObjectPropertyBase>(Property))
+		{
+			if (const UObject* referenced = objectProperty->GetObjectPropertyValue(Value))
+			{
+				Visit(referenced);
+			}
+		}
+		else if (const FArrayProperty* arrayProperty = CastField<FArrayProperty>(Property))
+		{
+			FScriptArrayHelper array(arrayProperty, Value);
+			for (int32 index = 0; index < array.Num(); index++)
+			{
+				VisitReferencedObjects(arrayProperty->Inner, array.GetRawPtr(index), Visit);
+			}
+		}
+		else if (const FStructProperty* structProperty = CastField<FStructProperty>(Property))
+		{
+			VisitReferencedObjects(structProperty->Struct, Value, Visit);
+		}
+	}
+
+	uint32 HashObjectProperties(const UObject* Object, const UObject* Root, TSet<const UObject*>& Visited)
+	{
+		bool bVisited = false;
+		Visited.Add(Object, &bVisited);
+		if (bVisited)
+		{
+			return 0;
+		}
+		uint32 hash = GetTypeHash(Object->GetClass()->GetPathName());
+		auto hashReference = [&hash, Root, &Visited](const UObject* Referenced)
+		{
+			if (IsHashedReference(Referenced, Root))
+			{
+				hash = HashCombine(hash, HashObjectProperties(Referenced, Root, Visited));
+			}
+		};
+		FString value;
+		for (TFieldIterator<FProperty> it(Object->GetClass()); it; ++it)
+		{
+			for (int32 index = 0; index < it->ArrayDim; index++)
+			{
+				value.Reset();
+				it->ExportText_InContainer(index, value, Object, nullptr, nullptr, PPF_None);
+				hash = HashCombine(hash, GetTypeHash(value));
+				VisitReferencedObjects(*it, it->ContainerPtrToValuePtr<void>(Object, index), hashReference);
+			}
+		}
+		// The rows are no properties of the table
+		const UDataTable* table = Cast<UDataTable>(Object);
+		if (table != nullptr && table->RowStruct != nullptr)
+		{
+			for (const TPair<FName, uint8*>& row : table->GetRowMap())
+			{
+				value.Reset();
+				table->RowStruct->ExportText(value, row.Value, nullptr, nullptr, PPF_None, nullptr);
+				hash = HashCombine(hash, HashCombine(GetTypeHash(row.Key), GetTypeHash(value)));
+				VisitReferencedObjects(table->RowStruct, row.Value, hashReference);
+			}
+		}
+		return hash;
+	}
+
+	// Hashes the exported text of every property, so any edit in the details panel changes the result. Data assets,
+	// data tables and curves the object references (like a biome table) are hashed the same way, rows included, so
+	// editing them changes the result too. Other assets, like materials, only contribute their path.
+	uint32 HashObjectProperties(const UObject* Object)
+	{
+		if (Object == nullptr)
+		{
+			return 0;
+		}
+		TSet<const UObject*> visited;
+		return HashObjectProperties(Object, Object, visited);
+	}
+
+#if WITH_EDITOR
+	// A recompiled Blueprint keeps its class path, so its graphs are hashed through their bytecode. The bytecode
+	// holds object pointers and only compares within one editor session, so it stays out of the cache key.
+	// Cooked classes never change.
+	uint32 HashBlueprintGraphs(const UObject* Object)
+	{
+		uint32 hash = 0;
+		for (const UClass* cls = Object != nullptr ? Object->GetClass() : nullptr;
+		     cls != nullptr && !cls->HasAnyClassFlags(CLASS_Native); cls = cls->GetSuperClass())
+		{
+			for (TFieldIterator<UFunction> it(cls, EFieldIteratorFlags::ExcludeSuper); it; ++it)
+			{
+				hash = HashCombine(hash, GetTypeHash(it->GetFName()));
+				hash = HashCombine(hash, FCrc::MemCrc32(it->Script.GetData(), it->Script.Num()));
+			}
+		}
+		return hash;
+	}
+#endif
+
+	class FIslandGenerationLatentAction : public FPendingLatentAction
+	{
+	public:
+		FIslandGenerationLatentAction(UIslandGenerationHandle* InHandle, const FLatentActionInfo& LatentInfo,
+		                              bool& bOutSucceeded)
+			: Handle(InHandle), ExecutionFunction(LatentInfo.ExecutionFunction), OutputLink(LatentInfo.Linkage),
+			  CallbackTarget(LatentInfo.CallbackTarget), bSucceeded(bOutSucceeded)
+		{
+		}
+
+		virtual void UpdateOperation(FLatentResponse& Response) override
+		{
+			const bool bDone = !Handle.IsValid() || Handle->IsDone();
+			if (bDone)
+			{
+				bSucceeded = Handle.IsValid() && Handle->IsSucceeded();
+			}
+			Response.FinishAndTriggerIf(bDone, ExecutionFunction, OutputLink, CallbackTarget);
+		}
+
+		virtual void NotifyObjectDestroyed() override
+		{
+			Cancel();
+		}
+
+		virtual void NotifyActionAborted() override
+		{
+			Cancel();
+		}
+
+	private:
+		void Cancel() const
+		{
+			if (Handle.IsValid())
+			{
+				Handle->Cancel();
+			}
+		}
+
+		TWeakObjectPtr<UIslandGenerationHandle> Handle;
+		FName ExecutionFunction;
+		int32 OutputLink;
+		FWeakObjectPtr CallbackTarget;
+		bool& bSucceeded;
+	};
+}
+
 // Sets default values
 UIslandMapData::UIslandMapData()
 {
@@ -102,12 +328,114 @@ void UIslandMapData::OnIslandGenComplete_Implementation()
 }
 
 void UIslandMapData::GenerateIsland_Implementation()
+{
+	if (ActiveGeneration != nullptr && ActiveGeneration->bQueueingStages)
+	{
+		ActiveGeneration->QueueStages();
+		return;
+	}
+	if (ActiveGeneration != nullptr)
+	{
+		ActiveGeneration->CancelAndWait();
+	}
+	TArray<FGenerationStage> stages;
+	uint64 cacheKey = 0;
+	bool bConcurrent = false;
+	if (BeginGeneration(stages, cacheKey, bConcurrent) != EGenerationStart::RunStages)
+	{
+		return;
+	}
+	RunGenerationStages(stages, bConcurrent);
+	EndGeneration(cacheKey);
+}
+
+UIslandGenerationHandle* UIslandMapData::GenerateIslandAsync()
+{
+	check(IsInGameThread());
+	if (ActiveGeneration != nullptr)
+	{
+		ActiveGeneration->CancelAndWait();
+	}
+	if (bProgressiveGeneration && GenerateCoarseIsland())
+	{
+		// The full island must not reuse the mesh or layers of the coarse one
+		InvalidateGenerationCache();
+	}
+	ActiveGeneration = NewObject<UIslandGenerationHandle>(this);
+	ActiveGeneration->Start(this);
+	return ActiveGeneration;
+}
+
+bool UIslandMapData::GenerateCoarseIsland()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UIslandMapData::GenerateCoarseIsland)
+	const UIslandMeshBuilder* pointGenerator = PointGenerator != nullptr ? ApplyMemoryBudget() : nullptr;
+	if (pointGenerator == nullptr)
+	{
+		return false;
+	}
+	CoarsePointGenerator = DuplicateObject<UIslandMeshBuilder>(pointGenerator, this);
+	if (!CoarsePointGenerator->ScaleRegionNum(ProgressiveRegionFraction))
+	{
+		UE_LOG(LogMapGen, Warning, TEXT("%s cannot scale its region count, generating the full island only."),
+		       *pointGenerator->GetClass()->GetName());
+		CoarsePointGenerator = nullptr;
+		return false;
+	}
+	bGeneratingCoarseIsland = true;
+	GenerateIsland();
+	bGeneratingCoarseIsland = false;
+	return true;
+}
+
+void UIslandMapData::GenerateIslandLatent(UObject* WorldContextObject, FLatentActionInfo LatentInfo, bool& bSucceeded)
+{
+	bSucceeded = false;
+	UWorld* world = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::LogAndReturnNull);
+	if (world == nullptr)
+	{
+		return;
+	}
+	FLatentActionManager& latentManager = world->GetLatentActionManager();
+	if (latentManager.FindExistingAction<FIslandGenerationLatentAction>(LatentInfo.CallbackTarget, LatentInfo.UUID)
+		== nullptr)
+	{
+		latentManager.AddNewAction(LatentInfo.CallbackTarget, LatentInfo.UUID,
+		                           new FIslandGenerationLatentAction(GenerateIslandAsync(), LatentInfo, bSucceeded));
+	}
+}
+
+void UIslandMapData::BeginDestroy()
+{
+	// Stage tasks of a running generation write into this object, listeners are not told while it goes away
+	if (ActiveGeneration != nullptr)
+	{
+		ActiveGeneration->CancelAndWait(false);
+	}
+	Super::BeginDestroy();
+}
+
+UIslandMapData::EGenerationStart UIslandMapData::BeginGeneration(TArray<FGenerationStage>& OutStages,
+                                                                 uint64& OutCacheKey, bool& bOutConcurrent)
 {
 	if (PointGenerator == nullptr || Water == nullptr || Elevation == nullptr || Rivers == nullptr
-		|| Moisture == nullptr || Biomes == nullptr || District == nullptr)
+		|| Moisture == nullptr || Biomes == nullptr)
 	{
 		UE_LOG(LogMapGen, Error, TEXT("IslandMap not properly set up!"));
-		return;
+		return EGenerationStart::Invalid;
+	}
+	const UIslandMeshBuilder* pointGenerator = bGeneratingCoarseIsland ? CoarsePointGenerator.Get() : ApplyMemoryBudget();
+	if (pointGenerator == nullptr)
+	{
+		return EGenerationStart::Invalid;
+	}
+	GenerationStartCycles = FPlatformTime::Cycles64();
+	GenerationReport.Reset();
+	Diagnostics.Reset();
+	// The stages work in full precision, none of them may keep outputs that went through the quantization
+	if (ExpandQuantizedLayers())
+	{
+		StageFingerprints.Reset();
 	}
 	FDateTime startTime;
 	if (bDetermineRandomSeedAtRuntime)
@@ -124,7 +452,7 @@ void UIslandMapData::GenerateIsland_Implementation()
 	{
 		RiverSeed = Rng.RandRange(INT32_MIN, INT32_MAX);
 		DrainageSeed = Rng.RandRange(INT32_MIN, INT32_MAX);
-		DistrictRng = Rng.RandRange(INT32_MIN, INT32_MAX);
+		DistrictSeed = Rng.RandRange(INT32_MIN, INT32_MAX);
 	}
 	RiverRng = FRandomStream();
 	RiverRng.Initialize(RiverSeed);
@@ -137,196 +465,1008 @@ void UIslandMapData::GenerateIsland_Implementation()
 	Shape.Amplitudes.SetNum(Shape.Octaves);
 	for (int i = 0; i < Shape.Amplitudes.Num(); i++)
 	{
-		Shape.Amplitudes[i] = FMath::Pow(Persistence, i);
+		Shape.Amplitudes[i] = FMath::Pow(Persistence, i);
+	}
+
+	uint32 meshFingerprint = HashCombine(GetTypeHash(Seed), HashObjectProperties(pointGenerator));
+
+	// Stages in their serial order, each one lists the stages whose outputs it reads
+	TArray<FGenerationStage>& stages = OutStages;
+	stages.Reset();
+	const int32 waterStage = stages.Add({TEXT("Water"), {}, [this]()
+	{
+		// Rng continues after the points, whose number differs between the coarse and the full island
+		FRandomStream shapeRng(HashCombine(GetTypeHash(Seed), GetTypeHash(TEXT("Water"))));
+		Water->assign_r_water(r_water, bProgressiveGeneration ? shapeRng : Rng, Mesh, Shape);
+		Water->assign_r_ocean(r_ocean, Mesh, r_water);
+		UIslandMapUtils::PackRegionFlags(Mesh, r_water, r_ocean, TArray<bool>(), r_flags);
+		LabelLakes();
+		PostWaterRng = Rng;
+	}, &OnIslandWaterGenerationComplete});
+	stages[waterStage].Inputs = HashCombine(HashObjectProperties(Water),
+	                                        HashCombine(GetTypeHash(Shape.Octaves),
+	                                                    HashCombine(GetTypeHash(Shape.IslandFragmentation),
+	                                                                GetTypeHash(Smoothing))));
+	stages[waterStage].Inputs = HashCombine(stages[waterStage].Inputs, GetTypeHash(bProgressiveGeneration));
+	const int32 elevationStage = stages.Add({TEXT("Elevation"), {waterStage}, [this]()
+	{
+		Elevation->assign_t_elevation(t_elevation, t_coastdistance, t_downslope_s, Mesh, r_ocean, r_water, DrainageRng);
+		Elevation->redistribute_t_elevation(t_elevation, Mesh, r_ocean);
+		Elevation->assign_r_elevation(r_elevation, Mesh, t_elevation, r_ocean);
+	}, &OnIslandElevationGenerationComplete});
+	stages[elevationStage].Inputs = HashCombine(HashObjectProperties(Elevation), GetTypeHash(DrainageSeed));
+	const int32 riverStage = stages.Add({TEXT("Rivers"), {elevationStage}, [this]()
+	{
+		river_t.Empty(NumRivers);
+		if (Rivers->bUseFlowAccumulation)
+		{
+			// Every drainage head is a spring, so there is nothing left to choose from
+			Rivers->AccumulateFlow(t_flow, Mesh, r_water, t_downslope_s);
+			spring_t = Rivers->FindDrainageSprings(Mesh, r_water, t_flow, t_downslope_s);
+			river_t = spring_t;
+		}
+		else
+		{
+			t_flow.Reset();
+			spring_t = Rivers->find_spring_t(Mesh, r_water, t_elevation, t_downslope_s);
+			UIslandMapUtils::RandomShuffle(spring_t, RiverRng);
+			river_t.SetNum(NumRivers < spring_t.Num() ? NumRivers : spring_t.Num());
+			for (int i = 0; i < river_t.Num(); i++)
+			{
+				river_t[i] = spring_t[i];
+			}
+		}
+		Rivers->assign_s_flow(s_flow, RiverNetwork, Mesh, t_downslope_s, river_t, RiverRng);
+	}, &OnIslandRiverGenerationComplete});
+	stages[riverStage].Inputs = HashCombine(HashObjectProperties(Rivers),
+	                                        HashCombine(GetTypeHash(NumRivers), GetTypeHash(RiverSeed)));
+	const int32 moistureStage = stages.Add({TEXT("Moisture"), {riverStage}, [this]()
+	{
+		Moisture->assign_r_moisture(r_moisture, r_waterdistance, Mesh, s_flow, r_ocean, r_water);
+		Moisture->redistribute_r_moisture(r_moisture, Mesh, r_water, BiomeBias.Rainfall, 1.0f + BiomeBias.Rainfall);
+	}, &OnIslandMoistureGenerationComplete});
+	stages[moistureStage].Inputs = HashCombine(HashObjectProperties(Moisture), GetTypeHash(BiomeBias.Rainfall));
+	const int32 coastStage = stages.Add({TEXT("Coast"), {waterStage}, [this]()
+	{
+		Biomes->assign_r_coast(r_coast, Mesh, r_ocean);
+		UIslandMapUtils::PackRegionFlags(Mesh, r_water, r_ocean, r_coast, r_flags);
+	}, nullptr});
+	const uint32 biomeInputs = HashObjectProperties(Biomes);
+	stages[coastStage].Inputs = biomeInputs;
+	// AssignTemperature is handed the moisture layer, so it has to wait for it
+	const int32 temperatureStage = stages.Add({TEXT("Temperature"), {elevationStage, moistureStage}, [this]()
+	{
+		Biomes->assign_r_temperature(r_temperature, Mesh, r_ocean, r_water, r_elevation, r_moisture,
+		                             BiomeBias.NorthernTemperature, BiomeBias.SouthernTemperature);
+	}, nullptr});
+	stages[temperatureStage].Inputs = HashCombine(biomeInputs, HashCombine(GetTypeHash(BiomeBias.NorthernTemperature),
+	                                                                       GetTypeHash(BiomeBias.SouthernTemperature)));
+	const int32 biomeStage = stages.Add({TEXT("Biomes"), {coastStage, temperatureStage}, [this]()
+	{
+		Biomes->assign_r_biome(r_biome, BiomePalette, Mesh, r_flags, r_temperature, r_moisture);
+	}, &OnIslandBiomeGenerationComplete});
+	stages[biomeStage].Inputs = biomeInputs;
+	// The water stage is the only other user of Rng, so districts stay deterministic
+	const int32 districtStage = stages.Add({TEXT("Districts"), {waterStage}, [this]()
+	{
+		if (District != nullptr)
+		{
+			District->AssignRegionDistricts(DistrictRegions, r_district, Mesh, r_ocean, Rng);
+		}
+		else
+		{
+			DistrictRegions.Reset();
+			UIslandMapUtils::ResetLayer(r_district, Mesh->NumRegions, INDEX_NONE);
+		}
+	}, nullptr});
+	stages[districtStage].Inputs = HashObjectProperties(District);
+	const int32 coastlineStage = stages.Add({TEXT("Coastlines"), {coastStage}, [this]()
+	{
+		IslandCoastline->Initialize(Mesh, r_flags, CoastlineSimplificationTolerances);
+	}, nullptr});
+	for (const float tolerance : CoastlineSimplificationTolerances)
+	{
+		stages[coastlineStage].Inputs = HashCombine(stages[coastlineStage].Inputs, GetTypeHash(tolerance));
+	}
+
+	// Same order as the stages above
+	const TStatId stageStats[] = {
+		GET_STATID(STAT_IslandWater), GET_STATID(STAT_IslandElevation), GET_STATID(STAT_IslandRivers),
+		GET_STATID(STAT_IslandMoisture), GET_STATID(STAT_IslandCoast), GET_STATID(STAT_IslandTemperature),
+		GET_STATID(STAT_IslandBiomes), GET_STATID(STAT_IslandDistricts), GET_STATID(STAT_IslandCoastlines)
+	};
+	check(stages.Num() == UE_ARRAY_COUNT(stageStats));
+	// The points, every stage and the finishing steps
+	GenerationReport.Stages.Reserve(stages.Num() + 2);
+	FIslandStageTiming& pointsTiming = GenerationReport.AddStage(TEXT("Points"));
+	for (int32 index = 0; index < stages.Num(); index++)
+	{
+		stages[index].StatId = stageStats[index];
+		stages[index].Timing = &GenerationReport.AddStage(stages[index].Name);
+		stages[index].Diagnostics = &Diagnostics;
+	}
+
+	uint32 stageInputs = 0;
+	for (const FGenerationStage& stage : stages)
+	{
+		stageInputs = HashCombine(stageInputs, stage.Inputs);
+	}
+	stageInputs = HashCombine(stageInputs, GetTypeHash(bBuildMeshAdjacency));
+	stageInputs = HashCombine(stageInputs, GetTypeHash(bCompactMeshPositions));
+	const uint64 cacheKey = (static_cast<uint64>(meshFingerprint) << 32) | stageInputs;
+	OutCacheKey = cacheKey;
+	LastCacheKey = cacheKey;
+#if WITH_EDITOR
+	// Edited Blueprint stages regenerate their outputs, but keep matching the cache files and bakes
+	meshFingerprint = HashCombine(meshFingerprint, HashBlueprintGraphs(pointGenerator));
+	const UObject* stageObjects[] = {Water, Elevation, Rivers, Moisture, Biomes, Biomes, Biomes, District, nullptr};
+	check(stages.Num() == UE_ARRAY_COUNT(stageObjects));
+	for (int32 index = 0; index < stages.Num(); index++)
+	{
+		stages[index].Inputs = HashCombine(stages[index].Inputs, HashBlueprintGraphs(stageObjects[index]));
+	}
+#endif
+	const bool bLoadedFromBake = BakedIsland != nullptr && LoadBakedIsland(cacheKey);
+	if (bLoadedFromBake || (bUseDiskCache && LoadCachedIsland(cacheKey)))
+	{
+		MeshFingerprint = meshFingerprint;
+		StageFingerprints.Reset();
+		UpdateStageFingerprints(stages);
+		GenerationReport.bLoadedFromCache = true;
+		GenerationReport.bLoadedFromBake = bLoadedFromBake;
+		for (FIslandStageTiming& timing : GenerationReport.Stages)
+		{
+			timing.bSkipped = true;
+		}
+		OnIslandPointGenerationComplete.Broadcast();
+		for (const FGenerationStage& stage : stages)
+		{
+			if (stage.OnComplete != nullptr)
+			{
+				stage.OnComplete->Broadcast();
+			}
+		}
+		FinishGeneration();
+		return EGenerationStart::Cached;
+	}
+
+	// Generate map points
+	const bool bReuseMesh = bIncrementalRegeneration && Mesh != nullptr && meshFingerprint == MeshFingerprint
+		&& Mesh->HasAdjacency() == bBuildMeshAdjacency && Mesh->HasCompactPositions() == bCompactMeshPositions;
+	pointsTiming.bSkipped = bReuseMesh;
+	if (bReuseMesh)
+	{
+		Rng = PostMeshRng;
+	}
+	else
+	{
+		FIslandStageScope pointsScope(&pointsTiming, GET_STATID(STAT_IslandPoints));
+		FGenerationDiagnosticsScope diagnosticsScope(&Diagnostics);
+		if (ScratchMeshBuilder != nullptr && Mesh != nullptr)
+		{
+			// Batch workers rebuild their own objects, so no UObject is created off the game thread
+			if (!pointGenerator->GenerateDualMeshInto(ScratchMeshBuilder, Mesh, Rng))
+			{
+				return EGenerationStart::Invalid;
+			}
+			bMeshIsShared = false;
+		}
+		else if (bShareMeshes)
+		{
+			AcquireSharedMesh(pointGenerator, meshFingerprint);
+		}
+		else
+		{
+			Mesh = pointGenerator->GenerateDualMesh(Rng);
+			bMeshIsShared = false;
+		}
+		if (Mesh != nullptr && bBuildMeshAdjacency && !bMeshIsShared)
+		{
+			Mesh->BuildAdjacency();
+		}
+		if (Mesh != nullptr && bCompactMeshPositions && !bMeshIsShared)
+		{
+			Mesh->CompactPositions();
+		}
+		MeshFingerprint = meshFingerprint;
+		PostMeshRng = Rng;
+		StageFingerprints.Reset();
+		ResetLayers();
+	}
+	// Another map data may be generating on a shared mesh, its lookups keep logging directly
+	if (Mesh != nullptr && !bMeshIsShared)
+	{
+		Mesh->SetDiagnostics(&Diagnostics);
+	}
+	OnIslandPointGenerationComplete.Broadcast();
+
+	UpdateStageFingerprints(stages);
+	if (stages[waterStage].bSkip)
+	{
+		Rng = PostWaterRng;
+	}
+	if (!stages[coastlineStage].bSkip || IslandCoastline == nullptr)
+	{
+		stages[coastlineStage].bSkip = false;
+		if (ScratchMeshBuilder == nullptr || IslandCoastline == nullptr)
+		{
+			IslandCoastline = NewObject<UIslandCoastline>();
+		}
+	}
+
+	ExpandRegionFlags();
+	bOutConcurrent = bRunStagesConcurrently && Water->GetClass()->IsNative() && Elevation->GetClass()->IsNative()
+		&& Rivers->GetClass()->IsNative() && Moisture->GetClass()->IsNative() && Biomes->GetClass()->IsNative()
+		&& (District == nullptr || District->GetClass()->IsNative());
+	return EGenerationStart::RunStages;
+}
+
+void UIslandMapData::AcquireSharedMesh(const UIslandMeshBuilder* PointGenerator, uint32 Fingerprint)
+{
+	const uint64 key = (static_cast<uint64>(Fingerprint) << 32)
+		| HashCombine(GetTypeHash(bBuildMeshAdjacency), GetTypeHash(bCompactMeshPositions));
+	FScopeLock lock(&SharedMeshLock);
+	if (const FSharedMesh* shared = SharedMeshes.Find(key))
+	{
+		if (UTriangleDualMesh* sharedMesh = shared->Mesh.Get())
+		{
+			Mesh = sharedMesh;
+			Rng = shared->PostMeshRng;
+			bMeshIsShared = true;
+			return;
+		}
+	}
+
+	Mesh = PointGenerator->GenerateDualMesh(Rng);
+	bMeshIsShared = Mesh != nullptr;
+	if (Mesh == nullptr)
+	{
+		return;
+	}
+	if (bBuildMeshAdjacency)
+	{
+		Mesh->BuildAdjacency();
+	}
+	if (bCompactMeshPositions)
+	{
+		Mesh->CompactPositions();
+	}
+	for (auto it = SharedMeshes.CreateIterator(); it; ++it)
+	{
+		if (!it->Value.Mesh.IsValid())
+		{
+			it.RemoveCurrent();
+		}
+	}
+	SharedMeshes.Add(key, {Mesh, Rng});
+}
+
+void UIslandMapData::EndGeneration(uint64 CacheKey)
+{
+	if (bUseDiskCache)
+	{
+		SaveCachedIsland(CacheKey);
+	}
+	FinishGeneration();
+}
+
+void UIslandMapData::FinishGeneration()
+{
+	{
+		FIslandStageScope finishScope(&GenerationReport.AddStage(TEXT("Finish")), GET_STATID(STAT_IslandFinish));
+		// Everything after the stages reads r_flags
+		r_water.Empty();
+		r_ocean.Empty();
+		r_coast.Empty();
+		VoronoiView.Reset();
+		VoronoiPolygons.Reset();
+		RiverObjects.Reset();
+		CoastDistanceField.Reset();
+		if (bBakeCoastDistanceField)
+		{
+			BakeCoastDistanceField();
+		}
+		{
+			FScopeLock lock(&MapQueryLock);
+			MapQuery.Reset();
+		}
+		if (bBuildMapQuery)
+		{
+			GetMapQuery();
+		}
+		{
+			FScopeLock lock(&NavigationGraphLock);
+			NavigationGraph.Reset();
+		}
+		if (bQuantizeLayers)
+		{
+			QuantizeLayers();
+		}
+		bIsCoarseIsland = bGeneratingCoarseIsland;
+		PublishSnapshot();
+	}
+	// Lookups after the generation log their problems again
+	if (Mesh != nullptr && !bMeshIsShared)
+	{
+		Mesh->SetDiagnostics(nullptr);
+	}
+	GenerationReport.SetDiagnostics(Diagnostics);
+	GenerationReport.NumRegions = Mesh != nullptr ? Mesh->NumSolidRegions : 0;
+	GenerationReport.LayersAllocatedSize = GetLayersAllocatedSize();
+	GenerationReport.MeshAllocatedSize = Mesh != nullptr ? Mesh->GetAllocatedSize() : 0;
+	GenerationReport.TotalSeconds = FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - GenerationStartCycles);
+	SET_MEMORY_STAT(STAT_IslandLayersMemory, GenerationReport.LayersAllocatedSize);
+	SET_MEMORY_STAT(STAT_IslandMeshMemory, GenerationReport.MeshAllocatedSize);
+	GenerationReport.Log();
+	if (bGeneratingCoarseIsland)
+	{
+		OnIslandCoarseGenerationComplete.Broadcast();
+		return;
+	}
+	// Do whatever we need to do when the island generation is done
+	OnIslandGenerationComplete.Broadcast();
+}
+
+void UIslandMapData::PublishSnapshot()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UIslandMapData::PublishSnapshot)
+	if (!bPublishSnapshots || Mesh == nullptr)
+	{
+		FScopeLock lock(&SnapshotLock);
+		Snapshot = MakeShared<FIslandMapSnapshot>();
+		return;
+	}
+	// Built completely before the swap, readers only ever see finished snapshots
+	const TSharedRef<FIslandMapSnapshot> snapshot = MakeShared<FIslandMapSnapshot>();
+	snapshot->Mesh.Reset(Mesh);
+	snapshot->Coastline.Reset(IslandCoastline);
+	snapshot->r_flags = r_flags;
+	snapshot->r_lake = r_lake;
+	snapshot->NumLakes = NumLakes;
+	snapshot->r_elevation = r_elevation;
+	snapshot->r_waterdistance = r_waterdistance;
+	snapshot->r_moisture = r_moisture;
+	snapshot->r_temperature = r_temperature;
+	snapshot->r_biome = r_biome;
+	snapshot->BiomePalette = BiomePalette;
+	snapshot->r_district = r_district;
+	snapshot->DistrictRegions = DistrictRegions;
+	snapshot->t_coastdistance = t_coastdistance;
+	snapshot->t_elevation = t_elevation;
+	snapshot->QuantizedLayers = QuantizedLayers;
+	snapshot->t_downslope_s = t_downslope_s;
+	snapshot->t_flow = t_flow;
+	snapshot->s_flow = s_flow;
+	snapshot->spring_t = spring_t;
+	snapshot->river_t = river_t;
+	snapshot->RiverNetwork = RiverNetwork;
+	snapshot->CoastDistanceField = CoastDistanceField;
+	if (bBuildMapQuery)
+	{
+		snapshot->MapQuery = GetMapQuery();
+	}
+	snapshot->GenerationFingerprint = GetGenerationFingerprint();
+
+	FScopeLock lock(&SnapshotLock);
+	Snapshot = snapshot;
+}
+
+TSharedRef<const FIslandMapSnapshot> UIslandMapData::GetSnapshot() const
+{
+	FScopeLock lock(&SnapshotLock);
+	return Snapshot;
+}
+
+FString UIslandMapData::GetCachedIslandPath(uint64 CacheKey) const
+{
+	const FString directory = CacheDirectory.IsEmpty()
+		                          ? FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("IslandCache"))
+		                          : CacheDirectory;
+	return FPaths::Combine(directory, FString::Printf(TEXT("Island_%016llx.bin"), CacheKey));
+}
+
+bool UIslandMapData::LoadCachedIsland(uint64 CacheKey)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UIslandMapData::LoadCachedIsland)
+	const FString path = GetCachedIslandPath(CacheKey);
+	TArray<uint8> bytes;
+	if (!IFileManager::Get().FileExists(*path) || !FFileHelper::LoadFileToArray(bytes, *path))
+	{
+		return false;
+	}
+	return LoadIslandFromBytes(bytes, CacheKey, path);
+}
+
+bool UIslandMapData::LoadBakedIsland(uint64 CacheKey)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UIslandMapData::LoadBakedIsland)
+	if (!BakedIsland->HasIsland() || BakedIsland->CacheKey != CacheKey || BakedIsland->CacheVersion != CacheVersion)
+	{
+		UE_LOG(LogMapGen, Warning, TEXT("%s was baked with other seeds or settings, generating the island instead."),
+		       *BakedIsland->GetPathName());
+		return false;
+	}
+	// Copied out and released right away, the bulk data reloads from the package if it is ever needed again
+	void* data = nullptr;
+	const int64 size = BakedIsland->IslandData.GetBulkDataSize();
+	BakedIsland->IslandData.GetCopy(&data, true);
+	if (data == nullptr)
+	{
+		return false;
+	}
+	const bool bLoaded = LoadIslandFromBytes(TArrayView<const uint8>(static_cast<const uint8*>(data), size), CacheKey,
+	                                         BakedIsland->GetPathName());
+	FMemory::Free(data);
+	return bLoaded;
+}
+
+bool UIslandMapData::LoadIslandFromBytes(TArrayView<const uint8> Bytes, uint64 CacheKey, const FString& Source)
+{
+	FMemoryReaderView reader(Bytes, true);
+	FObjectAndNameAsStringProxyArchive ar(reader, true);
+	uint32 magic = 0;
+	int32 version = 0;
+	uint64 key = 0;
+	ar << magic << version << key;
+	if (ar.IsError() || magic != CacheMagic || version != CacheVersion || key != CacheKey)
+	{
+		UE_LOG(LogMapGen, Warning, TEXT("Ignoring outdated island cache %s."), *Source);
+		return false;
+	}
+	Mesh = NewObject<UTriangleDualMesh>();
+	bMeshIsShared = false;
+	IslandCoastline = NewObject<UIslandCoastline>();
+	SerializeIsland(ar);
+	if (ar.IsError())
+	{
+		UE_LOG(LogMapGen, Error, TEXT("Island cache %s is corrupt, generating the island instead."), *Source);
+		Mesh = nullptr;
+		IslandCoastline = nullptr;
+		InvalidateGenerationCache();
+		return false;
+	}
+	UE_LOG(LogMapGen, Log, TEXT("Loaded island from %s."), *Source);
+	return true;
+}
+
+void UIslandMapData::SaveCachedIsland(uint64 CacheKey)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UIslandMapData::SaveCachedIsland)
+	TArray<uint8> bytes;
+	SaveIslandToBytes(bytes);
+	const FString path = GetCachedIslandPath(CacheKey);
+	if (!FFileHelper::SaveArrayToFile(bytes, *path))
+	{
+		UE_LOG(LogMapGen, Warning, TEXT("Could not write island cache %s."), *path);
+	}
+}
+
+bool UIslandMapData::SaveIslandToBytes(TArray<uint8>& OutBytes)
+{
+	OutBytes.Reset();
+	if (Mesh == nullptr || IslandCoastline == nullptr || LastCacheKey == 0)
+	{
+		return false;
+	}
+	FMemoryWriter writer(OutBytes, true);
+	FObjectAndNameAsStringProxyArchive ar(writer, false);
+	uint32 magic = CacheMagic;
+	int32 version = CacheVersion;
+	uint64 key = LastCacheKey;
+	ar << magic << version << key;
+	SerializeIsland(ar);
+	return !ar.IsError();
+}
+
+uint64 UIslandMapData::GetCacheKey() const
+{
+	return LastCacheKey;
+}
+
+int32 UIslandMapData::GetCacheVersion()
+{
+	return CacheVersion;
+}
+
+void UIslandMapData::SerializeIsland(FArchive& Ar)
+{
+	using namespace DualMeshArchive;
+	// The cache format holds the full precision layers
+	const bool bWasQuantized = ExpandQuantizedLayers();
+	Mesh->SerializeMeshData(Ar);
+
+	SerializeArray(Ar, r_flags);
+	SerializeArray(Ar, r_lake);
+	Ar << NumLakes;
+	SerializeArray(Ar, r_elevation);
+	SerializeArray(Ar, r_waterdistance);
+	SerializeArray(Ar, r_moisture);
+	SerializeArray(Ar, r_temperature);
+	SerializeArray(Ar, r_biome);
+	SerializeArray(Ar, r_district);
+	SerializeArray(Ar, t_coastdistance);
+	SerializeArray(Ar, t_elevation);
+	SerializeArray(Ar, t_downslope_s);
+	SerializeArray(Ar, s_flow);
+	SerializeArray(Ar, t_flow);
+	SerializeArray(Ar, spring_t);
+	SerializeArray(Ar, river_t);
+
+	// Biomes reference materials and tags, so they go through the property system
+	int32 paletteNum = BiomePalette.Num();
+	Ar << paletteNum;
+	if (Ar.IsLoading())
+	{
+		BiomePalette.Reset();
+		BiomePalette.SetNum(FMath::Clamp(paletteNum, 0, TNumericLimits<uint8>::Max() + 1));
+	}
+	for (FBiomeData& biome : BiomePalette)
+	{
+		FBiomeData::StaticStruct()->SerializeItem(Ar, &biome, nullptr);
+	}
+	TBaseStructure<FRandomStream>::Get()->SerializeItem(Ar, &PostMeshRng, nullptr);
+	TBaseStructure<FRandomStream>::Get()->SerializeItem(Ar, &PostWaterRng, nullptr);
+
+	SerializeArray(Ar, RiverNetwork.Triangles);
+	SerializeArray(Ar, RiverNetwork.Downslopes);
+	SerializeArray(Ar, RiverNetwork.SegmentOffsets);
+	SerializeArray(Ar, RiverNetwork.FeedsInto);
+	if (Ar.IsLoading() && ((RiverNetwork.Num() > 0 && RiverNetwork.SegmentOffsets.Num() != RiverNetwork.Num() + 1)
+		|| RiverNetwork.Triangles.Num() != RiverNetwork.Downslopes.Num()))
+	{
+		Ar.SetError();
+	}
+
+	int32 districtNum = DistrictRegions.Num();
+	Ar << districtNum;
+	if (Ar.IsLoading())
+	{
+		DistrictRegions.Reset();
+		DistrictRegions.SetNum(FMath::Max(districtNum, 0));
+	}
+	for (FDistrictRegion& region : DistrictRegions)
+	{
+		Ar << region.District;
+		SerializeArray(Ar, region.Indices);
+		SerializeArray(Ar, region.Positions);
+		SerializeArray(Ar, region.Triangles);
+	}
+
+	IslandCoastline->SerializeCoastlines(Ar);
+	if (bWasQuantized && Ar.IsSaving())
+	{
+		QuantizeLayers();
+	}
+}
+
+FVector2D UIslandMapData::GetMapSize() const
+{
+	if (Mesh == nullptr)
+		return FVector2D::ZeroVector;
+	return Mesh->GetSize();
+}
+
+void UIslandMapData::RunGenerationStages(const TArray<FGenerationStage>& Stages, bool bConcurrent)
+{
+	if (!bConcurrent)
+	{
+		for (const FGenerationStage& stage : Stages)
+		{
+			RunGenerationStage(stage);
+			if (stage.OnComplete != nullptr)
+			{
+				stage.OnComplete->Broadcast();
+			}
+		}
+		return;
+	}
+
+	FGraphEventArray events;
+	events.Reserve(Stages.Num());
+	for (const FGenerationStage& stage : Stages)
+	{
+		FGraphEventArray prerequisites;
+		for (int32 prerequisite : stage.Prerequisites)
+		{
+			checkf(prerequisite < events.Num(), TEXT("Stage %s depends on a later stage"), stage.Name);
+			prerequisites.Add(events[prerequisite]);
+		}
+		events.Add(FFunctionGraphTask::CreateAndDispatchWhenReady([&stage]()
+		{
+			RunGenerationStage(stage);
+		}, TStatId(), &prerequisites));
+	}
+	// Listeners read the layers, so completion events only fire once no stage writes any more, on this thread and
+	// in stage order
+	FTaskGraphInterface::Get().WaitUntilTasksComplete(events);
+	for (const FGenerationStage& stage : Stages)
+	{
+		if (stage.OnComplete != nullptr)
+		{
+			stage.OnComplete->Broadcast();
+		}
+	}
+}
+
+void UIslandMapData::RunGenerationStage(const FGenerationStage& Stage)
+{
+	if (Stage.Timing != nullptr)
+	{
+		Stage.Timing->bSkipped = Stage.bSkip;
+	}
+	if (!Stage.bSkip)
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE_TEXT(Stage.Name)
+		FIslandStageScope stageScope(Stage.Timing, Stage.StatId);
+		FGenerationDiagnosticsScope diagnosticsScope(Stage.Diagnostics);
+		Stage.Run();
+	}
+}
+
+void UIslandMapData::UpdateStageFingerprints(TArray<FGenerationStage>& Stages)
+{
+	const bool bHasPrevious = bIncrementalRegeneration && StageFingerprints.Num() == Stages.Num();
+	StageFingerprints.SetNum(Stages.Num());
+	int32 skipped = 0;
+	for (int32 index = 0; index < Stages.Num(); index++)
+	{
+		FGenerationStage& stage = Stages[index];
+		// Upstream fingerprints stand in for the layers they produced
+		uint32 fingerprint = HashCombine(stage.Inputs, MeshFingerprint);
+		for (int32 prerequisite : stage.Prerequisites)
+		{
+			fingerprint = HashCombine(fingerprint, StageFingerprints[prerequisite]);
+		}
+		stage.bSkip = bHasPrevious && StageFingerprints[index] == fingerprint;
+		StageFingerprints[index] = fingerprint;
+		skipped += stage.bSkip ? 1 : 0;
+	}
+	if (skipped > 0)
+	{
+		UE_LOG(LogMapGen, Log, TEXT("Reusing %d of %d generation stages."), skipped, Stages.Num());
+	}
+}
+
+void UIslandMapData::InvalidateGenerationCache()
+{
+	MeshFingerprint = 0;
+	StageFingerprints.Reset();
+}
+
+void UIslandMapData::ResetLayers()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UIslandMapData::ResetLayers)
+	const int32 numRegions = Mesh->NumRegions;
+	const int32 numTriangles = Mesh->NumTriangles;
+	UIslandMapUtils::ResetLayer(r_flags, numRegions);
+	UIslandMapUtils::ResetLayer(r_lake, numRegions, INDEX_NONE);
+	NumLakes = 0;
+	UIslandMapUtils::ResetLayer(r_elevation, numRegions);
+	UIslandMapUtils::ResetLayer(r_waterdistance, numRegions);
+	UIslandMapUtils::ResetLayer(r_moisture, numRegions);
+	UIslandMapUtils::ResetLayer(r_temperature, numRegions);
+	UIslandMapUtils::ResetLayer(r_biome, numRegions);
+	UIslandMapUtils::ResetLayer(r_district, numRegions, INDEX_NONE);
+	BiomePalette.Reset();
+
+	UIslandMapUtils::ResetLayer(t_coastdistance, numTriangles);
+	UIslandMapUtils::ResetLayer(t_elevation, numTriangles);
+	UIslandMapUtils::ResetLayer(t_downslope_s, numTriangles, FSideIndex());
+
+	UIslandMapUtils::ResetLayer(s_flow, Mesh->NumSides);
+	UE_LOG(LogMapGen, Verbose, TEXT("Map layers use %llu bytes."), (uint64)GetLayersAllocatedSize());
+}
+
+void UIslandMapData::ExpandRegionFlags()
+{
+	UIslandMapUtils::UnpackRegionFlags(r_flags, ERegionFlags::Water, r_water);
+	UIslandMapUtils::UnpackRegionFlags(r_flags, ERegionFlags::Ocean, r_ocean);
+	UIslandMapUtils::UnpackRegionFlags(r_flags, ERegionFlags::Coast, r_coast);
+}
+
+void UIslandMapData::LabelLakes()
+{
+	NumLakes = UIslandMapUtils::LabelConnectedRegions(Mesh, [this](FPointIndex r) { return EnumHasAnyFlags(r_flags[r], ERegionFlags::Lake); }, r_lake);
+}
+
+void UIslandMapData::RebuildRegionFlagLayers()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UIslandMapData::RebuildRegionFlagLayers)
+	LabelLakes();
+	if (Elevation != nullptr)
+	{
+		// Only the coast distances are kept, the elevations and drainage of the generation stay as they are
+		UIslandMapUtils::UnpackRegionFlags(r_flags, ERegionFlags::Water, r_water);
+		UIslandMapUtils::UnpackRegionFlags(r_flags, ERegionFlags::Ocean, r_ocean);
+		TArray<float> elevationScratch;
+		TArray<FSideIndex> downslopeScratch;
+		FRandomStream drainageRng = DrainageRng;
+		Elevation->assign_t_elevation(elevationScratch, t_coastdistance, downslopeScratch, Mesh, r_ocean, r_water, drainageRng);
+		r_water.Empty();
+		r_ocean.Empty();
+	}
+	if (IslandCoastline != nullptr)
+	{
+		IslandCoastline->Initialize(Mesh, r_flags, CoastlineSimplificationTolerances);
+	}
+	CoastDistanceField.Reset();
+	if (bBakeCoastDistanceField)
+	{
+		BakeCoastDistanceField();
+	}
+}
+
+void UIslandMapData::QuantizeLayers()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UIslandMapData::QuantizeLayers)
+	QuantizedLayers.r_elevation.Encode(r_elevation);
+	QuantizedLayers.r_waterdistance.Encode(r_waterdistance);
+	QuantizedLayers.r_moisture.Encode(r_moisture);
+	QuantizedLayers.r_temperature.Encode(r_temperature);
+	QuantizedLayers.t_coastdistance.Encode(t_coastdistance);
+	QuantizedLayers.t_elevation.Encode(t_elevation);
+	{
+		FScopeLock lock(&DecodedLayersLock);
+		DecodedLayers.Reset();
+	}
+	r_elevation.Empty();
+	r_waterdistance.Empty();
+	r_moisture.Empty();
+	r_temperature.Empty();
+	t_coastdistance.Empty();
+	t_elevation.Empty();
+}
+
+bool UIslandMapData::ExpandQuantizedLayers()
+{
+	if (QuantizedLayers.IsEmpty())
+	{
+		return false;
 	}
+	TRACE_CPUPROFILER_EVENT_SCOPE(UIslandMapData::ExpandQuantizedLayers)
+	QuantizedLayers.r_elevation.Decode(r_elevation);
+	QuantizedLayers.r_waterdistance.Decode(r_waterdistance);
+	QuantizedLayers.r_moisture.Decode(r_moisture);
+	QuantizedLayers.r_temperature.Decode(r_temperature);
+	QuantizedLayers.t_coastdistance.Decode(t_coastdistance);
+	QuantizedLayers.t_elevation.Decode(t_elevation);
+	QuantizedLayers.Reset();
+	{
+		FScopeLock lock(&DecodedLayersLock);
+		DecodedLayers.Reset();
+	}
+	return true;
+}
 
-	// Generate map points
-	Mesh = PointGenerator->GenerateDualMesh(Rng);
-	OnIslandPointGenerationComplete.Broadcast();
+SIZE_T UIslandMapData::GetLayersAllocatedSize() const
+{
+	return r_flags.GetAllocatedSize() + r_lake.GetAllocatedSize() + r_elevation.GetAllocatedSize() + r_waterdistance.GetAllocatedSize()
+		+ r_moisture.GetAllocatedSize() + r_temperature.GetAllocatedSize() + r_biome.GetAllocatedSize()
+		+ r_district.GetAllocatedSize() + BiomePalette.GetAllocatedSize() + t_coastdistance.GetAllocatedSize() + t_elevation.GetAllocatedSize()
+		+ t_downslope_s.GetAllocatedSize() + s_flow.GetAllocatedSize() + t_flow.GetAllocatedSize()
+		+ RiverNetwork.GetAllocatedSize() + QuantizedLayers.GetAllocatedSize() + DecodedLayers.GetAllocatedSize();
+}
 
-	// Reset all arrays
-	CreatedRivers.Empty(NumRivers);
-	spring_t.Empty();
-	river_t.Empty(NumRivers);
-
-	r_water.Empty(Mesh->NumRegions);
-	r_water.SetNumZeroed(Mesh->NumRegions);
-	r_ocean.Empty(Mesh->NumRegions);
-	r_ocean.SetNumZeroed(Mesh->NumRegions);
-
-	t_elevation.Empty(Mesh->NumTriangles);
-	t_elevation.SetNumZeroed(Mesh->NumTriangles);
-	t_downslope_s.Empty(Mesh->NumTriangles);
-	t_downslope_s.SetNum(Mesh->NumTriangles);
-	t_coastdistance.Empty(Mesh->NumTriangles);
-	t_coastdistance.SetNumZeroed(Mesh->NumTriangles);
-	r_elevation.Empty(Mesh->NumRegions);
-	r_elevation.SetNumZeroed(Mesh->NumRegions);
-
-	s_flow.Empty(Mesh->NumSides);
-	s_flow.SetNumZeroed(Mesh->NumSides);
-
-	r_moisture.Empty(Mesh->NumRegions);
-	r_moisture.SetNumZeroed(Mesh->NumRegions);
-	r_waterdistance.Empty(Mesh->NumRegions);
-	r_waterdistance.SetNumZeroed(Mesh->NumRegions);
-
-	r_coast.Empty(Mesh->NumRegions);
-	r_coast.SetNumZeroed(Mesh->NumRegions);
-	r_temperature.Empty(Mesh->NumRegions);
-	r_temperature.SetNumZeroed(Mesh->NumRegions);
-	r_biome.Empty(Mesh->NumRegions);
-	r_biome.SetNumZeroed(Mesh->NumRegions);
-
-	// Water
-	{
-		TRACE_CPUPROFILER_EVENT_SCOPE(Water)
-		Water->assign_r_water(r_water, Rng, Mesh, Shape);
-		Water->assign_r_ocean(r_ocean, Mesh, r_water);
-		OnIslandWaterGenerationComplete.Broadcast();
+FIslandMemoryFootprint UIslandMapData::GetMemoryFootprint() const
+{
+	FIslandMemoryFootprint footprint;
+	if (Mesh != nullptr)
+	{
+		footprint.Add(TEXT("MeshPoints"), Mesh->GetPointsAllocatedSize());
+		footprint.Add(TEXT("MeshHalfEdges"), Mesh->GetTopologyAllocatedSize());
+		footprint.Add(TEXT("MeshAdjacency"), Mesh->GetAdjacencyAllocatedSize());
+		footprint.Add(TEXT("MeshRegionGrid"), Mesh->GetRegionGridAllocatedSize());
 	}
-
-	// Elevation
+	footprint.Add(TEXT("r_flags"), r_flags.GetAllocatedSize());
+	footprint.Add(TEXT("r_lake"), r_lake.GetAllocatedSize());
+	footprint.Add(TEXT("r_elevation"), r_elevation.GetAllocatedSize() + QuantizedLayers.r_elevation.GetAllocatedSize()
+	              + DecodedLayers.r_elevation.GetAllocatedSize());
+	footprint.Add(TEXT("r_waterdistance"), r_waterdistance.GetAllocatedSize() + QuantizedLayers.r_waterdistance.GetAllocatedSize()
+	              + DecodedLayers.r_waterdistance.GetAllocatedSize());
+	footprint.Add(TEXT("r_moisture"), r_moisture.GetAllocatedSize() + QuantizedLayers.r_moisture.GetAllocatedSize()
+	              + DecodedLayers.r_moisture.GetAllocatedSize());
+	footprint.Add(TEXT("r_temperature"), r_temperature.GetAllocatedSize() + QuantizedLayers.r_temperature.GetAllocatedSize()
+	              + DecodedLayers.r_temperature.GetAllocatedSize());
+	footprint.Add(TEXT("r_biome"), r_biome.GetAllocatedSize() + BiomePalette.GetAllocatedSize());
+	footprint.Add(TEXT("t_coastdistance"), t_coastdistance.GetAllocatedSize() + QuantizedLayers.t_coastdistance.GetAllocatedSize()
+	              + DecodedLayers.t_coastdistance.GetAllocatedSize());
+	footprint.Add(TEXT("t_elevation"), t_elevation.GetAllocatedSize() + QuantizedLayers.t_elevation.GetAllocatedSize()
+	              + DecodedLayers.t_elevation.GetAllocatedSize());
+	footprint.Add(TEXT("t_downslope_s"), t_downslope_s.GetAllocatedSize());
+	footprint.Add(TEXT("t_flow"), t_flow.GetAllocatedSize());
+	footprint.Add(TEXT("s_flow"), s_flow.GetAllocatedSize());
+	footprint.Add(TEXT("Rivers"), RiverNetwork.GetAllocatedSize() + spring_t.GetAllocatedSize()
+	              + river_t.GetAllocatedSize() + RiverObjects.Num() * sizeof(URiver));
+	footprint.Add(TEXT("Coastlines"), IslandCoastline != nullptr ? IslandCoastline->GetAllocatedSize() : 0);
+	SIZE_T districtSize = r_district.GetAllocatedSize() + DistrictRegions.GetAllocatedSize();
+	for (const FDistrictRegion& districtRegion : DistrictRegions)
 	{
-		TRACE_CPUPROFILER_EVENT_SCOPE(Elevation)
-		Elevation->assign_t_elevation(t_elevation, t_coastdistance, t_downslope_s, Mesh, r_ocean, r_water, DrainageRng);
-		Elevation->redistribute_t_elevation(t_elevation, Mesh, r_ocean);
-		Elevation->assign_r_elevation(r_elevation, Mesh, t_elevation, r_ocean);
-		OnIslandElevationGenerationComplete.Broadcast();
+		districtSize += districtRegion.FAreaContour::GetAllocatedSize() + districtRegion.Triangles.GetAllocatedSize();
 	}
-
-	// Rivers
+	footprint.Add(TEXT("Districts"), districtSize);
+	SIZE_T voronoiSize = VoronoiPolygons.GetAllocatedSize();
+	for (const FIslandPolygon& polygon : VoronoiPolygons)
 	{
-		TRACE_CPUPROFILER_EVENT_SCOPE(Rivers)
-		spring_t = Rivers->find_spring_t(Mesh, r_water, t_elevation, t_downslope_s);
-		UIslandMapUtils::RandomShuffle(spring_t, RiverRng);
-		river_t.SetNum(NumRivers < spring_t.Num() ? NumRivers : spring_t.Num());
-		for (int i = 0; i < river_t.Num(); i++)
-		{
-			river_t[i] = spring_t[i];
-		}
-		Rivers->assign_s_flow(s_flow, CreatedRivers, Mesh, t_downslope_s, river_t, RiverRng);
-		OnIslandRiverGenerationComplete.Broadcast();
+		voronoiSize += polygon.VertexPoints.GetAllocatedSize() + polygon.Vertices.GetAllocatedSize();
 	}
-
-	// Moisture
+	footprint.Add(TEXT("VoronoiPolygons"), voronoiSize + VoronoiView.GetAllocatedSize());
+	// The only texture the map data owns, the district and overview textures belong to their assets
+	footprint.Add(TEXT("CoastDistanceField"), CoastDistanceField.GetAllocatedSize());
 	{
-		TRACE_CPUPROFILER_EVENT_SCOPE(Moisture)
-		Moisture->assign_r_moisture(r_moisture, r_waterdistance, Mesh, r_water,
-		                            Moisture->find_moisture_seeds_r(Mesh, s_flow, r_ocean, r_water));
-		Moisture->redistribute_r_moisture(r_moisture, Mesh, r_water, BiomeBias.Rainfall, 1.0f + BiomeBias.Rainfall);
-		OnIslandMoistureGenerationComplete.Broadcast();
+		FScopeLock lock(&MapQueryLock);
+		footprint.Add(TEXT("MapQuery"), MapQuery.IsValid() ? MapQuery->GetAllocatedSize() : 0);
 	}
-
-	// Biomes
 	{
-		TRACE_CPUPROFILER_EVENT_SCOPE(Biomes)
-		Biomes->assign_r_coast(r_coast, Mesh, r_ocean);
-		Biomes->assign_r_temperature(r_temperature, Mesh, r_ocean, r_water, r_elevation, r_moisture,
-		                             BiomeBias.NorthernTemperature, BiomeBias.SouthernTemperature);
-		Biomes->assign_r_biome(r_biome, Mesh, r_ocean, r_water, r_coast, r_temperature, r_moisture);
-		OnIslandBiomeGenerationComplete.Broadcast();
+		FScopeLock lock(&NavigationGraphLock);
+		footprint.Add(TEXT("NavigationGraph"), NavigationGraph.IsValid() ? NavigationGraph->GetAllocatedSize() : 0);
 	}
+	footprint.Add(TEXT("Snapshot"), GetSnapshot()->GetAllocatedSize());
+	return footprint;
+}
+
+FIslandMemoryFootprint UIslandMapData::EstimateMemoryFootprint(int32 NumRegions) const
+{
+	// Same proportions as UTriangleDualMesh::EstimateAllocatedSize
+	const SIZE_T numRegions = FMath::Max(NumRegions, 0);
+	const SIZE_T numTriangles = numRegions * 2;
+	const SIZE_T numSides = numTriangles * 3;
+	// The bool layers only exist while the stages run, but they count towards the peak
+	const SIZE_T regionBytes = sizeof(decltype(r_water)::ElementType) + sizeof(decltype(r_ocean)::ElementType)
+		+ sizeof(decltype(r_coast)::ElementType) + sizeof(decltype(r_flags)::ElementType)
+		+ sizeof(decltype(r_lake)::ElementType) + sizeof(decltype(r_elevation)::ElementType)
+		+ sizeof(decltype(r_waterdistance)::ElementType) + sizeof(decltype(r_moisture)::ElementType)
+		+ sizeof(decltype(r_temperature)::ElementType) + sizeof(decltype(r_biome)::ElementType)
+		+ sizeof(decltype(r_district)::ElementType);
+	const SIZE_T triangleBytes = sizeof(decltype(t_coastdistance)::ElementType)
+		+ sizeof(decltype(t_elevation)::ElementType) + sizeof(decltype(t_downslope_s)::ElementType)
+		+ sizeof(decltype(t_flow)::ElementType);
+	const SIZE_T sideBytes = sizeof(decltype(s_flow)::ElementType);
+
+	FIslandMemoryFootprint footprint;
+	footprint.Add(TEXT("Mesh"), UTriangleDualMesh::EstimateAllocatedSize(NumRegions, bBuildMeshAdjacency,
+	                                                                         bCompactMeshPositions));
+	const SIZE_T layerBytes = numRegions * regionBytes + numTriangles * triangleBytes + numSides * sideBytes;
+	footprint.Add(TEXT("Layers"), layerBytes);
+	// The layers are only quantized after the generation, so the snapshot is all that shrinks at the peak
+	const SIZE_T quantizedBytes = bQuantizeLayers
+		                              ? numRegions * 4 * (sizeof(float) - sizeof(uint16))
+		                              + numTriangles * 2 * (sizeof(float) - sizeof(uint16))
+		                              : 0;
+	// Every published generation keeps a copy of the layers
+	footprint.Add(TEXT("Snapshot"), bPublishSnapshots ? layerBytes - quantizedBytes : 0);
+	return footprint;
+}
 
+const UIslandMeshBuilder* UIslandMapData::ApplyMemoryBudget()
+{
+	const int32 numRegions = MemoryBudgetMB > 0 ? PointGenerator->EstimateRegionNum() : 0;
+	if (numRegions <= 0)
 	{
-		TRACE_CPUPROFILER_EVENT_SCOPE(Districts)
-		District->AssignDistrict(DistrictRegions, Mesh, r_ocean, Rng);
+		return PointGenerator;
 	}
-
+	const int64 budget = static_cast<int64>(MemoryBudgetMB) * 1024 * 1024;
+	const int64 estimate = EstimateMemoryFootprint(numRegions).TotalBytes;
+	if (estimate <= budget)
 	{
-		TRACE_CPUPROFILER_EVENT_SCOPE(Coastlines)
-		IslandCoastline = NewObject<UIslandCoastline>();
-		IslandCoastline->Initialize(Mesh, r_ocean, r_coast);
+		return PointGenerator;
 	}
-	// Do whatever we need to do when the island generation is done
-	OnIslandGenerationComplete.Broadcast();
+	if (bDownscaleOverBudget && IsInGameThread())
+	{
+		// A little below the budget, the estimate is not exact
+		const float scale = 0.95f * budget / estimate;
+		BudgetPointGenerator = DuplicateObject(PointGenerator, this);
+		if (BudgetPointGenerator->ScaleRegionNum(scale))
+		{
+			UE_LOG(LogMapGen, Warning,
+			       TEXT("About %d regions need %lld bytes, over the budget of %d MB. Generating about %d instead."),
+			       numRegions, estimate, MemoryBudgetMB, BudgetPointGenerator->EstimateRegionNum());
+			return BudgetPointGenerator;
+		}
+	}
+	UE_LOG(LogMapGen, Error, TEXT("About %d regions need %lld bytes, over the budget of %d MB. Not generating."),
+	       numRegions, estimate, MemoryBudgetMB);
+	return nullptr;
 }
 
-FVector2D UIslandMapData::GetMapSize() const
+const FIslandVoronoiView& UIslandMapData::GetVoronoiView()
 {
-	if (Mesh == nullptr)
-		return FVector2D::ZeroVector;
-	return Mesh->GetSize();
+	if (VoronoiView.IsEmpty())
+	{
+		VoronoiView.Build(Mesh);
+	}
+	return VoronoiView;
 }
 
 TArray<FIslandPolygon>& UIslandMapData::GetVoronoiPolygons()
 {
 	if (VoronoiPolygons.Num() == 0)
 	{
-		VoronoiPolygons.SetNumZeroed(Mesh->NumSolidRegions);
-		for (FPointIndex r = 0; r < Mesh->NumSolidRegions; r++)
+		const FIslandVoronoiView& voronoi = GetVoronoiView();
+		VoronoiPolygons.SetNumZeroed(voronoi.Num());
+		for (FPointIndex r = 0; r < voronoi.Num(); r++)
 		{
-			VoronoiPolygons[r].Biome = r_biome[r];
-			VoronoiPolygons[r].Vertices = Mesh->r_circulate_t(r);
-			for (FTriangleIndex t : VoronoiPolygons[r].Vertices)
+			const TArrayView<const FTriangleIndex> corners = voronoi.GetCorners(r);
+			FIslandPolygon& polygon = VoronoiPolygons[r];
+			polygon.BiomeIndex = r_biome[r];
+			polygon.Biome = BiomePalette[r_biome[r]];
+			polygon.Vertices.Append(corners.GetData(), corners.Num());
+			polygon.VertexPoints.Reserve(corners.Num());
+			for (FTriangleIndex t : corners)
 			{
-				if (!t.IsValid())
-				{
-					continue;
-				}
-				FVector2D point2D = Mesh->t_pos(t);
-				float z = t_elevation.IsValidIndex(t) ? t_elevation[t] : -1000.0f;
-				VoronoiPolygons[r].VertexPoints.Add(FVector(point2D.X, point2D.Y, z * 10000));
+				FVector2D point2D = voronoi.GetCornerPosition(t);
+				float z = t_elevation.IsValidIndex(t) ? t_elevation[t]
+					: QuantizedLayers.t_elevation.IsValidIndex(t) ? QuantizedLayers.t_elevation[t] : -1000.0f;
+				polygon.VertexPoints.Add(FVector(point2D.X, point2D.Y, z * 10000));
 			}
 		}
 	}
 	return VoronoiPolygons;
 }
 
-TArray<bool>& UIslandMapData::GetWaterRegions()
+TArray<bool> UIslandMapData::GetWaterRegions() const
 {
-	return r_water;
+	TArray<bool> regions;
+	UIslandMapUtils::UnpackRegionFlags(r_flags, ERegionFlags::Water, regions);
+	return regions;
 }
 
 bool UIslandMapData::IsPointWater(FPointIndex Region) const
 {
-	if (r_water.IsValidIndex(Region))
-	{
-		return r_water[Region];
-	}
-	else
-	{
-		return false;
-	}
+	return HasPointFlags(Region, ERegionFlags::Water);
 }
 
-TArray<bool>& UIslandMapData::GetOceanRegions()
+TArray<bool> UIslandMapData::GetOceanRegions() const
 {
-	return r_ocean;
+	TArray<bool> regions;
+	UIslandMapUtils::UnpackRegionFlags(r_flags, ERegionFlags::Ocean, regions);
+	return regions;
 }
 
 bool UIslandMapData::IsPointOcean(FPointIndex Region) const
 {
-	if (r_ocean.IsValidIndex(Region))
-	{
-		return r_ocean[Region];
-	}
-	else
-	{
-		return false;
-	}
+	return HasPointFlags(Region, ERegionFlags::Ocean);
 }
 
-TArray<bool>& UIslandMapData::GetCoastalRegions()
+TArray<bool> UIslandMapData::GetCoastalRegions() const
 {
-	return r_coast;
+	TArray<bool> regions;
+	UIslandMapUtils::UnpackRegionFlags(r_flags, ERegionFlags::Coast, regions);
+	return regions;
 }
 
 bool UIslandMapData::IsPointCoast(FPointIndex Region) const
 {
-	if (r_coast.IsValidIndex(Region))
-	{
-		return r_coast[Region];
-	}
-	else
-	{
-		return false;
-	}
+	return HasPointFlags(Region, ERegionFlags::Coast);
+}
+
+bool UIslandMapData::IsPointLake(FPointIndex Region) const
+{
+	return HasPointFlags(Region, ERegionFlags::Lake);
+}
+
+const TArray<int32>& UIslandMapData::GetRegionLakes() const
+{
+	return r_lake;
+}
+
+int32 UIslandMapData::GetPointLake(FPointIndex Region) const
+{
+	return r_lake.IsValidIndex(Region) ? r_lake[Region] : INDEX_NONE;
+}
+
+int32 UIslandMapData::GetLakeCount() const
+{
+	return NumLakes;
+}
+
+const TArray<ERegionFlags>& UIslandMapData::GetRegionFlags() const
+{
+	return r_flags;
 }
 
-TArray<float>& UIslandMapData::GetRegionElevations()
+const TArray<float>& UIslandMapData::GetRegionElevations() const
 {
-	return r_elevation;
+	return ReadDecodedLayer(r_elevation, QuantizedLayers.r_elevation, DecodedLayers.r_elevation, DecodedLayersLock);
 }
 
 float UIslandMapData::GetPointElevation(FPointIndex Region) const
@@ -335,15 +1475,19 @@ float UIslandMapData::GetPointElevation(FPointIndex Region) const
 	{
 		return r_elevation[Region];
 	}
+	else if (QuantizedLayers.r_elevation.IsValidIndex(Region))
+	{
+		return QuantizedLayers.r_elevation[Region];
+	}
 	else
 	{
 		return -1.0f;
 	}
 }
 
-TArray<int32>& UIslandMapData::GetRegionWaterDistance()
+const TArray<int32>& UIslandMapData::GetRegionWaterDistance() const
 {
-	return r_waterdistance;
+	return ReadDecodedLayer(r_waterdistance, QuantizedLayers.r_waterdistance, DecodedLayers.r_waterdistance, DecodedLayersLock);
 }
 
 int32 UIslandMapData::GetPointWaterDistance(FPointIndex Region) const
@@ -352,15 +1496,19 @@ int32 UIslandMapData::GetPointWaterDistance(FPointIndex Region) const
 	{
 		return r_waterdistance[Region];
 	}
+	else if (QuantizedLayers.r_waterdistance.IsValidIndex(Region))
+	{
+		return QuantizedLayers.r_waterdistance[Region];
+	}
 	else
 	{
 		return -1;
 	}
 }
 
-TArray<float>& UIslandMapData::GetRegionMoisture()
+const TArray<float>& UIslandMapData::GetRegionMoisture() const
 {
-	return r_moisture;
+	return ReadDecodedLayer(r_moisture, QuantizedLayers.r_moisture, DecodedLayers.r_moisture, DecodedLayersLock);
 }
 
 float UIslandMapData::GetPointMoisture(FPointIndex Region) const
@@ -369,15 +1517,19 @@ float UIslandMapData::GetPointMoisture(FPointIndex Region) const
 	{
 		return r_moisture[Region];
 	}
+	else if (QuantizedLayers.r_moisture.IsValidIndex(Region))
+	{
+		return QuantizedLayers.r_moisture[Region];
+	}
 	else
 	{
 		return -1.0f;
 	}
 }
 
-TArray<float>& UIslandMapData::GetRegionTemperature()
+const TArray<float>& UIslandMapData::GetRegionTemperature() const
 {
-	return r_temperature;
+	return ReadDecodedLayer(r_temperature, QuantizedLayers.r_temperature, DecodedLayers.r_temperature, DecodedLayersLock);
 }
 
 float UIslandMapData::GetPointTemperature(FPointIndex Region) const
@@ -386,22 +1538,42 @@ float UIslandMapData::GetPointTemperature(FPointIndex Region) const
 	{
 		return r_temperature[Region];
 	}
+	else if (QuantizedLayers.r_temperature.IsValidIndex(Region))
+	{
+		return QuantizedLayers.r_temperature[Region];
+	}
 	else
 	{
 		return -1.0f;
 	}
 }
 
-TArray<FBiomeData>& UIslandMapData::GetRegionBiomes()
+const TArray<uint8>& UIslandMapData::GetRegionBiomeIndices() const
 {
 	return r_biome;
 }
 
+TArray<FBiomeData> UIslandMapData::GetRegionBiomes() const
+{
+	TArray<FBiomeData> biomes;
+	biomes.Reserve(r_biome.Num());
+	for (const uint8 biome : r_biome)
+	{
+		biomes.Add(BiomePalette.IsValidIndex(biome) ? BiomePalette[biome] : FBiomeData());
+	}
+	return biomes;
+}
+
+const TArray<FBiomeData>& UIslandMapData::GetBiomePalette() const
+{
+	return BiomePalette;
+}
+
 FBiomeData UIslandMapData::GetPointBiome(FPointIndex Region) const
 {
-	if (r_biome.IsValidIndex(Region))
+	if (r_biome.IsValidIndex(Region) && BiomePalette.IsValidIndex(r_biome[Region]))
 	{
-		return r_biome[Region];
+		return BiomePalette[r_biome[Region]];
 	}
 	else
 	{
@@ -409,14 +1581,211 @@ FBiomeData UIslandMapData::GetPointBiome(FPointIndex Region) const
 	}
 }
 
+int32 UIslandMapData::GetPointBiomeIndex(FPointIndex Region) const
+{
+	return r_biome.IsValidIndex(Region) && BiomePalette.IsValidIndex(r_biome[Region]) ? r_biome[Region] : INDEX_NONE;
+}
+
 const TArray<FDistrictRegion>& UIslandMapData::GetDistrictRegions() const
 {
 	return DistrictRegions;
 }
 
-TArray<int32>& UIslandMapData::GetTriangleCoastDistances()
+const TArray<int32>& UIslandMapData::GetRegionDistricts() const
+{
+	return r_district;
+}
+
+int32 UIslandMapData::GetPointDistrict(FPointIndex Region) const
+{
+	return r_district.IsValidIndex(Region) ? r_district[Region] : INDEX_NONE;
+}
+
+uint32 UIslandMapData::GetGenerationFingerprint() const
+{
+	// Every stage fingerprint already includes the mesh fingerprint
+	uint32 fingerprint = StageFingerprints.IsEmpty() ? MeshFingerprint : 0;
+	for (const uint32 stageFingerprint : StageFingerprints)
+	{
+		fingerprint = HashCombine(fingerprint, stageFingerprint);
+	}
+	return fingerprint;
+}
+
+uint32 UIslandMapData::ComputeContentHash() const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UIslandMapData::ComputeContentHash)
+	if (Mesh == nullptr)
+	{
+		return 0;
+	}
+	uint32 crc = FCrc::MemCrc32(&Mesh->NumSolidRegions, sizeof(Mesh->NumSolidRegions));
+	crc = FCrc::MemCrc32(&Mesh->NumSolidTriangles, sizeof(Mesh->NumSolidTriangles), crc);
+	for (FPointIndex region(0); region < Mesh->NumSolidRegions; ++region)
+	{
+		const FVector2D position = Mesh->r_pos(region);
+		crc = FCrc::MemCrc32(&position, sizeof(position), crc);
+	}
+	auto hashLayer = [&crc](const auto& layer)
+	{
+		crc = FCrc::MemCrc32(layer.GetData(), layer.Num() * layer.GetTypeSize(), crc);
+	};
+	// Hashed as quantized, so a server with bQuantizeLayers agrees with clients without
+	auto hashFloatLayer = [&crc](const TArray<float>& layer, const FIslandQuantizedFloatLayer& quantized)
+	{
+		if (quantized.Num() > 0)
+		{
+			crc = quantized.GetCrc32(crc);
+			return;
+		}
+		FIslandQuantizedFloatLayer scratch;
+		scratch.Encode(layer);
+		crc = scratch.GetCrc32(crc);
+	};
+	hashLayer(r_flags);
+	hashFloatLayer(r_elevation, QuantizedLayers.r_elevation);
+	hashFloatLayer(r_moisture, QuantizedLayers.r_moisture);
+	hashFloatLayer(r_temperature, QuantizedLayers.r_temperature);
+	hashLayer(r_biome);
+	hashLayer(r_district);
+	hashFloatLayer(t_elevation, QuantizedLayers.t_elevation);
+	hashLayer(s_flow);
+	return crc;
+}
+
+FIslandReplicationState UIslandMapData::GetReplicationState() const
+{
+	FIslandReplicationState state;
+	state.Seed = Seed;
+	state.DrainageSeed = DrainageSeed;
+	state.RiverSeed = RiverSeed;
+	state.DistrictSeed = DistrictSeed;
+	state.GenerationFingerprint = GetGenerationFingerprint();
+	state.ContentHash = ComputeContentHash();
+	return state;
+}
+
+bool UIslandMapData::VerifyReplicationState(const FIslandReplicationState& State) const
+{
+	const uint32 fingerprint = GetGenerationFingerprint();
+	if (fingerprint != State.GenerationFingerprint)
+	{
+		UE_LOG(LogMapGen, Warning, TEXT("%s: generation fingerprint %08x differs from %08x, the seeds or the settings "
+			       "do not match"), *GetName(), fingerprint, State.GenerationFingerprint);
+		return false;
+	}
+	const uint32 contentHash = ComputeContentHash();
+	if (contentHash != State.ContentHash)
+	{
+		UE_LOG(LogMapGen, Warning, TEXT("%s: content hash %08x differs from %08x although the settings match, the "
+			       "generation is not deterministic across these machines"), *GetName(), contentHash, State.ContentHash);
+		return false;
+	}
+	return true;
+}
+
+FIslandRegionPatch UIslandMapData::MakeRegionPatch(int32 FirstRegion, int32 Num) const
+{
+	FIslandRegionPatch patch;
+	const int32 regionNum = Mesh != nullptr ? Mesh->NumSolidRegions : 0;
+	FirstRegion = FMath::Clamp(FirstRegion, 0, regionNum);
+	Num = FMath::Clamp(Num, 0, regionNum - FirstRegion);
+	patch.FirstRegion = FirstRegion;
+	if (Num > 0)
+	{
+		TArray<float> elevationScratch;
+		const TConstArrayView<float> elevations = ReadLayer(r_elevation, QuantizedLayers.r_elevation, elevationScratch);
+		patch.Elevations = TArray<float>(elevations.GetData() + FirstRegion, Num);
+		patch.Flags = TArray<ERegionFlags>(r_flags.GetData() + FirstRegion, Num);
+		patch.Biomes = TArray<uint8>(r_biome.GetData() + FirstRegion, Num);
+		patch.Districts = TArray<int32>(r_district.GetData() + FirstRegion, Num);
+	}
+	return patch;
+}
+
+bool UIslandMapData::ApplyRegionPatch(const FIslandRegionPatch& Patch)
+{
+	return ApplyRegionPatches(MakeArrayView(&Patch, 1));
+}
+
+bool UIslandMapData::ApplyRegionPatches(TConstArrayView<FIslandRegionPatch> Patches)
+{
+	const int32 regionNum = Mesh != nullptr ? Mesh->NumSolidRegions : 0;
+	for (const FIslandRegionPatch& patch : Patches)
+	{
+		const int32 num = patch.Num();
+		if (num == 0 || patch.FirstRegion < 0 || patch.FirstRegion + num > regionNum)
+		{
+			UE_LOG(LogMapGen, Warning, TEXT("%s: region patch at %d does not fit the %d regions of the map"), *GetName(),
+			       patch.FirstRegion, regionNum);
+			return false;
+		}
+		for (const uint8 biome : patch.Biomes)
+		{
+			if (!BiomePalette.IsValidIndex(biome))
+			{
+				UE_LOG(LogMapGen, Warning, TEXT("%s: region patch uses biome %d of a palette of %d"), *GetName(), biome,
+				       BiomePalette.Num());
+				return false;
+			}
+		}
+	}
+
+	// Patched in full precision, quantized again below
+	ExpandQuantizedLayers();
+	bool bFlagsChanged = false;
+	for (const FIslandRegionPatch& patch : Patches)
+	{
+		const int32 num = patch.Num();
+		const int32 first = patch.FirstRegion;
+		if (!patch.Elevations.IsEmpty())
+		{
+			FMemory::Memcpy(r_elevation.GetData() + first, patch.Elevations.GetData(), num * sizeof(float));
+		}
+		if (!patch.Biomes.IsEmpty())
+		{
+			FMemory::Memcpy(r_biome.GetData() + first, patch.Biomes.GetData(), num * sizeof(uint8));
+		}
+		if (!patch.Districts.IsEmpty())
+		{
+			FMemory::Memcpy(r_district.GetData() + first, patch.Districts.GetData(), num * sizeof(int32));
+		}
+		for (int32 index = 0; index < patch.Flags.Num(); index++)
+		{
+			bFlagsChanged |= r_flags[first + index] != patch.Flags[index];
+			r_flags[first + index] = patch.Flags[index];
+		}
+	}
+	if (bFlagsChanged)
+	{
+		RebuildRegionFlagLayers();
+	}
+
+	InvalidateGenerationCache();
+	VoronoiPolygons.Reset();
+	{
+		FScopeLock lock(&MapQueryLock);
+		MapQuery.Reset();
+	}
+	{
+		FScopeLock lock(&NavigationGraphLock);
+		NavigationGraph.Reset();
+	}
+	if (bBuildMapQuery)
+	{
+		GetMapQuery();
+	}
+	if (bQuantizeLayers)
+	{
+		QuantizeLayers();
+	}
+	PublishSnapshot();
+	return true;
+}
+
+const TArray<int32>& UIslandMapData::GetTriangleCoastDistances() const
 {
-	return t_coastdistance;
+	return ReadDecodedLayer(t_coastdistance, QuantizedLayers.t_coastdistance, DecodedLayers.t_coastdistance, DecodedLayersLock);
 }
 
 int32 UIslandMapData::GetTriangleCoastDistance(FTriangleIndex Triangle) const
@@ -425,15 +1794,19 @@ int32 UIslandMapData::GetTriangleCoastDistance(FTriangleIndex Triangle) const
 	{
 		return t_coastdistance[Triangle];
 	}
+	else if (QuantizedLayers.t_coastdistance.IsValidIndex(Triangle))
+	{
+		return QuantizedLayers.t_coastdistance[Triangle];
+	}
 	else
 	{
 		return -1;
 	}
 }
 
-TArray<float>& UIslandMapData::GetTriangleElevations()
+const TArray<float>& UIslandMapData::GetTriangleElevations() const
 {
-	return t_elevation;
+	return ReadDecodedLayer(t_elevation, QuantizedLayers.t_elevation, DecodedLayers.t_elevation, DecodedLayersLock);
 }
 
 float UIslandMapData::GetTriangleElevation(FTriangleIndex Triangle) const
@@ -442,6 +1815,10 @@ float UIslandMapData::GetTriangleElevation(FTriangleIndex Triangle) const
 	{
 		return t_elevation[Triangle];
 	}
+	else if (QuantizedLayers.t_elevation.IsValidIndex(Triangle))
+	{
+		return QuantizedLayers.t_elevation[Triangle];
+	}
 	else
 	{
 		return -1.0f;
@@ -458,6 +1835,30 @@ TArray<int32>& UIslandMapData::GetSideFlow()
 	return s_flow;
 }
 
+const FRiverNetwork& UIslandMapData::GetRiverNetwork() const
+{
+	return RiverNetwork;
+}
+
+const TArray<URiver*>& UIslandMapData::GetRivers()
+{
+	if (RiverObjects.Num() != RiverNetwork.Num())
+	{
+		RiverNetwork.CreateRiverObjects(this, RiverObjects);
+	}
+	return RiverObjects;
+}
+
+const TArray<URiver*>& UIslandMapData::GetCreatedRivers()
+{
+	return GetRivers();
+}
+
+const TArray<int32>& UIslandMapData::GetTriangleFlow() const
+{
+	return t_flow;
+}
+
 TArray<FTriangleIndex>& UIslandMapData::GetSpringTriangles()
 {
 	return spring_t;
@@ -482,3 +1883,134 @@ const TArray<FCoastlinePolygon>& UIslandMapData::GetCoastLines() const
 {
 	return IslandCoastline->GetCoastlines();
 }
+
+const FCoastlineSpatialIndex& UIslandMapData::GetCoastlineSpatialIndex() const
+{
+	return IslandCoastline->GetSpatialIndex();
+}
+
+void UIslandMapData::BakeCoastDistanceField()
+{
+	if (IslandCoastline == nullptr)
+	{
+		UE_LOG(LogMapGen, Warning, TEXT("Cannot bake the coast distance field before the island is generated."));
+		return;
+	}
+	TRACE_CPUPROFILER_EVENT_SCOPE(CoastDistanceField)
+	CoastDistanceField.Bake(IslandCoastline->GetSpatialIndex(), GetMapSize(), CoastDistanceFieldResolution,
+	                        CoastDistanceFieldMaxDistance);
+}
+
+const FCoastDistanceField& UIslandMapData::GetCoastDistanceField() const
+{
+	return CoastDistanceField;
+}
+
+double UIslandMapData::GetSignedCoastDistance(const FVector2D& Point, const double MaxDistance) const
+{
+	if (CoastDistanceField.Covers(MaxDistance))
+	{
+		return FMath::Clamp(CoastDistanceField.Sample(Point), -MaxDistance, MaxDistance);
+	}
+	const FCoastlineSpatialIndex& SpatialIndex = IslandCoastline->GetSpatialIndex();
+	const double Distance = SpatialIndex.DistanceToCoast(Point, MaxDistance);
+	return SpatialIndex.IsInside(Point) ? -Distance : Distance;
+}
+
+TSharedRef<const FIslandMapQuery> UIslandMapData::BuildMapQuery() const
+{
+	const TSharedRef<FIslandMapQuery> query = MakeShared<FIslandMapQuery>();
+	const int32 regionNum = Mesh != nullptr ? Mesh->NumSolidRegions : 0;
+	TArray<float> elevationScratch;
+	const TConstArrayView<float> elevations = ReadLayer(r_elevation, QuantizedLayers.r_elevation, elevationScratch);
+	if (regionNum > 0 && elevations.Num() >= regionNum && r_flags.Num() >= regionNum && r_biome.Num() >= regionNum
+		&& r_district.Num() >= regionNum)
+	{
+		query->Build(*Mesh, elevations, r_flags, r_biome, r_district);
+	}
+	return query;
+}
+
+TSharedRef<const FIslandMapQuery> UIslandMapData::GetMapQuery() const
+{
+	FScopeLock lock(&MapQueryLock);
+	if (!MapQuery.IsValid())
+	{
+		MapQuery = BuildMapQuery();
+	}
+	return MapQuery.ToSharedRef();
+}
+
+FIslandMapSample UIslandMapData::SampleAt(const FVector2D& Point) const
+{
+	return GetMapQuery()->Sample(Point);
+}
+
+TArray<FIslandMapSample> UIslandMapData::SampleAllAt(const TArray<FVector2D>& Points) const
+{
+	TArray<FIslandMapSample> samples;
+	samples.SetNum(Points.Num());
+	GetMapQuery()->SampleAll(Points, samples);
+	return samples;
+}
+
+float UIslandMapData::GetElevationAt(const FVector2D& Point) const
+{
+	return GetMapQuery()->GetElevationAt(Point);
+}
+
+FBiomeData UIslandMapData::GetBiomeAt(const FVector2D& Point) const
+{
+	const TSharedRef<const FIslandMapQuery> query = GetMapQuery();
+	if (!query->IsValid())
+	{
+		return FBiomeData();
+	}
+	const uint8 biome = query->GetBiomeAt(Point);
+	return BiomePalette.IsValidIndex(biome) ? BiomePalette[biome] : FBiomeData();
+}
+
+int32 UIslandMapData::GetDistrictAt(const FVector2D& Point) const
+{
+	return GetMapQuery()->GetDistrictAt(Point);
+}
+
+bool UIslandMapData::IsOceanAt(const FVector2D& Point) const
+{
+	return GetMapQuery()->IsOceanAt(Point);
+}
+
+TSharedRef<const FIslandNavigationGraph> UIslandMapData::GetNavigationGraph() const
+{
+	FScopeLock lock(&NavigationGraphLock);
+	if (!NavigationGraph.IsValid())
+	{
+		const TSharedRef<FIslandNavigationGraph> graph = MakeShared<FIslandNavigationGraph>();
+		const int32 regionNum = Mesh != nullptr ? Mesh->NumSolidRegions : 0;
+		TArray<float> elevationScratch;
+		const TConstArrayView<float> elevations = ReadLayer(r_elevation, QuantizedLayers.r_elevation, elevationScratch);
+		if (regionNum > 0 && elevations.Num() >= regionNum && r_flags.Num() >= regionNum)
+		{
+			graph->Build(*Mesh, elevations, r_flags, s_flow, NavigationSettings);
+		}
+		NavigationGraph = graph;
+	}
+	return NavigationGraph.ToSharedRef();
+}
+
+bool UIslandMapData::FindPath(const FVector2D& Start, const FVector2D& Goal, TArray<FVector2D>& OutPath) const
+{
+	OutPath.Reset();
+	const TSharedRef<const FIslandMapQuery> query = GetMapQuery();
+	TArray<FPointIndex> regions;
+	if (!GetNavigationGraph()->FindPath(query->FindRegion(Start), query->FindRegion(Goal), regions))
+	{
+		return false;
+	}
+	OutPath.Reserve(regions.Num());
+	for (const FPointIndex region : regions)
+	{
+		OutPath.Add(Mesh->r_pos(region));
+	}
+	return true;
+}
@@ -8,6 +8,38 @@
 #include "Engine/CanvasRenderTarget2D.h"
 #include "Kismet/KismetRenderingLibrary.h"
 
+namespace
+{
+	// Fans the Voronoi polygon of every solid region into one triangle list, so the layer is a single canvas draw
+	template <typename ColorFuncType>
+	void BuildRegionTriangles(TArray<FCanvasUVTri>& OutTris, const UTriangleDualMesh* Mesh, const FVector2D& Scale,
+	                          ColorFuncType&& GetRegionColor)
+	{
+		// Every solid triangle is a corner of three polygons, each polygon loses two of its corners to the fan
+		OutTris.Reset(FMath::Max(3 * Mesh->NumSolidTriangles - 2 * Mesh->NumSolidRegions, 0));
+		TArray<FVector2D, TInlineAllocator<16>> TrianglePos;
+		for (int32 PointIndex = 0; PointIndex < Mesh->NumSolidRegions; ++PointIndex)
+		{
+			TrianglePos.Reset();
+			Mesh->r_circulate_t(PointIndex, [&TrianglePos, Mesh, &Scale](const FTriangleIndex TriangleIndex)
+			{
+				TrianglePos.Add(Mesh->t_pos(TriangleIndex) * Scale);
+			});
+			const FLinearColor Color = GetRegionColor(FPointIndex(PointIndex));
+			for (int32 i = 2; i < TrianglePos.Num(); i++)
+			{
+				FCanvasUVTri& Tri = OutTris.AddDefaulted_GetRef();
+				Tri.V0_Color = Color;
+				Tri.V1_Color = Color;
+				Tri.V2_Color = Color;
+				Tri.V0_Pos = TrianglePos[0];
+				Tri.V1_Pos = TrianglePos[i - 1];
+				Tri.V2_Pos = TrianglePos[i];
+			}
+		}
+	}
+}
+
 void UIslandMapDebugUtils::DrawWater(UCanvasRenderTarget2D* RenderTarget2D, const UIslandMapData* MapData)
 {
 	if (MapData == nullptr)
@@ -25,43 +57,16 @@ void UIslandMapDebugUtils::DrawWater(UCanvasRenderTarget2D* RenderTarget2D, cons
 		return;
 	const FVector2D Scale = Size / MapData->GetMapSize();
 
-	for (int32 PointIndex = 0; PointIndex < Mesh->NumSolidRegions; ++PointIndex)
+	TArray<FCanvasUVTri> CanvasTris;
+	BuildRegionTriangles(CanvasTris, Mesh, Scale, [MapData](const FPointIndex PointIndex)
 	{
-		const TArray<FTriangleIndex>& TriangleIndexs = Mesh->r_circulate_t(PointIndex);
-		TArray<FVector2D> TrianglePos;
-		TrianglePos.Empty(TriangleIndexs.Num());
-		for (const FTriangleIndex& TriangleIndex : TriangleIndexs)
-		{
-			TrianglePos.Add(Mesh->t_pos(TriangleIndex));
-		}
-		TArray<FCanvasUVTri> CanvasTris;
-		CanvasTris.Empty(TrianglePos.Num() - 2);
-		FVector2D FirstPos = TrianglePos[0];
-		FVector2D SecondPos = TrianglePos[1];
-		FLinearColor Color = FLinearColor(0.937, 0.647, 0.451);
-		if (MapData->IsPointWater(PointIndex))
-		{
-			Color = FLinearColor(0.94, 0.29, 0.612);
-			if (MapData->IsPointOcean(PointIndex))
-			{
-				Color = FLinearColor(0.341, 0.549, 0.898);
-			}
-		}
-		for (int32 i = 2; i < TrianglePos.Num(); i++)
+		if (MapData->IsPointOcean(PointIndex))
 		{
-			const FVector2D& NextPos = TrianglePos[i % TrianglePos.Num()];
-			FCanvasUVTri Tri;
-			Tri.V0_Color = Color;
-			Tri.V1_Color = Color;
-			Tri.V2_Color = Color;
-			Tri.V0_Pos = FirstPos * Scale;
-			Tri.V1_Pos = SecondPos * Scale;
-			Tri.V2_Pos = NextPos * Scale;
-			CanvasTris.Add(Tri);
-			SecondPos = NextPos;
+			return FLinearColor(0.341, 0.549, 0.898);
 		}
-		Canvas->K2_DrawTriangle(nullptr, CanvasTris);
-	}
+		return MapData->IsPointWater(PointIndex) ? FLinearColor(0.94, 0.29, 0.612) : FLinearColor(0.937, 0.647, 0.451);
+	});
+	Canvas->K2_DrawTriangle(nullptr, CanvasTris);
 	UKismetRenderingLibrary::EndDrawCanvasToRenderTarget(MapData->GetWorld(), Context);
 }
 
@@ -82,48 +87,27 @@ void UIslandMapDebugUtils::DrawRegion(UCanvasRenderTarget2D* RenderTarget2D, con
 		return;
 	const FVector2D Scale = Size / MapData->GetMapSize();
 
-	for (int32 PointIndex = 0; PointIndex < Mesh->NumSolidRegions; ++PointIndex)
+	// Looked up by index, copying the biome of every region would dominate the overview
+	TArray<FLinearColor> BiomeColors;
+	for (const FBiomeData& Biome : MapData->GetBiomePalette())
 	{
-		const TArray<FTriangleIndex>& TriangleIndexs = Mesh->r_circulate_t(PointIndex);
-		TArray<FVector2D> TrianglePos;
-		TrianglePos.Empty(TriangleIndexs.Num());
-		for (const FTriangleIndex& TriangleIndex : TriangleIndexs)
+		BiomeColors.Add(Biome.DebugColor);
+	}
+	TArray<FCanvasUVTri> CanvasTris;
+	BuildRegionTriangles(CanvasTris, Mesh, Scale, [MapData, &BiomeColors](const FPointIndex PointIndex)
+	{
+		if (MapData->IsPointOcean(PointIndex))
 		{
-			TrianglePos.Add(Mesh->t_pos(TriangleIndex));
+			return FLinearColor::Black;
 		}
-		TArray<FCanvasUVTri> CanvasTris;
-		CanvasTris.Empty(TrianglePos.Num() - 2);
-		FVector2D FirstPos = TrianglePos[0];
-		FVector2D SecondPos = TrianglePos[1];
-		FLinearColor Color = FLinearColor::Gray;
 		if (MapData->IsPointWater(PointIndex))
 		{
-			Color = FLinearColor::Blue;
-			if (MapData->IsPointOcean(PointIndex))
-			{
-				Color = FLinearColor::Black;
-			}
-		}
-		else
-		{
-			FBiomeData Biome = MapData->GetPointBiome(PointIndex);
-			Color = Biome.DebugColor;
-		}
-		for (int32 i = 2; i < TrianglePos.Num(); i++)
-		{
-			const FVector2D& NextPos = TrianglePos[i % TrianglePos.Num()];
-			FCanvasUVTri Tri;
-			Tri.V0_Color = Color;
-			Tri.V1_Color = Color;
-			Tri.V2_Color = Color;
-			Tri.V0_Pos = FirstPos * Scale;
-			Tri.V1_Pos = SecondPos * Scale;
-			Tri.V2_Pos = NextPos * Scale;
-			CanvasTris.Add(Tri);
-			SecondPos = NextPos;
+			return FLinearColor::Blue;
 		}
-		Canvas->K2_DrawTriangle(nullptr, CanvasTris);
-	}
+		const int32 Biome = MapData->GetPointBiomeIndex(PointIndex);
+		return Biome == INDEX_NONE ? FLinearColor::Gray : BiomeColors[Biome];
+	});
+	Canvas->K2_DrawTriangle(nullptr, CanvasTris);
 	UKismetRenderingLibrary::EndDrawCanvasToRenderTarget(MapData->GetWorld(), Context);
 }
 
@@ -147,13 +131,12 @@ void UIslandMapDebugUtils::DrawCoastline(UCanvasRenderTarget2D* RenderTarget2D,
 		{
 			continue;
 		}
-		TArray<FSideIndex> Sides = Mesh->r_circulate_s(PointIndex);
-		for (const FSideIndex& Side : Sides)
+		Mesh->r_circulate_s(PointIndex, [&](const FSideIndex Side)
 		{
 			FPointIndex OuterRegion = Mesh->s_end_r(Side);
 			if (!MapData->IsPointOcean(OuterRegion))
 			{
-				continue;
+				return;
 			}
 			FTriangleIndex T1 = Mesh->s_inner_t(Side);
 			FTriangleIndex T2 = Mesh->s_outer_t(Side);
@@ -162,7 +145,7 @@ void UIslandMapDebugUtils::DrawCoastline(UCanvasRenderTarget2D* RenderTarget2D,
 			FVector2D CPos = (TPos1 + TPos2) / 2;
 			Canvas->K2_DrawLine(TPos1, CPos, 3, FLinearColor::Green);
 			Canvas->K2_DrawLine(CPos, TPos2, 3, FLinearColor::Red);
-		}
+		});
 	}
 
 	UKismetRenderingLibrary::EndDrawCanvasToRenderTarget(MapData->GetWorld(), Context);
@@ -186,7 +169,7 @@ void UIslandMapDebugUtils::DrawTriangulationIsland(UCanvasRenderTarget2D* Render
 
 	for (const FCoastlinePolygon& Coastline : MapData->GetCoastLines())
 	{
-		const FLinearColor Color = FLinearColor::MakeRandomSeededColor(Coastline.Begin.Pin()->AIndex);
+		const FLinearColor Color = FLinearColor::MakeRandomSeededColor(Coastline.IslandId);
 		for (const FPolyTriangle2D& Tri : Coastline.Triangles)
 		{
 			CanvasTris.Add(FCanvasUVTri());
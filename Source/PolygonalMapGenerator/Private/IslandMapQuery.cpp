@@ -0,0 +1,195 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "IslandMapQuery.h"
+#include "Async/ParallelFor.h"
+#include "TriangleDualMesh.h"
+
+namespace
+{
+	constexpr int32 QueryBatchSize = 1024;
+	// A walk on a Delaunay triangulation never runs in circles, this only guards against edited meshes
+	constexpr int32 MaxWalkSteps = 4096;
+
+	FORCEINLINE double Orient(const FVector2D& A, const FVector2D& B, const FVector2D& C)
+	{
+		return FVector2D::CrossProduct(B - A, C - A);
+	}
+
+	template <typename FuncType>
+	void ForEachBatch(const int32 Num, FuncType&& Func)
+	{
+		ParallelFor(FMath::DivideAndRoundUp(Num, QueryBatchSize), [Num, &Func](const int32 Batch)
+		{
+			const int32 End = FMath::Min((Batch + 1) * QueryBatchSize, Num);
+			for (int32 Index = Batch * QueryBatchSize; Index < End; ++Index)
+			{
+				Func(Index);
+			}
+		});
+	}
+}
+
+void FIslandMapQuery::Build(const UTriangleDualMesh& Mesh, TConstArrayView<float> Elevations,
+                            TConstArrayView<ERegionFlags> Flags, TConstArrayView<uint8> Biomes,
+                            TConstArrayView<int32> Districts)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FIslandMapQuery::Build)
+	const int32 RegionNum = Mesh.NumSolidRegions;
+	const int32 TriangleNum = Mesh.NumSolidTriangles;
+	check(Elevations.Num() >= RegionNum && Flags.Num() >= RegionNum && Biomes.Num() >= RegionNum
+		&& Districts.Num() >= RegionNum);
+
+	RegionPositions.SetNumUninitialized(RegionNum);
+	for (FPointIndex Region(0); Region < RegionNum; ++Region)
+	{
+		RegionPositions[Region] = Mesh.r_pos(Region);
+	}
+	RegionGrid.Build(RegionPositions);
+
+	RegionTriangles.Init(INDEX_NONE, RegionNum);
+	TriangleCorners.SetNumUninitialized(TriangleNum);
+	TriangleNeighbors.SetNumUninitialized(TriangleNum);
+	for (int32 Triangle = 0; Triangle < TriangleNum; ++Triangle)
+	{
+		for (int32 Corner = 0; Corner < 3; ++Corner)
+		{
+			const FSideIndex Side(3 * Triangle + Corner);
+			const FPointIndex Region = Mesh.s_begin_r(Side);
+			const FSideIndex Opposite = Mesh.s_opposite_s(Side);
+			TriangleCorners[Triangle][Corner] = Region < static_cast<SIZE_T>(RegionNum) ? Region : INDEX_NONE;
+			TriangleNeighbors[Triangle][Corner] = Opposite.IsValid() && !Mesh.s_ghost(Opposite)
+				                                      ? static_cast<int32>(UTriangleDualMesh::s_to_t(Opposite))
+				                                      : INDEX_NONE;
+			if (Region < static_cast<SIZE_T>(RegionNum) && RegionTriangles[Region] == INDEX_NONE)
+			{
+				RegionTriangles[Region] = Triangle;
+			}
+		}
+	}
+
+	r_elevation = TArray<float>(Elevations.GetData(), RegionNum);
+	r_biome = TArray<uint8>(Biomes.GetData(), RegionNum);
+	r_district = TArray<int32>(Districts.GetData(), RegionNum);
+	r_ocean.Init(false, RegionNum);
+	for (int32 Region = 0; Region < RegionNum; ++Region)
+	{
+		r_ocean[Region] = EnumHasAnyFlags(Flags[Region], ERegionFlags::Ocean);
+	}
+}
+
+FPointIndex FIslandMapQuery::FindRegion(const FVector2D& Point) const
+{
+	const int32 Region = RegionGrid.FindClosest(RegionPositions, Point);
+	return Region == INDEX_NONE ? FPointIndex() : FPointIndex(Region);
+}
+
+float FIslandMapQuery::InterpolateElevation(const FVector2D& Point, const int32 Region) const
+{
+	int32 Triangle = RegionTriangles[Region];
+	for (int32 Step = 0; Step < MaxWalkSteps && Triangle != INDEX_NONE; ++Step)
+	{
+		const FIntVector& Corners = TriangleCorners[Triangle];
+		if (Corners.X == INDEX_NONE || Corners.Y == INDEX_NONE || Corners.Z == INDEX_NONE)
+		{
+			break;
+		}
+		const FVector2D& A = RegionPositions[Corners.X];
+		const FVector2D& B = RegionPositions[Corners.Y];
+		const FVector2D& C = RegionPositions[Corners.Z];
+		const double Area = Orient(A, B, C);
+		if (Area == 0.)
+		{
+			break;
+		}
+		// Each weight belongs to the corner opposite of the side it is measured against
+		const double WeightC = Orient(A, B, Point) / Area;
+		const double WeightA = Orient(B, C, Point) / Area;
+		const double WeightB = Orient(C, A, Point) / Area;
+		if (WeightC < 0.)
+		{
+			Triangle = TriangleNeighbors[Triangle].X;
+		}
+		else if (WeightA < 0.)
+		{
+			Triangle = TriangleNeighbors[Triangle].Y;
+		}
+		else if (WeightB < 0.)
+		{
+			Triangle = TriangleNeighbors[Triangle].Z;
+		}
+		else
+		{
+			return static_cast<float>(WeightA * r_elevation[Corners.X] + WeightB * r_elevation[Corners.Y]
+				+ WeightC * r_elevation[Corners.Z]);
+		}
+	}
+	// Outside of the triangulation
+	return r_elevation[Region];
+}
+
+FIslandMapSample FIslandMapQuery::Sample(const FVector2D& Point) const
+{
+	FIslandMapSample Result;
+	const int32 Region = RegionGrid.FindClosest(RegionPositions, Point);
+	if (Region == INDEX_NONE)
+	{
+		return Result;
+	}
+	Result.Region = Region;
+	Result.Elevation = InterpolateElevation(Point, Region);
+	Result.Biome = r_biome[Region];
+	Result.District = r_district[Region];
+	Result.bOcean = r_ocean[Region];
+	return Result;
+}
+
+float FIslandMapQuery::GetElevationAt(const FVector2D& Point) const
+{
+	const int32 Region = RegionGrid.FindClosest(RegionPositions, Point);
+	return Region == INDEX_NONE ? -1.f : InterpolateElevation(Point, Region);
+}
+
+uint8 FIslandMapQuery::GetBiomeAt(const FVector2D& Point) const
+{
+	const int32 Region = RegionGrid.FindClosest(RegionPositions, Point);
+	return Region == INDEX_NONE ? 0 : r_biome[Region];
+}
+
+int32 FIslandMapQuery::GetDistrictAt(const FVector2D& Point) const
+{
+	const int32 Region = RegionGrid.FindClosest(RegionPositions, Point);
+	return Region == INDEX_NONE ? INDEX_NONE : r_district[Region];
+}
+
+bool FIslandMapQuery::IsOceanAt(const FVector2D& Point) const
+{
+	const int32 Region = RegionGrid.FindClosest(RegionPositions, Point);
+	return Region == INDEX_NONE || r_ocean[Region];
+}
+
+void FIslandMapQuery::SampleAll(TConstArrayView<FVector2D> Points, TArrayView<FIslandMapSample> OutSamples) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FIslandMapQuery::SampleAll)
+	check(OutSamples.Num() == Points.Num());
+	ForEachBatch(Points.Num(), [this, Points, OutSamples](const int32 Index)
+	{
+		OutSamples[Index] = Sample(Points[Index]);
+	});
+}
+
+void FIslandMapQuery::GetElevationsAt(TConstArrayView<FVector2D> Points, TArrayView<float> OutElevations) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FIslandMapQuery::GetElevationsAt)
+	check(OutElevations.Num() == Points.Num());
+	ForEachBatch(Points.Num(), [this, Points, OutElevations](const int32 Index)
+	{
+		OutElevations[Index] = GetElevationAt(Points[Index]);
+	});
+}
+
+SIZE_T FIslandMapQuery::GetAllocatedSize() const
+{
+	return RegionPositions.GetAllocatedSize() + RegionGrid.GetAllocatedSize() + RegionTriangles.GetAllocatedSize()
+		+ TriangleCorners.GetAllocatedSize() + TriangleNeighbors.GetAllocatedSize() + r_elevation.GetAllocatedSize()
+		+ r_biome.GetAllocatedSize() + r_district.GetAllocatedSize() + r_ocean.GetAllocatedSize();
+}
@@ -0,0 +1,43 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "IslandMapSnapshot.h"
+
+FBiomeData FIslandMapSnapshot::GetPointBiome(FPointIndex Region) const
+{
+	if (r_biome.IsValidIndex(Region) && BiomePalette.IsValidIndex(r_biome[Region]))
+	{
+		return BiomePalette[r_biome[Region]];
+	}
+	return FBiomeData();
+}
+
+double FIslandMapSnapshot::GetSignedCoastDistance(const FVector2D& Point, const double MaxDistance) const
+{
+	if (CoastDistanceField.Covers(MaxDistance))
+	{
+		return FMath::Clamp(CoastDistanceField.Sample(Point), -MaxDistance, MaxDistance);
+	}
+	if (!Coastline.IsValid())
+	{
+		return MaxDistance;
+	}
+	const FCoastlineSpatialIndex& spatialIndex = Coastline->GetSpatialIndex();
+	const double distance = spatialIndex.DistanceToCoast(Point, MaxDistance);
+	return spatialIndex.IsInside(Point) ? -distance : distance;
+}
+
+SIZE_T FIslandMapSnapshot::GetAllocatedSize() const
+{
+	SIZE_T size = r_flags.GetAllocatedSize() + r_lake.GetAllocatedSize() + r_elevation.GetAllocatedSize()
+		+ r_waterdistance.GetAllocatedSize() + r_moisture.GetAllocatedSize() + r_temperature.GetAllocatedSize()
+		+ r_biome.GetAllocatedSize() + BiomePalette.GetAllocatedSize() + r_district.GetAllocatedSize()
+		+ DistrictRegions.GetAllocatedSize() + t_coastdistance.GetAllocatedSize() + t_elevation.GetAllocatedSize()
+		+ QuantizedLayers.GetAllocatedSize() + t_downslope_s.GetAllocatedSize() + t_flow.GetAllocatedSize() + s_flow.GetAllocatedSize()
+		+ spring_t.GetAllocatedSize() + river_t.GetAllocatedSize() + RiverNetwork.GetAllocatedSize()
+		+ CoastDistanceField.GetAllocatedSize();
+	for (const FDistrictRegion& districtRegion : DistrictRegions)
+	{
+		size += districtRegion.FAreaContour::GetAllocatedSize() + districtRegion.Triangles.GetAllocatedSize();
+	}
+	return size;
+}
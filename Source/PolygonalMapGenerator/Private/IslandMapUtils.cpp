@@ -16,39 +16,231 @@
 * limitations under the License.
 */
 #include "IslandMapUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/App.h"
 #include "RandomSampling/SimplexNoise.h"
-#include "DrawDebugHelpers.h"
+#include "RandomSampling/CounterRandom.h"
+#include "Algo/Sort.h"
+#include "Async/ParallelFor.h"
+#include "Components/LineBatchComponent.h"
+#include "GenerationDiagnostics.h"
 #include "IslandMap.h"
+#include "Biomes/BiomeLookupTable.h"
 #include "PolyPartitionHelper.h"
 
+namespace
+{
+	constexpr int32 FBMBatchSize = 256;
+
+	TAutoConsoleVariable<int32> CVarIslandGenerationProfile(
+		TEXT("island.GenerationProfile"),
+		0,
+		TEXT("Overrides the generation profile of every island mesh actor and dynamic assets.\n")
+		TEXT("0: use their own setting, 1: Full, 2: Headless"),
+		ECVF_Default);
+
+	/**
+	 * Octave k of FBMNoise is a fractal of k octaves at frequency 2^k, so its i-th term samples frequency 2^(k+i).
+	 * Scaling by powers of two is exact, so every term of every octave can read the same cached samples.
+	 */
+	int32 GetFBMFrequencyNum(const TArray<float>& Amplitudes)
+	{
+		return FMath::Max(2 * Amplitudes.Num() - 2, 0);
+	}
+
+	void SampleFBMFrequencies(const FVector2D& Position, float* OutSamples, const int32 FrequencyNum)
+	{
+		for (int32 Exponent = 1; Exponent < FrequencyNum; Exponent++)
+		{
+			const double Frequency = (double)(((uint64)1) << Exponent);
+			OutSamples[Exponent] = USimplexNoise::noise(Position.X * Frequency, Position.Y * Frequency);
+		}
+	}
+
+	/** Same summation order as FCustomSimplexNoise::fractal with its default parameters, so the sum rounds the same. */
+	float CombineFBMOctaves(const TArray<float>& Amplitudes, const float* Samples)
+	{
+		float sum = 0.0f;
+		float sumOfAmplitudes = 0.0f;
+		for (int32 octave = 0; octave < Amplitudes.Num(); octave++)
+		{
+			float output = 0.0f;
+			float denom = 0.0f;
+			float amplitude = 1.0f;
+			for (int32 i = 0; i < octave; i++)
+			{
+				output += amplitude * Samples[octave + i];
+				denom += amplitude;
+				amplitude *= 0.5f;
+			}
+			sum += Amplitudes[octave] * (denom == 0.0f ? 0.0f : output / denom);
+			sumOfAmplitudes += Amplitudes[octave];
+		}
+
+		if (sumOfAmplitudes == 0.0f)
+		{
+			return 0.0f;
+		}
+		return sum / sumOfAmplitudes;
+	}
+
+	constexpr int32 RadixSortChunkSize = 16384;
+	constexpr int32 RadixSortDigitBits = 8;
+	constexpr int32 RadixSortBucketNum = 1 << RadixSortDigitBits;
+
+	// Maps a float onto an unsigned key with the same order: negatives are flipped, positives get the sign bit.
+	// Both zeros share a key, they compare equal.
+	uint32 GetRadixSortKey(const float Value)
+	{
+		const float key = Value == 0.0f ? 0.0f : Value;
+		uint32 bits;
+		FMemory::Memcpy(&bits, &key, sizeof(bits));
+		return (bits & 0x80000000u) != 0 ? ~bits : bits | 0x80000000u;
+	}
+
+	// Over a few of the fields PackBiomes compares, so equal biomes always share it. The tag alone tells the rows
+	// of a biome table apart; the floats are left out, -0 and 0 compare equal but hash differently.
+	uint32 GetBiomeHash(const FBiomeData& Biome)
+	{
+		const uint32 flags = (Biome.bIsOcean ? 1u : 0u) | (Biome.bIsWater ? 2u : 0u) | (Biome.bIsCoast ? 4u : 0u);
+		return HashCombine(HashCombine(GetTypeHash(Biome.Tag), flags), GetTypeHash(Biome.BiomeMaterial));
+	}
+}
+
+bool UIslandMapUtils::IsHeadlessProfile(EIslandGenerationProfile Profile)
+{
+	const int32 Override = CVarIslandGenerationProfile.GetValueOnAnyThread();
+	if (Override == 1 || Override == 2)
+	{
+		Profile = Override == 1 ? EIslandGenerationProfile::IGP_Full : EIslandGenerationProfile::IGP_Headless;
+	}
+	if (Profile == EIslandGenerationProfile::IGP_Auto)
+	{
+		return IsRunningDedicatedServer() || !FApp::CanEverRender();
+	}
+	return Profile == EIslandGenerationProfile::IGP_Headless;
+}
+
 void UIslandMapUtils::RandomShuffle(TArray<FTriangleIndex>& OutShuffledArray, FRandomStream& Rng)
 {
-	for (int i = OutShuffledArray.Num() - 1; i > 0; i--)
+	// Order by a hash of every element, so the result depends neither on the input order nor on the thread count
+	const FCounterRandom random(Rng);
+	TArray<TPair<uint32, FTriangleIndex>> order;
+	order.SetNumUninitialized(OutShuffledArray.Num());
+	ParallelFor(OutShuffledArray.Num(), [&random, &order, &OutShuffledArray](const int32 Index)
+	{
+		const FTriangleIndex t = OutShuffledArray[Index];
+		order[Index] = TPair<uint32, FTriangleIndex>(random.GetUnsignedInt(t), t);
+	});
+	Algo::Sort(order, [](const TPair<uint32, FTriangleIndex>& A, const TPair<uint32, FTriangleIndex>& B)
+	{
+		return A.Key < B.Key || (A.Key == B.Key && A.Value < B.Value);
+	});
+	for (int32 i = 0; i < order.Num(); i++)
 	{
-		int32 j = Rng.RandRange(0, i);
-		int32 swap = OutShuffledArray[i];
-		OutShuffledArray[i] = OutShuffledArray[j];
-		OutShuffledArray[j] = swap;
+		OutShuffledArray[i] = order[i].Value;
 	}
 }
 
-float UIslandMapUtils::FBMNoise(const TArray<float>& Amplitudes, const FVector2D& Position)
+void UIslandMapUtils::SortIndicesByValue(TArray<int32>& Indices, TConstArrayView<float> Values)
 {
-	float sum = 0.0f;
-	float sumOfAmplitudes = 0.0f;
-	FCustomSimplexNoise noise;
-	for (size_t octave = 0; octave < Amplitudes.Num(); octave++)
+	TRACE_CPUPROFILER_EVENT_SCOPE(UIslandMapUtils::SortIndicesByValue)
+	const int32 num = Indices.Num();
+	if (num <= 1)
 	{
-		size_t frequency = ((size_t)1) << octave;
-		sum += Amplitudes[octave] * noise.fractal(octave, Position * frequency);
-		sumOfAmplitudes += Amplitudes[octave];
+		return;
 	}
 
-	if (sumOfAmplitudes == 0.0f)
+	TArray<uint32> keys;
+	keys.SetNumUninitialized(num);
+	ParallelFor(num, [&keys, &Indices, Values](const int32 i)
 	{
-		return 0.0f;
+		keys[i] = GetRadixSortKey(Values[Indices[i]]);
+	});
+	TArray<uint32> sortedKeys;
+	TArray<int32> sortedIndices;
+	sortedKeys.SetNumUninitialized(num);
+	sortedIndices.SetNumUninitialized(num);
+
+	// Least significant digit first. Every chunk counts its digits, then scatters into its own slice of each
+	// bucket, which keeps every pass stable no matter how the chunks are scheduled.
+	const int32 chunkNum = FMath::DivideAndRoundUp(num, RadixSortChunkSize);
+	TArray<int32> offsets;
+	offsets.SetNumUninitialized(chunkNum * RadixSortBucketNum);
+	for (int32 shift = 0; shift < 32; shift += RadixSortDigitBits)
+	{
+		ParallelFor(chunkNum, [&keys, &offsets, num, shift](const int32 chunk)
+		{
+			int32* counts = &offsets[chunk * RadixSortBucketNum];
+			FMemory::Memzero(counts, RadixSortBucketNum * sizeof(int32));
+			const int32 end = FMath::Min((chunk + 1) * RadixSortChunkSize, num);
+			for (int32 i = chunk * RadixSortChunkSize; i < end; i++)
+			{
+				counts[(keys[i] >> shift) & (RadixSortBucketNum - 1)]++;
+			}
+		});
+
+		int32 offset = 0;
+		bool bSingleBucket = false;
+		for (int32 bucket = 0; bucket < RadixSortBucketNum && !bSingleBucket; bucket++)
+		{
+			const int32 bucketBegin = offset;
+			for (int32 chunk = 0; chunk < chunkNum; chunk++)
+			{
+				const int32 count = offsets[chunk * RadixSortBucketNum + bucket];
+				offsets[chunk * RadixSortBucketNum + bucket] = offset;
+				offset += count;
+			}
+			// Smooth layers often share their top digits, those passes would not move anything
+			bSingleBucket = offset - bucketBegin == num;
+		}
+		if (bSingleBucket)
+		{
+			continue;
+		}
+
+		ParallelFor(chunkNum, [&keys, &Indices, &sortedKeys, &sortedIndices, &offsets, num, shift](const int32 chunk)
+		{
+			int32* cursors = &offsets[chunk * RadixSortBucketNum];
+			const int32 end = FMath::Min((chunk + 1) * RadixSortChunkSize, num);
+			for (int32 i = chunk * RadixSortChunkSize; i < end; i++)
+			{
+				const int32 target = cursors[(keys[i] >> shift) & (RadixSortBucketNum - 1)]++;
+				sortedKeys[target] = keys[i];
+				sortedIndices[target] = Indices[i];
+			}
+		});
+		Swap(keys, sortedKeys);
+		Swap(Indices, sortedIndices);
 	}
-	return sum / sumOfAmplitudes;
+}
+
+float UIslandMapUtils::FBMNoise(const TArray<float>& Amplitudes, const FVector2D& Position)
+{
+	const int32 frequencyNum = GetFBMFrequencyNum(Amplitudes);
+	TArray<float, TInlineAllocator<32>> samples;
+	samples.SetNumUninitialized(frequencyNum);
+	SampleFBMFrequencies(Position, samples.GetData(), frequencyNum);
+	return CombineFBMOctaves(Amplitudes, samples.GetData());
+}
+
+void UIslandMapUtils::FBMNoiseBatch(const TArray<float>& Amplitudes, TConstArrayView<FVector2D> Positions, TArrayView<float> OutNoise)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UIslandMapUtils::FBMNoiseBatch)
+	check(Positions.Num() == OutNoise.Num());
+	const int32 frequencyNum = GetFBMFrequencyNum(Amplitudes);
+	const int32 batchNum = FMath::DivideAndRoundUp(Positions.Num(), FBMBatchSize);
+	ParallelFor(batchNum, [&Amplitudes, Positions, OutNoise, frequencyNum](const int32 batch)
+	{
+		TArray<float, TInlineAllocator<32>> samples;
+		samples.SetNumUninitialized(frequencyNum);
+		const int32 end = FMath::Min((batch + 1) * FBMBatchSize, Positions.Num());
+		for (int32 i = batch * FBMBatchSize; i < end; i++)
+		{
+			SampleFBMFrequencies(Positions[i], samples.GetData(), frequencyNum);
+			OutNoise[i] = CombineFBMOctaves(Amplitudes, samples.GetData());
+		}
+	});
 }
 
 float UIslandMapUtils::Remap(float Value, ERemapType RemapType)
@@ -278,19 +470,69 @@ FBiomeData UIslandMapUtils::GetBiome(const UDataTable* BiomeData, bool bIsOcean,
 		return FBiomeData();
 	}
 
-	UE_LOG(LogMapGen, Warning, TEXT("Had %d possible candidates for temperature %f and moisture %f."),
-	       possibleBiomes.Num(), Temperature, Moisture);
+	if (!FGenerationDiagnostics::AddActive(FBiomeLookupTable::AmbiguousBiomeCategory))
+	{
+		UE_LOG(LogMapGen, Warning, TEXT("Had %d possible candidates for temperature %f and moisture %f."),
+		       possibleBiomes.Num(), Temperature, Moisture);
+	}
 
 	return possibleBiomes[0];
 }
 
+namespace
+{
+	FName GetDebugLayerComponentName(const FName Layer)
+	{
+		return FName(*FString::Printf(TEXT("IslandDebug_%s"), *Layer.ToString()));
+	}
+
+	ULineBatchComponent* FindDebugLayer(const AActor* Context, const FName Layer)
+	{
+		return Context != nullptr
+			       ? FindObjectFast<ULineBatchComponent>(const_cast<AActor*>(Context), GetDebugLayerComponentName(Layer))
+			       : nullptr;
+	}
+
+	// Replaces the lines of the layer with Lines in one upload
+	void DrawDebugLayer(AActor* Context, const FName Layer, TArrayView<FBatchedLine> Lines)
+	{
+		ULineBatchComponent* lineBatcher = FindDebugLayer(Context, Layer);
+		if (lineBatcher == nullptr)
+		{
+			lineBatcher = NewObject<ULineBatchComponent>(Context, GetDebugLayerComponentName(Layer), RF_Transient);
+			lineBatcher->RegisterComponent();
+		}
+		lineBatcher->Flush();
+		lineBatcher->DrawLines(Lines);
+	}
+}
+
+void UIslandMapUtils::SetDebugLayerVisible(AActor* Context, FName Layer, bool bVisible)
+{
+	if (ULineBatchComponent* lineBatcher = FindDebugLayer(Context, Layer))
+	{
+		lineBatcher->SetVisibility(bVisible);
+	}
+}
+
+void UIslandMapUtils::ClearDebugLayer(AActor* Context, FName Layer)
+{
+	if (ULineBatchComponent* lineBatcher = FindDebugLayer(Context, Layer))
+	{
+		lineBatcher->Flush();
+	}
+}
+
 void UIslandMapUtils::DrawDelaunayFromMap(AIslandMap* Map)
 {
 	if (Map == NULL)
 	{
 		return;
 	}
-	DrawDelaunayMesh(Map, Map->Mesh, Map->r_elevation, Map->s_flow, Map->CreatedRivers, Map->t_elevation, Map->r_biome);
+	const UIslandMapData* mapData = Map->GetMapData();
+	// The map getters expand quantized layers
+	DrawDelaunayMesh(Map, mapData->Mesh, Map->GetRegionElevations(), mapData->s_flow, Map->CreatedRivers,
+	                 Map->GetTriangleElevations(), Map->GetRegionBiomes());
 }
 
 void UIslandMapUtils::DrawVoronoiFromMap(class AIslandMap* Map)
@@ -299,7 +541,12 @@ void UIslandMapUtils::DrawVoronoiFromMap(class AIslandMap* Map)
 	{
 		return;
 	}
-	DrawVoronoiMesh(Map, Map->Mesh, Map->GetVoronoiPolygons(), Map->s_flow, Map->CreatedRivers, Map->t_elevation);
+	const UIslandMapData* mapData = Map->GetMapData();
+	DrawVoronoiView(Map, Map->GetVoronoiView(), [mapData](const FPointIndex r)
+	{
+		return mapData->BiomePalette[mapData->r_biome[r]].DebugColor;
+	}, Map->GetTriangleElevations());
+	DrawRivers(Map, mapData->Mesh, Map->CreatedRivers, mapData->s_flow, Map->GetTriangleElevations());
 }
 
 void UIslandMapUtils::DrawDelaunayMesh(AActor* Context, UTriangleDualMesh* Mesh, const TArray<float>& RegionElevations,
@@ -314,10 +561,10 @@ void UIslandMapUtils::DrawDelaunayMesh(AActor* Context, UTriangleDualMesh* Mesh,
 	FDateTime startTime = FDateTime::UtcNow();
 #endif
 
-	UWorld* world = Context->GetWorld();
 	const TArray<FSideIndex>& _halfedges = Mesh->GetHalfEdges();
 	const FDualMesh& mesh = Mesh->GetRawMesh();
-	const TArray<FVector2D>& _r_vertex = Mesh->GetPoints();
+	TArray<FBatchedLine> lines;
+	lines.Reserve(_halfedges.Num() / 2);
 
 	for (FSideIndex e = 0; e < _halfedges.Num(); e++)
 	{
@@ -331,17 +578,18 @@ void UIslandMapUtils::DrawDelaunayMesh(AActor* Context, UTriangleDualMesh* Mesh,
 				continue;
 			}
 
-			const FVector2D p = _r_vertex[first];
-			const FVector2D q = _r_vertex[second];
+			const FVector2D p = Mesh->r_pos(first);
+			const FVector2D q = Mesh->r_pos(second);
 			float pZCoord = RegionElevations.IsValidIndex(first) ? RegionElevations[first] : -1000.0f;
 			float qZCoord = RegionElevations.IsValidIndex(second) ? RegionElevations[second] : -1000.0f;
 			FVector pVector = FVector(p.X, p.Y, pZCoord * 10000);
 			FVector qVector = FVector(q.X, q.Y, qZCoord * 10000);
 			FLinearColor color = FMath::Lerp(RegionBiomes[first].DebugColor.ReinterpretAsLinear(),
 			                                 RegionBiomes[second].DebugColor.ReinterpretAsLinear(), 0.5f);
-			DrawDebugLine(world, pVector, qVector, color.ToFColor(false), false, 999.0f);
+			lines.Emplace(pVector, qVector, FLinearColor(color.ToFColor(false)), 0.0f, 0.0f, SDPG_World);
 		}
 	}
+	DrawDebugLayer(Context, TEXT("Delaunay"), lines);
 
 #if !UE_BUILD_SHIPPING
 	FDateTime finishedTime = FDateTime::UtcNow();
@@ -364,19 +612,18 @@ void UIslandMapUtils::DrawVoronoiMesh(AActor* Context, UTriangleDualMesh* Mesh,
 	FDateTime startTime = FDateTime::UtcNow();
 #endif
 
-	UWorld* world = Context->GetWorld();
+	TArray<FBatchedLine> lines;
 	for (int i = 0; i < Polygons.Num(); i++)
 	{
 		const FIslandPolygon& polygon = Polygons[i];
 		for (int j = 0; j < polygon.VertexPoints.Num(); j++)
 		{
-			FVector point = polygon.VertexPoints[j];
-			FTriangleIndex first = polygon.Vertices[j];
-			FVector next = polygon.VertexPoints[(j + 1) % Polygons.Num()];
-			FTriangleIndex second = polygon.Vertices[(j + 1) % Polygons.Num()];
-			DrawDebugLine(world, point, next, polygon.Biome.DebugColor, false, 999.0f);
+			const FVector& point = polygon.VertexPoints[j];
+			const FVector& next = polygon.VertexPoints[(j + 1) % polygon.VertexPoints.Num()];
+			lines.Emplace(point, next, FLinearColor(polygon.Biome.DebugColor), 0.0f, 0.0f, SDPG_World);
 		}
 	}
+	DrawDebugLayer(Context, TEXT("Voronoi"), lines);
 
 #if !UE_BUILD_SHIPPING
 	FDateTime finishedTime = FDateTime::UtcNow();
@@ -387,6 +634,36 @@ void UIslandMapUtils::DrawVoronoiMesh(AActor* Context, UTriangleDualMesh* Mesh,
 	DrawRivers(Context, Mesh, Rivers, SideFlow, TriangleElevations);
 }
 
+void UIslandMapUtils::DrawVoronoiView(AActor* Context, const FIslandVoronoiView& Voronoi,
+                                      TFunctionRef<FColor(FPointIndex)> RegionColor,
+                                      const TArray<float>& TriangleElevations)
+{
+	if (Context == NULL || Voronoi.IsEmpty())
+	{
+		return;
+	}
+	TRACE_CPUPROFILER_EVENT_SCOPE(UIslandMapUtils::DrawVoronoiView)
+
+	TArray<FBatchedLine> lines;
+	auto cornerPoint = [&Voronoi, &TriangleElevations](const FTriangleIndex t)
+	{
+		const FVector2D point2D = Voronoi.GetCornerPosition(t);
+		const float z = TriangleElevations.IsValidIndex(t) ? TriangleElevations[t] : -1000.0f;
+		return FVector(point2D.X, point2D.Y, z * 10000);
+	};
+	for (FPointIndex r = 0; r < Voronoi.Num(); r++)
+	{
+		const TArrayView<const FTriangleIndex> corners = Voronoi.GetCorners(r);
+		const FLinearColor color = RegionColor(r);
+		for (int32 j = 0; j < corners.Num(); j++)
+		{
+			lines.Emplace(cornerPoint(corners[j]), cornerPoint(corners[(j + 1) % corners.Num()]), color, 0.0f, 0.0f,
+			              SDPG_World);
+		}
+	}
+	DrawDebugLayer(Context, TEXT("Voronoi"), lines);
+}
+
 void UIslandMapUtils::DrawRivers(AActor* Context, UTriangleDualMesh* Mesh, const TArray<URiver*>& Rivers,
                                  const TArray<int32>& SideFlow, const TArray<float>& TriangleElevations)
 {
@@ -399,15 +676,17 @@ void UIslandMapUtils::DrawRivers(AActor* Context, UTriangleDualMesh* Mesh, const
 	FDateTime startTime = FDateTime::UtcNow();
 #endif
 
-	UWorld* world = Context->GetWorld();
+	TArray<FBatchedLine> lines;
 	for (URiver* river : Rivers)
 	{
-		if (river->RiverTriangles.Num() <= 1)
+		if (river->RiverTriangles.Num() <= 1 && river->FeedsInto == NULL)
 		{
 			UE_LOG(LogMapGen, Warning, TEXT("Created a very short river!"));
 			continue;
 		}
-		for (int i = 0; i < river->RiverTriangles.Num() - 1; i++)
+		// Tributaries also draw the step onto the river they join
+		const int32 lineNum = river->FeedsInto != NULL ? river->RiverTriangles.Num() : river->RiverTriangles.Num() - 1;
+		for (int i = 0; i < lineNum; i++)
 		{
 			FTriangleIndex t1 = river->RiverTriangles[i];
 			int32 flow = SideFlow[river->Downslopes[i]];
@@ -416,14 +695,15 @@ void UIslandMapUtils::DrawRivers(AActor* Context, UTriangleDualMesh* Mesh, const
 			float z1 = TriangleElevations.IsValidIndex(t1) ? TriangleElevations[t1] : -1000.0f;
 			FVector first3D = FVector(first2D.X, first2D.Y, z1 * 10000);
 
-			FTriangleIndex t2 = river->RiverTriangles[i + 1];
+			FTriangleIndex t2 = i + 1 < river->RiverTriangles.Num() ? river->RiverTriangles[i + 1] : Mesh->s_outer_t(river->Downslopes[i]);
 			FVector2D second2D = Mesh->t_pos(t2);
 			float z2 = TriangleElevations.IsValidIndex(t2) ? TriangleElevations[t2] : -1000.0f;
 			FVector second3D = FVector(second2D.X, second2D.Y, z2 * 10000);
 
-			DrawDebugLine(world, first3D, second3D, FColor::Blue, false, 999.0f, (uint8)'\000', 100.0f * flow);
+			lines.Emplace(first3D, second3D, FLinearColor::Blue, 0.0f, 100.0f * flow, SDPG_World);
 		}
 	}
+	DrawDebugLayer(Context, TEXT("Rivers"), lines);
 
 #if !UE_BUILD_SHIPPING
 	FDateTime finishedTime = FDateTime::UtcNow();
@@ -438,7 +718,9 @@ void UIslandMapUtils::GenerateMesh(class AIslandMap* Map, UProceduralMeshCompone
 	{
 		return;
 	}
-	GenerateMapMeshMultiMaterial(Map->Mesh, MapMesh, ZScale, Map->r_elevation, Map->r_coast, Map->r_biome);
+	const UIslandMapData* mapData = Map->GetMapData();
+	GenerateMapMeshMultiMaterialIndexed(mapData->Mesh, MapMesh, ZScale, Map->GetRegionElevations(), mapData->GetCoastalRegions(),
+	                                    mapData->r_biome, mapData->BiomePalette);
 }
 
 void UIslandMapUtils::GenerateMapMeshSingleMaterial(UTriangleDualMesh* Mesh, UProceduralMeshComponent* MapMesh,
@@ -448,12 +730,11 @@ void UIslandMapUtils::GenerateMapMeshSingleMaterial(UTriangleDualMesh* Mesh, UPr
 	{
 		return;
 	}
-	const TArray<FVector2D>& points = Mesh->GetPoints();
 	const FDualMesh& rawMesh = Mesh->GetRawMesh();
 
 	FMapMeshData meshData;
 
-	meshData.Vertices.SetNumZeroed(points.Num());
+	meshData.Vertices.SetNumZeroed(Mesh->NumRegions);
 	meshData.VertexColors.SetNum(meshData.Vertices.Num());
 	meshData.Triangles.SetNumZeroed(rawMesh.DelaunayTriangles.Num());
 	meshData.Normals.SetNumZeroed(meshData.Triangles.Num());
@@ -463,13 +744,14 @@ void UIslandMapUtils::GenerateMapMeshSingleMaterial(UTriangleDualMesh* Mesh, UPr
 	for (FPointIndex r = 0; r < meshData.Vertices.Num(); r++)
 	{
 		float z = Mesh->r_ghost(r) ? -10 * ZScale : RegionElevation[r] * ZScale;
-		meshData.Vertices[r] = FVector(points[r].X, points[r].Y, z);
+		const FVector2D point = Mesh->r_pos(r);
+		meshData.Vertices[r] = FVector(point.X, point.Y, z);
 		meshData.VertexColors[r] = FLinearColor(0.75, 0.75, 0.75, 1.0);
 	}
 	for (FTriangleIndex t = 0; t < meshData.Triangles.Num(); t++)
 	{
 		meshData.Triangles[t] = (int32)rawMesh.DelaunayTriangles[t];
-		FDelaunayTriangle triangle = UDelaunayHelper::ConvertTriangleIDToTriangle(rawMesh, t);
+		FDelaunayTriangle triangle = Mesh->t_triangle(UTriangleDualMesh::s_to_t(FSideIndex(t)));
 		FVector a = FVector(triangle.A.X, triangle.A.Y, RegionElevation[triangle.AIndex]);
 		FVector b = FVector(triangle.B.X, triangle.B.Y, RegionElevation[triangle.BIndex]);
 		FVector c = FVector(triangle.C.X, triangle.C.Y, RegionElevation[triangle.CIndex]);
@@ -488,137 +770,532 @@ void UIslandMapUtils::GenerateMapMeshSingleMaterial(UTriangleDualMesh* Mesh, UPr
 void UIslandMapUtils::GenerateMapMeshMultiMaterial(UTriangleDualMesh* Mesh, UProceduralMeshComponent* MapMesh,
                                                    float ZScale, const TArray<float>& RegionElevation,
                                                    const TArray<bool>& CostalRegions,
-                                                   const TArray<FBiomeData> RegionBiomes)
+                                                   const TArray<FBiomeData>& RegionBiomes)
 {
-	if (Mesh == NULL || MapMesh == NULL)
+	TArray<uint8> biomeIndices;
+	TArray<FBiomeData> palette;
+	PackBiomes(RegionBiomes, biomeIndices, palette);
+	GenerateMapMeshMultiMaterialIndexed(Mesh, MapMesh, ZScale, RegionElevation, CostalRegions, biomeIndices, palette);
+}
+
+void UIslandMapUtils::GenerateMapMeshMultiMaterialIndexed(UTriangleDualMesh* Mesh, UProceduralMeshComponent* MapMesh,
+                                                          float ZScale, const TArray<float>& RegionElevation,
+                                                          const TArray<bool>& CostalRegions,
+                                                          const TArray<uint8>& RegionBiomes,
+                                                          const TArray<FBiomeData>& BiomePalette)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UIslandMapUtils::GenerateMapMeshMultiMaterialIndexed)
+	if (Mesh == NULL || MapMesh == NULL || BiomePalette.IsEmpty())
 	{
 		return;
 	}
-	const TArray<FVector2D>& points = Mesh->GetPoints();
 	const FDualMesh& rawMesh = Mesh->GetRawMesh();
+	const int32 numTriangles = rawMesh.DelaunayTriangles.Num() / 3;
 
-	TMap<FName, FMapMeshData> meshLookup;
-	TMap<FName, UMaterialInterface*> materialLookup;
+	auto tag = [&RegionBiomes, &BiomePalette](FPointIndex r) -> const FName&
+	{
+		return BiomePalette[RegionBiomes[r]].Tag;
+	};
 
-	for (FTriangleIndex t = 0; t < rawMesh.DelaunayTriangles.Num(); t += 3)
+	// Determine which biome to use for every triangle
+	// If we're on the boundary, use the boundary biome
+	// If we're part coast, use the coast biome (this prevents jagged triangles along the water)
+	// If 2+ points use the same biome, make the whole triangle that biome
+	// Otherwise, just use point A's biome
+	TArray<uint8> triangleBiomes;
+	triangleBiomes.SetNumUninitialized(numTriangles);
+	ParallelFor(numTriangles, [&](const int32 t)
 	{
-		// Get triangle
-		FDelaunayTriangle triangle = UDelaunayHelper::ConvertTriangleIDToTriangle(rawMesh, t);
-		// Determine which biome to use
-		// If we're on the boundary, use the boundary biome
-		// If we're part coast, use the coast biome (this prevents jagged triangles along the water)
-		// If 2+ points use the same biome, make the whole triangle that biome
-		// Otherwise, just use point A's biome
-		FBiomeData biome;
-		if (Mesh->r_boundary(triangle.AIndex))
+		const FPointIndex aIndex = rawMesh.DelaunayTriangles[t * 3];
+		const FPointIndex bIndex = rawMesh.DelaunayTriangles[t * 3 + 1];
+		const FPointIndex cIndex = rawMesh.DelaunayTriangles[t * 3 + 2];
+		FPointIndex biomeRegion = aIndex;
+		if (Mesh->r_boundary(aIndex))
 		{
-			biome = RegionBiomes[triangle.AIndex];
+			biomeRegion = aIndex;
 		}
-		else if (Mesh->r_boundary(triangle.BIndex))
+		else if (Mesh->r_boundary(bIndex))
 		{
-			biome = RegionBiomes[triangle.BIndex];
+			biomeRegion = bIndex;
 		}
-		else if (Mesh->r_boundary(triangle.CIndex))
+		else if (Mesh->r_boundary(cIndex))
 		{
-			biome = RegionBiomes[triangle.CIndex];
+			biomeRegion = cIndex;
 		}
-		else if (CostalRegions[triangle.AIndex])
+		else if (CostalRegions[aIndex])
 		{
 			// Coastal regions get handled after boundary regions
 			// This way, the boundary remains the same no matter what
-			biome = RegionBiomes[triangle.AIndex];
+			biomeRegion = aIndex;
 		}
-		else if (CostalRegions[triangle.BIndex])
+		else if (CostalRegions[bIndex])
 		{
-			biome = RegionBiomes[triangle.BIndex];
+			biomeRegion = bIndex;
 		}
-		else if (CostalRegions[triangle.CIndex])
+		else if (CostalRegions[cIndex])
 		{
-			biome = RegionBiomes[triangle.CIndex];
+			biomeRegion = cIndex;
 		}
-		else if (RegionBiomes[triangle.AIndex].Tag == RegionBiomes[triangle.BIndex].Tag)
+		else if (tag(aIndex) == tag(bIndex))
 		{
 			// Finally, handle it based on biomes
-			biome = RegionBiomes[triangle.AIndex];
+			biomeRegion = aIndex;
 		}
-		else if (RegionBiomes[triangle.BIndex].Tag == RegionBiomes[triangle.CIndex].Tag)
+		else if (tag(bIndex) == tag(cIndex))
 		{
-			biome = RegionBiomes[triangle.BIndex];
+			biomeRegion = bIndex;
 		}
-		else if (RegionBiomes[triangle.CIndex].Tag == RegionBiomes[triangle.AIndex].Tag)
+		else if (tag(cIndex) == tag(aIndex))
 		{
-			biome = RegionBiomes[triangle.CIndex];
+			biomeRegion = cIndex;
 		}
-		else
+		triangleBiomes[t] = RegionBiomes[biomeRegion];
+	});
+
+	// Palette entries sharing a tag share a mesh section, sections are numbered in the order they are first used.
+	// Every triangle gets its slot in its section, so the sections can be filled in parallel afterwards.
+	TArray<FProcMeshSection> sections;
+	TArray<UMaterialInterface*> sectionMaterials;
+	TArray<int32> sectionTriangleNum;
+	TMap<FName, int32> tagSections;
+	TArray<int32> paletteSections;
+	paletteSections.Init(INDEX_NONE, BiomePalette.Num());
+	TArray<int32> triangleSections;
+	triangleSections.SetNumUninitialized(numTriangles);
+	TArray<int32> triangleSlots;
+	triangleSlots.SetNumUninitialized(numTriangles);
+	for (int32 t = 0; t < numTriangles; t++)
+	{
+		int32& section = paletteSections[triangleBiomes[t]];
+		if (section == INDEX_NONE)
+		{
+			const FBiomeData& biomeData = BiomePalette[triangleBiomes[t]];
+			if (const int32* existing = tagSections.Find(biomeData.Tag))
+			{
+				section = *existing;
+			}
+			else
+			{
+				section = sections.AddDefaulted();
+				sectionMaterials.Add(biomeData.BiomeMaterial);
+				sectionTriangleNum.Add(0);
+				tagSections.Add(biomeData.Tag, section);
+			}
+		}
+		triangleSections[t] = section;
+		triangleSlots[t] = sectionTriangleNum[section]++;
+	}
+	for (int32 index = 0; index < sections.Num(); index++)
+	{
+		sections[index].ProcVertexBuffer.SetNumUninitialized(sectionTriangleNum[index] * 3);
+		sections[index].ProcIndexBuffer.SetNumUninitialized(sectionTriangleNum[index] * 3);
+	}
+
+	ParallelFor(numTriangles, [&](const int32 t)
+	{
+		FProcMeshSection& section = sections[triangleSections[t]];
+		const int32 firstVertex = triangleSlots[t] * 3;
+		FVector positions[3];
+		for (int32 i = 0; i < 3; i++)
+		{
+			const FPointIndex r = rawMesh.DelaunayTriangles[t * 3 + i];
+			const FVector2D point = Mesh->r_pos(r);
+			positions[i] = FVector(point.X, point.Y, Mesh->r_ghost(r) ? -10 * ZScale : RegionElevation[r] * ZScale);
+		}
+
+		// Calculate the tangents of our triangle
+		const FVector edge1 = positions[1] - positions[2];
+		const FVector edge2 = positions[0] - positions[2];
+		const FVector tangentX = edge1.GetSafeNormal();
+		const FVector tangentZ = (edge1 ^ edge2).GetSafeNormal();
+		for (int32 i = 0; i < 3; i++)
+		{
+			FProcMeshVertex& vertex = section.ProcVertexBuffer[firstVertex + i];
+			vertex = FProcMeshVertex();
+			vertex.Position = positions[i];
+			vertex.Normal = tangentZ;
+			vertex.Tangent = FProcMeshTangent(tangentX, false);
+			// Vertex colors from the original biome data
+			vertex.Color = BiomePalette[RegionBiomes[rawMesh.DelaunayTriangles[t * 3 + i]]].DebugColor;
+			vertex.UV0 = FVector2D::ZeroVector;
+			section.ProcIndexBuffer[firstVertex + i] = firstVertex + i;
+		}
+	});
+
+	// Create the actual meshes
+	ParallelFor(sections.Num(), [&sections](const int32 index)
+	{
+		FProcMeshSection& section = sections[index];
+		for (const FProcMeshVertex& vertex : section.ProcVertexBuffer)
+		{
+			section.SectionLocalBox += vertex.Position;
+		}
+		section.bEnableCollision = true;
+	});
+	for (int32 index = 0; index < sections.Num(); index++)
+	{
+		MapMesh->SetProcMeshSection(index, sections[index]);
+		// The component keeps its own copy
+		sections[index] = FProcMeshSection();
+		if (sectionMaterials[index] != NULL)
+		{
+			MapMesh->SetMaterial(index, sectionMaterials[index]);
+		}
+	}
+
+	// Enable collision data
+	MapMesh->ContainsPhysicsTriMeshData(true);
+}
+
+bool UIslandMapUtils::IsImplementedInScript(const UObject* Object, FName Function)
+{
+	return Object->GetClass()->IsFunctionImplementedInScript(Function);
+}
+
+int32 UIslandMapUtils::LabelConnectedRegions(const UTriangleDualMesh* Mesh, TFunctionRef<bool(FPointIndex)> IsMember,
+                                             TArray<int32>& OutRegionLabels)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UIslandMapUtils::LabelConnectedRegions)
+	check(Mesh != nullptr);
+	const int32 numRegions = Mesh->NumRegions;
+
+	// Union-find forest over the members, INDEX_NONE for everything else.
+	// Roots are only ever linked below smaller roots, so every root ends up as the lowest region of its group
+	// no matter in which order the threads merge.
+	TArray<int32> parent;
+	parent.SetNumUninitialized(numRegions);
+	ParallelFor(numRegions, [&parent, &IsMember](const int32 r)
+	{
+		parent[r] = IsMember(r) ? r : INDEX_NONE;
+	});
+
+	// Path halving: every visited region skips to its grandparent. Parents only ever move to smaller regions of the
+	// same group, so a failed exchange just means another thread shortened the path first.
+	auto findRoot = [&parent](int32 r)
+	{
+		int32 next = FPlatformAtomics::AtomicRead(&parent[r]);
+		while (next != r)
+		{
+			const int32 grandparent = FPlatformAtomics::AtomicRead(&parent[next]);
+			if (grandparent == next)
+			{
+				return next;
+			}
+			FPlatformAtomics::InterlockedCompareExchange(&parent[r], grandparent, next);
+			r = grandparent;
+			next = FPlatformAtomics::AtomicRead(&parent[r]);
+		}
+		return r;
+	};
+
+	ParallelFor(Mesh->NumSides, [Mesh, &parent, &findRoot](const int32 side)
+	{
+		const FSideIndex s = side;
+		// Each pair of half-edges only needs to be merged once
+		const FSideIndex opposite = Mesh->s_opposite_s(s);
+		if (opposite.IsValid() && opposite < s)
+		{
+			return;
+		}
+		const FPointIndex r1 = Mesh->s_begin_r(s);
+		const FPointIndex r2 = Mesh->s_end_r(s);
+		if (!r1.IsValid() || !r2.IsValid() || FPlatformAtomics::AtomicRead(&parent[r1]) == INDEX_NONE
+			|| FPlatformAtomics::AtomicRead(&parent[r2]) == INDEX_NONE)
+		{
+			return;
+		}
+		int32 a = r1;
+		int32 b = r2;
+		while (true)
 		{
-			biome = RegionBiomes[triangle.AIndex];
+			a = findRoot(a);
+			b = findRoot(b);
+			if (a == b)
+			{
+				return;
+			}
+			if (a < b)
+			{
+				Swap(a, b);
+			}
+			// Fails if another thread linked a in the meantime, then retry from the new roots
+			if (FPlatformAtomics::InterlockedCompareExchange(&parent[a], b, a) == a)
+			{
+				return;
+			}
 		}
+	});
 
-		// Grab mesh info from the biome
-		FMapMeshData meshData;
-		if (meshLookup.Contains(biome.Tag))
+	// Every parent is a smaller region of the same group, so one ascending pass can number and flatten them
+	OutRegionLabels.SetNumUninitialized(numRegions);
+	int32 labelNum = 0;
+	for (int32 r = 0; r < numRegions; r++)
+	{
+		if (parent[r] == INDEX_NONE)
 		{
-			meshData = meshLookup[biome.Tag];
+			OutRegionLabels[r] = INDEX_NONE;
+		}
+		else if (parent[r] == r)
+		{
+			OutRegionLabels[r] = labelNum++;
 		}
 		else
 		{
-			materialLookup.Add(biome.Tag, biome.BiomeMaterial);
-			meshLookup.Add(biome.Tag, meshData);
+			OutRegionLabels[r] = OutRegionLabels[parent[r]];
 		}
+	}
+	return labelNum;
+}
+
+void UIslandMapUtils::PackRegionFlags(const UTriangleDualMesh* Mesh, const TArray<bool>& RegionWater,
+                                      const TArray<bool>& RegionOcean, const TArray<bool>& RegionCoast,
+                                      TArray<ERegionFlags>& OutRegionFlags)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UIslandMapUtils::PackRegionFlags)
+	check(Mesh != nullptr);
+	check(RegionWater.Num() == Mesh->NumRegions && RegionOcean.Num() == Mesh->NumRegions);
+	const bool bHasCoast = RegionCoast.Num() == Mesh->NumRegions;
+	OutRegionFlags.SetNumUninitialized(Mesh->NumRegions);
+	for (FPointIndex r = 0; r < OutRegionFlags.Num(); r++)
+	{
+		ERegionFlags flags = ERegionFlags::None;
+		flags |= RegionWater[r] ? ERegionFlags::Water : ERegionFlags::None;
+		flags |= RegionOcean[r] ? ERegionFlags::Ocean : ERegionFlags::None;
+		flags |= RegionWater[r] && !RegionOcean[r] ? ERegionFlags::Lake : ERegionFlags::None;
+		flags |= bHasCoast && RegionCoast[r] ? ERegionFlags::Coast : ERegionFlags::None;
+		flags |= Mesh->r_boundary(r) ? ERegionFlags::Boundary : ERegionFlags::None;
+		OutRegionFlags[r] = flags;
+	}
+}
 
-		// Create points
-		float aZ = Mesh->r_ghost(triangle.AIndex) ? -10 * ZScale : RegionElevation[triangle.AIndex] * ZScale;
-		float bZ = Mesh->r_ghost(triangle.BIndex) ? -10 * ZScale : RegionElevation[triangle.BIndex] * ZScale;
-		float cZ = Mesh->r_ghost(triangle.CIndex) ? -10 * ZScale : RegionElevation[triangle.CIndex] * ZScale;
-		FVector a = FVector(triangle.A.X, triangle.A.Y, aZ);
-		FVector b = FVector(triangle.B.X, triangle.B.Y, bZ);
-		FVector c = FVector(triangle.C.X, triangle.C.Y, cZ);
+void UIslandMapUtils::UnpackRegionFlags(TConstArrayView<ERegionFlags> RegionFlags, ERegionFlags Flag,
+                                        TArray<bool>& OutRegions)
+{
+	OutRegions.SetNumUninitialized(RegionFlags.Num());
+	for (int32 r = 0; r < RegionFlags.Num(); r++)
+	{
+		OutRegions[r] = EnumHasAllFlags(RegionFlags[r], Flag);
+	}
+}
 
-		// Add to triangle
-		meshData.Triangles.Add(meshData.Vertices.Add(a));
-		meshData.Triangles.Add(meshData.Vertices.Add(b));
-		meshData.Triangles.Add(meshData.Vertices.Add(c));
+void UIslandMapUtils::PackBiomes(const TArray<FBiomeData>& RegionBiomes, TArray<uint8>& OutRegionBiomes,
+                                 TArray<FBiomeData>& OutBiomePalette)
+{
+	OutRegionBiomes.Empty(RegionBiomes.Num());
+	OutRegionBiomes.SetNumZeroed(RegionBiomes.Num());
+	OutBiomePalette.Empty();
+	OutBiomePalette.AddDefaulted();
 
-		// Calculate the tangents of our triangle
-		const FVector edge1 = b - c;
-		const FVector edge2 = a - c;
-		const FVector tangentX = edge1.GetSafeNormal();
-		FVector tangentZ = (edge1 ^ edge2).GetSafeNormal();
-		for (uint8 i = 0; i < 3; i++)
+	// Palette entries by biome hash, only biomes sharing a hash are compared field by field
+	UScriptStruct* biomeStruct = FBiomeData::StaticStruct();
+	TMultiMap<uint32, int32> paletteByHash;
+	paletteByHash.Add(GetBiomeHash(OutBiomePalette[0]), 0);
+	TArray<int32, TInlineAllocator<4>> candidates;
+	bool bPaletteFull = false;
+	for (int32 r = 0; r < RegionBiomes.Num(); r++)
+	{
+		const uint32 hash = GetBiomeHash(RegionBiomes[r]);
+		candidates.Reset();
+		paletteByHash.MultiFind(hash, candidates);
+		int32 index = INDEX_NONE;
+		for (const int32 candidate : candidates)
+		{
+			if (biomeStruct->CompareScriptStruct(&OutBiomePalette[candidate], &RegionBiomes[r], PPF_None))
+			{
+				index = candidate;
+				break;
+			}
+		}
+		if (index == INDEX_NONE)
 		{
-			meshData.Tangents.Add(FProcMeshTangent(tangentX, false));
-			meshData.Normals.Add(tangentZ);
-			meshData.UV0.Add(FVector2D::ZeroVector);
+			if (OutBiomePalette.Num() > TNumericLimits<uint8>::Max())
+			{
+				bPaletteFull = true;
+				continue;
+			}
+			index = OutBiomePalette.Add(RegionBiomes[r]);
+			paletteByHash.Add(hash, index);
 		}
+		OutRegionBiomes[r] = static_cast<uint8>(index);
+	}
+	if (bPaletteFull)
+	{
+		UE_LOG(LogMapGen, Error, TEXT("More than %d distinct biomes, the rest was replaced by the default biome!"),
+		       TNumericLimits<uint8>::Max() + 1);
+	}
+}
 
-		// Vertex colors from the original biome data
-		meshData.VertexColors.Add(RegionBiomes[triangle.AIndex].DebugColor.ReinterpretAsLinear());
-		meshData.VertexColors.Add(RegionBiomes[triangle.BIndex].DebugColor.ReinterpretAsLinear());
-		meshData.VertexColors.Add(RegionBiomes[triangle.CIndex].DebugColor.ReinterpretAsLinear());
+void UIslandMapUtils::ExtractBoundaryLoops(TArray<FRegionEdge>& Edges, TArray<int32>& OutLoopOffsets,
+                                           TArray<int32>& OutLoopEdges, const int32 MaxLoopNum)
+{
+	// If several edges end in the same triangle the last one is linked, the others start no loop of their own
+	TMap<FTriangleIndex, int32> endingEdges;
+	endingEdges.Reserve(Edges.Num());
+	for (int32 edge = 0; edge < Edges.Num(); edge++)
+	{
+		Edges[edge].Next = INDEX_NONE;
+		endingEdges.Add(Edges[edge].BIndex, edge);
+	}
+	for (int32 edge = 0; edge < Edges.Num(); edge++)
+	{
+		const int32* previous = endingEdges.Find(Edges[edge].AIndex);
+		if (previous != nullptr && Edges[*previous].Next == INDEX_NONE)
+		{
+			Edges[*previous].Next = edge;
+		}
+	}
 
-		// Update the map with the latest version of the mesh
-		meshLookup[biome.Tag] = meshData;
+	OutLoopOffsets.Reset();
+	OutLoopOffsets.Add(0);
+	OutLoopEdges.Reset(Edges.Num());
+	TBitArray<> visited(false, Edges.Num());
+	for (int32 first = 0; first < Edges.Num() && OutLoopOffsets.Num() <= MaxLoopNum; first++)
+	{
+		if (visited[first])
+		{
+			continue;
+		}
+		int32 edge = first;
+		do
+		{
+			visited[edge] = true;
+			OutLoopEdges.Add(edge);
+			edge = Edges[edge].Next;
+		}
+		while (edge != first && edge != INDEX_NONE && !visited[edge]);
+		if (edge != first)
+		{
+			UE_LOG(LogMapGen, Warning, TEXT("Boundary loop starting at triangle %d is not closed."),
+			       static_cast<int32>(Edges[first].AIndex));
+		}
+		OutLoopOffsets.Add(OutLoopEdges.Num());
 	}
+}
 
-	// Create the actual meshes
-	uint8 index = 0;
-	for (auto kvp : meshLookup)
+void UIslandMapUtils::BuildRegionFans(const UTriangleDualMesh* Mesh, TFunctionRef<bool(FPointIndex)> IsIncluded,
+                                      TArray<FTriangleIndex>& OutVertexTriangles, TArray<FIntVector>& OutTriangles,
+                                      TArray<int32>& OutTriangleVertices)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UIslandMapUtils::BuildRegionFans)
+	check(Mesh != nullptr);
+	const int32 numRegions = Mesh->NumSolidRegions;
+	auto getFan = [Mesh](const int32 r, TArray<FTriangleIndex, TInlineAllocator<16>>& outTriangles)
+	{
+		outTriangles.Reset();
+		Mesh->r_circulate_t(r, [&outTriangles](const FTriangleIndex t)
+		{
+			outTriangles.Add(t);
+		});
+	};
+
+	// Every triangle goes to the lowest region whose fan uses it, then the counts of every region are summed up
+	// into offsets so all regions can write their share at once
+	TArray<int32> owners;
+	owners.Init(MAX_int32, Mesh->NumTriangles);
+	TArray<int32> vertexOffsets;
+	TArray<int32> triangleOffsets;
+	vertexOffsets.SetNumZeroed(numRegions + 1);
+	triangleOffsets.SetNumZeroed(numRegions + 1);
+	ParallelFor(numRegions, [&](const int32 r)
+	{
+		if (!IsIncluded(r))
+		{
+			return;
+		}
+		TArray<FTriangleIndex, TInlineAllocator<16>> fan;
+		getFan(r, fan);
+		if (fan.Num() < 3)
+		{
+			return;
+		}
+		triangleOffsets[r + 1] = fan.Num() - 2;
+		for (const FTriangleIndex& t : fan)
+		{
+			int32 current = FPlatformAtomics::AtomicRead(&owners[t]);
+			while (r < current)
+			{
+				const int32 previous = FPlatformAtomics::InterlockedCompareExchange(&owners[t], r, current);
+				if (previous == current)
+				{
+					break;
+				}
+				current = previous;
+			}
+		}
+	});
+	ParallelFor(numRegions, [&](const int32 r)
 	{
-		FMapMeshData meshData = kvp.Value;
-		MapMesh->CreateMeshSection_LinearColor(index, meshData.Vertices, meshData.Triangles, meshData.Normals,
-		                                       meshData.UV0, meshData.VertexColors, meshData.Tangents, true);
-		if (materialLookup.Contains(kvp.Key) && materialLookup[kvp.Key] != NULL)
+		if (triangleOffsets[r + 1] == 0)
 		{
-			MapMesh->SetMaterial(index, materialLookup[kvp.Key]);
+			return;
 		}
-		index++;
+		TArray<FTriangleIndex, TInlineAllocator<16>> fan;
+		getFan(r, fan);
+		for (int32 index = 0; index < fan.Num(); index++)
+		{
+			if (owners[fan[index]] == r && fan.Find(fan[index]) == index)
+			{
+				vertexOffsets[r + 1]++;
+			}
+		}
+	});
+	for (int32 r = 0; r < numRegions; r++)
+	{
+		vertexOffsets[r + 1] += vertexOffsets[r];
+		triangleOffsets[r + 1] += triangleOffsets[r];
 	}
 
-	// Enable collision data
-	MapMesh->ContainsPhysicsTriMeshData(true);
+	OutTriangleVertices.Init(INDEX_NONE, Mesh->NumTriangles);
+	OutVertexTriangles.SetNumUninitialized(vertexOffsets[numRegions]);
+	ParallelFor(numRegions, [&](const int32 r)
+	{
+		int32 vertex = vertexOffsets[r];
+		if (vertex == vertexOffsets[r + 1])
+		{
+			return;
+		}
+		Mesh->r_circulate_t(r, [&](const FTriangleIndex t)
+		{
+			if (owners[t] == r && OutTriangleVertices[t] == INDEX_NONE)
+			{
+				OutVertexTriangles[vertex] = t;
+				OutTriangleVertices[t] = vertex++;
+			}
+		});
+	});
+	OutTriangles.SetNumUninitialized(triangleOffsets[numRegions]);
+	ParallelFor(numRegions, [&](const int32 r)
+	{
+		int32 triangle = triangleOffsets[r];
+		if (triangle == triangleOffsets[r + 1])
+		{
+			return;
+		}
+		TArray<FTriangleIndex, TInlineAllocator<16>> fan;
+		getFan(r, fan);
+		const int32 firstVertex = OutTriangleVertices[fan[0]];
+		for (int32 index = 2; index < fan.Num(); index++)
+		{
+			OutTriangles[triangle++] = FIntVector(OutTriangleVertices[fan[index]], OutTriangleVertices[fan[index - 1]],
+			                                      firstVertex);
+		}
+	});
+}
+
+void UIslandMapUtils::FillContour(FAreaContour& OutContour, const TArray<FRegionEdge>& Edges,
+                                  TConstArrayView<int32> LoopEdges)
+{
+	OutContour.Indices.Reset(LoopEdges.Num());
+	OutContour.Positions.Reset(LoopEdges.Num());
+	for (const int32 edge : LoopEdges)
+	{
+		OutContour.Indices.Add(Edges[edge].AIndex);
+		OutContour.Positions.Add(Edges[edge].APosition);
+	}
 }
 
-void UIslandMapUtils::TriangulateContour(const FAreaContour& Contour, TArray<FPolyTriangle2D>& Triangles)
+void UIslandMapUtils::TriangulateContour(const FAreaContour& Contour, TArray<FPolyTriangle2D>& Triangles,
+                                         const EPolyTriangulationMethod Method)
 {
 	TArray<int32> Indices;
 	Indices.Empty(Contour.Indices.Num());
@@ -626,7 +1303,236 @@ void UIslandMapUtils::TriangulateContour(const FAreaContour& Contour, TArray<FPo
 	{
 		Indices.Add(Index);
 	}
-	UPolyPartitionHelper::Triangulate(Contour.Positions, Indices, Triangles);
+	UPolyPartitionHelper::Triangulate(Contour.Positions, Indices, Triangles, Method);
+}
+
+namespace
+{
+	double SegmentDistanceSquared(const FVector2D& Point, const FVector2D& A, const FVector2D& B)
+	{
+		const FVector2D Edge = B - A;
+		const double LengthSquared = Edge.SizeSquared();
+		const double T = LengthSquared > 0. ? FMath::Clamp((Point - A).Dot(Edge) / LengthSquared, 0., 1.) : 0.;
+		return FVector2D::DistSquared(Point, A + Edge * T);
+	}
+
+	// Farthest vertex strictly between Begin and End, which may wrap past the end of the loop
+	double FindFarthestVertex(const TArray<FVector2D>& Positions, const int32 Begin, const int32 End,
+	                          int32& OutFarthest)
+	{
+		const int32 Num = Positions.Num();
+		const FVector2D& A = Positions[Begin % Num];
+		const FVector2D& B = Positions[End % Num];
+		double MaxDistanceSquared = -1.;
+		OutFarthest = INDEX_NONE;
+		for (int32 Index = Begin + 1; Index < End; ++Index)
+		{
+			const double DistanceSquared = SegmentDistanceSquared(Positions[Index % Num], A, B);
+			if (DistanceSquared > MaxDistanceSquared)
+			{
+				MaxDistanceSquared = DistanceSquared;
+				OutFarthest = Index;
+			}
+		}
+		return MaxDistanceSquared;
+	}
+
+	bool IsOnSegment(const FVector2D& Point, const FVector2D& A, const FVector2D& B)
+	{
+		return Point.X >= FMath::Min(A.X, B.X) && Point.X <= FMath::Max(A.X, B.X)
+			&& Point.Y >= FMath::Min(A.Y, B.Y) && Point.Y <= FMath::Max(A.Y, B.Y);
+	}
+
+	// Touching counts as crossing, shared end points are filtered by the caller
+	bool SegmentsIntersect(const FVector2D& P1, const FVector2D& P2, const FVector2D& Q1, const FVector2D& Q2)
+	{
+		const double D1 = FVector2D::CrossProduct(Q2 - Q1, P1 - Q1);
+		const double D2 = FVector2D::CrossProduct(Q2 - Q1, P2 - Q1);
+		const double D3 = FVector2D::CrossProduct(P2 - P1, Q1 - P1);
+		const double D4 = FVector2D::CrossProduct(P2 - P1, Q2 - P1);
+		if (((D1 > 0. && D2 < 0.) || (D1 < 0. && D2 > 0.)) && ((D3 > 0. && D4 < 0.) || (D3 < 0. && D4 > 0.)))
+		{
+			return true;
+		}
+		return (D1 == 0. && IsOnSegment(P1, Q1, Q2)) || (D2 == 0. && IsOnSegment(P2, Q1, Q2))
+			|| (D3 == 0. && IsOnSegment(Q1, P1, P2)) || (D4 == 0. && IsOnSegment(Q2, P1, P2));
+	}
+
+	struct FSimplifiedEdge
+	{
+		int32 Contour;
+		// Vertices of the source contour, End may be past its last vertex when the edge closes the loop
+		int32 Begin;
+		int32 End;
+		FBox2D Bounds;
+	};
+}
+
+void UIslandMapUtils::SimplifyContours(TConstArrayView<const FAreaContour*> Contours, const double Tolerance,
+                                       TArray<FAreaContour>& OutContours)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UIslandMapUtils::SimplifyContours)
+	const int32 ContourNum = Contours.Num();
+	TArray<TBitArray<>> Kept;
+	Kept.SetNum(ContourNum);
+	const double ToleranceSquared = Tolerance * Tolerance;
+	ParallelFor(ContourNum, [&](const int32 ContourIndex)
+	{
+		const TArray<FVector2D>& Positions = Contours[ContourIndex]->Positions;
+		const int32 Num = Positions.Num();
+		TBitArray<>& ContourKept = Kept[ContourIndex];
+		ContourKept.Init(Num <= 3, Num);
+		if (Num <= 3)
+		{
+			return;
+		}
+		// The first vertex and the one farthest from it split the loop into two open polylines
+		int32 Anchor = 1;
+		for (int32 Index = 2; Index < Num; ++Index)
+		{
+			if (FVector2D::DistSquared(Positions[Index], Positions[0]) > FVector2D::DistSquared(
+				Positions[Anchor], Positions[0]))
+			{
+				Anchor = Index;
+			}
+		}
+		ContourKept[0] = true;
+		ContourKept[Anchor] = true;
+		TArray<TPair<int32, int32>, TInlineAllocator<64>> Spans;
+		Spans.Emplace(0, Anchor);
+		Spans.Emplace(Anchor, Num);
+		while (!Spans.IsEmpty())
+		{
+			const TPair<int32, int32> Span = Spans.Pop(EAllowShrinking::No);
+			int32 Farthest;
+			if (FindFarthestVertex(Positions, Span.Key, Span.Value, Farthest) > ToleranceSquared)
+			{
+				ContourKept[Farthest] = true;
+				Spans.Emplace(Span.Key, Farthest);
+				Spans.Emplace(Farthest, Span.Value);
+			}
+		}
+		// A loop of two vertices has no area, keep the vertex farthest from their segment
+		if (ContourKept.CountSetBits() < 3)
+		{
+			int32 Farthest;
+			int32 FarthestAfter;
+			const double Before = FindFarthestVertex(Positions, 0, Anchor, Farthest);
+			if (FindFarthestVertex(Positions, Anchor, Num, FarthestAfter) > Before)
+			{
+				Farthest = FarthestAfter;
+			}
+			ContourKept[Farthest % Num] = true;
+		}
+	});
+
+	// Every round splits the crossing edges at their farthest vertex, the source contours themselves never cross
+	TArray<FSimplifiedEdge> Edges;
+	TArray<int32> Order;
+	TBitArray<> Split;
+	bool bSplit = true;
+	while (bSplit)
+	{
+		bSplit = false;
+		Edges.Reset();
+		for (int32 ContourIndex = 0; ContourIndex < ContourNum; ++ContourIndex)
+		{
+			const TArray<FVector2D>& Positions = Contours[ContourIndex]->Positions;
+			const int32 Num = Positions.Num();
+			int32 First = INDEX_NONE;
+			int32 Previous = INDEX_NONE;
+			auto AddEdge = [&](const int32 Begin, const int32 End)
+			{
+				FBox2D Bounds(ForceInit);
+				Bounds += Positions[Begin % Num];
+				Bounds += Positions[End % Num];
+				Edges.Add({ContourIndex, Begin, End, Bounds});
+			};
+			for (TConstSetBitIterator<> It(Kept[ContourIndex]); It; ++It)
+			{
+				if (Previous == INDEX_NONE)
+				{
+					First = It.GetIndex();
+				}
+				else
+				{
+					AddEdge(Previous, It.GetIndex());
+				}
+				Previous = It.GetIndex();
+			}
+			if (First != INDEX_NONE && First != Previous)
+			{
+				AddEdge(Previous, First + Num);
+			}
+		}
+		Order.SetNumUninitialized(Edges.Num());
+		for (int32 Index = 0; Index < Edges.Num(); ++Index)
+		{
+			Order[Index] = Index;
+		}
+		Algo::Sort(Order, [&Edges](const int32 A, const int32 B)
+		{
+			return Edges[A].Bounds.Min.X < Edges[B].Bounds.Min.X;
+		});
+		Split.Init(false, Edges.Num());
+		for (int32 OrderIndex = 0; OrderIndex < Order.Num(); ++OrderIndex)
+		{
+			const FSimplifiedEdge& Edge = Edges[Order[OrderIndex]];
+			const TArray<FVector2D>& Positions = Contours[Edge.Contour]->Positions;
+			const int32 Num = Positions.Num();
+			for (int32 OtherIndex = OrderIndex + 1; OtherIndex < Order.Num(); ++OtherIndex)
+			{
+				const FSimplifiedEdge& Other = Edges[Order[OtherIndex]];
+				if (Other.Bounds.Min.X > Edge.Bounds.Max.X)
+				{
+					break;
+				}
+				if (Other.Bounds.Min.Y > Edge.Bounds.Max.Y || Other.Bounds.Max.Y < Edge.Bounds.Min.Y)
+				{
+					continue;
+				}
+				const TArray<FVector2D>& OtherPositions = Contours[Other.Contour]->Positions;
+				const int32 OtherNum = OtherPositions.Num();
+				if (Other.Contour == Edge.Contour && (Other.Begin % Num == Edge.End % Num
+					|| Other.End % Num == Edge.Begin % Num))
+				{
+					continue;
+				}
+				if (SegmentsIntersect(Positions[Edge.Begin % Num], Positions[Edge.End % Num],
+				                      OtherPositions[Other.Begin % OtherNum], OtherPositions[Other.End % OtherNum]))
+				{
+					Split[Order[OrderIndex]] = true;
+					Split[Order[OtherIndex]] = true;
+				}
+			}
+		}
+		for (TConstSetBitIterator<> It(Split); It; ++It)
+		{
+			const FSimplifiedEdge& Edge = Edges[It.GetIndex()];
+			int32 Farthest;
+			// Edges of the source contour can not be split, touching source vertices stay as they are
+			if (FindFarthestVertex(Contours[Edge.Contour]->Positions, Edge.Begin, Edge.End, Farthest) >= 0.)
+			{
+				Kept[Edge.Contour][Farthest % Contours[Edge.Contour]->Positions.Num()] = true;
+				bSplit = true;
+			}
+		}
+	}
+
+	OutContours.SetNum(ContourNum);
+	for (int32 ContourIndex = 0; ContourIndex < ContourNum; ++ContourIndex)
+	{
+		const FAreaContour& Contour = *Contours[ContourIndex];
+		FAreaContour& OutContour = OutContours[ContourIndex];
+		const int32 KeptNum = Kept[ContourIndex].CountSetBits();
+		OutContour.Indices.Reset(KeptNum);
+		OutContour.Positions.Reset(KeptNum);
+		for (TConstSetBitIterator<> It(Kept[ContourIndex]); It; ++It)
+		{
+			OutContour.Indices.Add(Contour.Indices[It.GetIndex()]);
+			OutContour.Positions.Add(Contour.Positions[It.GetIndex()]);
+		}
+	}
 }
 
 bool UIslandMapUtils::PointInPolygon2D(const FVector2D& Point, const TArray<FVector2D>& Polygon)
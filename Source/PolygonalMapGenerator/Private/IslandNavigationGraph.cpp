@@ -0,0 +1,192 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "IslandNavigationGraph.h"
+#include "Algo/Reverse.h"
+#include "ScratchContainers.h"
+#include "TriangleDualMesh.h"
+
+namespace
+{
+	struct FOpenNode
+	{
+		float Estimate;
+		float Cost;
+		int32 Node;
+	};
+
+	struct FOpenNodePredicate
+	{
+		FORCEINLINE bool operator()(const FOpenNode& A, const FOpenNode& B) const
+		{
+			return A.Estimate < B.Estimate;
+		}
+	};
+}
+
+void FIslandNavigationGraph::Build(const UTriangleDualMesh& Mesh, TConstArrayView<float> Elevations,
+                                   TConstArrayView<ERegionFlags> Flags, TConstArrayView<int32> SideFlow,
+                                   const FIslandNavigationSettings& Settings)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FIslandNavigationGraph::Build)
+	const int32 RegionNum = Mesh.NumSolidRegions;
+	check(Elevations.Num() >= RegionNum && Flags.Num() >= RegionNum);
+
+	const ERegionFlags Blocking = Settings.bIncludeLakes ? ERegionFlags::Ocean : ERegionFlags::Water;
+	RegionNodes.Init(INDEX_NONE, RegionNum);
+	NodeRegions.Reset();
+	NodePositions.Reset();
+	for (FPointIndex Region(0); Region < RegionNum; ++Region)
+	{
+		if (!EnumHasAnyFlags(Flags[Region], Blocking))
+		{
+			RegionNodes[Region] = NodeRegions.Add(Region);
+			NodePositions.Add(Mesh.r_pos(Region));
+		}
+	}
+
+	const int32 NodeNum = NodeRegions.Num();
+	EdgeOffsets.SetNumUninitialized(NodeNum + 1);
+	EdgeTargets.Reset();
+	EdgeCosts.Reset();
+	for (int32 Node = 0; Node < NodeNum; ++Node)
+	{
+		EdgeOffsets[Node] = EdgeTargets.Num();
+		const FPointIndex Region(NodeRegions[Node]);
+		Mesh.r_circulate_s(Region, [&](const FSideIndex Side)
+		{
+			const int32 Target = GetRegionNode(Mesh.s_end_r(Side));
+			if (Target == INDEX_NONE)
+			{
+				return;
+			}
+			const double Distance = FVector2D::Distance(NodePositions[Node], NodePositions[Target]);
+			const float Rise = Elevations[NodeRegions[Target]] - Elevations[Region];
+			double Cost = Distance * (1. + Settings.UphillCost * FMath::Max(Rise, 0.f)
+				+ Settings.DownhillCost * FMath::Max(-Rise, 0.f));
+			// The river runs along the Voronoi edge between the two regions, which is dual to the side
+			if (SideFlow.IsValidIndex(Side))
+			{
+				const FSideIndex Opposite = Mesh.s_opposite_s(Side);
+				const int32 Flow = SideFlow[Side] + (SideFlow.IsValidIndex(Opposite) ? SideFlow[Opposite] : 0);
+				if (Flow >= Settings.MinRiverFlow)
+				{
+					Cost += Settings.RiverCrossingCost;
+				}
+			}
+			EdgeTargets.Add(Target);
+			EdgeCosts.Add(static_cast<float>(Cost));
+		});
+	}
+	EdgeOffsets[NodeNum] = EdgeTargets.Num();
+
+	// Flood fill the components so unreachable goals are rejected without a search
+	NodeComponents.Init(INDEX_NONE, NodeNum);
+	TArray<int32> Stack;
+	int32 ComponentNum = 0;
+	for (int32 Seed = 0; Seed < NodeNum; ++Seed)
+	{
+		if (NodeComponents[Seed] != INDEX_NONE)
+		{
+			continue;
+		}
+		NodeComponents[Seed] = ComponentNum;
+		Stack.Add(Seed);
+		while (!Stack.IsEmpty())
+		{
+			const int32 Node = Stack.Pop(EAllowShrinking::No);
+			for (int32 Edge = EdgeOffsets[Node]; Edge < EdgeOffsets[Node + 1]; ++Edge)
+			{
+				if (NodeComponents[EdgeTargets[Edge]] == INDEX_NONE)
+				{
+					NodeComponents[EdgeTargets[Edge]] = ComponentNum;
+					Stack.Add(EdgeTargets[Edge]);
+				}
+			}
+		}
+		++ComponentNum;
+	}
+}
+
+bool FIslandNavigationGraph::IsReachable(const FPointIndex Start, const FPointIndex Goal) const
+{
+	const int32 StartNode = GetRegionNode(Start);
+	const int32 GoalNode = GetRegionNode(Goal);
+	return StartNode != INDEX_NONE && GoalNode != INDEX_NONE
+		&& NodeComponents[StartNode] == NodeComponents[GoalNode];
+}
+
+bool FIslandNavigationGraph::FindPath(const FPointIndex Start, const FPointIndex Goal, TArray<FPointIndex>& OutPath,
+                                      float* OutCost) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FIslandNavigationGraph::FindPath)
+	OutPath.Reset();
+	if (!IsReachable(Start, Goal))
+	{
+		return false;
+	}
+	const int32 StartNode = GetRegionNode(Start);
+	const int32 GoalNode = GetRegionNode(Goal);
+	const FVector2D& GoalPosition = NodePositions[GoalNode];
+
+	FMemMark Mark(FMemStack::Get());
+	TScratchArray<float> Costs;
+	Costs.Init(TNumericLimits<float>::Max(), NodeRegions.Num());
+	TScratchArray<int32> Parents;
+	Parents.SetNumUninitialized(NodeRegions.Num());
+	TScratchArray<FOpenNode> Open;
+	Costs[StartNode] = 0.f;
+	Parents[StartNode] = INDEX_NONE;
+	Open.HeapPush({static_cast<float>(FVector2D::Distance(NodePositions[StartNode], GoalPosition)), 0.f, StartNode},
+	              FOpenNodePredicate());
+	// Every edge costs at least its length, so the straight distance never overestimates
+	while (!Open.IsEmpty())
+	{
+		FOpenNode Current;
+		Open.HeapPop(Current, FOpenNodePredicate(), EAllowShrinking::No);
+		const int32 Node = Current.Node;
+		if (Node == GoalNode)
+		{
+			break;
+		}
+		const float NodeCost = Costs[Node];
+		// Stale entry of a node that was reached cheaper since it was pushed
+		if (Current.Cost > NodeCost)
+		{
+			continue;
+		}
+		for (int32 Edge = EdgeOffsets[Node]; Edge < EdgeOffsets[Node + 1]; ++Edge)
+		{
+			const int32 Target = EdgeTargets[Edge];
+			const float Cost = NodeCost + EdgeCosts[Edge];
+			if (Cost < Costs[Target])
+			{
+				Costs[Target] = Cost;
+				Parents[Target] = Node;
+				const float Estimate = Cost + static_cast<float>(FVector2D::Distance(NodePositions[Target], GoalPosition));
+				Open.HeapPush({Estimate, Cost, Target}, FOpenNodePredicate());
+			}
+		}
+	}
+	if (Costs[GoalNode] == TNumericLimits<float>::Max())
+	{
+		return false;
+	}
+
+	for (int32 Node = GoalNode; Node != INDEX_NONE; Node = Parents[Node])
+	{
+		OutPath.Add(FPointIndex(NodeRegions[Node]));
+	}
+	Algo::Reverse(OutPath);
+	if (OutCost)
+	{
+		*OutCost = Costs[GoalNode];
+	}
+	return true;
+}
+
+SIZE_T FIslandNavigationGraph::GetAllocatedSize() const
+{
+	return RegionNodes.GetAllocatedSize() + NodeRegions.GetAllocatedSize() + NodePositions.GetAllocatedSize()
+		+ NodeComponents.GetAllocatedSize() + EdgeOffsets.GetAllocatedSize() + EdgeTargets.GetAllocatedSize()
+		+ EdgeCosts.GetAllocatedSize();
+}
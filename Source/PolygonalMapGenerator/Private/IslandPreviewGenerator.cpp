@@ -0,0 +1,124 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "IslandPreviewGenerator.h"
+
+#include "IslandBatchGenerator.h"
+#include "PolygonalMapGenerator.h"
+#include "Mesh/IslandMeshBuilder.h"
+
+bool UIslandPreviewGenerator::RequestPreview(UIslandMapData* InTarget, float SpacingScale)
+{
+	check(IsInGameThread());
+	if (!IsValid(InTarget) || !UIslandBatchGenerator::HasNativeGenerators(InTarget))
+	{
+		UE_LOG(LogMapGen, Warning, TEXT("Island previews need map data whose class and generators are all native"));
+		return false;
+	}
+	Target = InTarget;
+	PendingSpacingScale = FMath::Max(SpacingScale, 1.f);
+	bHasPendingRequest = true;
+	if (IsGenerating())
+	{
+		// Started again once the running request stops
+		bCancelled = true;
+	}
+	else
+	{
+		StartPendingRequest();
+	}
+	return true;
+}
+
+void UIslandPreviewGenerator::CancelPreview()
+{
+	bHasPendingRequest = false;
+	bCancelled = true;
+}
+
+bool UIslandPreviewGenerator::IsGenerating() const
+{
+	return CompletionTask.IsValid() && !CompletionTask->IsComplete();
+}
+
+void UIslandPreviewGenerator::BeginDestroy()
+{
+	// The tasks hold a raw pointer to this object
+	if (IsGenerating())
+	{
+		CancelPreview();
+		Target = nullptr;
+		FTaskGraphInterface::Get().WaitUntilTaskCompletes(CompletionTask, ENamedThreads::GameThread);
+	}
+	Super::BeginDestroy();
+}
+
+void UIslandPreviewGenerator::StartPendingRequest()
+{
+	check(IsInGameThread());
+	bHasPendingRequest = false;
+	bCancelled = false;
+	// A new copy for every request, the settings of the target changed since the last one
+	Scratch = UIslandBatchGenerator::CreateScratch(Target, this);
+	if (PendingSpacingScale > 1.f)
+	{
+		UIslandMeshBuilder* PointGenerator = DuplicateObject(Target->PointGenerator, Scratch);
+		if (PointGenerator->ScaleRegionNum(1.f / FMath::Square(PendingSpacingScale)))
+		{
+			Scratch->PointGenerator = PointGenerator;
+		}
+	}
+
+	UIslandMapData* Generating = Scratch;
+	const FGraphEventRef GenerateTask = FFunctionGraphTask::CreateAndDispatchWhenReady([this, Generating]
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(UIslandPreviewGenerator::Generate)
+		PreviewBytes.Reset();
+		TArray<UIslandMapData::FGenerationStage> Stages;
+		uint64 CacheKey = 0;
+		bool bConcurrent = false;
+		if (Generating->BeginGeneration(Stages, CacheKey, bConcurrent) != UIslandMapData::EGenerationStart::RunStages)
+		{
+			return;
+		}
+		for (const UIslandMapData::FGenerationStage& Stage : Stages)
+		{
+			if (bCancelled)
+			{
+				return;
+			}
+			UIslandMapData::RunGenerationStage(Stage);
+		}
+		Generating->SaveIslandToBytes(PreviewBytes);
+	});
+	FGraphEventArray Prerequisites;
+	Prerequisites.Emplace(GenerateTask);
+	CompletionTask = FFunctionGraphTask::CreateAndDispatchWhenReady([this]
+	{
+		FinishRequest();
+	}, TStatId(), &Prerequisites, ENamedThreads::GameThread);
+}
+
+void UIslandPreviewGenerator::FinishRequest()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UIslandPreviewGenerator::FinishRequest)
+	if (!bCancelled && IsValid(Target) && !PreviewBytes.IsEmpty())
+	{
+		// Loaded like a cached island, only the finishing steps run on the game thread
+		Target->GenerationReport = Scratch->GenerationReport;
+		Target->GenerationStartCycles = Scratch->GenerationStartCycles;
+		Target->Diagnostics.Assign(Scratch->Diagnostics);
+		if (Target->LoadIslandFromBytes(PreviewBytes, Scratch->GetCacheKey(), TEXT("the preview")))
+		{
+			// The next regeneration of the target must not reuse the layers of a coarse preview
+			Target->InvalidateGenerationCache();
+			Target->LastCacheKey = Scratch->GetCacheKey();
+			Target->FinishGeneration();
+		}
+	}
+	PreviewBytes.Empty();
+	Scratch = nullptr;
+	if (bHasPendingRequest && IsValid(Target))
+	{
+		StartPendingRequest();
+	}
+}
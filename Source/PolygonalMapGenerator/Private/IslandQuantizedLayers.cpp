@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "IslandQuantizedLayers.h"
+
+void FIslandQuantizedFloatLayer::Encode(TConstArrayView<float> InValues)
+{
+	Values.SetNumUninitialized(InValues.Num());
+	if (InValues.IsEmpty())
+	{
+		Min = 0.f;
+		Step = 0.f;
+		return;
+	}
+	float Max = InValues[0];
+	Min = InValues[0];
+	for (const float Value : InValues)
+	{
+		Min = FMath::Min(Min, Value);
+		Max = FMath::Max(Max, Value);
+	}
+	const uint16 StepNum = TNumericLimits<uint16>::Max();
+	Step = (Max - Min) / StepNum;
+	const float InvStep = Step > 0.f ? 1.f / Step : 0.f;
+	for (int32 Index = 0; Index < InValues.Num(); ++Index)
+	{
+		Values[Index] = static_cast<uint16>(FMath::Clamp(FMath::RoundToInt32((InValues[Index] - Min) * InvStep), 0, StepNum));
+	}
+}
+
+void FIslandQuantizedFloatLayer::Decode(TArray<float>& OutValues) const
+{
+	OutValues.SetNumUninitialized(Values.Num());
+	for (int32 Index = 0; Index < Values.Num(); ++Index)
+	{
+		OutValues[Index] = Min + Values[Index] * Step;
+	}
+}
+
+uint32 FIslandQuantizedFloatLayer::GetCrc32(uint32 Crc) const
+{
+	Crc = FCrc::MemCrc32(&Min, sizeof(Min), Crc);
+	Crc = FCrc::MemCrc32(&Step, sizeof(Step), Crc);
+	return FCrc::MemCrc32(Values.GetData(), Values.Num() * Values.GetTypeSize(), Crc);
+}
+
+void FIslandQuantizedDistanceLayer::Encode(TConstArrayView<int32> InValues)
+{
+	Values.SetNumUninitialized(InValues.Num());
+	for (int32 Index = 0; Index < InValues.Num(); ++Index)
+	{
+		Values[Index] = InValues[Index] < 0 ? NoDistance : static_cast<uint16>(FMath::Min(InValues[Index], NoDistance - 1));
+	}
+}
+
+void FIslandQuantizedDistanceLayer::Decode(TArray<int32>& OutValues) const
+{
+	OutValues.SetNumUninitialized(Values.Num());
+	for (int32 Index = 0; Index < Values.Num(); ++Index)
+	{
+		OutValues[Index] = (*this)[Index];
+	}
+}
@@ -0,0 +1,363 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "IslandRasterExport.h"
+
+#include "IslandMapData.h"
+#include "PolygonalMapGenerator.h"
+#include "Async/ParallelFor.h"
+#include "HAL/FileManager.h"
+#include "Serialization/MemoryWriter.h"
+
+THIRD_PARTY_INCLUDES_START
+#include "zlib.h"
+THIRD_PARTY_INCLUDES_END
+
+namespace
+{
+	/** Writes rows of one image as they come, top row first. */
+	class FRasterWriter
+	{
+	public:
+		virtual ~FRasterWriter() = default;
+		virtual void Begin(FArchive& Ar, int32 Width, int32 Height) = 0;
+		virtual void WriteRows(FArchive& Ar, TConstArrayView<float> Values, int32 Width) = 0;
+		virtual void End(FArchive& Ar)
+		{
+		}
+	};
+
+	/** Maps [Min, Max] to the 16 bit range. */
+	struct FUnorm16Range
+	{
+		float Min = 0.f;
+		float Max = 65535.f;
+
+		uint16 Quantize(const float Value) const
+		{
+			const float Unit = Max > Min ? (Value - Min) / (Max - Min) : 0.f;
+			return static_cast<uint16>(FMath::Clamp(FMath::RoundToInt32(Unit * 65535.f), 0, 65535));
+		}
+	};
+
+	class FR16Writer : public FRasterWriter
+	{
+	public:
+		explicit FR16Writer(const FUnorm16Range& InRange)
+			: Range(InRange)
+		{
+		}
+
+		virtual void Begin(FArchive& Ar, int32 Width, int32 Height) override
+		{
+		}
+
+		virtual void WriteRows(FArchive& Ar, TConstArrayView<float> Values, int32 Width) override
+		{
+			Row.SetNumUninitialized(Values.Num());
+			for (int32 Index = 0; Index < Values.Num(); ++Index)
+			{
+				Row[Index] = Range.Quantize(Values[Index]);
+			}
+			// Archives are little endian, as R16 is
+			Ar.Serialize(Row.GetData(), Row.NumBytes());
+		}
+
+	private:
+		FUnorm16Range Range;
+		TArray<uint16> Row;
+	};
+
+	/**
+	 * Scanline EXR without compression. Every chunk then has a known size, so the offset table is written up front
+	 * and the rows follow without seeking back.
+	 */
+	class FEXRWriter : public FRasterWriter
+	{
+	public:
+		virtual void Begin(FArchive& Ar, int32 Width, int32 Height) override
+		{
+			TArray<uint8> Header;
+			FMemoryWriter HeaderAr(Header);
+			int32 Magic = 20000630;
+			int32 Version = 2;
+			HeaderAr << Magic << Version;
+			auto WriteAttribute = [&HeaderAr](const ANSICHAR* Name, const ANSICHAR* Type, const int32 Size)
+			{
+				HeaderAr.Serialize(const_cast<ANSICHAR*>(Name), FCStringAnsi::Strlen(Name) + 1);
+				HeaderAr.Serialize(const_cast<ANSICHAR*>(Type), FCStringAnsi::Strlen(Type) + 1);
+				int32 AttributeSize = Size;
+				HeaderAr << AttributeSize;
+			};
+			// One FLOAT channel named Y, not linear, no subsampling
+			WriteAttribute("channels", "chlist", 19);
+			HeaderAr.Serialize(const_cast<ANSICHAR*>("Y"), 2);
+			int32 PixelType = 2;
+			uint32 LinearAndReserved = 0;
+			int32 Sampling = 1;
+			HeaderAr << PixelType << LinearAndReserved << Sampling << Sampling;
+			uint8 Terminator = 0;
+			HeaderAr << Terminator;
+			WriteAttribute("compression", "compression", 1);
+			uint8 NoCompression = 0;
+			HeaderAr << NoCompression;
+			int32 Box[4] = {0, 0, Width - 1, Height - 1};
+			WriteAttribute("dataWindow", "box2i", sizeof(Box));
+			HeaderAr.Serialize(Box, sizeof(Box));
+			WriteAttribute("displayWindow", "box2i", sizeof(Box));
+			HeaderAr.Serialize(Box, sizeof(Box));
+			WriteAttribute("lineOrder", "lineOrder", 1);
+			uint8 IncreasingY = 0;
+			HeaderAr << IncreasingY;
+			float One = 1.f;
+			WriteAttribute("pixelAspectRatio", "float", sizeof(float));
+			HeaderAr << One;
+			float Center[2] = {0.f, 0.f};
+			WriteAttribute("screenWindowCenter", "v2f", sizeof(Center));
+			HeaderAr.Serialize(Center, sizeof(Center));
+			WriteAttribute("screenWindowWidth", "float", sizeof(float));
+			HeaderAr << One;
+			HeaderAr << Terminator;
+			Ar.Serialize(Header.GetData(), Header.Num());
+
+			// One scanline per chunk: its y, its size and the floats
+			const uint64 ChunkSize = 2 * sizeof(int32) + static_cast<uint64>(Width) * sizeof(float);
+			uint64 Offset = Header.Num() + static_cast<uint64>(Height) * sizeof(uint64);
+			for (int32 Y = 0; Y < Height; ++Y)
+			{
+				Ar << Offset;
+				Offset += ChunkSize;
+			}
+		}
+
+		virtual void WriteRows(FArchive& Ar, TConstArrayView<float> Values, int32 Width) override
+		{
+			for (int32 First = 0; First < Values.Num(); First += Width)
+			{
+				int32 DataSize = Width * sizeof(float);
+				Ar << NextRow << DataSize;
+				Ar.Serialize(const_cast<float*>(Values.GetData() + First), DataSize);
+				++NextRow;
+			}
+		}
+
+	private:
+		int32 NextRow = 0;
+	};
+
+	/** 16 bit grayscale PNG, the rows go through one deflate stream that is flushed into IDAT chunks as it fills. */
+	class FPNGWriter : public FRasterWriter
+	{
+	public:
+		explicit FPNGWriter(const FUnorm16Range& InRange)
+			: Range(InRange)
+		{
+			FMemory::Memzero(Stream);
+			deflateInit(&Stream, Z_BEST_SPEED);
+			Compressed.SetNumUninitialized(64 * 1024);
+		}
+
+		virtual ~FPNGWriter() override
+		{
+			deflateEnd(&Stream);
+		}
+
+		virtual void Begin(FArchive& Ar, int32 Width, int32 Height) override
+		{
+			const uint8 Signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+			Ar.Serialize(const_cast<uint8*>(Signature), sizeof(Signature));
+			uint8 Header[13];
+			WriteBigEndian(Header, Width);
+			WriteBigEndian(Header + 4, Height);
+			Header[8] = 16;
+			// Grayscale, deflate, adaptive filtering, not interlaced
+			Header[9] = 0;
+			Header[10] = 0;
+			Header[11] = 0;
+			Header[12] = 0;
+			WriteChunk(Ar, "IHDR", Header, sizeof(Header));
+		}
+
+		virtual void WriteRows(FArchive& Ar, TConstArrayView<float> Values, int32 Width) override
+		{
+			// Every row starts with its filter type, Sub stores the difference to the sample on the left
+			const int32 RowBytes = 1 + Width * 2;
+			Filtered.SetNumUninitialized(Values.Num() / Width * RowBytes);
+			for (int32 Row = 0; Row < Values.Num() / Width; ++Row)
+			{
+				uint8* Out = Filtered.GetData() + Row * RowBytes;
+				Out[0] = 1;
+				uint16 Left = 0;
+				for (int32 X = 0; X < Width; ++X)
+				{
+					const uint16 Sample = Range.Quantize(Values[Row * Width + X]);
+					Out[1 + 2 * X] = static_cast<uint8>((Sample >> 8) - (Left >> 8));
+					Out[2 + 2 * X] = static_cast<uint8>((Sample & 0xFF) - (Left & 0xFF));
+					Left = Sample;
+				}
+			}
+			Stream.next_in = Filtered.GetData();
+			Stream.avail_in = Filtered.Num();
+			while (Stream.avail_in > 0 && Deflate(Ar, Z_NO_FLUSH) == Z_OK)
+			{
+			}
+		}
+
+		virtual void End(FArchive& Ar) override
+		{
+			while (Deflate(Ar, Z_FINISH) == Z_OK)
+			{
+			}
+			WriteChunk(Ar, "IEND", nullptr, 0);
+		}
+
+	private:
+		static void WriteBigEndian(uint8* Out, const uint32 Value)
+		{
+			Out[0] = static_cast<uint8>(Value >> 24);
+			Out[1] = static_cast<uint8>(Value >> 16);
+			Out[2] = static_cast<uint8>(Value >> 8);
+			Out[3] = static_cast<uint8>(Value);
+		}
+
+		static void WriteChunk(FArchive& Ar, const ANSICHAR* Type, const uint8* Data, const uint32 Size)
+		{
+			uint8 Word[4];
+			WriteBigEndian(Word, Size);
+			Ar.Serialize(Word, 4);
+			Ar.Serialize(const_cast<ANSICHAR*>(Type), 4);
+			if (Size > 0)
+			{
+				Ar.Serialize(const_cast<uint8*>(Data), Size);
+			}
+			uLong Crc = crc32(0, reinterpret_cast<const Bytef*>(Type), 4);
+			if (Size > 0)
+			{
+				Crc = crc32(Crc, Data, Size);
+			}
+			WriteBigEndian(Word, static_cast<uint32>(Crc));
+			Ar.Serialize(Word, 4);
+		}
+
+		/** Runs deflate once and writes what it produced when the buffer is full or the stream ends. */
+		int32 Deflate(FArchive& Ar, const int32 Flush)
+		{
+			Stream.next_out = Compressed.GetData() + Pending;
+			Stream.avail_out = Compressed.Num() - Pending;
+			const int32 Result = deflate(&Stream, Flush);
+			Pending = Compressed.Num() - Stream.avail_out;
+			if (Pending == Compressed.Num() || (Result == Z_STREAM_END && Pending > 0))
+			{
+				WriteChunk(Ar, "IDAT", Compressed.GetData(), Pending);
+				Pending = 0;
+			}
+			return Result;
+		}
+
+		FUnorm16Range Range;
+		z_stream Stream;
+		TArray<uint8> Filtered;
+		TArray<uint8> Compressed;
+		uint32 Pending = 0;
+	};
+}
+
+bool UIslandRasterExport::ExportLayer(const UIslandMapData* MapData, const FString& Filename,
+                                      const FIslandRasterExportOptions& Options)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UIslandRasterExport::ExportLayer)
+	if (!IsValid(MapData))
+	{
+		UE_LOG(LogMapGen, Error, TEXT("Cannot export %s without map data."), *Filename);
+		return false;
+	}
+	const TSharedRef<const FIslandMapQuery> Query = MapData->GetMapQuery();
+	if (!Query->IsValid())
+	{
+		UE_LOG(LogMapGen, Error, TEXT("Cannot export %s, the map data has no finished island."), *Filename);
+		return false;
+	}
+	const int32 Width = Options.Width;
+	const int32 Height = Options.Height;
+	if (Width < 2 || Height < 2)
+	{
+		UE_LOG(LogMapGen, Error, TEXT("Cannot export %s with %dx%d pixels."), *Filename, Width, Height);
+		return false;
+	}
+
+	FUnorm16Range Range;
+	switch (Options.Layer)
+	{
+	case EIslandRasterLayer::IRL_Elevation:
+	case EIslandRasterLayer::IRL_Moisture:
+		Range = {Options.RangeMin, Options.RangeMax};
+		break;
+	case EIslandRasterLayer::IRL_CoastDistance:
+		Range = {-Options.MaxCoastDistance, Options.MaxCoastDistance};
+		break;
+	default:
+		// Indices are written as they are
+		break;
+	}
+	TUniquePtr<FRasterWriter> Writer;
+	switch (Options.Format)
+	{
+	case EIslandRasterFormat::IRF_EXR:
+		Writer = MakeUnique<FEXRWriter>();
+		break;
+	case EIslandRasterFormat::IRF_PNG:
+		Writer = MakeUnique<FPNGWriter>(Range);
+		break;
+	default:
+		Writer = MakeUnique<FR16Writer>(Range);
+		break;
+	}
+	const TUniquePtr<FArchive> Ar(IFileManager::Get().CreateFileWriter(*Filename));
+	if (!Ar.IsValid())
+	{
+		UE_LOG(LogMapGen, Error, TEXT("Cannot open %s for writing."), *Filename);
+		return false;
+	}
+
+	const FVector2D PixelSize = MapData->GetMapSize() / FVector2D(Width - 1, Height - 1);
+	auto SampleLayer = [&](const FVector2D& Point) -> float
+	{
+		switch (Options.Layer)
+		{
+		case EIslandRasterLayer::IRL_Moisture:
+			return MapData->GetPointMoisture(Query->FindRegion(Point));
+		case EIslandRasterLayer::IRL_Biome:
+			return Query->GetBiomeAt(Point);
+		case EIslandRasterLayer::IRL_District:
+			return Query->GetDistrictAt(Point) + 1;
+		case EIslandRasterLayer::IRL_CoastDistance:
+			return MapData->GetSignedCoastDistance(Point, Options.MaxCoastDistance);
+		default:
+			return Query->GetElevationAt(Point);
+		}
+	};
+
+	const int32 RowsPerBand = FMath::Clamp(Options.RowsPerBand, 1, Height);
+	TArray<float> Band;
+	Band.SetNumUninitialized(RowsPerBand * Width);
+	Writer->Begin(*Ar, Width, Height);
+	for (int32 FirstRow = 0; FirstRow < Height; FirstRow += RowsPerBand)
+	{
+		const int32 RowNum = FMath::Min(RowsPerBand, Height - FirstRow);
+		ParallelFor(RowNum, [&](const int32 Row)
+		{
+			const double Y = (FirstRow + Row) * PixelSize.Y;
+			for (int32 X = 0; X < Width; ++X)
+			{
+				Band[Row * Width + X] = SampleLayer(FVector2D(X * PixelSize.X, Y));
+			}
+		});
+		Writer->WriteRows(*Ar, MakeArrayView(Band.GetData(), RowNum * Width), Width);
+	}
+	Writer->End(*Ar);
+	if (!Ar->Close())
+	{
+		UE_LOG(LogMapGen, Error, TEXT("Failed to write %s."), *Filename);
+		return false;
+	}
+	return true;
+}
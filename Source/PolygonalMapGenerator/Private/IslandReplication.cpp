@@ -0,0 +1,21 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "IslandReplication.h"
+
+int32 FIslandRegionPatch::Num() const
+{
+	int32 num = 0;
+	for (const int32 layerNum : {Elevations.Num(), Flags.Num(), Biomes.Num(), Districts.Num()})
+	{
+		if (layerNum == 0)
+		{
+			continue;
+		}
+		if (num != 0 && layerNum != num)
+		{
+			return 0;
+		}
+		num = layerNum;
+	}
+	return num;
+}
@@ -0,0 +1,43 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "IslandVoronoiView.h"
+
+void FIslandVoronoiView::Build(const UTriangleDualMesh* InMesh)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FIslandVoronoiView::Build)
+	Reset();
+	if (InMesh == nullptr)
+	{
+		return;
+	}
+	Mesh = InMesh;
+	NumPolygons = InMesh->NumSolidRegions;
+	if (InMesh->HasAdjacency())
+	{
+		return;
+	}
+
+	// Every side starts at exactly one region, so the corners of all polygons fit into one index per side
+	Offsets.SetNumUninitialized(NumPolygons + 1);
+	Corners.Reserve(InMesh->NumSides);
+	for (FPointIndex r = 0; r < NumPolygons; r++)
+	{
+		Offsets[r] = Corners.Num();
+		InMesh->r_circulate_t(r, [this](const FTriangleIndex t)
+		{
+			if (t.IsValid())
+			{
+				Corners.Add(t);
+			}
+		});
+	}
+	Offsets[NumPolygons] = Corners.Num();
+}
+
+void FIslandVoronoiView::Reset()
+{
+	Mesh = nullptr;
+	NumPolygons = 0;
+	Offsets.Reset();
+	Corners.Reset();
+}
@@ -0,0 +1,240 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "IslandWorldGenerator.h"
+
+#include "PolygonalMapGenerator.h"
+#include "RandomSampling/CounterRandom.h"
+
+bool UIslandWorldGenerator::SetTemplate(UIslandMapData* InTemplate)
+{
+	check(IsInGameThread());
+	if (!IsValid(InTemplate) || !UIslandBatchGenerator::HasNativeGenerators(InTemplate))
+	{
+		UE_LOG(LogMapGen, Error, TEXT("Island worlds need map data whose class and generators are all native"));
+		return false;
+	}
+	ReleaseAllChunks();
+	// The copies of the old template carry its generators and settings
+	StaleMapData.Append(RetiringMapData);
+	RetiringMapData.Reset();
+	PooledMapData.Reset();
+	Template = InTemplate;
+	return true;
+}
+
+FVector2D UIslandWorldGenerator::GetChunkSize() const
+{
+	return IsValid(Template) && Template->PointGenerator != nullptr ? Template->PointGenerator->MapSize : FVector2D::ZeroVector;
+}
+
+FVector2D UIslandWorldGenerator::GetChunkOrigin(FIntPoint Chunk) const
+{
+	const FVector2D ChunkSize = GetChunkSize();
+	return FVector2D(Chunk.X * ChunkSize.X, Chunk.Y * ChunkSize.Y);
+}
+
+FIntPoint UIslandWorldGenerator::WorldToChunk(const FVector2D& WorldPosition) const
+{
+	const FVector2D ChunkSize = GetChunkSize();
+	if (ChunkSize.X <= 0.0 || ChunkSize.Y <= 0.0)
+	{
+		return FIntPoint::ZeroValue;
+	}
+	return FIntPoint(FMath::FloorToInt32(WorldPosition.X / ChunkSize.X), FMath::FloorToInt32(WorldPosition.Y / ChunkSize.Y));
+}
+
+bool UIslandWorldGenerator::RequestChunk(FIntPoint Chunk)
+{
+	check(IsInGameThread());
+	if (!IsValid(Template))
+	{
+		UE_LOG(LogMapGen, Error, TEXT("Island world has no template, call SetTemplate first"));
+		return false;
+	}
+	if (Chunks.Contains(Chunk))
+	{
+		return true;
+	}
+
+	UIslandMapData* MapData = AcquireMapData();
+	UIslandBatchGenerator::ApplyCandidate(MapData, GetChunkSeeds(WorldSeed, Chunk));
+	FIslandWorldChunk& WorldChunk = Chunks.Add(Chunk);
+	WorldChunk.Coordinates = Chunk;
+	WorldChunk.MapData = MapData;
+	// The stages run on a worker, the finish broadcasts and publishes the snapshot on the game thread
+	TWeakObjectPtr<UIslandWorldGenerator> WeakThis(this);
+	ChunkTasks.RemoveAllSwap([](const FGraphEventRef& Task) { return Task->IsComplete(); });
+	ChunkTasks.Add(FFunctionGraphTask::CreateAndDispatchWhenReady([WeakThis, Chunk, MapData]
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(UIslandWorldGenerator::GenerateChunk)
+		TArray<UIslandMapData::FGenerationStage> Stages;
+		uint64 CacheKey = 0;
+		bool bConcurrent = false;
+		const bool bStagesRan = MapData->BeginGeneration(Stages, CacheKey, bConcurrent) == UIslandMapData::EGenerationStart::RunStages;
+		if (bStagesRan)
+		{
+			// Chunks already generate side by side, so the stages of one chunk stay on this worker
+			MapData->RunGenerationStages(Stages, false);
+		}
+		FFunctionGraphTask::CreateAndDispatchWhenReady([WeakThis, Chunk, MapData, bStagesRan, CacheKey]
+		{
+			if (UIslandWorldGenerator* World = WeakThis.Get())
+			{
+				World->OnChunkTaskComplete(Chunk, MapData, bStagesRan, CacheKey);
+			}
+		}, TStatId(), nullptr, ENamedThreads::GameThread);
+	}));
+	return true;
+}
+
+void UIslandWorldGenerator::ReleaseChunk(FIntPoint Chunk)
+{
+	check(IsInGameThread());
+	FIslandWorldChunk WorldChunk;
+	if (!Chunks.RemoveAndCopyValue(Chunk, WorldChunk))
+	{
+		return;
+	}
+	if (WorldChunk.bGenerated)
+	{
+		RecycleMapData(WorldChunk.MapData);
+	}
+	else
+	{
+		RetiringMapData.Add(WorldChunk.MapData);
+	}
+}
+
+void UIslandWorldGenerator::ReleaseAllChunks()
+{
+	TArray<FIntPoint> Loaded;
+	Chunks.GetKeys(Loaded);
+	for (const FIntPoint& Chunk : Loaded)
+	{
+		ReleaseChunk(Chunk);
+	}
+}
+
+void UIslandWorldGenerator::UpdateLoadedChunks(const FVector2D& WorldCenter, double Radius)
+{
+	check(IsInGameThread());
+	const FVector2D ChunkSize = GetChunkSize();
+	if (ChunkSize.X <= 0.0 || ChunkSize.Y <= 0.0)
+	{
+		return;
+	}
+	const FIntPoint Min = WorldToChunk(WorldCenter - FVector2D(Radius));
+	const FIntPoint Max = WorldToChunk(WorldCenter + FVector2D(Radius));
+	TSet<FIntPoint> Wanted;
+	for (int32 Y = Min.Y; Y <= Max.Y; Y++)
+	{
+		for (int32 X = Min.X; X <= Max.X; X++)
+		{
+			const FBox2D Bounds(GetChunkOrigin(FIntPoint(X, Y)), GetChunkOrigin(FIntPoint(X + 1, Y + 1)));
+			if (Bounds.ComputeSquaredDistanceToPoint(WorldCenter) <= Radius * Radius)
+			{
+				Wanted.Add(FIntPoint(X, Y));
+			}
+		}
+	}
+
+	TArray<FIntPoint> Loaded;
+	Chunks.GetKeys(Loaded);
+	for (const FIntPoint& Chunk : Loaded)
+	{
+		if (!Wanted.Contains(Chunk))
+		{
+			ReleaseChunk(Chunk);
+		}
+	}
+	for (const FIntPoint& Chunk : Wanted)
+	{
+		RequestChunk(Chunk);
+	}
+}
+
+UIslandMapData* UIslandWorldGenerator::GetChunkMapData(FIntPoint Chunk) const
+{
+	const FIslandWorldChunk* WorldChunk = Chunks.Find(Chunk);
+	return WorldChunk != nullptr && WorldChunk->bGenerated ? WorldChunk->MapData.Get() : nullptr;
+}
+
+UIslandMapData* UIslandWorldGenerator::FindMapDataAt(const FVector2D& WorldPosition, FVector2D& OutLocalPosition) const
+{
+	const FIntPoint Chunk = WorldToChunk(WorldPosition);
+	OutLocalPosition = WorldPosition - GetChunkOrigin(Chunk);
+	return GetChunkMapData(Chunk);
+}
+
+FIslandBatchCandidate UIslandWorldGenerator::GetChunkSeeds(int32 Seed, FIntPoint Chunk)
+{
+	// One counter per chunk, one substream per seed
+	const FCounterRandom Random(Seed);
+	const uint64 Index = (static_cast<uint64>(static_cast<uint32>(Chunk.X)) << 32) | static_cast<uint32>(Chunk.Y);
+	FIslandBatchCandidate Seeds;
+	Seeds.Seed = static_cast<int32>(Random.Substream(0).GetUnsignedInt(Index));
+	Seeds.DrainageSeed = static_cast<int32>(Random.Substream(1).GetUnsignedInt(Index));
+	Seeds.RiverSeed = static_cast<int32>(Random.Substream(2).GetUnsignedInt(Index));
+	Seeds.DistrictSeed = static_cast<int32>(Random.Substream(3).GetUnsignedInt(Index));
+	return Seeds;
+}
+
+void UIslandWorldGenerator::BeginDestroy()
+{
+	// The finish of a chunk only holds a weak pointer to this object, but the workers write into our map data
+	if (ChunkTasks.Num() > 0)
+	{
+		FTaskGraphInterface::Get().WaitUntilTasksComplete(ChunkTasks);
+		ChunkTasks.Reset();
+	}
+	OnChunkGenerated.Clear();
+	Super::BeginDestroy();
+}
+
+UIslandMapData* UIslandWorldGenerator::AcquireMapData()
+{
+	if (PooledMapData.Num() > 0)
+	{
+		return PooledMapData.Pop(EAllowShrinking::No);
+	}
+	UIslandMapData* MapData = UIslandBatchGenerator::CreateScratch(Template, this);
+	// Chunks are read on the game thread and from other threads like any other map
+	MapData->bPublishSnapshots = Template->bPublishSnapshots;
+	MapData->bBakeCoastDistanceField = Template->bBakeCoastDistanceField;
+	return MapData;
+}
+
+void UIslandWorldGenerator::RecycleMapData(UIslandMapData* MapData)
+{
+	if (PooledMapData.Num() < MaxPooledChunks)
+	{
+		PooledMapData.Add(MapData);
+	}
+}
+
+void UIslandWorldGenerator::OnChunkTaskComplete(FIntPoint Chunk, UIslandMapData* MapData, bool bStagesRan, uint64 CacheKey)
+{
+	check(IsInGameThread());
+	if (RetiringMapData.RemoveSingleSwap(MapData) > 0)
+	{
+		RecycleMapData(MapData);
+		return;
+	}
+	if (StaleMapData.RemoveSingleSwap(MapData) > 0)
+	{
+		return;
+	}
+	FIslandWorldChunk* WorldChunk = Chunks.Find(Chunk);
+	if (WorldChunk == nullptr || WorldChunk->MapData != MapData)
+	{
+		return;
+	}
+	WorldChunk->bGenerated = true;
+	if (!bStagesRan)
+	{
+		UE_LOG(LogMapGen, Error, TEXT("Island world chunk %d, %d failed to generate"), Chunk.X, Chunk.Y);
+		return;
+	}
+	MapData->EndGeneration(CacheKey);
+	OnChunkGenerated.Broadcast(Chunk, MapData);
+}
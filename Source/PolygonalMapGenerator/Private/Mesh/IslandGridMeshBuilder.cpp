@@ -0,0 +1,75 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Mesh/IslandGridMeshBuilder.h"
+#include "DualMeshBuilder.h"
+
+namespace
+{
+	// Row spacing of a hex grid in columns
+	constexpr double HexRowSpacing = 0.86602540378443864676;
+}
+
+UIslandGridMeshBuilder::UIslandGridMeshBuilder()
+{
+	Shape = EIslandGridShape::IGS_Hex;
+	NumberOfPoints = 1000;
+}
+
+void UIslandGridMeshBuilder::GetGridSize(int32& OutColumns, int32& OutRows) const
+{
+	const double aspect = MapSize.Y > 0.0 ? MapSize.X / MapSize.Y : 1.0;
+	const double rowScale = Shape == EIslandGridShape::IGS_Hex ? HexRowSpacing : 1.0;
+	OutColumns = FMath::Max(2, FMath::RoundToInt32(FMath::Sqrt(NumberOfPoints * aspect * rowScale)));
+	OutRows = FMath::Max(2, FMath::RoundToInt32(static_cast<double>(NumberOfPoints) / OutColumns));
+}
+
+void UIslandGridMeshBuilder::AddPoints_Implementation(UDualMeshBuilder* Builder, FRandomStream& Rng) const
+{
+	// Only for callers of AddPoints, GenerateDualMesh builds the grid without any points
+	int32 columns, rows;
+	GetGridSize(columns, rows);
+	const bool bHex = Shape == EIslandGridShape::IGS_Hex;
+	const double dx = MapSize.X / (bHex ? columns - 0.5 : columns - 1.0);
+	const double dy = MapSize.Y / (rows - 1.0);
+	for (int32 y = 0; y < rows; y++)
+	{
+		const double shift = bHex && (y & 1) ? 0.5 : 0.0;
+		for (int32 x = 0; x < columns; x++)
+		{
+			Builder->AddPoint(FVector2D((x + shift) * dx, y * dy));
+		}
+	}
+}
+
+UTriangleDualMesh* UIslandGridMeshBuilder::GenerateDualMesh_Implementation(FRandomStream& Rng) const
+{
+	UDualMeshBuilder* builder = NewObject<UDualMeshBuilder>();
+	UTriangleDualMesh* mesh = NewObject<UTriangleDualMesh>();
+	return GenerateDualMeshInto(builder, mesh, Rng) ? mesh : nullptr;
+}
+
+bool UIslandGridMeshBuilder::GenerateDualMeshInto(UDualMeshBuilder* Builder, UTriangleDualMesh* Mesh,
+                                                  FRandomStream& Rng) const
+{
+	int32 columns, rows;
+	GetGridSize(columns, rows);
+	Builder->Initialize(MapSize);
+	return Builder->CreateGridInto(Mesh, columns, rows, Shape == EIslandGridShape::IGS_Hex, bSortSpatially);
+}
+
+int32 UIslandGridMeshBuilder::EstimateRegionNum() const
+{
+	int32 columns, rows;
+	GetGridSize(columns, rows);
+	return columns * rows;
+}
+
+bool UIslandGridMeshBuilder::ScaleRegionNum(float Scale)
+{
+	if (Scale <= 0.f)
+	{
+		return false;
+	}
+	NumberOfPoints = FMath::Max(4, FMath::FloorToInt32(NumberOfPoints * Scale));
+	return true;
+}
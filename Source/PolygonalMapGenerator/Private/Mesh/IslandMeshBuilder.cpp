@@ -23,6 +23,8 @@ UIslandMeshBuilder::UIslandMeshBuilder()
 {
 	MapSize = FVector2D(107500.0, 107500.0);
 	BoundarySpacing = 1000;
+	bSortSpatially = false;
+	Triangulator = EDelaunayTriangulator::DT_Automatic;
 }
 
 void UIslandMeshBuilder::AddPoints_Implementation(UDualMeshBuilder* Builder, FRandomStream& Rng) const
@@ -34,6 +36,37 @@ UTriangleDualMesh* UIslandMeshBuilder::GenerateDualMesh_Implementation(FRandomSt
 {
 	UDualMeshBuilder* builder = NewObject<UDualMeshBuilder>();
 	builder->Initialize(MapSize, BoundarySpacing);
+	builder->SetTriangulator(Triangulator);
 	AddPoints(builder, Rng);
-	return builder->Create();
+	return builder->Create(bSortSpatially);
+}
+
+bool UIslandMeshBuilder::GenerateDualMeshInto(UDualMeshBuilder* Builder, UTriangleDualMesh* Mesh,
+                                              FRandomStream& Rng) const
+{
+	check(GetClass()->IsNative());
+	Builder->Initialize(MapSize, BoundarySpacing);
+	Builder->SetTriangulator(Triangulator);
+	AddPoints_Implementation(Builder, Rng);
+	return Builder->CreateInto(Mesh, bSortSpatially);
+}
+
+int32 UIslandMeshBuilder::EstimateRegionNum() const
+{
+	return 0;
+}
+
+bool UIslandMeshBuilder::ScaleRegionNum(float Scale)
+{
+	return false;
+}
+
+int32 UIslandMeshBuilder::EstimateBoundaryRegionNum() const
+{
+	if (BoundarySpacing <= 0)
+	{
+		return 0;
+	}
+	// Four points per step along each axis, see UDualMeshBuilder::AddBoundaryPoints
+	return 4 * (FMath::CeilToInt32(MapSize.X / BoundarySpacing) + FMath::CeilToInt32(MapSize.Y / BoundarySpacing));
 }
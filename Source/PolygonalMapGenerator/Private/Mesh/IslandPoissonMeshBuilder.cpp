@@ -30,3 +30,25 @@ void UIslandPoissonMeshBuilder::AddPoints_Implementation(UDualMeshBuilder* Build
 {
 	Builder->AddPoisson(Rng, MapSize - PoissonSize, PoissonSpacing, PoissonSamples);
 }
+
+int32 UIslandPoissonMeshBuilder::EstimateRegionNum() const
+{
+	if (PoissonSpacing <= 0.f)
+	{
+		return 0;
+	}
+	// Poisson disc sampling covers about this much of the area with points per squared spacing
+	constexpr double poissonDensity = 0.7;
+	const double points = poissonDensity * PoissonSize.X * PoissonSize.Y / FMath::Square(PoissonSpacing);
+	return EstimateBoundaryRegionNum() + static_cast<int32>(FMath::Min(points, static_cast<double>(MAX_int32 / 2)));
+}
+
+bool UIslandPoissonMeshBuilder::ScaleRegionNum(float Scale)
+{
+	if (Scale <= 0.f || PoissonSpacing <= 0.f)
+	{
+		return false;
+	}
+	PoissonSpacing /= FMath::Sqrt(Scale);
+	return true;
+}
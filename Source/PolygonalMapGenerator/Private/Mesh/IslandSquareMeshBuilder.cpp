@@ -35,3 +35,19 @@ void UIslandSquareMeshBuilder::AddPoints_Implementation(UDualMeshBuilder* Builde
 		}
 	}
 }
+
+int32 UIslandSquareMeshBuilder::EstimateRegionNum() const
+{
+	const int32 gridSize = FMath::CeilToInt(FMath::Sqrt(static_cast<float>(NumberOfPoints)));
+	return EstimateBoundaryRegionNum() + gridSize * gridSize;
+}
+
+bool UIslandSquareMeshBuilder::ScaleRegionNum(float Scale)
+{
+	if (Scale <= 0.f)
+	{
+		return false;
+	}
+	NumberOfPoints = FMath::Max(1, FMath::FloorToInt32(NumberOfPoints * Scale));
+	return true;
+}
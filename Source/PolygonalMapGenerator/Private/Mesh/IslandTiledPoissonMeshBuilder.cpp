@@ -0,0 +1,14 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Mesh/IslandTiledPoissonMeshBuilder.h"
+#include "DualMeshBuilder.h"
+
+UIslandTiledPoissonMeshBuilder::UIslandTiledPoissonMeshBuilder()
+{
+	TileCells = 64;
+}
+
+void UIslandTiledPoissonMeshBuilder::AddPoints_Implementation(UDualMeshBuilder* Builder, FRandomStream& Rng) const
+{
+	Builder->AddTiledPoisson(Rng, MapSize - PoissonSize, PoissonSpacing, PoissonSamples, TileCells);
+}
@@ -17,6 +17,17 @@
 */
 
 #include "Moisture/IslandMoisture.h"
+#include "Async/ParallelFor.h"
+#include "GenerationDiagnostics.h"
+#include "IslandMapUtils.h"
+#include "ScratchContainers.h"
+#include "PolygonalMapGenerator.h"
+
+namespace
+{
+	// Frontier regions per task of the water distance search
+	constexpr int32 FrontierBatchSize = 256;
+}
 
 TSet<FPointIndex> UIslandMoisture::FindRiverbanks(UTriangleDualMesh* Mesh, const TArray<int32>& s_flow) const
 {
@@ -47,65 +58,135 @@ TSet<FPointIndex> UIslandMoisture::FindLakeshores(UTriangleDualMesh* Mesh, const
 	return shores;
 }
 
-TSet<FPointIndex> UIslandMoisture::FindMoistureSeeds_Implementation(UTriangleDualMesh* Mesh, const TArray<int32>& s_flow, const TArray<bool>& r_ocean, const TArray<bool>& r_water) const
+TSet<FPointIndex> UIslandMoisture::FindLakeshores(UTriangleDualMesh* Mesh, TConstArrayView<ERegionFlags> r_flags) const
 {
-	TSet<FPointIndex> seeds;
-
-	seeds.Append(FindRiverbanks(Mesh, s_flow));
-	seeds.Append(FindLakeshores(Mesh, r_ocean, r_water));
-
-	return seeds;
+	TSet<FPointIndex> shores;
+	for (FSideIndex s = 0; s < Mesh->NumSolidSides; s++)
+	{
+		FPointIndex r = Mesh->s_begin_r(s);
+		if (EnumHasAnyFlags(r_flags[r], ERegionFlags::Lake))
+		{
+			shores.Add(r);
+			shores.Add(Mesh->s_end_r(s));
+		}
+	}
+	return shores;
 }
 
-void UIslandMoisture::AssignRegionMoisture_Implementation(TArray<float>& r_moisture, TArray<int32>& r_waterdistance, UTriangleDualMesh* Mesh, const TArray<bool>& r_water, const TSet<FPointIndex>& seed_r) const
+void UIslandMoisture::FindMoistureSeedRegions(TArray<uint8>& r_seed, UTriangleDualMesh* Mesh, const TArray<int32>& s_flow, const TArray<bool>& r_ocean, const TArray<bool>& r_water) const
 {
-	r_moisture.Empty(Mesh->NumRegions);
-	r_moisture.SetNumZeroed(Mesh->NumRegions);
-	r_waterdistance.Empty(Mesh->NumRegions);
-	r_waterdistance.SetNumZeroed(Mesh->NumRegions);
-	for (FPointIndex r = 0; r < r_waterdistance.Num(); r++)
+	TRACE_CPUPROFILER_EVENT_SCOPE(UIslandMoisture::FindMoistureSeedRegions)
+	r_seed.Reset();
+	r_seed.SetNumZeroed(Mesh->NumRegions);
+	// Neighbouring sides flag the same regions, but they only ever store a 1
+	ParallelFor(Mesh->NumSolidSides, [Mesh, &r_seed, &s_flow, &r_ocean, &r_water](const int32 side)
 	{
-		r_waterdistance[r] = -1;
-	}
-
-	TArray<FPointIndex> queue_r = seed_r.Array();
+		const FSideIndex s = side;
+		const FPointIndex r = Mesh->s_begin_r(s);
+		// Riverbanks, or lakeshores
+		if (s_flow[s] > 0 || (r_water[r] && !r_ocean[r]))
+		{
+			FPlatformAtomics::AtomicStore_Relaxed(reinterpret_cast<volatile int8*>(&r_seed[r]), 1);
+			FPlatformAtomics::AtomicStore_Relaxed(reinterpret_cast<volatile int8*>(&r_seed[Mesh->s_end_r(s)]), 1);
+		}
+	});
+}
 
-	// Set all freshwater regions to have distance 0 from water
-	for (FPointIndex r : queue_r)
+void UIslandMoisture::AssignMoistureFromSeeds(TArray<float>& r_moisture, TArray<int32>& r_waterdistance, UTriangleDualMesh* Mesh, const TArray<bool>& r_water, const TArray<uint8>& r_seed) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UIslandMoisture::AssignMoistureFromSeeds)
+	UIslandMapUtils::ResetLayer(r_moisture, Mesh->NumRegions);
+	UIslandMapUtils::ResetLayer(r_waterdistance, Mesh->NumRegions, -1);
+
+	// Every region enters the queue at most once, so it never grows past the region count.
+	// The regions of one distance sit next to each other, starting with the seeds at distance 0.
+	FMemMark mark(FMemStack::Get());
+	TScratchArray<int32> queue_r;
+	queue_r.SetNumUninitialized(Mesh->NumRegions);
+	int32 tail = 0;
+	for (int32 r = 0; r < r_seed.Num() && r < Mesh->NumRegions; r++)
 	{
-		r_waterdistance[r] = 0;
+		if (r_seed[r])
+		{
+			r_waterdistance[r] = 0;
+			queue_r[tail++] = r;
+		}
 	}
 
 	int32 maxDistance = 1;
 
-	while (queue_r.Num() > 0)
+	// Expand one distance at a time. Whichever thread claims a region first, it gets the same distance,
+	// so the result matches a serial breadth-first search; only the order inside a level varies.
+	int32 levelBegin = 0;
+	for (int32 distance = 1; levelBegin < tail; distance++)
 	{
-		FPointIndex current_r = queue_r[0];
-		queue_r.RemoveAt(0);
-		TArray<FPointIndex> out_r = Mesh->r_circulate_r(current_r);
-		for (FPointIndex neighbor_r : out_r)
+		const int32 levelEnd = tail;
+		const int32 batchNum = FMath::DivideAndRoundUp(levelEnd - levelBegin, FrontierBatchSize);
+		ParallelForWithDiagnostics(batchNum, [Mesh, &r_water, &r_waterdistance, &queue_r, &tail, levelBegin, levelEnd, distance](const int32 batch)
 		{
-			if (!r_water[neighbor_r] && r_waterdistance[neighbor_r] == -1)
+			const int32 end = FMath::Min(levelBegin + (batch + 1) * FrontierBatchSize, levelEnd);
+			for (int32 i = levelBegin + batch * FrontierBatchSize; i < end; i++)
 			{
-				int32 newDistance = 1 + r_waterdistance[current_r];
-				r_waterdistance[neighbor_r] = newDistance;
-				if (newDistance > maxDistance) { maxDistance = newDistance; }
-				queue_r.Add(neighbor_r);
+				Mesh->r_circulate_r(queue_r[i], [&](FPointIndex neighbor_r)
+				{
+					if (!r_water[neighbor_r] && FPlatformAtomics::AtomicRead(&r_waterdistance[neighbor_r]) == -1
+						&& FPlatformAtomics::InterlockedCompareExchange(&r_waterdistance[neighbor_r], distance, -1) == -1)
+					{
+						queue_r[FPlatformAtomics::InterlockedIncrement(&tail) - 1] = neighbor_r;
+					}
+				});
 			}
+		});
+		if (tail > levelEnd)
+		{
+			maxDistance = FMath::Max(maxDistance, distance);
 		}
+		levelBegin = levelEnd;
 	}
 
 	// Actually set the moisture
-	for (FPointIndex r = 0; r < r_waterdistance.Num(); r++)
+	ParallelFor(r_waterdistance.Num(), [&r_moisture, &r_waterdistance, &r_water, maxDistance](const int32 r)
 	{
 		r_moisture[r] = r_water[r] ? 1.0f : 1.0f - FMath::Pow((float)r_waterdistance[r] / maxDistance, 0.5f);
+	});
+}
+
+TSet<FPointIndex> UIslandMoisture::FindMoistureSeeds_Implementation(UTriangleDualMesh* Mesh, const TArray<int32>& s_flow, const TArray<bool>& r_ocean, const TArray<bool>& r_water) const
+{
+	TArray<uint8> r_seed;
+	FindMoistureSeedRegions(r_seed, Mesh, s_flow, r_ocean, r_water);
+
+	TSet<FPointIndex> seeds;
+	for (int32 r = 0; r < r_seed.Num(); r++)
+	{
+		if (r_seed[r])
+		{
+			seeds.Add(r);
+		}
 	}
+	return seeds;
+}
+
+void UIslandMoisture::AssignRegionMoisture_Implementation(TArray<float>& r_moisture, TArray<int32>& r_waterdistance, UTriangleDualMesh* Mesh, const TArray<bool>& r_water, const TSet<FPointIndex>& seed_r) const
+{
+	TArray<uint8> r_seed;
+	r_seed.SetNumZeroed(Mesh->NumRegions);
+	for (FPointIndex r : seed_r)
+	{
+		if (r_seed.IsValidIndex(r))
+		{
+			r_seed[r] = 1;
+		}
+	}
+	AssignMoistureFromSeeds(r_moisture, r_waterdistance, Mesh, r_water, r_seed);
 }
 
 void UIslandMoisture::RedistributeRegionMoisture_Implementation(TArray<float>& r_moisture, UTriangleDualMesh* Mesh, const TArray<bool>& r_water, float MinMoisture, float MaxMoisture) const
 {
-	TArray<FPointIndex> land_r;
-	for (FPointIndex r = 0; r < Mesh->NumSolidRegions; r++)
+	TRACE_CPUPROFILER_EVENT_SCOPE(UIslandMoisture::RedistributeRegionMoisture)
+	TArray<int32> land_r;
+	land_r.Reserve(Mesh->NumSolidRegions);
+	for (int32 r = 0; r < Mesh->NumSolidRegions; r++)
 	{
 		if (!r_water[r])
 		{
@@ -118,28 +199,36 @@ void UIslandMoisture::RedistributeRegionMoisture_Implementation(TArray<float>& r
 		return;
 	}
 
-	land_r.Sort([r_moisture](const FPointIndex& A, const FPointIndex& B)
-	{
-		return r_moisture[A] < r_moisture[B];
-	});
+	UIslandMapUtils::SortIndicesByValue(land_r, r_moisture);
 
-	for (int i = 0; i < land_r.Num(); i++)
+	ParallelFor(land_r.Num(), [&r_moisture, &land_r, MinMoisture, MaxMoisture](const int32 i)
 	{
 		r_moisture[land_r[i]] = MinMoisture + (MaxMoisture - MinMoisture) * i / ((float)land_r.Num() - 1.0f);
-	}
+	});
 }
 
 void UIslandMoisture::assign_r_moisture(TArray<float>& r_moisture, TArray<int32>& r_waterdistance, UTriangleDualMesh* Mesh, const TArray<bool>& r_water, const TSet<FPointIndex>& r_moisture_seeds) const
 {
-	AssignRegionMoisture(r_moisture, r_waterdistance, Mesh, r_water, r_moisture_seeds);
+	ISLAND_CALL_NATIVE_OR_EVENT(UIslandMoisture, AssignRegionMoisture, r_moisture, r_waterdistance, Mesh, r_water, r_moisture_seeds);
+}
+
+void UIslandMoisture::assign_r_moisture(TArray<float>& r_moisture, TArray<int32>& r_waterdistance, UTriangleDualMesh* Mesh, const TArray<int32>& s_flow, const TArray<bool>& r_ocean, const TArray<bool>& r_water) const
+{
+	if (Mesh == NULL)
+	{
+		UE_LOG(LogMapGen, Error, TEXT("Mesh was invalid!"));
+		return;
+	}
+	// Through both aliases, so C++ overrides of either implementation run as well as Blueprint ones
+	assign_r_moisture(r_moisture, r_waterdistance, Mesh, r_water, find_moisture_seeds_r(Mesh, s_flow, r_ocean, r_water));
 }
 
 void UIslandMoisture::redistribute_r_moisture(TArray<float>& r_moisture, UTriangleDualMesh* Mesh, const TArray<bool>& r_water, float MinMoisture, float MaxMoisture) const
 {
-	RedistributeRegionMoisture(r_moisture, Mesh, r_water, MinMoisture, MaxMoisture);
+	ISLAND_CALL_NATIVE_OR_EVENT(UIslandMoisture, RedistributeRegionMoisture, r_moisture, Mesh, r_water, MinMoisture, MaxMoisture);
 }
 
 TSet<FPointIndex> UIslandMoisture::find_moisture_seeds_r(UTriangleDualMesh* Mesh, const TArray<int32>& s_flow, const TArray<bool>& r_ocean, const TArray<bool>& r_water) const
 {
-	return FindMoistureSeeds(Mesh, s_flow, r_ocean, r_water);
+	return ISLAND_CALL_NATIVE_OR_EVENT(UIslandMoisture, FindMoistureSeeds, Mesh, s_flow, r_ocean, r_water);
 }
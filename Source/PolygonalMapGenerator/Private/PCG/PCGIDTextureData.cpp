@@ -3,6 +3,7 @@
 
 #include "PCG/PCGIDTextureData.h"
 
+#include "Async/ParallelFor.h"
 #include "Data/PCGPointData.h"
 #include "Helpers/PCGAsync.h"
 #include "Helpers/PCGHelpers.h"
@@ -15,6 +16,53 @@
 
 using namespace IDTextureFixedName;
 
+namespace
+{
+	/** Rows of the texel grid sampled by one ParallelFor task of CreateDistrictPointData. */
+	constexpr int32 RowsPerBatch = 16;
+	/** Points sampled by one ParallelFor task of SamplePoints. */
+	constexpr int32 PointsPerBatch = 1024;
+
+	template <typename T>
+	FPCGMetadataAttribute<T>* FindTypedAttribute(UPCGMetadata* Metadata, const FName AttributeName)
+	{
+		FPCGMetadataAttributeBase* Attribute = Metadata->GetMutableAttribute(AttributeName);
+		return Attribute && Attribute->GetTypeId() == PCG::Private::MetadataTypes<T>::Id
+			       ? static_cast<FPCGMetadataAttribute<T>*>(Attribute)
+			       : nullptr;
+	}
+
+	/** X and Y are in texels, with the texel centers on whole numbers for the bilinear filter. */
+	FPixelData SampleLevel(const FIDTextueData& Level, const EPCGIDTextureFilter Filter, const double X,
+	                       const double Y)
+	{
+		if (Filter == EPCGIDTextureFilter::Nearest)
+		{
+			const int32 TexelX = FMath::Clamp(static_cast<int32>(X), 0, Level.Width - 1);
+			const int32 TexelY = FMath::Clamp(static_cast<int32>(Y), 0, Level.Height - 1);
+			return Level.Data[TexelX + TexelY * Level.Width].Unpack();
+		}
+		const int32 X0 = FMath::FloorToInt32(X);
+		const int32 Y0 = FMath::FloorToInt32(Y);
+		const float FracX = static_cast<float>(X - X0);
+		const float FracY = static_cast<float>(Y - Y0);
+		FDistrictProportionBlend Blend;
+		for (int32 Offset = 0; Offset < 4; ++Offset)
+		{
+			const int32 DX = Offset & 1;
+			const int32 DY = Offset >> 1;
+			const float Weight = (DX ? FracX : 1.f - FracX) * (DY ? FracY : 1.f - FracY);
+			if (Weight > 0.f)
+			{
+				const int32 TexelX = FMath::Clamp(X0 + DX, 0, Level.Width - 1);
+				const int32 TexelY = FMath::Clamp(Y0 + DY, 0, Level.Height - 1);
+				Blend.Add(Level.Data[TexelX + TexelY * Level.Width], Weight);
+			}
+		}
+		return Blend.Resolve();
+	}
+}
+
 FBox UPCGIDTextureData::GetBounds() const
 {
 	return Bounds;
@@ -42,20 +90,15 @@ bool UPCGIDTextureData::SamplePoint(const FTransform& InTransform, const FBox& I
 
 	FVector2D Position2D(PointPositionInLocalSpace.X, PointPositionInLocalSpace.Y);
 
-	FVector2D PointPositionInTextureSpace = (Position2D + 1) / 2;
-	PointPositionInTextureSpace.X *= TextureData->Width - 1;
-	PointPositionInTextureSpace.Y *= TextureData->Height - 1;
-	// PointPositionInTextureSpace.X += 0.5f;
-	// PointPositionInTextureSpace.Y += 0.5f;
-
-	int32 Index = static_cast<int32>(PointPositionInTextureSpace.X)
-		+ static_cast<int32>(PointPositionInTextureSpace.Y)
-		* TextureData->Width;
-	if (Index < 0 || Index >= TextureData->Data.Num())
+	const FVector2D PointPositionInUVSpace = (Position2D + 1) / 2;
+	if (PointPositionInUVSpace.X < 0 || PointPositionInUVSpace.Y < 0 || PointPositionInUVSpace.X > 1
+		|| PointPositionInUVSpace.Y > 1)
 	{
 		return false;
 	}
-	FPixelData& PixelData = TextureData->Data[Index];
+	const FIDTextueData& Level = SelectLevel(*TextureData, MipChain.Get(), Transform, TexelSize);
+	const FPixelData PixelData = SampleLevel(Level, Filter, PointPositionInUVSpace.X * (Level.Width - 1),
+	                                         PointPositionInUVSpace.Y * (Level.Height - 1));
 	OutPoint.Density = ((DensityFunction == EPCGIDTextureDensityFunction::Ignore)
 		                    ? 1.0f
 		                    : PixelData.DistrictID1 == PrimaryID
@@ -77,6 +120,111 @@ bool UPCGIDTextureData::SamplePoint(const FTransform& InTransform, const FBox& I
 	return OutPoint.Density > 0;
 }
 
+void UPCGIDTextureData::SamplePoints(const TArrayView<const TPair<FTransform, FBox>>& Samples,
+                                     const TArrayView<FPCGPoint>& OutPoints, UPCGMetadata* OutMetadata) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UPCGIDTextureData::SamplePoints);
+	check(Samples.Num() == OutPoints.Num());
+	if (!IsValid())
+	{
+		for (FPCGPoint& OutPoint : OutPoints)
+		{
+			OutPoint.Density = 0.f;
+		}
+		return;
+	}
+
+	// The transform is inverted and the level selected once for the whole range
+	const FMatrix ToLocal = Transform.ToInverseMatrixWithScale();
+	const FMatrix ToWorld = Transform.ToMatrixWithScale();
+	const FIDTextueData& Level = SelectLevel(*TextureData, MipChain.Get(), Transform, TexelSize);
+	TArray<FPixelData> Pixels;
+	Pixels.SetNumUninitialized(Samples.Num());
+	TArray<bool> Inside;
+	Inside.SetNumUninitialized(Samples.Num());
+	ParallelFor(FMath::DivideAndRoundUp(Samples.Num(), PointsPerBatch), [&](const int32 Batch)
+	{
+		const int32 End = FMath::Min((Batch + 1) * PointsPerBatch, Samples.Num());
+		for (int32 Index = Batch * PointsPerBatch; Index < End; ++Index)
+		{
+			FPCGPoint& OutPoint = OutPoints[Index];
+			FVector LocalPosition = ToLocal.TransformPosition(Samples[Index].Key.GetLocation());
+			LocalPosition.Z = 0;
+			OutPoint.Transform = Samples[Index].Key;
+			OutPoint.Transform.SetLocation(ToWorld.TransformPosition(LocalPosition));
+			OutPoint.SetLocalBounds(Samples[Index].Value);
+			const double U = (LocalPosition.X + 1) / 2;
+			const double V = (LocalPosition.Y + 1) / 2;
+			Inside[Index] = U >= 0 && V >= 0 && U <= 1 && V <= 1;
+			if (!Inside[Index])
+			{
+				OutPoint.Density = 0.f;
+				continue;
+			}
+			const FPixelData& PixelData = Pixels[Index] = SampleLevel(Level, Filter, U * (Level.Width - 1),
+			                                                          V * (Level.Height - 1));
+			OutPoint.Density = DensityFunction == EPCGIDTextureDensityFunction::Ignore
+				                   ? 1.0f
+				                   : PixelData.DistrictID1 == PrimaryID
+				                   ? PixelData.Proportion1
+				                   : 0.f;
+		}
+	});
+
+	// Attributes are written by one thread, looked up once for the range instead of once per point
+	if (OutMetadata == nullptr)
+	{
+		return;
+	}
+	FPCGMetadataAttribute<int32>* PrimaryIDAttribute = FindTypedAttribute<int32>(OutMetadata, DataAttrPrimaryID);
+	FPCGMetadataAttribute<int32>* DistrictIDAttributes[] = {
+		FindTypedAttribute<int32>(OutMetadata, DataAttrDistrictID1),
+		FindTypedAttribute<int32>(OutMetadata, DataAttrDistrictID2),
+		FindTypedAttribute<int32>(OutMetadata, DataAttrDistrictID3),
+		FindTypedAttribute<int32>(OutMetadata, DataAttrDistrictID4)
+	};
+	FPCGMetadataAttribute<float>* ProportionAttributes[] = {
+		FindTypedAttribute<float>(OutMetadata, DataAttrProportion1),
+		FindTypedAttribute<float>(OutMetadata, DataAttrProportion2),
+		FindTypedAttribute<float>(OutMetadata, DataAttrProportion3),
+		FindTypedAttribute<float>(OutMetadata, DataAttrProportion4)
+	};
+	for (int32 Index = 0; Index < OutPoints.Num(); ++Index)
+	{
+		const PCGMetadataEntryKey Key = OutPoints[Index].MetadataEntry;
+		if (Key == PCGInvalidEntryKey)
+		{
+			continue;
+		}
+		if (PrimaryIDAttribute)
+		{
+			PrimaryIDAttribute->SetValue(Key, PrimaryID);
+		}
+		if (!Inside[Index])
+		{
+			continue;
+		}
+		const FPixelData& PixelData = Pixels[Index];
+		const int32 DistrictIDs[] = {
+			PixelData.DistrictID1, PixelData.DistrictID2, PixelData.DistrictID3, PixelData.DistrictID4
+		};
+		const float Proportions[] = {
+			PixelData.Proportion1, PixelData.Proportion2, PixelData.Proportion3, PixelData.Proportion4
+		};
+		for (int32 Slot = 0; Slot < 4; ++Slot)
+		{
+			if (DistrictIDAttributes[Slot])
+			{
+				DistrictIDAttributes[Slot]->SetValue(Key, DistrictIDs[Slot]);
+			}
+			if (ProportionAttributes[Slot])
+			{
+				ProportionAttributes[Slot]->SetValue(Key, Proportions[Slot]);
+			}
+		}
+	}
+}
+
 const UPCGPointData* UPCGIDTextureData::CreatePointData(FPCGContext* Context) const
 {
 	TRACE_CPUPROFILER_EVENT_SCOPE(UPCGIDTextureData::CreatePointData);
@@ -112,20 +260,24 @@ const UPCGPointData* UPCGIDTextureData::CreatePointData(FPCGContext* Context) co
 	}
 
 	UPCGMetadata* OutMetadata = Data->MutableMetadata();
-	TArray<FPixelData>& OriTextureData = TextureData.Get()->Data;
+	const FIDTextueData& Level = SelectLevel(*TextureData, MipChain.Get(), Transform, TexelSize);
 	FPCGAsync::AsyncPointProcessing(
 		Context, PointCount, Points,
-		[this, XCount, YCount, &OriTextureData, &OutMetadata](int32 Index, FPCGPoint& OutPoint)
+		[this, XCount, YCount, &Level, &OutMetadata](int32 Index, FPCGPoint& OutPoint)
 		{
 			const int LocalX = Index % XCount;
-			const int LocalY = Index / YCount;
-			const int X = static_cast<float>(LocalX) / XCount * Width;
-			const int Y = static_cast<float>(LocalY) / YCount * Height;
-			if (X >= Width || Y >= Height)
+			const int LocalY = Index / XCount;
+			const int X = static_cast<float>(LocalX) / XCount * Level.Width;
+			const int Y = static_cast<float>(LocalY) / YCount * Level.Height;
+			if (X >= Level.Width || Y >= Level.Height)
 			{
 				return false;
 			}
-			FPixelData& PixelData = OriTextureData[X + Y * Width];
+			const FPixelData PixelData = Filter == EPCGIDTextureFilter::Nearest
+				                             ? Level.Data[X + Y * Level.Width].Unpack()
+				                             : SampleLevel(Level, Filter,
+				                                           (LocalX + 0.5) / XCount * Level.Width - 0.5,
+				                                           (LocalY + 0.5) / YCount * Level.Height - 0.5);
 			const float Density = (
 				(DensityFunction == EPCGIDTextureDensityFunction::Ignore)
 					? 1.0f
@@ -173,6 +325,162 @@ const UPCGPointData* UPCGIDTextureData::CreatePointData(FPCGContext* Context) co
 	return Data;
 }
 
+void UPCGIDTextureData::CreateDistrictPointData(const FIDTextueData& InTextureData,
+                                                const FIDTextueMipChain* InMipChain, const FTransform& InTransform,
+                                                const EPCGIDTextureDensityFunction InDensityFunction,
+                                                const float InTexelSize, const EPCGIDTextureFilter InFilter,
+                                                TConstArrayView<int32> InDistrictIDs,
+                                                TArrayView<UPCGPointData* const> OutData)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UPCGIDTextureData::CreateDistrictPointData);
+	const FIDTextueData& Level = SelectLevel(InTextureData, InMipChain, InTransform, InTexelSize);
+	const int32 TextureWidth = Level.Width;
+	const int32 TextureHeight = Level.Height;
+	const int32 XCount = FMath::Floor(2.0 * InTransform.GetScale3D().X / InTexelSize);
+	const int32 YCount = FMath::Floor(2.0 * InTransform.GetScale3D().Y / InTexelSize);
+	const int32 DistrictNum = OutData.Num();
+	if (TextureWidth <= 0 || TextureHeight <= 0 || XCount <= 0 || YCount <= 0 || DistrictNum == 0)
+	{
+		UE_LOG(LogPCG, Warning, TEXT("Texture data has no texel to sample - will return empty data"));
+		return;
+	}
+	check(InDistrictIDs.Num() == DistrictNum);
+	// The output of every 8 bit district ID
+	int32 DistrictOutputs[256];
+	for (int32& Output : DistrictOutputs)
+	{
+		Output = INDEX_NONE;
+	}
+	for (int32 Output = 0; Output < DistrictNum; ++Output)
+	{
+		if (InDistrictIDs[Output] >= 0 && InDistrictIDs[Output] < 256)
+		{
+			DistrictOutputs[InDistrictIDs[Output]] = Output;
+		}
+	}
+
+	// Points of every batch and district, next to the pixel each of them was sampled from
+	const int32 BatchNum = FMath::DivideAndRoundUp(YCount, RowsPerBatch);
+	TArray<TArray<FPCGPoint>> BatchPoints;
+	TArray<TArray<FPixelData>> BatchPixels;
+	BatchPoints.SetNum(BatchNum * DistrictNum);
+	BatchPixels.SetNum(BatchNum * DistrictNum);
+	ParallelFor(BatchNum, [&](const int32 Batch)
+	{
+		const FVector Extents(InTexelSize / 2.0);
+		auto AddPoint = [&](const int32 District, const FVector& Location, const FPixelData& PixelData,
+		                    const float Density, const int32 X, const int32 Y)
+		{
+			const int32 Slot = Batch * DistrictNum + District;
+			FPCGPoint& Point = BatchPoints[Slot].Emplace_GetRef(FTransform(Location), Density,
+			                                                    PCGHelpers::ComputeSeed(X, Y));
+			Point.SetExtents(Extents);
+			BatchPixels[Slot].Add(PixelData);
+		};
+		const int32 EndY = FMath::Min((Batch + 1) * RowsPerBatch, YCount);
+		for (int32 LocalY = Batch * RowsPerBatch; LocalY < EndY; ++LocalY)
+		{
+			const int32 Y = static_cast<float>(LocalY) / YCount * TextureHeight;
+			for (int32 LocalX = 0; LocalX < XCount && Y < TextureHeight; ++LocalX)
+			{
+				const int32 X = static_cast<float>(LocalX) / XCount * TextureWidth;
+				if (X >= TextureWidth)
+				{
+					break;
+				}
+				const FPixelData PixelData = InFilter == EPCGIDTextureFilter::Nearest
+					                             ? Level.Data[X + Y * TextureWidth].Unpack()
+					                             : SampleLevel(Level, InFilter,
+					                                           (LocalX + 0.5) / XCount * TextureWidth - 0.5,
+					                                           (LocalY + 0.5) / YCount * TextureHeight - 0.5);
+				const FVector Location = InTransform.TransformPosition(
+					FVector((2.0 * LocalX + 0.5) / XCount - 1.0, (2.0 * LocalY + 0.5) / YCount - 1.0, 0));
+				if (InDensityFunction == EPCGIDTextureDensityFunction::Ignore)
+				{
+					for (int32 District = 0; District < DistrictNum; ++District)
+					{
+						AddPoint(District, Location, PixelData, 1.f, X, Y);
+					}
+				}
+				else if (PixelData.DistrictID1 >= 1 && PixelData.DistrictID1 < 256
+					&& DistrictOutputs[PixelData.DistrictID1] != INDEX_NONE && PixelData.Proportion1 > 0)
+				{
+					AddPoint(DistrictOutputs[PixelData.DistrictID1], Location, PixelData, PixelData.Proportion1, X, Y);
+				}
+			}
+		}
+	});
+
+	// Every output owns its metadata, so the outputs are merged and attributed side by side
+	ParallelFor(DistrictNum, [&](const int32 District)
+	{
+		UPCGPointData* Data = OutData[District];
+		UPCGMetadata* Metadata = Data->MutableMetadata();
+		Metadata->CreateInteger32Attribute(DataAttrPrimaryID, 0, false, true);
+		Metadata->CreateInteger32Attribute(DataAttrDistrictID1, 0, false, true);
+		Metadata->CreateFloatAttribute(DataAttrProportion1, 0.f, false, true);
+		Metadata->CreateInteger32Attribute(DataAttrDistrictID2, 0, false, true);
+		Metadata->CreateFloatAttribute(DataAttrProportion2, 0.f, false, true);
+		Metadata->CreateInteger32Attribute(DataAttrDistrictID3, 0, false, true);
+		Metadata->CreateFloatAttribute(DataAttrProportion3, 0.f, false, true);
+		Metadata->CreateInteger32Attribute(DataAttrDistrictID4, 0, false, true);
+		Metadata->CreateFloatAttribute(DataAttrProportion4, 0.f, false, true);
+		// Looked up once per output instead of once per point
+		FPCGMetadataAttribute<int32>* PrimaryIDAttribute = FindTypedAttribute<int32>(Metadata, DataAttrPrimaryID);
+		FPCGMetadataAttribute<int32>* DistrictID1Attribute = FindTypedAttribute<int32>(Metadata, DataAttrDistrictID1);
+		FPCGMetadataAttribute<int32>* DistrictID2Attribute = FindTypedAttribute<int32>(Metadata, DataAttrDistrictID2);
+		FPCGMetadataAttribute<int32>* DistrictID3Attribute = FindTypedAttribute<int32>(Metadata, DataAttrDistrictID3);
+		FPCGMetadataAttribute<int32>* DistrictID4Attribute = FindTypedAttribute<int32>(Metadata, DataAttrDistrictID4);
+		FPCGMetadataAttribute<float>* Proportion1Attribute = FindTypedAttribute<float>(Metadata, DataAttrProportion1);
+		FPCGMetadataAttribute<float>* Proportion2Attribute = FindTypedAttribute<float>(Metadata, DataAttrProportion2);
+		FPCGMetadataAttribute<float>* Proportion3Attribute = FindTypedAttribute<float>(Metadata, DataAttrProportion3);
+		FPCGMetadataAttribute<float>* Proportion4Attribute = FindTypedAttribute<float>(Metadata, DataAttrProportion4);
+
+		TArray<FPCGPoint>& Points = Data->GetMutablePoints();
+		int32 PointNum = 0;
+		for (int32 Batch = 0; Batch < BatchNum; ++Batch)
+		{
+			PointNum += BatchPoints[Batch * DistrictNum + District].Num();
+		}
+		Points.Reserve(PointNum);
+		for (int32 Batch = 0; Batch < BatchNum; ++Batch)
+		{
+			const int32 Slot = Batch * DistrictNum + District;
+			const int32 First = Points.Num();
+			Points.Append(MoveTemp(BatchPoints[Slot]));
+			for (int32 Index = 0; Index < BatchPixels[Slot].Num(); ++Index)
+			{
+				const FPixelData& PixelData = BatchPixels[Slot][Index];
+				const PCGMetadataEntryKey Key = Metadata->AddEntry();
+				Points[First + Index].MetadataEntry = Key;
+				PrimaryIDAttribute->SetValue(Key, InDistrictIDs[District]);
+				DistrictID1Attribute->SetValue(Key, PixelData.DistrictID1);
+				DistrictID2Attribute->SetValue(Key, PixelData.DistrictID2);
+				DistrictID3Attribute->SetValue(Key, PixelData.DistrictID3);
+				DistrictID4Attribute->SetValue(Key, PixelData.DistrictID4);
+				Proportion1Attribute->SetValue(Key, PixelData.Proportion1);
+				Proportion2Attribute->SetValue(Key, PixelData.Proportion2);
+				Proportion3Attribute->SetValue(Key, PixelData.Proportion3);
+				Proportion4Attribute->SetValue(Key, PixelData.Proportion4);
+			}
+		}
+	});
+}
+
+const FIDTextueData& UPCGIDTextureData::SelectLevel(const FIDTextueData& InTextureData,
+                                                    const FIDTextueMipChain* InMipChain,
+                                                    const FTransform& InTransform, const float InTexelSize)
+{
+	const int32 XCount = FMath::Floor(2.0 * InTransform.GetScale3D().X / InTexelSize);
+	const int32 YCount = FMath::Floor(2.0 * InTransform.GetScale3D().Y / InTexelSize);
+	if (InMipChain == nullptr || XCount <= 0 || YCount <= 0)
+	{
+		return InTextureData;
+	}
+	// The denser direction decides, so that no direction skips texels
+	return InMipChain->FindLevel(FMath::Min(static_cast<double>(InTextureData.Width) / XCount,
+	                                        static_cast<double>(InTextureData.Height) / YCount));
+}
 
 bool UPCGIDTextureData::IsValid() const
 {
@@ -185,12 +493,13 @@ void UPCGIDTextureData::CopyBaseTextureData(UPCGIDTextureData* NewTextureData) c
 	NewTextureData->PrimaryID = PrimaryID;
 	NewTextureData->DensityFunction = DensityFunction;
 	NewTextureData->TexelSize = TexelSize;
+	NewTextureData->Filter = Filter;
 	NewTextureData->Bounds = Bounds;
 	NewTextureData->Height = Height;
 	NewTextureData->Width = Width;
 }
 
-void UPCGIDTextureData::Initialize(const TSharedPtr<FIDTextueData, ESPMode::ThreadSafe>& InTextureData,
+void UPCGIDTextureData::Initialize(const TSharedPtr<const FIDTextueData, ESPMode::ThreadSafe>& InTextureData,
                                    const FTransform& InTransform)
 {
 	TextureData = InTextureData;
@@ -208,7 +517,7 @@ bool UPCGIDTextureData::IsSupported(UTexture2D* InTexture)
 	const FTexturePlatformData* PlatformData = InTexture ? InTexture->GetPlatformData() : nullptr;
 
 	return PlatformData && PlatformData->Mips.Num() > 0 &&
-		(PlatformData->PixelFormat == PF_FloatRGBA);
+		(PlatformData->PixelFormat == PF_FloatRGBA || PlatformData->PixelFormat == PF_R8G8B8A8);
 }
 
 UPCGSpatialData* UPCGIDTextureData::CopyInternal() const
@@ -218,6 +527,7 @@ UPCGSpatialData* UPCGIDTextureData::CopyInternal() const
 	CopyBaseTextureData(NewTextureData);
 
 	NewTextureData->TextureData = TextureData;
+	NewTextureData->MipChain = MipChain;
 
 	return NewTextureData;
 }
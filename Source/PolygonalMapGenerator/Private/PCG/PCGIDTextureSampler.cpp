@@ -11,8 +11,10 @@
 #include "Helpers/PCGHelpers.h"
 #include "Helpers/PCGSettingsHelpers.h"
 
+#include "Data/PCGPointData.h"
 #include "Engine/Texture2D.h"
 #include "GameFramework/Actor.h"
+#include "IslandDynamicAssets.h"
 #include "PCG/PCGIDTextureData.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(PCGIDTextureSampler)
@@ -24,22 +26,16 @@ using namespace IDTextureFixedName;
 TArray<FPCGPinProperties> UPCGIDTextureSamplerSettings::OutputPinProperties() const
 {
 	TArray<FPCGPinProperties> Properties;
-	Properties.Emplace(OutNameDistrict1, EPCGDataType::Texture);
-	Properties.Emplace(OutNameDistrict2, EPCGDataType::Texture);
-	Properties.Emplace(OutNameDistrict3, EPCGDataType::Texture);
-	Properties.Emplace(OutNameDistrict4, EPCGDataType::Texture);
-	Properties.Emplace(OutNameDistrict5, EPCGDataType::Texture);
-	Properties.Emplace(OutNameDistrict6, EPCGDataType::Texture);
-	Properties.Emplace(OutNameDistrict7, EPCGDataType::Texture);
-	Properties.Emplace(OutNameDistrict8, EPCGDataType::Texture);
-	Properties.Emplace(OutNameDistrict9, EPCGDataType::Texture);
-	Properties.Emplace(OutNameDistrict10, EPCGDataType::Texture);
-	Properties.Emplace(OutNameDistrict11, EPCGDataType::Texture);
-	Properties.Emplace(OutNameDistrict12, EPCGDataType::Texture);
-	Properties.Emplace(OutNameDistrict13, EPCGDataType::Texture);
-	Properties.Emplace(OutNameDistrict14, EPCGDataType::Texture);
-	Properties.Emplace(OutNameDistrict15, EPCGDataType::Texture);
-	Properties.Emplace(OutNameDistrict16, EPCGDataType::Texture);
+	const EPCGDataType PinType = bSinglePassPointData ? EPCGDataType::Point : EPCGDataType::Texture;
+	if (bDynamicDistrictOutputs)
+	{
+		Properties.Emplace(OutNameDistricts, PinType);
+		return Properties;
+	}
+	for (int32 DistrictID = 1; DistrictID <= DistrictPinNum; ++DistrictID)
+	{
+		Properties.Emplace(GetDistrictName(DistrictID), PinType);
+	}
 	return Properties;
 }
 
@@ -55,21 +51,34 @@ bool FPCGIDTextureSamplerElement::ExecuteInternal(FPCGContext* Context) const
 	const UPCGIDTextureSamplerSettings* Settings = Context->GetInputSettings<UPCGIDTextureSamplerSettings>();
 	check(Settings);
 
-	if (!Settings->IDTexture1)
+	UTexture2D* IDTexture1 = Settings->IDTexture1;
+	UTexture2D* IDTexture2 = Settings->IDTexture2;
+	if (Settings->DynamicAssets)
+	{
+		if (Settings->DynamicAssets->IsGenerating())
+		{
+			PCGE_LOG(Error, GraphAndLog, LOCTEXT("DynamicAssetsGenerating", "DynamicAssets are still generating"));
+			return true;
+		}
+		IDTexture1 = Settings->DynamicAssets->GetDistrictIDTexture01();
+		IDTexture2 = Settings->DynamicAssets->GetDistrictIDTexture02();
+	}
+
+	if (!IDTexture1)
 	{
 		PCGE_LOG(Error, GraphAndLog, LOCTEXT("IDTexture1IsNull", "IDTexture1 is Null"));
 		return true;
 	}
-	if (!Settings->IDTexture2)
+	if (!IDTexture2)
 	{
 		PCGE_LOG(Error, GraphAndLog, LOCTEXT("IDTexture2IsNull", "IDTexture2 is Null"));
 		return true;
 	}
 
-	if (!UPCGIDTextureData::IsSupported(Settings->IDTexture1) || !UPCGIDTextureData::IsSupported(Settings->IDTexture2))
+	if (!UPCGIDTextureData::IsSupported(IDTexture1) || !UPCGIDTextureData::IsSupported(IDTexture2))
 	{
 		PCGE_LOG(Error, GraphAndLog, LOCTEXT("UnsupportedTextureFormat",
-			         "Texture has unsupported texture format, currently supported formats are FloatRGBA (Half float)."
+			         "Texture has unsupported texture format, currently supported formats are FloatRGBA (Half float) and R8G8B8A8."
 		         ));
 		return true;
 	}
@@ -78,6 +87,7 @@ bool FPCGIDTextureSamplerElement::ExecuteInternal(FPCGContext* Context) const
 	const bool bUseAbsoluteTransform = Settings->bUseAbsoluteTransform;
 	const EPCGIDTextureDensityFunction DensityFunction = Settings->DensityFunction;
 	const float TexelSize = Settings->TexelSize;
+	const EPCGIDTextureFilter Filter = Settings->Filter;
 
 	AActor* OriginalActor = UPCGBlueprintHelpers::GetOriginalComponent(*Context)->GetOwner();
 	FTransform FinalTransform = Transform;
@@ -92,12 +102,53 @@ bool FPCGIDTextureSamplerElement::ExecuteInternal(FPCGContext* Context) const
 	}
 
 	TArray<FPCGTaggedData>& Outputs = Context->OutputData.TaggedData;
-	TSharedRef<FIDTextueData> OriginalIDTextueData = CreateOriginalIDTextureData(
-		Settings->IDTexture1, Settings->IDTexture2);
-	for (int32 ID = 1; ID <= 16; ++ID)
+	// Decoded once per texture revision and shared by all outputs and later executions
+	const TSharedRef<const FIDTextueData, ESPMode::ThreadSafe> OriginalIDTextueData =
+		FDistrictIDDataCache::Get().FindOrDecode(IDTexture1, IDTexture2);
+	TSharedPtr<const FIDTextueMipChain, ESPMode::ThreadSafe> MipChain;
+	if (Settings->bUseMipChain)
+	{
+		MipChain = FDistrictIDDataCache::Get().FindOrBuildMipChain(IDTexture1, IDTexture2);
+	}
+	// Only the districts that exist get an output, whatever their count, when the outputs are dynamic
+	TArray<int32> DistrictIDs;
+	if (Settings->bDynamicDistrictOutputs)
+	{
+		DistrictIDs = DistrictIDTexture::FindDistricts(OriginalIDTextueData.Get());
+	}
+	else
+	{
+		for (int32 DistrictID = 1; DistrictID <= Settings->DistrictPinNum; ++DistrictID)
+		{
+			DistrictIDs.Add(DistrictID);
+		}
+	}
+	auto AddOutput = [&Outputs, bDynamic = Settings->bDynamicDistrictOutputs](const int32 DistrictID) -> FPCGTaggedData&
 	{
 		FPCGTaggedData& Output = Outputs.Emplace_GetRef();
-		Output.Pin = FName(FString::Printf(TEXT("District%d"), ID));
+		Output.Pin = bDynamic ? OutNameDistricts : GetDistrictName(DistrictID);
+		if (bDynamic)
+		{
+			Output.Tags.Add(GetDistrictName(DistrictID).ToString());
+		}
+		return Output;
+	};
+	if (Settings->bSinglePassPointData)
+	{
+		TArray<UPCGPointData*, TInlineAllocator<16>> PointData;
+		for (const int32 ID : DistrictIDs)
+		{
+			UPCGPointData* Data = NewObject<UPCGPointData>();
+			AddOutput(ID).Data = Data;
+			PointData.Add(Data);
+		}
+		UPCGIDTextureData::CreateDistrictPointData(OriginalIDTextueData.Get(), MipChain.Get(), FinalTransform,
+		                                           DensityFunction, TexelSize, Filter, DistrictIDs, PointData);
+		return true;
+	}
+	for (const int32 ID : DistrictIDs)
+	{
+		FPCGTaggedData& Output = AddOutput(ID);
 		UPCGIDTextureData* TextureData = NewObject<UPCGIDTextureData>();
 		Output.Data = TextureData;
 		// Initialize & set properties
@@ -105,6 +156,8 @@ bool FPCGIDTextureSamplerElement::ExecuteInternal(FPCGContext* Context) const
 		TextureData->PrimaryID = ID;
 		TextureData->DensityFunction = DensityFunction;
 		TextureData->TexelSize = TexelSize;
+		TextureData->Filter = Filter;
+		TextureData->SetMipChain(MipChain);
 		UPCGMetadata* Metadata = TextureData->MutableMetadata();
 		Metadata->CreateInteger32Attribute(DataAttrPrimaryID, 0, false, true);
 		Metadata->CreateInteger32Attribute(DataAttrDistrictID1, 0, false, true);
@@ -126,49 +179,6 @@ bool FPCGIDTextureSamplerElement::ExecuteInternal(FPCGContext* Context) const
 	return true;
 }
 
-TSharedRef<FIDTextueData> FPCGIDTextureSamplerElement::CreateOriginalIDTextureData(const UTexture2D* Texture1,
-	const UTexture2D* Texture2)
-{
-	const int32 PixelCount = Texture1->GetSizeX() * Texture1->GetSizeY();
-	TSharedRef<FIDTextueData, ESPMode::ThreadSafe> Result = MakeShared<FIDTextueData>();
-	FIDTextueData& TextureData = Result.Get();
-	TextureData.Width = Texture1->GetSizeX();
-	TextureData.Height = Texture1->GetSizeY();
-	TextureData.Data.SetNum(PixelCount);
-	const FTexturePlatformData* PlatformData1 = Texture1->GetPlatformData();
-	if (PlatformData1)
-	{
-		if (const FFloat16* BulkData = static_cast<const FFloat16*>(PlatformData1->Mips[0].BulkData.LockReadOnly()))
-		{
-			for (int32 D = 0; D < PixelCount; ++D)
-			{
-				TextureData.Data[D].DistrictID1 = FMath::RoundHalfToEven((BulkData + D * 4 + 0)->GetFloat() * 16);
-				TextureData.Data[D].Proportion1 = (BulkData + D * 4 + 1)->GetFloat();
-				TextureData.Data[D].DistrictID2 = FMath::RoundHalfToEven((BulkData + D * 4 + 2)->GetFloat() * 16);
-				TextureData.Data[D].Proportion2 = (BulkData + D * 4 + 3)->GetFloat();
-			}
-		}
-	}
-	PlatformData1->Mips[0].BulkData.Unlock();
-	const FTexturePlatformData* PlatformData2 = Texture2->GetPlatformData();
-	if (PlatformData2)
-	{
-		if (const FFloat16* BulkData = static_cast<const FFloat16*>(PlatformData2->Mips[0].BulkData.LockReadOnly()))
-		{
-			for (int32 D = 0; D < PixelCount; ++D)
-			{
-				TextureData.Data[D].DistrictID3 = FMath::RoundHalfToEven((BulkData + D * 4 + 0)->GetFloat() * 16);
-				TextureData.Data[D].Proportion3 = (BulkData + D * 4 + 1)->GetFloat();
-				TextureData.Data[D].DistrictID4 = FMath::RoundHalfToEven((BulkData + D * 4 + 2)->GetFloat() * 16);
-				TextureData.Data[D].Proportion4 = (BulkData + D * 4 + 3)->GetFloat();
-			}
-		}
-	}
-	PlatformData2->Mips[0].BulkData.Unlock();
-	
-	return Result;
-}
-
 void FPCGIDTextureSamplerElement::GetDependenciesCrc(const FPCGDataCollection& InInput, const UPCGSettings* InSettings,
                                                      UPCGComponent* InComponent, FPCGCrc& OutCrc) const
 {
@@ -190,6 +200,22 @@ void FPCGIDTextureSamplerElement::GetDependenciesCrc(const FPCGDataCollection& I
 				Crc.Combine(Data->GetOrComputeCrc(/*bFullDataCrc=*/false));
 			}
 		}
+
+		// The settings only name the textures, their pixels change with every regenerated island
+		UTexture2D* IDTexture1 = Settings->IDTexture1;
+		UTexture2D* IDTexture2 = Settings->IDTexture2;
+		if (Settings->DynamicAssets)
+		{
+			IDTexture1 = Settings->DynamicAssets->IsGenerating()
+				             ? nullptr
+				             : Settings->DynamicAssets->GetDistrictIDTexture01();
+			IDTexture2 = Settings->DynamicAssets->GetDistrictIDTexture02();
+		}
+		if (IDTexture1 && IDTexture2 && UPCGIDTextureData::IsSupported(IDTexture1)
+			&& UPCGIDTextureData::IsSupported(IDTexture2))
+		{
+			Crc.Combine(FDistrictIDDataCache::Get().FindOrComputeContentCrc(IDTexture1, IDTexture2));
+		}
 	}
 
 	OutCrc = Crc;
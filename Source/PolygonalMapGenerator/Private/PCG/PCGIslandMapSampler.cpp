@@ -0,0 +1,227 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PCG/PCGIslandMapSampler.h"
+
+#include "PCGComponent.h"
+#include "PCGContext.h"
+#include "PCGCrc.h"
+#include "PCGPin.h"
+#include "Data/PCGPointData.h"
+#include "Helpers/PCGBlueprintHelpers.h"
+#include "Helpers/PCGHelpers.h"
+#include "Helpers/PCGSettingsHelpers.h"
+
+#include "Async/ParallelFor.h"
+#include "GameFramework/Actor.h"
+#include "IslandMapData.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(PCGIslandMapSampler)
+
+#define LOCTEXT_NAMESPACE "PCGIslandMapSamplerElement"
+
+using namespace IslandMapFixedName;
+
+namespace
+{
+	template <typename T>
+	FPCGMetadataAttribute<T>* FindTypedAttribute(UPCGMetadata* Metadata, const FName AttributeName)
+	{
+		FPCGMetadataAttributeBase* Attribute = Metadata->GetMutableAttribute(AttributeName);
+		return Attribute && Attribute->GetTypeId() == PCG::Private::MetadataTypes<T>::Id
+			       ? static_cast<FPCGMetadataAttribute<T>*>(Attribute)
+			       : nullptr;
+	}
+}
+
+TArray<FPCGPinProperties> UPCGIslandMapSamplerSettings::OutputPinProperties() const
+{
+	TArray<FPCGPinProperties> Properties;
+	Properties.Emplace(PCGPinConstants::DefaultOutputLabel, EPCGDataType::Point);
+	return Properties;
+}
+
+FPCGElementPtr UPCGIslandMapSamplerSettings::CreateElement() const
+{
+	return MakeShared<FPCGIslandMapSamplerElement>();
+}
+
+bool FPCGIslandMapSamplerElement::ExecuteInternal(FPCGContext* Context) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FPCGIslandMapSamplerElement::Execute);
+
+	const UPCGIslandMapSamplerSettings* Settings = Context->GetInputSettings<UPCGIslandMapSamplerSettings>();
+	check(Settings);
+
+	UIslandMapData* MapData = Settings->MapData;
+	if (!MapData)
+	{
+		PCGE_LOG(Error, GraphAndLog, LOCTEXT("MapDataIsNull", "MapData is Null"));
+		return true;
+	}
+	// The last finished island, a generation running meanwhile does not touch it
+	const TSharedRef<const FIslandMapSnapshot> Snapshot = MapData->GetSnapshot();
+	const UTriangleDualMesh* Mesh = Snapshot->Mesh.Get();
+	if (!Mesh || Snapshot->r_district.Num() < Mesh->NumSolidRegions || Snapshot->r_biome.Num() < Mesh->NumSolidRegions)
+	{
+		PCGE_LOG(Error, GraphAndLog, LOCTEXT("MapDataNotGenerated",
+		                                      "MapData has not been generated or does not publish snapshots, turn on bPublishSnapshots"));
+		return true;
+	}
+
+	FTransform FinalTransform = Settings->Transform;
+	if (!Settings->bUseAbsoluteTransform)
+	{
+		AActor* OriginalActor = UPCGBlueprintHelpers::GetOriginalComponent(*Context)->GetOwner();
+		FinalTransform = Settings->Transform * OriginalActor->GetTransform();
+
+		FBox OriginalActorLocalBounds = PCGHelpers::GetActorLocalBounds(OriginalActor);
+		FinalTransform.SetScale3D(
+			FinalTransform.GetScale3D() * 0.5 * (OriginalActorLocalBounds.Max - OriginalActorLocalBounds.Min));
+	}
+
+	// Candidate points in map space, with the region each of them falls into
+	const FVector2D MapSize = Mesh->GetSize();
+	TArray<FVector2D> MapPositions;
+	TArray<FPointIndex> Regions;
+	FVector Extents(Settings->PointSpacing / 2.0);
+	if (Settings->SampleMode == EPCGIslandMapSampleMode::Grid)
+	{
+		const int32 XCount = FMath::Floor(2.0 * FinalTransform.GetScale3D().X / Settings->PointSpacing);
+		const int32 YCount = FMath::Floor(2.0 * FinalTransform.GetScale3D().Y / Settings->PointSpacing);
+		if (XCount <= 0 || YCount <= 0)
+		{
+			PCGE_LOG(Warning, GraphAndLog, LOCTEXT("PointSpacingTooLarge",
+				         "Point spacing is larger than the surface - will return empty data"));
+		}
+		MapPositions.Reserve(FMath::Max(XCount, 0) * FMath::Max(YCount, 0));
+		for (int32 Y = 0; Y < YCount; ++Y)
+		{
+			for (int32 X = 0; X < XCount; ++X)
+			{
+				MapPositions.Emplace((X + 0.5) / XCount * MapSize.X, (Y + 0.5) / YCount * MapSize.Y);
+			}
+		}
+		// The region grid of the mesh answers these in parallel
+		Regions = Mesh->ClosestRegions(MapPositions);
+	}
+	else
+	{
+		MapPositions.Reserve(Mesh->NumSolidRegions);
+		Regions.Reserve(Mesh->NumSolidRegions);
+		for (int32 Region = 0; Region < Mesh->NumSolidRegions; ++Region)
+		{
+			MapPositions.Add(Mesh->r_pos(Region));
+			Regions.Add(Region);
+		}
+		// About half the distance between two region centers
+		Extents = FVector(FinalTransform.GetScale3D().X / FMath::Max(FMath::Sqrt(
+			static_cast<double>(Mesh->NumSolidRegions)), 1.0));
+	}
+
+	const TArray<int32>& RegionDistricts = Snapshot->r_district;
+	TArray<bool> bKeep;
+	TArray<float> CoastDistances;
+	bKeep.SetNumZeroed(MapPositions.Num());
+	CoastDistances.SetNumZeroed(MapPositions.Num());
+	ParallelFor(MapPositions.Num(), [&](const int32 Index)
+	{
+		const FPointIndex Region = Regions[Index];
+		if (!Region.IsValid() || static_cast<int32>(Region) >= Mesh->NumSolidRegions
+			|| (Settings->bExcludeOcean && Snapshot->HasPointFlags(Region, ERegionFlags::Ocean))
+			|| (Settings->bExcludeWater && Snapshot->HasPointFlags(Region, ERegionFlags::Water))
+			|| (!Settings->DistrictIDs.IsEmpty() && !Settings->DistrictIDs.Contains(RegionDistricts[Region] + 1)))
+		{
+			return;
+		}
+		bKeep[Index] = true;
+		CoastDistances[Index] = Snapshot->GetSignedCoastDistance(MapPositions[Index], Settings->MaxCoastDistance);
+	});
+
+	UPCGPointData* Data = NewObject<UPCGPointData>();
+	FPCGTaggedData& Output = Context->OutputData.TaggedData.Emplace_GetRef();
+	Output.Data = Data;
+	UPCGMetadata* Metadata = Data->MutableMetadata();
+	Metadata->CreateInteger32Attribute(DataAttrRegion, INDEX_NONE, false, true);
+	Metadata->CreateInteger32Attribute(DataAttrDistrictID, 0, false, true);
+	Metadata->CreateInteger32Attribute(DataAttrBiomeIndex, 0, false, true);
+	Metadata->CreateNameAttribute(DataAttrBiomeTag, NAME_None, false, true);
+	Metadata->CreateFloatAttribute(DataAttrElevation, 0.f, true, true);
+	Metadata->CreateFloatAttribute(DataAttrMoisture, 0.f, true, true);
+	Metadata->CreateFloatAttribute(DataAttrCoastDistance, 0.f, true, true);
+	// Looked up once instead of once per point
+	FPCGMetadataAttribute<int32>* RegionAttribute = FindTypedAttribute<int32>(Metadata, DataAttrRegion);
+	FPCGMetadataAttribute<int32>* DistrictIDAttribute = FindTypedAttribute<int32>(Metadata, DataAttrDistrictID);
+	FPCGMetadataAttribute<int32>* BiomeIndexAttribute = FindTypedAttribute<int32>(Metadata, DataAttrBiomeIndex);
+	FPCGMetadataAttribute<FName>* BiomeTagAttribute = FindTypedAttribute<FName>(Metadata, DataAttrBiomeTag);
+	FPCGMetadataAttribute<float>* ElevationAttribute = FindTypedAttribute<float>(Metadata, DataAttrElevation);
+	FPCGMetadataAttribute<float>* MoistureAttribute = FindTypedAttribute<float>(Metadata, DataAttrMoisture);
+	FPCGMetadataAttribute<float>* CoastDistanceAttribute = FindTypedAttribute<float>(Metadata, DataAttrCoastDistance);
+
+	TArray<FName> BiomeTags;
+	for (const FBiomeData& Biome : Snapshot->BiomePalette)
+	{
+		BiomeTags.Add(Biome.Tag.GetTagName());
+	}
+	const TArray<uint8>& RegionBiomes = Snapshot->r_biome;
+	TArray<FPCGPoint>& Points = Data->GetMutablePoints();
+	for (int32 Index = 0; Index < MapPositions.Num(); ++Index)
+	{
+		if (!bKeep[Index])
+		{
+			continue;
+		}
+		const FPointIndex Region = Regions[Index];
+		const FVector LocalPosition(MapPositions[Index].X / MapSize.X * 2.0 - 1.0,
+		                            MapPositions[Index].Y / MapSize.Y * 2.0 - 1.0, 0);
+		FPCGPoint& Point = Points.Emplace_GetRef(FTransform(FinalTransform.TransformPosition(LocalPosition)), 1.f,
+		                                         PCGHelpers::ComputeSeed(Index, static_cast<int32>(Region)));
+		Point.SetExtents(Extents);
+		const PCGMetadataEntryKey Key = Metadata->AddEntry();
+		Point.MetadataEntry = Key;
+		const int32 BiomeIndex = RegionBiomes[Region];
+		RegionAttribute->SetValue(Key, static_cast<int32>(Region));
+		DistrictIDAttribute->SetValue(Key, RegionDistricts[Region] + 1);
+		BiomeIndexAttribute->SetValue(Key, BiomeIndex);
+		BiomeTagAttribute->SetValue(Key, BiomeTags.IsValidIndex(BiomeIndex) ? BiomeTags[BiomeIndex] : NAME_None);
+		ElevationAttribute->SetValue(Key, Snapshot->GetPointElevation(Region));
+		MoistureAttribute->SetValue(Key, Snapshot->GetPointMoisture(Region));
+		CoastDistanceAttribute->SetValue(Key, CoastDistances[Index]);
+	}
+
+	return true;
+}
+
+void FPCGIslandMapSamplerElement::GetDependenciesCrc(const FPCGDataCollection& InInput, const UPCGSettings* InSettings,
+                                                     UPCGComponent* InComponent, FPCGCrc& OutCrc) const
+{
+	FPCGCrc Crc;
+	IPCGElement::GetDependenciesCrc(InInput, InSettings, InComponent, Crc);
+
+	if (const UPCGIslandMapSamplerSettings* Settings = Cast<UPCGIslandMapSamplerSettings>(InSettings))
+	{
+		// The settings only reference the map data, its content is covered by the fingerprint of its generation
+		if (const UIslandMapData* MapData = Settings->MapData)
+		{
+			Crc.Combine(MapData->GetSnapshot()->GenerationFingerprint);
+		}
+
+		// If not using absolute transform, depend on actor transform and bounds, and therefore take dependency on actor data.
+		bool bUseAbsoluteTransform;
+		PCGSettingsHelpers::GetOverrideValue(InInput, Settings,
+		                                     GET_MEMBER_NAME_CHECKED(UPCGIslandMapSamplerSettings,
+		                                                             bUseAbsoluteTransform),
+		                                     Settings->bUseAbsoluteTransform, bUseAbsoluteTransform);
+		if (!bUseAbsoluteTransform && InComponent)
+		{
+			if (const UPCGData* Data = InComponent->GetActorPCGData())
+			{
+				Crc.Combine(Data->GetOrComputeCrc(/*bFullDataCrc=*/false));
+			}
+		}
+	}
+
+	OutCrc = Crc;
+}
+
+#undef LOCTEXT_NAMESPACE
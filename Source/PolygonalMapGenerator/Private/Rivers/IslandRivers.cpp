@@ -17,16 +17,20 @@
 */
 
 #include "Rivers/IslandRivers.h"
+#include "Async/ParallelFor.h"
+#include "ScratchContainers.h"
 
 UIslandRivers::UIslandRivers()
 {
 	MinSpringElevation = 0.3f;
 	MaxSpringElevation = 0.9f;
+	bUseFlowAccumulation = false;
+	MinRiverDrainage = 64;
 }
 
 bool UIslandRivers::IsTriangleWater(FTriangleIndex t, UTriangleDualMesh* Mesh, const TArray<bool>& r_water) const
 {
-	TArray<FPointIndex> regions = Mesh->t_circulate_r(t);
+	const TStaticArray<FPointIndex, 3> regions = Mesh->t_circulate_r(t);
 	for (FPointIndex r : regions)
 	{
 		if (r_water[r])
@@ -39,9 +43,11 @@ bool UIslandRivers::IsTriangleWater(FTriangleIndex t, UTriangleDualMesh* Mesh, c
 
 TArray<FTriangleIndex> UIslandRivers::FindSpringTriangles_Implementation(UTriangleDualMesh* Mesh, const TArray<bool>& r_water, const TArray<float>& t_elevation, const TArray<FSideIndex>& t_downslope_s) const
 {
-	TSet<FTriangleIndex> spring_t;
+	// Every triangle is visited once, so no set is needed to keep them unique
+	TArray<FTriangleIndex> spring_t;
 	if (Mesh != NULL)
 	{
+		spring_t.Reserve(Mesh->NumSolidTriangles / 2 + 1);
 		// Add everything above some elevation, but not lakes
 		// We skip every other triangle to ensure that we don't select neighboring triangles later
 		for (FTriangleIndex t = 0; t < Mesh->NumSolidTriangles; t += 2)
@@ -58,12 +64,13 @@ TArray<FTriangleIndex> UIslandRivers::FindSpringTriangles_Implementation(UTriang
 	{
 		UE_LOG(LogMapGen, Error, TEXT("Mesh was invalid!"));
 	}
-	return spring_t.Array();
+	return spring_t;
 }
 
-TArray<URiver*> UIslandRivers::CreateRiver(FTriangleIndex RiverTriangle, TArray<int32> &s_flow, TMap<FTriangleIndex, URiver*> RiverMap, UTriangleDualMesh* Mesh, const TArray<FSideIndex>& t_downslope_s, FRandomStream& RiverRng) const
+TArray<URiver*> UIslandRivers::CreateRiver(FTriangleIndex RiverTriangle, TArray<int32> &s_flow, TMap<FTriangleIndex, URiver*>& RiverMap, UTriangleDualMesh* Mesh, const TArray<FSideIndex>& t_downslope_s, FRandomStream& RiverRng) const
 {
-	TSet<FTriangleIndex> processedSlopes;
+	FMemMark mark(FMemStack::Get());
+	TScratchSet<FTriangleIndex> processedSlopes;
 	TArray<URiver*> createdRivers;
 	URiver* currentRiver = NULL;
 	FSideIndex lastS = FSideIndex();
@@ -165,27 +172,136 @@ void UIslandRivers::AssignSideFlow_Implementation(TArray<int32>& s_flow, TArray<
 {
 	if (Mesh)
 	{
-		Rivers.Empty(river_t.Num());
-		s_flow.Empty(Mesh->NumSides);
-		s_flow.SetNumZeroed(Mesh->NumSides);
-		TMap<FTriangleIndex, URiver*> riverTriangles;
-		for (int i = 0; i < river_t.Num(); i++)
+		UIslandMapUtils::ResetLayer(s_flow, Mesh->NumSides);
+		FRiverNetwork network;
+		network.Trace(Mesh, t_downslope_s, river_t, s_flow);
+		network.CreateRiverObjects(GetTransientPackage(), Rivers);
+	}
+	else
+	{
+		UE_LOG(LogMapGen, Error, TEXT("Mesh was invalid!"));
+	}
+}
+
+void UIslandRivers::AccumulateFlow(TArray<int32>& t_flow, UTriangleDualMesh* Mesh, const TArray<bool>& r_water, const TArray<FSideIndex>& t_downslope_s) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UIslandRivers::AccumulateFlow)
+	if (Mesh == NULL)
+	{
+		UE_LOG(LogMapGen, Error, TEXT("Mesh was invalid!"));
+		return;
+	}
+	// The downslopes form a forest rooted at the coast. Lakes keep their coast distance along the slope,
+	// so the distances alone don't order it; count the open upstream triangles instead.
+	UIslandMapUtils::ResetLayer(t_flow, Mesh->NumTriangles);
+	TArray<int32> t_upstream;
+	t_upstream.SetNumZeroed(Mesh->NumTriangles);
+	TArray<FTriangleIndex> downstream_t;
+	UIslandMapUtils::ResetLayer(downstream_t, Mesh->NumTriangles, FTriangleIndex());
+	// Every land triangle drains itself, classified apart from the serial pass below
+	ParallelFor(Mesh->NumTriangles, [this, Mesh, &r_water, &t_flow](const int32 t)
+	{
+		t_flow[t] = IsTriangleWater(t, Mesh, r_water) ? 0 : 1;
+	});
+	for (FTriangleIndex t = 0; t < Mesh->NumTriangles; t++)
+	{
+		if (t_downslope_s[t].IsValid())
 		{
-			Rivers.Append(CreateRiver(river_t[i], s_flow, riverTriangles, Mesh, t_downslope_s, RiverRng));
+			const FTriangleIndex next_t = Mesh->s_outer_t(t_downslope_s[t]);
+			if (next_t.IsValid() && next_t != t)
+			{
+				downstream_t[t] = next_t;
+				t_upstream[next_t]++;
+			}
 		}
 	}
-	else
+
+	TArray<FTriangleIndex> ready_t;
+	ready_t.Reserve(Mesh->NumTriangles);
+	for (FTriangleIndex t = 0; t < Mesh->NumTriangles; t++)
+	{
+		if (t_upstream[t] == 0)
+		{
+			ready_t.Add(t);
+		}
+	}
+	for (int32 i = 0; i < ready_t.Num(); i++)
+	{
+		const FTriangleIndex next_t = downstream_t[ready_t[i]];
+		if (next_t.IsValid())
+		{
+			t_flow[next_t] += t_flow[ready_t[i]];
+			if (--t_upstream[next_t] == 0)
+			{
+				ready_t.Add(next_t);
+			}
+		}
+	}
+	if (ready_t.Num() < Mesh->NumTriangles)
+	{
+		UE_LOG(LogMapGen, Warning, TEXT("%d triangles drain in a loop and got no upstream flow."), Mesh->NumTriangles - ready_t.Num());
+	}
+}
+
+TArray<FTriangleIndex> UIslandRivers::FindDrainageSprings(UTriangleDualMesh* Mesh, const TArray<bool>& r_water, const TArray<int32>& t_flow, const TArray<FSideIndex>& t_downslope_s) const
+{
+	TArray<FTriangleIndex> spring_t;
+	if (Mesh == NULL)
 	{
 		UE_LOG(LogMapGen, Error, TEXT("Mesh was invalid!"));
+		return spring_t;
+	}
+	TBitArray<> fedByRiver(false, Mesh->NumTriangles);
+	for (FTriangleIndex t = 0; t < Mesh->NumTriangles; t++)
+	{
+		if (t_flow[t] >= MinRiverDrainage && t_downslope_s[t].IsValid())
+		{
+			const FTriangleIndex next_t = Mesh->s_outer_t(t_downslope_s[t]);
+			if (next_t.IsValid())
+			{
+				fedByRiver[next_t] = true;
+			}
+		}
+	}
+	for (FTriangleIndex t = 0; t < Mesh->NumSolidTriangles; t++)
+	{
+		if (t_flow[t] >= MinRiverDrainage && !fedByRiver[t] && !IsTriangleWater(t, Mesh, r_water))
+		{
+			spring_t.Add(t);
+		}
 	}
+	return spring_t;
 }
 
 TArray<FTriangleIndex> UIslandRivers::find_spring_t(UTriangleDualMesh* Mesh, const TArray<bool>& r_water, const TArray<float>& t_elevation, const TArray<FSideIndex>& t_downslope_s) const
 {
-	return FindSpringTriangles(Mesh, r_water, t_elevation, t_downslope_s);
+	return ISLAND_CALL_NATIVE_OR_EVENT(UIslandRivers, FindSpringTriangles, Mesh, r_water, t_elevation, t_downslope_s);
+}
+
+void UIslandRivers::AssignRiverNetwork(TArray<int32>& s_flow, FRiverNetwork& Network, UTriangleDualMesh* Mesh, const TArray<FSideIndex>& t_downslope_s, const TArray<FTriangleIndex>& river_t, FRandomStream& RiverRng) const
+{
+	if (UIslandMapUtils::IsImplementedInScript(this, GET_FUNCTION_NAME_CHECKED(UIslandRivers, AssignSideFlow)))
+	{
+		TArray<URiver*> rivers;
+		AssignSideFlow(s_flow, rivers, Mesh, t_downslope_s, river_t, RiverRng);
+		Network.AssignFromRiverObjects(rivers);
+		return;
+	}
+	if (Mesh == NULL)
+	{
+		UE_LOG(LogMapGen, Error, TEXT("Mesh was invalid!"));
+		return;
+	}
+	UIslandMapUtils::ResetLayer(s_flow, Mesh->NumSides);
+	Network.Trace(Mesh, t_downslope_s, river_t, s_flow);
+}
+
+void UIslandRivers::assign_s_flow(TArray<int32>& s_flow, FRiverNetwork& Network, UTriangleDualMesh* Mesh, const TArray<FSideIndex>& t_downslope_s, const TArray<FTriangleIndex>& river_t, FRandomStream& RiverRng) const
+{
+	AssignRiverNetwork(s_flow, Network, Mesh, t_downslope_s, river_t, RiverRng);
 }
 
 void UIslandRivers::assign_s_flow(TArray<int32>& s_flow, TArray<URiver*>& Rivers, UTriangleDualMesh* Mesh, const TArray<FSideIndex>& t_downslope_s, const TArray<FTriangleIndex>& river_t, FRandomStream& RiverRng) const
 {
-	AssignSideFlow(s_flow, Rivers, Mesh, t_downslope_s, river_t, RiverRng);
+	ISLAND_CALL_NATIVE_OR_EVENT(UIslandRivers, AssignSideFlow, s_flow, Rivers, Mesh, t_downslope_s, river_t, RiverRng);
 }
\ No newline at end of file
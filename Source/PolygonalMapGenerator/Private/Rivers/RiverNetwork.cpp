@@ -0,0 +1,203 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Rivers/RiverNetwork.h"
+
+#include "IslandMapUtils.h"
+#include "PolygonalMapGenerator.h"
+
+void FRiverNetwork::Reset()
+{
+	Triangles.Reset();
+	Downslopes.Reset();
+	SegmentOffsets.Reset();
+	FeedsInto.Reset();
+}
+
+TArrayView<const FTriangleIndex> FRiverNetwork::GetSegmentTriangles(int32 Segment) const
+{
+	if (!FeedsInto.IsValidIndex(Segment))
+	{
+		return TArrayView<const FTriangleIndex>();
+	}
+	const int32 begin = SegmentOffsets[Segment];
+	return TArrayView<const FTriangleIndex>(Triangles.GetData() + begin, SegmentOffsets[Segment + 1] - begin);
+}
+
+TArrayView<const FSideIndex> FRiverNetwork::GetSegmentDownslopes(int32 Segment) const
+{
+	if (!FeedsInto.IsValidIndex(Segment))
+	{
+		return TArrayView<const FSideIndex>();
+	}
+	const int32 begin = SegmentOffsets[Segment];
+	return TArrayView<const FSideIndex>(Downslopes.GetData() + begin, SegmentOffsets[Segment + 1] - begin);
+}
+
+void FRiverNetwork::CreateRiverObjects(UObject* Outer, TArray<URiver*>& OutRivers) const
+{
+	check(IsInGameThread());
+	OutRivers.Empty(Num());
+	for (int32 segment = 0; segment < Num(); segment++)
+	{
+		URiver* river = NewObject<URiver>(Outer);
+		const TArrayView<const FTriangleIndex> triangles = GetSegmentTriangles(segment);
+		const TArrayView<const FSideIndex> downslopes = GetSegmentDownslopes(segment);
+		river->RiverTriangles.Append(triangles.GetData(), triangles.Num());
+		river->Downslopes.Append(downslopes.GetData(), downslopes.Num());
+		OutRivers.Add(river);
+	}
+	for (int32 segment = 0; segment < Num(); segment++)
+	{
+		OutRivers[segment]->FeedsInto = OutRivers.IsValidIndex(FeedsInto[segment]) ? OutRivers[FeedsInto[segment]] : nullptr;
+	}
+}
+
+void FRiverNetwork::AssignFromRiverObjects(const TArray<URiver*>& Rivers)
+{
+	Reset();
+	SegmentOffsets.Add(0);
+	// Give every distinct river its index first, null and repeated entries would shift the ones after them
+	TMap<const URiver*, int32> segments;
+	segments.Reserve(Rivers.Num());
+	for (const URiver* river : Rivers)
+	{
+		if (river == nullptr || segments.Contains(river))
+		{
+			continue;
+		}
+		segments.Add(river, segments.Num());
+		const int32 length = FMath::Min(river->RiverTriangles.Num(), river->Downslopes.Num());
+		Triangles.Append(river->RiverTriangles.GetData(), length);
+		Downslopes.Append(river->Downslopes.GetData(), length);
+		SegmentOffsets.Add(Triangles.Num());
+		FeedsInto.Add(INDEX_NONE);
+	}
+	for (const TPair<const URiver*, int32>& segment : segments)
+	{
+		if (const int32* feedsInto = segments.Find(segment.Key->FeedsInto))
+		{
+			FeedsInto[segment.Value] = *feedsInto;
+		}
+	}
+}
+
+void FRiverNetwork::Trace(const UTriangleDualMesh* Mesh, const TArray<FSideIndex>& t_downslope_s,
+                          const TArray<FTriangleIndex>& Springs, TArray<int32>& OutSideFlow)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRiverNetwork::Trace)
+	check(Mesh != nullptr);
+	Reset();
+	SegmentOffsets.Add(0);
+
+	// Segment owning each triangle, shared by all springs
+	TArray<int32> t_segment;
+	t_segment.Init(INDEX_NONE, Mesh->NumTriangles);
+	// Flow arriving at a triangle from the tributaries joining there
+	TArray<int32> t_inflow;
+	t_inflow.SetNumZeroed(Mesh->NumTriangles);
+	// Where each segment hands over its flow: a triangle of an older segment, or a side on the coast.
+	// The coast triangle's side depends on where the river came from, so that one is not shared.
+	TArray<FTriangleIndex> joinTriangles;
+	TArray<FSideIndex> joinSides;
+
+	for (const FTriangleIndex spring : Springs)
+	{
+		const int32 segment = FeedsInto.Num();
+		const int32 segmentStart = Triangles.Num();
+		FTriangleIndex t = spring;
+		FSideIndex lastS;
+		int32 feedsInto = INDEX_NONE;
+		FTriangleIndex joinT;
+		FSideIndex joinS;
+		while (true)
+		{
+			const int32 owner = t_segment[t];
+			if (owner != INDEX_NONE)
+			{
+				if (owner == segment)
+				{
+					UE_LOG(LogMapGen, Warning, TEXT("Tried to process a slope we've already processed once this loop! We have an infinite loop."));
+					break;
+				}
+				// The older river carries this flow from here on
+				feedsInto = owner;
+				if (t_downslope_s[t].IsValid())
+				{
+					joinT = t;
+				}
+				else
+				{
+					joinS = Mesh->s_opposite_s(lastS);
+				}
+				break;
+			}
+
+			FSideIndex s = t_downslope_s[t];
+			const bool bHitCoast = !s.IsValid();
+			if (bHitCoast)
+			{
+				// Hit the coastline; add the last triangle
+				s = Mesh->s_opposite_s(lastS);
+				if (!s.IsValid())
+				{
+					break;
+				}
+			}
+			Triangles.Add(t);
+			Downslopes.Add(s);
+			t_segment[t] = segment;
+			if (bHitCoast)
+			{
+				break;
+			}
+
+			const FTriangleIndex next_t = Mesh->s_outer_t(s);
+			if (next_t == t)
+			{
+				// Loop onto ourselves
+				break;
+			}
+			lastS = s;
+			t = next_t;
+		}
+
+		if (Triangles.Num() > segmentStart)
+		{
+			SegmentOffsets.Add(Triangles.Num());
+			FeedsInto.Add(feedsInto);
+			joinTriangles.Add(joinT);
+			joinSides.Add(joinS);
+		}
+		// The spring already lies on a river, only its flow is left to hand over
+		else if (joinT.IsValid())
+		{
+			t_inflow[joinT]++;
+		}
+		else if (joinS.IsValid())
+		{
+			OutSideFlow[joinS]++;
+		}
+	}
+
+	// Tributaries are always younger than the river they join, so walking the segments backwards
+	// knows a segment's complete inflow before it is passed down.
+	for (int32 segment = Num() - 1; segment >= 0; segment--)
+	{
+		int32 flow = 1;
+		for (int32 i = SegmentOffsets[segment]; i < SegmentOffsets[segment + 1]; i++)
+		{
+			flow += t_inflow[Triangles[i]];
+			OutSideFlow[Downslopes[i]] += flow;
+		}
+		if (joinTriangles[segment].IsValid())
+		{
+			t_inflow[joinTriangles[segment]] += flow;
+		}
+		else if (joinSides[segment].IsValid())
+		{
+			OutSideFlow[joinSides[segment]] += flow;
+		}
+	}
+	UE_LOG(LogMapGen, Verbose, TEXT("Traced %d springs into %d river segments covering %d triangles."),
+	       Springs.Num(), Num(), Triangles.Num());
+}
@@ -0,0 +1,101 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataTable.h"
+#include "HAL/FileManager.h"
+#include "IslandDeterminismTests.h"
+
+/**
+ * Edits the biome table between two generations with the disk cache on. The table is only referenced by the biome
+ * stage, yet the edit has to change the cache key and generate the island instead of loading the stale one.
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FIslandCacheAssetEditTest, "Procedural Generation.PolygonalMapGenerator.Cache.Referenced Asset Edits", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter | EAutomationTestFlags::MediumPriority)
+
+/**
+ * The same edit with incremental regeneration: the stages downstream of the biome table rerun and pick up the edited
+ * row, the stages before it are still reused.
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FIslandStageSkipAssetEditTest, "Procedural Generation.PolygonalMapGenerator.Cache.Referenced Asset Edits Rerun Stages", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter | EAutomationTestFlags::MediumPriority)
+
+namespace IslandCacheTests
+{
+	// One ocean and one land biome, so every region resolves to exactly one of them
+	UDataTable* CreateBiomeTable()
+	{
+		UDataTable* biomeTable = NewObject<UDataTable>();
+		biomeTable->RowStruct = FBiomeData::StaticStruct();
+		FBiomeData ocean;
+		ocean.bIsOcean = true;
+		ocean.bIsWater = true;
+		ocean.DebugColor = FColor::Blue;
+		biomeTable->AddRow(TEXT("Ocean"), ocean);
+		FBiomeData land;
+		land.DebugColor = FColor::Green;
+		biomeTable->AddRow(TEXT("Land"), land);
+		return biomeTable;
+	}
+
+	UIslandMapData* CreateMapData(const FString& CacheDirectory)
+	{
+		UIslandMapData* mapData = IslandDeterminismTests::CreateMapData();
+		mapData->Biomes->BiomeData = CreateBiomeTable();
+		mapData->bUseDiskCache = true;
+		mapData->CacheDirectory = CacheDirectory;
+		UIslandBatchGenerator::ApplyCandidate(mapData, IslandDeterminismTests::Candidates[0]);
+		return mapData;
+	}
+
+	bool IsStageSkipped(const UIslandMapData* MapData, const FName Stage)
+	{
+		const FIslandStageTiming* timing = MapData->GetGenerationReport().Stages.FindByPredicate(
+			[Stage](const FIslandStageTiming& Timing) { return Timing.Stage == Stage; });
+		return timing != nullptr && timing->bSkipped;
+	}
+}
+
+bool FIslandCacheAssetEditTest::RunTest(const FString& Parameters)
+{
+	using namespace IslandCacheTests;
+	const FString cacheDirectory = FPaths::Combine(FPaths::ProjectIntermediateDir(), TEXT("IslandCacheTests"));
+	IFileManager::Get().DeleteDirectory(*cacheDirectory, false, true);
+
+	UIslandMapData* mapData = CreateMapData(cacheDirectory);
+	mapData->GenerateIsland();
+	const uint64 cacheKey = mapData->GetCacheKey();
+	mapData->InvalidateGenerationCache();
+	mapData->GenerateIsland();
+	TestTrue(TEXT("The unchanged island loads from the cache"), mapData->GetGenerationReport().bLoadedFromCache);
+
+	mapData->Biomes->BiomeData->FindRow<FBiomeData>(TEXT("Land"), TEXT(""))->DebugColor = FColor::Yellow;
+	mapData->InvalidateGenerationCache();
+	mapData->GenerateIsland();
+	TestNotEqual(TEXT("Cache key after editing the biome table"), mapData->GetCacheKey(), cacheKey);
+	TestFalse(TEXT("The island with the edited biome table loads from the cache"),
+	          mapData->GetGenerationReport().bLoadedFromCache);
+
+	IFileManager::Get().DeleteDirectory(*cacheDirectory, false, true);
+	return true;
+}
+
+bool FIslandStageSkipAssetEditTest::RunTest(const FString& Parameters)
+{
+	using namespace IslandCacheTests;
+	UIslandMapData* mapData = CreateMapData(FString());
+	mapData->bUseDiskCache = false;
+	mapData->bIncrementalRegeneration = true;
+	mapData->GenerateIsland();
+
+	mapData->Biomes->BiomeData->FindRow<FBiomeData>(TEXT("Land"), TEXT(""))->DebugColor = FColor::Yellow;
+	mapData->GenerateIsland();
+	TestTrue(TEXT("The water stage is reused"), IsStageSkipped(mapData, TEXT("Water")));
+	for (const TCHAR* stage : {TEXT("Coast"), TEXT("Temperature"), TEXT("Biomes"), TEXT("Coastlines")})
+	{
+		TestFalse(FString::Printf(TEXT("%s stage is reused after editing the biome table"), stage),
+		          IsStageSkipped(mapData, stage));
+	}
+	TestTrue(TEXT("The biome palette holds the edited row"), mapData->GetBiomePalette().ContainsByPredicate(
+		[](const FBiomeData& Biome) { return Biome.DebugColor == FColor::Yellow; }));
+	return true;
+}
@@ -0,0 +1,330 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/ParallelFor.h"
+#include "Dom/JsonObject.h"
+#include "Interfaces/IPluginManager.h"
+#include "IslandBatchGenerator.h"
+#include "IslandComputeGPU.h"
+#include "IslandMapData.h"
+#include "Biomes/IslandBiome.h"
+#include "Coastline/IslandCoastline.h"
+#include "District/IslandPoissonDistrict.h"
+#include "Elevation/IslandElevation.h"
+#include "Mesh/IslandPoissonMeshBuilder.h"
+#include "Misc/FileHelper.h"
+#include "Moisture/IslandMoisture.h"
+#include "Rivers/IslandRivers.h"
+#include "Serialization/JsonSerializer.h"
+#include "Water/IslandNoiseWater.h"
+#include <atomic>
+
+/**
+ * Generates a fixed set of seeds serially, with concurrent stages, incrementally, and with one, two and as many
+ * candidates at once as there are task graph workers, and requires every way to build the same island. The worker
+ * count of the task graph is fixed at startup, run with -onethread to cover a single worker. The serial hashes are
+ * compared against the golden hashes in Tests/IslandDeterminismHashes.json of the plugin, a file without any is only
+ * warned about. Only with -IslandRecordDeterminism on the command line the test writes that file instead; commit it
+ * from the platform the goldens are meant for. The GPU noise rounds differently from the CPU by design, so it only has to agree with itself.
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FIslandDeterminismTest, "Procedural Generation.PolygonalMapGenerator.Determinism", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter | EAutomationTestFlags::HighPriority)
+
+namespace IslandDeterminismTests
+{
+	constexpr int32 RegionNum = 4000;
+	const FIslandBatchCandidate Candidates[] = {
+		{ 0, 1, 2, 0 },
+		{ 1, 7, 3, 5 },
+		{ 42, 42, 42, 42 },
+		{ -1234567, 98765, 31, 8 },
+	};
+
+	struct FIslandHashes
+	{
+		// UIslandMapData::ComputeContentHash, what replication compares
+		uint32 Content = 0;
+		// The full coastline contours
+		uint32 Coastlines = 0;
+		// Every layer, the mesh, rivers, districts and coastlines in the island cache format
+		uint32 Island = 0;
+
+		bool operator==(const FIslandHashes& Other) const
+		{
+			return Content == Other.Content && Coastlines == Other.Coastlines && Island == Other.Island;
+		}
+
+		FString ToString() const
+		{
+			return FString::Printf(TEXT("content %08x, coastlines %08x, island %08x"), Content, Coastlines, Island);
+		}
+	};
+
+	UIslandMapData* CreateMapData()
+	{
+		UIslandMapData* mapData = NewObject<UIslandMapData>();
+		UIslandPoissonMeshBuilder* pointGenerator = NewObject<UIslandPoissonMeshBuilder>(mapData);
+		const FVector2D poissonSize = pointGenerator->PoissonSize;
+		pointGenerator->PoissonSpacing = FMath::Sqrt(0.7 * poissonSize.X * poissonSize.Y / RegionNum);
+		pointGenerator->BoundarySpacing = FMath::Max(1, FMath::RoundToInt32(pointGenerator->PoissonSpacing));
+		mapData->PointGenerator = pointGenerator;
+		mapData->Water = NewObject<UIslandNoiseWater>(mapData);
+		mapData->Elevation = NewObject<UIslandElevation>(mapData);
+		mapData->Rivers = NewObject<UIslandRivers>(mapData);
+		mapData->Moisture = NewObject<UIslandMoisture>(mapData);
+		mapData->Biomes = NewObject<UIslandBiome>(mapData);
+		mapData->District = NewObject<UIslandPoissonDistrict>(mapData);
+		mapData->bIncrementalRegeneration = false;
+		mapData->bUseDiskCache = false;
+		mapData->bRunStagesConcurrently = false;
+		mapData->bQuantizeLayers = false;
+		return mapData;
+	}
+
+	FIslandHashes HashIsland(UIslandMapData* MapData)
+	{
+		FIslandHashes hashes;
+		hashes.Content = MapData->ComputeContentHash();
+		for (const FCoastlinePolygon& coastline : MapData->GetCoastLines())
+		{
+			hashes.Coastlines = FCrc::MemCrc32(coastline.Positions.GetData(), coastline.Positions.NumBytes(), hashes.Coastlines);
+		}
+		TArray<uint8> bytes;
+		if (MapData->SaveIslandToBytes(bytes))
+		{
+			// Skips the magic, version and cache key, the key hashes settings that do not change the island
+			constexpr int32 headerSize = sizeof(uint32) + sizeof(int32) + sizeof(uint64);
+			hashes.Island = FCrc::MemCrc32(bytes.GetData() + headerSize, bytes.Num() - headerSize);
+		}
+		return hashes;
+	}
+
+	// Every candidate from scratch on the game thread
+	TArray<FIslandHashes> GenerateSerially(UIslandMapData* MapData)
+	{
+		TArray<FIslandHashes> hashes;
+		for (const FIslandBatchCandidate& candidate : Candidates)
+		{
+			UIslandBatchGenerator::ApplyCandidate(MapData, candidate);
+			MapData->InvalidateGenerationCache();
+			MapData->GenerateIsland();
+			hashes.Add(HashIsland(MapData));
+		}
+		return hashes;
+	}
+
+	FString GetGoldenPath()
+	{
+		const TSharedPtr<IPlugin> plugin = IPluginManager::Get().FindPlugin(TEXT("IslandGenerator"));
+		return plugin.IsValid() ? FPaths::Combine(plugin->GetBaseDir(), TEXT("Tests"), TEXT("IslandDeterminismHashes.json")) : FString();
+	}
+
+	bool SaveGoldens(const FString& Path, const TArray<FIslandHashes>& Hashes)
+	{
+		TSharedRef<FJsonObject> root = MakeShared<FJsonObject>();
+		root->SetNumberField(TEXT("CacheVersion"), UIslandMapData::GetCacheVersion());
+		root->SetNumberField(TEXT("RegionNum"), RegionNum);
+		TArray<TSharedPtr<FJsonValue>> seeds;
+		for (int32 i = 0; i < Hashes.Num(); i++)
+		{
+			TSharedRef<FJsonObject> seed = MakeShared<FJsonObject>();
+			seed->SetNumberField(TEXT("Seed"), Candidates[i].Seed);
+			seed->SetStringField(TEXT("Content"), FString::Printf(TEXT("%08x"), Hashes[i].Content));
+			seed->SetStringField(TEXT("Coastlines"), FString::Printf(TEXT("%08x"), Hashes[i].Coastlines));
+			seed->SetStringField(TEXT("Island"), FString::Printf(TEXT("%08x"), Hashes[i].Island));
+			seeds.Add(MakeShared<FJsonValueObject>(seed));
+		}
+		root->SetArrayField(TEXT("Seeds"), seeds);
+		FString json;
+		const TSharedRef<TJsonWriter<>> writer = TJsonWriterFactory<>::Create(&json);
+		return FJsonSerializer::Serialize(root, writer) && FFileHelper::SaveStringToFile(json, *Path);
+	}
+
+	bool LoadGoldens(const FString& Path, int32& OutCacheVersion, TArray<FIslandHashes>& OutHashes)
+	{
+		FString json;
+		TSharedPtr<FJsonObject> root;
+		if (!FFileHelper::LoadFileToString(json, *Path)
+			|| !FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(json), root) || !root.IsValid())
+		{
+			return false;
+		}
+		OutCacheVersion = root->GetIntegerField(TEXT("CacheVersion"));
+		auto parseHash = [](const TSharedPtr<FJsonObject>& Seed, const TCHAR* Field)
+		{
+			return static_cast<uint32>(FParse::HexNumber(*Seed->GetStringField(Field)));
+		};
+		for (const TSharedPtr<FJsonValue>& value : root->GetArrayField(TEXT("Seeds")))
+		{
+			const TSharedPtr<FJsonObject> seed = value->AsObject();
+			FIslandHashes& hashes = OutHashes.AddDefaulted_GetRef();
+			hashes.Content = parseHash(seed, TEXT("Content"));
+			hashes.Coastlines = parseHash(seed, TEXT("Coastlines"));
+			hashes.Island = parseHash(seed, TEXT("Island"));
+		}
+		return true;
+	}
+}
+
+bool FIslandDeterminismTest::RunTest(const FString& Parameters)
+{
+	using namespace IslandDeterminismTests;
+	constexpr int32 candidateNum = UE_ARRAY_COUNT(Candidates);
+
+	UIslandMapData* mapData = CreateMapData();
+	const TArray<FIslandHashes> reference = GenerateSerially(mapData);
+	for (int32 i = 0; i < candidateNum; i++)
+	{
+		AddInfo(FString::Printf(TEXT("Seed %d: %s"), Candidates[i].Seed, *reference[i].ToString()));
+	}
+	auto compare = [this, &reference](const TCHAR* What, const TArray<FIslandHashes>& Hashes)
+	{
+		for (int32 i = 0; i < reference.Num(); i++)
+		{
+			if (!Hashes.IsValidIndex(i) || !(Hashes[i] == reference[i]))
+			{
+				AddError(FString::Printf(TEXT("%s built a different island for seed %d: %s, serially %s"), What,
+				                         Candidates[i].Seed, Hashes.IsValidIndex(i) ? *Hashes[i].ToString() : TEXT("nothing"),
+				                         *reference[i].ToString()));
+			}
+		}
+	};
+
+	// The same map data again, reusing the allocations of the last seed
+	compare(TEXT("Regenerating"), GenerateSerially(mapData));
+
+	mapData->bRunStagesConcurrently = true;
+	compare(TEXT("Running the stages concurrently"), GenerateSerially(mapData));
+	mapData->bRunStagesConcurrently = false;
+
+	// Only the stages after the water rerun for the second drainage seed
+	{
+		mapData->bIncrementalRegeneration = true;
+		TArray<FIslandHashes> hashes;
+		for (const FIslandBatchCandidate& candidate : Candidates)
+		{
+			FIslandBatchCandidate other = candidate;
+			other.DrainageSeed++;
+			UIslandBatchGenerator::ApplyCandidate(mapData, other);
+			mapData->GenerateIsland();
+			UIslandBatchGenerator::ApplyCandidate(mapData, candidate);
+			mapData->GenerateIsland();
+			hashes.Add(HashIsland(mapData));
+		}
+		compare(TEXT("Incremental regeneration"), hashes);
+		mapData->bIncrementalRegeneration = false;
+	}
+
+	// Quantizing is lossy, but the content hash is defined on the quantized layers
+	{
+		mapData->bQuantizeLayers = true;
+		const TArray<FIslandHashes> hashes = GenerateSerially(mapData);
+		for (int32 i = 0; i < candidateNum; i++)
+		{
+			TestEqual(FString::Printf(TEXT("Content hash of seed %d with quantized layers"), Candidates[i].Seed),
+			          hashes[i].Content, reference[i].Content);
+		}
+		mapData->bQuantizeLayers = false;
+	}
+
+	// Candidates side by side on the task graph, the way UIslandBatchGenerator runs them. This varies how many
+	// islands generate at once, the ParallelFor calls inside the stages share the same workers either way.
+	const int32 maxWorkers = FMath::Max(FTaskGraphInterface::Get().GetNumWorkerThreads(), 1);
+	TArray<int32> concurrentNums = { 1 };
+	concurrentNums.AddUnique(FMath::Min(2, maxWorkers));
+	concurrentNums.AddUnique(maxWorkers);
+	for (const int32 concurrentNum : concurrentNums)
+	{
+		TArray<UIslandMapData*> scratches;
+		for (int32 slot = 0; slot < concurrentNum; slot++)
+		{
+			scratches.Add(UIslandBatchGenerator::CreateScratch(mapData, GetTransientPackage()));
+		}
+		TArray<FIslandHashes> hashes;
+		hashes.SetNum(candidateNum);
+		std::atomic<int32> nextCandidate = 0;
+		ParallelFor(concurrentNum, [&](const int32 Slot)
+		{
+			UIslandMapData* scratch = scratches[Slot];
+			for (int32 candidate = nextCandidate++; candidate < candidateNum; candidate = nextCandidate++)
+			{
+				UIslandBatchGenerator::ApplyCandidate(scratch, Candidates[candidate]);
+				TArray<UIslandMapData::FGenerationStage> stages;
+				uint64 cacheKey = 0;
+				bool bConcurrent = false;
+				if (scratch->BeginGeneration(stages, cacheKey, bConcurrent) == UIslandMapData::EGenerationStart::RunStages)
+				{
+					scratch->RunGenerationStages(stages, false);
+					hashes[candidate] = HashIsland(scratch);
+				}
+			}
+		});
+		compare(*FString::Printf(TEXT("%d candidates at once"), concurrentNum), hashes);
+	}
+
+	if (IslandComputeGPU::IsSupported())
+	{
+		UIslandNoiseWater* water = CastChecked<UIslandNoiseWater>(mapData->Water);
+		water->bEvaluateNoiseOnGPU = true;
+		const TArray<FIslandHashes> first = GenerateSerially(mapData);
+		const TArray<FIslandHashes> second = GenerateSerially(mapData);
+		for (int32 i = 0; i < candidateNum; i++)
+		{
+			TestTrue(FString::Printf(TEXT("GPU noise builds the same island twice for seed %d"), Candidates[i].Seed),
+			         first[i] == second[i]);
+		}
+		water->bEvaluateNoiseOnGPU = false;
+	}
+
+	const FString goldenPath = GetGoldenPath();
+	if (goldenPath.IsEmpty())
+	{
+		AddError(TEXT("The IslandGenerator plugin was not found, can not locate the golden hashes"));
+		return false;
+	}
+	if (FParse::Param(FCommandLine::Get(), TEXT("IslandRecordDeterminism")))
+	{
+		if (!SaveGoldens(goldenPath, reference))
+		{
+			AddError(FString::Printf(TEXT("Could not write the golden hashes to %s"), *goldenPath));
+			return false;
+		}
+		AddWarning(FString::Printf(TEXT("Recorded the golden hashes to %s, commit them"), *goldenPath));
+		return true;
+	}
+	if (!FPaths::FileExists(goldenPath))
+	{
+		AddError(FString::Printf(TEXT("The golden hashes %s are missing, record them with -IslandRecordDeterminism"), *goldenPath));
+		return false;
+	}
+	int32 goldenVersion = 0;
+	TArray<FIslandHashes> goldens;
+	if (!LoadGoldens(goldenPath, goldenVersion, goldens))
+	{
+		AddError(FString::Printf(TEXT("Could not read the golden hashes from %s"), *goldenPath));
+		return false;
+	}
+	// Nothing recorded for this platform yet, the self-consistency checks above still have to pass
+	if (goldens.IsEmpty())
+	{
+		AddWarning(FString::Printf(TEXT("%s holds no golden hashes yet, skipped comparing against them. Record them with -IslandRecordDeterminism"),
+		                           *goldenPath));
+		return !HasAnyErrors();
+	}
+	if (goldenVersion != UIslandMapData::GetCacheVersion())
+	{
+		AddError(FString::Printf(TEXT("The golden hashes were recorded for cache version %d, rerecord them for %d with -IslandRecordDeterminism"),
+		                         goldenVersion, UIslandMapData::GetCacheVersion()));
+		return false;
+	}
+	for (int32 i = 0; i < candidateNum; i++)
+	{
+		if (!goldens.IsValidIndex(i) || !(goldens[i] == reference[i]))
+		{
+			AddError(FString::Printf(TEXT("Seed %d changed: %s, golden %s"), Candidates[i].Seed, *reference[i].ToString(),
+			                         goldens.IsValidIndex(i) ? *goldens[i].ToString() : TEXT("missing")));
+		}
+	}
+	return !HasAnyErrors();
+}
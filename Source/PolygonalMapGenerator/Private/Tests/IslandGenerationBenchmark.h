@@ -0,0 +1,218 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Dom/JsonObject.h"
+#include "HAL/PlatformMemory.h"
+#include "IslandDynamicAssets.h"
+#include "IslandMapData.h"
+#include "Biomes/IslandBiome.h"
+#include "District/IslandPoissonDistrict.h"
+#include "Elevation/IslandElevation.h"
+#include "Mesh/IslandPoissonMeshBuilder.h"
+#include "Moisture/IslandMoisture.h"
+#include "Rivers/IslandRivers.h"
+#include "Tests/BenchmarkReport.h"
+#include "Water/IslandRadialWater.h"
+
+/**
+ * Generates islands of a fixed set of seeds at one of the region counts returned by GetTests and writes the wall
+ * time and memory of every stage to Saved/Benchmarks/IslandGeneration_<Size>.json.
+ * The points stage covers everything BeginGeneration does, Finish covers EndGeneration. MapQuerySamples times a
+ * million FIslandMapQuery::Sample calls on one thread. The district ID texture
+ * and the tile buffers run side by side, both are timed from the moment the map data is done.
+ */
+IMPLEMENT_COMPLEX_AUTOMATION_TEST(FIslandGenerationBenchmark, "Procedural Generation.PolygonalMapGenerator.Benchmark.Island Generation", EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter | EAutomationTestFlags::LowPriority)
+
+namespace IslandGenerationBenchmark
+{
+	const int32 Seeds[] = { 0, 1, 2 };
+	// Poisson disc sampling covers about this much of the area with points per squared spacing
+	constexpr double PoissonDensity = 0.7;
+	// Distinct random points the map query samples cycle through
+	constexpr int32 QueryNum = 65536;
+
+	struct FStageSample
+	{
+		FString Name;
+		double Seconds = 0.;
+		int64 UsedPhysicalDelta = 0;
+		uint64 LayersAllocatedSize = 0;
+	};
+
+	/** Times Func and records how much the used physical memory and the map layers changed. */
+	template <typename FuncType>
+	void Measure(TArray<FStageSample>& Samples, const FString& Name, const UIslandMapData* MapData, FuncType&& Func)
+	{
+		const uint64 usedBefore = FPlatformMemory::GetStats().UsedPhysical;
+		const double start = FPlatformTime::Seconds();
+		Func();
+		FStageSample& sample = Samples.AddDefaulted_GetRef();
+		sample.Name = Name;
+		sample.Seconds = FPlatformTime::Seconds() - start;
+		sample.UsedPhysicalDelta = static_cast<int64>(FPlatformMemory::GetStats().UsedPhysical) - usedBefore;
+		sample.LayersAllocatedSize = MapData->GetLayersAllocatedSize();
+	}
+
+	UIslandMapData* CreateMapData(const int32 RegionNum)
+	{
+		UIslandMapData* mapData = NewObject<UIslandMapData>();
+		UIslandPoissonMeshBuilder* pointGenerator = NewObject<UIslandPoissonMeshBuilder>(mapData);
+		const FVector2D poissonSize = pointGenerator->PoissonSize;
+		pointGenerator->PoissonSpacing = FMath::Sqrt(PoissonDensity * poissonSize.X * poissonSize.Y / RegionNum);
+		pointGenerator->BoundarySpacing = FMath::Max(1, FMath::RoundToInt32(pointGenerator->PoissonSpacing));
+		mapData->PointGenerator = pointGenerator;
+		mapData->Water = NewObject<UIslandRadialWater>(mapData);
+		mapData->Elevation = NewObject<UIslandElevation>(mapData);
+		mapData->Rivers = NewObject<UIslandRivers>(mapData);
+		mapData->Moisture = NewObject<UIslandMoisture>(mapData);
+		mapData->Biomes = NewObject<UIslandBiome>(mapData);
+		mapData->District = NewObject<UIslandPoissonDistrict>(mapData);
+		// Every seed is measured from scratch
+		mapData->bIncrementalRegeneration = false;
+		mapData->bUseDiskCache = false;
+		mapData->bRunStagesConcurrently = false;
+		return mapData;
+	}
+}
+
+void FIslandGenerationBenchmark::GetTests(TArray<FString>& OutBeautifiedNames, TArray<FString>& OutTestCommands) const
+{
+	const TCHAR* sizes[] = { TEXT("10k"), TEXT("100k"), TEXT("1M") };
+	for (const TCHAR* size : sizes)
+	{
+		OutBeautifiedNames.Add(size);
+		OutTestCommands.Add(size);
+	}
+}
+
+bool FIslandGenerationBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace IslandGenerationBenchmark;
+	const int32 regionNum = Parameters == TEXT("1M") ? 1000000 : Parameters == TEXT("100k") ? 100000 : 10000;
+	UIslandMapData* mapData = CreateMapData(regionNum);
+
+	TArray<TSharedPtr<FJsonValue>> runs;
+	for (const int32 seed : Seeds)
+	{
+		mapData->Seed = seed;
+		mapData->InvalidateGenerationCache();
+		TArray<FStageSample> samples;
+		TArray<UIslandMapData::FGenerationStage> stages;
+		uint64 cacheKey = 0;
+		bool bConcurrent = false;
+		UIslandMapData::EGenerationStart generationStart = UIslandMapData::EGenerationStart::Invalid;
+		Measure(samples, TEXT("Points"), mapData, [&]
+		{
+			generationStart = mapData->BeginGeneration(stages, cacheKey, bConcurrent);
+		});
+		if (generationStart != UIslandMapData::EGenerationStart::RunStages)
+		{
+			AddError(FString::Printf(TEXT("Seed %d did not generate."), seed));
+			return false;
+		}
+		for (const UIslandMapData::FGenerationStage& stage : stages)
+		{
+			Measure(samples, stage.Name, mapData, [&stage]
+			{
+				UIslandMapData::RunGenerationStage(stage);
+			});
+		}
+		Measure(samples, TEXT("Finish"), mapData, [&]
+		{
+			mapData->EndGeneration(cacheKey);
+		});
+		TSharedPtr<const FIslandMapQuery> mapQuery;
+		Measure(samples, TEXT("MapQueryBuild"), mapData, [&]
+		{
+			mapQuery = mapData->GetMapQuery();
+		});
+		// One million queries on this thread, the seconds of this stage are the microseconds per query
+		FRandomStream queryRng(seed);
+		const FVector2D mapSize = mapData->GetMapSize();
+		TArray<FVector2D> queryPoints;
+		queryPoints.SetNumUninitialized(QueryNum);
+		for (FVector2D& point : queryPoints)
+		{
+			point = FVector2D(queryRng.FRandRange(0., mapSize.X), queryRng.FRandRange(0., mapSize.Y));
+		}
+		double elevationSum = 0.;
+		Measure(samples, TEXT("MapQuerySamples"), mapData, [&]
+		{
+			for (int32 i = 0; i < 1000000; i++)
+			{
+				elevationSum += mapQuery->Sample(queryPoints[i % QueryNum]).Elevation;
+			}
+		});
+		AddInfo(FString::Printf(TEXT("Query elevation checksum %f."), elevationSum));
+
+		// Stages are all skipped now, so the map data task only finishes the generation again
+		mapData->bIncrementalRegeneration = true;
+		UIslandDynamicAssets* assets = NewObject<UIslandDynamicAssets>();
+		assets->MapData = mapData;
+		assets->AsyncGenerateAssets();
+		FGraphEventArray tileTasks;
+		for (const FDynamicTileInfo& tile : assets->TileInfo)
+		{
+			tileTasks.Add(tile.Task);
+		}
+		FStageSample mapDataDone;
+		FStageSample textureDone;
+		textureDone.Name = TEXT("DistrictIDTexture");
+		FStageSample tilesDone;
+		tilesDone.Name = TEXT("TileBuffers");
+		FGraphEventArray timers;
+		auto addTimer = [&timers](FStageSample& Sample, const FGraphEventArray& Prerequisites)
+		{
+			timers.Add(FFunctionGraphTask::CreateAndDispatchWhenReady([&Sample]
+			{
+				Sample.Seconds = FPlatformTime::Seconds();
+				Sample.UsedPhysicalDelta = FPlatformMemory::GetStats().UsedPhysical;
+			}, TStatId(), &Prerequisites));
+		};
+		addTimer(mapDataDone, {assets->GenerateMapDataTask});
+		addTimer(textureDone, {assets->GenDistrictIDTextureTask});
+		addTimer(tilesDone, tileTasks);
+		timers.Add(assets->GetCompletionTask());
+		FTaskGraphInterface::Get().WaitUntilTasksComplete(timers, ENamedThreads::GameThread);
+		for (FStageSample* sample : {&textureDone, &tilesDone})
+		{
+			sample->Seconds -= mapDataDone.Seconds;
+			sample->UsedPhysicalDelta -= mapDataDone.UsedPhysicalDelta;
+			sample->LayersAllocatedSize = mapData->GetLayersAllocatedSize();
+		}
+		mapData->bIncrementalRegeneration = false;
+
+		double totalSeconds = FMath::Max(textureDone.Seconds, tilesDone.Seconds);
+		for (const FStageSample& sample : samples)
+		{
+			totalSeconds += sample.Seconds;
+		}
+		samples.Add(textureDone);
+		samples.Add(tilesDone);
+		TArray<TSharedPtr<FJsonValue>> stageValues;
+		for (const FStageSample& sample : samples)
+		{
+			const TSharedRef<FJsonObject> stageObject = MakeShared<FJsonObject>();
+			stageObject->SetStringField(TEXT("name"), sample.Name);
+			stageObject->SetNumberField(TEXT("seconds"), sample.Seconds);
+			stageObject->SetNumberField(TEXT("usedPhysicalDelta"), sample.UsedPhysicalDelta);
+			stageObject->SetNumberField(TEXT("layersAllocatedSize"), sample.LayersAllocatedSize);
+			stageValues.Add(MakeShared<FJsonValueObject>(stageObject));
+		}
+		const TSharedRef<FJsonObject> runObject = MakeShared<FJsonObject>();
+		runObject->SetNumberField(TEXT("seed"), seed);
+		runObject->SetNumberField(TEXT("regions"), mapData->Mesh->NumSolidRegions);
+		runObject->SetNumberField(TEXT("seconds"), totalSeconds);
+		runObject->SetArrayField(TEXT("stages"), stageValues);
+		runs.Add(MakeShared<FJsonValueObject>(runObject));
+		AddInfo(FString::Printf(TEXT("Seed %d: %d regions in %.3f seconds."), seed, mapData->Mesh->NumSolidRegions,
+		                        totalSeconds));
+	}
+
+	const TSharedRef<FJsonObject> report = BenchmarkReport::Create(TEXT("IslandGeneration"), Parameters);
+	report->SetNumberField(TEXT("peakUsedPhysical"), FPlatformMemory::GetStats().PeakUsedPhysical);
+	report->SetArrayField(TEXT("runs"), runs);
+	return BenchmarkReport::Save(*this, report);
+}
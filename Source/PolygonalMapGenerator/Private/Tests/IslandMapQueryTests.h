@@ -0,0 +1,166 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "IslandMapQuery.h"
+#include "RandomSampling/PoissonDiscUtilities.h"
+#include "TriangleDualMesh.h"
+
+/**
+ * Answers random points with FIslandMapQuery and with the scans it replaces: the closest region by comparing every
+ * region, the elevation by interpolating over the first triangle that holds the point. Both have to agree, points
+ * outside of the mesh included, and the batched queries have to return what the single queries do.
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FIslandMapQueryTest, "Procedural Generation.PolygonalMapGenerator.Check Map Query", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter | EAutomationTestFlags::MediumPriority)
+
+namespace IslandMapQueryTests
+{
+	const FVector2D MapSize(1000.0, 1000.0);
+	constexpr float MinimumDistance = 20.f;
+	constexpr int32 QueryNum = 2000;
+
+	int32 FindRegionByScan(const UTriangleDualMesh* Mesh, const FVector2D& Point)
+	{
+		int32 closest = INDEX_NONE;
+		double closestDistance = TNumericLimits<double>::Max();
+		for (int32 r = 0; r < Mesh->NumSolidRegions; r++)
+		{
+			const double distance = FVector2D::DistSquared(Mesh->r_pos(r), Point);
+			if (distance < closestDistance)
+			{
+				closest = r;
+				closestDistance = distance;
+			}
+		}
+		return closest;
+	}
+
+	float InterpolateByScan(const UTriangleDualMesh* Mesh, const TArray<float>& Elevations, const FVector2D& Point,
+	                        const int32 Region)
+	{
+		for (int32 t = 0; t < Mesh->NumSolidTriangles; t++)
+		{
+			const FPointIndex a = Mesh->s_begin_r(3 * t);
+			const FPointIndex b = Mesh->s_begin_r(3 * t + 1);
+			const FPointIndex c = Mesh->s_begin_r(3 * t + 2);
+			if (a >= static_cast<SIZE_T>(Mesh->NumSolidRegions) || b >= static_cast<SIZE_T>(Mesh->NumSolidRegions)
+				|| c >= static_cast<SIZE_T>(Mesh->NumSolidRegions))
+			{
+				continue;
+			}
+			const FVector2D posA = Mesh->r_pos(a);
+			const FVector2D posB = Mesh->r_pos(b);
+			const FVector2D posC = Mesh->r_pos(c);
+			const double area = FVector2D::CrossProduct(posB - posA, posC - posA);
+			if (area == 0.)
+			{
+				continue;
+			}
+			const double weightA = FVector2D::CrossProduct(posC - posB, Point - posB) / area;
+			const double weightB = FVector2D::CrossProduct(posA - posC, Point - posC) / area;
+			const double weightC = FVector2D::CrossProduct(posB - posA, Point - posA) / area;
+			if (weightA >= 0. && weightB >= 0. && weightC >= 0.)
+			{
+				return static_cast<float>(weightA * Elevations[a] + weightB * Elevations[b] + weightC * Elevations[c]);
+			}
+		}
+		return Elevations[Region];
+	}
+}
+
+bool FIslandMapQueryTest::RunTest(const FString& Parameters)
+{
+	using namespace IslandMapQueryTests;
+	TArray<FVector2D> points;
+	UPoissonDiscUtilities::Distribute2D(points, 0, MapSize, FVector2D::ZeroVector, MinimumDistance);
+	const FDualMesh dualMesh(points, MapSize);
+	UTriangleDualMesh* mesh = NewObject<UTriangleDualMesh>();
+	mesh->InitializeMesh(dualMesh, 0);
+	const int32 regionNum = mesh->NumSolidRegions;
+	if (regionNum == 0)
+	{
+		AddError(TEXT("The test mesh has no regions."));
+		return false;
+	}
+
+	FRandomStream rng(0);
+	TArray<float> elevations;
+	TArray<ERegionFlags> flags;
+	TArray<uint8> biomes;
+	TArray<int32> districts;
+	for (int32 r = 0; r < regionNum; r++)
+	{
+		elevations.Add(rng.FRand());
+		flags.Add(rng.FRand() < 0.3f ? ERegionFlags::Water | ERegionFlags::Ocean : ERegionFlags::None);
+		biomes.Add(static_cast<uint8>(rng.RandRange(0, 7)));
+		districts.Add(rng.RandRange(INDEX_NONE, 4));
+	}
+	FIslandMapQuery query;
+	query.Build(*mesh, elevations, flags, biomes, districts);
+
+	// A margin around the map covers the points the triangle walk leaves the mesh for
+	TArray<FVector2D> queries;
+	for (int32 i = 0; i < QueryNum; i++)
+	{
+		queries.Emplace(rng.FRandRange(-0.1 * MapSize.X, 1.1 * MapSize.X), rng.FRandRange(-0.1 * MapSize.Y, 1.1 * MapSize.Y));
+	}
+	TArray<FIslandMapSample> samples;
+	samples.SetNum(QueryNum);
+	query.SampleAll(queries, samples);
+	TArray<float> batchElevations;
+	batchElevations.SetNum(QueryNum);
+	query.GetElevationsAt(queries, batchElevations);
+
+	for (int32 i = 0; i < QueryNum; i++)
+	{
+		const FVector2D& point = queries[i];
+		const FIslandMapSample sample = query.Sample(point);
+		int32 expectedRegion = FindRegionByScan(mesh, point);
+		// Equally close regions may be found in either order
+		if (sample.Region.IsValid() && static_cast<int32>(sample.Region) != expectedRegion
+			&& FMath::IsNearlyEqual(FVector2D::Distance(mesh->r_pos(sample.Region), point),
+			                        FVector2D::Distance(mesh->r_pos(expectedRegion), point)))
+		{
+			expectedRegion = static_cast<int32>(sample.Region);
+		}
+		if (!sample.Region.IsValid() || static_cast<int32>(sample.Region) != expectedRegion)
+		{
+			AddError(FString::Printf(TEXT("The query found region %d at %s, the scan found region %d"),
+			                         sample.Region.IsValid() ? static_cast<int32>(sample.Region) : INDEX_NONE,
+			                         *point.ToString(), expectedRegion));
+			return false;
+		}
+
+		const float expectedElevation = InterpolateByScan(mesh, elevations, point, expectedRegion);
+		if (!FMath::IsNearlyEqual(sample.Elevation, expectedElevation, 1e-4f))
+		{
+			AddError(FString::Printf(TEXT("The query interpolated elevation %f at %s, the scan %f"), sample.Elevation,
+			                         *point.ToString(), expectedElevation));
+			return false;
+		}
+		if (sample.Biome != biomes[expectedRegion] || sample.District != districts[expectedRegion]
+			|| sample.bOcean != EnumHasAnyFlags(flags[expectedRegion], ERegionFlags::Ocean))
+		{
+			AddError(FString::Printf(TEXT("The query sampled biome %d, district %d, ocean %d at %s, region %d holds %d, %d, %d"),
+			                         sample.Biome, sample.District, sample.bOcean, *point.ToString(), expectedRegion,
+			                         biomes[expectedRegion], districts[expectedRegion],
+			                         EnumHasAnyFlags(flags[expectedRegion], ERegionFlags::Ocean)));
+			return false;
+		}
+
+		if (query.GetElevationAt(point) != sample.Elevation || query.GetBiomeAt(point) != sample.Biome
+			|| query.GetDistrictAt(point) != sample.District || query.IsOceanAt(point) != sample.bOcean)
+		{
+			AddError(FString::Printf(TEXT("The single attribute queries differ from Sample at %s"), *point.ToString()));
+			return false;
+		}
+		if (samples[i].Region != sample.Region || samples[i].Elevation != sample.Elevation
+			|| batchElevations[i] != sample.Elevation)
+		{
+			AddError(FString::Printf(TEXT("The batched queries differ from Sample at %s"), *point.ToString()));
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,184 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "IslandDeterminismTests.h"
+
+/**
+ * Generates a few seeds and traces the district outlines and coastlines again by the edge maps and pointer walks
+ * that UIslandMapUtils::ExtractBoundaryLoops replaced. Every outline has to come out with the same triangles in the
+ * same order, starting at the same edge.
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FIslandOutlineTest, "Procedural Generation.PolygonalMapGenerator.Check Outlines", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter | EAutomationTestFlags::MediumPriority)
+
+namespace IslandOutlineTests
+{
+	// Follows the next edges from Begin until it returns, false if the loop does not close
+	bool WalkLoop(const TArray<FRegionEdge>& Edges, const TArray<int32>& Next, const int32 Begin, FAreaContour& OutContour)
+	{
+		int32 edge = Begin;
+		do
+		{
+			OutContour.Indices.Add(Edges[edge].AIndex);
+			OutContour.Positions.Add(Edges[edge].APosition);
+			edge = Next[edge];
+		}
+		while (edge != Begin && edge != INDEX_NONE && OutContour.Indices.Num() <= Edges.Num());
+		return edge == Begin;
+	}
+
+	// One edge per outer triangle in the order they were first found, a later edge replaces the earlier one.
+	// Each edge links to the first edge that starts where it ends, the outline starts at the first edge.
+	bool TraceDistrict(const UTriangleDualMesh* Mesh, const TArray<int32>& RegionDistricts, const int32 District,
+	                   FAreaContour& OutContour)
+	{
+		TMap<FTriangleIndex, FRegionEdge> edgesByEnd;
+		for (int32 r = 0; r < RegionDistricts.Num(); r++)
+		{
+			if (RegionDistricts[r] != District)
+			{
+				continue;
+			}
+			Mesh->r_circulate_s(FPointIndex(r), [&](const FSideIndex s)
+			{
+				if (RegionDistricts[Mesh->s_end_r(s)] != District)
+				{
+					const FTriangleIndex a = Mesh->s_inner_t(s);
+					const FTriangleIndex b = Mesh->s_outer_t(s);
+					edgesByEnd.Add(b, FRegionEdge(a, Mesh->t_pos(a), b, Mesh->t_pos(b)));
+				}
+			});
+		}
+		TArray<FRegionEdge> edges;
+		edgesByEnd.GenerateValueArray(edges);
+		TMap<FTriangleIndex, int32> edgeIndices;
+		for (int32 edge = 0; edge < edges.Num(); edge++)
+		{
+			edgeIndices.Add(edges[edge].BIndex, edge);
+		}
+		TArray<int32> next;
+		next.Init(INDEX_NONE, edges.Num());
+		for (int32 edge = 0; edge < edges.Num(); edge++)
+		{
+			const int32* previous = edgeIndices.Find(edges[edge].AIndex);
+			if (previous != nullptr && next[*previous] == INDEX_NONE)
+			{
+				next[*previous] = edge;
+			}
+		}
+		return edges.IsEmpty() || WalkLoop(edges, next, 0, OutContour);
+	}
+
+	// Every coast edge in region order. The last edge ending in a triangle links to the first edge starting there,
+	// every edge not on an earlier loop starts the next one.
+	bool TraceCoastlines(const UTriangleDualMesh* Mesh, const TArray<ERegionFlags>& RegionFlags,
+	                     TArray<FAreaContour>& OutContours)
+	{
+		TArray<FRegionEdge> edges;
+		TMap<FTriangleIndex, int32> edgesByEnd;
+		for (int32 r = 0; r < Mesh->NumSolidRegions; r++)
+		{
+			if (!EnumHasAnyFlags(RegionFlags[r], ERegionFlags::Coast))
+			{
+				continue;
+			}
+			Mesh->r_circulate_s(FPointIndex(r), [&](const FSideIndex s)
+			{
+				if (EnumHasAnyFlags(RegionFlags[Mesh->s_end_r(s)], ERegionFlags::Ocean))
+				{
+					const FTriangleIndex a = Mesh->s_inner_t(s);
+					const FTriangleIndex b = Mesh->s_outer_t(s);
+					edgesByEnd.Add(b, edges.Emplace(a, Mesh->t_pos(a), b, Mesh->t_pos(b)));
+				}
+			});
+		}
+		TArray<int32> next;
+		next.Init(INDEX_NONE, edges.Num());
+		for (int32 edge = 0; edge < edges.Num(); edge++)
+		{
+			const int32* previous = edgesByEnd.Find(edges[edge].AIndex);
+			if (previous != nullptr && next[*previous] == INDEX_NONE)
+			{
+				next[*previous] = edge;
+			}
+		}
+		TBitArray<> visited(false, edges.Num());
+		for (int32 begin = 0; begin < edges.Num(); begin++)
+		{
+			if (visited[begin])
+			{
+				continue;
+			}
+			FAreaContour& contour = OutContours.AddDefaulted_GetRef();
+			if (!WalkLoop(edges, next, begin, contour))
+			{
+				return false;
+			}
+			for (int32 edge = begin; !visited[edge]; edge = next[edge])
+			{
+				visited[edge] = true;
+			}
+		}
+		return true;
+	}
+
+	bool IsSameContour(const FAreaContour& Contour, const FAreaContour& Expected)
+	{
+		return Contour.Indices == Expected.Indices && Contour.Positions == Expected.Positions;
+	}
+}
+
+bool FIslandOutlineTest::RunTest(const FString& Parameters)
+{
+	using namespace IslandDeterminismTests;
+	using namespace IslandOutlineTests;
+	UIslandMapData* mapData = CreateMapData();
+	for (const FIslandBatchCandidate& candidate : Candidates)
+	{
+		UIslandBatchGenerator::ApplyCandidate(mapData, candidate);
+		mapData->InvalidateGenerationCache();
+		mapData->GenerateIsland();
+		const UTriangleDualMesh* mesh = mapData->Mesh;
+
+		for (const FDistrictRegion& district : mapData->GetDistrictRegions())
+		{
+			FAreaContour expected;
+			if (!TraceDistrict(mesh, mapData->GetRegionDistricts(), district.District, expected))
+			{
+				AddError(FString::Printf(TEXT("Seed %d: the outline of district %d does not close"), candidate.Seed,
+				                         district.District));
+				return false;
+			}
+			if (!IsSameContour(district, expected))
+			{
+				AddError(FString::Printf(TEXT("Seed %d: district %d has %d outline points, the reference walk %d"),
+				                         candidate.Seed, district.District, district.Indices.Num(), expected.Indices.Num()));
+				return false;
+			}
+		}
+
+		TArray<FAreaContour> expected;
+		if (!TraceCoastlines(mesh, mapData->GetRegionFlags(), expected))
+		{
+			AddError(FString::Printf(TEXT("Seed %d: a coastline does not close"), candidate.Seed));
+			return false;
+		}
+		const TArray<FCoastlinePolygon>& coastlines = mapData->GetCoastLines();
+		if (coastlines.Num() != expected.Num())
+		{
+			AddError(FString::Printf(TEXT("Seed %d has %d coastlines, the reference walk %d"), candidate.Seed,
+			                         coastlines.Num(), expected.Num()));
+			return false;
+		}
+		for (int32 i = 0; i < coastlines.Num(); i++)
+		{
+			if (!IsSameContour(coastlines[i], expected[i]))
+			{
+				AddError(FString::Printf(TEXT("Seed %d: coastline %d differs from the reference walk"), candidate.Seed, i));
+				return false;
+			}
+		}
+	}
+	return true;
+}
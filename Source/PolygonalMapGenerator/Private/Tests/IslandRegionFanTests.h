@@ -0,0 +1,106 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "IslandMapUtils.h"
+#include "RandomSampling/PoissonDiscUtilities.h"
+#include "TriangleDualMesh.h"
+
+/**
+ * Builds the fans of random region subsets with UIslandMapUtils::BuildRegionFans and with the serial walk over the
+ * regions that numbered the vertices of the land mesh through a map before. Vertices and triangles have to match
+ * one to one, in the same order.
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FIslandRegionFanTest, "Procedural Generation.PolygonalMapGenerator.Check Region Fans", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter | EAutomationTestFlags::MediumPriority)
+
+namespace IslandRegionFanTests
+{
+	const FVector2D MapSize(1000.0, 1000.0);
+	constexpr float MinimumDistance = 15.f;
+	const int32 Seeds[] = { 0, 1, 42 };
+
+	void BuildFansSerially(const UTriangleDualMesh* Mesh, const TArray<bool>& Included,
+	                       TArray<FTriangleIndex>& OutVertexTriangles, TArray<FIntVector>& OutTriangles)
+	{
+		TMap<FTriangleIndex, int32> vertices;
+		for (int32 r = 0; r < Mesh->NumSolidRegions; r++)
+		{
+			const TArray<FTriangleIndex> fan = Mesh->r_circulate_t(FPointIndex(r));
+			if (!Included[r] || fan.Num() < 3)
+			{
+				continue;
+			}
+			int32 firstVertex = INDEX_NONE;
+			int32 previousVertex = INDEX_NONE;
+			for (int32 index = 0; index < fan.Num(); index++)
+			{
+				const int32* found = vertices.Find(fan[index]);
+				const int32 vertex = found != nullptr ? *found : vertices.Add(fan[index], OutVertexTriangles.Add(fan[index]));
+				if (index == 0)
+				{
+					firstVertex = vertex;
+				}
+				else if (index >= 2)
+				{
+					OutTriangles.Emplace(vertex, previousVertex, firstVertex);
+				}
+				previousVertex = vertex;
+			}
+		}
+	}
+}
+
+bool FIslandRegionFanTest::RunTest(const FString& Parameters)
+{
+	using namespace IslandRegionFanTests;
+	TArray<FVector2D> points;
+	UPoissonDiscUtilities::Distribute2D(points, 0, MapSize, FVector2D::ZeroVector, MinimumDistance);
+	const FDualMesh dualMesh(points, MapSize);
+	UTriangleDualMesh* mesh = NewObject<UTriangleDualMesh>();
+	mesh->InitializeMesh(dualMesh, 0);
+
+	for (const int32 seed : Seeds)
+	{
+		// Mostly included regions with scattered holes, like the land of an island
+		FRandomStream rng(seed);
+		TArray<bool> included;
+		for (int32 r = 0; r < mesh->NumSolidRegions; r++)
+		{
+			included.Add(rng.FRand() < 0.7f);
+		}
+
+		TArray<FTriangleIndex> expectedVertices;
+		TArray<FIntVector> expectedTriangles;
+		BuildFansSerially(mesh, included, expectedVertices, expectedTriangles);
+		TArray<FTriangleIndex> vertexTriangles;
+		TArray<FIntVector> triangles;
+		TArray<int32> triangleVertices;
+		UIslandMapUtils::BuildRegionFans(mesh, [&included](const FPointIndex Region) { return included[Region]; },
+		                                 vertexTriangles, triangles, triangleVertices);
+
+		if (vertexTriangles != expectedVertices)
+		{
+			AddError(FString::Printf(TEXT("Seed %d numbered %d fan vertices, the serial walk %d or in another order"),
+			                         seed, vertexTriangles.Num(), expectedVertices.Num()));
+			return false;
+		}
+		if (triangles != expectedTriangles)
+		{
+			AddError(FString::Printf(TEXT("Seed %d built %d fan triangles, the serial walk %d or in another order"),
+			                         seed, triangles.Num(), expectedTriangles.Num()));
+			return false;
+		}
+		for (int32 vertex = 0; vertex < vertexTriangles.Num(); vertex++)
+		{
+			if (triangleVertices[vertexTriangles[vertex]] != vertex)
+			{
+				AddError(FString::Printf(TEXT("Seed %d maps triangle %d to vertex %d instead of %d"), seed,
+				                         static_cast<int32>(vertexTriangles[vertex]),
+				                         triangleVertices[vertexTriangles[vertex]], vertex));
+				return false;
+			}
+		}
+	}
+	return true;
+}
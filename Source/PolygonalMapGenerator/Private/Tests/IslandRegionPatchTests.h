@@ -0,0 +1,76 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "IslandDeterminismTests.h"
+
+/**
+ * Turns an inland region into a lake and then into ocean with region patches, and patches it back after each edit.
+ * The lakes, coast distances and coastlines have to follow the flags, and patching the original flags back has to
+ * restore exactly the island the stages generated.
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FIslandRegionPatchFlagsTest, "Procedural Generation.PolygonalMapGenerator.Replication.Region Patch Flags", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter | EAutomationTestFlags::MediumPriority)
+
+namespace IslandRegionPatchTests
+{
+	// A land region whose neighbours are all dry land, so flooding it makes a lake of its own
+	int32 FindInlandRegion(const UIslandMapData* MapData)
+	{
+		const UTriangleDualMesh* mesh = MapData->Mesh;
+		const TArray<ERegionFlags>& flags = MapData->GetRegionFlags();
+		for (int32 r = 0; r < mesh->NumSolidRegions; r++)
+		{
+			bool bInland = flags[r] == ERegionFlags::None;
+			mesh->r_circulate_r(FPointIndex(r), [&](FPointIndex neighbor)
+			{
+				bInland &= neighbor < static_cast<SIZE_T>(mesh->NumSolidRegions) && flags[neighbor] == ERegionFlags::None;
+			});
+			if (bInland)
+			{
+				return r;
+			}
+		}
+		return INDEX_NONE;
+	}
+}
+
+bool FIslandRegionPatchFlagsTest::RunTest(const FString& Parameters)
+{
+	using namespace IslandDeterminismTests;
+	UIslandMapData* mapData = CreateMapData();
+	UIslandBatchGenerator::ApplyCandidate(mapData, Candidates[0]);
+	mapData->GenerateIsland();
+	const FIslandHashes generated = HashIsland(mapData);
+	const int32 lakeCount = mapData->GetLakeCount();
+	const TArray<int32> coastDistances = mapData->GetTriangleCoastDistances();
+
+	const int32 region = IslandRegionPatchTests::FindInlandRegion(mapData);
+	if (region == INDEX_NONE)
+	{
+		AddError(TEXT("The test island has no inland region."));
+		return false;
+	}
+	const FIslandRegionPatch original = mapData->MakeRegionPatch(region, 1);
+
+	FIslandRegionPatch lake = original;
+	lake.Flags[0] = ERegionFlags::Water | ERegionFlags::Lake;
+	if (!mapData->ApplyRegionPatch(lake))
+	{
+		AddError(TEXT("The lake patch was rejected."));
+		return false;
+	}
+	TestEqual(TEXT("Lakes after flooding an inland region"), mapData->GetLakeCount(), lakeCount + 1);
+	TestTrue(TEXT("The flooded region is labelled as a lake"), mapData->GetPointLake(FPointIndex(region)) != INDEX_NONE);
+	mapData->ApplyRegionPatch(original);
+	TestTrue(TEXT("The island after patching the lake back"), HashIsland(mapData) == generated);
+
+	FIslandRegionPatch ocean = original;
+	ocean.Flags[0] = ERegionFlags::Water | ERegionFlags::Ocean;
+	mapData->ApplyRegionPatch(ocean);
+	TestTrue(TEXT("Coast distances follow the new ocean"), mapData->GetTriangleCoastDistances() != coastDistances);
+	TestTrue(TEXT("Coastlines follow the new ocean"), HashIsland(mapData).Coastlines != generated.Coastlines);
+	mapData->ApplyRegionPatch(original);
+	TestTrue(TEXT("The island after patching the ocean back"), HashIsland(mapData) == generated);
+	return true;
+}
@@ -0,0 +1,56 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Algo/StableSort.h"
+#include "IslandMapUtils.h"
+
+/**
+ * Sorts random index lists with UIslandMapUtils::SortIndicesByValue and with a stable comparison sort, the way the
+ * moisture and elevation redistribution sorted before. Values repeat a lot, so ties have to keep their input order,
+ * and the larger lists span several chunks of the parallel passes.
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FIslandSortIndicesTest, "Procedural Generation.PolygonalMapGenerator.Sort Indices By Value", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter | EAutomationTestFlags::MediumPriority)
+
+namespace IslandSortTests
+{
+	const int32 Seeds[] = { 0, 1, 42 };
+	const int32 IndexNums[] = { 0, 1, 2, 17, 1000, 50000 };
+}
+
+bool FIslandSortIndicesTest::RunTest(const FString& Parameters)
+{
+	using namespace IslandSortTests;
+	for (const int32 seed : Seeds)
+	{
+		for (const int32 indexNum : IndexNums)
+		{
+			FRandomStream rng(seed);
+			// Every other value is one of a few steps, the rest spread over negative and positive values
+			TArray<float> values;
+			values.SetNumUninitialized(2 * indexNum + 1);
+			for (float& value : values)
+			{
+				value = rng.FRand() < 0.5f ? rng.RandRange(-8, 8) * 0.25f : rng.FRandRange(-1000.f, 1000.f);
+			}
+			// A shuffled subset, like the land regions
+			TArray<int32> indices;
+			for (int32 i = 0; i < indexNum; i++)
+			{
+				indices.Add(rng.RandRange(0, values.Num() - 1));
+			}
+
+			TArray<int32> expected = indices;
+			Algo::StableSort(expected, [&values](const int32 A, const int32 B) { return values[A] < values[B]; });
+			UIslandMapUtils::SortIndicesByValue(indices, values);
+			if (indices != expected)
+			{
+				AddError(FString::Printf(TEXT("Seed %d sorted %d indices differently from the stable sort"), seed,
+				                         indexNum));
+				return false;
+			}
+		}
+	}
+	return true;
+}
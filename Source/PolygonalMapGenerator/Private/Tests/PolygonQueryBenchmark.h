@@ -0,0 +1,97 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Coastline/CoastlineSpatialIndex.h"
+#include "Coastline/IslandCoastline.h"
+#include "IslandMapUtils.h"
+#include "Tests/BenchmarkReport.h"
+
+/**
+ * Times UIslandMapUtils::PointInPolygon2D and DistanceToPolygon2D against a fixed noisy circle with the vertex count
+ * returned by GetTests, next to FCoastlineSpatialIndex answering the same queries. Written to
+ * Saved/Benchmarks/PolygonQueries_<Size>.json in the same layout as the DualMesh benchmark.
+ */
+IMPLEMENT_COMPLEX_AUTOMATION_TEST(FPolygonQueryBenchmark, "Procedural Generation.PolygonalMapGenerator.Benchmark.Polygon Queries", EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter | EAutomationTestFlags::LowPriority)
+
+namespace PolygonQueryBenchmark
+{
+	constexpr int32 QueryNum = 10000;
+}
+
+void FPolygonQueryBenchmark::GetTests(TArray<FString>& OutBeautifiedNames, TArray<FString>& OutTestCommands) const
+{
+	const TCHAR* sizes[] = { TEXT("64"), TEXT("1024"), TEXT("16384") };
+	for (const TCHAR* size : sizes)
+	{
+		OutBeautifiedNames.Add(size);
+		OutTestCommands.Add(size);
+	}
+}
+
+bool FPolygonQueryBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace PolygonQueryBenchmark;
+	using BenchmarkReport::Measure;
+	const int32 vertexNum = FMath::Max(FCString::Atoi(*Parameters), 3);
+	FRandomStream rng(0);
+	FCoastlinePolygon coastline;
+	for (int32 i = 0; i < vertexNum; i++)
+	{
+		const double angle = UE_DOUBLE_TWO_PI * i / vertexNum;
+		const double radius = 1000.0 * rng.FRandRange(0.8, 1.0);
+		coastline.Positions.Emplace(radius * FMath::Cos(angle), radius * FMath::Sin(angle));
+	}
+	const TArray<FVector2D>& polygon = coastline.Positions;
+	TArray<FVector2D> queries;
+	queries.SetNumUninitialized(QueryNum);
+	for (FVector2D& query : queries)
+	{
+		query = FVector2D(rng.FRandRange(-1200.0, 1200.0), rng.FRandRange(-1200.0, 1200.0));
+	}
+	FCoastlineSpatialIndex spatialIndex;
+	spatialIndex.Build({coastline});
+
+	TArray<TSharedPtr<FJsonValue>> results;
+	results.Add(MakeShared<FJsonValueObject>(Measure(TEXT("PointInPolygon2D"), QueryNum, [&]
+	{
+		int32 inside = 0;
+		for (const FVector2D& query : queries)
+		{
+			inside += UIslandMapUtils::PointInPolygon2D(query, polygon) ? 1 : 0;
+		}
+		return static_cast<double>(inside);
+	})));
+	results.Add(MakeShared<FJsonValueObject>(Measure(TEXT("DistanceToPolygon2D"), QueryNum, [&]
+	{
+		double sum = 0.;
+		for (const FVector2D& query : queries)
+		{
+			sum += UIslandMapUtils::DistanceToPolygon2D(query, polygon, false);
+		}
+		return sum;
+	})));
+	results.Add(MakeShared<FJsonValueObject>(Measure(TEXT("SpatialIndexIsInside"), QueryNum, [&]
+	{
+		int32 inside = 0;
+		for (const FVector2D& query : queries)
+		{
+			inside += spatialIndex.IsInside(query) ? 1 : 0;
+		}
+		return static_cast<double>(inside);
+	})));
+	results.Add(MakeShared<FJsonValueObject>(Measure(TEXT("SpatialIndexDistanceToCoast"), QueryNum, [&]
+	{
+		double sum = 0.;
+		for (const FVector2D& query : queries)
+		{
+			sum += spatialIndex.DistanceToCoast(query, 500.0);
+		}
+		return sum;
+	})));
+
+	const TSharedRef<FJsonObject> report = BenchmarkReport::Create(TEXT("PolygonQueries"), Parameters);
+	report->SetArrayField(TEXT("results"), results);
+	return BenchmarkReport::Save(*this, report);
+}
@@ -17,4 +17,13 @@
 */
 
 #include "PolygonalMapGeneratorTests.h"
+#include "IslandGenerationBenchmark.h"
+#include "IslandDeterminismTests.h"
+#include "IslandCacheTests.h"
+#include "IslandMapQueryTests.h"
+#include "IslandOutlineTests.h"
+#include "IslandRegionFanTests.h"
+#include "IslandRegionPatchTests.h"
+#include "IslandSortTests.h"
+#include "PolygonQueryBenchmark.h"
 
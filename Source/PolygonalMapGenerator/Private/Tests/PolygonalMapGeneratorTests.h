@@ -19,10 +19,57 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Biomes/BiomeLookupTable.h"
+#include "Engine/DataTable.h"
 
 IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWaterTest, "Procedural Generation.PolygonalMapGenerator.Check Water Generation", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter | EAutomationTestFlags::LowPriority)
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBiomeLookupTest, "Procedural Generation.PolygonalMapGenerator.Check Biome Lookup", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter | EAutomationTestFlags::MediumPriority)
 
 bool FWaterTest::RunTest(const FString& Parameters)
 {
 	return true;
-}
\ No newline at end of file
+}
+
+bool FBiomeLookupTest::RunTest(const FString& Parameters)
+{
+	UDataTable* biomeTable = NewObject<UDataTable>();
+	biomeTable->RowStruct = FBiomeData::StaticStruct();
+
+	FRandomStream rng(0);
+	const float bounds[] = { 0.0f, 0.25f, 0.5f, 0.75f, 1.0f };
+	for (int i = 0; i < 12; i++)
+	{
+		FBiomeData biome;
+		biome.bIsOcean = rng.FRand() < 0.3f;
+		biome.bIsWater = rng.FRand() < 0.3f;
+		biome.bIsCoast = rng.FRand() < 0.3f;
+		biome.MinMoisture = bounds[rng.RandRange(0, 2)];
+		biome.MaxMoisture = bounds[rng.RandRange(2, 4)];
+		biome.MinTemperature = bounds[rng.RandRange(0, 2)];
+		biome.MaxTemperature = bounds[rng.RandRange(2, 4)];
+		biome.DebugColor = FColor(i, 0, 0);
+		biomeTable->AddRow(*FString::Printf(TEXT("Biome%d"), i), biome);
+	}
+
+	FBiomeLookupTable lookup;
+	lookup.Build(biomeTable);
+	for (int i = 0; i < 2000; i++)
+	{
+		const bool bIsOcean = rng.FRand() < 0.5f;
+		const bool bIsWater = rng.FRand() < 0.5f;
+		const bool bIsCoast = rng.FRand() < 0.5f;
+		const float temperature = i % 2 ? bounds[rng.RandRange(0, 4)] : rng.FRandRange(-0.5f, 1.5f);
+		const float moisture = i % 3 ? bounds[rng.RandRange(0, 4)] : rng.FRandRange(-0.5f, 1.5f);
+
+		const FBiomeData expected = UIslandMapUtils::GetBiome(biomeTable, bIsOcean, bIsWater, bIsCoast, temperature, moisture);
+		const int32 biome = lookup.Resolve(bIsOcean, bIsWater, bIsCoast, temperature, moisture);
+		const FColor actual = biome == INDEX_NONE ? FBiomeData().DebugColor : lookup.GetBiomes()[biome].DebugColor;
+		if (actual != expected.DebugColor)
+		{
+			AddError(FString::Printf(TEXT("Biome lookup differs for ocean %d, water %d, coast %d, temperature %f and moisture %f: got %s, expected %s"),
+				bIsOcean, bIsWater, bIsCoast, temperature, moisture, *actual.ToString(), *expected.DebugColor.ToString()));
+			return false;
+		}
+	}
+	return true;
+}
@@ -17,14 +17,138 @@
 */
 
 #include "Water/IslandNoiseWater.h"
+#include "IslandComputeGPU.h"
+#include "Misc/ScopeLock.h"
 
 bool UIslandNoiseWater::IsPointLand_Implementation(FPointIndex Point, UTriangleDualMesh* Mesh, const FVector2D& HalfMeshSize, const FVector2D& Offset, const FIslandShape& Shape) const
 {
-	FVector2D nVector = Mesh->r_pos(Point);
+	FVector2D nVector = GetNoisePosition(Mesh->r_pos(Point), HalfMeshSize, Offset, Shape);
+	if (bCacheNoiseField)
+	{
+		return IsNoiseLand(GetNoiseField(HalfMeshSize, Offset, Shape)->Sample(nVector), nVector);
+	}
+	return IsNoiseLand(UIslandMapUtils::FBMNoise(Shape.Amplitudes, nVector), nVector);
+}
+
+void UIslandNoiseWater::ClassifyRegions(TArray<bool>& r_water, UTriangleDualMesh* Mesh, const FVector2D& HalfMeshSize, const FVector2D& Offset, const FIslandShape& Shape) const
+{
+	if (IsPointLandImplementedInScript())
+	{
+		Super::ClassifyRegions(r_water, Mesh, HalfMeshSize, Offset, Shape);
+		return;
+	}
+
+	TArray<FPointIndex> regions;
+	TArray<FVector2D> positions;
+	regions.Reserve(r_water.Num());
+	positions.Reserve(r_water.Num());
+	for (FPointIndex r = 0; r < r_water.Num(); r++)
+	{
+		if (!Mesh->r_ghost(r) && !Mesh->r_boundary(r))
+		{
+			regions.Add(r);
+			positions.Add(GetNoisePosition(Mesh->r_pos(r), HalfMeshSize, Offset, Shape));
+		}
+	}
+
+	TArray<float> noise;
+	noise.SetNumUninitialized(positions.Num());
+	if (bCacheNoiseField)
+	{
+		const TSharedPtr<const FNoiseField, ESPMode::ThreadSafe> field = GetNoiseField(HalfMeshSize, Offset, Shape);
+		for (int32 i = 0; i < positions.Num(); i++)
+		{
+			noise[i] = field->Sample(positions[i]);
+		}
+	}
+	else
+	{
+		EvaluateNoise(Shape, positions, noise);
+	}
+	for (int32 i = 0; i < regions.Num(); i++)
+	{
+		r_water[regions[i]] = IsNoiseLand(noise[i], positions[i]);
+	}
+}
+
+TSharedPtr<const UIslandNoiseWater::FNoiseField, ESPMode::ThreadSafe> UIslandNoiseWater::GetNoiseField(const FVector2D& HalfMeshSize, const FVector2D& Offset, const FIslandShape& Shape) const
+{
+	// The offset comes from the seed, so the key covers everything the noise of a position depends on
+	const int32 resolution = FMath::Max(NoiseFieldResolution, 2);
+	uint32 key = HashCombine(GetTypeHash(resolution), HashCombine(GetTypeHash(Shape.IslandFragmentation), HashCombine(GetTypeHash(Offset), GetTypeHash(HalfMeshSize))));
+	for (const float amplitude : Shape.Amplitudes)
+	{
+		key = HashCombine(key, GetTypeHash(amplitude));
+	}
+
+	FScopeLock lock(&NoiseFieldLock);
+	if (NoiseField.IsValid() && NoiseField->Key == key)
+	{
+		return NoiseField;
+	}
+
+	TRACE_CPUPROFILER_EVENT_SCOPE(UIslandNoiseWater::GetNoiseField)
+	// Regions lie within [0, 2 * HalfMeshSize]
+	const FVector2D corner0 = GetNoisePosition(FVector2D::ZeroVector, HalfMeshSize, Offset, Shape);
+	const FVector2D corner1 = GetNoisePosition(HalfMeshSize * 2.0, HalfMeshSize, Offset, Shape);
+	const FVector2D min = FVector2D::Min(corner0, corner1);
+	const FVector2D extent = FVector2D::Max(corner0, corner1) - min;
+	const FVector2D step = extent / (resolution - 1);
+
+	const TSharedRef<FNoiseField, ESPMode::ThreadSafe> field = MakeShared<FNoiseField, ESPMode::ThreadSafe>();
+	field->Key = key;
+	field->Resolution = resolution;
+	field->Min = min;
+	field->CellsPerUnit = FVector2D(extent.X > 0.0 ? (resolution - 1) / extent.X : 0.0, extent.Y > 0.0 ? (resolution - 1) / extent.Y : 0.0);
+	TArray<FVector2D> positions;
+	positions.SetNumUninitialized(resolution * resolution);
+	for (int32 y = 0; y < resolution; y++)
+	{
+		for (int32 x = 0; x < resolution; x++)
+		{
+			positions[y * resolution + x] = min + FVector2D(x, y) * step;
+		}
+	}
+	field->Values.SetNumUninitialized(positions.Num());
+	EvaluateNoise(Shape, positions, field->Values);
+
+	NoiseField = field;
+	return NoiseField;
+}
+
+float UIslandNoiseWater::FNoiseField::Sample(const FVector2D& NoisePosition) const
+{
+	const FVector2D cell = (NoisePosition - Min) * CellsPerUnit;
+	const double x = FMath::Clamp(cell.X, 0.0, Resolution - 1.0);
+	const double y = FMath::Clamp(cell.Y, 0.0, Resolution - 1.0);
+	const int32 x0 = FMath::Min(FMath::FloorToInt32(x), Resolution - 2);
+	const int32 y0 = FMath::Min(FMath::FloorToInt32(y), Resolution - 2);
+	const float tx = x - x0;
+	const float ty = y - y0;
+	const float* row0 = &Values[y0 * Resolution + x0];
+	const float* row1 = row0 + Resolution;
+	return FMath::Lerp(FMath::Lerp(row0[0], row0[1], tx), FMath::Lerp(row1[0], row1[1], tx), ty);
+}
+
+void UIslandNoiseWater::EvaluateNoise(const FIslandShape& Shape, TConstArrayView<FVector2D> Positions, TArrayView<float> OutNoise) const
+{
+	if (bEvaluateNoiseOnGPU && IslandComputeGPU::FBMNoise(Positions, Shape.Amplitudes, OutNoise))
+	{
+		return;
+	}
+	UIslandMapUtils::FBMNoiseBatch(Shape.Amplitudes, Positions, OutNoise);
+}
+
+FVector2D UIslandNoiseWater::GetNoisePosition(const FVector2D& Position, const FVector2D& HalfMeshSize, const FVector2D& Offset, const FIslandShape& Shape)
+{
+	FVector2D nVector = Position;
 	nVector.X /= HalfMeshSize.X;
 	nVector.Y /= HalfMeshSize.Y;
-	nVector = (nVector + Offset) * Shape.IslandFragmentation;
-	float n = UIslandMapUtils::FBMNoise(Shape.Amplitudes, nVector);
-	float distance = FMath::Max(FMath::Abs(nVector.X), FMath::Abs(nVector.Y));
-	return n * distance * distance > WaterCutoff;
+	return (nVector + Offset) * Shape.IslandFragmentation;
+}
+
+bool UIslandNoiseWater::IsNoiseLand(float Noise, const FVector2D& NoisePosition) const
+{
+	float distance = FMath::Max(FMath::Abs(NoisePosition.X), FMath::Abs(NoisePosition.Y));
+	return Noise * distance * distance > WaterCutoff;
 }
@@ -30,28 +30,14 @@ void UIslandWater::AssignOcean_Implementation(TArray<bool>& r_ocean, UTriangleDu
 	/* A region is ocean if it is a water region connected to the ghost region,
 	which is outside the boundary of the map; this could be any seed set but
 	for islands, the ghost region is a good seed */
-	r_ocean.Empty(Mesh->NumRegions);
-	r_ocean.SetNumZeroed(Mesh->NumRegions);
-	TArray<FPointIndex> stack = { Mesh->ghost_r() };
-	r_ocean[stack[0]] = true;
-
-	while (stack.Num() > 0)
+	UIslandMapUtils::ResetLayer(r_ocean, Mesh->NumRegions);
+	TArray<int32> r_body;
+	const FPointIndex ghost = Mesh->ghost_r();
+	UIslandMapUtils::LabelConnectedRegions(Mesh, [&r_water, ghost](FPointIndex r) { return r == ghost || r_water[r]; }, r_body);
+	const int32 oceanBody = r_body[ghost];
+	for (int32 r = 0; r < r_ocean.Num(); r++)
 	{
-		FPointIndex r1 = stack.Pop();
-		check(r1.IsValid());
-		TArray<FPointIndex> r_out = Mesh->r_circulate_r(r1);
-		for (FPointIndex r2 : r_out)
-		{
-			if (!r2.IsValid())
-			{
-				continue;
-			}
-			if (r_water[r2] && !r_ocean[r2])
-			{
-				r_ocean[r2] = true;
-				stack.Add(r2);
-			}
-		}
+		r_ocean[r] = r_body[r] == oceanBody;
 	}
 
 #if !UE_BUILD_SHIPPING
@@ -82,26 +68,22 @@ void UIslandWater::AssignWater_Implementation(TArray<bool>& r_water, FRandomStre
 		int32 count = 0;
 #endif
 		/* A region is water if the noise value is low */
-		r_water.Empty(Mesh->NumRegions);
-		r_water.SetNumZeroed(Mesh->NumRegions);
+		UIslandMapUtils::ResetLayer(r_water, Mesh->NumRegions);
 
-		InitializeWater(r_water, Mesh, Rng);
+		ISLAND_CALL_NATIVE_OR_EVENT(UIslandWater, InitializeWater, r_water, Mesh, Rng);
 
 		FVector2D meshSize = Mesh->GetSize() * 0.5f;
 		FVector2D offset = FVector2D(Rng.FRandRange(-meshSize.X, meshSize.X), Rng.FRandRange(-meshSize.Y, meshSize.Y));
+		ClassifyRegions(r_water, Mesh, meshSize, offset, Shape);
 		for (FPointIndex r = 0; r < r_water.Num(); r++)
 		{
 			if (Mesh->r_ghost(r) || Mesh->r_boundary(r))
 			{
 				r_water[r] = true;
 			}
-			else
+			else if (bInvertLandAndWater)
 			{
-				r_water[r] = IsPointLand(r, Mesh, meshSize, offset, Shape);
-				if (bInvertLandAndWater)
-				{
-					r_water[r] = !r_water[r];
-				}
+				r_water[r] = !r_water[r];
 			}
 #if !UE_BUILD_SHIPPING
 			if (r_water[r])
@@ -121,6 +103,26 @@ void UIslandWater::AssignWater_Implementation(TArray<bool>& r_water, FRandomStre
 	}
 }
 
+void UIslandWater::ClassifyRegions(TArray<bool>& r_water, UTriangleDualMesh* Mesh, const FVector2D& HalfMeshSize, const FVector2D& Offset, const FIslandShape& Shape) const
+{
+	// Checked once, the event would otherwise be dispatched for every region
+	const bool bScriptPointLand = IsPointLandImplementedInScript();
+	for (FPointIndex r = 0; r < r_water.Num(); r++)
+	{
+		if (!Mesh->r_ghost(r) && !Mesh->r_boundary(r))
+		{
+			r_water[r] = bScriptPointLand
+				             ? IsPointLand(r, Mesh, HalfMeshSize, Offset, Shape)
+				             : IsPointLand_Implementation(r, Mesh, HalfMeshSize, Offset, Shape);
+		}
+	}
+}
+
+bool UIslandWater::IsPointLandImplementedInScript() const
+{
+	return UIslandMapUtils::IsImplementedInScript(this, GET_FUNCTION_NAME_CHECKED(UIslandWater, IsPointLand));
+}
+
 void UIslandWater::InitializeWater_Implementation(TArray<bool>& r_water, UTriangleDualMesh* Mesh, FRandomStream& Rng) const
 {
 	// Empty
@@ -133,10 +135,10 @@ bool UIslandWater::IsPointLand_Implementation(FPointIndex Point, UTriangleDualMe
 
 void UIslandWater::assign_r_water(TArray<bool>& r_water, FRandomStream& Rng, UTriangleDualMesh* Mesh, const FIslandShape& Shape) const
 {
-	AssignWater(r_water, Rng, Mesh, Shape);
+	ISLAND_CALL_NATIVE_OR_EVENT(UIslandWater, AssignWater, r_water, Rng, Mesh, Shape);
 }
 
 void UIslandWater::assign_r_ocean(TArray<bool>& r_ocean, UTriangleDualMesh* Mesh, const TArray<bool>& r_water) const
 {
-	AssignOcean(r_ocean, Mesh, r_water);
+	ISLAND_CALL_NATIVE_OR_EVENT(UIslandWater, AssignOcean, r_ocean, Mesh, r_water);
 }
@@ -0,0 +1,63 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "IslandMapUtils.h"
+
+class UDataTable;
+
+/**
+ * Biome rows of a data table compiled into a grid per ocean/water/coast class.
+ * The grid axes are split at every moisture and temperature bound of the table, so each cell resolves to
+ * exactly the row UIslandMapUtils::GetBiome would pick for any value inside it.
+ */
+struct POLYGONALMAPGENERATOR_API FBiomeLookupTable
+{
+	/** Diagnostics category of values several rows match, shared with UIslandMapUtils::GetBiome. */
+	static const TCHAR* const AmbiguousBiomeCategory;
+
+	void Build(const UDataTable* BiomeData);
+
+	void Reset();
+
+	bool IsEmpty() const
+	{
+		return Biomes.IsEmpty();
+	}
+
+	/**
+	 * Index into GetBiomes() of the matching row, or INDEX_NONE if GetBiome would fail. Values several rows match
+	 * are reported to the active diagnostics with Region as sample, and logged outside of a generation.
+	 */
+	int32 Resolve(bool bIsOcean, bool bIsWater, bool bIsCoast, float Temperature, float Moisture,
+	              int64 Region = INDEX_NONE) const;
+
+	const TArray<FBiomeData>& GetBiomes() const
+	{
+		return Biomes;
+	}
+
+protected:
+	static int32 ClassIndex(const bool bIsOcean, const bool bIsWater, const bool bIsCoast)
+	{
+		return (bIsOcean ? 4 : 0) | (bIsWater ? 2 : 0) | (bIsCoast ? 1 : 0);
+	}
+
+	/** The filter cascade of GetBiome over the cached rows, without the grid. */
+	int32 Evaluate(bool bIsOcean, bool bIsWater, bool bIsCoast, float Temperature, float Moisture,
+	               bool& bOutAmbiguous) const;
+
+	static void ReportAmbiguous(float Temperature, float Moisture, int64 Region);
+
+	static int32 FindBucket(const TArray<float>& Breaks, float Value);
+
+	TArray<FBiomeData> Biomes;
+	/** Sorted unique bounds of all rows. A value falls into the bucket of the first bound not below it. */
+	TArray<float> MoistureBreaks;
+	TArray<float> TemperatureBreaks;
+	/** One grid per class, temperature major. Empty if the table was too large to compile. */
+	TArray<int16> Cells;
+	/** Cells that several rows match, found while the grid is built. */
+	TBitArray<> AmbiguousCells;
+};
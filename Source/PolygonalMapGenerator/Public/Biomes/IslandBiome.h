@@ -45,6 +45,8 @@ protected:
 	virtual void AssignCoast_Implementation(TArray<bool>& r_coast, UTriangleDualMesh* Mesh, const TArray<bool>& r_ocean) const;
 	virtual void AssignTemperature_Implementation(TArray<float>& r_temperature, UTriangleDualMesh* Mesh, const TArray<bool>& r_ocean, const TArray<bool>& r_water, const TArray<float>& r_elevation, const TArray<float>& r_moisture, float NorthernTemperature, float SouthernTemperature) const;
 	virtual void AssignBiome_Implementation(TArray<FBiomeData>& r_biome, UTriangleDualMesh* Mesh, const TArray<bool>& r_ocean, const TArray<bool>& r_water, const TArray<bool>& r_coast, const TArray<float>& r_temperature, const TArray<float>& r_moisture) const;
+	// Native form of AssignBiome: one index per region into BiomePalette, whose entry 0 is the default biome.
+	virtual void AssignBiomeIndices(TArray<uint8>& r_biome, TArray<FBiomeData>& BiomePalette, UTriangleDualMesh* Mesh, TConstArrayView<ERegionFlags> r_flags, const TArray<float>& r_temperature, const TArray<float>& r_moisture) const;
 
 public:
 	UFUNCTION(BlueprintCallable, BlueprintNativeEvent, Category = "Procedural Generation|Island Generation|Biome")
@@ -57,4 +59,5 @@ public:
 	void assign_r_coast(TArray<bool>& r_coast, UTriangleDualMesh* Mesh, const TArray<bool>& r_ocean) const;
 	void assign_r_temperature(TArray<float>& r_temperature, UTriangleDualMesh* Mesh, const TArray<bool>& r_ocean, const TArray<bool>& r_water, const TArray<float>& r_elevation, const TArray<float>& r_moisture, float NorthernTemperature, float SouthernTemperature) const;
 	void assign_r_biome(TArray<FBiomeData>& r_biome, UTriangleDualMesh* Mesh, const TArray<bool>& r_ocean, const TArray<bool>& r_water, const TArray<bool>& r_coast, const TArray<float>& r_temperature, const TArray<float>& r_moisture) const;
+	void assign_r_biome(TArray<uint8>& r_biome, TArray<FBiomeData>& BiomePalette, UTriangleDualMesh* Mesh, TConstArrayView<ERegionFlags> r_flags, const TArray<float>& r_temperature, const TArray<float>& r_moisture) const;
 };
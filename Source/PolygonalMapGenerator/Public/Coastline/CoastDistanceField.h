@@ -0,0 +1,50 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FCoastlineSpatialIndex;
+
+/**
+ * Signed distance to the coastline sampled on a regular grid, negative on land.
+ * Distances are clamped to MaxDistance and stored normalized as float16.
+ */
+struct POLYGONALMAPGENERATOR_API FCoastDistanceField
+{
+	void Bake(const FCoastlineSpatialIndex& SpatialIndex, const FVector2D& MapSize, int32 Resolution,
+	          double InMaxDistance);
+
+	void Reset();
+
+	bool IsValid() const
+	{
+		return !Distances.IsEmpty();
+	}
+
+	/** True if the field was baked with a clamp distance of at least Distance. */
+	bool Covers(const double Distance) const
+	{
+		return IsValid() && MaxDistance >= Distance;
+	}
+
+	/** Bilinearly filtered signed distance at Point. */
+	double Sample(const FVector2D& Point) const;
+
+	double GetMaxDistance() const
+	{
+		return MaxDistance;
+	}
+
+	SIZE_T GetAllocatedSize() const
+	{
+		return Distances.GetAllocatedSize();
+	}
+
+protected:
+	FVector2D Origin = FVector2D::ZeroVector;
+	double TexelSize = 1.;
+	FIntPoint Size = FIntPoint::ZeroValue;
+	double MaxDistance = 0.;
+	TArray<FFloat16> Distances;
+};
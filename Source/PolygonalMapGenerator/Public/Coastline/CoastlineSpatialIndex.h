@@ -0,0 +1,70 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FCoastlinePolygon;
+
+/**
+ * Uniform grid over the coastline edges.
+ * Every cell keeps the edges overlapping it and whether its center lies on land, so inside tests and
+ * bounded distance queries only touch the edges around the query point.
+ */
+struct POLYGONALMAPGENERATOR_API FCoastlineSpatialIndex
+{
+	void Build(const TArray<FCoastlinePolygon>& Coastlines);
+
+	void Reset();
+
+	bool IsEmpty() const
+	{
+		return SegmentStarts.IsEmpty();
+	}
+
+	/** Same result as running UIslandMapUtils::PointInPolygon2D against every coastline. */
+	bool IsInside(const FVector2D& Point) const;
+
+	/** Distance to the nearest coast edge, or MaxDistance if no edge is closer than that. */
+	double DistanceToCoast(const FVector2D& Point, double MaxDistance) const;
+
+	SIZE_T GetAllocatedSize() const
+	{
+		return SegmentStarts.GetAllocatedSize() + SegmentEnds.GetAllocatedSize() + CellOffsets.GetAllocatedSize()
+			+ CellSegments.GetAllocatedSize() + CellCenterInside.GetAllocatedSize();
+	}
+
+protected:
+	FORCEINLINE int32 CellIndex(const int32 CellX, const int32 CellY) const
+	{
+		return CellY * CellCount.X + CellX;
+	}
+
+	FORCEINLINE FIntPoint CellOf(const FVector2D& Point) const
+	{
+		return FIntPoint(FMath::FloorToInt32((Point.X - Origin.X) / CellSize),
+		                 FMath::FloorToInt32((Point.Y - Origin.Y) / CellSize));
+	}
+
+	FORCEINLINE FVector2D CellCenter(const int32 CellX, const int32 CellY) const
+	{
+		return Origin + FVector2D(CellX + 0.5, CellY + 0.5) * CellSize;
+	}
+
+	/** Number of cell edges met by the horizontal ray test between (FromX, Y) and (ToX, Y). */
+	int32 CountHorizontalCrossings(int32 Cell, double Y, double FromX, double ToX) const;
+
+	/** Number of cell edges met by the vertical move between (X, FromY) and (X, ToY). */
+	int32 CountVerticalCrossings(int32 Cell, double X, double FromY, double ToY) const;
+
+	TArray<FVector2D> SegmentStarts;
+	TArray<FVector2D> SegmentEnds;
+
+	FVector2D Origin = FVector2D::ZeroVector;
+	double CellSize = 1.;
+	FIntPoint CellCount = FIntPoint::ZeroValue;
+	/** Offsets into CellSegments, one entry per cell plus a terminator. */
+	TArray<int32> CellOffsets;
+	TArray<int32> CellSegments;
+	TBitArray<> CellCenterInside;
+};
@@ -3,6 +3,7 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Coastline/CoastlineSpatialIndex.h"
 #include "DelaunayHelper.h"
 #include "PolyPartitionHelper.h"
 #include "IslandMapUtils.h"
@@ -14,6 +15,22 @@ struct POLYGONALMAPGENERATOR_API FCoastlinePolygon : public FAreaContour
 	GENERATED_BODY()
 	SIZE_T IslandId;
 	TArray<FPolyTriangle2D> Triangles;
+	// Simplifications of the contour by ascending tolerance, vertices are a subset of the full contour.
+	TArray<double> SimplifiedTolerances;
+	TArray<FAreaContour> SimplifiedContours;
+
+	// The coarsest simplification within MaxError of the coast, or the full contour.
+	const FAreaContour& GetContour(const double MaxError) const
+	{
+		for (int32 Level = SimplifiedTolerances.Num() - 1; Level >= 0; --Level)
+		{
+			if (SimplifiedTolerances[Level] <= MaxError)
+			{
+				return SimplifiedContours[Level];
+			}
+		}
+		return *this;
+	}
 };
 
 UCLASS()
@@ -22,11 +39,20 @@ class POLYGONALMAPGENERATOR_API UIslandCoastline : public UObject
 	GENERATED_BODY()
 protected:
 	TArray<FCoastlinePolygon> Coastlines;
-	TArray<TSharedPtr<FRegionEdge>> Edges;
+	FCoastlineSpatialIndex SpatialIndex;
 
 public:
-	void Initialize(const UTriangleDualMesh* Mesh, TArray<bool> OceanRegions, TArray<bool> CoastRegions);
+	// SimplificationTolerances adds one simplified contour per tolerance to every polygon.
+	void Initialize(const UTriangleDualMesh* Mesh, const TArray<ERegionFlags>& RegionFlags,
+	                TConstArrayView<float> SimplificationTolerances = TConstArrayView<float>());
+	// Writes or reads the polygons, their triangulation and simplifications.
+	void SerializeCoastlines(FArchive& Ar);
 
 	UFUNCTION(BlueprintCallable, BlueprintPure)
 	const TArray<FCoastlinePolygon>& GetCoastlines() const;
+
+	const FCoastlineSpatialIndex& GetSpatialIndex() const;
+
+	// The polygons, their triangulation and simplifications and the spatial index.
+	SIZE_T GetAllocatedSize() const;
 };
@@ -0,0 +1,154 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/WeakObjectPtrTemplates.h"
+
+class UTexture2D;
+
+struct FPixelData
+{
+	int32 DistrictID1;
+	float Proportion1;
+	int32 DistrictID2;
+	float Proportion2;
+	int32 DistrictID3;
+	float Proportion3;
+	int32 DistrictID4;
+	float Proportion4;
+};
+
+/** How a decoded pixel is stored, 8 bytes instead of the 32 of FPixelData. Proportions are quantized to 1/255. */
+struct FPackedPixelData
+{
+	uint8 DistrictIDs[4] = {0, 0, 0, 0};
+	uint8 Proportions[4] = {0, 0, 0, 0};
+
+	static uint8 PackProportion(const float Proportion)
+	{
+		return static_cast<uint8>(FMath::RoundToInt32(FMath::Clamp(Proportion, 0.f, 1.f) * 255.f));
+	}
+
+	static uint8 PackDistrictID(const int32 DistrictID)
+	{
+		return static_cast<uint8>(FMath::Clamp(DistrictID, 0, 255));
+	}
+
+	FPixelData Unpack() const
+	{
+		return {
+			DistrictIDs[0], Proportions[0] / 255.f, DistrictIDs[1], Proportions[1] / 255.f,
+			DistrictIDs[2], Proportions[2] / 255.f, DistrictIDs[3], Proportions[3] / 255.f
+		};
+	}
+};
+static_assert(sizeof(FPackedPixelData) == 8);
+
+/** Both district ID textures decoded into one array of pixels. */
+struct FIDTextueData
+{
+	int32 Width;
+	int32 Height;
+	TArray<FPackedPixelData> Data;
+};
+
+/** Prefiltered levels of one decoded ID texture, each level halves the previous one. Level 0 is the decoded data. */
+struct FIDTextueMipChain
+{
+	TArray<TSharedRef<const FIDTextueData, ESPMode::ThreadSafe>> Levels;
+
+	/** The coarsest level that still has at least one texel per sample. */
+	const FIDTextueData& FindLevel(const double TexelsPerSample) const
+	{
+		const int32 Level = TexelsPerSample > 1.0 ? FMath::FloorToInt32(FMath::Log2(TexelsPerSample)) : 0;
+		return Levels[FMath::Clamp(Level, 0, Levels.Num() - 1)].Get();
+	}
+};
+
+/** Weighted sum of the districts of several pixels, resolved to the four largest like a single pixel. */
+class POLYGONALMAPGENERATOR_API FDistrictProportionBlend
+{
+public:
+	void Add(const FPackedPixelData& Pixel, float Weight);
+	FPixelData Resolve() const;
+	FPackedPixelData ResolvePacked() const;
+
+private:
+	TArray<TPair<int32, float>, TInlineAllocator<16>> Districts;
+	float TotalWeight = 0.f;
+};
+
+namespace DistrictIDTexture
+{
+	/** Decodes the two FloatRGBA district ID images, as written by ResolveRows, into one pixel array. */
+	POLYGONALMAPGENERATOR_API TSharedRef<FIDTextueData, ESPMode::ThreadSafe> Decode(
+		const FFloat16* FloatIDImage1, const FFloat16* FloatIDImage2, int32 Width, int32 Height);
+
+	/** Decodes the two R8G8B8A8 district ID images, as written by EncodeUnorm8, into one pixel array. */
+	POLYGONALMAPGENERATOR_API TSharedRef<FIDTextueData, ESPMode::ThreadSafe> DecodeUnorm8(
+		const uint8* IDImage1, const uint8* IDImage2, int32 Width, int32 Height);
+
+	/**
+	 * Writes decoded pixels as two images in the channel layout of ResolveRows, so materials read them the same way.
+	 * Unorm8 quantizes every channel to 1/255, which keeps the district IDs and the 1/255 of the decoded proportions.
+	 * Both outputs must be preallocated to Width * Height * 4 elements.
+	 * Returns false if a district above MaxUnorm8Districts had to be clamped.
+	 */
+	POLYGONALMAPGENERATOR_API bool EncodeUnorm8(const FIDTextueData& Data, uint8* IDImage1, uint8* IDImage2);
+	POLYGONALMAPGENERATOR_API void EncodeFloat16(const FIDTextueData& Data, FFloat16* FloatIDImage1,
+	                                             FFloat16* FloatIDImage2);
+
+	/** The districts with some proportion in any pixel, ascending. */
+	POLYGONALMAPGENERATOR_API TArray<int32> FindDistricts(const FIDTextueData& Data);
+
+	/** Box filters the decoded data down to one texel, keeping the four largest districts of every texel. */
+	POLYGONALMAPGENERATOR_API TSharedRef<const FIDTextueMipChain, ESPMode::ThreadSafe> BuildMipChain(
+		const TSharedRef<const FIDTextueData, ESPMode::ThreadSafe>& Data);
+}
+
+/**
+ * Decoded district ID data shared by everything that samples the same pair of textures.
+ * Entries are keyed on both textures and their revision, and drop out once a texture is gone.
+ * Safe to use from any thread, the shared data must not be changed once added.
+ */
+class POLYGONALMAPGENERATOR_API FDistrictIDDataCache
+{
+public:
+	static FDistrictIDDataCache& Get();
+
+	TSharedPtr<const FIDTextueData, ESPMode::ThreadSafe> Find(const UTexture2D* Texture1,
+	                                                          const UTexture2D* Texture2);
+
+	void Add(const UTexture2D* Texture1, const UTexture2D* Texture2,
+	         const TSharedRef<const FIDTextueData, ESPMode::ThreadSafe>& Data,
+	         const TSharedPtr<const FIDTextueMipChain, ESPMode::ThreadSafe>& MipChain = nullptr);
+
+	/** Finds the decoded data or locks both textures once to decode and add it. FloatRGBA and R8G8B8A8 decode. */
+	TSharedRef<const FIDTextueData, ESPMode::ThreadSafe> FindOrDecode(const UTexture2D* Texture1,
+	                                                                  const UTexture2D* Texture2);
+
+	/** Same as FindOrDecode, the levels are built on first use and kept with the decoded data. */
+	TSharedRef<const FIDTextueMipChain, ESPMode::ThreadSafe> FindOrBuildMipChain(const UTexture2D* Texture1,
+	                                                                             const UTexture2D* Texture2);
+
+	/** Crc of the decoded pixels, equal for textures with the same content. Computed once per revision. */
+	uint32 FindOrComputeContentCrc(const UTexture2D* Texture1, const UTexture2D* Texture2);
+
+private:
+	struct FEntry
+	{
+		TWeakObjectPtr<const UTexture2D> Texture1;
+		TWeakObjectPtr<const UTexture2D> Texture2;
+		uint32 Revision = 0;
+		TSharedRef<const FIDTextueData, ESPMode::ThreadSafe> Data;
+		TSharedPtr<const FIDTextueMipChain, ESPMode::ThreadSafe> MipChain;
+		TOptional<uint32> ContentCrc;
+	};
+
+	/** Changes whenever the texture is edited or its platform data is rebuilt. */
+	static uint32 GetRevision(const UTexture2D* Texture);
+
+	FCriticalSection Lock;
+	TArray<FEntry> Entries;
+};
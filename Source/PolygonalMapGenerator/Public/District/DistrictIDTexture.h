@@ -0,0 +1,53 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "District/IslandDistrict.h"
+
+/** One (district, coverage) pair of a rasterized pixel. District is 1-based, 0 marks an empty slot. */
+struct FDistrictCoverage
+{
+	uint8 District = 0;
+	uint16 Coverage = 0;
+};
+
+/** A district polygon already scaled into texture space. */
+struct FDistrictRasterPolygon
+{
+	uint8 District = 0;
+	TArray<FVector2f> Points;
+	FBox2f Bounds = FBox2f(ForceInit);
+};
+
+namespace DistrictIDTexture
+{
+	// Every pixel only keeps its TopDistricts largest districts, so the district count does not change its size
+	constexpr int32 MaxDistricts = 255;
+	constexpr int32 TopDistricts = 4;
+	// IDs are encoded as ID / 16 - 0.01, which only stays within the range of a unorm channel up to here
+	constexpr int32 MaxUnorm8Districts = 16;
+	constexpr uint16 FullCoverage = TNumericLimits<uint16>::Max();
+
+	/** Scales the district outlines into texture space. Districts outside [0, MaxDistricts) are dropped. */
+	POLYGONALMAPGENERATOR_API void PreparePolygons(TArray<FDistrictRasterPolygon>& OutPolygons,
+	                                               const TArray<FDistrictRegion>& DistrictRegions,
+	                                               const FVector2D& Scale);
+
+	/**
+	 * Computes exact area coverage of every polygon for rows [RowBegin, RowEnd) and keeps the TopDistricts
+	 * largest districts of each pixel, largest first. OutCoverage holds TopDistricts entries per pixel. The coverage
+	 * of any further district is spread over the kept ones, so a pixel still sums to its total coverage.
+	 */
+	POLYGONALMAPGENERATOR_API void RasterizeRows(TArray<FDistrictCoverage>& OutCoverage,
+	                                             const TArray<FDistrictRasterPolygon>& Polygons, int32 Width,
+	                                             int32 RowBegin, int32 RowEnd);
+
+	/**
+	 * Rasterizes rows [RowBegin, RowEnd) and writes them into the two FloatRGBA district ID images.
+	 * Both outputs must be preallocated to Width * Height * 4 elements.
+	 */
+	POLYGONALMAPGENERATOR_API void ResolveRows(const TArray<FDistrictRasterPolygon>& Polygons, int32 Width,
+	                                           int32 RowBegin, int32 RowEnd, FFloat16* FloatIDImageBuffer1,
+	                                           FFloat16* FloatIDImageBuffer2);
+}
@@ -16,16 +16,40 @@ struct POLYGONALMAPGENERATOR_API FDistrictRegion : public FAreaContour
 	TArray<FPolyTriangle2D> Triangles;
 };
 
+UENUM(BlueprintType)
+enum class EDistrictFillMode : uint8
+{
+	// Districts grow one ring of neighbours at a time from their starts
+	DFM_BreadthFirst UMETA(DisplayName="Breadth First"),
+	// Every region joins the closest start, pieces cut off from their start are regrown breadth first
+	DFM_NearestStart UMETA(DisplayName="Nearest Start"),
+};
+
 UCLASS(Blueprintable)
 class POLYGONALMAPGENERATOR_API UIslandDistrict : public UDataAsset
 {
 	GENERATED_BODY()
 
 public:
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Fill")
+	EDistrictFillMode FillMode = EDistrictFillMode::DFM_BreadthFirst;
+
 	virtual void AssignDistrict(TArray<FDistrictRegion>& DistrictRegions, UTriangleDualMesh* Mesh,
 	                            const TArray<bool>& OceanRegions, FRandomStream& Rng) const;
 
+	// Calls AssignDistrict and also keeps the district of every region, -1 for the regions outside of all districts.
+	// An override of AssignDistrict that does not call its parent gets the regions inside its district triangles.
+	virtual void AssignRegionDistricts(TArray<FDistrictRegion>& DistrictRegions, TArray<int32>& RegionDistricts,
+	                                   UTriangleDualMesh* Mesh, const TArray<bool>& OceanRegions,
+	                                   FRandomStream& Rng) const;
+
 protected:
+	// What the base AssignDistrict does, the district of every region included
+	void BuildDistricts(TArray<FDistrictRegion>& DistrictRegions, TArray<int32>& RegionDistricts,
+	                    UTriangleDualMesh* Mesh, const TArray<bool>& OceanRegions, FRandomStream& Rng) const;
+	static void LocateRegionDistricts(TArray<int32>& RegionDistricts, const TArray<FDistrictRegion>& DistrictRegions,
+	                                  const UTriangleDualMesh* Mesh, const TArray<bool>& OceanRegions);
+
 	virtual void ScatterDistrictStarts(TArray<FPointIndex>& DistrictStarts, UTriangleDualMesh* Mesh,
 	                                   const TArray<bool>& OceanRegions, FRandomStream& Rng) const;
 
@@ -8,11 +8,15 @@
 #include "GeometryScript/MeshVoxelFunctions.h"
 #include "IslandDynamicMeshActor.generated.h"
 
+struct FCoastlinePolygon;
+
 UENUM(BlueprintType)
 enum class EGenerateMeshType : uint8
 {
 	GMT_Delaunator UMETA(DisplayName="Delaunator"),
 	GMT_Voxelization UMETA(DisplayName="Voxelization"),
+	/** Samples the coast distance onto a grid and meshes the land and the border straight from it. */
+	GMT_Heightfield UMETA(DisplayName="Heightfield"),
 };
 
 UENUM(BlueprintType)
@@ -22,6 +26,14 @@ enum class EDelaunatorBorderProcess : uint8
 	DBP_StepTwoWay UMETA(DisplayName="Step Two-way"),
 };
 
+UENUM(BlueprintType)
+enum class EVoxelizationRegion : uint8
+{
+	VR_WholeMap UMETA(DisplayName="Whole Map"),
+	/** One voxel grid per group of islands whose border bands overlap. */
+	VR_IslandBands UMETA(DisplayName="Island Bands"),
+};
+
 UCLASS(BlueprintType, Blueprintable)
 class POLYGONALMAPGENERATOR_API AIslandDynamicMeshActor : public AIslandDynamicMeshActorBase
 {
@@ -36,12 +48,17 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Generate Mesh")
 	EGenerateMeshType GenerateMeshMethod = EGenerateMeshType::GMT_Delaunator;
 
+	/** Size of one heightfield cell in map units. */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Generate Mesh",
-		meta = (ClampMin = 1, EditCondition = "GenerateMeshMethod == EGenerateMeshType::GMT_PixelMesh"))
+		meta = (ClampMin = 1, EditCondition = "GenerateMeshMethod == EGenerateMeshType::GMT_Heightfield"))
 	int32 MeshPixelWidth = 10;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Generate Mesh",
-		meta = (ClampMin = 1, EditCondition = "GenerateMeshMethod == EGenerateMeshType::GMT_PixelMesh"))
+		meta = (ClampMin = 1, EditCondition = "GenerateMeshMethod == EGenerateMeshType::GMT_Heightfield"))
 	int32 MeshPixelHeight = 10;
+	/** Height of the land at elevation 1. Zero keeps the land flat like the other methods. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Generate Mesh",
+		meta = (EditCondition = "GenerateMeshMethod == EGenerateMeshType::GMT_Heightfield"))
+	float HeightfieldElevationScale = 0;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Generate Mesh|Border")
 	float BorderOffset = 500;
@@ -52,7 +69,7 @@ public:
 		EditAnywhere, BlueprintReadWrite, Category = "Generate Mesh|Border",
 		meta = (
 			ClampMin = 1, EditCondition =
-			"GenerateMeshMethod == EGenerateMeshType::GMT_Delaunator || GenerateMeshMethod == EGenerateMeshType::GMT_PixelMesh"
+			"GenerateMeshMethod == EGenerateMeshType::GMT_Delaunator || GenerateMeshMethod == EGenerateMeshType::GMT_Heightfield"
 		)
 	)
 	ERemapType BorderDepthRemapMethod = ERemapType::RT_EaseOutSine;
@@ -85,9 +102,19 @@ public:
 	)
 	int32 BorderTessellationStartStep = 4;
 
+	/**
+	 * The border offsets and voxelized islands start from the coarsest coastline simplification within this distance
+	 * of the coast, see UIslandMapData::CoastlineSimplificationTolerances. Zero keeps the exact coast.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Generate Mesh|Border", meta = (ClampMin = 0))
+	float CoastSimplificationTolerance = 0;
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Generate Mesh",
 		meta = ( EditCondition = "GenerateMeshMethod == EGenerateMeshType::GMT_Voxelization" ))
 	FGeometryScriptSolidifyOptions SolidifyOptions;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Generate Mesh",
+		meta = ( EditCondition = "GenerateMeshMethod == EGenerateMeshType::GMT_Voxelization" ))
+	EVoxelizationRegion VoxelizationRegion = EVoxelizationRegion::VR_WholeMap;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Generate Mesh",
 		meta = (
@@ -96,6 +123,20 @@ public:
 		)
 	)
 	int32 TessellationLevel = 1;
+	/**
+	 * Only tessellate the border and the land within AdaptiveTessellationBand of the coast. The rest of the land is
+	 * flat, subdividing it only adds vertices.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Generate Mesh",
+		meta = ( EditCondition = "GenerateMeshMethod == EGenerateMeshType::GMT_Delaunator" ))
+	bool bAdaptiveTessellation = false;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Generate Mesh",
+		meta = (
+			ClampMin = 0,
+			EditCondition = "GenerateMeshMethod == EGenerateMeshType::GMT_Delaunator && bAdaptiveTessellation"
+		)
+	)
+	float AdaptiveTessellationBand = 100;
 
 	UPROPERTY(BlueprintReadOnly)
 	UTexture2D* DistrictIDTexture01;
@@ -107,6 +148,16 @@ protected:
 	virtual void GenerateIslandMesh(UDynamicMesh* DynamicMesh, const FTransform& Transform) override;
 	virtual void GenerateMeshDelaunator(UDynamicMesh* DynamicMesh, const FTransform& Transform);
 	virtual void GenerateMeshVoxelization(UDynamicMesh* DynamicMesh, const FTransform& Transform);
+	/**
+	 * Meshes the grid cells within BorderOffset of the coast. Cells crossed by the outer edge of the border are cut
+	 * along it by marching squares, the border drops to BorderDepth like GMT_Delaunator.
+	 */
+	virtual void GenerateMeshHeightfield(UDynamicMesh* DynamicMesh, const FTransform& Transform);
+	void AppendVoxelizationIsland(UDynamicMesh* DynamicMesh, const FCoastlinePolygon& Coastline,
+	                              const FTransform& Transform) const;
+	/** Solidify, smooth, tessellate and cut away everything below the border depth. */
+	void SolidifyVoxelization(UDynamicMesh* DynamicMesh, const FGeometryScriptSolidifyOptions& Options,
+	                          const FVector2D& BaseCenter, const FVector2D& BaseSize) const;
 
 	virtual void SetMaterialParameters(UMaterialInstanceDynamic* MaterialInstance) override;
 
@@ -6,8 +6,13 @@
 #include "DynamicMeshActor.h"
 #include "GeometryScript/CollisionFunctions.h"
 #include "IslandMapData.h"
+#include "Containers/Ticker.h"
 #include "IslandDynamicMeshActorBase.generated.h"
 
+class UStaticMesh;
+class UStaticMeshComponent;
+struct FMeshDescription;
+
 UCLASS(BlueprintType, Blueprintable)
 class POLYGONALMAPGENERATOR_API AIslandDynamicMeshActorBase : public ADynamicMeshActor
 {
@@ -21,11 +26,46 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Material")
 	UMaterial* IslandMaterial;
 
+	/** Headless generations build the mesh and its collision only: no textures, material, UVs, normals or LODs. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Generate Mesh")
+	EIslandGenerationProfile GenerationProfile = EIslandGenerationProfile::IGP_Auto;
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Generate Mesh")
 	bool bGenerateCollision = true;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Generate Mesh", meta = ( EditCondition = "bGenerateCollision" ))
 	FGeometryScriptCollisionFromMeshOptions GenerateCollisionOptions;
 
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LOD")
+	bool bGenerateLODs = false;
+	/** Triangle count of every LOD relative to the full mesh, the coastline and open borders are never collapsed. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LOD",
+		meta = ( EditCondition = "bGenerateLODs", ClampMin = 0, ClampMax = 1 ))
+	TArray<float> LODTriangleRatios = {0.5f, 0.25f, 0.125f};
+	/** Vertices closer to the coastline than this, in map units, are locked during simplification. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LOD",
+		meta = ( EditCondition = "bGenerateLODs", ClampMin = 0 ))
+	float LODCoastlineTolerance = 0.01f;
+
+	/** Simplified copies of the island mesh, LOD 1 first. */
+	UPROPERTY(Transient, BlueprintReadOnly, Category = "LOD")
+	TArray<TObjectPtr<UDynamicMesh>> LODMeshes;
+
+	/**
+	 * Runs ConvertToStaticMesh after every generation that is not headless. Nanite data can only be built in the
+	 * editor, at runtime the static mesh is built without it.
+	 * Once the static mesh is shown the dynamic mesh is released unless it is the complex collision, so until the
+	 * next GenerateIsland CopyToStaticMesh and another ConvertToStaticMesh find no mesh.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Static Mesh")
+	bool bConvertToStaticMesh = false;
+
+	/** The transient static mesh the island was converted into, null until a conversion finished. */
+	UPROPERTY(Transient, BlueprintReadOnly, Category = "Static Mesh")
+	TObjectPtr<UStaticMesh> IslandStaticMesh;
+
+	UPROPERTY(Transient, BlueprintReadOnly, Category = "Static Mesh")
+	TObjectPtr<UStaticMeshComponent> StaticMeshComponent;
+
 	UFUNCTION(BlueprintCallable)
 	UIslandMapData* SetMapData(UIslandMapData* InMapData);
 
@@ -38,10 +78,46 @@ public:
 	UFUNCTION(BlueprintCallable, BlueprintNativeEvent, Category = "Generate Mesh")
 	void PostGenerateIsland(bool bSucceed);
 
+	/**
+	 * Converts the island mesh into a Nanite enabled static mesh in the background and shows it instead. The dynamic
+	 * mesh and its LODMeshes are released once it is built, unless the component uses the mesh as complex collision.
+	 * False if there is no mesh to convert, PostConvertToStaticMesh follows otherwise.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Static Mesh")
+	bool ConvertToStaticMesh();
+
+	UFUNCTION(BlueprintCallable, BlueprintNativeEvent, Category = "Static Mesh")
+	void PostConvertToStaticMesh(bool bSucceed);
+
+	/**
+	 * Writes the island mesh and its LODMeshes into the source models of a static mesh asset, e.g. for HLOD.
+	 * Source models only exist in the editor, elsewhere this logs an error and returns false.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "LOD", meta = ( DevelopmentOnly ))
+	bool CopyToStaticMesh(UStaticMesh* StaticMesh);
+
 protected:
+	// Resolved from GenerationProfile at the start of every GenerateIsland
+	bool bHeadless = false;
+
 	virtual void GenerateIslandTexture();
 	virtual void GenerateIslandMesh(UDynamicMesh* DynamicMesh, const FTransform& Transform);
 	virtual void SetMaterialParameters(UMaterialInstanceDynamic* MaterialInstance);
+	virtual void GenerateLODs(const UDynamicMesh* SourceMesh, const FTransform& Transform);
 
 	virtual void PostGenerateIsland_Implementation(bool bSucceed);
+	virtual void PostConvertToStaticMesh_Implementation(bool bSucceed);
+
+	virtual void BeginDestroy() override;
+
+	// Bumped by every generation and conversion, results of older conversions are dropped
+	int32 ConversionSerial = 0;
+	UPROPERTY(Transient)
+	TObjectPtr<UStaticMesh> PendingStaticMesh;
+	FTSTicker::FDelegateHandle ConversionTickerHandle;
+	void BuildStaticMesh(FMeshDescription&& MeshDescription);
+	bool TickStaticMeshBuild(float DeltaTime);
+	void ShowStaticMesh();
+	// Shows the dynamic mesh again and drops any conversion in flight
+	void ResetStaticMesh();
 };
@@ -5,10 +5,60 @@
 #include "IslandDynamicAssets.h"
 #include "GameFramework/Actor.h"
 #include "GeometryScript/CollisionFunctions.h"
+#include "PerPlatformProperties.h"
 #include "IslandDynamicTileMeshActor.generated.h"
 
 DECLARE_LOG_CATEGORY_EXTERN(LogIslandDynamicActor, Log, All);
 
+UENUM(BlueprintType)
+enum class ETileSpawnPhase : uint8
+{
+	TSP_Spawn UMETA(DisplayName="Spawn"),
+	TSP_Mesh UMETA(DisplayName="Mesh"),
+	TSP_Collision UMETA(DisplayName="Collision"),
+	TSP_Material UMETA(DisplayName="Material"),
+};
+
+UENUM(BlueprintType)
+enum class ETileSpawnMode : uint8
+{
+	TSM_Actors UMETA(DisplayName="Actors"),
+	/** One dynamic mesh component per tile on this actor. */
+	TSM_Components UMETA(DisplayName="Components"),
+	/** Square batches of tiles appended into one dynamic mesh component each, tiles are never unloaded. */
+	TSM_MergedBatches UMETA(DisplayName="Merged Batches"),
+};
+
+UENUM(BlueprintType)
+enum class ETileCollisionMode : uint8
+{
+	/** GenerateCollisionOptions shapes, built on the game thread while the tile spawns. */
+	TCM_SimpleShapes UMETA(DisplayName="Simple Shapes"),
+	/** The tile mesh itself as complex-as-simple collision, cooked by the physics async cooker. */
+	TCM_AsyncComplex UMETA(DisplayName="Async Complex"),
+};
+
+/** Game thread time spent on tile spawning, summed per phase since the last AsyncGenerateDynamicMesh. */
+USTRUCT(BlueprintType)
+struct FTileSpawnStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category="Stats")
+	double SpawnSeconds = 0.;
+	UPROPERTY(BlueprintReadOnly, Category="Stats")
+	double MeshSeconds = 0.;
+	UPROPERTY(BlueprintReadOnly, Category="Stats")
+	double CollisionSeconds = 0.;
+	UPROPERTY(BlueprintReadOnly, Category="Stats")
+	double MaterialSeconds = 0.;
+	/** Longest single tick spent spawning tiles. */
+	UPROPERTY(BlueprintReadOnly, Category="Stats")
+	double MaxTickSeconds = 0.;
+	UPROPERTY(BlueprintReadOnly, Category="Stats")
+	int32 TickCount = 0;
+};
+
 UCLASS(Blueprintable, BlueprintType)
 class POLYGONALMAPGENERATOR_API AIslandDynamicTileMeshActor : public AActor
 {
@@ -21,16 +71,30 @@ protected:
 	UPROPERTY(BlueprintReadWrite, Category="Assets")
 	TObjectPtr<UIslandDynamicAssets> Assets;
 
+	/** Only filled with ETileSpawnMode::TSM_Actors. */
 	UPROPERTY(BlueprintReadWrite, Category="Tiles")
 	TArray<TObjectPtr<ADynamicMeshActor>> TileActors;
 
+	/** The component holding each spawned tile, tiles of one merged batch share it. */
+	UPROPERTY(BlueprintReadOnly, Category="Tiles")
+	TArray<TObjectPtr<UDynamicMeshComponent>> TileComponents;
+
 public:
+	/** Game thread budget in seconds for tile spawning per tick, checked after every phase of a tile. */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Transform")
 	float MaxSpawnTileTickTime = 0.03f;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Transform")
 	FVector2D Pivot = FVector2D(.5f, .5f);
 
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Tiles")
+	ETileSpawnMode SpawnMode = ETileSpawnMode::TSM_Actors;
+
+	/** Tiles along each side of a merged batch, lower values mean more draw calls but cheaper appends. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Tiles",
+		meta = ( EditCondition = "SpawnMode == ETileSpawnMode::TSM_MergedBatches", ClampMin = 1 ))
+	FPerPlatformInt TilesPerBatchSide = 4;
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Material")
 	TObjectPtr<UMaterial> IslandMaterial;
 
@@ -40,25 +104,120 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Material")
 	FName DistrictIDTexture02ParamName = FName(TEXT("District ID 02"));
 
+	/**
+	 * All tiles share one material instance. If this is not INDEX_NONE, every tile writes its row and column into
+	 * the custom primitive data at this index and the next one, for tile specific material logic.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Material", meta = ( ClampMin = -1 ))
+	int32 TileCustomPrimitiveDataIndex = INDEX_NONE;
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Generate Mesh")
 	bool bGenerateCollision = true;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Generate Mesh",
 		meta = ( EditCondition = "bGenerateCollision" ))
+	ETileCollisionMode CollisionMode = ETileCollisionMode::TCM_SimpleShapes;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Generate Mesh",
+		meta = ( EditCondition = "bGenerateCollision && CollisionMode == ETileCollisionMode::TCM_SimpleShapes" ))
 	FGeometryScriptCollisionFromMeshOptions GenerateCollisionOptions;
 
+	/**
+	 * Keeps the vertex, triangle and UV buffers of every tile after its mesh is in place. Without it they are freed,
+	 * except while streaming unloads tiles, which are rebuilt from them.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Generate Mesh")
+	bool bKeepTileBuffers = false;
+
+	/** Whether the collision of a tile is in place, tiles without collision never become ready. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Generate Mesh")
+	bool IsTileCollisionReady(int32 TileIndex) const;
+
 	void AsyncGenerateDynamicMesh(UIslandDynamicAssets* InAssets);
 
+	/**
+	 * Streaming spawns built tiles closest to a viewer first and only within StreamingRadius. Without registered
+	 * viewers or points the view points of all local player controllers are used. Without any of them, e.g. on a
+	 * server with no players yet, every tile is spawned and kept loaded.
+	 * PostGenerateIsland fires once every tile is built and the ones within StreamingRadius are spawned.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Streaming")
+	bool bStreamTiles = false;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Streaming",
+		meta = ( EditCondition = "bStreamTiles", ClampMin = 0 ))
+	float StreamingRadius = 20000.f;
+	/** Spawned tiles further than this from every viewer are destroyed again. Keep it above StreamingRadius. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Streaming",
+		meta = ( EditCondition = "bStreamTiles", ClampMin = 0 ))
+	float UnloadRadius = 25000.f;
+
+	UFUNCTION(BlueprintCallable, Category = "Streaming")
+	void AddStreamingViewer(AActor* Viewer);
+	UFUNCTION(BlueprintCallable, Category = "Streaming")
+	void RemoveStreamingViewer(AActor* Viewer);
+	/** Fixed world locations that keep tiles loaded, e.g. server side relevancy points. */
+	UFUNCTION(BlueprintCallable, Category = "Streaming")
+	void SetStreamingPoints(const TArray<FVector>& Points);
+
 protected:
+	TArray<TWeakObjectPtr<AActor>> StreamingViewers;
+	TArray<FVector> StreamingPoints;
+	/** Tiles whose buffers are ready to spawn. */
+	TBitArray<> TileBuilt;
+	void GatherStreamingLocations(TArray<FVector>& OutLocations) const;
+	double GetTileViewerDistance(int32 TileIndex, const TArray<FVector>& Locations) const;
+	/** Closest built and not spawned tile within StreamingRadius, or INDEX_NONE. */
+	int32 FindNextStreamingTile(const TArray<FVector>& Locations) const;
+	void UnloadDistantTiles(const TArray<FVector>& Locations);
+
+	UPROPERTY(Transient)
+	TObjectPtr<UMaterialInstanceDynamic> SharedMaterialInstance;
+	FGraphEventRef CreateMaterialTask;
+	void ApplyTileMaterial(UDynamicMeshComponent* Component, int32 TileIndex);
+
+	/** Merged batch components and the number of their tiles still to be appended. */
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UDynamicMeshComponent>> BatchComponents;
+	TArray<int32> BatchPendingTiles;
+	int32 GetTileBatch(int32 TileIndex) const;
+	FVector GetTileLocation(int32 TileIndex) const;
+	void SpawnTile(int32 TileIndex);
+	/** Whether a tile can be spawned again after its mesh is in place, which needs its buffers. */
+	bool CanRespawnTiles() const;
+	void DestroyTile(int32 TileIndex);
+
 	int32 CompletedTilesCount = 0;
+	/** A streamed tile can be spawned several times, it only counts towards completion once. */
+	TBitArray<> TileCompleted;
+	/** PostGenerateIsland fires once per generation, streaming may complete the island before all tiles did. */
+	bool bIslandCompleted = false;
 	virtual void CheckIfAllTilesAreCompleted();
+	void CheckIfStreamedTilesAreCompleted(const TArray<FVector>& Locations);
 
 	int32 SpawnedTileActorsCount = 0;
-	TQueue<int32> TileToSpawnQueue;
+	TQueue<int32, EQueueMode::Mpsc> TileToSpawnQueue;
+	int32 SpawningTile = INDEX_NONE;
+	ETileSpawnPhase SpawningPhase = ETileSpawnPhase::TSP_Spawn;
+	/** Runs the current phase of SpawningTile and moves on to the next one. */
+	void RunTileSpawnPhase();
+
+	UPROPERTY(BlueprintReadOnly, Category="Stats")
+	FTileSpawnStats SpawnStats;
+
+	TBitArray<> TileCollisionReady;
+	/** Tiles whose collision is cooking asynchronously, polled every tick. */
+	TArray<int32> CookingCollisionTiles;
+	void UpdateCookingCollisionTiles();
 
 public:
 	virtual void Tick(float DeltaSeconds) override;
 
+	UFUNCTION(BlueprintCallable, Category="Stats")
+	const FTileSpawnStats& GetSpawnStats() const
+	{
+		return SpawnStats;
+	}
+
 protected:
 	UFUNCTION(BlueprintCallable, BlueprintNativeEvent, Category = "Generate Mesh")
 	void PostGenerateIsland(bool bSucceed);
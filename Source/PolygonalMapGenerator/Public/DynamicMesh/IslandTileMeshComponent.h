@@ -0,0 +1,33 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/DynamicMeshComponent.h"
+#include "DynamicMeshActor.h"
+#include "IslandTileMeshComponent.generated.h"
+
+/**
+ * Tile component whose complex collision leaves out the triangles of NoCollisionMaterialID, so the async cooked
+ * collision of ETileCollisionMode::TCM_AsyncComplex skips the river ribbons like the simple shapes do.
+ */
+UCLASS(ClassGroup = Rendering)
+class POLYGONALMAPGENERATOR_API UIslandTileMeshComponent : public UDynamicMeshComponent
+{
+	GENERATED_BODY()
+
+public:
+	/** Triangles with this material ID get no collision, INDEX_NONE keeps all of them. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Collision")
+	int32 NoCollisionMaterialID = INDEX_NONE;
+
+	virtual bool GetPhysicsTriMeshData(struct FTriMeshCollisionData* CollisionData, bool InUseAllTriData) override;
+};
+
+/** ADynamicMeshActor with a UIslandTileMeshComponent, spawned for ETileSpawnMode::TSM_Actors. */
+UCLASS()
+class POLYGONALMAPGENERATOR_API AIslandTileMeshActor : public ADynamicMeshActor
+{
+	GENERATED_BODY()
+
+public:
+	AIslandTileMeshActor(const FObjectInitializer& ObjectInitializer);
+};
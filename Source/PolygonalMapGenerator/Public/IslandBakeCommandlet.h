@@ -0,0 +1,20 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "IslandBakeCommandlet.generated.h"
+
+/**
+ * Bakes island assets before the cook, so the build ships them up to date.
+ * -run=IslandBake -Assets=/Game/Islands/Island01+/Game/Islands/Island02
+ */
+UCLASS()
+class POLYGONALMAPGENERATOR_API UIslandBakeCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,76 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Serialization/BulkData.h"
+#include "UObject/Object.h"
+#include "IslandBakedData.generated.h"
+
+class UIslandMapData;
+class UTexture2D;
+
+/**
+ * A generated island stored as an asset, for fixed seed islands that ship instead of generating at runtime.
+ * The layers, mesh, rivers, districts and coastlines are one bulk data payload in the island cache format, loaded
+ * through the regular asset streaming. The district ID textures are regular texture assets inside this one.
+ *
+ * Bake in the editor with Bake, or for many assets with the IslandBake commandlet. At runtime, reference the asset from
+ * UIslandMapData::BakedIsland: GenerateIsland then loads it whenever the seeds and settings match the bake.
+ */
+UCLASS(BlueprintType)
+class POLYGONALMAPGENERATOR_API UIslandBakedData : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	/** The seeds and settings to bake with, the map data assets that load the bake must match them. */
+	UPROPERTY(EditAnywhere, Instanced, Category = "Bake")
+	TObjectPtr<UIslandMapData> MapData;
+	/** 0 skips the district ID textures. */
+	UPROPERTY(EditAnywhere, Category = "Bake", meta = (ClampMin = "0"))
+	int32 DistrictIDTextureWidth = 4096;
+	UPROPERTY(EditAnywhere, Category = "Bake", meta = (ClampMin = "0"))
+	int32 DistrictIDTextureHeight = 4096;
+
+	/** The cache key of the baked generation, see UIslandMapData::GetCacheKey. */
+	UPROPERTY(VisibleAnywhere, Category = "Baked")
+	uint64 CacheKey = 0;
+	UPROPERTY(VisibleAnywhere, Category = "Baked")
+	int32 CacheVersion = 0;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Baked")
+	int32 NumRegions = 0;
+	/**
+	 * Always Float16 without mips and never streamed. The DistrictIDTextureFormat and bDistrictIDTextureMips of
+	 * UIslandDynamicAssets do not apply to them, it only regenerates the textures with bShareDistrictIDData.
+	 */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Baked")
+	TObjectPtr<UTexture2D> DistrictIDTexture01;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Baked")
+	TObjectPtr<UTexture2D> DistrictIDTexture02;
+
+	/** The island in the format of UIslandMapData::SerializeIsland, behind the cache header. */
+	FByteBulkData IslandData;
+
+	bool HasIsland() const
+	{
+		return CacheKey != 0 && IslandData.GetBulkDataSize() > 0;
+	}
+
+	bool HasDistrictIDTextures() const
+	{
+		return DistrictIDTexture01 != nullptr && DistrictIDTexture02 != nullptr;
+	}
+
+	virtual void Serialize(FArchive& Ar) override;
+	virtual void GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize) override;
+
+#if WITH_EDITOR
+	/** Generates MapData and stores the island and its district ID textures, marks the package dirty. */
+	UFUNCTION(CallInEditor, Category = "Bake")
+	void Bake();
+
+	/** Stores the last generation of InMapData, false if it has none. */
+	bool BakeFrom(UIslandMapData* InMapData);
+#endif
+};
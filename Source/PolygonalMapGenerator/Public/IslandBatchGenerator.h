@@ -0,0 +1,124 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "IslandMapData.h"
+#include <atomic>
+#include "IslandBatchGenerator.generated.h"
+
+USTRUCT(BlueprintType)
+struct POLYGONALMAPGENERATOR_API FIslandBatchCandidate
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "RNG", meta = (NoSpinbox))
+	int32 Seed = 0;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "RNG", meta = (NoSpinbox))
+	int32 DrainageSeed = 1;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "RNG", meta = (NoSpinbox))
+	int32 RiverSeed = 2;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "RNG", meta = (NoSpinbox))
+	int32 DistrictSeed = 0;
+};
+
+USTRUCT(BlueprintType)
+struct POLYGONALMAPGENERATOR_API FIslandBatchSummary
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Summary")
+	int32 Candidate = INDEX_NONE;
+	// False if the candidate failed to generate or the batch was cancelled before it
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Summary")
+	bool bGenerated = false;
+	// Land regions over all solid regions
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Summary")
+	float LandRatio = 0.f;
+	// Summed perimeter of every coastline polygon
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Summary")
+	double CoastlineLength = 0.;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Summary")
+	int32 CoastlineNum = 0;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Summary")
+	int32 LakeNum = 0;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Summary")
+	int32 RiverSegmentNum = 0;
+	// Number of contours of each district, indexed by district
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Summary")
+	TArray<int32> DistrictRegionNums;
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnIslandBatchGenerated, const TArray<FIslandBatchSummary>&, Summaries);
+
+/**
+ * Generates many candidates of one island setup on the task graph and only keeps a summary of each.
+ * Every worker owns a scratch copy of the template, created on the game thread, whose mesh, coastline and layer
+ * allocations are rebuilt in place for each of its candidates. Full map data is only created on request for the
+ * candidates that are kept, see CreateCandidateMapData.
+ */
+UCLASS(BlueprintType)
+class POLYGONALMAPGENERATOR_API UIslandBatchGenerator : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	// Upper bound of candidates generated at the same time, 0 uses every task graph worker.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Batch", meta = (ClampMin = "0"))
+	int32 MaxWorkers = 0;
+
+	// Broadcast on the game thread with one summary per candidate, in candidate order.
+	UPROPERTY(BlueprintAssignable, Category = "Batch")
+	FOnIslandBatchGenerated OnBatchGenerated;
+
+	// Starts the batch, the template and all of its generators have to be native classes. Game thread only.
+	UFUNCTION(BlueprintCallable, Category = "Batch")
+	bool GenerateBatch(UIslandMapData* InTemplate, const TArray<FIslandBatchCandidate>& InCandidates);
+
+	// Candidates that did not start yet are skipped, waits for the running ones.
+	UFUNCTION(BlueprintCallable, Category = "Batch")
+	void CancelBatch();
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Batch")
+	bool IsGenerating() const;
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Batch")
+	const TArray<FIslandBatchSummary>& GetSummaries() const
+	{
+		return Summaries;
+	}
+
+	// Generates the full map data of one candidate of the last batch on the game thread.
+	UFUNCTION(BlueprintCallable, Category = "Batch")
+	UIslandMapData* CreateCandidateMapData(int32 Candidate, UObject* Outer) const;
+
+	FGraphEventRef GetCompletionTask() const
+	{
+		return CompletionTask;
+	}
+
+	static FIslandBatchSummary Summarize(const UIslandMapData* MapData);
+
+	// True if MapData and all of its generators can run off the game thread
+	static bool HasNativeGenerators(const UIslandMapData* MapData);
+	static void ApplyCandidate(UIslandMapData* MapData, const FIslandBatchCandidate& Candidate);
+	// A copy of Template with its own generators, mesh and coastline, owned by Outer. Game thread only.
+	static UIslandMapData* CreateScratch(const UIslandMapData* Template, UObject* Outer);
+
+	virtual void BeginDestroy() override;
+
+protected:
+	void GenerateCandidates(UIslandMapData* Scratch);
+
+	UPROPERTY(Transient)
+	TObjectPtr<UIslandMapData> Template;
+	// Kept between batches of the same template
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UIslandMapData>> WorkerMapData;
+
+	TArray<FIslandBatchCandidate> Candidates;
+	TArray<FIslandBatchSummary> Summaries;
+	std::atomic<int32> NextCandidate = 0;
+	std::atomic<bool> bCancelled = false;
+	FGraphEventRef CompletionTask;
+};
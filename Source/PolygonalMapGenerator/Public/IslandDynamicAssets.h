@@ -4,8 +4,15 @@
 #include "IslandMapData.h"
 #include "GeometryScript/MeshBasicEditFunctions.h"
 #include "UObject/Object.h"
+#include <atomic>
 #include "IslandDynamicAssets.generated.h"
 
+namespace UE::Geometry
+{
+	class FDynamicMesh3;
+}
+class UMaterialInterface;
+
 USTRUCT()
 struct FDynamicTileInfo
 {
@@ -24,8 +31,39 @@ struct FDynamicTileInfo
 	int32 TileCol = 0;
 	FVector2D TileCenter;
 	FGeometryScriptSimpleMeshBuffers Buffers;
+	/** Buffers already appended and with per vertex normals, built by the tile task and moved out on spawn. */
+	TSharedPtr<UE::Geometry::FDynamicMesh3, ESPMode::ThreadSafe> Mesh;
 };
 
+/** Center line of one river segment with the half width at every point, in map units. */
+struct FIslandRiverRibbon
+{
+	TArray<FVector2D> Points;
+	TArray<float> HalfWidths;
+	FBox2D Bounds = FBox2D(ForceInit);
+};
+
+UENUM(BlueprintType)
+enum class EDistrictIDTextureFormat : uint8
+{
+	// FloatRGBA, 8 bytes per pixel and texture
+	DTF_Float16 UMETA(DisplayName="Float16"),
+	// R8G8B8A8 with the same channels quantized to 1/255, half the memory, decoded by the same materials.
+	// Only holds the first 16 districts, Float16 holds up to 255.
+	DTF_Unorm8 UMETA(DisplayName="Unorm8"),
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnIslandAssetsGenerated, bool, bSucceeded);
+
+using FIslandAssetsCancelToken = TSharedPtr<std::atomic<bool>, ESPMode::ThreadSafe>;
+
+/**
+ * Threading rules of AsyncGenerateAssets:
+ * - Starting, cancelling and the completion broadcast happen on the game thread.
+ * - MapData generation and all UObject creation run as game thread tasks, worker tasks only fill plain buffers.
+ * - MapData and the settings of this object must not change until the completion task has run.
+ * - Every task of a run holds the cancel token of that run, starting a new run cancels and waits for the last one.
+ */
 UCLASS(Blueprintable, BlueprintType, EditInlineNew)
 class POLYGONALMAPGENERATOR_API UIslandDynamicAssets : public UObject
 {
@@ -35,15 +73,51 @@ public:
 	UPROPERTY(EditAnywhere, Instanced, BlueprintReadWrite, Category="MapData")
 	UIslandMapData* MapData;
 
+	/**
+	 * Headless runs generate the map data and the tile geometry only: no district ID textures, UVs or normals.
+	 * Consumers of the textures, like the PCG ID texture sampler, then get nothing.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="MapData")
+	EIslandGenerationProfile GenerationProfile = EIslandGenerationProfile::IGP_Auto;
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="District")
 	int32 DistrictIDTextureWidth = 4096;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="District")
 	int32 DistrictIDTextureHeight = 4096;
+	/**
+	 * Decodes the district IDs straight from the generated images into the shared cache of the PCG ID texture
+	 * sampler, so sampling these textures never reads them back. Keeps the decoded pixels alive with the textures.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="District")
+	bool bShareDistrictIDData = false;
+	/** Not used for the textures of a bake, see UIslandBakedData::DistrictIDTexture01. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="District")
+	EDistrictIDTextureFormat DistrictIDTextureFormat = EDistrictIDTextureFormat::DTF_Float16;
+	/**
+	 * Gives the district ID textures a full mip chain, every level keeps the four largest districts of the texels
+	 * below it instead of averaging IDs. Only for power of two sizes, costs a third more memory. Baked textures have
+	 * no mips.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="District")
+	bool bDistrictIDTextureMips = false;
+	/**
+	 * Renders the district ID textures on the GPU, proportions are then multiples of 1 / 8 and there are no mips.
+	 * The textures have no CPU copy, so the PCG ID texture sampler can only read them with bShareDistrictIDData,
+	 * which keeps the CPU path. Servers and platforms without SM5 or multisampling always use the CPU path.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="District")
+	bool bGenerateDistrictIDTextureOnGPU = false;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Grid")
 	int32 TileDivisions = 9;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Grid")
 	int32 TileResolution = 100;
+	/**
+	 * Merge grid cells of equal depth into quadtree leaves, so only the coastline band keeps the full resolution.
+	 * Leaves larger than a cell are flat, which keeps the edges towards finer leaves and neighbouring tiles closed.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Grid")
+	bool bAdaptiveTileMesh = false;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Border")
 	float BorderOffset = 500;
@@ -52,24 +126,125 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Border")
 	TObjectPtr<UCurveFloat> BorderDepthRemapCurve;
 
+	/**
+	 * Adds a flat ribbon along every river of the map data to the tiles, with RiverMaterialID so they share the tile
+	 * mesh and its component but not its collision. Rivers lie on the land height of the tiles, headless runs and
+	 * assets without a RiverMaterial skip them.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Rivers")
+	bool bGenerateRiverMeshes = false;
+	/** Material slot RiverMaterialID of every tile. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Rivers", meta = ( EditCondition = "bGenerateRiverMeshes" ))
+	TObjectPtr<UMaterialInterface> RiverMaterial;
+	/** Width of a river fed by a single spring, it grows with the square root of the flow. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Rivers",
+		meta = ( EditCondition = "bGenerateRiverMeshes", ClampMin = 0 ))
+	float RiverWidth = 100;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Rivers",
+		meta = ( EditCondition = "bGenerateRiverMeshes", ClampMin = 0 ))
+	float RiverMaxWidth = 1000;
+	/** Height of the ribbons above the land, against z-fighting. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Rivers", meta = ( EditCondition = "bGenerateRiverMeshes" ))
+	float RiverHeightOffset = 10;
+
 	FGraphEventRef GenerateMapDataTask;
 
 	FGraphEventRef GenDistrictIDTextureTask;
 
 	TArray<FDynamicTileInfo> TileInfo;
 
+	/** Broadcast on the game thread once all tasks of a run are done, with false if the run was cancelled. */
+	UPROPERTY(BlueprintAssignable, Category="MapData")
+	FOnIslandAssetsGenerated OnAssetsGenerated;
+
+	UFUNCTION(BlueprintCallable, Category="MapData")
 	void AsyncGenerateAssets();
 
+	/** Makes the tasks of the running generation skip their work and waits for them, game thread only. */
+	UFUNCTION(BlueprintCallable, Category="MapData")
+	void CancelAsyncGeneration();
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category="MapData")
+	bool IsGenerating() const;
+
+	/** Completes after every task of the last run, on the game thread. */
+	FGraphEventRef GetCompletionTask() const
+	{
+		return CompletionTask;
+	}
+
+	bool IsGenerationCancelled() const
+	{
+		return CancelToken.IsValid() && CancelToken->load();
+	}
+
+	FIslandAssetsCancelToken GetCancelToken() const
+	{
+		return CancelToken;
+	}
+
+	/** Whether the last run skipped the render only artifacts, see GenerationProfile. */
+	bool IsHeadless() const
+	{
+		return bHeadlessRun;
+	}
+
+	virtual void BeginDestroy() override;
+
+	/**
+	 * What AppendBuffersToMesh and SetPerVertexNormals would produce on an empty mesh, without any UObject.
+	 * TriGroupIDs become the material IDs. Without bRenderAttributes the mesh gets neither UVs nor normals.
+	 */
+	static void BuildTileMesh(UE::Geometry::FDynamicMesh3& Mesh, const FGeometryScriptSimpleMeshBuffers& Buffers,
+	                          bool bRenderAttributes = true);
+
+	/** Material ID, and TriGroupID in the tile buffers, of the river ribbon triangles. */
+	static constexpr int32 RiverMaterialID = 1;
+
+	/** Positions and triangles of Mesh without the river ribbons, what the tile collision is built from. */
+	static void CopyTerrainMesh(const UE::Geometry::FDynamicMesh3& Mesh, UE::Geometry::FDynamicMesh3& OutTerrain);
+
+	/** True if the tiles carry river ribbons, only known once the map data is generated. */
+	bool HasRiverRibbons() const
+	{
+		return !RiverRibbons.IsEmpty();
+	}
+
 protected:
 	UPROPERTY(BlueprintReadWrite)
 	UTexture2D* DistrictIDTexture01;
 	UPROPERTY(BlueprintReadWrite)
 	UTexture2D* DistrictIDTexture02;
 
+	FIslandAssetsCancelToken CancelToken;
+	// Resolved from GenerationProfile when a run starts, read by its tasks
+	bool bHeadlessRun = false;
+
+	FGraphEventRef CompletionTask;
+
 	FGraphEventRef AsyncGenerateDistrictIDTexture(const FGraphEventArray& Prerequisites);
 
+	FGraphEventRef AsyncGenerateDistrictIDTextureOnGPU(const FGraphEventArray& Prerequisites);
+
+	static UTexture2D* CreateDistrictIDTexture(int32 Width, int32 Height, EDistrictIDTextureFormat Format,
+	                                           int32 MipNum = 1);
+
 	void CalcTileMeshBuffer(const int32 GridIndex);
 
+	/** Turns the unit depth vertices of a tile into the final positions, UVs and mesh. */
+	void FinishTileMeshBuffer(FDynamicTileInfo& Info, const FVector2D& MapSize) const;
+
+	/** Bounds of every coastline of the map data, filled before any tile task runs. */
+	TArray<FBox2D> CoastlineBounds;
+
+	/** One ribbon per river segment, filled before any tile task runs when bGenerateRiverMeshes is set. */
+	TArray<FIslandRiverRibbon> RiverRibbons;
+
+	void PrepareRiverRibbons();
+
+	/** Appends the pieces of the river ribbons whose middle lies in the tile, after its vertices are final. */
+	void AppendRiverRibbons(FDynamicTileInfo& Info, const FVector2D& MapSize) const;
+
 public:
 	UFUNCTION(BlueprintCallable, Category="MapData")
 	FORCEINLINE int32 GetTileAmount() const;
@@ -0,0 +1,103 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Ticker.h"
+#include "IslandMapData.h"
+#include <atomic>
+#include "IslandGenerationHandle.generated.h"
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnIslandGenerationFinished, bool, bSucceeded);
+
+/**
+ * One run of UIslandMapData::GenerateIslandAsync, driven by the core ticker on the game thread.
+ * The points and every UObject are created on the game thread. Native stages run on the task graph like with
+ * bRunStagesConcurrently, Blueprint stages run one per tick. Completion events are broadcast on the game thread
+ * in stage order, and a cancelled run leaves the map to be rebuilt from scratch by the next generation.
+ * GenerateIsland is dispatched as usual on the first tick; its parent implementation queues the stages instead of
+ * running them, so an override that does not call it generates the island as one piece.
+ */
+UCLASS(BlueprintType)
+class POLYGONALMAPGENERATOR_API UIslandGenerationHandle : public UObject
+{
+	GENERATED_BODY()
+	friend class UIslandMapData;
+
+public:
+	// Broadcast on the game thread once the run is over, with false if it failed or was cancelled.
+	UPROPERTY(BlueprintAssignable, Category = "Procedural Generation|Island Generation")
+	FOnIslandGenerationFinished OnFinished;
+
+	// Stages that already started still run to their end, their results are dropped.
+	UFUNCTION(BlueprintCallable, Category = "Procedural Generation|Island Generation")
+	void Cancel();
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation")
+	bool IsDone() const
+	{
+		return bDone;
+	}
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation")
+	bool IsSucceeded() const
+	{
+		return bDone && bSucceeded;
+	}
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation")
+	bool IsCancelled() const
+	{
+		return bCancelled.load();
+	}
+
+	// Fraction of finished stages, the points count as the first stage.
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation")
+	float GetProgress() const;
+
+	// The stage list is known once the points are generated, until then only the points stage is listed.
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation")
+	int32 GetStageNum() const
+	{
+		return StageProgress.Num();
+	}
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation")
+	FString GetStageName(int32 Stage) const;
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation")
+	float GetStageProgress(int32 Stage) const;
+
+	virtual void BeginDestroy() override;
+
+protected:
+	void Start(UIslandMapData* InMapData);
+	bool Tick(float DeltaTime);
+	// Called by UIslandMapData::GenerateIsland_Implementation while the first tick dispatches GenerateIsland
+	void QueueStages();
+	void Finish(bool bInSucceeded, bool bBroadcast = true);
+	// Cancels and blocks until no stage task is left, game thread only. Without bBroadcast OnFinished stays silent,
+	// for when the handle or its map data are being destroyed.
+	void CancelAndWait(bool bBroadcast = true);
+	bool AreStageTasksComplete() const;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UIslandMapData> MapData;
+
+	TArray<UIslandMapData::FGenerationStage> Stages;
+	FGraphEventArray StageEvents;
+	// One entry for the points, then one per stage
+	TArray<float> StageProgress;
+	// Next stage to run or to broadcast the completion of
+	int32 NextStage = 0;
+	uint64 CacheKey = 0;
+	bool bConcurrent = false;
+	UIslandMapData::EGenerationStart GenerationStart = UIslandMapData::EGenerationStart::Invalid;
+	bool bBegun = false;
+	bool bQueueingStages = false;
+	bool bStagesQueued = false;
+	bool bDone = false;
+	bool bSucceeded = false;
+	std::atomic<bool> bCancelled = false;
+	FTSTicker::FDelegateHandle TickerHandle;
+};
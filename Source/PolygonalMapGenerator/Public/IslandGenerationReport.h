@@ -0,0 +1,142 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GenerationDiagnostics.h"
+#include "Stats/Stats.h"
+#include "IslandGenerationReport.generated.h"
+
+DECLARE_STATS_GROUP(TEXT("Island Generation"), STATGROUP_IslandGeneration, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Points"), STAT_IslandPoints, STATGROUP_IslandGeneration, POLYGONALMAPGENERATOR_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Water"), STAT_IslandWater, STATGROUP_IslandGeneration, POLYGONALMAPGENERATOR_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Elevation"), STAT_IslandElevation, STATGROUP_IslandGeneration,
+                          POLYGONALMAPGENERATOR_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Rivers"), STAT_IslandRivers, STATGROUP_IslandGeneration, POLYGONALMAPGENERATOR_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Moisture"), STAT_IslandMoisture, STATGROUP_IslandGeneration,
+                          POLYGONALMAPGENERATOR_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Coast"), STAT_IslandCoast, STATGROUP_IslandGeneration, POLYGONALMAPGENERATOR_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Temperature"), STAT_IslandTemperature, STATGROUP_IslandGeneration,
+                          POLYGONALMAPGENERATOR_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Biomes"), STAT_IslandBiomes, STATGROUP_IslandGeneration, POLYGONALMAPGENERATOR_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Districts"), STAT_IslandDistricts, STATGROUP_IslandGeneration,
+                          POLYGONALMAPGENERATOR_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Coastlines"), STAT_IslandCoastlines, STATGROUP_IslandGeneration,
+                          POLYGONALMAPGENERATOR_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Finish"), STAT_IslandFinish, STATGROUP_IslandGeneration, POLYGONALMAPGENERATOR_API);
+
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Layers"), STAT_IslandLayersMemory, STATGROUP_IslandGeneration,
+                           POLYGONALMAPGENERATOR_API);
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Mesh"), STAT_IslandMeshMemory, STATGROUP_IslandGeneration, POLYGONALMAPGENERATOR_API);
+
+USTRUCT(BlueprintType)
+struct POLYGONALMAPGENERATOR_API FIslandStageTiming
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Report")
+	FName Stage;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Report")
+	float Seconds = 0.f;
+	// Kept the outputs of the previous generation, see UIslandMapData::bIncrementalRegeneration
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Report")
+	bool bSkipped = false;
+};
+
+USTRUCT(BlueprintType)
+struct POLYGONALMAPGENERATOR_API FIslandDiagnosticCount
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Report")
+	FString Category;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Report")
+	int64 Count = 0;
+	// The first few element indices, see FGenerationDiagnostics
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Report")
+	TArray<int64> Samples;
+};
+
+/**
+ * What the last generation did and what its results hold on to. Filled in every build configuration, the stages
+ * are timed with one cycle counter read at each end, so reading it back is the only real cost.
+ */
+USTRUCT(BlueprintType)
+struct POLYGONALMAPGENERATOR_API FIslandGenerationReport
+{
+	GENERATED_BODY()
+
+	// Points first, then the stages in their serial order, and the finishing steps last
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Report")
+	TArray<FIslandStageTiming> Stages;
+	// Wall time from the start of the generation until its completion event
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Report")
+	float TotalSeconds = 0.f;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Report")
+	bool bLoadedFromCache = false;
+	// Loaded from UIslandMapData::BakedIsland, bLoadedFromCache is set as well
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Report")
+	bool bLoadedFromBake = false;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Report")
+	int32 NumRegions = 0;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Report")
+	int64 LayersAllocatedSize = 0;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Report")
+	int64 MeshAllocatedSize = 0;
+	// Problems of the generation by category, logged once each instead of per element
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Report")
+	TArray<FIslandDiagnosticCount> Diagnostics;
+
+	void Reset();
+
+	void SetDiagnostics(const FGenerationDiagnostics& InDiagnostics);
+
+	/** Stages keep pointers to their entries, so reserve every entry before handing out the first one. */
+	FIslandStageTiming& AddStage(FName Stage);
+
+	float GetStageSeconds(FName Stage) const;
+
+	void Log() const;
+};
+
+USTRUCT(BlueprintType)
+struct POLYGONALMAPGENERATOR_API FIslandMemoryComponent
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Memory")
+	FName Name;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Memory")
+	int64 Bytes = 0;
+};
+
+/** Heap memory held by the parts of a generated island, or estimated for one about to be generated. */
+USTRUCT(BlueprintType)
+struct POLYGONALMAPGENERATOR_API FIslandMemoryFootprint
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Memory")
+	TArray<FIslandMemoryComponent> Components;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Memory")
+	int64 TotalBytes = 0;
+
+	void Add(FName Name, SIZE_T Bytes);
+
+	int64 GetBytes(FName Name) const;
+
+	void Log() const;
+};
+
+/** Times one stage into its report entry and the matching cycle stat. */
+struct POLYGONALMAPGENERATOR_API FIslandStageScope
+{
+	FIslandStageScope(FIslandStageTiming* InTiming, TStatId StatId);
+	~FIslandStageScope();
+
+private:
+	FIslandStageTiming* Timing;
+	uint64 StartCycles;
+	FScopeCycleCounter CycleCounter;
+};
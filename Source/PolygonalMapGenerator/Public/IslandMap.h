@@ -20,23 +20,21 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
-#include "GameplayTagContainer.h"
+#include "Containers/Ticker.h"
 
-#include "DualMesh/Public/RandomSampling/SimplexNoise.h"
-#include "DualMesh/Public/TriangleDualMesh.h"
-
-#include "IslandMapUtils.h"
-#include "Mesh/IslandMeshBuilder.h"
-#include "Biomes/IslandBiome.h"
-#include "Elevation/IslandElevation.h"
-#include "Moisture/IslandMoisture.h"
-#include "Rivers/IslandRivers.h"
-#include "Water/IslandWater.h"
+#include "IslandMapData.h"
 
 #include "IslandMap.generated.h"
 
-DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnIslandGenerationComplete);
-
+/**
+ * Actor that generates an island when play begins. The layers and the generation itself live in MapData,
+ * the settings of the actor are copied into it before every generation.
+ *
+ * In multiplayer only the server generates from its settings. Clients get ReplicatedIsland, generate the same
+ * island from its seeds and verify it, then apply the RegionPatches the server made since. The layers themselves
+ * never replicate, so the actor class must carry the same generation settings on every machine. Replication is
+ * off by default, turn on Replicates and Always Relevant on the actor to use it.
+ */
 UCLASS()
 class POLYGONALMAPGENERATOR_API AIslandMap : public AActor
 {
@@ -48,41 +46,40 @@ private:
 	FDateTime LastRegenerationTime;
 #endif
 
+#if WITH_EDITORONLY_DATA
+	UPROPERTY(Transient)
+	TObjectPtr<class UIslandPreviewGenerator> PreviewGenerator;
+	FTSTicker::FDelegateHandle PreviewRefineHandle;
+#endif
+
 protected:
-	UPROPERTY()
-	TArray<bool> r_water;
-	UPROPERTY()
-	TArray<bool> r_ocean;
-	UPROPERTY()
-	TArray<bool> r_coast;
-	UPROPERTY()
-	TArray<float> r_elevation;
-	UPROPERTY()
-	TArray<int32> r_waterdistance;
-	UPROPERTY()
-	TArray<float> r_moisture;
-	UPROPERTY()
-	TArray<float> r_temperature;
-	UPROPERTY()
-	TArray<FBiomeData> r_biome;
-
-	UPROPERTY()
-	TArray<int32> t_coastdistance;
-	UPROPERTY()
-	TArray<float> t_elevation;
-	UPROPERTY()
-	TArray<FSideIndex> t_downslope_s;
-	UPROPERTY()
-	TArray<int32> s_flow;
-	UPROPERTY()
-	TArray<FTriangleIndex> spring_t;
-	UPROPERTY()
-	TArray<FTriangleIndex> river_t;
-
-	// Note -- will be compiled when GetVoronoiPolygons is first called.
-	// This will take a long time to compile and use a lot of memory. Use with caution!
-	UPROPERTY()
-	TArray<FIslandPolygon> VoronoiPolygons;
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Category = "Map")
+	TObjectPtr<UIslandMapData> MapData;
+
+	// Full biome of every region, built when GetRegionBiomes is first called.
+	UPROPERTY(Transient)
+	TArray<FBiomeData> RegionBiomes;
+
+	// Copies the settings of the actor into MapData, false if the actor is not set up
+	bool ApplySettings();
+
+	// Set by the server after every generation
+	UPROPERTY(ReplicatedUsing = OnRep_ReplicatedIsland)
+	FIslandReplicationState ReplicatedIsland;
+	// The current values of every region the server edited since the generation, merged into disjoint ranges of at
+	// most MaxRegionPatchSize regions. Clients apply all of them again whenever they change.
+	UPROPERTY(ReplicatedUsing = OnRep_RegionPatches)
+	TArray<FIslandRegionPatch> RegionPatches;
+	// Keeps RegionPatches well below net.MaxRepArraySize and the size of a replicated property
+	static constexpr int32 MaxRegionPatchSize = 256;
+	static constexpr int32 MaxRegionPatchNum = 16;
+
+	UFUNCTION()
+	void OnRep_ReplicatedIsland();
+	UFUNCTION()
+	void OnRep_RegionPatches();
+	// Applies RegionPatches, once the island of the client is verified
+	void ApplyPendingRegionPatches();
 
 public:
 	// The random seed to use for the island.
@@ -94,6 +91,8 @@ public:
 	// Modifies how we calculate drainage.
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "RNG", meta = (NoSpinbox))
 	int32 RiverSeed;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "RNG", meta = (NoSpinbox))
+	int32 DistrictSeed;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "RNG")
 	bool bDetermineRandomSeedAtRuntime;
 	// Modifies the types of biomes we produce.
@@ -132,7 +131,37 @@ public:
 	const UIslandRivers* Rivers;
 	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Map")
 	const UIslandWater* Water;
+	// Optional, the regions keep no district without it.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Map")
+	UIslandDistrict* District;
+
+	// Spreads the generation over the next ticks, see UIslandMapData::GenerateIslandAsync.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Map")
+	bool bGenerateAsynchronously;
+	// See UIslandMapData::bIncrementalRegeneration.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Map")
+	bool bIncrementalRegeneration;
+	// See UIslandMapData::bUseDiskCache.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Cache")
+	bool bUseDiskCache;
+
+#if WITH_EDITORONLY_DATA
+	// Regenerates in the background while the settings of the actor are edited in a level.
+	UPROPERTY(EditAnywhere, Category = "Preview")
+	bool bLivePreview;
+	// While a property is dragged the preview uses this many times the point spacing, far fewer regions.
+	UPROPERTY(EditAnywhere, Category = "Preview", meta = (ClampMin = "1", EditCondition = "bLivePreview"))
+	float PreviewSpacingScale;
+	// Seconds without an edit before the preview is refined to full resolution.
+	UPROPERTY(EditAnywhere, Category = "Preview", meta = (ClampMin = "0", EditCondition = "bLivePreview"))
+	float PreviewRefineDelay;
+#endif
+
+	// Set on clients when their island does not match ReplicatedIsland, region patches are not applied then.
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Category = "Replication")
+	bool bReplicationMismatch;
 
+	// Filled once the island is generated.
 	UPROPERTY(VisibleInstanceOnly, BlueprintReadWrite, Category = "Map")
 	TArray<URiver*> CreatedRivers;
 
@@ -156,8 +185,14 @@ public:
 	AIslandMap();
 
 protected:
-	//virtual void OnConstruction(const FTransform& NewTransform) override;
 	virtual void BeginPlay() override;
+	virtual void BeginDestroy() override;
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+	// Starts a background generation of the current settings, see UIslandPreviewGenerator
+	void RequestPreview(float SpacingScale);
+#endif
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
 
 	UFUNCTION(BlueprintCallable, BlueprintNativeEvent, Category = "Procedural Generation|Island Generation")
 	void OnPointGenerationComplete();
@@ -182,43 +217,86 @@ protected:
 	void OnIslandGenComplete();
 	virtual void OnIslandGenComplete_Implementation();
 
+private:
+	// Pass the events of MapData on to the events of the actor
+	UFUNCTION()
+	void HandleMapPointsGenerated();
+	UFUNCTION()
+	void HandleMapWaterGenerated();
+	UFUNCTION()
+	void HandleMapElevationGenerated();
+	UFUNCTION()
+	void HandleMapRiversGenerated();
+	UFUNCTION()
+	void HandleMapMoistureGenerated();
+	UFUNCTION()
+	void HandleMapBiomesGenerated();
+	UFUNCTION()
+	void HandleMapGenerated();
+
 public:
 	// Creates the island using all the current parameters.
 	UFUNCTION(BlueprintCallable, BlueprintNativeEvent, Category = "Procedural Generation|Island Generation")
 	void GenerateIsland();
 	virtual void GenerateIsland_Implementation();
 
-	// WARNING: This will take a long time to compile and will use a lot of memory.
+	// Applies the patch to the island of the server and sends it to every client, see UIslandMapData::ApplyRegionPatch.
+	// False without change if the edited regions would no longer fit into MaxRegionPatchNum patches.
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Procedural Generation|Island Generation|Replication")
+	bool AddRegionPatch(const FIslandRegionPatch& Patch);
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation")
+	UIslandMapData* GetMapData() const
+	{
+		return MapData;
+	}
+
+	// Timings of the last generation, complete once OnIslandGenerationComplete is broadcast.
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation")
+	const FIslandGenerationReport& GetGenerationReport() const
+	{
+		return MapData->GetGenerationReport();
+	}
+
+	// The last finished generation, see UIslandMapData::GetSnapshot.
+	TSharedRef<const FIslandMapSnapshot> GetSnapshot() const
+	{
+		return MapData->GetSnapshot();
+	}
+
+	// The Voronoi polygons without copying them, prefer this over GetVoronoiPolygons.
+	const FIslandVoronoiView& GetVoronoiView();
+	// WARNING: Copies every polygon of GetVoronoiView with its biome and will use a lot of memory.
 	// Use with caution!
 	UFUNCTION()
 	TArray<FIslandPolygon>& GetVoronoiPolygons();
 
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Water")
-	TArray<bool>& GetWaterRegions();
+	TArray<bool> GetWaterRegions() const;
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Water")
 	bool IsPointWater(FPointIndex Region) const;
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Ocean")
-	TArray<bool>& GetOceanRegions();
+	TArray<bool> GetOceanRegions() const;
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Ocean")
 	bool IsPointOcean(FPointIndex Region) const;
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Ocean")
-	TArray<bool>& GetCoastalRegions();
+	TArray<bool> GetCoastalRegions() const;
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Ocean")
 	bool IsPointCoast(FPointIndex Region) const;
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Elevation")
-	TArray<float>& GetRegionElevations();
+	const TArray<float>& GetRegionElevations() const;
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Elevation")
 	float GetPointElevation(FPointIndex Region) const;
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Moisture")
-	TArray<int32>& GetRegionWaterDistance();
+	const TArray<int32>& GetRegionWaterDistance() const;
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Moisture")
 	int32 GetPointWaterDistance(FPointIndex Region) const;
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Moisture")
-	TArray<float>& GetRegionMoisture();
+	const TArray<float>& GetRegionMoisture() const;
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Moisture")
 	float GetPointMoisture(FPointIndex Region) const;
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Temperature")
-	TArray<float>& GetRegionTemperature();
+	const TArray<float>& GetRegionTemperature() const;
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Temperature")
 	float GetPointTemperature(FPointIndex Region) const;
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Biomes")
@@ -227,11 +305,11 @@ public:
 	FBiomeData GetPointBiome(FPointIndex Region) const;
 
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Ocean")
-	TArray<int32>& GetTriangleCoastDistances();
+	const TArray<int32>& GetTriangleCoastDistances() const;
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Ocean")
 	int32 GetTriangleCoastDistance(FTriangleIndex Triangle) const;
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Elevation")
-	TArray<float>& GetTriangleElevations();
+	const TArray<float>& GetTriangleElevations() const;
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Elevation")
 	float GetTriangleElevation(FTriangleIndex Triangle) const;
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Rivers")
@@ -20,9 +20,17 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
-#include "IslandMap.h"
+#include "GameplayTagContainer.h"
+#include "DualMesh/Public/RandomSampling/SimplexNoise.h"
 #include "DualMesh/Public/TriangleDualMesh.h"
+#include "GenerationDiagnostics.h"
+#include "IslandGenerationReport.h"
+#include "IslandMapSnapshot.h"
+#include "IslandQuantizedLayers.h"
 #include "IslandMapUtils.h"
+#include "IslandNavigationGraph.h"
+#include "IslandReplication.h"
+#include "Coastline/CoastDistanceField.h"
 #include "Mesh/IslandMeshBuilder.h"
 #include "Biomes/IslandBiome.h"
 #include "District/IslandDistrict.h"
@@ -33,12 +41,26 @@
 
 #include "IslandMapData.generated.h"
 
+class UIslandBakedData;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnIslandGenerationComplete);
+
+class UDualMeshBuilder;
+class UIslandGenerationHandle;
+
 UCLASS(BlueprintType, Blueprintable, EditInlineNew)
 class POLYGONALMAPGENERATOR_API UIslandMapData : public UObject
 {
 	GENERATED_BODY()
 	friend class UIslandMapUtils;
+	friend class AIslandMap;
 	friend class UIslandCoastline;
+	friend class UIslandGenerationHandle;
+	friend class UIslandBatchGenerator;
+	friend class UIslandPreviewGenerator;
+	friend class UIslandWorldGenerator;
+	friend class FIslandGenerationBenchmark;
+	friend class FIslandDeterminismTest;
 
 #if !UE_BUILD_SHIPPING
 
@@ -47,12 +69,19 @@ private:
 #endif
 
 protected:
+	// The layers are never replicated, clients regenerate them, see GetReplicationState and AIslandMap
+	// Water, ocean, coast, lake and boundary bits of each region, refreshed after the water and coast stages.
+	// The only copy of them that outlives a generation, the bool layers below are expanded from it.
 	UPROPERTY()
+	TArray<ERegionFlags> r_flags;
+	// Scratch views of r_flags for the stages, which still hand bools to Blueprint. Only valid while generating.
 	TArray<bool> r_water;
-	UPROPERTY()
 	TArray<bool> r_ocean;
-	UPROPERTY()
 	TArray<bool> r_coast;
+	// Index of the lake each region belongs to, INDEX_NONE for land and ocean
+	UPROPERTY()
+	TArray<int32> r_lake;
+	int32 NumLakes = 0;
 	UPROPERTY()
 	TArray<float> r_elevation;
 	UPROPERTY()
@@ -61,8 +90,12 @@ protected:
 	TArray<float> r_moisture;
 	UPROPERTY()
 	TArray<float> r_temperature;
+	// Index into BiomePalette per region
+	UPROPERTY()
+	TArray<uint8> r_biome;
+	// Distinct biomes of this map, entry 0 is the default biome
 	UPROPERTY()
-	TArray<FBiomeData> r_biome;
+	TArray<FBiomeData> BiomePalette;
 
 	UPROPERTY()
 	TArray<int32> t_coastdistance;
@@ -72,11 +105,24 @@ protected:
 	TArray<FSideIndex> t_downslope_s;
 	UPROPERTY()
 	TArray<int32> s_flow;
+	// Drained land triangles per triangle, only filled when the rivers use flow accumulation
+	UPROPERTY()
+	TArray<int32> t_flow;
 	UPROPERTY()
 	TArray<FTriangleIndex> spring_t;
 	UPROPERTY()
 	TArray<FTriangleIndex> river_t;
+	// Blueprint wrappers of RiverNetwork, see GetRivers
+	UPROPERTY(Transient)
+	TArray<URiver*> RiverObjects;
+	// The float and distance layers between generations with bQuantizeLayers, the full precision arrays are empty then
+	FIslandQuantizedLayers QuantizedLayers;
+	// What the layer getters hand out while the layers are quantized, the quantized layers stay the storage
+	mutable FIslandDecodedLayers DecodedLayers;
+	mutable FCriticalSection DecodedLayersLock;
 
+	// Built when GetVoronoiView or GetVoronoiPolygons is first called, reads the mesh in place.
+	FIslandVoronoiView VoronoiView;
 	// Note -- will be compiled when GetVoronoiPolygons is first called.
 	// This will take a long time to compile and use a lot of memory. Use with caution!
 	UPROPERTY()
@@ -85,8 +131,41 @@ protected:
 	UPROPERTY()
 	UIslandCoastline* IslandCoastline;
 
+	FCoastDistanceField CoastDistanceField;
+
+	// Built at the end of the generation with bBuildMapQuery, otherwise on the first GetMapQuery
+	mutable TSharedPtr<const FIslandMapQuery> MapQuery;
+	mutable FCriticalSection MapQueryLock;
+	TSharedRef<const FIslandMapQuery> BuildMapQuery() const;
+
+	// Built on the first GetNavigationGraph after a generation
+	mutable TSharedPtr<const FIslandNavigationGraph> NavigationGraph;
+	mutable FCriticalSection NavigationGraphLock;
+
 	UPROPERTY()
 	TArray<FDistrictRegion> DistrictRegions;
+	// District of each region, -1 outside of every district
+	UPROPERTY()
+	TArray<int32> r_district;
+
+	// Fingerprints of the last generation, see bIncrementalRegeneration
+	uint32 MeshFingerprint = 0;
+	// Key of the disk cache and the bakes for the seeds and settings of the last generation
+	uint64 LastCacheKey = 0;
+	TArray<uint32> StageFingerprints;
+
+	UPROPERTY(Transient)
+	FIslandGenerationReport GenerationReport;
+	uint64 GenerationStartCycles = 0;
+	// Problems the stages counted instead of logging every element, summarized in GenerationReport
+	FGenerationDiagnostics Diagnostics;
+	// Rng as the point and water stages left it, restored when those stages are skipped
+	FRandomStream PostMeshRng;
+	FRandomStream PostWaterRng;
+
+	// The last published generation, replaced as a whole under SnapshotLock
+	TSharedRef<const FIslandMapSnapshot> Snapshot = MakeShared<FIslandMapSnapshot>();
+	mutable FCriticalSection SnapshotLock;
 
 public:
 	// The random seed to use for the island.
@@ -140,11 +219,102 @@ public:
 	const UIslandRivers* Rivers;
 	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Map")
 	const UIslandWater* Water;
+	// Optional, the regions keep no district without it.
 	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Map")
 	UIslandDistrict* District;
 
-	UPROPERTY(VisibleInstanceOnly, BlueprintReadWrite, Category = "Map")
-	TArray<URiver*> CreatedRivers;
+	// Flattens the mesh's region neighbors into contiguous tables for the graph passes.
+	// Costs roughly three indices per side, turn off on low-memory targets.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Mesh")
+	bool bBuildMeshAdjacency = true;
+	// Stores the mesh positions in single precision, see UTriangleDualMesh::CompactPositions.
+	// Halves the memory of the positions on large maps, at the cost of precision far from the origin.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Mesh")
+	bool bCompactMeshPositions = false;
+	// Takes the mesh from a pool shared by every map data with the same point generator settings, Seed and mesh options,
+	// so varying only the later seeds builds the mesh once. Shared meshes must not be modified after the generation.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Mesh")
+	bool bShareMeshes = false;
+
+	// Refuses to generate when the mesh and layers of the points the generator would create are estimated to need
+	// more than this. 0 turns the check off, as do point generators that cannot estimate their region count.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Memory", meta = (ClampMin = "0"))
+	int32 MemoryBudgetMB = 0;
+	// Generates fewer regions instead of refusing when over MemoryBudgetMB. Only on the game thread.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Memory", meta = (EditCondition = "MemoryBudgetMB > 0"))
+	bool bDownscaleOverBudget = false;
+	// Keeps the elevation, moisture, temperature and distance layers in 16 bits once the generation is done, in the
+	// map data and its snapshots. The stages still work in full precision, and so does the next generation, which
+	// reruns every stage. The getters returning the layer arrays expand them back to full precision.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Memory")
+	bool bQuantizeLayers = false;
+
+	// Runs stages that do not depend on each other (districts, coastline, climate) on the task graph.
+	// The stage events still fire in order, but only once every stage is done.
+	// Falls back to serial generation whenever one of the stage objects is a Blueprint.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Map")
+	bool bRunStagesConcurrently = true;
+
+	// Keeps the mesh and the outputs of stages whose settings, seeds and upstream stages did not change. The settings
+	// include the data assets, data tables and curves a stage references, so editing the biome table reruns the
+	// biomes. Edits made to the layers from outside the stages are not tracked, call InvalidateGenerationCache after those.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Map")
+	bool bIncrementalRegeneration = true;
+
+	// Copies the layers into a read-only FIslandMapSnapshot at the end of every generation, see GetSnapshot.
+	// Keeps a second copy of every layer, only turn on when something reads the map while it regenerates,
+	// like the PCG island map sampler.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Map")
+	bool bPublishSnapshots = false;
+
+	// GenerateIslandAsync first generates and publishes a coarse island with ProgressiveRegionFraction of the regions
+	// on the calling tick, then the full island over the next ticks. The water shape is then drawn from Seed alone
+	// instead of after the points, so both share one coastline; this changes the islands of existing seeds.
+	// The coarse island ends with OnIslandCoarseGenerationComplete, the full one with OnIslandGenerationComplete.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Map|Progressive")
+	bool bProgressiveGeneration = false;
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Map|Progressive",
+		meta = (ClampMin = "0.001", ClampMax = "1", EditCondition = "bProgressiveGeneration"))
+	float ProgressiveRegionFraction = 0.03f;
+
+	// Builds the point queries of GetMapQuery at the end of every generation and publishes them with the snapshot,
+	// instead of building them on first use.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Map")
+	bool bBuildMapQuery = false;
+
+	// Edge costs of the navigation graph, see GetNavigationGraph
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Map")
+	FIslandNavigationSettings NavigationSettings;
+
+	// Writes every generated island to CacheDirectory and loads it back instead of generating when the seeds
+	// and settings match. Cache files are raw memory dumps and only valid on the platform that wrote them.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Cache")
+	bool bUseDiskCache = false;
+	// Defaults to Saved/IslandCache.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Cache", meta = (EditCondition = "bUseDiskCache"))
+	FString CacheDirectory;
+	// Loads this bake instead of generating when it was baked with the same seeds and settings, see UIslandBakedData.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Cache")
+	TObjectPtr<UIslandBakedData> BakedIsland;
+
+	// Every coastline keeps one simplified contour per tolerance, for consumers that do not need the exact coast.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Coastline")
+	TArray<float> CoastlineSimplificationTolerances;
+
+	// Bakes a signed distance field of the coastlines after generation, shared by the mesh generators.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Coastline")
+	bool bBakeCoastDistanceField = false;
+	// Texels along the longer side of the map.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Coastline",
+		meta = (EditCondition = "bBakeCoastDistanceField", ClampMin = "2"))
+	int32 CoastDistanceFieldResolution = 1024;
+	// Distances are clamped to this. Queries with a larger range fall back to the exact coastline edges.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Coastline",
+		meta = (EditCondition = "bBakeCoastDistanceField", ClampMin = "0"))
+	float CoastDistanceFieldMaxDistance = 500.f;
+
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Category = "Map")
+	FRiverNetwork RiverNetwork;
 
 
 	UPROPERTY(BlueprintAssignable)
@@ -161,6 +331,10 @@ public:
 	FOnIslandGenerationComplete OnIslandBiomeGenerationComplete;
 	UPROPERTY(BlueprintAssignable)
 	FOnIslandGenerationComplete OnIslandGenerationComplete;
+	// Broadcast instead of OnIslandGenerationComplete once the coarse island of bProgressiveGeneration is published.
+	// Stage events still fire for it, OnIslandGenerationComplete and replication only follow the full island.
+	UPROPERTY(BlueprintAssignable)
+	FOnIslandGenerationComplete OnIslandCoarseGenerationComplete;
 
 public:
 	UIslandMapData();
@@ -185,6 +359,95 @@ protected:
 	void OnBiomeGenerationComplete();
 	virtual void OnBiomeGenerationComplete_Implementation();
 
+	struct FGenerationStage
+	{
+		const TCHAR* Name;
+		// Indices of earlier stages whose outputs this stage reads
+		TArray<int32> Prerequisites;
+		TFunction<void()> Run;
+		FOnIslandGenerationComplete* OnComplete;
+		// Hash of the settings this stage reads, without the upstream layers
+		uint32 Inputs = 0;
+		// Set if neither the inputs nor any upstream stage changed since the last generation
+		bool bSkip = false;
+		TStatId StatId;
+		// Entry of GenerationReport the stage writes its timing to
+		FIslandStageTiming* Timing = nullptr;
+		// Active while the stage runs, see FGenerationDiagnosticsScope
+		FGenerationDiagnostics* Diagnostics = nullptr;
+	};
+	// Chains every stage's inputs with its prerequisites and marks the stages that can keep their outputs
+	void UpdateStageFingerprints(TArray<FGenerationStage>& Stages);
+	// Stage independent tail of GenerateIsland, also used after loading a cached island
+	void FinishGeneration();
+	// Copies the current layers into a new snapshot and swaps it in
+	void PublishSnapshot();
+
+	FString GetCachedIslandPath(uint64 CacheKey) const;
+	bool LoadCachedIsland(uint64 CacheKey);
+	bool LoadBakedIsland(uint64 CacheKey);
+	// Reads what SaveIslandToBytes wrote, false if it belongs to another key or cache version
+	bool LoadIslandFromBytes(TArrayView<const uint8> Bytes, uint64 CacheKey, const FString& Source);
+	void SaveCachedIsland(uint64 CacheKey);
+	// Every generated layer, the mesh, rivers, districts and coastlines, in the cache file layout
+	void SerializeIsland(FArchive& Ar);
+
+	enum class EGenerationStart : uint8
+	{
+		Invalid,
+		// Everything came from the disk cache, all completion events have been broadcast
+		Cached,
+		RunStages
+	};
+	// Everything GenerateIsland does before the stages run: the seeds, the stage list, the cache and the points
+	EGenerationStart BeginGeneration(TArray<FGenerationStage>& OutStages, uint64& OutCacheKey, bool& bOutConcurrent);
+	// Stores the cache file and finishes the generation once every stage ran
+	void EndGeneration(uint64 CacheKey);
+
+	// Runs the stages in order, or on the task graph as soon as their prerequisites are done
+	void RunGenerationStages(const TArray<FGenerationStage>& Stages, bool bConcurrent);
+	static void RunGenerationStage(const FGenerationStage& Stage);
+
+	UPROPERTY(Transient)
+	TObjectPtr<UIslandGenerationHandle> ActiveGeneration;
+	// Set on the scratch copies of UIslandBatchGenerator, the mesh and coastline objects are then rebuilt in place
+	UPROPERTY(Transient)
+	TObjectPtr<UDualMeshBuilder> ScratchMeshBuilder;
+	// Copy of PointGenerator scaled down to MemoryBudgetMB
+	UPROPERTY(Transient)
+	TObjectPtr<UIslandMeshBuilder> BudgetPointGenerator;
+
+	// Copy of the point generator scaled down to ProgressiveRegionFraction
+	UPROPERTY(Transient)
+	TObjectPtr<UIslandMeshBuilder> CoarsePointGenerator;
+	// Set while the coarse island of bProgressiveGeneration generates
+	bool bGeneratingCoarseIsland = false;
+	bool bIsCoarseIsland = false;
+
+	// Set when Mesh came from the pool of bShareMeshes
+	bool bMeshIsShared = false;
+	// Takes the mesh of the fingerprint from the pool, or generates and adds it
+	void AcquireSharedMesh(const UIslandMeshBuilder* PointGenerator, uint32 Fingerprint);
+
+	// The point generator to use within MemoryBudgetMB, nullptr if generation has to be refused
+	const UIslandMeshBuilder* ApplyMemoryBudget();
+	// Generates the coarse island of bProgressiveGeneration, false if the point generator cannot scale
+	bool GenerateCoarseIsland();
+
+	// Sizes every region, triangle and side layer to the current mesh, reusing the previous allocations
+	void ResetLayers();
+	// Fills the scratch bool layers from r_flags, so stages that are skipped still leave valid inputs behind
+	void ExpandRegionFlags();
+	// Labels the connected lakes of r_flags into r_lake and NumLakes
+	void LabelLakes();
+	// Rebuilds what the stages derive from r_flags after the flags were edited: lakes, coast distances, the
+	// coastline and the coast distance field
+	void RebuildRegionFlagLayers();
+	// Moves the layers of bQuantizeLayers into QuantizedLayers and frees their full precision arrays
+	void QuantizeLayers();
+	// Decodes QuantizedLayers back into the full precision arrays, false if the layers were not quantized
+	bool ExpandQuantizedLayers();
+
 	UFUNCTION(BlueprintCallable, BlueprintNativeEvent, Category = "Procedural Generation|Island Generation")
 	void OnIslandGenComplete();
 	virtual void OnIslandGenComplete_Implementation();
@@ -195,55 +458,169 @@ public:
 	void GenerateIsland();
 	virtual void GenerateIsland_Implementation();
 
+	// Starts the generation over the next ticks and returns right away. A running generation is cancelled first.
+	// GenerateIsland is called on the first tick, so Blueprint and C++ overrides run; the stages run over the
+	// following ticks if the override calls its parent implementation. Code after that call runs before them.
+	// With bProgressiveGeneration, the coarse island is generated and published before this returns.
+	UFUNCTION(BlueprintCallable, Category = "Procedural Generation|Island Generation")
+	UIslandGenerationHandle* GenerateIslandAsync();
+
+	// GenerateIslandAsync as a latent node, aborting the node cancels the generation.
+	UFUNCTION(BlueprintCallable, Category = "Procedural Generation|Island Generation",
+		meta = (Latent, LatentInfo = "LatentInfo", WorldContext = "WorldContextObject"))
+	void GenerateIslandLatent(UObject* WorldContextObject, FLatentActionInfo LatentInfo, bool& bSucceeded);
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation")
+	UIslandGenerationHandle* GetActiveGeneration() const
+	{
+		return ActiveGeneration;
+	}
+
+	// True while the published island is the coarse one of bProgressiveGeneration and the full one still generates.
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation")
+	bool IsCoarseIsland() const
+	{
+		return bIsCoarseIsland;
+	}
+
+	virtual void BeginDestroy() override;
+
 	UFUNCTION(BlueprintCallable, BlueprintPure)
 	FVector2D GetMapSize() const;
 
-	// WARNING: This will take a long time to compile and will use a lot of memory.
+	// The last finished generation. Unlike the layer getters below, which return the arrays the stages write to,
+	// the snapshot stays untouched while the next island generates and can be held on to from any thread.
+	// Empty before the first generation, or if bPublishSnapshots is off.
+	TSharedRef<const FIslandMapSnapshot> GetSnapshot() const;
+
+	// Identifies the seeds and settings of the last generation for the disk cache and the bakes, 0 before the first.
+	uint64 GetCacheKey() const;
+	// Changes whenever the layout of the cache files and bakes does
+	static int32 GetCacheVersion();
+	// The last generation in the island cache format, false if there is none.
+	bool SaveIslandToBytes(TArray<uint8>& OutBytes);
+
+	// Makes the next GenerateIsland rebuild everything, starting with the points.
+	UFUNCTION(BlueprintCallable, Category = "Procedural Generation|Island Generation")
+	void InvalidateGenerationCache();
+
+	// The Voronoi polygons without copying them, prefer this over GetVoronoiPolygons.
+	const FIslandVoronoiView& GetVoronoiView();
+	// WARNING: Copies every polygon of GetVoronoiView with its biome and will use a lot of memory.
 	// Use with caution!
 	UFUNCTION()
 	TArray<FIslandPolygon>& GetVoronoiPolygons();
 
+	// The bool layers are built from GetRegionFlags on every call, prefer IsPointWater and friends
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Water")
-	TArray<bool>& GetWaterRegions();
+	TArray<bool> GetWaterRegions() const;
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Water")
 	bool IsPointWater(FPointIndex Region) const;
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Ocean")
-	TArray<bool>& GetOceanRegions();
+	TArray<bool> GetOceanRegions() const;
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Ocean")
 	bool IsPointOcean(FPointIndex Region) const;
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Ocean")
-	TArray<bool>& GetCoastalRegions();
+	TArray<bool> GetCoastalRegions() const;
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Ocean")
 	bool IsPointCoast(FPointIndex Region) const;
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Water")
+	bool IsPointLake(FPointIndex Region) const;
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Water")
+	const TArray<int32>& GetRegionLakes() const;
+	// Lake index of the region, INDEX_NONE if it is not part of a lake
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Water")
+	int32 GetPointLake(FPointIndex Region) const;
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Water")
+	int32 GetLakeCount() const;
+	const TArray<ERegionFlags>& GetRegionFlags() const;
+	SIZE_T GetLayersAllocatedSize() const;
+
+	// What the mesh, every layer and the derived data of the last generation hold on to.
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation")
+	FIslandMemoryFootprint GetMemoryFootprint() const;
+	// The mesh and the layers of a generation with NumRegions regions, see MemoryBudgetMB.
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation")
+	FIslandMemoryFootprint EstimateMemoryFootprint(int32 NumRegions) const;
+	// True if the region has all of the given flags
+	bool HasPointFlags(FPointIndex Region, ERegionFlags Flags) const
+	{
+		return r_flags.IsValidIndex(Region) && EnumHasAllFlags(r_flags[Region], Flags);
+	}
+	// While the layers are quantized the getters return a full precision copy, decoded once per generation and
+	// released with the next one, see bQuantizeLayers. The point getters read the quantized layers directly.
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Elevation")
-	TArray<float>& GetRegionElevations();
+	const TArray<float>& GetRegionElevations() const;
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Elevation")
 	float GetPointElevation(FPointIndex Region) const;
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Moisture")
-	TArray<int32>& GetRegionWaterDistance();
+	const TArray<int32>& GetRegionWaterDistance() const;
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Moisture")
 	int32 GetPointWaterDistance(FPointIndex Region) const;
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Moisture")
-	TArray<float>& GetRegionMoisture();
+	const TArray<float>& GetRegionMoisture() const;
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Moisture")
 	float GetPointMoisture(FPointIndex Region) const;
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Temperature")
-	TArray<float>& GetRegionTemperature();
+	const TArray<float>& GetRegionTemperature() const;
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Temperature")
 	float GetPointTemperature(FPointIndex Region) const;
+	// Index of every region into GetBiomePalette
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Biomes")
+	const TArray<uint8>& GetRegionBiomeIndices() const;
+	// Copies the palette entry of every region, the layout the biomes were stored in before the palette
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Biomes",
+		meta = (DeprecatedFunction, DeprecationMessage = "Use GetRegionBiomeIndices and GetBiomePalette instead."))
+	TArray<FBiomeData> GetRegionBiomes() const;
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Biomes")
-	TArray<FBiomeData>& GetRegionBiomes();
+	const TArray<FBiomeData>& GetBiomePalette() const;
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Moisture")
 	FBiomeData GetPointBiome(FPointIndex Region) const;
+	// Index of the biome of the region into GetBiomePalette, without copying it. INDEX_NONE before the biomes exist.
+	int32 GetPointBiomeIndex(FPointIndex Region) const;
 
 	const TArray<FDistrictRegion>& GetDistrictRegions() const;
+	const TArray<int32>& GetRegionDistricts() const;
+	// The district index of the region, -1 outside of every district
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|District")
+	int32 GetPointDistrict(FPointIndex Region) const;
+
+	// Changes whenever any stage of the last generation worked on different inputs, 0 before the first generation.
+	uint32 GetGenerationFingerprint() const;
+
+	// Hash of the mesh positions and the generated layers, to tell whether two machines built the same island.
+	uint32 ComputeContentHash() const;
+	// The seeds, fingerprint and content hash of the last generation, for clients to regenerate it from.
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Replication")
+	FIslandReplicationState GetReplicationState() const;
+	// True if the last generation matches the one State was taken from. Logs which part differs otherwise.
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Replication")
+	bool VerifyReplicationState(const FIslandReplicationState& State) const;
+
+	// The current layers of Num regions from FirstRegion, to send an edit made after the generation.
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Replication")
+	FIslandRegionPatch MakeRegionPatch(int32 FirstRegion, int32 Num) const;
+	// Writes the patch into the layers and republishes the derived data. False without change if it does not fit.
+	// Like any edit from outside the stages, this makes the next generation start over.
+	UFUNCTION(BlueprintCallable, Category = "Procedural Generation|Island Generation|Replication")
+	bool ApplyRegionPatch(const FIslandRegionPatch& Patch);
+	// ApplyRegionPatch for every patch in order, republishing the derived data once. False without change if any
+	// of them does not fit. Patches that change flags also rebuild the lakes, coast distances and coastline.
+	bool ApplyRegionPatches(TConstArrayView<FIslandRegionPatch> Patches);
+
+	// Timings and memory of the last generation, complete once OnIslandGenerationComplete is broadcast.
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation")
+	const FIslandGenerationReport& GetGenerationReport() const
+	{
+		return GenerationReport;
+	}
 
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Ocean")
-	TArray<int32>& GetTriangleCoastDistances();
+	const TArray<int32>& GetTriangleCoastDistances() const;
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Ocean")
 	int32 GetTriangleCoastDistance(FTriangleIndex Triangle) const;
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Elevation")
-	TArray<float>& GetTriangleElevations();
+	const TArray<float>& GetTriangleElevations() const;
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Elevation")
 	float GetTriangleElevation(FTriangleIndex Triangle) const;
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Rivers")
@@ -251,6 +628,18 @@ public:
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Rivers")
 	TArray<int32>& GetSideFlow();
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Rivers")
+	const FRiverNetwork& GetRiverNetwork() const;
+	// One URiver per segment of the river network, created on first use after each generation.
+	UFUNCTION(BlueprintCallable, Category = "Procedural Generation|Island Generation|Rivers")
+	const TArray<URiver*>& GetRivers();
+	// The rivers used to be stored in the CreatedRivers property
+	UFUNCTION(BlueprintCallable, Category = "Procedural Generation|Island Generation|Rivers",
+		meta = (DeprecatedFunction, DeprecationMessage = "Use GetRivers or GetRiverNetwork instead."))
+	const TArray<URiver*>& GetCreatedRivers();
+	// Empty unless the rivers use flow accumulation
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Rivers")
+	const TArray<int32>& GetTriangleFlow() const;
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Rivers")
 	TArray<FTriangleIndex>& GetSpringTriangles();
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Rivers")
 	bool IsTriangleSpring(FTriangleIndex Triangle) const;
@@ -261,4 +650,52 @@ public:
 
 	UFUNCTION(BlueprintCallable, BlueprintPure)
 	const TArray<FCoastlinePolygon>& GetCoastLines() const;
+
+	const FCoastlineSpatialIndex& GetCoastlineSpatialIndex() const;
+
+	// Rebakes the coastline distance field from the current coastlines, e.g. after changing its settings.
+	UFUNCTION(BlueprintCallable, Category = "Procedural Generation|Island Generation|Coastline")
+	void BakeCoastDistanceField();
+
+	const FCoastDistanceField& GetCoastDistanceField() const;
+
+	/**
+	 * Signed distance from Point to the nearest coastline, negative on land and clamped to MaxDistance.
+	 * Samples the baked distance field when it covers MaxDistance, otherwise queries the coastline edges.
+	 */
+	double GetSignedCoastDistance(const FVector2D& Point, double MaxDistance) const;
+
+	/**
+	 * Point queries over the last finished generation, built on first use unless bBuildMapQuery is set. Do not call
+	 * it while the map generates. The result never changes and can be used from any thread, hold on to it instead
+	 * of calling this per query. Edits of the mesh after the generation are not seen.
+	 */
+	TSharedRef<const FIslandMapQuery> GetMapQuery() const;
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Query")
+	FIslandMapSample SampleAt(const FVector2D& Point) const;
+	// SampleAt for every point, spread over the worker threads
+	UFUNCTION(BlueprintCallable, Category = "Procedural Generation|Island Generation|Query")
+	TArray<FIslandMapSample> SampleAllAt(const TArray<FVector2D>& Points) const;
+	// Region elevations interpolated over the Delaunay triangle around the point
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Query")
+	float GetElevationAt(const FVector2D& Point) const;
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Query")
+	FBiomeData GetBiomeAt(const FVector2D& Point) const;
+	// The district index at the point, -1 outside of every district
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Query")
+	int32 GetDistrictAt(const FVector2D& Point) const;
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Query")
+	bool IsOceanAt(const FVector2D& Point) const;
+
+	/**
+	 * Region graph of the last finished generation for coarse AI paths, built on first use with NavigationSettings.
+	 * Same rules as GetMapQuery: do not call it while the map generates, the result can be used from any thread.
+	 */
+	TSharedRef<const FIslandNavigationGraph> GetNavigationGraph() const;
+
+	// Cheapest path over the regions from the region at Start to the region at Goal, as region positions.
+	// False when either point is not on walkable land or the land in between is not connected.
+	UFUNCTION(BlueprintCallable, Category = "Procedural Generation|Island Generation|Query")
+	bool FindPath(const FVector2D& Start, const FVector2D& Goal, TArray<FVector2D>& OutPath) const;
 };
@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RegionGrid.h"
+#include "IslandMapUtils.h"
+#include "IslandMapQuery.generated.h"
+
+class UTriangleDualMesh;
+
+/** Everything known about one point of the map, see FIslandMapQuery::Sample. */
+USTRUCT(BlueprintType)
+struct POLYGONALMAPGENERATOR_API FIslandMapSample
+{
+	GENERATED_BODY()
+
+	// Region elevations interpolated over the Delaunay triangle around the point
+	UPROPERTY(BlueprintReadOnly, Category = "Island Map Query")
+	float Elevation = -1.f;
+	// The region whose Voronoi cell holds the point, the attributes below are those of this region
+	UPROPERTY(BlueprintReadOnly, Category = "Island Map Query")
+	FPointIndex Region;
+	// Index into the biome palette of the map data
+	UPROPERTY(BlueprintReadOnly, Category = "Island Map Query")
+	uint8 Biome = 0;
+	// -1 outside of every district
+	UPROPERTY(BlueprintReadOnly, Category = "Island Map Query")
+	int32 District = INDEX_NONE;
+	UPROPERTY(BlueprintReadOnly, Category = "Island Map Query")
+	bool bOcean = true;
+};
+
+/**
+ * Point queries over one generation, for gameplay code that needs the map at arbitrary positions.
+ * Copies the region positions, the triangles and the queried layers, so it never changes after Build and can be
+ * used from any thread while the map data generates the next island. The containing triangle is found by walking
+ * from a triangle of the closest region, which a uniform grid finds in constant time.
+ */
+struct POLYGONALMAPGENERATOR_API FIslandMapQuery
+{
+	void Build(const UTriangleDualMesh& Mesh, TConstArrayView<float> Elevations, TConstArrayView<ERegionFlags> Flags,
+	           TConstArrayView<uint8> Biomes, TConstArrayView<int32> Districts);
+
+	bool IsValid() const
+	{
+		return !RegionPositions.IsEmpty();
+	}
+
+	/** The closest solid region, or an invalid index before Build. */
+	FPointIndex FindRegion(const FVector2D& Point) const;
+
+	FIslandMapSample Sample(const FVector2D& Point) const;
+	float GetElevationAt(const FVector2D& Point) const;
+	uint8 GetBiomeAt(const FVector2D& Point) const;
+	int32 GetDistrictAt(const FVector2D& Point) const;
+	bool IsOceanAt(const FVector2D& Point) const;
+
+	/** Sample for every point, spread over the worker threads. OutSamples must be as long as Points. */
+	void SampleAll(TConstArrayView<FVector2D> Points, TArrayView<FIslandMapSample> OutSamples) const;
+	/** GetElevationAt for every point, spread over the worker threads. OutElevations must be as long as Points. */
+	void GetElevationsAt(TConstArrayView<FVector2D> Points, TArrayView<float> OutElevations) const;
+
+	SIZE_T GetAllocatedSize() const;
+
+protected:
+	float InterpolateElevation(const FVector2D& Point, int32 Region) const;
+
+	TArray<FVector2D> RegionPositions;
+	FRegionGrid RegionGrid;
+	// One solid triangle around every region to start the walk from, INDEX_NONE for regions without one
+	TArray<int32> RegionTriangles;
+	// The corner regions of every solid triangle and the triangle across each of its sides, INDEX_NONE on the hull
+	TArray<FIntVector> TriangleCorners;
+	TArray<FIntVector> TriangleNeighbors;
+
+	TArray<float> r_elevation;
+	TArray<uint8> r_biome;
+	TArray<int32> r_district;
+	TBitArray<> r_ocean;
+};
@@ -0,0 +1,102 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/StrongObjectPtr.h"
+#include "DualMesh/Public/TriangleDualMesh.h"
+#include "IslandMapUtils.h"
+#include "Biomes/IslandBiome.h"
+#include "Coastline/CoastDistanceField.h"
+#include "Coastline/IslandCoastline.h"
+#include "District/IslandDistrict.h"
+#include "IslandMapQuery.h"
+#include "IslandQuantizedLayers.h"
+#include "Rivers/RiverNetwork.h"
+
+/**
+ * The layers of one finished generation. UIslandMapData publishes a new snapshot at the end of every generation
+ * and never changes it afterwards, so it can be read from any thread while the next island is generated.
+ * The mesh and coastline objects are shared with the map data instead of copied. Editing the mesh in place
+ * (e.g. UTriangleDualMesh::MoveRegion) therefore also changes what older snapshots see.
+ */
+struct POLYGONALMAPGENERATOR_API FIslandMapSnapshot
+{
+	TStrongObjectPtr<UTriangleDualMesh> Mesh;
+	TStrongObjectPtr<UIslandCoastline> Coastline;
+
+	TArray<ERegionFlags> r_flags;
+	TArray<int32> r_lake;
+	int32 NumLakes = 0;
+	TArray<float> r_elevation;
+	TArray<int32> r_waterdistance;
+	TArray<float> r_moisture;
+	TArray<float> r_temperature;
+	TArray<uint8> r_biome;
+	// Not referenced for the garbage collector, the biome assets of the map data keep the materials alive
+	TArray<FBiomeData> BiomePalette;
+	TArray<int32> r_district;
+	TArray<FDistrictRegion> DistrictRegions;
+
+	TArray<int32> t_coastdistance;
+	TArray<float> t_elevation;
+	// With UIslandMapData::bQuantizeLayers, replaces the full precision layers above
+	FIslandQuantizedLayers QuantizedLayers;
+	TArray<FSideIndex> t_downslope_s;
+	TArray<int32> t_flow;
+	TArray<int32> s_flow;
+	TArray<FTriangleIndex> spring_t;
+	TArray<FTriangleIndex> river_t;
+	FRiverNetwork RiverNetwork;
+
+	FCoastDistanceField CoastDistanceField;
+	// Only with UIslandMapData::bBuildMapQuery, shared with the map data
+	TSharedPtr<const FIslandMapQuery> MapQuery;
+
+	// UIslandMapData::GetGenerationFingerprint of the generation, 0 for the empty snapshot
+	uint32 GenerationFingerprint = 0;
+
+	// False before the first generation
+	bool IsValid() const
+	{
+		return Mesh.IsValid();
+	}
+
+	// True if the region has all of the given flags
+	bool HasPointFlags(FPointIndex Region, ERegionFlags Flags) const
+	{
+		return r_flags.IsValidIndex(Region) && EnumHasAllFlags(r_flags[Region], Flags);
+	}
+
+	float GetPointElevation(FPointIndex Region) const
+	{
+		if (r_elevation.IsValidIndex(Region))
+		{
+			return r_elevation[Region];
+		}
+		return QuantizedLayers.r_elevation.IsValidIndex(Region) ? QuantizedLayers.r_elevation[Region] : -1.0f;
+	}
+
+	float GetPointMoisture(FPointIndex Region) const
+	{
+		if (r_moisture.IsValidIndex(Region))
+		{
+			return r_moisture[Region];
+		}
+		return QuantizedLayers.r_moisture.IsValidIndex(Region) ? QuantizedLayers.r_moisture[Region] : -1.0f;
+	}
+
+	// The district index of the region, -1 outside of every district
+	int32 GetPointDistrict(FPointIndex Region) const
+	{
+		return r_district.IsValidIndex(Region) ? r_district[Region] : INDEX_NONE;
+	}
+
+	FBiomeData GetPointBiome(FPointIndex Region) const;
+
+	// Same as UIslandMapData::GetSignedCoastDistance
+	double GetSignedCoastDistance(const FVector2D& Point, double MaxDistance) const;
+
+	// The copied layers, without the shared mesh and coastlines
+	SIZE_T GetAllocatedSize() const;
+};
@@ -24,6 +24,7 @@
 #include "GameplayTagsManager.h"
 #include "Delaunator/Public/DelaunayHelper.h"
 #include "DualMesh/Public/TriangleDualMesh.h"
+#include "IslandVoronoiView.h"
 #include "PolyPartitionHelper.h"
 #include "ProceduralMeshComponent.h"
 
@@ -41,6 +42,32 @@ enum class ERemapType : uint8
 	RT_EaseInOutQuad UMETA(DisplayName="Ease In Out Quad"),
 };
 
+// Boolean region layers packed into one byte per region.
+UENUM(BlueprintType, meta = (Bitflags, UseEnumValuesAsMaskValuesInEditor = "true"))
+enum class ERegionFlags : uint8
+{
+	None = 0 UMETA(Hidden),
+	Water = 1 << 0,
+	Ocean = 1 << 1,
+	Coast = 1 << 2,
+	// Water that is not ocean
+	Lake = 1 << 3,
+	Boundary = 1 << 4,
+};
+ENUM_CLASS_FLAGS(ERegionFlags);
+
+// Which artifacts the mesh actors and dynamic assets build, see UIslandMapUtils::IsHeadlessProfile.
+UENUM(BlueprintType)
+enum class EIslandGenerationProfile : uint8
+{
+	// Headless on dedicated servers and without a renderer, Full otherwise
+	IGP_Auto UMETA(DisplayName="Auto"),
+	IGP_Full UMETA(DisplayName="Full"),
+	// Only what gameplay reads: the layers, the query structures and the collision geometry. No textures,
+	// materials, UVs, normals, LODs or PN tessellation.
+	IGP_Headless UMETA(DisplayName="Headless"),
+};
+
 USTRUCT(BlueprintType)
 struct POLYGONALMAPGENERATOR_API FIslandShape
 {
@@ -166,6 +193,9 @@ struct POLYGONALMAPGENERATOR_API FIslandPolygon
 public:
 	UPROPERTY(VisibleAnywhere, BlueprintReadWrite)
 	FBiomeData Biome;
+	// Index into the biome palette of the map data this polygon was built from
+	UPROPERTY(VisibleAnywhere, BlueprintReadWrite)
+	uint8 BiomeIndex = 0;
 	UPROPERTY(VisibleAnywhere, BlueprintReadWrite)
 	TArray<FVector> VertexPoints;
 	UPROPERTY(VisibleAnywhere, BlueprintReadWrite)
@@ -196,7 +226,8 @@ USTRUCT()
 struct POLYGONALMAPGENERATOR_API FRegionEdge
 {
 	GENERATED_BODY()
-	TWeakPtr<FRegionEdge> Next;
+	// Index of the following edge in the same edge array, see UIslandMapUtils::ExtractBoundaryLoops
+	int32 Next = INDEX_NONE;
 	FTriangleIndex AIndex;
 	FVector2D APosition;
 	FTriangleIndex BIndex;
@@ -214,11 +245,13 @@ USTRUCT()
 struct POLYGONALMAPGENERATOR_API FAreaContour
 {
 	GENERATED_BODY()
-	TArray<TSharedPtr<FRegionEdge>> Edges;
-	TWeakPtr<FRegionEdge> Begin;
-	TWeakPtr<FRegionEdge> End;
 	TArray<FTriangleIndex> Indices;
 	TArray<FVector2D> Positions;
+
+	SIZE_T GetAllocatedSize() const
+	{
+		return Indices.GetAllocatedSize() + Positions.GetAllocatedSize();
+	}
 };
 
 /**
@@ -234,6 +267,15 @@ public:
 	static void RandomShuffle(TArray<FTriangleIndex>& OutShuffledArray, UPARAM(ref) FRandomStream& Rng);
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Utils")
 	static float FBMNoise(const TArray<float>& Amplitudes, const FVector2D& Position);
+	// FBMNoise of every position, spread over the worker threads. OutNoise must be as long as Positions.
+	static void FBMNoiseBatch(const TArray<float>& Amplitudes, TConstArrayView<FVector2D> Positions, TArrayView<float> OutNoise);
+
+	/**
+	 * Whether Profile skips the render only artifacts on this process. The console variable
+	 * island.GenerationProfile (1 Full, 2 Headless) overrides every object, e.g. from the engine ini of a server.
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Utils")
+	static bool IsHeadlessProfile(EIslandGenerationProfile Profile);
 
 	/**
 	 * Remap value [0 - 1] to different curves.
@@ -249,6 +291,12 @@ public:
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Procedural Generation|Island Generation|Biomes")
 	static FBiomeData GetBiome(const UDataTable* BiomeData, bool bIsOcean, bool bIsWater, bool bIsCoast,
 	                           float Temperature, float Moisture);
+	// The debug drawings below are one line batch component per layer on their context actor: "Delaunay", "Voronoi"
+	// and "Rivers". Drawing a layer replaces its previous lines.
+	UFUNCTION(BlueprintCallable, Category = "Procedural Generation|Island Generation|Debug")
+	static void SetDebugLayerVisible(AActor* Context, FName Layer, bool bVisible);
+	UFUNCTION(BlueprintCallable, Category = "Procedural Generation|Island Generation|Debug")
+	static void ClearDebugLayer(AActor* Context, FName Layer);
 	UFUNCTION(BlueprintCallable, Category = "Procedural Generation|Island Generation|Debug")
 	static void DrawDelaunayFromMap(class AIslandMap* Map);
 	//UFUNCTION(BlueprintCallable, Category = "Procedural Generation|Island Generation|Debug")
@@ -263,6 +311,9 @@ public:
 	static void DrawVoronoiMesh(AActor* Context, UTriangleDualMesh* Mesh, const TArray<FIslandPolygon>& Polygons,
 	                            const TArray<int32>& SideFlow, const TArray<URiver*>& Rivers,
 	                            const TArray<float>& TriangleElevations);
+	// The outlines of DrawVoronoiMesh straight from the mesh, RegionColor picks the color of every polygon
+	static void DrawVoronoiView(AActor* Context, const FIslandVoronoiView& Voronoi,
+	                            TFunctionRef<FColor(FPointIndex)> RegionColor, const TArray<float>& TriangleElevations);
 	UFUNCTION(BlueprintCallable, Category = "Procedural Generation|Island Generation|Debug")
 	static void DrawRivers(AActor* Context, UTriangleDualMesh* Mesh, const TArray<URiver*>& Rivers,
 	                       const TArray<int32>& SideFlow, const TArray<float>& TriangleElevations);
@@ -275,11 +326,102 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Procedural Generation|Island Generation")
 	static void GenerateMapMeshMultiMaterial(UTriangleDualMesh* Mesh, UProceduralMeshComponent* MapMesh, float ZScale,
 	                                         const TArray<float>& RegionElevation, const TArray<bool>& CostalRegions,
-	                                         const TArray<FBiomeData> RegionBiomes);
+	                                         const TArray<FBiomeData>& RegionBiomes);
+	// Same as GenerateMapMeshMultiMaterial, with one palette index per region instead of a full biome.
+	UFUNCTION(BlueprintCallable, Category = "Procedural Generation|Island Generation")
+	static void GenerateMapMeshMultiMaterialIndexed(UTriangleDualMesh* Mesh, UProceduralMeshComponent* MapMesh,
+	                                                float ZScale, const TArray<float>& RegionElevation,
+	                                                const TArray<bool>& CostalRegions,
+	                                                const TArray<uint8>& RegionBiomes,
+	                                                const TArray<FBiomeData>& BiomePalette);
+
+	// Resizes a map layer to Num zeroed entries, keeping its allocation when it is already large enough.
+	// Layers are reset on every regeneration, so this avoids reallocating them for each seed.
+	template <typename T>
+	static void ResetLayer(TArray<T>& Layer, int32 Num)
+	{
+		Layer.Reset(Num);
+		Layer.AddZeroed(Num);
+	}
+
+	template <typename T>
+	static void ResetLayer(TArray<T>& Layer, int32 Num, const T& Value)
+	{
+		Layer.Reset(Num);
+		Layer.AddUninitialized(Num);
+		for (T& Entry : Layer)
+		{
+			Entry = Value;
+		}
+	}
 
-	static void TriangulateContour(const FAreaContour& Contour, TArray<FPolyTriangle2D>& Triangles);
+	// Whether a Blueprint class of Object overrides the BlueprintNativeEvent Function.
+	static bool IsImplementedInScript(const UObject* Object, FName Function);
+
+	// Calls the BlueprintNativeEvent Event of Object, going straight to its native Implementation unless a Blueprint
+	// overrides the event. The event thunk copies every array it passes in and out, which would cost whole layer
+	// copies per stage. Implementation is virtual, so C++ overrides still run. Stages call it through
+	// ISLAND_CALL_NATIVE_OR_EVENT from their old-style aliases, like UIslandWater::assign_r_water.
+	template <typename ObjectType, typename EventType, typename ImplementationType, typename... ArgTypes>
+	static auto CallNativeOrEvent(const ObjectType* Object, FName Event, EventType EventFunction,
+	                              ImplementationType ImplementationFunction, ArgTypes&&... Args)
+	{
+		if (IsImplementedInScript(Object, Event))
+		{
+			return (Object->*EventFunction)(Forward<ArgTypes>(Args)...);
+		}
+		return (Object->*ImplementationFunction)(Forward<ArgTypes>(Args)...);
+	}
+
+	// Labels the connected groups of regions for which IsMember is true, in parallel. Non-members get INDEX_NONE,
+	// the groups are numbered by their lowest region. IsMember is called once per region, possibly concurrently.
+	// Returns the number of groups.
+	static int32 LabelConnectedRegions(const UTriangleDualMesh* Mesh, TFunctionRef<bool(FPointIndex)> IsMember,
+	                                   TArray<int32>& OutRegionLabels);
+
+	// Sorts Indices by Values[Index], ascending with ties kept in their input order. A parallel radix sort over
+	// the float bits, so every value orders consistently, NaN included.
+	static void SortIndicesByValue(TArray<int32>& Indices, TConstArrayView<float> Values);
+
+	// Packs the boolean region layers into flags. Coast may be empty if it has not been assigned yet.
+	static void PackRegionFlags(const UTriangleDualMesh* Mesh, const TArray<bool>& RegionWater,
+	                            const TArray<bool>& RegionOcean, const TArray<bool>& RegionCoast,
+	                            TArray<ERegionFlags>& OutRegionFlags);
+	// One bool per region telling whether it has all of Flag, the inverse of PackRegionFlags.
+	static void UnpackRegionFlags(TConstArrayView<ERegionFlags> RegionFlags, ERegionFlags Flag, TArray<bool>& OutRegions);
+
+	// Splits per region biomes into indices and a palette of distinct biomes. Entry 0 is always the default biome.
+	static void PackBiomes(const TArray<FBiomeData>& RegionBiomes, TArray<uint8>& OutRegionBiomes,
+	                       TArray<FBiomeData>& OutBiomePalette);
+
+	// Links every edge to the edge starting at its B triangle and walks the closed loops, in the order of their
+	// first edge. Loop i covers [OutLoopOffsets[i], OutLoopOffsets[i + 1]) of OutLoopEdges, stops after MaxLoopNum.
+	static void ExtractBoundaryLoops(TArray<FRegionEdge>& Edges, TArray<int32>& OutLoopOffsets,
+	                                 TArray<int32>& OutLoopEdges, int32 MaxLoopNum = MAX_int32);
+	// Triangle fans around every region IsIncluded accepts, in parallel. The fans use the triangle centers as
+	// vertices, numbered in the order a serial walk over the regions first meets them; OutVertexTriangles holds the
+	// triangle of every vertex and OutTriangleVertices the vertex of every triangle, INDEX_NONE if no fan uses it.
+	// IsIncluded is called once per region, possibly concurrently.
+	static void BuildRegionFans(const UTriangleDualMesh* Mesh, TFunctionRef<bool(FPointIndex)> IsIncluded,
+	                            TArray<FTriangleIndex>& OutVertexTriangles, TArray<FIntVector>& OutTriangles,
+	                            TArray<int32>& OutTriangleVertices);
+	// Contour through the A triangles of one loop of ExtractBoundaryLoops.
+	static void FillContour(FAreaContour& OutContour, const TArray<FRegionEdge>& Edges, TConstArrayView<int32> LoopEdges);
+
+	static void TriangulateContour(const FAreaContour& Contour, TArray<FPolyTriangle2D>& Triangles,
+	                               EPolyTriangulationMethod Method = EPolyTriangulationMethod::PTM_Monotone);
+
+	// Douglas-Peucker simplification of closed contours, every vertex stays within Tolerance of the result. Vertices
+	// are added back until no two edges of the results cross, so the contours do not cross each other or themselves.
+	static void SimplifyContours(TConstArrayView<const FAreaContour*> Contours, double Tolerance,
+	                             TArray<FAreaContour>& OutContours);
 
 	static bool PointInPolygon2D(const FVector2D& Point, const TArray<FVector2D>& Polygon);
 	static double DistanceToEdge2D(const FVector2D& Point, const FVector2D& EdgePointA, const FVector2D& EdgePointB);
 	static double DistanceToPolygon2D(const FVector2D& Point, const TArray<FVector2D>& Polygon, bool bZeroIfInner = true);
 };
+
+// UIslandMapUtils::CallNativeOrEvent for the event Function of ClassName, from a const member of ClassName.
+#define ISLAND_CALL_NATIVE_OR_EVENT(ClassName, Function, ...) \
+	UIslandMapUtils::CallNativeOrEvent(this, GET_FUNCTION_NAME_CHECKED(ClassName, Function), &ClassName::Function, \
+	                                   &ClassName::Function##_Implementation, ##__VA_ARGS__)
@@ -0,0 +1,78 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "IslandMapUtils.h"
+#include "IslandNavigationGraph.generated.h"
+
+class UTriangleDualMesh;
+
+USTRUCT(BlueprintType)
+struct POLYGONALMAPGENERATOR_API FIslandNavigationSettings
+{
+	GENERATED_BODY()
+
+	// Every step costs its length, times one plus this per unit of elevation gained
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Navigation", meta = (ClampMin = "0"))
+	float UphillCost = 10.f;
+	// Same as UphillCost for the elevation lost
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Navigation", meta = (ClampMin = "0"))
+	float DownhillCost = 2.f;
+	// Added to every step across a river, in map units
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Navigation", meta = (ClampMin = "0"))
+	float RiverCrossingCost = 1000.f;
+	// Rivers with less flow are crossed for free
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Navigation", meta = (ClampMin = "1"))
+	int32 MinRiverFlow = 1;
+	// Lakes are nodes like land, otherwise only land regions are
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Navigation")
+	bool bIncludeLakes = false;
+};
+
+/**
+ * Coarse navigation graph over the region adjacency, one node per land region, stored as compressed rows.
+ * Paths are planned with A* over the regions. Nodes are labelled with their connected component when the graph is
+ * built, so paths between different islands fail without a search.
+ */
+struct POLYGONALMAPGENERATOR_API FIslandNavigationGraph
+{
+	void Build(const UTriangleDualMesh& Mesh, TConstArrayView<float> Elevations, TConstArrayView<ERegionFlags> Flags,
+	           TConstArrayView<int32> SideFlow, const FIslandNavigationSettings& Settings);
+
+	bool IsValid() const
+	{
+		return !NodeRegions.IsEmpty();
+	}
+
+	int32 GetNodeNum() const
+	{
+		return NodeRegions.Num();
+	}
+
+	/** The node of the region, INDEX_NONE for regions that can not be walked on. */
+	int32 GetRegionNode(const FPointIndex Region) const
+	{
+		return RegionNodes.IsValidIndex(Region) ? RegionNodes[Region] : INDEX_NONE;
+	}
+
+	bool IsReachable(FPointIndex Start, FPointIndex Goal) const;
+
+	/**
+	 * Cheapest path from Start to Goal, both included. False if either region is not a node or the goal can not be
+	 * reached. OutCost is the sum of the edge costs along the path.
+	 */
+	bool FindPath(FPointIndex Start, FPointIndex Goal, TArray<FPointIndex>& OutPath, float* OutCost = nullptr) const;
+
+	SIZE_T GetAllocatedSize() const;
+
+protected:
+	TArray<int32> RegionNodes;
+	TArray<int32> NodeRegions;
+	TArray<FVector2D> NodePositions;
+	TArray<int32> NodeComponents;
+	// Node i links to EdgeTargets[EdgeOffsets[i] .. EdgeOffsets[i + 1])
+	TArray<int32> EdgeOffsets;
+	TArray<int32> EdgeTargets;
+	TArray<float> EdgeCosts;
+};
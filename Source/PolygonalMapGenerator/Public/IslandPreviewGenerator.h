@@ -0,0 +1,48 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "IslandMapData.h"
+#include <atomic>
+#include "IslandPreviewGenerator.generated.h"
+
+/**
+ * Regenerates an island on the task graph while its settings are edited, so the editor never waits on it.
+ * Each request generates a scratch copy of the target, see UIslandBatchGenerator::CreateScratch, and the finished
+ * island is loaded into the target on the game thread like a cached one. Only the newest request is kept: a request
+ * made while another one runs cancels that one at its next stage, and the ones in between are never started.
+ */
+UCLASS()
+class POLYGONALMAPGENERATOR_API UIslandPreviewGenerator : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	// Generates Target with SpacingScale times its point spacing, 1 for full resolution. Game thread only.
+	bool RequestPreview(UIslandMapData* InTarget, float SpacingScale);
+
+	// Drops the running and pending requests without waiting for them.
+	void CancelPreview();
+
+	bool IsGenerating() const;
+
+	virtual void BeginDestroy() override;
+
+protected:
+	void StartPendingRequest();
+	void FinishRequest();
+
+	UPROPERTY(Transient)
+	TObjectPtr<UIslandMapData> Target;
+	// Only touched by the worker task while it runs
+	UPROPERTY(Transient)
+	TObjectPtr<UIslandMapData> Scratch;
+
+	float PendingSpacingScale = 0.f;
+	bool bHasPendingRequest = false;
+	// The island of the running request, in the format of UIslandMapData::SaveIslandToBytes
+	TArray<uint8> PreviewBytes;
+	std::atomic<bool> bCancelled = false;
+	FGraphEventRef CompletionTask;
+};
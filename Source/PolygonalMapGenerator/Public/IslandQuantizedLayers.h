@@ -0,0 +1,146 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * A float layer stored as 16 bit steps between its smallest and largest value.
+ * The normalized layers keep about five significant digits, far more than the stages that produce them resolve.
+ */
+struct POLYGONALMAPGENERATOR_API FIslandQuantizedFloatLayer
+{
+	void Encode(TConstArrayView<float> InValues);
+	void Decode(TArray<float>& OutValues) const;
+
+	float operator[](const int32 Index) const
+	{
+		return Min + Values[Index] * Step;
+	}
+
+	bool IsValidIndex(const int32 Index) const
+	{
+		return Values.IsValidIndex(Index);
+	}
+
+	int32 Num() const
+	{
+		return Values.Num();
+	}
+
+	void Reset()
+	{
+		Values.Empty();
+		Min = 0.f;
+		Step = 0.f;
+	}
+
+	// Covers the range and the steps, so equal hashes mean equal decoded values
+	uint32 GetCrc32(uint32 Crc) const;
+
+	SIZE_T GetAllocatedSize() const
+	{
+		return Values.GetAllocatedSize();
+	}
+
+private:
+	TArray<uint16> Values;
+	float Min = 0.f;
+	float Step = 0.f;
+};
+
+/** A distance layer stored in 16 bits. INDEX_NONE stays INDEX_NONE, larger distances saturate. */
+struct POLYGONALMAPGENERATOR_API FIslandQuantizedDistanceLayer
+{
+	void Encode(TConstArrayView<int32> InValues);
+	void Decode(TArray<int32>& OutValues) const;
+
+	int32 operator[](const int32 Index) const
+	{
+		return Values[Index] == NoDistance ? INDEX_NONE : Values[Index];
+	}
+
+	bool IsValidIndex(const int32 Index) const
+	{
+		return Values.IsValidIndex(Index);
+	}
+
+	int32 Num() const
+	{
+		return Values.Num();
+	}
+
+	void Reset()
+	{
+		Values.Empty();
+	}
+
+	SIZE_T GetAllocatedSize() const
+	{
+		return Values.GetAllocatedSize();
+	}
+
+private:
+	static constexpr uint16 NoDistance = TNumericLimits<uint16>::Max();
+	TArray<uint16> Values;
+};
+
+/** The layers UIslandMapData::bQuantizeLayers keeps in 16 bits between generations. */
+struct POLYGONALMAPGENERATOR_API FIslandQuantizedLayers
+{
+	FIslandQuantizedFloatLayer r_elevation;
+	FIslandQuantizedDistanceLayer r_waterdistance;
+	FIslandQuantizedFloatLayer r_moisture;
+	FIslandQuantizedFloatLayer r_temperature;
+	FIslandQuantizedDistanceLayer t_coastdistance;
+	FIslandQuantizedFloatLayer t_elevation;
+
+	bool IsEmpty() const
+	{
+		return r_elevation.Num() == 0 && r_waterdistance.Num() == 0 && r_moisture.Num() == 0
+			&& r_temperature.Num() == 0 && t_coastdistance.Num() == 0 && t_elevation.Num() == 0;
+	}
+
+	void Reset()
+	{
+		r_elevation.Reset();
+		r_waterdistance.Reset();
+		r_moisture.Reset();
+		r_temperature.Reset();
+		t_coastdistance.Reset();
+		t_elevation.Reset();
+	}
+
+	SIZE_T GetAllocatedSize() const
+	{
+		return r_elevation.GetAllocatedSize() + r_waterdistance.GetAllocatedSize() + r_moisture.GetAllocatedSize()
+			+ r_temperature.GetAllocatedSize() + t_coastdistance.GetAllocatedSize() + t_elevation.GetAllocatedSize();
+	}
+};
+
+/** Full precision copies of FIslandQuantizedLayers, each layer decoded when it is first read. */
+struct POLYGONALMAPGENERATOR_API FIslandDecodedLayers
+{
+	TArray<float> r_elevation;
+	TArray<int32> r_waterdistance;
+	TArray<float> r_moisture;
+	TArray<float> r_temperature;
+	TArray<int32> t_coastdistance;
+	TArray<float> t_elevation;
+
+	void Reset()
+	{
+		r_elevation.Empty();
+		r_waterdistance.Empty();
+		r_moisture.Empty();
+		r_temperature.Empty();
+		t_coastdistance.Empty();
+		t_elevation.Empty();
+	}
+
+	SIZE_T GetAllocatedSize() const
+	{
+		return r_elevation.GetAllocatedSize() + r_waterdistance.GetAllocatedSize() + r_moisture.GetAllocatedSize()
+			+ r_temperature.GetAllocatedSize() + t_coastdistance.GetAllocatedSize() + t_elevation.GetAllocatedSize();
+	}
+};
@@ -0,0 +1,84 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Kismet/BlueprintFunctionLibrary.h"
+#include "IslandRasterExport.generated.h"
+
+class UIslandMapData;
+
+UENUM(BlueprintType)
+enum class EIslandRasterLayer : uint8
+{
+	IRL_Elevation UMETA(DisplayName="Elevation"),
+	IRL_Moisture UMETA(DisplayName="Moisture"),
+	/** The biome palette index of every pixel. */
+	IRL_Biome UMETA(DisplayName="Biome"),
+	/** The district index plus one, 0 outside of every district. */
+	IRL_District UMETA(DisplayName="District"),
+	/** Signed distance to the coastline, negative on land. */
+	IRL_CoastDistance UMETA(DisplayName="Coast Distance"),
+};
+
+UENUM(BlueprintType)
+enum class EIslandRasterFormat : uint8
+{
+	/** One 32 bit float channel, the values are written as they are. */
+	IRF_EXR UMETA(DisplayName="EXR"),
+	/** Raw little endian 16 bit values, as the landscape importer reads them. */
+	IRF_R16 UMETA(DisplayName="R16"),
+	/** 16 bit grayscale. */
+	IRF_PNG UMETA(DisplayName="PNG"),
+};
+
+USTRUCT(BlueprintType)
+struct POLYGONALMAPGENERATOR_API FIslandRasterExportOptions
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Export")
+	EIslandRasterLayer Layer = EIslandRasterLayer::IRL_Elevation;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Export")
+	EIslandRasterFormat Format = EIslandRasterFormat::IRF_R16;
+
+	/**
+	 * Pixels along each side. The first and last pixel sit on the map border, like landscape vertices, so a size
+	 * the landscape supports (e.g. 2017 or 8129) imports without resampling.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Export", meta = ( ClampMin = 2 ))
+	int32 Width = 2017;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Export", meta = ( ClampMin = 2 ))
+	int32 Height = 2017;
+
+	/** The elevation or moisture mapped to 0 and 65535 in the 16 bit formats. Ocean elevations are negative. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Export")
+	float RangeMin = -1.f;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Export")
+	float RangeMax = 1.f;
+
+	/** Coast distances are clamped to this in map units, the 16 bit formats map -MaxCoastDistance to 0. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Export", meta = ( ClampMin = 1 ))
+	float MaxCoastDistance = 5000.f;
+
+	/** Rows sampled in parallel and written at once, the only pixels held in memory. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Export", meta = ( ClampMin = 1 ))
+	int32 RowsPerBand = 64;
+};
+
+/**
+ * Writes the layers of the last finished generation as images for external tools and landscape heightmaps.
+ * Rows are sampled band by band and written as they are done, so memory does not grow with the image size.
+ */
+UCLASS()
+class POLYGONALMAPGENERATOR_API UIslandRasterExport : public UBlueprintFunctionLibrary
+{
+	GENERATED_BODY()
+
+public:
+	/** Same rules as UIslandMapData::GetMapQuery, do not call it while the map generates. */
+	UFUNCTION(BlueprintCallable, Category = "Procedural Generation|Island Generation|Export")
+	static bool ExportLayer(const UIslandMapData* MapData, const FString& Filename,
+	                        const FIslandRasterExportOptions& Options);
+};
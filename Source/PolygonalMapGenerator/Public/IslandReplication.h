@@ -0,0 +1,64 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "IslandMapUtils.h"
+#include "IslandReplication.generated.h"
+
+/**
+ * What a client needs to generate the island of the server on its own, a few bytes instead of the layers.
+ * The generation settings themselves are not sent: they come from the same assets on both sides, and the
+ * fingerprint tells whether they match. The content hash then tells whether the pipeline produced the same island.
+ */
+USTRUCT(BlueprintType)
+struct POLYGONALMAPGENERATOR_API FIslandReplicationState
+{
+	GENERATED_BODY()
+
+	// The seeds as the server generated with them, after bDetermineRandomSeedAtRuntime picked them
+	UPROPERTY(BlueprintReadOnly, Category = "Replication")
+	int32 Seed = 0;
+	UPROPERTY(BlueprintReadOnly, Category = "Replication")
+	int32 DrainageSeed = 0;
+	UPROPERTY(BlueprintReadOnly, Category = "Replication")
+	int32 RiverSeed = 0;
+	UPROPERTY(BlueprintReadOnly, Category = "Replication")
+	int32 DistrictSeed = 0;
+	// UIslandMapData::GetGenerationFingerprint, covers the seeds and every stage setting
+	UPROPERTY(BlueprintReadOnly, Category = "Replication")
+	uint32 GenerationFingerprint = 0;
+	// UIslandMapData::ComputeContentHash, before any region patch
+	UPROPERTY(BlueprintReadOnly, Category = "Replication")
+	uint32 ContentHash = 0;
+
+	bool IsValid() const
+	{
+		return GenerationFingerprint != 0;
+	}
+};
+
+/**
+ * An edit of the layers of consecutive regions after the generation, starting at FirstRegion.
+ * Each array holds one value per patched region, or nothing to leave that layer alone.
+ */
+USTRUCT(BlueprintType)
+struct POLYGONALMAPGENERATOR_API FIslandRegionPatch
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadWrite, Category = "Replication")
+	int32 FirstRegion = 0;
+	UPROPERTY(BlueprintReadWrite, Category = "Replication")
+	TArray<float> Elevations;
+	UPROPERTY(BlueprintReadWrite, Category = "Replication")
+	TArray<ERegionFlags> Flags;
+	// Indices into the biome palette
+	UPROPERTY(BlueprintReadWrite, Category = "Replication")
+	TArray<uint8> Biomes;
+	UPROPERTY(BlueprintReadWrite, Category = "Replication")
+	TArray<int32> Districts;
+
+	// The number of patched regions, 0 if the layers disagree
+	int32 Num() const;
+};
@@ -0,0 +1,63 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "TriangleDualMesh.h"
+
+/**
+ * The Voronoi polygons of the solid regions of a mesh, without copying their corners or biomes.
+ * The corners of a region are triangle indices in circulation order, placed at UTriangleDualMesh::t_pos.
+ * Reads the adjacency rows of the mesh when it has them, otherwise keeps one offset per region and one index per
+ * corner. Only valid as long as the mesh is not regenerated.
+ */
+struct POLYGONALMAPGENERATOR_API FIslandVoronoiView
+{
+	void Build(const UTriangleDualMesh* InMesh);
+
+	void Reset();
+
+	bool IsEmpty() const
+	{
+		return Mesh == nullptr;
+	}
+
+	const UTriangleDualMesh* GetMesh() const
+	{
+		return Mesh;
+	}
+
+	// Number of polygons, one per solid region
+	int32 Num() const
+	{
+		return NumPolygons;
+	}
+
+	TArrayView<const FTriangleIndex> GetCorners(const FPointIndex Region) const
+	{
+		check(static_cast<int32>(Region) < NumPolygons);
+		if (Offsets.IsEmpty())
+		{
+			return Mesh->r_adjacent_t(Region);
+		}
+		return TArrayView<const FTriangleIndex>(Corners.GetData() + Offsets[Region],
+		                                        Offsets[Region + 1] - Offsets[Region]);
+	}
+
+	FVector2D GetCornerPosition(const FTriangleIndex Corner) const
+	{
+		return Mesh->t_pos(Corner);
+	}
+
+	SIZE_T GetAllocatedSize() const
+	{
+		return Offsets.GetAllocatedSize() + Corners.GetAllocatedSize();
+	}
+
+private:
+	const UTriangleDualMesh* Mesh = nullptr;
+	int32 NumPolygons = 0;
+	// Empty when the mesh adjacency is read instead
+	TArray<int32> Offsets;
+	TArray<FTriangleIndex> Corners;
+};
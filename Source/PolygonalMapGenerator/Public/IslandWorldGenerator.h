@@ -0,0 +1,110 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "IslandBatchGenerator.h"
+#include "IslandMapData.h"
+#include "IslandWorldGenerator.generated.h"
+
+USTRUCT(BlueprintType)
+struct POLYGONALMAPGENERATOR_API FIslandWorldChunk
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "World")
+	FIntPoint Coordinates = FIntPoint::ZeroValue;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "World")
+	TObjectPtr<UIslandMapData> MapData = nullptr;
+	// False while the chunk is generating
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "World")
+	bool bGenerated = false;
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnIslandChunkGenerated, FIntPoint, Chunk, UIslandMapData*, MapData);
+
+/**
+ * An endless ocean of islands, one UIslandMapData per chunk of a world grid. Every chunk is as large as the map of
+ * the template's point generator and has its chunk coordinates times that size as its world origin.
+ * Chunks are generated on demand on the task graph, side by side, from copies of the template whose layers are
+ * reused once the chunk is released, so memory follows the loaded chunks instead of the world size.
+ * The seeds of a chunk only depend on WorldSeed and its coordinates, so a chunk comes out the same whenever and in
+ * whichever order it is loaded. Water generators always make the boundary regions ocean, so neighboring chunks
+ * meet in open water and need nothing from each other.
+ */
+UCLASS(BlueprintType)
+class POLYGONALMAPGENERATOR_API UIslandWorldGenerator : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "World", meta = (NoSpinbox))
+	int32 WorldSeed = 0;
+	// Released chunks whose map data is kept for the next chunk, so streaming does not reallocate the layers.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "World", meta = (ClampMin = "0"))
+	int32 MaxPooledChunks = 4;
+
+	// Broadcast on the game thread once a requested chunk is generated.
+	UPROPERTY(BlueprintAssignable, Category = "World")
+	FOnIslandChunkGenerated OnChunkGenerated;
+
+	// Releases every chunk and generates the next ones from InTemplate, whose class and generators have to be native.
+	UFUNCTION(BlueprintCallable, Category = "World")
+	bool SetTemplate(UIslandMapData* InTemplate);
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "World")
+	FVector2D GetChunkSize() const;
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "World")
+	FVector2D GetChunkOrigin(FIntPoint Chunk) const;
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "World")
+	FIntPoint WorldToChunk(const FVector2D& WorldPosition) const;
+
+	// Starts generating the chunk unless it is loaded already. Game thread only.
+	UFUNCTION(BlueprintCallable, Category = "World")
+	bool RequestChunk(FIntPoint Chunk);
+	// Unloads the chunk, a running generation finishes first.
+	UFUNCTION(BlueprintCallable, Category = "World")
+	void ReleaseChunk(FIntPoint Chunk);
+	UFUNCTION(BlueprintCallable, Category = "World")
+	void ReleaseAllChunks();
+	// Requests every chunk touching the circle and releases all others.
+	UFUNCTION(BlueprintCallable, Category = "World")
+	void UpdateLoadedChunks(const FVector2D& WorldCenter, double Radius);
+
+	// The map data of a generated chunk, nullptr while it is not loaded or still generating.
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "World")
+	UIslandMapData* GetChunkMapData(FIntPoint Chunk) const;
+	// The generated chunk containing WorldPosition and the position inside of its map.
+	UFUNCTION(BlueprintCallable, Category = "World")
+	UIslandMapData* FindMapDataAt(const FVector2D& WorldPosition, FVector2D& OutLocalPosition) const;
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "World")
+	int32 GetLoadedChunkNum() const
+	{
+		return Chunks.Num();
+	}
+
+	// The seeds a chunk of a world generates with.
+	static FIslandBatchCandidate GetChunkSeeds(int32 Seed, FIntPoint Chunk);
+
+	virtual void BeginDestroy() override;
+
+protected:
+	UIslandMapData* AcquireMapData();
+	void RecycleMapData(UIslandMapData* MapData);
+	void OnChunkTaskComplete(FIntPoint Chunk, UIslandMapData* MapData, bool bStagesRan, uint64 CacheKey);
+
+	UPROPERTY(Transient)
+	TObjectPtr<UIslandMapData> Template;
+	UPROPERTY(Transient)
+	TMap<FIntPoint, FIslandWorldChunk> Chunks;
+	// Released while they were generating, recycled once their task is done
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UIslandMapData>> RetiringMapData;
+	// Released while generating from a previous template, dropped once their task is done
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UIslandMapData>> StaleMapData;
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UIslandMapData>> PooledMapData;
+	// Chunk generations that may still run, the workers write into map data this object keeps alive
+	FGraphEventArray ChunkTasks;
+};
@@ -0,0 +1,47 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Mesh/IslandMeshBuilder.h"
+#include "IslandGridMeshBuilder.generated.h"
+
+UENUM(BlueprintType)
+enum class EIslandGridShape : uint8
+{
+	IGS_Square UMETA(DisplayName="Square"),
+	/** Odd rows shifted by half a column, every region has six neighbors. */
+	IGS_Hex UMETA(DisplayName="Hex"),
+};
+
+/**
+ * Regular grid builder that lays out the triangles directly instead of triangulating points, see
+ * UDualMeshBuilder::CreateGrid. Much faster to generate than the point builders; BoundarySpacing is not used,
+ * the outer ring of the grid is the boundary.
+ */
+UCLASS()
+class POLYGONALMAPGENERATOR_API UIslandGridMeshBuilder : public UIslandMeshBuilder
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Points")
+	EIslandGridShape Shape;
+	// Roughly, the columns and rows are rounded to fit the map.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Points", meta = (ClampMin = "4"))
+	int32 NumberOfPoints;
+
+public:
+	UIslandGridMeshBuilder();
+
+	virtual bool GenerateDualMeshInto(UDualMeshBuilder* Builder, UTriangleDualMesh* Mesh, FRandomStream& Rng) const override;
+	virtual int32 EstimateRegionNum() const override;
+	virtual bool ScaleRegionNum(float Scale) override;
+
+	// Hex rows are closer together than the columns, so their triangles come out equilateral.
+	void GetGridSize(int32& OutColumns, int32& OutRows) const;
+
+protected:
+	virtual void AddPoints_Implementation(UDualMeshBuilder* Builder, FRandomStream& Rng) const override;
+	virtual UTriangleDualMesh* GenerateDualMesh_Implementation(FRandomStream& Rng) const override;
+};
@@ -40,6 +40,14 @@ public:
 	// The amount of spacing on the edge of the map.
 	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Edges", meta = (ClampMin = "0"))
 	int32 BoundarySpacing;
+	// Numbers the regions and triangles along a Hilbert curve so neighbors sit close together in every layer.
+	// Speeds up the passes over large maps, but the same seed then lays the island out differently.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Mesh")
+	bool bSortSpatially;
+	// Automatic keeps the Delaunator for small maps and triangulates large ones on all cores.
+	// Only changes which triangles cocircular points get and the order of the triangles.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Mesh")
+	EDelaunayTriangulator Triangulator;
 
 public:
 	UIslandMeshBuilder();
@@ -53,4 +61,15 @@ protected:
 public:
 	UFUNCTION(BlueprintCallable, BlueprintNativeEvent, Category = "Procedural Generation|Island Generation|Points")
 	UTriangleDualMesh* GenerateDualMesh(UPARAM(ref) FRandomStream& Rng) const;
+
+	// GenerateDualMesh into existing objects, native point generators only. Safe to call from any thread.
+	virtual bool GenerateDualMeshInto(UDualMeshBuilder* Builder, UTriangleDualMesh* Mesh, FRandomStream& Rng) const;
+
+	// Regions GenerateDualMesh is expected to create, boundary included. 0 if the builder cannot tell.
+	virtual int32 EstimateRegionNum() const;
+	// Changes the settings so about Scale times as many regions are created. False if the builder cannot scale.
+	virtual bool ScaleRegionNum(float Scale);
+
+protected:
+	int32 EstimateBoundaryRegionNum() const;
 };
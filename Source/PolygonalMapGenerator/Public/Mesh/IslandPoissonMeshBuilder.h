@@ -43,6 +43,9 @@ public:
 public:
 	UIslandPoissonMeshBuilder();
 
+	virtual int32 EstimateRegionNum() const override;
+	virtual bool ScaleRegionNum(float Scale) override;
+
 protected:
 	virtual void AddPoints_Implementation(UDualMeshBuilder* Builder, FRandomStream& Rng) const override;
 };
@@ -37,6 +37,9 @@ public:
 public:
 	UIslandSquareMeshBuilder();
 
+	virtual int32 EstimateRegionNum() const override;
+	virtual bool ScaleRegionNum(float Scale) override;
+
 protected:
 	virtual void AddPoints_Implementation(UDualMeshBuilder* Builder, FRandomStream& Rng) const override;
 };
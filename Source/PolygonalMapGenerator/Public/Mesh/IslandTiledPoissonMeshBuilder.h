@@ -0,0 +1,27 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Mesh/IslandPoissonMeshBuilder.h"
+#include "IslandTiledPoissonMeshBuilder.generated.h"
+
+/**
+ * Poisson mesh builder that fills tiles of the map on all cores, meant for maps with very many regions.
+ * The points depend on the seed and the tile size, not on the number of threads.
+ */
+UCLASS()
+class POLYGONALMAPGENERATOR_API UIslandTiledPoissonMeshBuilder : public UIslandPoissonMeshBuilder
+{
+	GENERATED_BODY()
+public:
+	// Width of a tile in sampling cells, each PoissonSpacing / sqrt(2) wide. Changing it changes the points.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Points", meta = (ClampMin = "4"))
+	int32 TileCells;
+
+public:
+	UIslandTiledPoissonMeshBuilder();
+
+protected:
+	virtual void AddPoints_Implementation(UDualMeshBuilder* Builder, FRandomStream& Rng) const override;
+};
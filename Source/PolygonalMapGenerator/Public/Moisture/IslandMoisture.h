@@ -23,6 +23,8 @@
 
 #include "DualMesh/Public/TriangleDualMesh.h"
 
+#include "IslandMapUtils.h"
+
 #include "IslandMoisture.generated.h"
 
 /**
@@ -38,6 +40,13 @@ protected:
 	virtual TSet<FPointIndex> FindRiverbanks(UTriangleDualMesh* Mesh, const TArray<int32>& s_flow) const;
 	UFUNCTION(BlueprintPure, BlueprintCallable, Category = "Procedural Generation|Island Generation|Moisture")
 	virtual TSet<FPointIndex> FindLakeshores(UTriangleDualMesh* Mesh, const TArray<bool>& r_ocean, const TArray<bool>& r_water) const;
+	// Same regions from the packed flags of UIslandMapData::GetRegionFlags
+	TSet<FPointIndex> FindLakeshores(UTriangleDualMesh* Mesh, TConstArrayView<ERegionFlags> r_flags) const;
+
+	// Flags every riverbank and lakeshore region in r_seed, the same regions FindMoistureSeeds returns.
+	virtual void FindMoistureSeedRegions(TArray<uint8>& r_seed, UTriangleDualMesh* Mesh, const TArray<int32>& s_flow, const TArray<bool>& r_ocean, const TArray<bool>& r_water) const;
+	// Breadth-first water distance from all flagged regions at once, then moisture from that distance.
+	void AssignMoistureFromSeeds(TArray<float>& r_moisture, TArray<int32>& r_waterdistance, UTriangleDualMesh* Mesh, const TArray<bool>& r_water, const TArray<uint8>& r_seed) const;
 
 	virtual TSet<FPointIndex> FindMoistureSeeds_Implementation(UTriangleDualMesh* Mesh, const TArray<int32>& s_flow, const TArray<bool>& r_ocean, const TArray<bool>& r_water) const;
 	virtual void AssignRegionMoisture_Implementation(TArray<float>& r_moisture, TArray<int32>& r_waterdistance, UTriangleDualMesh* Mesh, const TArray<bool>& r_water, const TSet<FPointIndex>& r_moisture_seeds) const;
@@ -53,5 +62,7 @@ public:
 	
 	TSet<FPointIndex> find_moisture_seeds_r(UTriangleDualMesh* Mesh, const TArray<int32>& s_flow, const TArray<bool>& r_ocean, const TArray<bool>& r_water) const;
 	void assign_r_moisture(TArray<float>& r_moisture, TArray<int32>& r_waterdistance, UTriangleDualMesh* Mesh, const TArray<bool>& r_water, const TSet<FPointIndex>& r_moisture_seeds) const;
+	// find_moisture_seeds_r followed by the assign_r_moisture above.
+	void assign_r_moisture(TArray<float>& r_moisture, TArray<int32>& r_waterdistance, UTriangleDualMesh* Mesh, const TArray<int32>& s_flow, const TArray<bool>& r_ocean, const TArray<bool>& r_water) const;
 	void redistribute_r_moisture(TArray<float>& r_moisture, UTriangleDualMesh* Mesh, const TArray<bool>& r_water, float MinMoisture, float MaxMoisture) const;
 };
@@ -26,6 +26,9 @@ public:
 	virtual FBox GetStrictBounds() const override;
 	virtual bool SamplePoint(const FTransform& Transform, const FBox& Bounds, FPCGPoint& OutPoint,
 	                         UPCGMetadata* OutMetadata) const override;
+	/** SamplePoint for a whole range, points outside the texture get a density of 0. */
+	virtual void SamplePoints(const TArrayView<const TPair<FTransform, FBox>>& Samples,
+	                          const TArrayView<FPCGPoint>& OutPoints, UPCGMetadata* OutMetadata) const override;
 	//~End UPCGSpatialData interface
 
 	//~Begin UPCGSpatialDataWithPointCache interface
@@ -34,6 +37,20 @@ public:
 
 	virtual bool IsValid() const;
 
+	/**
+	 * Samples the texel grid once and buckets every point into the point data of its district, OutData[Index] being
+	 * district InDistrictIDs[Index]. With the Ignore density function every output gets every point.
+	 */
+	static void CreateDistrictPointData(const FIDTextueData& InTextureData, const FIDTextueMipChain* InMipChain,
+	                                    const FTransform& InTransform,
+	                                    EPCGIDTextureDensityFunction InDensityFunction, float InTexelSize,
+	                                    EPCGIDTextureFilter InFilter, TConstArrayView<int32> InDistrictIDs,
+	                                    TArrayView<UPCGPointData* const> OutData);
+
+	/** The level of the mip chain closest to one texel per sample of the TexelSize grid, or the data itself. */
+	static const FIDTextueData& SelectLevel(const FIDTextueData& InTextureData, const FIDTextueMipChain* InMipChain,
+	                                        const FTransform& InTransform, float InTexelSize);
+
 public:
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere, Category = SpatialData)
 	int32 PrimaryID;
@@ -45,9 +62,14 @@ public:
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (UIMin = "1.0", ClampMin = "1.0"))
 	float TexelSize = 50.0f;
 
+	UPROPERTY(BlueprintReadWrite, VisibleAnywhere, Category = SpatialData)
+	EPCGIDTextureFilter Filter = EPCGIDTextureFilter::Nearest;
+
 protected:
 
-	TSharedPtr<FIDTextueData, ESPMode::ThreadSafe> TextureData;
+	TSharedPtr<const FIDTextueData, ESPMode::ThreadSafe> TextureData;
+	// Only set when sampling prefiltered levels
+	TSharedPtr<const FIDTextueMipChain, ESPMode::ThreadSafe> MipChain;
 
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere, Category = SpatialData)
 	FBox Bounds = FBox(EForceInit::ForceInit);
@@ -65,7 +87,13 @@ public:
 	virtual EPCGDataType GetDataType() const override { return EPCGDataType::Texture; }
 	// ~End UPCGData interface
 
-	void Initialize(const TSharedPtr<FIDTextueData, ESPMode::ThreadSafe>& InTextureData, const FTransform& InTransform);
+	void Initialize(const TSharedPtr<const FIDTextueData, ESPMode::ThreadSafe>& InTextureData,
+	                const FTransform& InTransform);
+
+	void SetMipChain(const TSharedPtr<const FIDTextueMipChain, ESPMode::ThreadSafe>& InMipChain)
+	{
+		MipChain = InMipChain;
+	}
 
 	/** Returns true if the format of InTexture is compatible and can be loaded. Will load texture if not already loaded. */
 	static bool IsSupported(UTexture2D* InTexture);
@@ -5,52 +5,36 @@
 #include "CoreMinimal.h"
 #include "PCGSettings.h"
 #include "PCGPin.h"
+#include "District/DistrictIDData.h"
 
 #include "PCGIDTextureSampler.generated.h"
 
+class UIslandDynamicAssets;
+
 UENUM(BlueprintType)
 enum class EPCGIDTextureDensityFunction : uint8
 {
 	Ignore,
 	Multiply
 };
-struct FPixelData
-{
-	int32 DistrictID1;
-	float Proportion1;
-	int32 DistrictID2;
-	float Proportion2;
-	int32 DistrictID3;
-	float Proportion3;
-	int32 DistrictID4;
-	float Proportion4;
-};
 
-struct FIDTextueData
+UENUM(BlueprintType)
+enum class EPCGIDTextureFilter : uint8
 {
-	int32 Width;
-	int32 Height;
-	TArray<FPixelData> Data;
+	Nearest,
+	// Blends the district proportions of the four closest texels
+	Bilinear
 };
 
 namespace IDTextureFixedName
 {
-const FName OutNameDistrict1 = FName(TEXT("District1"));
-const FName OutNameDistrict2 = FName(TEXT("District2"));
-const FName OutNameDistrict3 = FName(TEXT("District3"));
-const FName OutNameDistrict4 = FName(TEXT("District4"));
-const FName OutNameDistrict5 = FName(TEXT("District5"));
-const FName OutNameDistrict6 = FName(TEXT("District6"));
-const FName OutNameDistrict7 = FName(TEXT("District7"));
-const FName OutNameDistrict8 = FName(TEXT("District8"));
-const FName OutNameDistrict9 = FName(TEXT("District9"));
-const FName OutNameDistrict10 = FName(TEXT("District10"));
-const FName OutNameDistrict11 = FName(TEXT("District11"));
-const FName OutNameDistrict12 = FName(TEXT("District12"));
-const FName OutNameDistrict13 = FName(TEXT("District13"));
-const FName OutNameDistrict14 = FName(TEXT("District14"));
-const FName OutNameDistrict15 = FName(TEXT("District15"));
-const FName OutNameDistrict16 = FName(TEXT("District16"));
+const FName OutNameDistricts = FName(TEXT("Districts"));
+
+// The pin of one district, and its tag on the Districts pin
+inline FName GetDistrictName(const int32 DistrictID)
+{
+	return FName(FString::Printf(TEXT("District%d"), DistrictID));
+}
 
 const FName DataAttrPrimaryID = FName(TEXT("PrimaryID"));
 const FName DataAttrDistrictID1 = FName(TEXT("DistrictID1"));
@@ -97,6 +81,10 @@ public:
 	
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (PCG_Overridable))
 	UTexture2D* IDTexture2 = nullptr;
+
+	// Samples the district ID textures of these assets instead of IDTexture1 and IDTexture2
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (PCG_Overridable))
+	TObjectPtr<UIslandDynamicAssets> DynamicAssets = nullptr;
 	
 	// Common members in BaseTextureData
 	UPROPERTY(BlueprintReadWrite, VisibleAnywhere, Category = SpatialData, meta = (PCG_Overridable))
@@ -105,6 +93,28 @@ public:
 	/** The size of one texel in cm, used when calling ToPointData. */
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (UIMin = "1.0", ClampMin = "1.0", PCG_Overridable))
 	float TexelSize = 50.0f;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (PCG_Overridable))
+	EPCGIDTextureFilter Filter = EPCGIDTextureFilter::Nearest;
+
+	// Samples a prefiltered level of the ID data that matches TexelSize instead of the full resolution data
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (PCG_Overridable))
+	bool bUseMipChain = false;
+
+	// Outputs point data, sampled for all districts in one pass over the texel grid, instead of one texture data per
+	// district that every consumer samples on its own
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings)
+	bool bSinglePassPointData = false;
+
+	// Outputs one data per district found in the textures on the single Districts pin, tagged District1 and so on,
+	// instead of one pin per district
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings)
+	bool bDynamicDistrictOutputs = false;
+
+	// The pins District1 to DistrictN, without bDynamicDistrictOutputs
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings,
+		meta = (ClampMin = "1", ClampMax = "255", EditCondition = "!bDynamicDistrictOutputs"))
+	int32 DistrictPinNum = 16;
 };
 
 class FPCGIDTextureSamplerElement : public IPCGElement
@@ -114,7 +124,4 @@ public:
 
 protected:
 	virtual bool ExecuteInternal(FPCGContext* Context) const override;
-
-public:
-	static TSharedRef<FIDTextueData> CreateOriginalIDTextureData(const UTexture2D* Texture1, const UTexture2D* Texture2);
 };
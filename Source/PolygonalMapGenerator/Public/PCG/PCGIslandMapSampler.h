@@ -0,0 +1,101 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PCGSettings.h"
+#include "PCGPin.h"
+
+#include "PCGIslandMapSampler.generated.h"
+
+class UIslandMapData;
+
+UENUM(BlueprintType)
+enum class EPCGIslandMapSampleMode : uint8
+{
+	// One point per cell of a PointSpacing grid over the surface
+	Grid,
+	// One point at the center of every solid region
+	RegionCenters
+};
+
+namespace IslandMapFixedName
+{
+const FName DataAttrRegion = FName(TEXT("Region"));
+const FName DataAttrDistrictID = FName(TEXT("DistrictID"));
+const FName DataAttrBiomeIndex = FName(TEXT("BiomeIndex"));
+const FName DataAttrBiomeTag = FName(TEXT("BiomeTag"));
+const FName DataAttrElevation = FName(TEXT("Elevation"));
+const FName DataAttrMoisture = FName(TEXT("Moisture"));
+const FName DataAttrCoastDistance = FName(TEXT("CoastDistance"));
+}
+
+/**
+ * Samples the layers of generated map data straight into points, without the district ID textures.
+ * Every point takes the values of the region closest to it. DistrictID uses the numbering of the ID textures,
+ * district + 1 and 0 outside of every district.
+ */
+UCLASS(BlueprintType, ClassGroup = (Procedural))
+class POLYGONALMAPGENERATOR_API UPCGIslandMapSamplerSettings : public UPCGSettings
+{
+	GENERATED_BODY()
+
+public:
+	//~Begin UPCGSettings interface
+#if WITH_EDITOR
+	virtual FName GetDefaultNodeName() const override { return FName(TEXT("GetIslandMapData")); }
+	virtual FText GetDefaultNodeTitle() const override { return NSLOCTEXT("PCGIslandMapSamplerSettings", "NodeTitle", "Get Island Map Data"); }
+	virtual EPCGSettingsType GetType() const override { return EPCGSettingsType::Spatial; }
+#endif
+
+protected:
+	virtual TArray<FPCGPinProperties> InputPinProperties() const override { return TArray<FPCGPinProperties>(); }
+	virtual TArray<FPCGPinProperties> OutputPinProperties() const override;
+	virtual FPCGElementPtr CreateElement() const override;
+	//~End UPCGSettings interface
+
+public:
+	// Sampled through its snapshots, so it needs bPublishSnapshots
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (PCG_Overridable))
+	TObjectPtr<UIslandMapData> MapData = nullptr;
+
+	// Surface transform, the map covers -1 to 1 on X and Y like the ID texture sampler
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (PCG_Overridable))
+	FTransform Transform = FTransform::Identity;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (PCG_Overridable))
+	bool bUseAbsoluteTransform = false;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (PCG_Overridable))
+	EPCGIslandMapSampleMode SampleMode = EPCGIslandMapSampleMode::Grid;
+
+	/** The distance between two grid points in cm. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings,
+		meta = (UIMin = "1.0", ClampMin = "1.0", PCG_Overridable,
+			EditCondition = "SampleMode == EPCGIslandMapSampleMode::Grid"))
+	float PointSpacing = 50.0f;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (PCG_Overridable))
+	bool bExcludeOcean = true;
+
+	// Lakes as well as the ocean
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (PCG_Overridable))
+	bool bExcludeWater = false;
+
+	// District IDs to keep, all points are kept when empty
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (PCG_Overridable))
+	TArray<int32> DistrictIDs;
+
+	// Coast distances are clamped to this, in map units
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Settings, meta = (ClampMin = "0.0", PCG_Overridable))
+	float MaxCoastDistance = 500.0f;
+};
+
+class FPCGIslandMapSamplerElement : public IPCGElement
+{
+public:
+	virtual void GetDependenciesCrc(const FPCGDataCollection& InInput, const UPCGSettings* InSettings, UPCGComponent* InComponent, FPCGCrc& OutCrc) const override;
+
+protected:
+	virtual bool ExecuteInternal(FPCGContext* Context) const override;
+};
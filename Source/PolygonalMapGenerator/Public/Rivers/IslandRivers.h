@@ -25,6 +25,7 @@
 #include "DualMesh/Public/TriangleDualMesh.h"
 
 #include "IslandMapUtils.h"
+#include "Rivers/RiverNetwork.h"
 
 #include "IslandRivers.generated.h"
 
@@ -42,6 +43,13 @@ public:
 	float MinSpringElevation;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0.0", ClampMax = "1.0"))
 	float MaxSpringElevation;
+	// Accumulate the drainage of every land triangle down the slopes and start rivers wherever it reaches
+	// MinRiverDrainage, instead of picking random springs. The number of rivers is then up to the terrain.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Drainage")
+	bool bUseFlowAccumulation;
+	// How many land triangles have to drain through a triangle before it carries a river.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Drainage", meta = (ClampMin = "1", EditCondition = "bUseFlowAccumulation"))
+	int32 MinRiverDrainage;
 
 public:
 	UIslandRivers();
@@ -53,7 +61,7 @@ protected:
 	UFUNCTION(BlueprintPure, BlueprintCallable, Category = "Procedural Generation|Island Generation|Rivers")
 	virtual bool IsTriangleWater(FTriangleIndex t, UTriangleDualMesh* Mesh, const TArray<bool>& WaterRegions) const;
 	UFUNCTION(BlueprintCallable, Category = "Procedural Generation|Island Generation|Rivers")
-	virtual TArray<URiver*> CreateRiver(FTriangleIndex RiverTriangle, TArray<int32> &s_flow, TMap<FTriangleIndex, URiver*> RiverMap, UTriangleDualMesh* Mesh, const TArray<FSideIndex>& t_downslope_s, FRandomStream& RiverRng) const;
+	virtual TArray<URiver*> CreateRiver(FTriangleIndex RiverTriangle, TArray<int32> &s_flow, UPARAM(ref) TMap<FTriangleIndex, URiver*>& RiverMap, UTriangleDualMesh* Mesh, const TArray<FSideIndex>& t_downslope_s, FRandomStream& RiverRng) const;
 
 	virtual TArray<FTriangleIndex> FindSpringTriangles_Implementation(UTriangleDualMesh* Mesh, const TArray<bool>& r_water, const TArray<float>& t_elevation, const TArray<FSideIndex>& t_downslope_s) const;
 	virtual void AssignSideFlow_Implementation(TArray<int32>& s_flow, TArray<URiver*>& Rivers, UTriangleDualMesh* Mesh, const TArray<FSideIndex>& t_downslope_s, const TArray<FTriangleIndex>& river_t, FRandomStream& RiverRNG) const;
@@ -69,6 +77,21 @@ public:
 	UFUNCTION(BlueprintCallable, BlueprintNativeEvent, Category = "Procedural Generation|Island Generation|Rivers")
 	void AssignSideFlow(UPARAM(ref) TArray<int32>& SideFlow, UPARAM(ref) TArray<URiver*>& Rivers, UTriangleDualMesh* Mesh, const TArray<FSideIndex>& TriangleSideDownslopes, const TArray<FTriangleIndex>& RiverTriangles, UPARAM(ref) FRandomStream& RiverRNG) const;
 
+	/**
+	* Number of land triangles draining through each triangle, itself included.
+	* Every triangle is visited once, after everything upstream of it.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "Procedural Generation|Island Generation|Rivers")
+	virtual void AccumulateFlow(UPARAM(ref) TArray<int32>& TriangleFlow, UTriangleDualMesh* Mesh, const TArray<bool>& WaterRegions, const TArray<FSideIndex>& TriangleSideDownslopes) const;
+	// Land triangles carrying at least MinRiverDrainage where no upstream triangle does, in index order.
+	UFUNCTION(BlueprintCallable, Category = "Procedural Generation|Island Generation|Rivers")
+	virtual TArray<FTriangleIndex> FindDrainageSprings(UTriangleDualMesh* Mesh, const TArray<bool>& WaterRegions, const TArray<int32>& TriangleFlow, const TArray<FSideIndex>& TriangleSideDownslopes) const;
+
+	// Native entry point of the river stage. Traces the network directly and never creates UObjects,
+	// unless AssignSideFlow is overridden in Blueprint, in which case its rivers are converted.
+	virtual void AssignRiverNetwork(TArray<int32>& s_flow, FRiverNetwork& Network, UTriangleDualMesh* Mesh, const TArray<FSideIndex>& t_downslope_s, const TArray<FTriangleIndex>& river_t, FRandomStream& RiverRNG) const;
+
 	TArray<FTriangleIndex> find_spring_t(UTriangleDualMesh* Mesh, const TArray<bool>& r_water, const TArray<float>& t_elevation, const TArray<FSideIndex>& t_downslope_s) const;
 	void assign_s_flow(TArray<int32>& s_flow, TArray<URiver*>& Rivers, UTriangleDualMesh* Mesh, const TArray<FSideIndex>& t_downslope_s, const TArray<FTriangleIndex>& river_t, FRandomStream& RiverRNG) const;
+	void assign_s_flow(TArray<int32>& s_flow, FRiverNetwork& Network, UTriangleDualMesh* Mesh, const TArray<FSideIndex>& t_downslope_s, const TArray<FTriangleIndex>& river_t, FRandomStream& RiverRNG) const;
 };
@@ -0,0 +1,67 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "DualMesh/Public/TriangleDualMesh.h"
+
+#include "RiverNetwork.generated.h"
+
+class URiver;
+
+/**
+ * All river segments of an island in flat arrays.
+ * A segment runs from its spring (or the point a tributary became a new river) down to where it
+ * either reaches the coast or joins an older segment.
+ */
+USTRUCT(BlueprintType)
+struct POLYGONALMAPGENERATOR_API FRiverNetwork
+{
+	GENERATED_BODY()
+
+public:
+	// Triangles of all segments back to back
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Rivers")
+	TArray<FTriangleIndex> Triangles;
+	// The side each triangle's river leaves through, parallel to Triangles
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Rivers")
+	TArray<FSideIndex> Downslopes;
+	// Segment i covers [SegmentOffsets[i], SegmentOffsets[i + 1]) of Triangles
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Rivers")
+	TArray<int32> SegmentOffsets;
+	// The segment each segment flows into, INDEX_NONE if it ends at the coast
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Rivers")
+	TArray<int32> FeedsInto;
+
+public:
+	void Reset();
+
+	SIZE_T GetAllocatedSize() const
+	{
+		return Triangles.GetAllocatedSize() + Downslopes.GetAllocatedSize() + SegmentOffsets.GetAllocatedSize()
+			+ FeedsInto.GetAllocatedSize();
+	}
+
+	int32 Num() const
+	{
+		return FeedsInto.Num();
+	}
+
+	TArrayView<const FTriangleIndex> GetSegmentTriangles(int32 Segment) const;
+	TArrayView<const FSideIndex> GetSegmentDownslopes(int32 Segment) const;
+
+	/**
+	 * Follows t_downslope_s from every spring in order and adds one unit of flow per spring to every side it crosses.
+	 * A spring stops once it reaches a river traced earlier, its flow is handed down that river afterwards,
+	 * so the work is linear in the total river length instead of the summed length of all paths.
+	 */
+	void Trace(const UTriangleDualMesh* Mesh, const TArray<FSideIndex>& t_downslope_s,
+	           const TArray<FTriangleIndex>& Springs, TArray<int32>& OutSideFlow);
+
+	// One URiver per segment for Blueprint. Creates UObjects, so only call this on the game thread.
+	void CreateRiverObjects(UObject* Outer, TArray<URiver*>& OutRivers) const;
+	// Rebuilds the network from rivers made elsewhere, e.g. by a Blueprint stage.
+	// Null entries and repeats of a river already added are skipped.
+	void AssignFromRiverObjects(const TArray<URiver*>& Rivers);
+};
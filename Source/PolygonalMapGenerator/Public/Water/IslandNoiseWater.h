@@ -30,6 +30,44 @@ class POLYGONALMAPGENERATOR_API UIslandNoiseWater : public UIslandWater
 {
 	GENERATED_BODY()
 
+public:
+	// Samples a precomputed grid of the noise instead of evaluating it per region.
+	// The grid is rebuilt only when the noise domain (offset, mesh size and shape) changes, at the cost of some bilinear error.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Noise Field")
+	bool bCacheNoiseField = false;
+	// Samples per side of the cached grid.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Noise Field", meta = (ClampMin = "2", EditCondition = "bCacheNoiseField"))
+	int32 NoiseFieldResolution = 1024;
+	// Evaluates the noise in a compute shader where the GPU can be used, see IslandComputeGPU.
+	// The GPU rounds differently in the last bits, so leave it off for islands that are replicated or shipped.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Noise Field")
+	bool bEvaluateNoiseOnGPU = false;
+
 protected:
+	struct FNoiseField
+	{
+		uint32 Key = 0;
+		int32 Resolution = 0;
+		FVector2D Min = FVector2D::ZeroVector;
+		// Grid cells per unit of noise position
+		FVector2D CellsPerUnit = FVector2D::ZeroVector;
+		TArray<float> Values;
+
+		float Sample(const FVector2D& NoisePosition) const;
+	};
+
+	mutable FCriticalSection NoiseFieldLock;
+	mutable TSharedPtr<const FNoiseField, ESPMode::ThreadSafe> NoiseField;
+
+	// The cached grid covering the mesh, built on first use for a new noise domain.
+	TSharedPtr<const FNoiseField, ESPMode::ThreadSafe> GetNoiseField(const FVector2D& HalfMeshSize, const FVector2D& Offset, const FIslandShape& Shape) const;
+
+	// FBMNoiseBatch on the GPU with bEvaluateNoiseOnGPU, falls back to the CPU
+	void EvaluateNoise(const FIslandShape& Shape, TConstArrayView<FVector2D> Positions, TArrayView<float> OutNoise) const;
+
 	virtual bool IsPointLand_Implementation(FPointIndex Point, UTriangleDualMesh* Mesh, const FVector2D& HalfMeshSize, const FVector2D& Offset, const FIslandShape& Shape) const override;
+	virtual void ClassifyRegions(TArray<bool>& r_water, UTriangleDualMesh* Mesh, const FVector2D& HalfMeshSize, const FVector2D& Offset, const FIslandShape& Shape) const override;
+
+	static FVector2D GetNoisePosition(const FVector2D& Position, const FVector2D& HalfMeshSize, const FVector2D& Offset, const FIslandShape& Shape);
+	bool IsNoiseLand(float Noise, const FVector2D& NoisePosition) const;
 };
@@ -0,0 +1,32 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+using UnrealBuildTool;
+
+public class PolygonalMapGeneratorShaders : ModuleRules
+{
+	public PolygonalMapGeneratorShaders(ReadOnlyTargetRules ROTargetRules) : base(ROTargetRules)
+    {
+		PCHUsage = ModuleRules.PCHUsageMode.UseExplicitOrSharedPCHs;
+		
+		PublicDependencyModuleNames.AddRange(
+			new string[]
+			{
+				"Core"
+				// ... add other public dependencies that you statically link with here ...
+			}
+			);
+			
+		
+		PrivateDependencyModuleNames.AddRange(
+			new string[]
+			{
+				"CoreUObject",
+				"Engine",
+				"Projects",
+				"RenderCore",
+				"RHI"
+				// ... add private dependencies that you statically link with here ...	
+			}
+			);
+	}
+}
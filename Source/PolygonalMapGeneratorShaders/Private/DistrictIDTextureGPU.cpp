@@ -0,0 +1,192 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "DistrictIDTextureGPU.h"
+
+#include "GlobalShader.h"
+#include "PipelineStateCache.h"
+#include "PolygonalMapGeneratorShaders.h"
+#include "RenderGraphBuilder.h"
+#include "RenderGraphUtils.h"
+#include "RenderingThread.h"
+#include "ShaderParameterStruct.h"
+#include "TextureResource.h"
+#include "Misc/App.h"
+
+namespace
+{
+	constexpr int32 ResolveGroupSize = 8;
+
+	bool ShouldCompileDistrictIDShaders(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return IsFeatureLevelSupported(Parameters.Platform, ERHIFeatureLevel::SM5);
+	}
+}
+
+class FDistrictIDRasterVS : public FGlobalShader
+{
+	DECLARE_GLOBAL_SHADER(FDistrictIDRasterVS);
+	SHADER_USE_PARAMETER_STRUCT(FDistrictIDRasterVS, FGlobalShader);
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<float2>, Positions)
+		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<uint>, Districts)
+		SHADER_PARAMETER(FVector2f, InvTextureSize)
+	END_SHADER_PARAMETER_STRUCT()
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return ShouldCompileDistrictIDShaders(Parameters);
+	}
+};
+
+class FDistrictIDRasterPS : public FGlobalShader
+{
+	DECLARE_GLOBAL_SHADER(FDistrictIDRasterPS);
+	SHADER_USE_PARAMETER_STRUCT(FDistrictIDRasterPS, FGlobalShader);
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		RENDER_TARGET_BINDING_SLOTS()
+	END_SHADER_PARAMETER_STRUCT()
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return ShouldCompileDistrictIDShaders(Parameters);
+	}
+
+	static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters,
+	                                         FShaderCompilerEnvironment& OutEnvironment)
+	{
+		FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+		OutEnvironment.SetRenderTargetOutputFormat(0, PF_R8_UINT);
+	}
+};
+
+class FDistrictIDResolveCS : public FGlobalShader
+{
+	DECLARE_GLOBAL_SHADER(FDistrictIDResolveCS);
+	SHADER_USE_PARAMETER_STRUCT(FDistrictIDResolveCS, FGlobalShader);
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_RDG_TEXTURE(Texture2DMS<uint>, Coverage)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float4>, OutputTexture01)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float4>, OutputTexture02)
+		SHADER_PARAMETER(FUintVector2, TextureSize)
+	END_SHADER_PARAMETER_STRUCT()
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return ShouldCompileDistrictIDShaders(Parameters);
+	}
+
+	static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters,
+	                                         FShaderCompilerEnvironment& OutEnvironment)
+	{
+		FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+		OutEnvironment.SetDefine(TEXT("SAMPLE_COUNT"), DistrictIDTextureGPU::SampleCount);
+		OutEnvironment.SetDefine(TEXT("THREADGROUP_SIZE"), ResolveGroupSize);
+	}
+};
+
+IMPLEMENT_GLOBAL_SHADER(FDistrictIDRasterVS, "/Plugin/IslandGenerator/Private/DistrictIDTexture.usf", "RasterVS", SF_Vertex);
+IMPLEMENT_GLOBAL_SHADER(FDistrictIDRasterPS, "/Plugin/IslandGenerator/Private/DistrictIDTexture.usf", "RasterPS", SF_Pixel);
+IMPLEMENT_GLOBAL_SHADER(FDistrictIDResolveCS, "/Plugin/IslandGenerator/Private/DistrictIDTexture.usf", "ResolveCS", SF_Compute);
+
+BEGIN_SHADER_PARAMETER_STRUCT(FDistrictIDRasterParameters, )
+	SHADER_PARAMETER_STRUCT_INCLUDE(FDistrictIDRasterVS::FParameters, VS)
+	SHADER_PARAMETER_STRUCT_INCLUDE(FDistrictIDRasterPS::FParameters, PS)
+END_SHADER_PARAMETER_STRUCT()
+
+bool DistrictIDTextureGPU::IsSupported(const int32 Width, const int32 Height)
+{
+	return FApp::CanEverRender() && GMaxRHIFeatureLevel >= ERHIFeatureLevel::SM5
+		&& RHISupportsMSAA(GMaxRHIShaderPlatform) && Width > 0 && Height > 0
+		&& static_cast<uint32>(FMath::Max(Width, Height)) <= GetMax2DTextureDimension();
+}
+
+void DistrictIDTextureGPU::EnqueueGenerate(TArray<FVector2f>&& Positions, TArray<uint32>&& Districts,
+                                           const int32 Width, const int32 Height, FTextureResource* Texture01,
+                                           FTextureResource* Texture02)
+{
+	check(Positions.Num() == Districts.Num() * 3);
+	// Structured buffers can not be empty, a degenerate triangle of no district covers nothing
+	if (Districts.IsEmpty())
+	{
+		Positions.SetNumZeroed(3);
+		Districts.Add(0);
+	}
+	ENQUEUE_RENDER_COMMAND(GenerateDistrictIDTexture)(
+		[Positions = MoveTemp(Positions), Districts = MoveTemp(Districts), Width, Height, Texture01, Texture02](
+		FRHICommandListImmediate& RHICmdList)
+		{
+			FRHITexture* Target01 = Texture01->GetTexture2DRHI();
+			FRHITexture* Target02 = Texture02->GetTexture2DRHI();
+			if (Target01 == nullptr || Target02 == nullptr)
+			{
+				UE_LOG(LogMapGenShaders, Error, TEXT("District ID textures have no RHI texture to render into"));
+				return;
+			}
+			FRDGBuilder GraphBuilder(RHICmdList, RDG_EVENT_NAME("DistrictIDTexture"));
+			const FIntPoint Extent(Width, Height);
+
+			FRDGTextureRef Coverage = GraphBuilder.CreateTexture(
+				FRDGTextureDesc::Create2D(Extent, PF_R8_UINT, FClearValueBinding::Black,
+				                          TexCreate_RenderTargetable | TexCreate_ShaderResource, 1, SampleCount),
+				TEXT("DistrictIDCoverage"));
+			FRDGBufferRef PositionBuffer = CreateStructuredBuffer(GraphBuilder, TEXT("DistrictIDPositions"),
+			                                                      sizeof(FVector2f), Positions.Num(),
+			                                                      Positions.GetData(), Positions.NumBytes());
+			FRDGBufferRef DistrictBuffer = CreateStructuredBuffer(GraphBuilder, TEXT("DistrictIDDistricts"),
+			                                                      sizeof(uint32), Districts.Num(),
+			                                                      Districts.GetData(), Districts.NumBytes());
+
+			const FGlobalShaderMap* ShaderMap = GetGlobalShaderMap(GMaxRHIFeatureLevel);
+			TShaderMapRef<FDistrictIDRasterVS> VertexShader(ShaderMap);
+			TShaderMapRef<FDistrictIDRasterPS> PixelShader(ShaderMap);
+			FDistrictIDRasterParameters* RasterParameters = GraphBuilder.AllocParameters<FDistrictIDRasterParameters>();
+			RasterParameters->VS.Positions = GraphBuilder.CreateSRV(PositionBuffer);
+			RasterParameters->VS.Districts = GraphBuilder.CreateSRV(DistrictBuffer);
+			RasterParameters->VS.InvTextureSize = FVector2f(1.f / Width, 1.f / Height);
+			RasterParameters->PS.RenderTargets[0] = FRenderTargetBinding(Coverage, ERenderTargetLoadAction::EClear);
+			const int32 TriangleNum = Districts.Num();
+			GraphBuilder.AddPass(RDG_EVENT_NAME("RasterDistricts"), RasterParameters, ERDGPassFlags::Raster,
+			                     [RasterParameters, VertexShader, PixelShader, Width, Height, TriangleNum](
+			                     FRHICommandList& RHICmdList)
+			                     {
+				                     RHICmdList.SetViewport(0.f, 0.f, 0.f, Width, Height, 1.f);
+				                     FGraphicsPipelineStateInitializer GraphicsPSOInit;
+				                     RHICmdList.ApplyCachedRenderTargets(GraphicsPSOInit);
+				                     GraphicsPSOInit.BlendState = TStaticBlendState<>::GetRHI();
+				                     GraphicsPSOInit.RasterizerState = TStaticRasterizerState<FM_Solid, CM_None>::GetRHI();
+				                     GraphicsPSOInit.DepthStencilState = TStaticDepthStencilState<false, CF_Always>::GetRHI();
+				                     GraphicsPSOInit.BoundShaderState.VertexDeclarationRHI = GEmptyVertexDeclaration.VertexDeclarationRHI;
+				                     GraphicsPSOInit.BoundShaderState.VertexShaderRHI = VertexShader.GetVertexShader();
+				                     GraphicsPSOInit.BoundShaderState.PixelShaderRHI = PixelShader.GetPixelShader();
+				                     GraphicsPSOInit.PrimitiveType = PT_TriangleList;
+				                     SetGraphicsPipelineState(RHICmdList, GraphicsPSOInit, 0);
+				                     SetShaderParameters(RHICmdList, VertexShader, VertexShader.GetVertexShader(),
+				                                         RasterParameters->VS);
+				                     RHICmdList.DrawPrimitive(0, TriangleNum, 1);
+			                     });
+
+			// The textures of UTexture2D are not UAVs, so the resolve writes intermediates that are copied over
+			const FRDGTextureDesc OutputDesc = FRDGTextureDesc::Create2D(
+				Extent, Target01->GetFormat(), FClearValueBinding::None, TexCreate_ShaderResource | TexCreate_UAV);
+			FRDGTextureRef Output01 = GraphBuilder.CreateTexture(OutputDesc, TEXT("DistrictIDOutput01"));
+			FRDGTextureRef Output02 = GraphBuilder.CreateTexture(OutputDesc, TEXT("DistrictIDOutput02"));
+			FDistrictIDResolveCS::FParameters* ResolveParameters =
+				GraphBuilder.AllocParameters<FDistrictIDResolveCS::FParameters>();
+			ResolveParameters->Coverage = Coverage;
+			ResolveParameters->OutputTexture01 = GraphBuilder.CreateUAV(Output01);
+			ResolveParameters->OutputTexture02 = GraphBuilder.CreateUAV(Output02);
+			ResolveParameters->TextureSize = FUintVector2(Width, Height);
+			FComputeShaderUtils::AddPass(GraphBuilder, RDG_EVENT_NAME("ResolveDistricts"),
+			                             TShaderMapRef<FDistrictIDResolveCS>(ShaderMap), ResolveParameters,
+			                             FComputeShaderUtils::GetGroupCount(Extent, ResolveGroupSize));
+
+			AddCopyTexturePass(GraphBuilder, Output01,
+			                   GraphBuilder.RegisterExternalTexture(CreateRenderTarget(Target01, TEXT("DistrictIDTexture01"))));
+			AddCopyTexturePass(GraphBuilder, Output02,
+			                   GraphBuilder.RegisterExternalTexture(CreateRenderTarget(Target02, TEXT("DistrictIDTexture02"))));
+			GraphBuilder.Execute();
+		});
+}
@@ -0,0 +1,168 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "IslandComputeGPU.h"
+
+#include "GlobalShader.h"
+#include "HAL/IConsoleManager.h"
+#include "PolygonalMapGeneratorShaders.h"
+#include "RenderGraphBuilder.h"
+#include "RenderGraphUtils.h"
+#include "RenderingThread.h"
+#include "RHIGPUReadback.h"
+#include "ShaderParameterStruct.h"
+#include "Misc/App.h"
+
+namespace
+{
+	constexpr int32 FBMGroupSize = 64;
+
+	TAutoConsoleVariable<bool> CVarAllowGPUStages(
+		TEXT("island.AllowGPUStages"),
+		true,
+		TEXT("Lets generation stages that have a compute shader run it instead of their CPU implementation."),
+		ECVF_Default);
+}
+
+class FIslandFBMNoiseCS : public FGlobalShader
+{
+	DECLARE_GLOBAL_SHADER(FIslandFBMNoiseCS);
+	SHADER_USE_PARAMETER_STRUCT(FIslandFBMNoiseCS, FGlobalShader);
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<float2>, Positions)
+		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<float>, Amplitudes)
+		SHADER_PARAMETER_RDG_BUFFER_UAV(RWStructuredBuffer<float>, OutNoise)
+		SHADER_PARAMETER(uint32, PositionNum)
+		SHADER_PARAMETER(uint32, OctaveNum)
+	END_SHADER_PARAMETER_STRUCT()
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return IsFeatureLevelSupported(Parameters.Platform, ERHIFeatureLevel::SM5);
+	}
+
+	static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters,
+	                                         FShaderCompilerEnvironment& OutEnvironment)
+	{
+		FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+		OutEnvironment.SetDefine(TEXT("THREADGROUP_SIZE"), FBMGroupSize);
+		OutEnvironment.SetDefine(TEXT("MAX_FREQUENCIES"), 2 * IslandComputeGPU::MaxFBMOctaves - 2);
+	}
+};
+
+IMPLEMENT_GLOBAL_SHADER(FIslandFBMNoiseCS, "/Plugin/IslandGenerator/Private/IslandNoise.usf", "FBMNoiseCS", SF_Compute);
+
+IslandComputeGPU::FResult::FResult() = default;
+
+IslandComputeGPU::FResult::~FResult() = default;
+
+bool IslandComputeGPU::FResult::Read(void* OutData, const uint32 NumBytes)
+{
+	if (NumBytes == 0)
+	{
+		return true;
+	}
+	bool bRead = false;
+	FEvent* Done = FPlatformProcess::GetSynchEventFromPool();
+	ENQUEUE_RENDER_COMMAND(ReadIslandCompute)([this, OutData, NumBytes, Done, &bRead](FRHICommandListImmediate& RHICmdList)
+	{
+		if (Buffer.IsValid() && Buffer->GetSize() >= NumBytes)
+		{
+			FRHIGPUBufferReadback Readback(TEXT("IslandComputeReadback"));
+			FRDGBuilder GraphBuilder(RHICmdList, RDG_EVENT_NAME("ReadIslandCompute"));
+			AddEnqueueCopyPass(GraphBuilder, &Readback, GraphBuilder.RegisterExternalBuffer(Buffer), NumBytes);
+			GraphBuilder.Execute();
+			RHICmdList.ImmediateFlush(EImmediateFlushType::FlushRHIThread);
+			RHICmdList.BlockUntilGPUIdle();
+			FMemory::Memcpy(OutData, Readback.Lock(NumBytes), NumBytes);
+			Readback.Unlock();
+			bRead = true;
+		}
+		Done->Trigger();
+	});
+	Done->Wait();
+	FPlatformProcess::ReturnSynchEventToPool(Done);
+	if (!bRead)
+	{
+		UE_LOG(LogMapGenShaders, Warning, TEXT("Island compute result is smaller than the %u bytes read"), NumBytes);
+	}
+	return bRead;
+}
+
+bool IslandComputeGPU::IsSupported()
+{
+	return CVarAllowGPUStages.GetValueOnAnyThread() && FApp::CanEverRender()
+		&& GMaxRHIFeatureLevel >= ERHIFeatureLevel::SM5 && (GIsThreadedRendering || IsInGameThread())
+		&& !IsInActualRenderingThread();
+}
+
+TSharedPtr<IslandComputeGPU::FResult, ESPMode::ThreadSafe> IslandComputeGPU::Dispatch(
+	const TCHAR* Name, TUniqueFunction<FRDGBuffer*(FRDGBuilder&)>&& BuildPasses)
+{
+	if (!IsSupported())
+	{
+		return nullptr;
+	}
+	TSharedRef<FResult, ESPMode::ThreadSafe> Result = MakeShared<FResult, ESPMode::ThreadSafe>();
+	ENQUEUE_RENDER_COMMAND(DispatchIslandCompute)(
+		[Result, Name, BuildPasses = MoveTemp(BuildPasses)](FRHICommandListImmediate& RHICmdList) mutable
+		{
+			FRDGBuilder GraphBuilder(RHICmdList, RDG_EVENT_NAME("IslandCompute %s", Name));
+			if (FRDGBufferRef Output = BuildPasses(GraphBuilder))
+			{
+				GraphBuilder.QueueBufferExtraction(Output, &Result->Buffer);
+			}
+			GraphBuilder.Execute();
+		});
+	return Result;
+}
+
+bool IslandComputeGPU::FBMNoise(TConstArrayView<FVector2D> Positions, TConstArrayView<float> Amplitudes,
+                                TArrayView<float> OutNoise)
+{
+	check(Positions.Num() == OutNoise.Num());
+	if (Amplitudes.Num() > MaxFBMOctaves || !IsSupported())
+	{
+		return false;
+	}
+	// Nothing to upload, and without amplitudes the CPU sum is zero everywhere
+	if (Positions.IsEmpty() || Amplitudes.IsEmpty())
+	{
+		FMemory::Memzero(OutNoise.GetData(), OutNoise.NumBytes());
+		return true;
+	}
+
+	// The CPU casts every scaled position to float, scaling by powers of two commutes with that cast
+	TArray<FVector2f> PositionData;
+	PositionData.SetNumUninitialized(Positions.Num());
+	for (int32 Index = 0; Index < Positions.Num(); ++Index)
+	{
+		PositionData[Index] = FVector2f(Positions[Index]);
+	}
+	TArray<float> AmplitudeData(Amplitudes.GetData(), Amplitudes.Num());
+	const TSharedPtr<FResult, ESPMode::ThreadSafe> Result = Dispatch(TEXT("FBMNoise"),
+		[PositionData = MoveTemp(PositionData), AmplitudeData = MoveTemp(AmplitudeData)](FRDGBuilder& GraphBuilder)
+		{
+			const uint32 PositionNum = PositionData.Num();
+			FRDGBufferRef PositionBuffer = CreateStructuredBuffer(GraphBuilder, TEXT("IslandFBMPositions"),
+			                                                      sizeof(FVector2f), PositionNum,
+			                                                      PositionData.GetData(), PositionData.NumBytes());
+			FRDGBufferRef AmplitudeBuffer = CreateStructuredBuffer(GraphBuilder, TEXT("IslandFBMAmplitudes"),
+			                                                       sizeof(float), AmplitudeData.Num(),
+			                                                       AmplitudeData.GetData(), AmplitudeData.NumBytes());
+			FRDGBufferRef NoiseBuffer = GraphBuilder.CreateBuffer(
+				FRDGBufferDesc::CreateStructuredDesc(sizeof(float), PositionNum), TEXT("IslandFBMNoise"));
+
+			FIslandFBMNoiseCS::FParameters* Parameters = GraphBuilder.AllocParameters<FIslandFBMNoiseCS::FParameters>();
+			Parameters->Positions = GraphBuilder.CreateSRV(PositionBuffer);
+			Parameters->Amplitudes = GraphBuilder.CreateSRV(AmplitudeBuffer);
+			Parameters->OutNoise = GraphBuilder.CreateUAV(NoiseBuffer);
+			Parameters->PositionNum = PositionNum;
+			Parameters->OctaveNum = AmplitudeData.Num();
+			FComputeShaderUtils::AddPass(GraphBuilder, RDG_EVENT_NAME("FBMNoise"),
+			                             TShaderMapRef<FIslandFBMNoiseCS>(GetGlobalShaderMap(GMaxRHIFeatureLevel)),
+			                             Parameters, FComputeShaderUtils::GetGroupCount(PositionNum, FBMGroupSize));
+			return NoiseBuffer;
+		});
+	return Result.IsValid() && Result->Read(OutNoise);
+}
@@ -0,0 +1,26 @@
+// Copyright 1998-2016 Epic Games, Inc. All Rights Reserved.
+
+#include "PolygonalMapGeneratorShaders.h"
+
+#include "Interfaces/IPluginManager.h"
+#include "Misc/Paths.h"
+#include "ShaderCore.h"
+
+#define LOCTEXT_NAMESPACE "FPolygonalMapGeneratorShadersModule"
+
+DEFINE_LOG_CATEGORY(LogMapGenShaders);
+
+void FPolygonalMapGeneratorShadersModule::StartupModule()
+{
+	const TSharedPtr<IPlugin> Plugin = IPluginManager::Get().FindPlugin(TEXT("IslandGenerator"));
+	check(Plugin.IsValid());
+	AddShaderSourceDirectoryMapping(TEXT("/Plugin/IslandGenerator"), FPaths::Combine(Plugin->GetBaseDir(), TEXT("Shaders")));
+}
+
+void FPolygonalMapGeneratorShadersModule::ShutdownModule()
+{
+}
+
+#undef LOCTEXT_NAMESPACE
+	
+IMPLEMENT_MODULE(FPolygonalMapGeneratorShadersModule, PolygonalMapGeneratorShaders)
@@ -0,0 +1,30 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FTextureResource;
+
+/**
+ * Renders the two district ID textures on the GPU. Every sample of a multisampled target stores the district whose
+ * triangle covers it, a compute pass counts the samples of each pixel and writes the four largest districts with the
+ * same encoding and padding as DistrictIDTexture::ResolveRows. Proportions are multiples of 1 / SampleCount.
+ */
+namespace DistrictIDTextureGPU
+{
+	// The coverage target stores one 8 bit ID per sample
+	constexpr int32 MaxDistricts = 255;
+	constexpr int32 SampleCount = 8;
+
+	/** False on servers, null RHIs and platforms without SM5 or multisampling. */
+	POLYGONALMAPGENERATORSHADERS_API bool IsSupported(int32 Width, int32 Height);
+
+	/**
+	 * Enqueues the passes on the render thread. Positions are in texture space, three per triangle, Districts are
+	 * 1-based, one per triangle. Both textures must be FloatRGBA or R8G8B8A8 of Width x Height with their resource initialized.
+	 */
+	POLYGONALMAPGENERATORSHADERS_API void EnqueueGenerate(TArray<FVector2f>&& Positions, TArray<uint32>&& Districts,
+	                                                      int32 Width, int32 Height, FTextureResource* Texture01,
+	                                                      FTextureResource* Texture02);
+}
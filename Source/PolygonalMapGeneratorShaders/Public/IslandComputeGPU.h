@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/RefCounting.h"
+
+class FRDGBuffer;
+class FRDGBuilder;
+class FRDGPooledBuffer;
+
+/**
+ * Runs the element-parallel passes of the generation stages as compute shaders. A stage uploads the flat arrays it
+ * reads as structured buffers, adds its passes to a graph of its own and leaves the result on the GPU. The result is
+ * only read back once a CPU stage needs the values. Everything here fails where the GPU can not be used, the stage
+ * then runs its CPU implementation instead.
+ */
+namespace IslandComputeGPU
+{
+	/** The buffer a Dispatch produced, kept on the GPU until it is read. */
+	class POLYGONALMAPGENERATORSHADERS_API FResult
+	{
+	public:
+		FResult();
+		~FResult();
+
+		/** Blocks until the passes ran and copies the first NumBytes of the buffer, false if they produced less. */
+		bool Read(void* OutData, uint32 NumBytes);
+
+		template <typename T>
+		bool Read(TArrayView<T> OutValues)
+		{
+			return Read(OutValues.GetData(), OutValues.NumBytes());
+		}
+
+		// Set by the dispatch, only touched on the render thread, which runs the dispatch before every read
+		TRefCountPtr<FRDGPooledBuffer> Buffer;
+	};
+
+	/**
+	 * False on servers, null RHIs, platforms without SM5, with island.AllowGPUStages off, and on worker threads when
+	 * rendering is not threaded.
+	 */
+	POLYGONALMAPGENERATORSHADERS_API bool IsSupported();
+
+	/**
+	 * Builds the passes of BuildPasses on the render thread and returns the buffer it returned, without waiting for
+	 * them. Name must be a literal. Null if the GPU path is not supported.
+	 */
+	POLYGONALMAPGENERATORSHADERS_API TSharedPtr<FResult, ESPMode::ThreadSafe> Dispatch(
+		const TCHAR* Name, TUniqueFunction<FRDGBuffer*(FRDGBuilder&)>&& BuildPasses);
+
+	/**
+	 * UIslandMapUtils::FBMNoiseBatch on the GPU, waits for the result. Same inputs and summation order as the CPU, the
+	 * values still differ in the last bits. False if not supported or with more than MaxFBMOctaves amplitudes.
+	 */
+	constexpr int32 MaxFBMOctaves = 16;
+	POLYGONALMAPGENERATORSHADERS_API bool FBMNoise(TConstArrayView<FVector2D> Positions, TConstArrayView<float> Amplitudes,
+	                                               TArrayView<float> OutNoise);
+}